@@ -31,6 +31,9 @@
 #include "gdal_priv.h"
 #include "gdal_alg.h"
 #include "ogr_api.h"
+#include "cpl_multiproc.h"
+#include <map>
+#include <vector>
 
 CPL_CVSID("$Id: contour.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -44,56 +47,69 @@ CPL_CVSID("$Id: contour.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
 #define JOIN_DIST 0.0001
 
+// The size of the cells in which the line ends are indexed for joining.  It
+// is a power of two fraction of a pixel, much larger than JOIN_DIST, so that
+// the neighbouring cells rarely need to be checked.
+
+#define JOIN_CELL_SIZE (1.0 / 1024.0)
+
+class GDALContourLevel;
+
 /************************************************************************/
 /*                           GDALContourItem                            */
 /************************************************************************/
 class GDALContourItem
 {
 public:
-    int    bRecentlyAccessed;
+    int    iLastLine;
+    int    iOpen;
+    GDALContourLevel *poLevel;
     double dfLevel;
 
     int  nPoints;
     int  nMaxPoints;
+    int  nHeadRoom;
     double *padfX;
     double *padfY;
 
     int bLeftIsHigh;
 
-    double dfTailX;
-
     GDALContourItem( double dfLevel );
     ~GDALContourItem();
 
-    int    AddSegment( double dfXStart, double dfYStart,
+    void   AddSegment( double dfXStart, double dfYStart,
                        double dfXEnd, double dfYEnd, int bLeftHigh );
-    void   MakeRoomFor( int );
-    int    Merge( GDALContourItem * );
+    void   AddPoint( double dfX, double dfY, int bAtTail );
+    void   MakeRoomFor( int nAtHead, int nAtTail );
+    void   Merge( GDALContourItem *, int bAtTail, int bOtherTail );
+    int    IsClosed();
     void   PrepareEjection();
 };
 
 /************************************************************************/
 /*                           GDALContourLevel                           */
 /************************************************************************/
+
+typedef std::pair<GIntBig,GIntBig> GDALContourCell;
+typedef std::pair<GDALContourItem*,int> GDALContourEnd;
+typedef std::multimap<GDALContourCell,GDALContourEnd> GDALContourEndMap;
+
 class GDALContourLevel 
 {
     double dfLevel;
 
-    int nEntryMax;
-    int nEntryCount;
-    GDALContourItem **papoEntries;
+    // The head and tail ends of the open contours, by cell.
+    GDALContourEndMap oEnds;
     
 public:
     GDALContourLevel( double );
     ~GDALContourLevel();
 
     double GetLevel() { return dfLevel; }
-    int    GetContourCount() { return nEntryCount; }
-    GDALContourItem *GetContour( int i) { return papoEntries[i]; }
-    void   AdjustContour( int );
-    void   RemoveContour( int );
-    int    FindContour( double dfX, double dfY );
-    int    InsertContour( GDALContourItem * );
+    int    GetContourCount() { return (int) oEnds.size() / 2; }
+    void   InsertEnd( GDALContourItem *, int bTail );
+    void   RemoveEnd( GDALContourItem *, int bTail );
+    GDALContourItem *FindContour( double dfX, double dfY, int *pbTail );
 };
 
 /************************************************************************/
@@ -104,16 +120,19 @@ class GDALContourGenerator
     int    nWidth;
     int    nHeight;
     int    iLine;
+    int    nEndLine;
+    int    bLoadLineAbove;
 
     double *padfLastLine;
     double *padfThisLine;
 
     int    nLevelMax;
     int    nLevelCount;
+    int    nLevelBase;
     GDALContourLevel **papoLevels;
 
-    int    iLastLevel;
-    
+    std::vector<GDALContourItem*> apoOpen;
+
     int     bNoDataActive;
     double  dfNoDataValue;
 
@@ -121,7 +140,7 @@ class GDALContourGenerator
     double  dfContourInterval;
     double  dfContourOffset;
 
-    CPLErr AddSegment( double dfLevel, 
+    CPLErr AddSegment( GDALContourLevel *poLevel,
                        double dfXStart, double dfYStart,
                        double dfXEnd, double dfYEnd, int bLeftHigh );
 
@@ -136,6 +155,11 @@ class GDALContourGenerator
                       double, double, int *, double *, double * );
 
     GDALContourLevel *FindLevel( double dfLevel );
+    GDALContourLevel *GetIntervalLevel( int iLevel );
+
+    void   AddOpenContour( GDALContourItem * );
+    void   RemoveOpenContour( GDALContourItem * );
+    CPLErr EjectContour( GDALContourItem * );
 
 public:
     GDALContourWriter pfnWriter;
@@ -152,7 +176,10 @@ public:
           this->dfContourOffset = dfContourOffset; }
 
     void                SetFixedLevels( int, double * );
+    void                SetStripLines( int iStartLine, int iEndLine );
+    void                SetLine( int iLineIn ) { iLine = iLineIn; }
     CPLErr              FeedLine( double *padfScanline );
+    CPLErr              AddContour( GDALContourItem * );
     CPLErr              EjectContours( int bOnlyUnused = FALSE );
     
 };
@@ -223,6 +250,8 @@ GDALContourGenerator::GDALContourGenerator( int nWidthIn, int nHeightIn,
     pWriterCBData = pWriterCBDataIn;
 
     iLine = -1;
+    nEndLine = nHeight;
+    bLoadLineAbove = FALSE;
 
     bNoDataActive = FALSE;
     dfNoDataValue = -1000000.0;
@@ -231,6 +260,7 @@ GDALContourGenerator::GDALContourGenerator( int nWidthIn, int nHeightIn,
 
     nLevelMax = 0;
     nLevelCount = 0;
+    nLevelBase = 0;
     papoLevels = NULL;
     bFixedLevels = FALSE;
 }
@@ -242,8 +272,17 @@ GDALContourGenerator::GDALContourGenerator( int nWidthIn, int nHeightIn,
 GDALContourGenerator::~GDALContourGenerator()
 
 {
+    size_t iOpen;
     int i;
 
+    // Contours left open by an error.
+    for( iOpen = 0; iOpen < apoOpen.size(); iOpen++ )
+    {
+        apoOpen[iOpen]->poLevel->RemoveEnd( apoOpen[iOpen], FALSE );
+        apoOpen[iOpen]->poLevel->RemoveEnd( apoOpen[iOpen], TRUE );
+        delete apoOpen[iOpen];
+    }
+
     for( i = 0; i < nLevelCount; i++ )
         delete papoLevels[i];
     CPLFree( papoLevels );
@@ -265,6 +304,29 @@ void GDALContourGenerator::SetFixedLevels( int nFixedLevelCount,
         FindLevel( padfFixedLevels[i] );
 }
 
+/************************************************************************/
+/*                           SetStripLines()                            */
+/*                                                                      */
+/*      Restrict the generator to the rectangles between the lines      */
+/*      iStartLine-1 and iEndLine-1, for the processing of a strip of   */
+/*      the raster.  The line above the strip, if any, is the first     */
+/*      one to be fed.  The contours are all ejected after the last     */
+/*      line of the strip, and those reaching its top or bottom are     */
+/*      to be joined with those of the neighbouring strips.             */
+/************************************************************************/
+
+void GDALContourGenerator::SetStripLines( int iStartLine, int iEndLine )
+
+{
+    if( iStartLine > 0 )
+    {
+        iLine = iStartLine;
+        bLoadLineAbove = TRUE;
+    }
+
+    nEndLine = iEndLine;
+}
+
 /************************************************************************/
 /*                             SetNoData()                              */
 /************************************************************************/
@@ -486,10 +548,22 @@ CPLErr GDALContourGenerator::ProcessRect(
         if( iStartLevel == -1 )
             iStartLevel = nEnd + 1;
 
+        /* The last level below dfMax, by binary search too. */
         iEndLevel = iStartLevel;
-        while( iEndLevel < nLevelCount-1 
-               && papoLevels[iEndLevel+1]->GetLevel() < dfMax )
-            iEndLevel++;
+        nStart = iStartLevel + 1;
+        nEnd = nLevelCount - 1;
+        while( nStart <= nEnd )
+        {
+            nMiddle = (nEnd + nStart) / 2;
+
+            if( papoLevels[nMiddle]->GetLevel() < dfMax )
+            {
+                iEndLevel = nMiddle;
+                nStart = nMiddle + 1;
+            }
+            else
+                nEnd = nMiddle - 1;
+        }
 
         if( iStartLevel >= nLevelCount )
             return CE_None;
@@ -519,12 +593,14 @@ CPLErr GDALContourGenerator::ProcessRect(
 
     for( iLevel = iStartLevel; iLevel <= iEndLevel; iLevel++ )
     {
-        double dfLevel;
+        GDALContourLevel *poLevel;
 
         if( bFixedLevels )
-            dfLevel = papoLevels[iLevel]->GetLevel();
+            poLevel = papoLevels[iLevel];
         else
-            dfLevel = iLevel * dfContourInterval + dfContourOffset;
+            poLevel = GetIntervalLevel( iLevel );
+
+        double dfLevel = poLevel->GetLevel();
 
         int  nPoints = 0; 
         double adfX[4], adfY[4];
@@ -570,11 +646,11 @@ CPLErr GDALContourGenerator::ProcessRect(
                 ( ( (nPoints3 == 1 && nPoints  == 2)  ) &&
                                          dfLoRight > dfUpRight )
               )
-                eErr = AddSegment( dfLevel,
+                eErr = AddSegment( poLevel,
                                    adfX[0], adfY[0], adfX[1], adfY[1],
                                    TRUE );
             else
-                eErr = AddSegment( dfLevel,
+                eErr = AddSegment( poLevel,
                                    adfX[0], adfY[0], adfX[1], adfY[1],
                                    FALSE );
 
@@ -588,7 +664,7 @@ CPLErr GDALContourGenerator::ProcessRect(
             ** right+top, therefore "left is high" if loRight is larger than
             ** up right...
             */
-            eErr = AddSegment( dfLevel,
+            eErr = AddSegment( poLevel,
                                adfX[2], adfY[2], adfX[3], adfY[3],
                                ( dfLoRight > dfUpRight) );
             if( eErr != CE_None )
@@ -636,52 +712,207 @@ void GDALContourGenerator::Intersect( double dfVal1, double dfX1, double dfY1,
 
 /************************************************************************/
 /*                             AddSegment()                             */
+/*                                                                      */
+/*      Add a segment to the open contour ending where it starts or     */
+/*      ends, if any, and join that contour with the one it then        */
+/*      meets, if any.  The ends of the open contours are indexed by    */
+/*      level, so this does not depend on the number of contours.      */
 /************************************************************************/
 
-CPLErr GDALContourGenerator::AddSegment( double dfLevel, 
+CPLErr GDALContourGenerator::AddSegment( GDALContourLevel *poLevel, 
                                          double dfX1, double dfY1,
                                          double dfX2, double dfY2,
                                          int bLeftHigh)
 
 {
-    GDALContourLevel *poLevel = FindLevel( dfLevel );
     GDALContourItem *poTarget;
-    int iTarget;
+    int bTail, bStartMatched = TRUE;
+
+    poTarget = poLevel->FindContour( dfX1, dfY1, &bTail );
+    if( poTarget == NULL )
+    {
+        bStartMatched = FALSE;
+        poTarget = poLevel->FindContour( dfX2, dfY2, &bTail );
+    }
 
 /* -------------------------------------------------------------------- */
-/*      Check all active contours for any that this might attach        */
-/*      to. Eventually this should be recoded to find the contours      */
-/*      of the correct level more efficiently.                          */
+/*      No existing contour found, lets create a new one.               */
 /* -------------------------------------------------------------------- */
-
-    if( dfY1 < dfY2 )
-        iTarget = poLevel->FindContour( dfX1, dfY1 );
-    else
-        iTarget = poLevel->FindContour( dfX2, dfY2 );
-
-    if( iTarget != -1 )
+    if( poTarget == NULL )
     {
-        poTarget = poLevel->GetContour( iTarget );
+        poTarget = new GDALContourItem( poLevel->GetLevel() );
+        poTarget->poLevel = poLevel;
+        poTarget->iLastLine = iLine;
 
         poTarget->AddSegment( dfX1, dfY1, dfX2, dfY2, bLeftHigh );
 
-        poLevel->AdjustContour( iTarget );
-        
+        poLevel->InsertEnd( poTarget, FALSE );
+        poLevel->InsertEnd( poTarget, TRUE );
+        AddOpenContour( poTarget );
+
         return CE_None;
     }
 
 /* -------------------------------------------------------------------- */
-/*      No existing contour found, lets create a new one.               */
+/*      Extend the contour found.                                       */
 /* -------------------------------------------------------------------- */
-    poTarget = new GDALContourItem( dfLevel );
+    poLevel->RemoveEnd( poTarget, bTail );
 
-    poTarget->AddSegment( dfX1, dfY1, dfX2, dfY2, bLeftHigh );
+    if( bStartMatched )
+        poTarget->AddPoint( dfX2, dfY2, bTail );
+    else
+        poTarget->AddPoint( dfX1, dfY1, bTail );
+    poTarget->iLastLine = iLine;
 
-    poLevel->InsertContour( poTarget );
+/* -------------------------------------------------------------------- */
+/*      Does its new end meet another contour, or its other end?        */
+/* -------------------------------------------------------------------- */
+    GDALContourItem *poOther = NULL;
+    int bOtherTail = FALSE;
+
+    if( bStartMatched )
+        poOther = poLevel->FindContour( dfX2, dfY2, &bOtherTail );
+
+    if( poOther == NULL )
+    {
+        poLevel->InsertEnd( poTarget, bTail );
+        return CE_None;
+    }
+
+    poLevel->RemoveEnd( poTarget, !bTail );
+    RemoveOpenContour( poTarget );
+
+    if( poOther == poTarget )
+        return EjectContour( poTarget );
+    else
+        return AddContour( poTarget );
+}
+
+/************************************************************************/
+/*                             AddContour()                             */
+/*                                                                      */
+/*      Add a contour line, which is not among the open contours,       */
+/*      joining it with the open contours at its ends.  The smaller     */
+/*      one is merged into the larger one, so the cost of merges is     */
+/*      O(n log n) in the number of points.  This is also used to       */
+/*      stitch the contours of the strips of the raster.                */
+/************************************************************************/
+
+CPLErr GDALContourGenerator::AddContour( GDALContourItem *poItem )
+
+{
+    GDALContourLevel *poLevel = poItem->poLevel;
+
+    if( poLevel == NULL )
+    {
+        if( bFixedLevels )
+            poLevel = FindLevel( poItem->dfLevel );
+        else
+            poLevel = GetIntervalLevel( (int) 
+                floor( (poItem->dfLevel - dfContourOffset) 
+                       / dfContourInterval + 0.5 ) );
+        poItem->poLevel = poLevel;
+    }
+
+    for( ;; )
+    {
+        if( poItem->IsClosed() )
+            return EjectContour( poItem );
+
+        GDALContourItem *poOther = NULL;
+        int bTail, bOtherTail = FALSE;
+
+        for( bTail = FALSE; bTail <= TRUE; bTail++ )
+        {
+            int iPoint = bTail ? poItem->nPoints - 1 : 0;
+
+            poOther = poLevel->FindContour( poItem->padfX[iPoint], 
+                                            poItem->padfY[iPoint], 
+                                            &bOtherTail );
+            if( poOther != NULL )
+                break;
+        }
+
+        if( poOther == NULL )
+            break;
+
+        poLevel->RemoveEnd( poOther, FALSE );
+        poLevel->RemoveEnd( poOther, TRUE );
+        RemoveOpenContour( poOther );
+
+        if( poOther->nPoints > poItem->nPoints )
+        {
+            poOther->Merge( poItem, bOtherTail, bTail );
+            delete poItem;
+            poItem = poOther;
+        }
+        else
+        {
+            poItem->Merge( poOther, bTail, bOtherTail );
+            delete poOther;
+        }
+    }
+
+    poItem->iLastLine = iLine;
+
+    poLevel->InsertEnd( poItem, FALSE );
+    poLevel->InsertEnd( poItem, TRUE );
+    AddOpenContour( poItem );
 
     return CE_None;
 }
 
+/************************************************************************/
+/*                           AddOpenContour()                           */
+/************************************************************************/
+
+void GDALContourGenerator::AddOpenContour( GDALContourItem *poItem )
+
+{
+    poItem->iOpen = (int) apoOpen.size();
+    apoOpen.push_back( poItem );
+}
+
+/************************************************************************/
+/*                         RemoveOpenContour()                          */
+/************************************************************************/
+
+void GDALContourGenerator::RemoveOpenContour( GDALContourItem *poItem )
+
+{
+    GDALContourItem *poLast = apoOpen.back();
+
+    apoOpen[poItem->iOpen] = poLast;
+    poLast->iOpen = poItem->iOpen;
+    apoOpen.pop_back();
+}
+
+/************************************************************************/
+/*                            EjectContour()                            */
+/*                                                                      */
+/*      Write out and destroy a contour that is no longer open.         */
+/************************************************************************/
+
+CPLErr GDALContourGenerator::EjectContour( GDALContourItem *poItem )
+
+{
+    CPLErr eErr = CE_None;
+
+    if( pfnWriter != NULL )
+    {
+        // If direction is wrong, then reverse before ejecting.
+        poItem->PrepareEjection();
+
+        eErr = pfnWriter( poItem->dfLevel, poItem->nPoints, 
+                          poItem->padfX, poItem->padfY, 
+                          pWriterCBData );
+    }
+
+    delete poItem;
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                              FeedLine()                              */
 /************************************************************************/
@@ -731,26 +962,18 @@ CPLErr GDALContourGenerator::FeedLine( double *padfScanline )
 
 /* -------------------------------------------------------------------- */
 /*      If this is the first line we need to initialize the previous    */
-/*      line from the first line of data.                               */
+/*      line from the first line of data.  The line above a strip is    */
+/*      only kept for the next one.                                     */
 /* -------------------------------------------------------------------- */
     if( iLine == -1 )
     {
         memcpy( padfLastLine, padfThisLine, sizeof(double) * nWidth );
         iLine = 0;
     }
-
-/* -------------------------------------------------------------------- */
-/*      Clear the recently used flags on the contours so we can         */
-/*      check later which ones were touched for this scanline.          */
-/* -------------------------------------------------------------------- */
-    int iLevel, iContour;
-
-    for( iLevel = 0; iLevel < nLevelCount; iLevel++ )
+    else if( bLoadLineAbove )
     {
-        GDALContourLevel *poLevel = papoLevels[iLevel];
-
-        for( iContour = 0; iContour < poLevel->GetContourCount(); iContour++ )
-            poLevel->GetContour( iContour )->bRecentlyAccessed = FALSE;
+        bLoadLineAbove = FALSE;
+        return CE_None;
     }
 
 /* -------------------------------------------------------------------- */
@@ -770,8 +993,13 @@ CPLErr GDALContourGenerator::FeedLine( double *padfScanline )
 
     iLine++;
 
-    if( iLine == nHeight && eErr == CE_None )
-        return FeedLine( NULL );
+    if( iLine == nEndLine && eErr == CE_None )
+    {
+        if( nEndLine == nHeight )
+            return FeedLine( NULL );
+        else
+            return EjectContours( FALSE );
+    }
     else
         return eErr;
 }
@@ -783,58 +1011,29 @@ CPLErr GDALContourGenerator::FeedLine( double *padfScanline )
 CPLErr GDALContourGenerator::EjectContours( int bOnlyUnused )
 
 {
-    int iLevel;
     CPLErr eErr = CE_None;
+    size_t iOpen;
 
 /* -------------------------------------------------------------------- */
-/*      Process all contours of all levels that match our criteria      */
+/*      Process all open contours that match our criteria.  Those       */
+/*      which didn't grow on this line can't grow anymore.              */
 /* -------------------------------------------------------------------- */
-    for( iLevel = 0; iLevel < nLevelCount && eErr == CE_None; iLevel++ )
+    for( iOpen = 0; iOpen < apoOpen.size() && eErr == CE_None; 
+         /* increment in loop if we don't consume it. */ )
     {
-        GDALContourLevel *poLevel = papoLevels[iLevel];
-        int iContour;
+        GDALContourItem *poTarget = apoOpen[iOpen];
 
-        for( iContour = 0; 
-             iContour < poLevel->GetContourCount() && eErr == CE_None; 
-             /* increment in loop if we don't consume it. */ )
+        if( bOnlyUnused && poTarget->iLastLine == iLine )
         {
-            int  iC2;
-            GDALContourItem *poTarget = poLevel->GetContour( iContour );
-            
-            if( bOnlyUnused && poTarget->bRecentlyAccessed )
-            {
-                iContour++;
-                continue;
-            }
-
-            poLevel->RemoveContour( iContour );
-
-            // Try to find another contour we can merge with in this level.
-            
-            for( iC2 = 0; iC2 < poLevel->GetContourCount(); iC2++ )
-            {
-                GDALContourItem *poOther = poLevel->GetContour( iC2 );
-
-                if( poOther->Merge( poTarget ) )
-                    break;
-            }
-
-            // If we didn't merge it, then eject (write) it out. 
-            if( iC2 == poLevel->GetContourCount() )
-            {
-                if( pfnWriter != NULL )
-                {
-                    // If direction is wrong, then reverse before ejecting.
-                    poTarget->PrepareEjection();
+            iOpen++;
+            continue;
+        }
 
-                    eErr = pfnWriter( poTarget->dfLevel, poTarget->nPoints, 
-                                      poTarget->padfX, poTarget->padfY, 
-                                      pWriterCBData );
-                }
-            }
+        poTarget->poLevel->RemoveEnd( poTarget, FALSE );
+        poTarget->poLevel->RemoveEnd( poTarget, TRUE );
+        RemoveOpenContour( poTarget );
 
-            delete poTarget;
-        }
+        eErr = EjectContour( poTarget );
     }
 
     return eErr;
@@ -888,6 +1087,60 @@ GDALContourLevel *GDALContourGenerator::FindLevel( double dfLevel )
     return poLevel;
 }
 
+/************************************************************************/
+/*                          GetIntervalLevel()                          */
+/*                                                                      */
+/*      Get the level of the given index from the contour interval      */
+/*      and offset.  These levels are kept in an array indexed from     */
+/*      nLevelBase, grown at either end as needed, and created when     */
+/*      first used.                                                     */
+/************************************************************************/
+
+GDALContourLevel *GDALContourGenerator::GetIntervalLevel( int iLevel )
+
+{
+    if( nLevelCount == 0 )
+        nLevelBase = iLevel;
+
+    if( iLevel < nLevelBase )
+    {
+        int nShift = MAX(nLevelBase - iLevel, nLevelCount + 10);
+
+        nLevelMax = nLevelCount + nShift;
+        papoLevels = (GDALContourLevel **) 
+            CPLRealloc( papoLevels, sizeof(void*) * nLevelMax );
+        memmove( papoLevels + nShift, papoLevels, 
+                 nLevelCount * sizeof(void*) );
+        memset( papoLevels, 0, nShift * sizeof(void*) );
+
+        nLevelCount += nShift;
+        nLevelBase -= nShift;
+    }
+    else if( iLevel - nLevelBase >= nLevelCount )
+    {
+        int nNewCount = iLevel - nLevelBase + 1;
+
+        if( nNewCount > nLevelMax )
+        {
+            nLevelMax = MAX(nNewCount, nLevelMax * 2 + 10);
+            papoLevels = (GDALContourLevel **) 
+                CPLRealloc( papoLevels, sizeof(void*) * nLevelMax );
+        }
+
+        memset( papoLevels + nLevelCount, 0, 
+                (nNewCount - nLevelCount) * sizeof(void*) );
+        nLevelCount = nNewCount;
+    }
+
+    GDALContourLevel **ppoLevel = papoLevels + (iLevel - nLevelBase);
+
+    if( *ppoLevel == NULL )
+        *ppoLevel = new GDALContourLevel( iLevel * dfContourInterval 
+                                          + dfContourOffset );
+
+    return *ppoLevel;
+}
+
 /************************************************************************/
 /* ==================================================================== */
 /*                           GDALContourLevel                           */
@@ -902,9 +1155,6 @@ GDALContourLevel::GDALContourLevel( double dfLevelIn )
 
 {
     dfLevel = dfLevelIn;
-    nEntryMax = 0;
-    nEntryCount = 0;
-    papoEntries = NULL;
 }
 
 /************************************************************************/
@@ -914,153 +1164,125 @@ GDALContourLevel::GDALContourLevel( double dfLevelIn )
 GDALContourLevel::~GDALContourLevel()
 
 {
-    CPLAssert( nEntryCount == 0 );
-    CPLFree( papoEntries );
+    CPLAssert( oEnds.empty() );
 }
 
 /************************************************************************/
-/*                           AdjustContour()                            */
-/*                                                                      */
-/*      Assume the indicated contour's tail may have changed, and       */
-/*      adjust it up or down in the list of contours to re-establish    */
-/*      proper ordering.                                                */
+/*                              GetCell()                               */
 /************************************************************************/
 
-void GDALContourLevel::AdjustContour( int iChanged )
+static GDALContourCell GetCell( double dfX, double dfY )
 
 {
-    while( iChanged > 0 
-         && papoEntries[iChanged]->dfTailX < papoEntries[iChanged-1]->dfTailX )
-    {
-        GDALContourItem *poTemp = papoEntries[iChanged];
-        papoEntries[iChanged] = papoEntries[iChanged-1];
-        papoEntries[iChanged-1] = poTemp;
-        iChanged--;
-    }
-
-    while( iChanged < nEntryCount-1
-         && papoEntries[iChanged]->dfTailX > papoEntries[iChanged+1]->dfTailX )
-    {
-        GDALContourItem *poTemp = papoEntries[iChanged];
-        papoEntries[iChanged] = papoEntries[iChanged+1];
-        papoEntries[iChanged+1] = poTemp;
-        iChanged++;
-    }
+    return GDALContourCell( (GIntBig) floor( dfX / JOIN_CELL_SIZE ),
+                            (GIntBig) floor( dfY / JOIN_CELL_SIZE ) );
 }
 
 /************************************************************************/
-/*                           RemoveContour()                            */
+/*                             InsertEnd()                              */
+/*                                                                      */
+/*      Index the head or tail end of an open contour.                  */
 /************************************************************************/
 
-void GDALContourLevel::RemoveContour( int iTarget )
+void GDALContourLevel::InsertEnd( GDALContourItem *poItem, int bTail )
 
 {
-    if( iTarget < nEntryCount )
-        memmove( papoEntries + iTarget, papoEntries + iTarget + 1, 
-                 (nEntryCount - iTarget - 1) * sizeof(void*) );
-    nEntryCount--;
+    int iPoint = bTail ? poItem->nPoints - 1 : 0;
+
+    oEnds.insert( GDALContourEndMap::value_type(
+                      GetCell( poItem->padfX[iPoint], poItem->padfY[iPoint] ),
+                      GDALContourEnd( poItem, bTail ) ) );
 }
 
 /************************************************************************/
-/*                            FindContour()                             */
+/*                             RemoveEnd()                              */
 /*                                                                      */
-/*      Perform a binary search to find the requested "tail"            */
-/*      location.  If not available return -1.  In theory there can     */
-/*      be more than one contour with the same tail X and different     */
-/*      Y tails ... ensure we check against them all.                   */
+/*      Remove the index of an end of a contour, which must not have    */
+/*      moved since it was inserted.                                    */
 /************************************************************************/
 
-int GDALContourLevel::FindContour( double dfX, double dfY )
+void GDALContourLevel::RemoveEnd( GDALContourItem *poItem, int bTail )
 
 {
-    int nStart = 0, nEnd = nEntryCount-1, nMiddle;
+    int iPoint = bTail ? poItem->nPoints - 1 : 0;
+    std::pair<GDALContourEndMap::iterator,GDALContourEndMap::iterator> oRange =
+        oEnds.equal_range( GetCell( poItem->padfX[iPoint], 
+                                    poItem->padfY[iPoint] ) );
 
-    while( nEnd >= nStart )
+    for( ; oRange.first != oRange.second; ++oRange.first )
     {
-        nMiddle = (nEnd + nStart) / 2;
-
-        double dfMiddleX = papoEntries[nMiddle]->dfTailX;
-
-        if( dfMiddleX < dfX )
-            nStart = nMiddle + 1;
-        else if( dfMiddleX > dfX )
-            nEnd = nMiddle - 1;
-        else
+        if( oRange.first->second == GDALContourEnd( poItem, bTail ) )
         {
-            while( nMiddle > 0 
-                   && fabs(papoEntries[nMiddle]->dfTailX-dfX) < JOIN_DIST )
-                nMiddle--;
-
-            while( nMiddle < nEntryCount
-                   && fabs(papoEntries[nMiddle]->dfTailX-dfX) < JOIN_DIST )
-            {
-                if( fabs(papoEntries[nMiddle]->padfY[papoEntries[nMiddle]->nPoints-1] - dfY) < JOIN_DIST )
-                    return nMiddle;
-                nMiddle++;
-            }
-
-            return -1;
+            oEnds.erase( oRange.first );
+            return;
         }
     }
 
-    return -1;
+    CPLAssert( FALSE );
 }
 
 /************************************************************************/
-/*                           InsertContour()                            */
+/*                            FindContour()                             */
 /*                                                                      */
-/*      Ensure the newly added contour is placed in order according     */
-/*      to the X value relative to the other contours.                  */
+/*      Find an open contour with an end within JOIN_DIST of the        */
+/*      given location, returning NULL if there is none.  *pbTail is    */
+/*      set to TRUE if that is its tail end.  The neighbouring cells    */
+/*      are only searched when the location is near their edge.         */
 /************************************************************************/
 
-int GDALContourLevel::InsertContour( GDALContourItem *poNewContour )
+GDALContourItem *GDALContourLevel::FindContour( double dfX, double dfY,
+                                                int *pbTail )
 
 {
-/* -------------------------------------------------------------------- */
-/*      Find where to insert by binary search.                          */
-/* -------------------------------------------------------------------- */
-    int nStart = 0, nEnd = nEntryCount-1, nMiddle;
-
-    while( nEnd >= nStart )
+    if( oEnds.empty() )
+        return NULL;
+
+    GDALContourCell oCell = GetCell( dfX, dfY );
+    GIntBig anCellX[2], anCellY[2];
+    int     nCellsX = 1, nCellsY = 1;
+    double  dfOffsetX = dfX - oCell.first * JOIN_CELL_SIZE;
+    double  dfOffsetY = dfY - oCell.second * JOIN_CELL_SIZE;
+
+    anCellX[0] = oCell.first;
+    if( dfOffsetX < JOIN_DIST )
+        anCellX[nCellsX++] = oCell.first - 1;
+    else if( dfOffsetX > JOIN_CELL_SIZE - JOIN_DIST )
+        anCellX[nCellsX++] = oCell.first + 1;
+
+    anCellY[0] = oCell.second;
+    if( dfOffsetY < JOIN_DIST )
+        anCellY[nCellsY++] = oCell.second - 1;
+    else if( dfOffsetY > JOIN_CELL_SIZE - JOIN_DIST )
+        anCellY[nCellsY++] = oCell.second + 1;
+
+    for( int iCellY = 0; iCellY < nCellsY; iCellY++ )
     {
-        nMiddle = (nEnd + nStart) / 2;
+        for( int iCellX = 0; iCellX < nCellsX; iCellX++ )
+        {
+            std::pair<GDALContourEndMap::iterator,
+                      GDALContourEndMap::iterator> oRange =
+                oEnds.equal_range( GDALContourCell( anCellX[iCellX], 
+                                                    anCellY[iCellY] ) );
 
-        double dfMiddleX = papoEntries[nMiddle]->dfTailX;
+            for( ; oRange.first != oRange.second; ++oRange.first )
+            {
+                GDALContourItem *poItem = oRange.first->second.first;
+                int iPoint = oRange.first->second.second 
+                    ? poItem->nPoints - 1 : 0;
 
-        if( dfMiddleX < poNewContour->dfLevel )
-            nStart = nMiddle + 1;
-        else if( dfMiddleX > poNewContour->dfLevel )
-            nEnd = nMiddle - 1;
-        else
-        {
-            nEnd = nMiddle - 1;
-            break;
+                if( fabs(poItem->padfX[iPoint] - dfX) < JOIN_DIST
+                    && fabs(poItem->padfY[iPoint] - dfY) < JOIN_DIST )
+                {
+                    *pbTail = oRange.first->second.second;
+                    return poItem;
+                }
+            }
         }
     }
 
-/* -------------------------------------------------------------------- */
-/*      Do we need to grow the array?                                   */
-/* -------------------------------------------------------------------- */
-    if( nEntryMax == nEntryCount )
-    {
-        nEntryMax = nEntryMax * 2 + 10;
-        papoEntries = (GDALContourItem **) 
-            CPLRealloc( papoEntries, sizeof(void*) * nEntryMax );
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Insert the new contour at the appropriate location.             */
-/* -------------------------------------------------------------------- */
-    if( nEntryCount - nEnd - 1 > 0 )
-        memmove( papoEntries + nEnd + 2, papoEntries + nEnd + 1, 
-                 (nEntryCount - nEnd - 1) * sizeof(void*) );
-    papoEntries[nEnd+1] = poNewContour;
-    nEntryCount++;
-
-    return nEnd+1;
+    return NULL;
 }
 
-
 /************************************************************************/
 /* ==================================================================== */
 /*                           GDALContourItem                            */
@@ -1075,15 +1297,16 @@ GDALContourItem::GDALContourItem( double dfLevelIn )
 
 {
     dfLevel = dfLevelIn;
-    bRecentlyAccessed = FALSE;
+    poLevel = NULL;
+    iLastLine = -1;
+    iOpen = -1;
     nPoints = 0;
     nMaxPoints = 0;
+    nHeadRoom = 0;
     padfX = NULL;
     padfY = NULL;
     
     bLeftIsHigh = FALSE;
-
-    dfTailX = 0.0;
 }
 
 /************************************************************************/
@@ -1093,190 +1316,178 @@ GDALContourItem::GDALContourItem( double dfLevelIn )
 GDALContourItem::~GDALContourItem()
 
 {
-    CPLFree( padfX );
-    CPLFree( padfY );
+    if( padfX != NULL )
+    {
+        CPLFree( padfX - nHeadRoom );
+        CPLFree( padfY - nHeadRoom );
+    }
 }
 
 /************************************************************************/
 /*                             AddSegment()                             */
+/*                                                                      */
+/*      Add the first segment of a contour.                             */
 /************************************************************************/
 
-int GDALContourItem::AddSegment( double dfXStart, double dfYStart, 
-                                 double dfXEnd, double dfYEnd,
-                                 int bLeftHigh)
+void GDALContourItem::AddSegment( double dfXStart, double dfYStart, 
+                                  double dfXEnd, double dfYEnd,
+                                  int bLeftHigh)
 
 {
-    MakeRoomFor( nPoints + 1 );
+    CPLAssert( nPoints == 0 );
 
-/* -------------------------------------------------------------------- */
-/*      If there are no segments, just add now.                         */
-/* -------------------------------------------------------------------- */
-    if( nPoints == 0 )
-    {
-        nPoints = 2;
+    MakeRoomFor( 0, 2 );
 
-        padfX[0] = dfXStart;
-        padfY[0] = dfYStart;
-        padfX[1] = dfXEnd;
-        padfY[1] = dfYEnd;
-        bRecentlyAccessed = TRUE;
+    nPoints = 2;
 
-        dfTailX = padfX[1];
-
-        // Here we know that the left of this vector is the high side
-        bLeftIsHigh = bLeftHigh;
-
-        return TRUE;
-    }
+    padfX[0] = dfXStart;
+    padfY[0] = dfYStart;
+    padfX[1] = dfXEnd;
+    padfY[1] = dfYEnd;
 
-/* -------------------------------------------------------------------- */
-/*      Try to matching up with one of the ends, and insert.            */
-/* -------------------------------------------------------------------- */
-    if( fabs(padfX[nPoints-1]-dfXStart) < JOIN_DIST 
-             && fabs(padfY[nPoints-1]-dfYStart) < JOIN_DIST )
-    {
-        padfX[nPoints] = dfXEnd;
-        padfY[nPoints] = dfYEnd;
-        nPoints++;
+    // Here we know that the left of this vector is the high side
+    bLeftIsHigh = bLeftHigh;
+}
 
-        bRecentlyAccessed = TRUE;
+/************************************************************************/
+/*                              AddPoint()                              */
+/*                                                                      */
+/*      Extend the contour at its tail or head.                         */
+/************************************************************************/
 
-        dfTailX = dfXEnd;
+void GDALContourItem::AddPoint( double dfX, double dfY, int bAtTail )
 
-        return TRUE;
-    }
-    else if( fabs(padfX[nPoints-1]-dfXEnd) < JOIN_DIST 
-             && fabs(padfY[nPoints-1]-dfYEnd) < JOIN_DIST )
+{
+    if( bAtTail )
     {
-        padfX[nPoints] = dfXStart;
-        padfY[nPoints] = dfYStart;
-        nPoints++;
-
-        bRecentlyAccessed = TRUE;
-
-        dfTailX = dfXStart;
-
-        return TRUE;
+        MakeRoomFor( 0, 1 );
+        padfX[nPoints] = dfX;
+        padfY[nPoints] = dfY;
     }
     else
-        return FALSE;
+    {
+        MakeRoomFor( 1, 0 );
+        padfX--;
+        padfY--;
+        nHeadRoom--;
+        padfX[0] = dfX;
+        padfY[0] = dfY;
+    }
+
+    nPoints++;
 }
  
 /************************************************************************/
 /*                               Merge()                                */
+/*                                                                      */
+/*      Append another contour at the tail or head of this one, from    */
+/*      its tail or head end, which is at the same location.            */
 /************************************************************************/
 
-int GDALContourItem::Merge( GDALContourItem *poOther )
+void GDALContourItem::Merge( GDALContourItem *poOther, 
+                             int bAtTail, int bOtherTail )
 
 {
-    if( poOther->dfLevel != dfLevel )
-        return FALSE;
-
-/* -------------------------------------------------------------------- */
-/*      Try to matching up with one of the ends, and insert.            */
-/* -------------------------------------------------------------------- */
-    if( fabs(padfX[nPoints-1]-poOther->padfX[0]) < JOIN_DIST 
-        && fabs(padfY[nPoints-1]-poOther->padfY[0]) < JOIN_DIST )
-    {
-        MakeRoomFor( nPoints + poOther->nPoints - 1 );
-
-        memcpy( padfX + nPoints, poOther->padfX + 1, 
-                sizeof(double) * (poOther->nPoints-1) );
-        memcpy( padfY + nPoints, poOther->padfY + 1, 
-                sizeof(double) * (poOther->nPoints-1) );
-        nPoints += poOther->nPoints - 1;
-
-        bRecentlyAccessed = TRUE;
-
-        dfTailX = padfX[nPoints-1];
-
-        return TRUE;
-    }
-    else if( fabs(padfX[0]-poOther->padfX[poOther->nPoints-1]) < JOIN_DIST 
-             && fabs(padfY[0]-poOther->padfY[poOther->nPoints-1]) < JOIN_DIST )
-    {
-        MakeRoomFor( nPoints + poOther->nPoints - 1 );
-
-        memmove( padfX + poOther->nPoints - 1, padfX, 
-                sizeof(double) * nPoints );
-        memmove( padfY + poOther->nPoints - 1, padfY, 
-                sizeof(double) * nPoints );
-        memcpy( padfX, poOther->padfX, 
-                sizeof(double) * (poOther->nPoints-1) );
-        memcpy( padfY, poOther->padfY, 
-                sizeof(double) * (poOther->nPoints-1) );
-        nPoints += poOther->nPoints - 1;
+    int i, nNew = poOther->nPoints - 1;
 
-        bRecentlyAccessed = TRUE;
-
-        dfTailX = padfX[nPoints-1];
-
-        return TRUE;
-    }
-    else if( fabs(padfX[nPoints-1]-poOther->padfX[poOther->nPoints-1]) < JOIN_DIST 
-        && fabs(padfY[nPoints-1]-poOther->padfY[poOther->nPoints-1]) < JOIN_DIST )
+    if( bAtTail )
     {
-        int i;
-
-        MakeRoomFor( nPoints + poOther->nPoints - 1 );
+        MakeRoomFor( 0, nNew );
 
-        for( i = 0; i < poOther->nPoints-1; i++ )
+        if( bOtherTail )
         {
-            padfX[i+nPoints] = poOther->padfX[poOther->nPoints-i-2];
-            padfY[i+nPoints] = poOther->padfY[poOther->nPoints-i-2];
+            for( i = 0; i < nNew; i++ )
+            {
+                padfX[nPoints+i] = poOther->padfX[nNew-1-i];
+                padfY[nPoints+i] = poOther->padfY[nNew-1-i];
+            }
+        }
+        else
+        {
+            memcpy( padfX + nPoints, poOther->padfX + 1, 
+                    sizeof(double) * nNew );
+            memcpy( padfY + nPoints, poOther->padfY + 1, 
+                    sizeof(double) * nNew );
         }
-
-        nPoints += poOther->nPoints - 1;
-
-        bRecentlyAccessed = TRUE;
-
-        dfTailX = padfX[nPoints-1];
-
-        return TRUE;
     }
-    else if( fabs(padfX[0]-poOther->padfX[0]) < JOIN_DIST 
-        && fabs(padfY[0]-poOther->padfY[0]) < JOIN_DIST )
+    else
     {
-        int i;
-
-        MakeRoomFor( nPoints + poOther->nPoints - 1 );
+        MakeRoomFor( nNew, 0 );
 
-        memmove( padfX + poOther->nPoints - 1, padfX, 
-                sizeof(double) * nPoints );
-        memmove( padfY + poOther->nPoints - 1, padfY, 
-                sizeof(double) * nPoints );
+        padfX -= nNew;
+        padfY -= nNew;
+        nHeadRoom -= nNew;
 
-        for( i = 0; i < poOther->nPoints-1; i++ )
+        if( bOtherTail )
         {
-            padfX[i] = poOther->padfX[poOther->nPoints - i - 1];
-            padfY[i] = poOther->padfY[poOther->nPoints - i - 1];
+            memcpy( padfX, poOther->padfX, sizeof(double) * nNew );
+            memcpy( padfY, poOther->padfY, sizeof(double) * nNew );
         }
+        else
+        {
+            for( i = 0; i < nNew; i++ )
+            {
+                padfX[i] = poOther->padfX[nNew-i];
+                padfY[i] = poOther->padfY[nNew-i];
+            }
+        }
+    }
 
-        nPoints += poOther->nPoints - 1;
+    nPoints += nNew;
+}
 
-        bRecentlyAccessed = TRUE;
+/************************************************************************/
+/*                              IsClosed()                              */
+/************************************************************************/
 
-        dfTailX = padfX[nPoints-1];
+int GDALContourItem::IsClosed()
 
-        return TRUE;
-    }
-    else
-        return FALSE;
+{
+    return nPoints > 2 
+        && fabs(padfX[0] - padfX[nPoints-1]) < JOIN_DIST
+        && fabs(padfY[0] - padfY[nPoints-1]) < JOIN_DIST;
 }
 
 /************************************************************************/
 /*                            MakeRoomFor()                             */
+/*                                                                      */
+/*      Ensure there is room for the given number of points before      */
+/*      the head and after the tail.  The room is doubled on the        */
+/*      side that lacks it, so adding points is O(1) amortized at       */
+/*      both ends.                                                      */
 /************************************************************************/
 
-void GDALContourItem::MakeRoomFor( int nNewPoints )
+void GDALContourItem::MakeRoomFor( int nAtHead, int nAtTail )
 
 {
-    if( nNewPoints > nMaxPoints )
+    int nTailRoom = nMaxPoints - nHeadRoom - nPoints;
+
+    if( nHeadRoom >= nAtHead && nTailRoom >= nAtTail )
+        return;
+
+    int nNewHeadRoom = nHeadRoom, nNewTailRoom = nTailRoom;
+
+    if( nNewHeadRoom < nAtHead )
+        nNewHeadRoom = nAtHead + nPoints + 25;
+    if( nNewTailRoom < nAtTail )
+        nNewTailRoom = nAtTail + nPoints + 25;
+
+    int nNewMaxPoints = nNewHeadRoom + nPoints + nNewTailRoom;
+    double *padfNewX = (double *) CPLMalloc(sizeof(double) * nNewMaxPoints);
+    double *padfNewY = (double *) CPLMalloc(sizeof(double) * nNewMaxPoints);
+
+    if( padfX != NULL )
     {
-        nMaxPoints = nNewPoints * 2 + 50;
-        padfX = (double *) CPLRealloc(padfX,sizeof(double) * nMaxPoints);
-        padfY = (double *) CPLRealloc(padfY,sizeof(double) * nMaxPoints);
+        memcpy( padfNewX + nNewHeadRoom, padfX, sizeof(double) * nPoints );
+        memcpy( padfNewY + nNewHeadRoom, padfY, sizeof(double) * nPoints );
+        CPLFree( padfX - nHeadRoom );
+        CPLFree( padfY - nHeadRoom );
     }
+
+    padfX = padfNewX + nNewHeadRoom;
+    padfY = padfNewY + nNewHeadRoom;
+    nHeadRoom = nNewHeadRoom;
+    nMaxPoints = nNewMaxPoints;
 }
 
 /************************************************************************/
@@ -1359,6 +1570,204 @@ CPLErr OGRContourWriter( double dfLevel,
     return CE_None;
 }
 
+/************************************************************************/
+/*                        GDALContourCollector()                        */
+/*                                                                      */
+/*      Contour writer keeping the contours of a strip of the raster    */
+/*      in memory, so that they can be stitched with those of the       */
+/*      other strips.                                                   */
+/************************************************************************/
+
+static CPLErr GDALContourCollector( double dfLevel, 
+                                    int nPoints, double *padfX, double *padfY, 
+                                    void *pInfo )
+
+{
+    std::vector<GDALContourItem*> *papoPieces = 
+        (std::vector<GDALContourItem*> *) pInfo;
+    GDALContourItem *poPiece = new GDALContourItem( dfLevel );
+
+    poPiece->MakeRoomFor( 0, nPoints );
+    memcpy( poPiece->padfX, padfX, sizeof(double) * nPoints );
+    memcpy( poPiece->padfY, padfY, sizeof(double) * nPoints );
+    poPiece->nPoints = nPoints;
+
+    papoPieces->push_back( poPiece );
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                        GDALContourStripJob                           */
+/************************************************************************/
+
+typedef struct
+{
+    GDALContourGenerator *poCG;
+    double               *padfLines;
+    int                   nXSize;
+    int                   nLines;
+    std::vector<GDALContourItem*> apoPieces;
+    CPLErr                eErr;
+} GDALContourStripJob;
+
+static void GDALContourStripJobMain( void *pData )
+
+{
+    GDALContourStripJob *psJob = (GDALContourStripJob *) pData;
+    int iLine;
+
+    psJob->eErr = CE_None;
+
+    for( iLine = 0; iLine < psJob->nLines && psJob->eErr == CE_None; iLine++ )
+        psJob->eErr = psJob->poCG->FeedLine( psJob->padfLines 
+                                             + iLine * psJob->nXSize );
+}
+
+/************************************************************************/
+/*                     GDALContourGenerateStrips()                      */
+/*                                                                      */
+/*      Generate the contours of strips of the raster in parallel,      */
+/*      a group of nThreads strips at a time.  The contours reaching    */
+/*      the boundaries of the strips are then joined by the contour     */
+/*      generator poStitcher, which writes them out once they are no    */
+/*      longer extended by the next group of strips.                    */
+/************************************************************************/
+
+static CPLErr 
+GDALContourGenerateStrips( GDALRasterBandH hBand, 
+                           GDALContourGenerator *poStitcher,
+                           double dfContourInterval, double dfContourBase,
+                           int nFixedLevelCount, double *padfFixedLevels,
+                           int bUseNoData, double dfNoDataValue,
+                           int nStripLines, int nThreads,
+                           GDALProgressFunc pfnProgress, void *pProgressArg )
+
+{
+    int nXSize = GDALGetRasterBandXSize( hBand );
+    int nYSize = GDALGetRasterBandYSize( hBand );
+    int nGroupLines = nStripLines * nThreads;
+
+/* -------------------------------------------------------------------- */
+/*      Allocate the lines of a group of strips, and the one above.     */
+/* -------------------------------------------------------------------- */
+    double *padfLines = (double *) 
+        VSIMalloc3( sizeof(double), nXSize, nGroupLines + 1 );
+
+    if( padfLines == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "VSIMalloc3(): Out of memory in GDALContourGenerate" );
+        return CE_Failure;
+    }
+
+    GDALContourStripJob *pasJobs = new GDALContourStripJob[nThreads];
+    void **papJobs = (void **) CPLMalloc( sizeof(void*) * nThreads );
+    CPLErr eErr = CE_None;
+    int iGroupStart, iGroup = 0;
+
+    for( iGroupStart = 0; 
+         iGroupStart < nYSize && eErr == CE_None; 
+         iGroupStart += nGroupLines, iGroup++ )
+    {
+        int iGroupEnd = MIN(nYSize, iGroupStart + nGroupLines);
+        int iFirstLine = MAX(0, iGroupStart - 1);
+
+        eErr = GDALRasterIO( hBand, GF_Read, 0, iFirstLine, 
+                             nXSize, iGroupEnd - iFirstLine, padfLines, 
+                             nXSize, iGroupEnd - iFirstLine, GDT_Float64, 
+                             0, 0 );
+        if( eErr != CE_None )
+            break;
+
+/* -------------------------------------------------------------------- */
+/*      Setup a contour generator per strip, and run them.              */
+/* -------------------------------------------------------------------- */
+        int iStripStart, nJobs = 0;
+
+        for( iStripStart = iGroupStart; 
+             iStripStart < iGroupEnd; 
+             iStripStart += nStripLines )
+        {
+            GDALContourStripJob *psJob = pasJobs + nJobs;
+            int iStripEnd = MIN(iGroupEnd, iStripStart + nStripLines);
+            int iLine = MAX(0, iStripStart - 1);
+
+            psJob->poCG = new GDALContourGenerator( nXSize, nYSize, 
+                                                    GDALContourCollector,
+                                                    &(psJob->apoPieces) );
+
+            if( nFixedLevelCount > 0 )
+                psJob->poCG->SetFixedLevels( nFixedLevelCount, 
+                                             padfFixedLevels );
+            else
+                psJob->poCG->SetContourLevels( dfContourInterval, 
+                                               dfContourBase );
+
+            if( bUseNoData )
+                psJob->poCG->SetNoData( dfNoDataValue );
+
+            psJob->poCG->SetStripLines( iStripStart, iStripEnd );
+
+            psJob->padfLines = padfLines 
+                + (size_t) (iLine - iFirstLine) * nXSize;
+            psJob->nXSize = nXSize;
+            psJob->nLines = iStripEnd - iLine;
+
+            papJobs[nJobs++] = psJob;
+        }
+
+        CPLRunJobs( nJobs, papJobs, GDALContourStripJobMain, nThreads );
+
+/* -------------------------------------------------------------------- */
+/*      Stitch the contours of the strips, in order.                    */
+/* -------------------------------------------------------------------- */
+        int iJob;
+        size_t iPiece;
+
+        poStitcher->SetLine( iGroup );
+
+        for( iJob = 0; iJob < nJobs; iJob++ )
+        {
+            GDALContourStripJob *psJob = pasJobs + iJob;
+
+            delete psJob->poCG;
+
+            if( eErr == CE_None )
+                eErr = psJob->eErr;
+
+            for( iPiece = 0; iPiece < psJob->apoPieces.size(); iPiece++ )
+            {
+                if( eErr == CE_None )
+                    eErr = poStitcher->AddContour( psJob->apoPieces[iPiece] );
+                else
+                    delete psJob->apoPieces[iPiece];
+            }
+
+            psJob->apoPieces.clear();
+        }
+
+        if( eErr == CE_None )
+            eErr = poStitcher->EjectContours( TRUE );
+
+        if( eErr == CE_None 
+            && !pfnProgress( iGroupEnd / (double) nYSize, "", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+    if( eErr == CE_None )
+        eErr = poStitcher->EjectContours( FALSE );
+
+    CPLFree( papJobs );
+    delete[] pasJobs;
+    CPLFree( padfLines );
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                        GDALContourGenerate()                         */
 /************************************************************************/
@@ -1374,6 +1783,10 @@ CPLErr OGRContourWriter( double dfLevel,
  * The gdal/apps/gdal_contour.cpp mainline can be used as an example of
  * how to use this function.
  *
+ * If the GDAL_NUM_THREADS configuration option is set to more than one
+ * thread (or ALL_CPUS), strips of the raster are processed in parallel,
+ * and the contours crossing their boundaries are joined afterwards.
+ *
  * ALGORITHM RULES
 
 For contouring purposes raster pixel values are assumed to represent a point 
@@ -1548,6 +1961,21 @@ CPLErr GDALContourGenerate( GDALRasterBandH hBand,
     if( bUseNoData )
         oCG.SetNoData( dfNoDataValue );
 
+/* -------------------------------------------------------------------- */
+/*      With several threads, process strips of about a million         */
+/*      pixels in parallel, the generator joining their contours.       */
+/* -------------------------------------------------------------------- */
+    int nThreads = CPLGetNumThreads( NULL );
+    int nStripLines = MAX(64, 1024 * 1024 / MAX(1,nXSize));
+
+    if( nThreads > 1 && nYSize > nStripLines )
+        return GDALContourGenerateStrips( hBand, &oCG, 
+                                          dfContourInterval, dfContourBase,
+                                          nFixedLevelCount, padfFixedLevels,
+                                          bUseNoData, dfNoDataValue,
+                                          nStripLines, nThreads,
+                                          pfnProgress, pProgressArg );
+
 /* -------------------------------------------------------------------- */
 /*      Feed the data into the contour generator.                       */
 /* -------------------------------------------------------------------- */
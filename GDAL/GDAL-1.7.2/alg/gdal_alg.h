@@ -438,6 +438,64 @@ GDALGridCreate( GDALGridAlgorithm, const void *, GUInt32,
                 double, double, double, double,
                 GUInt32, GUInt32, GDALDataType, void *,
                 GDALProgressFunc, void *);
+
+/************************************************************************/
+/*  Terrain analysis interface.                                         */
+/************************************************************************/
+
+/** Terrain analysis products */
+typedef enum {
+  /*! Shaded relief, from 1 to 255 */   GTP_Hillshade = 1,
+  /*! Slope */                          GTP_Slope = 2,
+  /*! Aspect, in degrees */             GTP_Aspect = 3,
+  /*! Terrain Ruggedness Index */       GTP_TRI = 4,
+  /*! Topographic Position Index */     GTP_TPI = 5,
+  /*! Roughness */                      GTP_Roughness = 6
+} GDALTerrainProduct;
+
+/** Terrain analysis control options */
+typedef struct
+{
+    /*! West-east pixel size, as in the geotransform. */
+    double  dfEWRes;
+    /*! North-south pixel size, as in the geotransform. */
+    double  dfNSRes;
+    /*! Ratio of vertical units to horizontal units. */
+    double  dfScale;
+    /*! Vertical exaggeration used for the hillshade. */
+    double  dfZFactor;
+    /*! Azimuth of the light of the hillshade, in degrees. */
+    double  dfAzimuth;
+    /*! Altitude of the light of the hillshade, in degrees. */
+    double  dfAltitude;
+    /*! Whether the slope is in percent rather than in degrees. */
+    int     bSlopeInPercent;
+    /*! Whether the aspect is a trigonometric angle rather than an
+     *  azimuth. */
+    int     bAspectTrigonometric;
+} GDALTerrainOptions;
+
+CPLErr CPL_DLL
+GDALTerrainProcessLines( const GDALTerrainOptions *psOptions,
+                         int nProducts, const GDALTerrainProduct *paeProducts,
+                         int nXSize, int nLines,
+                         const float * const *papafSrcLines,
+                         int bSrcHasNoData, float fSrcNoDataValue,
+                         const float *pafDstNoDataValues, float **papafDst );
+
+CPLErr CPL_DLL
+GDALTerrainProcessing( GDALRasterBandH hSrcBand,
+                       const GDALTerrainOptions *psOptions,
+                       int nProducts, const GDALTerrainProduct *paeProducts,
+                       GDALRasterBandH *pahDstBands, char **papszOptions,
+                       GDALProgressFunc pfnProgress, void *pProgressArg );
+
+CPLErr CPL_DLL
+GDALGridCreateToBand( GDALGridAlgorithm, const void *, GUInt32,
+                      const double *, const double *, const double *,
+                      double, double, double, double,
+                      GDALRasterBandH, char **,
+                      GDALProgressFunc, void *);
 CPL_C_END
                             
 #endif /* ndef GDAL_ALG_H_INCLUDED */
@@ -33,6 +33,10 @@
 
 #include "gdal_alg.h"
 
+#ifdef __cplusplus
+#  include <vector>
+#endif
+
 CPL_C_START
 
 /** Source of the burn value */
@@ -117,4 +121,50 @@ public:
     void     Clear();
 };
 
+/************************************************************************/
+/*                      Streaming Polygon Labeller                      */
+/*                                                                      */
+/*      Union-find labelling of the polygons line by line.  After       */
+/*      ProcessLine() the ids of the line are those of the polygons,    */
+/*      and anMerges lists the polygons merged while processing it.     */
+/*      A polygon absent from the line is closed, and its id may be     */
+/*      released for reuse, so the ids only cover the open polygons.    */
+/************************************************************************/
+
+class GDALRasterPolygonLabeller
+
+{
+private:
+    std::vector<int>    anParent;
+    std::vector<int>    anRank;
+    std::vector<GInt32> anValue;
+    std::vector<int>    anLastLine;
+    std::vector<int>    anFreeIds;
+    std::vector<int>    anMergedIds;
+
+    int      nConnectedness;
+
+    int      NewPolygon( GInt32 nValue, int iLine );
+    void     Union( int nId1, int nId2 );
+
+public:
+    // (merged id, surviving id) pairs of the last ProcessLine().
+    std::vector<int>    anMerges;
+
+             GDALRasterPolygonLabeller( int nConnectedness=4 );
+
+    int      Find( int nId );
+
+    void     ProcessLine( GInt32 *panLastLineVal, GInt32 *panThisLineVal,
+                          GInt32 *panLastLineId,  GInt32 *panThisLineId, 
+                          int nXSize, int iLine );
+
+    int      IsClosed( int nId, int iLine ) 
+                 { return anLastLine[nId] < iLine; }
+    GInt32   GetValue( int nId ) { return anValue[nId]; }
+    int      GetIdCount() { return (int) anParent.size(); }
+
+    void     Release( int nId );
+};
+
 #endif /* ndef GDAL_ALG_PRIV_H_INCLUDED */
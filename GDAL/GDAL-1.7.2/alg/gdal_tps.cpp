@@ -31,6 +31,7 @@
 #include "gdal_alg.h"
 #include "cpl_conv.h"
 #include "cpl_string.h"
+#include "cpl_multiproc.h"
 
 CPL_CVSID("$Id: gdal_tps.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -53,6 +54,42 @@ typedef struct
     
 } TPSTransformInfo;
 
+typedef struct
+{
+    VizGeorefSpline2D *poSpline;
+
+    int       nResult;
+    CPLErr    eErrClass;
+    int       nErrNo;
+    char     *pszErrMsg;
+} TPSSolveJob;
+
+/************************************************************************/
+/*                          GDALTPSSolveJob()                           */
+/*                                                                      */
+/*      The job may run in a worker thread, whose errors the caller     */
+/*      would never see, so the error of a failed solve is kept to      */
+/*      be posted again from the calling thread.                        */
+/************************************************************************/
+
+static void GDALTPSSolveJob( void *pData )
+
+{
+    TPSSolveJob *psJob = (TPSSolveJob *) pData;
+
+    CPLErrorReset();
+    CPLPushErrorHandler( CPLQuietErrorHandler );
+    psJob->nResult = psJob->poSpline->solve();
+    CPLPopErrorHandler();
+
+    if( psJob->nResult == 0 )
+    {
+        psJob->eErrClass = CPLGetLastErrorType();
+        psJob->nErrNo = CPLGetLastErrorNo();
+        psJob->pszErrMsg = CPLStrdup( CPLGetLastErrorMsg() );
+    }
+}
+
 /************************************************************************/
 /*                      GDALCreateTPSTransformer()                      */
 /************************************************************************/
@@ -69,8 +106,20 @@ typedef struct
  * Creating the TPS transformer involves solving systems of linear equations
  * related to the number of control points involved.  This solution is
  * computed within this function call.  It can be quite an expensive operation
- * for large numbers of GCPs.  For instance, for reference, it takes on the 
- * order of 10s for 400 GCPs on a 2GHz Athlon processor. 
+ * for large numbers of GCPs, its cost growing with the cube of the number
+ * of GCPs: for reference, it takes on the order of 30s for 5000 GCPs.  The
+ * forward and reverse transformations are solved in parallel if the
+ * GDAL_NUM_THREADS configuration option allows several threads.
+ *
+ * With 1000 GCPs or more, the transformation of a point only evaluates the
+ * contribution of the nearby GCPs, the one of the farther GCPs being
+ * interpolated from precomputed values.  The approximation is checked
+ * against the exact transformation when the transformer is created, and
+ * only used if its error is below 1e-8 times the range of the coordinates
+ * the GCPs are transformed to.  Setting the GDAL_TPS_FARFIELD configuration
+ * option to NO always evaluates the exact transformation, and setting
+ * GDAL_TPS_SOLVER to LU solves the systems by a plain LU factorization,
+ * which is slower but may serve as a reference.
  *
  * TPS Transformers are serializable. 
  *
@@ -135,8 +184,29 @@ void *GDALCreateTPSTransformer( int nGCPCount, const GDAL_GCP *pasGCPList,
         }
     }
 
-    psInfo->poForward->solve();
-    psInfo->poReverse->solve();
+/* -------------------------------------------------------------------- */
+/*      Solve the forward and reverse transformations, and report       */
+/*      their failures from this thread.                                */
+/* -------------------------------------------------------------------- */
+    TPSSolveJob asJobs[2];
+    void       *apJobs[2];
+    int         iJob;
+
+    memset( asJobs, 0, sizeof(asJobs) );
+    asJobs[0].poSpline = psInfo->poForward;
+    asJobs[1].poSpline = psInfo->poReverse;
+    apJobs[0] = asJobs + 0;
+    apJobs[1] = asJobs + 1;
+
+    CPLRunJobs( 2, apJobs, GDALTPSSolveJob, CPLGetNumThreads( NULL ) );
+
+    for( iJob = 0; iJob < 2; iJob++ )
+    {
+        if( asJobs[iJob].nResult == 0 && asJobs[iJob].eErrClass != CE_None )
+            CPLError( asJobs[iJob].eErrClass, asJobs[iJob].nErrNo,
+                      "%s", asJobs[iJob].pszErrMsg );
+        CPLFree( asJobs[iJob].pszErrMsg );
+    }
 
     return psInfo;
 }
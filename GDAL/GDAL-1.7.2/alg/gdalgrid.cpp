@@ -28,7 +28,11 @@
  ****************************************************************************/
 
 #include "cpl_vsi.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_multiproc.h"
 #include "gdalgrid.h"
+#include <algorithm>
 
 CPL_CVSID("$Id: gdalgrid.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -405,6 +409,7 @@ GDALGridNearestNeighbor( const void *poOptions, GUInt32 nPoints,
     // Nearest distance will be initialized with a largest ellipse semi-axis.
     // All nearest points should be located in this range.
     double      dfNearestR = MAX(dfRadius1, dfRadius2);
+    int         bFound = FALSE;
     GUInt32 i = 0;
 
     while ( i < nPoints )
@@ -424,11 +429,15 @@ GDALGridNearestNeighbor( const void *poOptions, GUInt32 nPoints,
         // Is this point located inside the search ellipse?
         if ( dfRadius2 * dfRX * dfRX + dfRadius1 * dfRY * dfRY <= dfR12 )
         {
+            // When no search ellipse is set, the first point is taken
+            // whatever its distance.  Once found, a point coinciding with
+            // the node is kept.
             const double    dfR2 = dfRX * dfRX + dfRY * dfRY;
-            if ( dfNearestR == 0.0 || dfR2 < dfNearestR )
+            if ( (dfNearestR == 0.0 && !bFound) || dfR2 < dfNearestR )
             {
                 dfNearestR = dfR2;
                 dfNearestValue = padfZ[i];
+                bFound = TRUE;
             }
         }
 
@@ -1057,7 +1066,7 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
     GUInt32     i = 0, n = 0;
 
     // Search for the first point within the search ellipse
-    while ( i < nPoints - 1 )
+    while ( i + 1 < nPoints )
     {
         double  dfRX1 = padfX[i] - dfXPoint;
         double  dfRY1 = padfY[i] - dfYPoint;
@@ -1119,63 +1128,477 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
 }
 
 /************************************************************************/
-/*                            GDALGridCreate()                          */
+/*                          GDALGridPointIndex                          */
+/*                                                                      */
+/*      Regular grid of square cells over the extent of the input       */
+/*      points, used to only visit the points near a grid node.  The    */
+/*      points of cell i are panCellPoints[panCellStart[i]] up to       */
+/*      panCellPoints[panCellStart[i+1]-1], in ascending order.         */
+/*      Points with a non finite coordinate are left out, as they are   */
+/*      never located in a search ellipse.                              */
 /************************************************************************/
 
-/**
- * Create regular grid from the scattered data.
- *
- * This fucntion takes the arrays of X and Y coordinates and corresponding Z
- * values as input and computes regular grid (or call it a raster) from these
- * scattered data. You should supply geometry and extent of the output grid
- * and allocate array sufficient to hold such a grid.
- *
- * @param eAlgorithm Gridding method. 
- * @param poOptions Options to control choosen gridding method.
- * @param nPoints Number of elements in input arrays.
- * @param padfX Input array of X coordinates. 
- * @param padfY Input array of Y coordinates. 
- * @param padfZ Input array of Z values. 
- * @param dfXMin Lowest X border of output grid.
- * @param dfXMax Highest X border of output grid.
- * @param dfYMin Lowest Y border of output grid.
- * @param dfYMax Highest Y border of output grid.
- * @param nXSize Number of columns in output grid.
- * @param nYSize Number of rows in output grid.
- * @param eType Data type of output array.  
- * @param pData Pointer to array where the computed grid will be stored.
- * @param pfnProgress a GDALProgressFunc() compatible callback function for
- * reporting progress or NULL.
- * @param pProgressArg argument to be passed to pfnProgress.  May be NULL.
- *
- * @return CE_None on success or CE_Failure if something goes wrong.
- */
+class GDALGridPointIndex
+{
+    double      dfXOrigin;
+    double      dfYOrigin;
+    double      dfCellSize;
+    int         nXCells;
+    int         nYCells;
+    GUInt32    *panCellStart;
+    GUInt32    *panCellPoints;
+
+    int         GetCell( double dfValue, double dfOrigin, int nCells ) const;
+
+  public:
+                GDALGridPointIndex();
+               ~GDALGridPointIndex();
+
+    int         Build( GUInt32 nPoints, const double *padfX,
+                       const double *padfY, double dfMinCellSize );
+
+    double      GetCellSize() const { return dfCellSize; }
+    int         GetXCells() const { return nXCells; }
+    int         GetYCells() const { return nYCells; }
+    int         GetCellX( double dfX ) const
+                    { return GetCell( dfX, dfXOrigin, nXCells ); }
+    int         GetCellY( double dfY ) const
+                    { return GetCell( dfY, dfYOrigin, nYCells ); }
+
+    void        CollectCells( int nXFirst, int nYFirst,
+                              int nXLast, int nYLast,
+                              GUInt32 **ppanPoints, GUInt32 *pnCount,
+                              GUInt32 *pnMaxCount ) const;
+};
+
+/************************************************************************/
+/*                         GDALGridPointIndex()                         */
+/************************************************************************/
+
+GDALGridPointIndex::GDALGridPointIndex()
 
-CPLErr
-GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
-                GUInt32 nPoints,
-                const double *padfX, const double *padfY, const double *padfZ,
-                double dfXMin, double dfXMax, double dfYMin, double dfYMax,
-                GUInt32 nXSize, GUInt32 nYSize, GDALDataType eType, void *pData,
-                GDALProgressFunc pfnProgress, void *pProgressArg )
 {
-    CPLAssert( poOptions );
-    CPLAssert( padfX );
-    CPLAssert( padfY );
-    CPLAssert( padfZ );
-    CPLAssert( pData );
+    dfXOrigin = 0.0;
+    dfYOrigin = 0.0;
+    dfCellSize = 1.0;
+    nXCells = 0;
+    nYCells = 0;
+    panCellStart = NULL;
+    panCellPoints = NULL;
+}
 
-    if ( pfnProgress == NULL )
-        pfnProgress = GDALDummyProgress;
+/************************************************************************/
+/*                        ~GDALGridPointIndex()                         */
+/************************************************************************/
 
-    if ( nXSize == 0 || nYSize == 0 )
+GDALGridPointIndex::~GDALGridPointIndex()
+
+{
+    CPLFree( panCellStart );
+    CPLFree( panCellPoints );
+}
+
+/************************************************************************/
+/*                              GetCell()                               */
+/*                                                                      */
+/*      Cell column or row of a coordinate, clamped to the grid.  The   */
+/*      result never decreases when the coordinate increases, so the    */
+/*      cells of a coordinate range always hold all its points.         */
+/************************************************************************/
+
+int GDALGridPointIndex::GetCell( double dfValue, double dfOrigin,
+                                 int nCells ) const
+
+{
+    const double dfCell = floor( (dfValue - dfOrigin) / dfCellSize );
+
+    if( !(dfCell > 0.0) )
+        return 0;
+    if( dfCell >= nCells - 1 )
+        return nCells - 1;
+
+    return (int) dfCell;
+}
+
+/************************************************************************/
+/*                               Build()                                */
+/*                                                                      */
+/*      The cells are at least dfMinCellSize wide, and large enough     */
+/*      to hold two points on average if the points were evenly         */
+/*      spread, so that sparse points do not leave most cells empty.    */
+/************************************************************************/
+
+int GDALGridPointIndex::Build( GUInt32 nPoints, const double *padfX,
+                               const double *padfY, double dfMinCellSize )
+
+{
+    GUInt32     i, nValid = 0;
+    double      dfXMax = 0.0, dfYMax = 0.0;
+
+    for( i = 0; i < nPoints; i++ )
     {
-        CPLError( CE_Failure, CPLE_IllegalArg,
-                  "Output raster dimesions should have non-zero size." );
-        return CE_Failure;
+        if( !CPLIsFinite(padfX[i]) || !CPLIsFinite(padfY[i]) )
+            continue;
+
+        if( nValid == 0 )
+        {
+            dfXOrigin = dfXMax = padfX[i];
+            dfYOrigin = dfYMax = padfY[i];
+        }
+        else
+        {
+            dfXOrigin = MIN(dfXOrigin, padfX[i]);
+            dfXMax = MAX(dfXMax, padfX[i]);
+            dfYOrigin = MIN(dfYOrigin, padfY[i]);
+            dfYMax = MAX(dfYMax, padfY[i]);
+        }
+        nValid++;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Choose the cell size.                                           */
+/* -------------------------------------------------------------------- */
+    const double dfWidth = dfXMax - dfXOrigin;
+    const double dfHeight = dfYMax - dfYOrigin;
+    const double dfMaxCells = MAX(nValid / 2, 1);
+
+    if( dfWidth > 0.0 && dfHeight > 0.0 )
+        dfCellSize = sqrt( dfWidth * dfHeight / dfMaxCells );
+    else
+        dfCellSize = MAX(dfWidth, dfHeight) / dfMaxCells;
+
+    if( dfMinCellSize > dfCellSize )
+        dfCellSize = dfMinCellSize;
+    if( !(dfCellSize > 0.0) )
+        dfCellSize = 1.0;
+
+    while( (floor( dfWidth / dfCellSize ) + 1.0)
+           * (floor( dfHeight / dfCellSize ) + 1.0) > dfMaxCells )
+        dfCellSize *= 2.0;
+
+    nXCells = (int) floor( dfWidth / dfCellSize ) + 1;
+    nYCells = (int) floor( dfHeight / dfCellSize ) + 1;
+
+/* -------------------------------------------------------------------- */
+/*      Count the points of each cell, and sort the point indices by    */
+/*      cell.  panCellStart[i] is advanced to the end of cell i while   */
+/*      filling it, and shifted back afterwards.                        */
+/* -------------------------------------------------------------------- */
+    const int   nCells = nXCells * nYCells;
+
+    panCellStart = (GUInt32 *) VSICalloc( nCells + 1, sizeof(GUInt32) );
+    panCellPoints = (GUInt32 *) VSIMalloc( MAX(nValid, 1) * sizeof(GUInt32) );
+    if( panCellStart == NULL || panCellPoints == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate the index of %lu points.",
+                  (long unsigned int) nPoints );
+        return FALSE;
     }
 
+    for( i = 0; i < nPoints; i++ )
+    {
+        if( CPLIsFinite(padfX[i]) && CPLIsFinite(padfY[i]) )
+            panCellStart[GetCellY( padfY[i] ) * nXCells
+                         + GetCellX( padfX[i] ) + 1]++;
+    }
+
+    for( int iCell = 0; iCell < nCells; iCell++ )
+        panCellStart[iCell + 1] += panCellStart[iCell];
+
+    for( i = 0; i < nPoints; i++ )
+    {
+        if( CPLIsFinite(padfX[i]) && CPLIsFinite(padfY[i]) )
+            panCellPoints[panCellStart[GetCellY( padfY[i] ) * nXCells
+                                       + GetCellX( padfX[i] )]++] = i;
+    }
+
+    memmove( panCellStart + 1, panCellStart, nCells * sizeof(GUInt32) );
+    panCellStart[0] = 0;
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                            CollectCells()                            */
+/*                                                                      */
+/*      Append the points of a rectangle of cells to a growable         */
+/*      array.                                                          */
+/************************************************************************/
+
+void GDALGridPointIndex::CollectCells( int nXFirst, int nYFirst,
+                                       int nXLast, int nYLast,
+                                       GUInt32 **ppanPoints, GUInt32 *pnCount,
+                                       GUInt32 *pnMaxCount ) const
+
+{
+    for( int iY = nYFirst; iY <= nYLast; iY++ )
+    {
+        const GUInt32 nFirst = panCellStart[iY * nXCells + nXFirst];
+        const GUInt32 nLast = panCellStart[iY * nXCells + nXLast + 1];
+
+        if( nLast == nFirst )
+            continue;
+
+        if( *pnCount + (nLast - nFirst) > *pnMaxCount )
+        {
+            *pnMaxCount = MAX(*pnMaxCount * 2, *pnCount + (nLast - nFirst));
+            *ppanPoints = (GUInt32 *)
+                CPLRealloc( *ppanPoints, *pnMaxCount * sizeof(GUInt32) );
+        }
+
+        memcpy( *ppanPoints + *pnCount, panCellPoints + nFirst,
+                (nLast - nFirst) * sizeof(GUInt32) );
+        *pnCount += nLast - nFirst;
+    }
+}
+
+/************************************************************************/
+/*                           GDALGridContext                            */
+/*                                                                      */
+/*      What is needed to compute a grid node: the gridding method      */
+/*      and its search ellipse, the input points and their index if     */
+/*      any, and scratch arrays for the points near the node.           */
+/************************************************************************/
+
+typedef struct
+{
     GDALGridFunction    pfnGDALGridMethod;
+    const void         *poOptions;
+    GUInt32             nPoints;
+    const double       *padfX;
+    const double       *padfY;
+    const double       *padfZ;
+
+    GDALGridPointIndex *poIndex;
+    int                 bNearest;
+    int                 bBounded;
+    double              dfRadius1;
+    double              dfRadius2;
+    double              dfCoeff1;
+    double              dfCoeff2;
+    double              dfHalfWidth;
+    double              dfHalfHeight;
+
+    GUInt32            *panNearPoints;
+    GUInt32             nMaxNearPoints;
+    double             *padfNearValues;
+    GUInt32             nMaxNearValues;
+} GDALGridContext;
+
+/************************************************************************/
+/*                        GDALGridCollectRing()                         */
+/*                                                                      */
+/*      Append the points of the cells nRing cells away from cell       */
+/*      (nXCell,nYCell) within the given cell range.  Returns FALSE     */
+/*      if the ring lies entirely outside the range.                    */
+/************************************************************************/
+
+static int GDALGridCollectRing( GDALGridContext *psContext,
+                                int nXCell, int nYCell, int nRing,
+                                int nXFirst, int nYFirst,
+                                int nXLast, int nYLast, GUInt32 *pnCount )
+
+{
+    const GDALGridPointIndex *poIndex = psContext->poIndex;
+    const int nXMin = MAX(nXCell - nRing, nXFirst);
+    const int nXMax = MIN(nXCell + nRing, nXLast);
+    const int nYMin = MAX(nYCell - nRing + 1, nYFirst);
+    const int nYMax = MIN(nYCell + nRing - 1, nYLast);
+
+    if( nXCell - nRing < nXFirst && nXCell + nRing > nXLast
+        && nYCell - nRing < nYFirst && nYCell + nRing > nYLast )
+        return FALSE;
+
+    if( nYCell - nRing >= nYFirst )
+        poIndex->CollectCells( nXMin, nYCell - nRing, nXMax, nYCell - nRing,
+                               &psContext->panNearPoints, pnCount,
+                               &psContext->nMaxNearPoints );
+    if( nRing > 0 && nYCell + nRing <= nYLast )
+        poIndex->CollectCells( nXMin, nYCell + nRing, nXMax, nYCell + nRing,
+                               &psContext->panNearPoints, pnCount,
+                               &psContext->nMaxNearPoints );
+    if( nRing > 0 && nXCell - nRing >= nXFirst && nYMin <= nYMax )
+        poIndex->CollectCells( nXCell - nRing, nYMin, nXCell - nRing, nYMax,
+                               &psContext->panNearPoints, pnCount,
+                               &psContext->nMaxNearPoints );
+    if( nRing > 0 && nXCell + nRing <= nXLast && nYMin <= nYMax )
+        poIndex->CollectCells( nXCell + nRing, nYMin, nXCell + nRing, nYMax,
+                               &psContext->panNearPoints, pnCount,
+                               &psContext->nMaxNearPoints );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                        GDALGridComputeNode()                         */
+/*                                                                      */
+/*      Compute one grid node.  Without index the gridding method is    */
+/*      run on all the points.  Otherwise the points of the cells       */
+/*      covering the bounding box of the search ellipse are collected,  */
+/*      or, for the nearest neighbor, the cells around the node ring    */
+/*      by ring until no closer point may be found.  The method is      */
+/*      then run on these points only, taken in their input order so    */
+/*      that the result is the same as with all the points.             */
+/************************************************************************/
+
+static CPLErr GDALGridComputeNode( GDALGridContext *psContext,
+                                   double dfXPoint, double dfYPoint,
+                                   double *pdfValue )
+
+{
+    const GDALGridPointIndex *poIndex = psContext->poIndex;
+
+    if( poIndex == NULL )
+        return (*psContext->pfnGDALGridMethod)( psContext->poOptions,
+                                                psContext->nPoints,
+                                                psContext->padfX,
+                                                psContext->padfY,
+                                                psContext->padfZ,
+                                                dfXPoint, dfYPoint,
+                                                pdfValue );
+
+/* -------------------------------------------------------------------- */
+/*      Cells covering the search ellipse.  The box is slightly         */
+/*      enlarged to account for the rounding of the ellipse test.       */
+/* -------------------------------------------------------------------- */
+    int         nXFirst = 0, nYFirst = 0;
+    int         nXLast = poIndex->GetXCells() - 1;
+    int         nYLast = poIndex->GetYCells() - 1;
+    GUInt32     nCount = 0;
+
+    if( psContext->bBounded )
+    {
+        const double dfXMargin = psContext->dfHalfWidth * (1.0 + 1e-9)
+            + fabs(dfXPoint) * 1e-12;
+        const double dfYMargin = psContext->dfHalfHeight * (1.0 + 1e-9)
+            + fabs(dfYPoint) * 1e-12;
+
+        nXFirst = poIndex->GetCellX( dfXPoint - dfXMargin );
+        nXLast = poIndex->GetCellX( dfXPoint + dfXMargin );
+        nYFirst = poIndex->GetCellY( dfYPoint - dfYMargin );
+        nYLast = poIndex->GetCellY( dfYPoint + dfYMargin );
+    }
+
+    if( !psContext->bNearest )
+    {
+        poIndex->CollectCells( nXFirst, nYFirst, nXLast, nYLast,
+                               &psContext->panNearPoints, &nCount,
+                               &psContext->nMaxNearPoints );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Nearest neighbor: visit the rings of cells around the node      */
+/*      until the nearest point found so far is closer than any         */
+/*      point of the next rings.                                        */
+/* -------------------------------------------------------------------- */
+    else
+    {
+        const int    nXCell = poIndex->GetCellX( dfXPoint );
+        const int    nYCell = poIndex->GetCellY( dfYPoint );
+        const double dfR12 = psContext->dfRadius1 * psContext->dfRadius2;
+        const double dfEpsilon =
+            (fabs(dfXPoint) + fabs(dfYPoint) + poIndex->GetCellSize()) * 1e-9;
+        double       dfNearestR = 0.0;
+        int          bFound = FALSE;
+
+        for( int nRing = 0; ; nRing++ )
+        {
+            const GUInt32 nFirst = nCount;
+
+            if( !GDALGridCollectRing( psContext, nXCell, nYCell, nRing,
+                                      nXFirst, nYFirst, nXLast, nYLast,
+                                      &nCount ) )
+                break;
+
+            for( GUInt32 j = nFirst; j < nCount; j++ )
+            {
+                const GUInt32 i = psContext->panNearPoints[j];
+                double  dfRX = psContext->padfX[i] - dfXPoint;
+                double  dfRY = psContext->padfY[i] - dfYPoint;
+
+                if( psContext->dfCoeff1 != 1.0 || psContext->dfCoeff2 != 0.0 )
+                {
+                    const double dfRXRotated = dfRX * psContext->dfCoeff1
+                                             + dfRY * psContext->dfCoeff2;
+                    const double dfRYRotated = dfRY * psContext->dfCoeff1
+                                             - dfRX * psContext->dfCoeff2;
+
+                    dfRX = dfRXRotated;
+                    dfRY = dfRYRotated;
+                }
+
+                if( psContext->bBounded
+                    && psContext->dfRadius2 * dfRX * dfRX
+                       + psContext->dfRadius1 * dfRY * dfRY > dfR12 )
+                    continue;
+
+                const double dfR2 = dfRX * dfRX + dfRY * dfRY;
+                if( !bFound || dfR2 < dfNearestR )
+                {
+                    dfNearestR = dfR2;
+                    bFound = TRUE;
+                }
+            }
+
+            // The points of the next rings are at least nRing cells away.
+            if( bFound && sqrt( dfNearestR )
+                < nRing * poIndex->GetCellSize() - dfEpsilon )
+                break;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Gather the coordinates and values of the collected points in    */
+/*      input order, and run the gridding method on them.               */
+/* -------------------------------------------------------------------- */
+    GUInt32    *panNearPoints = psContext->panNearPoints;
+
+    std::sort( panNearPoints, panNearPoints + nCount );
+
+    if( nCount > psContext->nMaxNearValues || psContext->padfNearValues == NULL )
+    {
+        psContext->nMaxNearValues = MAX(nCount, psContext->nMaxNearValues * 2);
+        psContext->nMaxNearValues = MAX(psContext->nMaxNearValues, 16);
+        psContext->padfNearValues = (double *)
+            CPLRealloc( psContext->padfNearValues,
+                        3 * sizeof(double) * psContext->nMaxNearValues );
+    }
+
+    double     *padfNearX = psContext->padfNearValues;
+    double     *padfNearY = padfNearX + psContext->nMaxNearValues;
+    double     *padfNearZ = padfNearY + psContext->nMaxNearValues;
+
+    for( GUInt32 j = 0; j < nCount; j++ )
+    {
+        padfNearX[j] = psContext->padfX[panNearPoints[j]];
+        padfNearY[j] = psContext->padfY[panNearPoints[j]];
+        padfNearZ[j] = psContext->padfZ[panNearPoints[j]];
+    }
+
+    return (*psContext->pfnGDALGridMethod)( psContext->poOptions, nCount,
+                                            padfNearX, padfNearY, padfNearZ,
+                                            dfXPoint, dfYPoint, pdfValue );
+}
+
+/************************************************************************/
+/*                        GDALGridContextInit()                         */
+/*                                                                      */
+/*      Select the gridding method and index the points, unless every   */
+/*      point is in the search ellipse anyway.  The nearest neighbor    */
+/*      always uses the index.                                          */
+/************************************************************************/
+
+static CPLErr GDALGridContextInit( GDALGridContext *psContext,
+                                   GDALGridAlgorithm eAlgorithm,
+                                   const void *poOptions, GUInt32 nPoints,
+                                   const double *padfX, const double *padfY,
+                                   const double *padfZ )
+
+{
+    GDALGridFunction    pfnGDALGridMethod;
+
+    memset( psContext, 0, sizeof(GDALGridContext) );
 
     switch ( eAlgorithm )
     {
@@ -1227,54 +1650,431 @@ GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
 	    return CE_Failure;
     }
 
-    GUInt32 nXPoint, nYPoint;
-    const double    dfDeltaX = ( dfXMax - dfXMin ) / nXSize;
-    const double    dfDeltaY = ( dfYMax - dfYMin ) / nYSize;
+    psContext->pfnGDALGridMethod = pfnGDALGridMethod;
+    psContext->poOptions = poOptions;
+    psContext->nPoints = nPoints;
+    psContext->padfX = padfX;
+    psContext->padfY = padfY;
+    psContext->padfZ = padfZ;
+    psContext->bNearest = ( eAlgorithm == GGA_NearestNeighbor );
+
+    if ( pfnGDALGridMethod == GDALGridInverseDistanceToAPowerNoSearch )
+        return CE_None;
+
+    double  dfAngle;
+
+    // The search ellipse fields of all the option structures but the
+    // inverse distance one come first, in the same order.
+    if ( eAlgorithm == GGA_InverseDistanceToAPower )
+    {
+        const GDALGridInverseDistanceToAPowerOptions *psOptions =
+            (const GDALGridInverseDistanceToAPowerOptions *)poOptions;
+        psContext->dfRadius1 = psOptions->dfRadius1;
+        psContext->dfRadius2 = psOptions->dfRadius2;
+        dfAngle = psOptions->dfAngle;
+    }
+    else
+    {
+        const GDALGridMovingAverageOptions *psOptions =
+            (const GDALGridMovingAverageOptions *)poOptions;
+        psContext->dfRadius1 = psOptions->dfRadius1;
+        psContext->dfRadius2 = psOptions->dfRadius2;
+        dfAngle = psOptions->dfAngle;
+    }
+
+    dfAngle *= TO_RADIANS;
+    psContext->dfCoeff1 = ( dfAngle == 0.0 ) ? 1.0 : cos(dfAngle);
+    psContext->dfCoeff2 = ( dfAngle == 0.0 ) ? 0.0 : sin(dfAngle);
+
+    // Half sizes of the bounding box of the rotated ellipse.
+    const double dfR1 = psContext->dfRadius1, dfR2 = psContext->dfRadius2;
+    const double dfC = psContext->dfCoeff1, dfS = psContext->dfCoeff2;
+    psContext->dfHalfWidth = sqrt( dfR1 * dfR1 * dfC * dfC
+                                   + dfR2 * dfR2 * dfS * dfS );
+    psContext->dfHalfHeight = sqrt( dfR1 * dfR1 * dfS * dfS
+                                    + dfR2 * dfR2 * dfC * dfC );
+
+    psContext->dfRadius1 *= psContext->dfRadius1;
+    psContext->dfRadius2 *= psContext->dfRadius2;
+    psContext->bBounded = ( psContext->dfRadius1 != 0.0
+                            || psContext->dfRadius2 != 0.0 );
+
+    if ( psContext->bBounded || psContext->bNearest )
+    {
+        psContext->poIndex = new GDALGridPointIndex();
+        if ( !psContext->poIndex->Build(
+                 nPoints, padfX, padfY,
+                 psContext->bNearest ? 0.0 :
+                 MAX(psContext->dfHalfWidth, psContext->dfHalfHeight) ) )
+        {
+            delete psContext->poIndex;
+            psContext->poIndex = NULL;
+            return CE_Failure;
+        }
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                          GDALGridJobMain()                           */
+/*                                                                      */
+/*      Compute every nLineStep-th line of a chunk of output lines,     */
+/*      from iFirstLine.  Each job has its own copy of the context,     */
+/*      sharing the index but with its own scratch arrays.              */
+/************************************************************************/
+
+typedef struct
+{
+    GDALGridContext sContext;
+
+    double      dfXMin;
+    double      dfYMin;
+    double      dfDeltaX;
+    double      dfDeltaY;
+    GUInt32     nXSize;
+
+    GUInt32     nYOff;
+    GUInt32     nLines;
+    GUInt32     iFirstLine;
+    GUInt32     nLineStep;
+    double     *padfValues;
+
+    CPLErr      eErr;
+    GUInt32     nFailedX;
+    GUInt32     nFailedY;
+} GDALGridJob;
+
+static void GDALGridJobMain( void *pData )
+
+{
+    GDALGridJob *psJob = (GDALGridJob *) pData;
+    GUInt32     iLine, nXPoint;
+
+    psJob->eErr = CE_None;
+
+    for ( iLine = psJob->iFirstLine; iLine < psJob->nLines;
+          iLine += psJob->nLineStep )
+    {
+        const GUInt32   nYPoint = psJob->nYOff + iLine;
+        const double    dfYPoint =
+            psJob->dfYMin + ( nYPoint + 0.5 ) * psJob->dfDeltaY;
+        double         *padfLine =
+            psJob->padfValues + (size_t)iLine * psJob->nXSize;
+
+        for ( nXPoint = 0; nXPoint < psJob->nXSize; nXPoint++ )
+        {
+            const double    dfXPoint =
+                psJob->dfXMin + ( nXPoint + 0.5 ) * psJob->dfDeltaX;
+
+            if ( GDALGridComputeNode( &psJob->sContext, dfXPoint, dfYPoint,
+                                      padfLine + nXPoint ) != CE_None )
+            {
+                psJob->eErr = CE_Failure;
+                psJob->nFailedX = nXPoint;
+                psJob->nFailedY = nYPoint;
+                return;
+            }
+        }
+    }
+}
+
+/************************************************************************/
+/*                        GDALGridComputeLines()                        */
+/*                                                                      */
+/*      Compute the grid by chunks of lines, the lines of a chunk       */
+/*      being shared between nThreads jobs, and store each finished     */
+/*      chunk either in the pData array, or in the hBand band.          */
+/************************************************************************/
+
+static CPLErr GDALGridComputeLines( GDALGridContext *psContext,
+                                    double dfXMin, double dfXMax,
+                                    double dfYMin, double dfYMax,
+                                    GUInt32 nXSize, GUInt32 nYSize,
+                                    GDALDataType eType, void *pData,
+                                    GDALRasterBandH hBand, int nThreads,
+                                    GDALProgressFunc pfnProgress,
+                                    void *pProgressArg )
+
+{
+/* -------------------------------------------------------------------- */
+/*      Chunks hold about a million values, and whole blocks of the     */
+/*      output band if any.                                             */
+/* -------------------------------------------------------------------- */
+    GUInt32     nChunkYSize = MAX(1, 1048576 / nXSize);
+
+    if ( hBand != NULL )
+    {
+        int     nBlockXSize, nBlockYSize;
+
+        GDALGetBlockSize( hBand, &nBlockXSize, &nBlockYSize );
+        nBlockYSize = MAX(nBlockYSize, 1);
+        nChunkYSize = MAX(nChunkYSize / nBlockYSize, 1) * nBlockYSize;
+    }
+    nChunkYSize = MIN(nChunkYSize, nYSize);
+
+    double      *padfValues = (double *)
+        VSIMalloc( sizeof(double) * nXSize * (size_t)nChunkYSize );
+
+    if ( padfValues == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate a buffer of %lu lines of %lu values.",
+                  (long unsigned int)nChunkYSize, (long unsigned int)nXSize );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Prepare the jobs.                                               */
+/* -------------------------------------------------------------------- */
+    const int   nJobs = (int) MIN((GUInt32) MAX(nThreads, 1), nChunkYSize);
+    GDALGridJob *pasJobs =
+        (GDALGridJob *) CPLCalloc( sizeof(GDALGridJob), nJobs );
+    void       **papJobs = (void **) CPLCalloc( sizeof(void *), nJobs );
+    int          iJob;
+
+    for ( iJob = 0; iJob < nJobs; iJob++ )
+    {
+        pasJobs[iJob].sContext = *psContext;
+        pasJobs[iJob].sContext.panNearPoints = NULL;
+        pasJobs[iJob].sContext.nMaxNearPoints = 0;
+        pasJobs[iJob].sContext.padfNearValues = NULL;
+        pasJobs[iJob].sContext.nMaxNearValues = 0;
+        pasJobs[iJob].dfXMin = dfXMin;
+        pasJobs[iJob].dfYMin = dfYMin;
+        pasJobs[iJob].dfDeltaX = ( dfXMax - dfXMin ) / nXSize;
+        pasJobs[iJob].dfDeltaY = ( dfYMax - dfYMin ) / nYSize;
+        pasJobs[iJob].nXSize = nXSize;
+        pasJobs[iJob].iFirstLine = iJob;
+        pasJobs[iJob].nLineStep = nJobs;
+        pasJobs[iJob].padfValues = padfValues;
+        papJobs[iJob] = pasJobs + iJob;
+    }
 
 /* -------------------------------------------------------------------- */
-/*  Allocate a buffer of scanline size, fill it with gridded values     */
-/*  and use GDALCopyWords() to copy values into output data array with  */
-/*  appropriate data type conversion.                                   */
+/*      Compute and store each chunk in turn.                           */
 /* -------------------------------------------------------------------- */
-    double      *padfValues = (double *)VSIMalloc( sizeof(double) * nXSize );
     GByte       *pabyData = (GByte *)pData;
-    int         nDataTypeSize = GDALGetDataTypeSize(eType) / 8;
-    int         nLineSpace = nXSize * nDataTypeSize;
-    
-    for ( nYPoint = 0; nYPoint < nYSize; nYPoint++ )
+    const int   nDataTypeSize = GDALGetDataTypeSize(eType) / 8;
+    CPLErr      eErr = CE_None;
+    GUInt32     nYOff;
+
+    for ( nYOff = 0; nYOff < nYSize && eErr == CE_None; nYOff += nChunkYSize )
     {
-        const double    dfYPoint = dfYMin + ( nYPoint + 0.5 ) * dfDeltaY;
+        const GUInt32 nLines = MIN(nChunkYSize, nYSize - nYOff);
 
-        for ( nXPoint = 0; nXPoint < nXSize; nXPoint++ )
+        for ( iJob = 0; iJob < nJobs; iJob++ )
         {
-            const double    dfXPoint = dfXMin + ( nXPoint + 0.5 ) * dfDeltaX;
+            pasJobs[iJob].nYOff = nYOff;
+            pasJobs[iJob].nLines = nLines;
+        }
+
+        CPLRunJobs( nJobs, papJobs, GDALGridJobMain, nThreads );
 
-            if ( (*pfnGDALGridMethod)( poOptions, nPoints, padfX, padfY, padfZ,
-                                       dfXPoint, dfYPoint,
-                                       padfValues + nXPoint ) != CE_None )
+        for ( iJob = 0; iJob < nJobs && eErr == CE_None; iJob++ )
+        {
+            if ( pasJobs[iJob].eErr != CE_None )
             {
                 CPLError( CE_Failure, CPLE_AppDefined,
                           "Gridding failed at X position %lu, Y position %lu",
-                          (long unsigned int)nXPoint,
-                          (long unsigned int)nYPoint );
-                return CE_Failure;
+                          (long unsigned int)pasJobs[iJob].nFailedX,
+                          (long unsigned int)pasJobs[iJob].nFailedY );
+                eErr = CE_Failure;
             }
         }
+        if ( eErr != CE_None )
+            break;
 
-        GDALCopyWords( padfValues, GDT_Float64, sizeof(double),
-                       pabyData, eType, nDataTypeSize,
-                       nXSize );
-        pabyData += nLineSpace;
+        if ( hBand != NULL )
+        {
+            eErr = GDALRasterIO( hBand, GF_Write, 0, nYOff, nXSize, nLines,
+                                 padfValues, nXSize, nLines, GDT_Float64,
+                                 0, 0 );
+        }
+        else
+        {
+            GDALCopyWords( padfValues, GDT_Float64, sizeof(double),
+                           pabyData + (size_t)nYOff * nXSize * nDataTypeSize,
+                           eType, nDataTypeSize, nXSize * nLines );
+        }
 
-        if( !pfnProgress( (double)(nYPoint + 1) / nYSize, NULL, pProgressArg ) )
+        if( eErr == CE_None
+            && !pfnProgress( (double)(nYOff + nLines) / nYSize, NULL,
+                             pProgressArg ) )
         {
             CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-            return CE_Failure;
+            eErr = CE_Failure;
         }
     }
 
+    for ( iJob = 0; iJob < nJobs; iJob++ )
+    {
+        CPLFree( pasJobs[iJob].sContext.panNearPoints );
+        CPLFree( pasJobs[iJob].sContext.padfNearValues );
+    }
+    CPLFree( pasJobs );
+    CPLFree( papJobs );
     VSIFree( padfValues );
 
-    return CE_None;
+    return eErr;
 }
 
+/************************************************************************/
+/*                            GDALGridCreate()                          */
+/************************************************************************/
+
+/**
+ * Create regular grid from the scattered data.
+ *
+ * This fucntion takes the arrays of X and Y coordinates and corresponding Z
+ * values as input and computes regular grid (or call it a raster) from these
+ * scattered data. You should supply geometry and extent of the output grid
+ * and allocate array sufficient to hold such a grid.
+ *
+ * When a search ellipse is set, and always for the nearest neighbor method,
+ * the input points are first indexed in a regular grid of cells, so that
+ * only the points near each grid node are visited.  The index is built
+ * on each call, so the whole output grid should preferably be computed
+ * by a single call, or written to a band by GDALGridCreateToBand().
+ *
+ * The lines of the grid are computed by as many threads as set by the
+ * GDAL_NUM_THREADS configuration option (a number, or ALL_CPUS), one by
+ * default.
+ *
+ * @param eAlgorithm Gridding method. 
+ * @param poOptions Options to control choosen gridding method.
+ * @param nPoints Number of elements in input arrays.
+ * @param padfX Input array of X coordinates. 
+ * @param padfY Input array of Y coordinates. 
+ * @param padfZ Input array of Z values. 
+ * @param dfXMin Lowest X border of output grid.
+ * @param dfXMax Highest X border of output grid.
+ * @param dfYMin Lowest Y border of output grid.
+ * @param dfYMax Highest Y border of output grid.
+ * @param nXSize Number of columns in output grid.
+ * @param nYSize Number of rows in output grid.
+ * @param eType Data type of output array.  
+ * @param pData Pointer to array where the computed grid will be stored.
+ * @param pfnProgress a GDALProgressFunc() compatible callback function for
+ * reporting progress or NULL.
+ * @param pProgressArg argument to be passed to pfnProgress.  May be NULL.
+ *
+ * @return CE_None on success or CE_Failure if something goes wrong.
+ */
+
+CPLErr
+GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
+                GUInt32 nPoints,
+                const double *padfX, const double *padfY, const double *padfZ,
+                double dfXMin, double dfXMax, double dfYMin, double dfYMax,
+                GUInt32 nXSize, GUInt32 nYSize, GDALDataType eType, void *pData,
+                GDALProgressFunc pfnProgress, void *pProgressArg )
+{
+    CPLAssert( poOptions );
+    CPLAssert( padfX );
+    CPLAssert( padfY );
+    CPLAssert( padfZ );
+    CPLAssert( pData );
+
+    if ( pfnProgress == NULL )
+        pfnProgress = GDALDummyProgress;
+
+    if ( nXSize == 0 || nYSize == 0 )
+    {
+        CPLError( CE_Failure, CPLE_IllegalArg,
+                  "Output raster dimesions should have non-zero size." );
+        return CE_Failure;
+    }
+
+    GDALGridContext sContext;
+
+    if ( GDALGridContextInit( &sContext, eAlgorithm, poOptions, nPoints,
+                              padfX, padfY, padfZ ) != CE_None )
+        return CE_Failure;
+
+    CPLErr  eErr =
+        GDALGridComputeLines( &sContext, dfXMin, dfXMax, dfYMin, dfYMax,
+                              nXSize, nYSize, eType, pData, NULL,
+                              CPLGetNumThreads( NULL ),
+                              pfnProgress, pProgressArg );
+
+    delete sContext.poIndex;
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                        GDALGridCreateToBand()                        */
+/************************************************************************/
+
+/**
+ * Create regular grid from the scattered data into a raster band.
+ *
+ * Same as GDALGridCreate(), but the grid is the whole given band, and is
+ * written to it by chunks of lines as they are computed, instead of being
+ * returned in an array.  The first line of the band is the one of the
+ * dfYMin border.
+ *
+ * The following options are supported:
+ * <dl>
+ * <dt>"NUM_THREADS":</dt> <dd>The number of threads, or ALL_CPUS, computing
+ * the lines of each chunk.  Defaults to the GDAL_NUM_THREADS configuration
+ * option, or 1.</dd>
+ * </dl>
+ *
+ * @param eAlgorithm Gridding method. 
+ * @param poOptions Options to control choosen gridding method.
+ * @param nPoints Number of elements in input arrays.
+ * @param padfX Input array of X coordinates. 
+ * @param padfY Input array of Y coordinates. 
+ * @param padfZ Input array of Z values. 
+ * @param dfXMin Lowest X border of output grid.
+ * @param dfXMax Highest X border of output grid.
+ * @param dfYMin Lowest Y border of output grid.
+ * @param dfYMax Highest Y border of output grid.
+ * @param hBand Band where the computed grid will be written.
+ * @param papszOptions a list of NAME=VALUE options, or NULL.
+ * @param pfnProgress a GDALProgressFunc() compatible callback function for
+ * reporting progress or NULL.
+ * @param pProgressArg argument to be passed to pfnProgress.  May be NULL.
+ *
+ * @return CE_None on success or CE_Failure if something goes wrong.
+ */
+
+CPLErr
+GDALGridCreateToBand( GDALGridAlgorithm eAlgorithm, const void *poOptions,
+                      GUInt32 nPoints, const double *padfX,
+                      const double *padfY, const double *padfZ,
+                      double dfXMin, double dfXMax,
+                      double dfYMin, double dfYMax,
+                      GDALRasterBandH hBand, char **papszOptions,
+                      GDALProgressFunc pfnProgress, void *pProgressArg )
+{
+    CPLAssert( poOptions );
+    CPLAssert( padfX );
+    CPLAssert( padfY );
+    CPLAssert( padfZ );
+    VALIDATE_POINTER1( hBand, "GDALGridCreateToBand", CE_Failure );
+
+    if ( pfnProgress == NULL )
+        pfnProgress = GDALDummyProgress;
+
+    GDALGridContext sContext;
+
+    if ( GDALGridContextInit( &sContext, eAlgorithm, poOptions, nPoints,
+                              padfX, padfY, padfZ ) != CE_None )
+        return CE_Failure;
+
+    const int nThreads =
+        CPLGetNumThreads( CSLFetchNameValue( papszOptions, "NUM_THREADS" ) );
+    CPLErr  eErr =
+        GDALGridComputeLines( &sContext, dfXMin, dfXMax, dfYMin, dfYMax,
+                              GDALGetRasterBandXSize( hBand ),
+                              GDALGetRasterBandYSize( hBand ),
+                              GDT_Float64, NULL, hBand, nThreads,
+                              pfnProgress, pProgressArg );
+
+    delete sContext.poIndex;
+
+    return eErr;
+}
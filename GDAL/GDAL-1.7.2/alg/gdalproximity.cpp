@@ -28,8 +28,10 @@
  ****************************************************************************/
 
 #include "gdal_alg.h"
+#include "ogr_srs_api.h"
 #include "cpl_conv.h"
 #include "cpl_string.h"
+#include "cpl_multiproc.h"
 
 CPL_CVSID("$Id: gdalproximity.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -39,6 +41,20 @@ ProcessProximityLine( GInt32 *panSrcScanline, int *panNearX, int *panNearY,
                       float *pafProximity,
                       int nTargetValues, int *panTargetValues );
 
+static CPLErr
+GetExactProximityResolutions( GDALRasterBandH hSrcBand, const char *pszUnits,
+                              double *padfXRes, double *padfYRes );
+
+static CPLErr
+ComputeExactProximity( GDALRasterBandH hSrcBand,
+                       GDALRasterBandH hProximityBand,
+                       const double *padfXRes, const double *padfYRes,
+                       double dfMaxDist, float fNoDataValue,
+                       int bFixedBufVal, double dfFixedBufVal,
+                       int nTargetValues, int *panTargetValues,
+                       int nThreads,
+                       GDALProgressFunc pfnProgress, void *pProgressArg );
+
 /************************************************************************/
 /*                        GDALComputeProximity()                        */
 /************************************************************************/
@@ -66,11 +82,35 @@ option is not provided proximity will be computed from non-zero
 pixel values.  Currently pixel values are internally processed as
 integers.
 
-  DISTUNITS=[PIXEL]/GEO
+  DISTUNITS=[PIXEL]/GEO/GREAT_CIRCLE
 
 Indicates whether distances will be computed in pixel units or
 in georeferenced units.  The default is pixel units.  This also 
-determines the interpretation of MAXDIST.
+determines the interpretation of MAXDIST.  GREAT_CIRCLE, only
+available with ALGORITHM=EXACT, computes distances in meters over
+a source in a geographic coordinate system: around each output pixel,
+pixels are sized with the radii of curvature of the ellipsoid at its
+latitude, which is accurate for distances small compared to the Earth
+radius.
+
+  ALGORITHM=[APPROXIMATE]/EXACT
+
+APPROXIMATE propagates the nearest target of each pixel to its
+neighbours, in two passes over the image, which may miss the nearest
+target of some pixels.  EXACT computes a separable Euclidean distance
+transform (Meijster/Felzenszwalb): a pass down and up each column
+finds the nearest target of every pixel in its column, and the lower
+envelope of the parabolas of these targets gives the exact distance
+along each line, in time linear with the number of pixels whatever
+the MAXDIST.  With GEO units, EXACT uses the pixel width and height
+so pixels needn't be square.  Defaults to APPROXIMATE, or EXACT with
+GREAT_CIRCLE units.
+
+  NUM_THREADS=n
+
+The number of threads, or ALL_CPUS, computing the lines with
+ALGORITHM=EXACT.  Defaults to the GDAL_NUM_THREADS configuration
+option, or 1.
 
   MAXDIST=n
 
@@ -110,12 +150,32 @@ GDALComputeProximity( GDALRasterBandH hSrcBand,
     if( pfnProgress == NULL )
         pfnProgress = GDALDummyProgress;
 
+/* -------------------------------------------------------------------- */
+/*      Which algorithm?                                                */
+/* -------------------------------------------------------------------- */
+    const char *pszDistUnits = CSLFetchNameValue( papszOptions, "DISTUNITS" );
+    int bExact = pszDistUnits != NULL && EQUAL(pszDistUnits,"GREAT_CIRCLE");
+
+    pszOpt = CSLFetchNameValue( papszOptions, "ALGORITHM" );
+    if( pszOpt )
+    {
+        if( EQUAL(pszOpt,"EXACT") )
+            bExact = TRUE;
+        else if( !EQUAL(pszOpt,"APPROXIMATE") || bExact )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Unsupported ALGORITHM value '%s'%s.", pszOpt,
+                      bExact ? " with GREAT_CIRCLE units" : "" );
+            return CE_Failure;
+        }
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Are we using pixels or georeferenced coordinates for distances? */
 /* -------------------------------------------------------------------- */
     double dfDistMult = 1.0;
-    pszOpt = CSLFetchNameValue( papszOptions, "DISTUNITS" );
-    if( pszOpt )
+    pszOpt = pszDistUnits;
+    if( pszOpt && !bExact )
     {
         if( EQUAL(pszOpt,"GEO") )
         {
@@ -139,6 +199,14 @@ GDALComputeProximity( GDALRasterBandH hSrcBand,
             return CE_Failure;
         }
     }
+    else if( pszOpt && !EQUAL(pszOpt,"PIXEL") && !EQUAL(pszOpt,"GEO")
+             && !EQUAL(pszOpt,"GREAT_CIRCLE") )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Unrecognised DISTUNITS value '%s', should be GEO, PIXEL "
+                  "or GREAT_CIRCLE.", pszOpt );
+        return CE_Failure;
+    }
 
 /* -------------------------------------------------------------------- */
 /*      What is our maxdist value?                                      */
@@ -221,6 +289,47 @@ GDALComputeProximity( GDALRasterBandH hSrcBand,
         return CE_Failure;
     }
 
+/* -------------------------------------------------------------------- */
+/*      The exact distance transform works in distance units, with a    */
+/*      pixel size per line.                                            */
+/* -------------------------------------------------------------------- */
+    if( bExact )
+    {
+        double *padfXRes = (double *) VSIMalloc2( sizeof(double), nYSize );
+        double *padfYRes = (double *) VSIMalloc2( sizeof(double), nYSize );
+        CPLErr  eExactErr;
+
+        if( padfXRes == NULL || padfYRes == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Out of memory allocating working buffers.");
+            eExactErr = CE_Failure;
+        }
+        else
+            eExactErr = GetExactProximityResolutions( hSrcBand, pszDistUnits,
+                                                      padfXRes, padfYRes );
+
+        if( eExactErr == CE_None )
+        {
+            pszOpt = CSLFetchNameValue( papszOptions, "MAXDIST" );
+            eExactErr =
+                ComputeExactProximity(
+                    hSrcBand, hProximityBand, padfXRes, padfYRes,
+                    pszOpt ? atof(pszOpt) : -1.0, fNoDataValue,
+                    bFixedBufVal, dfFixedBufVal,
+                    nTargetValues, panTargetValues,
+                    CPLGetNumThreads(
+                        CSLFetchNameValue( papszOptions, "NUM_THREADS" ) ),
+                    pfnProgress, pProgressArg );
+        }
+
+        CPLFree( padfXRes );
+        CPLFree( padfYRes );
+        CPLFree( panTargetValues );
+
+        return eExactErr;
+    }
+
 /* -------------------------------------------------------------------- */
 /*      We need a signed type for the working proximity values kept     */
 /*      on disk.  If our proximity band is not signed, then create a    */
@@ -536,3 +645,497 @@ ProcessProximityLine( GInt32 *panSrcScanline, int *panNearX, int *panNearY,
 
     return CE_None;
 }
+
+/************************************************************************/
+/*                    GetExactProximityResolutions()                    */
+/*                                                                      */
+/*      Size of the pixels of each line, in distance units, for the     */
+/*      exact distance transform.                                       */
+/************************************************************************/
+
+static CPLErr
+GetExactProximityResolutions( GDALRasterBandH hSrcBand, const char *pszUnits,
+                              double *padfXRes, double *padfYRes )
+
+{
+    const int nYSize = GDALGetRasterBandYSize( hSrcBand );
+    int       iLine;
+
+    for( iLine = 0; iLine < nYSize; iLine++ )
+        padfXRes[iLine] = padfYRes[iLine] = 1.0;
+
+    if( pszUnits == NULL || EQUAL(pszUnits,"PIXEL") )
+        return CE_None;
+
+    GDALDatasetH hSrcDS = GDALGetBandDataset( hSrcBand );
+    double       adfGeoTransform[6];
+
+    if( hSrcDS == NULL
+        || GDALGetGeoTransform( hSrcDS, adfGeoTransform ) != CE_None )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "DISTUNITS=%s needs a georeferenced source.", pszUnits );
+        return CE_Failure;
+    }
+
+    if( adfGeoTransform[2] != 0.0 || adfGeoTransform[4] != 0.0 )
+        CPLError( CE_Warning, CPLE_AppDefined,
+                  "Rotated geotransform, distances will be inaccurate." );
+
+/* -------------------------------------------------------------------- */
+/*      Georeferenced units: the pixel width and height.                */
+/* -------------------------------------------------------------------- */
+    if( EQUAL(pszUnits,"GEO") )
+    {
+        for( iLine = 0; iLine < nYSize; iLine++ )
+        {
+            padfXRes[iLine] = ABS(adfGeoTransform[1]);
+            padfYRes[iLine] = ABS(adfGeoTransform[5]);
+        }
+        return CE_None;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Meters: the pixel size at the latitude of the line, with the    */
+/*      meridian and prime vertical radii of curvature.                 */
+/* -------------------------------------------------------------------- */
+    OGRSpatialReferenceH hSRS =
+        OSRNewSpatialReference( GDALGetProjectionRef( hSrcDS ) );
+
+    if( hSRS == NULL || !OSRIsGeographic( hSRS ) )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "DISTUNITS=GREAT_CIRCLE needs a source in a geographic "
+                  "coordinate system." );
+        if( hSRS != NULL )
+            OSRDestroySpatialReference( hSRS );
+        return CE_Failure;
+    }
+
+    const double dfToRadians = OSRGetAngularUnits( hSRS, NULL );
+    const double dfSemiMajor = OSRGetSemiMajor( hSRS, NULL );
+    const double dfInvFlattening = OSRGetInvFlattening( hSRS, NULL );
+    const double dfFlattening =
+        dfInvFlattening != 0.0 ? 1.0 / dfInvFlattening : 0.0;
+    const double dfEcc2 = dfFlattening * (2.0 - dfFlattening);
+
+    OSRDestroySpatialReference( hSRS );
+
+    for( iLine = 0; iLine < nYSize; iLine++ )
+    {
+        const double dfLat = dfToRadians
+            * (adfGeoTransform[3] + (iLine + 0.5) * adfGeoTransform[5]);
+        const double dfSinLat = sin(dfLat);
+        const double dfW = sqrt(1.0 - dfEcc2 * dfSinLat * dfSinLat);
+
+        padfXRes[iLine] = ABS(adfGeoTransform[1]) * dfToRadians
+            * dfSemiMajor / dfW * ABS(cos(dfLat));
+        padfYRes[iLine] = ABS(adfGeoTransform[5]) * dfToRadians
+            * dfSemiMajor * (1.0 - dfEcc2) / (dfW * dfW * dfW);
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                        GDALExactProximityJob                         */
+/************************************************************************/
+
+typedef struct
+{
+    int          nXSize;
+    const double *padfXRes;
+    const double *padfYRes;
+    double       dfMaxDistSq;
+    float        fNoDataValue;
+    int          bFixedBufVal;
+    float        fFixedBufVal;
+
+    // The lines of the chunk, and the ones of this job.
+    float       *pafChunk;
+    int          nYOff;
+    int          nLines;
+    int          iFirstLine;
+    int          nLineStep;
+
+    // Working buffers.
+    double      *padfF;
+    double      *padfZ;
+    int         *panV;
+} GDALExactProximityJob;
+
+/************************************************************************/
+/*                        ExactProximityLine()                          */
+/*                                                                      */
+/*      Replace the distance of each pixel of a line to the nearest     */
+/*      target of its column, in lines (negative when there is          */
+/*      none), by the final proximity value.  The squared distance to   */
+/*      the target of column q is dfXRes^2 (x-q)^2 + f(q), a parabola   */
+/*      of x: we build the lower envelope of the parabolas from left    */
+/*      to right, then read it at each pixel.                           */
+/************************************************************************/
+
+static void ExactProximityLine( GDALExactProximityJob *psJob,
+                                float *pafLine, int iLine )
+
+{
+    const int    nXSize = psJob->nXSize;
+    const double dfW = psJob->padfXRes[iLine] * psJob->padfXRes[iLine];
+    const double dfYRes = psJob->padfYRes[iLine];
+    double      *padfF = psJob->padfF;
+    double      *padfZ = psJob->padfZ;
+    int         *panV = psJob->panV;
+    double       dfMinF = -1.0;
+    int          k = -1, iPixel;
+
+    for( iPixel = 0; iPixel < nXSize; iPixel++ )
+    {
+        if( pafLine[iPixel] < 0.0 )
+            continue;
+
+        const double dfF = pafLine[iPixel] * dfYRes * pafLine[iPixel] * dfYRes;
+
+        padfF[iPixel] = dfF;
+        if( dfMinF < 0.0 || dfF < dfMinF )
+            dfMinF = dfF;
+
+        if( dfW == 0.0 )
+            continue;
+
+        if( k < 0 )
+        {
+            k = 0;
+            panV[0] = iPixel;
+            padfZ[0] = -HUGE_VAL;
+            continue;
+        }
+
+        // Pop the parabolas hidden by this one, and find where it
+        // starts to be the lowest.
+        double dfS;
+
+        for( ;; )
+        {
+            const int iV = panV[k];
+
+            dfS = ((dfF + dfW * iPixel * (double) iPixel)
+                   - (padfF[iV] + dfW * iV * (double) iV))
+                / (2.0 * dfW * (iPixel - iV));
+            if( dfS > padfZ[k] )
+                break;
+            k--;
+        }
+
+        k++;
+        panV[k] = iPixel;
+        padfZ[k] = dfS;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read the envelope.  At the poles all the columns of a line are  */
+/*      the same point.                                                 */
+/* -------------------------------------------------------------------- */
+    int j = 0;
+
+    for( iPixel = 0; iPixel < nXSize; iPixel++ )
+    {
+        double dfDistSq;
+
+        if( dfMinF < 0.0 )
+        {
+            pafLine[iPixel] = psJob->fNoDataValue;
+            continue;
+        }
+
+        if( dfW == 0.0 )
+            dfDistSq = dfMinF;
+        else
+        {
+            while( j < k && padfZ[j+1] < iPixel )
+                j++;
+            dfDistSq = dfW * (iPixel - panV[j]) * (double) (iPixel - panV[j])
+                + padfF[panV[j]];
+        }
+
+        if( psJob->dfMaxDistSq >= 0.0 && dfDistSq > psJob->dfMaxDistSq )
+            pafLine[iPixel] = psJob->fNoDataValue;
+        else if( dfDistSq == 0.0 )
+            pafLine[iPixel] = 0.0;
+        else if( psJob->bFixedBufVal )
+            pafLine[iPixel] = psJob->fFixedBufVal;
+        else
+            pafLine[iPixel] = (float) sqrt(dfDistSq);
+    }
+}
+
+/************************************************************************/
+/*                     GDALExactProximityJobMain()                      */
+/************************************************************************/
+
+static void GDALExactProximityJobMain( void *pData )
+
+{
+    GDALExactProximityJob *psJob = (GDALExactProximityJob *) pData;
+    int                    iLine;
+
+    for( iLine = psJob->iFirstLine; iLine < psJob->nLines;
+         iLine += psJob->nLineStep )
+        ExactProximityLine( psJob,
+                            psJob->pafChunk + iLine * (size_t) psJob->nXSize,
+                            psJob->nYOff + iLine );
+}
+
+/************************************************************************/
+/*                         IsProximityTarget()                          */
+/************************************************************************/
+
+static int IsProximityTarget( GInt32 nValue, int nTargetValues,
+                              const int *panTargetValues )
+
+{
+    if( nTargetValues == 0 )
+        return nValue != 0;
+
+    for( int i = 0; i < nTargetValues; i++ )
+    {
+        if( nValue == panTargetValues[i] )
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/************************************************************************/
+/*                       ComputeExactProximity()                        */
+/*                                                                      */
+/*      The column pass goes down the image, keeping for each column    */
+/*      the number of lines since its last target, which is written     */
+/*      to a work band.  It then goes up the image by chunks of lines,  */
+/*      keeping the number of lines to the next target, so that the     */
+/*      distance to the nearest target of the column is known for the   */
+/*      lines of the chunk.  These are then transformed on separate     */
+/*      threads, and written.                                           */
+/************************************************************************/
+
+static CPLErr
+ComputeExactProximity( GDALRasterBandH hSrcBand,
+                       GDALRasterBandH hProximityBand,
+                       const double *padfXRes, const double *padfYRes,
+                       double dfMaxDist, float fNoDataValue,
+                       int bFixedBufVal, double dfFixedBufVal,
+                       int nTargetValues, int *panTargetValues,
+                       int nThreads,
+                       GDALProgressFunc pfnProgress, void *pProgressArg )
+
+{
+    const int nXSize = GDALGetRasterBandXSize( hSrcBand );
+    const int nYSize = GDALGetRasterBandYSize( hSrcBand );
+    int       i, iLine;
+    CPLErr    eErr = CE_None;
+
+/* -------------------------------------------------------------------- */
+/*      The line counts are kept in the proximity band if it can hold   */
+/*      them, or in a temporary file.                                   */
+/* -------------------------------------------------------------------- */
+    GDALRasterBandH hWorkBand = hProximityBand;
+    GDALDatasetH    hWorkDS = NULL;
+    GDALDataType    eProxType = GDALGetRasterDataType( hProximityBand );
+
+    if( eProxType != GDT_Float32 && eProxType != GDT_Float64
+        && eProxType != GDT_Int32 )
+    {
+        GDALDriverH hDriver = GDALGetDriverByName("GTiff");
+        if (hDriver == NULL)
+        {
+            CPLError(CE_Failure, CPLE_AppDefined,
+                     "GDALComputeProximity needs GTiff driver");
+            return CE_Failure;
+        }
+        CPLString osTmpFile = CPLGenerateTempFilename( "proximity" );
+        hWorkDS = GDALCreate( hDriver, osTmpFile,
+                              nXSize, nYSize, 1, GDT_Float32, NULL );
+        if (hWorkDS == NULL)
+            return CE_Failure;
+        hWorkBand = GDALGetRasterBand( hWorkDS, 1 );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Allocate a chunk of about a million pixels, and the jobs.       */
+/* -------------------------------------------------------------------- */
+    int nChunkLines = MAX(1, 1048576 / MAX(nXSize, 1));
+
+    nChunkLines = MIN(MAX(nChunkLines, nThreads), nYSize);
+
+    GInt32 *panSrcChunk = (GInt32 *)
+        VSIMalloc( sizeof(GInt32) * nXSize * (size_t) nChunkLines );
+    float  *pafChunk = (float *)
+        VSIMalloc( sizeof(float) * nXSize * (size_t) nChunkLines );
+    int    *panNearLines = (int *) VSIMalloc2( sizeof(int), nXSize );
+
+    const int nJobs = MIN(nThreads, nChunkLines);
+    GDALExactProximityJob *pasJobs = (GDALExactProximityJob *)
+        CPLCalloc( sizeof(GDALExactProximityJob), nJobs );
+    void  **papJobs = (void **) CPLCalloc( sizeof(void*), nJobs );
+    int     bOK = panSrcChunk != NULL && pafChunk != NULL
+        && panNearLines != NULL;
+    int     iJob;
+
+    for( iJob = 0; iJob < nJobs; iJob++ )
+    {
+        GDALExactProximityJob *psJob = pasJobs + iJob;
+
+        psJob->nXSize = nXSize;
+        psJob->padfXRes = padfXRes;
+        psJob->padfYRes = padfYRes;
+        psJob->dfMaxDistSq = dfMaxDist >= 0.0 ? dfMaxDist * dfMaxDist : -1.0;
+        psJob->fNoDataValue = fNoDataValue;
+        psJob->bFixedBufVal = bFixedBufVal;
+        psJob->fFixedBufVal = (float) dfFixedBufVal;
+        psJob->pafChunk = pafChunk;
+        psJob->iFirstLine = iJob;
+        psJob->nLineStep = nJobs;
+        psJob->padfF = (double *) VSIMalloc2( sizeof(double), nXSize );
+        psJob->padfZ = (double *) VSIMalloc2( sizeof(double), nXSize );
+        psJob->panV = (int *) VSIMalloc2( sizeof(int), nXSize );
+        bOK = bOK && psJob->padfF != NULL && psJob->padfZ != NULL
+            && psJob->panV != NULL;
+        papJobs[iJob] = psJob;
+    }
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Out of memory allocating working buffers.");
+        eErr = CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Down the image: lines since the last target of each column.     */
+/* -------------------------------------------------------------------- */
+    int nYOff, nLines;
+
+    for( i = 0; bOK && i < nXSize; i++ )
+        panNearLines[i] = -1;
+
+    for( nYOff = 0; eErr == CE_None && nYOff < nYSize; nYOff += nLines )
+    {
+        nLines = MIN(nChunkLines, nYSize - nYOff);
+
+        eErr = GDALRasterIO( hSrcBand, GF_Read, 0, nYOff, nXSize, nLines,
+                             panSrcChunk, nXSize, nLines, GDT_Int32, 0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        for( iLine = 0; iLine < nLines; iLine++ )
+        {
+            const GInt32 *panSrc = panSrcChunk + iLine * (size_t) nXSize;
+            float        *pafLine = pafChunk + iLine * (size_t) nXSize;
+
+            for( i = 0; i < nXSize; i++ )
+            {
+                if( IsProximityTarget( panSrc[i], nTargetValues,
+                                       panTargetValues ) )
+                    panNearLines[i] = 0;
+                else if( panNearLines[i] >= 0 )
+                    panNearLines[i]++;
+                pafLine[i] = (float) panNearLines[i];
+            }
+        }
+
+        eErr = GDALRasterIO( hWorkBand, GF_Write, 0, nYOff, nXSize, nLines,
+                             pafChunk, nXSize, nLines, GDT_Float32, 0, 0 );
+
+        if( eErr == CE_None
+            && !pfnProgress( 0.25 * (nYOff + nLines) / (double) nYSize,
+                             "", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Up the image: lines to the next target of each column, and      */
+/*      transform of the lines of each chunk.                           */
+/* -------------------------------------------------------------------- */
+    for( i = 0; bOK && i < nXSize; i++ )
+        panNearLines[i] = -1;
+
+    for( nYOff = nYSize; eErr == CE_None && nYOff > 0; )
+    {
+        nLines = MIN(nChunkLines, nYOff);
+        nYOff -= nLines;
+
+        eErr = GDALRasterIO( hSrcBand, GF_Read, 0, nYOff, nXSize, nLines,
+                             panSrcChunk, nXSize, nLines, GDT_Int32, 0, 0 );
+        if( eErr == CE_None )
+            eErr = GDALRasterIO( hWorkBand, GF_Read,
+                                 0, nYOff, nXSize, nLines,
+                                 pafChunk, nXSize, nLines, GDT_Float32, 0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        for( iLine = nLines - 1; iLine >= 0; iLine-- )
+        {
+            const GInt32 *panSrc = panSrcChunk + iLine * (size_t) nXSize;
+            float        *pafLine = pafChunk + iLine * (size_t) nXSize;
+
+            for( i = 0; i < nXSize; i++ )
+            {
+                if( IsProximityTarget( panSrc[i], nTargetValues,
+                                       panTargetValues ) )
+                    panNearLines[i] = 0;
+                else if( panNearLines[i] >= 0 )
+                    panNearLines[i]++;
+
+                if( panNearLines[i] >= 0
+                    && (pafLine[i] < 0.0 || panNearLines[i] < pafLine[i]) )
+                    pafLine[i] = (float) panNearLines[i];
+            }
+        }
+
+        for( iJob = 0; iJob < nJobs; iJob++ )
+        {
+            pasJobs[iJob].nYOff = nYOff;
+            pasJobs[iJob].nLines = nLines;
+        }
+
+        CPLRunJobs( nJobs, papJobs, GDALExactProximityJobMain, nThreads );
+
+        eErr = GDALRasterIO( hProximityBand, GF_Write,
+                             0, nYOff, nXSize, nLines,
+                             pafChunk, nXSize, nLines, GDT_Float32, 0, 0 );
+
+        if( eErr == CE_None
+            && !pfnProgress( 0.25 + 0.75 * (nYSize - nYOff) / (double) nYSize,
+                             "", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Cleanup                                                         */
+/* -------------------------------------------------------------------- */
+    for( iJob = 0; iJob < nJobs; iJob++ )
+    {
+        CPLFree( pasJobs[iJob].padfF );
+        CPLFree( pasJobs[iJob].padfZ );
+        CPLFree( pasJobs[iJob].panV );
+    }
+    CPLFree( pasJobs );
+    CPLFree( papJobs );
+    CPLFree( panSrcChunk );
+    CPLFree( pafChunk );
+    CPLFree( panNearLines );
+
+    if( hWorkDS != NULL )
+    {
+        CPLString osProxFile = GDALGetDescription( hWorkDS );
+        GDALClose( hWorkDS );
+        GDALDeleteDataset( GDALGetDriverByName( "GTiff" ), osProxFile );
+    }
+
+    return eErr;
+}
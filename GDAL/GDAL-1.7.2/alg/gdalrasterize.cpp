@@ -32,6 +32,7 @@
 #include "gdal_alg.h"
 #include "gdal_alg_priv.h"
 #include "gdal_priv.h"
+#include "cpl_multiproc.h"
 #include "ogr_api.h"
 #include "ogr_geometry.h"
 #include "ogr_spatialref.h"
@@ -163,10 +164,7 @@ static void GDALCollectRingsFromGeometry(
     if ( eFlatType == wkbPoint )
     {
         OGRPoint    *poPoint = (OGRPoint *) poShape;
-        int nNewCount = aPointX.size() + 1;
 
-        aPointX.reserve( nNewCount );
-        aPointY.reserve( nNewCount );
         aPointX.push_back( poPoint->getX() );
         aPointY.push_back( poPoint->getY() );
         aPartSize.push_back( 1 );
@@ -175,11 +173,9 @@ static void GDALCollectRingsFromGeometry(
             /*switch( eBurnValueSrc )
             {
             case GBV_Z:*/
-                aPointVariant.reserve( nNewCount );
                 aPointVariant.push_back( poPoint->getZ() );
                 /*break;
             case GBV_M:
-                aPointVariant.reserve( nNewCount );
                 aPointVariant.push_back( poPoint->getM() );
             }*/
         }
@@ -188,12 +184,7 @@ static void GDALCollectRingsFromGeometry(
     {
         OGRLineString   *poLine = (OGRLineString *) poShape;
         int nCount = poLine->getNumPoints();
-        int nNewCount = aPointX.size() + nCount;
 
-        aPointX.reserve( nNewCount );
-        aPointY.reserve( nNewCount );
-        if( eBurnValueSrc != GBV_UserBurnValue )
-            aPointVariant.reserve( nNewCount );
         for ( i = nCount - 1; i >= 0; i-- )
         {
             aPointX.push_back( poLine->getX(i) );
@@ -216,27 +207,22 @@ static void GDALCollectRingsFromGeometry(
     {
         OGRLinearRing *poRing = (OGRLinearRing *) poShape;
         int nCount = poRing->getNumPoints();
-        int nNewCount = aPointX.size() + nCount;
 
-        aPointX.reserve( nNewCount );
-        aPointY.reserve( nNewCount );
-        if( eBurnValueSrc != GBV_UserBurnValue )
-            aPointVariant.reserve( nNewCount );
         for ( i = nCount - 1; i >= 0; i-- )
         {
             aPointX.push_back( poRing->getX(i) );
             aPointY.push_back( poRing->getY(i) );
-        }
-        if( eBurnValueSrc != GBV_UserBurnValue )
-        {
-            /*switch( eBurnValueSrc )
+            if( eBurnValueSrc != GBV_UserBurnValue )
             {
-            case GBV_Z:*/
-                aPointVariant.push_back( poRing->getZ(i) );
-                /*break;
-            case GBV_M:
-                aPointVariant.push_back( poRing->getM(i) );
-            }*/
+                /*switch( eBurnValueSrc )
+                {
+                case GBV_Z:*/
+                    aPointVariant.push_back( poRing->getZ(i) );
+                    /*break;
+                case GBV_M:
+                    aPointVariant.push_back( poRing->getM(i) );
+                }*/
+            }
         }
         aPartSize.push_back( nCount );
     }
@@ -272,6 +258,95 @@ static void GDALCollectRingsFromGeometry(
     }
 }
 
+/************************************************************************/
+/*                           gv_burn_shape()                            */
+/*                                                                      */
+/*      Burn the point, line or ring parts of a shape, already in the   */
+/*      pixel/line coordinates of the chunk buffer.  The variants, if   */
+/*      any, must be as many as the points, and may be modified.        */
+/************************************************************************/
+
+static void 
+gv_burn_shape( unsigned char *pabyChunkBuf, int nXSize, int nYSize,
+               int nBands, GDALDataType eType, int bAllTouched,
+               OGRwkbGeometryType eFlatType,
+               int nPartCount, int *panPartSize,
+               double *padfX, double *padfY, double *padfVariant,
+               double *padfBurnValue, GDALBurnValueSrc eBurnValueSrc )
+
+{
+    GDALRasterizeInfo sInfo;
+
+    sInfo.nXSize = nXSize;
+    sInfo.nYSize = nYSize;
+    sInfo.nBands = nBands;
+    sInfo.pabyChunkBuf = pabyChunkBuf;
+    sInfo.eType = eType;
+    sInfo.padfBurnValue = padfBurnValue;
+    sInfo.eBurnValueSource = eBurnValueSrc;
+
+    if( eBurnValueSrc == GBV_UserBurnValue )
+        padfVariant = NULL;
+
+/* -------------------------------------------------------------------- */
+/*      Perform the rasterization.                                      */
+/* -------------------------------------------------------------------- */
+    int i, j, n;
+
+    switch ( eFlatType )
+    {
+        case wkbPoint:
+        case wkbMultiPoint:
+            GDALdllImagePoint( sInfo.nXSize, nYSize, 
+                               nPartCount, panPartSize, 
+                               padfX, padfY, padfVariant,
+                               gvBurnPoint, &sInfo );
+            break;
+        case wkbLineString:
+        case wkbMultiLineString:
+        {
+            if( bAllTouched )
+                GDALdllImageLineAllTouched( sInfo.nXSize, nYSize, 
+                                            nPartCount, panPartSize, 
+                                            padfX, padfY, padfVariant,
+                                            gvBurnPoint, &sInfo );
+            else
+                GDALdllImageLine( sInfo.nXSize, nYSize, 
+                                  nPartCount, panPartSize, 
+                                  padfX, padfY, padfVariant,
+                                  gvBurnPoint, &sInfo );
+        }
+        break;
+
+        default:
+        {
+            GDALdllImageFilledPolygon( sInfo.nXSize, nYSize, 
+                                       nPartCount, panPartSize, 
+                                       padfX, padfY, padfVariant,
+                                       gvBurnScanline, &sInfo );
+            if( bAllTouched )
+            {
+                /* Reverting the variants to the first value because the
+                   polygon is filled using the variant from the first point of
+                   the first segment. Should be removed when the code to full
+                   polygons more appropriately is added. */
+                if( padfVariant != NULL )
+                {
+                    for( i = 0, n = 0; i < nPartCount; i++ )
+                        for( j = 0; j < panPartSize[i]; j++ )
+                            padfVariant[n++] = padfVariant[0];
+                }
+
+                GDALdllImageLineAllTouched( sInfo.nXSize, nYSize, 
+                                            nPartCount, panPartSize, 
+                                            padfX, padfY, padfVariant,
+                                            gvBurnPoint, &sInfo );
+            }
+        }
+        break;
+    }
+}
+
 /************************************************************************/
 /*                       gv_rasterize_one_shape()                       */
 /************************************************************************/
@@ -285,19 +360,9 @@ gv_rasterize_one_shape( unsigned char *pabyChunkBuf, int nYOff,
                         void *pTransformArg )
 
 {
-    GDALRasterizeInfo sInfo;
-
     if (poShape == NULL)
         return;
 
-    sInfo.nXSize = nXSize;
-    sInfo.nYSize = nYSize;
-    sInfo.nBands = nBands;
-    sInfo.pabyChunkBuf = pabyChunkBuf;
-    sInfo.eType = eType;
-    sInfo.padfBurnValue = padfBurnValue;
-    sInfo.eBurnValueSource = eBurnValueSrc;
-
 /* -------------------------------------------------------------------- */
 /*      Transform polygon geometries into a set of rings and a part     */
 /*      size list.                                                      */
@@ -336,7 +401,6 @@ gv_rasterize_one_shape( unsigned char *pabyChunkBuf, int nYOff,
 /*      According to the C++ Standard/23.2.4, elements of a vector are  */
 /*      stored in continuous memory block.                              */
 /* -------------------------------------------------------------------- */
-    unsigned int j,n;
 
     // TODO - mloskot: Check if vectors are empty, otherwise it may
     // lead to undefined behavior by returning non-referencable pointer.
@@ -344,75 +408,409 @@ gv_rasterize_one_shape( unsigned char *pabyChunkBuf, int nYOff,
     //    /* fill polygon */
     // else
     //    /* How to report this problem? */    
-    switch ( wkbFlatten(poShape->getGeometryType()) )
+    gv_burn_shape( pabyChunkBuf, nXSize, nYSize, nBands, eType, bAllTouched,
+                   wkbFlatten(poShape->getGeometryType()),
+                   aPartSize.size(), &(aPartSize[0]),
+                   &(aPointX[0]), &(aPointY[0]), 
+                   (eBurnValueSrc == GBV_UserBurnValue)?
+                       NULL : &(aPointVariant[0]),
+                   padfBurnValue, eBurnValueSrc );
+}
+
+/************************************************************************/
+/*                        GDALRasterizeShapeSet                         */
+/*                                                                      */
+/*      Shapes collected and transformed to pixel/line coordinates      */
+/*      once, with their burn values.  Burn() buckets them by the       */
+/*      chunks of lines they may touch, and burns each chunk from its   */
+/*      bucket, instead of collecting and transforming every shape      */
+/*      again for every chunk.                                          */
+/************************************************************************/
+
+typedef struct
+{
+    OGRwkbGeometryType eFlatType;
+    int         nFirstPoint;
+    int         nPointCount;
+    int         nFirstPart;
+    int         nPartCount;
+    double      dfMinY;
+    double      dfMaxY;
+    int         bFinite;
+} GDALRasterizeShape;
+
+class GDALRasterizeShapeSet
+{
+    int                 nBandCount;
+    GDALBurnValueSrc    eBurnValueSrc;
+
+    std::vector<double> aPointX;
+    std::vector<double> aPointY;
+    std::vector<double> aPointVariant;
+    std::vector<int>    aPartSize;
+    std::vector<double> aBurnValues;
+    std::vector<GDALRasterizeShape> aShapes;
+    std::vector<int>    anSuccess;
+
+  public:
+                        GDALRasterizeShapeSet( int nBandCountIn,
+                                               GDALBurnValueSrc eSrc )
+                            { nBandCount = nBandCountIn;
+                              eBurnValueSrc = eSrc; }
+
+    void                Clear();
+    size_t              GetMemoryUsage();
+    void                AddShape( OGRGeometry *poShape, 
+                                  double *padfBurnValue,
+                                  GDALTransformerFunc pfnTransformer, 
+                                  void *pTransformArg );
+    void                BurnChunk( const std::vector<int> &anShapes,
+                                   unsigned char *pabyChunkBuf, int nYOff,
+                                   int nXSize, int nYSize, 
+                                   GDALDataType eType, int bAllTouched );
+    CPLErr              Burn( GDALDataset *poDS, int nBandCount,
+                              int *panBandList, GDALDataType eType,
+                              unsigned char *pabyChunkBuf, int nYChunkSize,
+                              int bAllTouched, int nThreads,
+                              GDALProgressFunc pfnProgress, 
+                              void *pProgressArg );
+};
+
+/************************************************************************/
+/*                               Clear()                                */
+/************************************************************************/
+
+void GDALRasterizeShapeSet::Clear()
+
+{
+    aPointX.resize( 0 );
+    aPointY.resize( 0 );
+    aPointVariant.resize( 0 );
+    aPartSize.resize( 0 );
+    aBurnValues.resize( 0 );
+    aShapes.resize( 0 );
+}
+
+/************************************************************************/
+/*                           GetMemoryUsage()                           */
+/************************************************************************/
+
+size_t GDALRasterizeShapeSet::GetMemoryUsage()
+
+{
+    return (aPointX.size() + aPointY.size() + aPointVariant.size()
+            + aBurnValues.size()) * sizeof(double)
+        + aPartSize.size() * sizeof(int)
+        + aShapes.size() * (sizeof(GDALRasterizeShape) + sizeof(int));
+}
+
+/************************************************************************/
+/*                              AddShape()                              */
+/*                                                                      */
+/*      Collect and transform the shape exactly like                    */
+/*      gv_rasterize_one_shape() does.                                  */
+/************************************************************************/
+
+void GDALRasterizeShapeSet::AddShape( OGRGeometry *poShape, 
+                                      double *padfBurnValue,
+                                      GDALTransformerFunc pfnTransformer, 
+                                      void *pTransformArg )
+
+{
+    GDALRasterizeShape sShape;
+    int                i;
+
+    if( poShape == NULL )
+        return;
+
+    sShape.eFlatType = wkbFlatten(poShape->getGeometryType());
+    sShape.nFirstPoint = aPointX.size();
+    sShape.nFirstPart = aPartSize.size();
+
+    GDALCollectRingsFromGeometry( poShape, aPointX, aPointY, aPointVariant,
+                                  aPartSize, eBurnValueSrc );
+
+    sShape.nPointCount = aPointX.size() - sShape.nFirstPoint;
+    sShape.nPartCount = aPartSize.size() - sShape.nFirstPart;
+
+    // Nothing would be burnt.
+    if( sShape.nPointCount == 0 )
     {
-        case wkbPoint:
-        case wkbMultiPoint:
-            GDALdllImagePoint( sInfo.nXSize, nYSize, 
-                               aPartSize.size(), &(aPartSize[0]), 
-                               &(aPointX[0]), &(aPointY[0]), 
-                               (eBurnValueSrc == GBV_UserBurnValue)?
-                                   NULL : &(aPointVariant[0]),
-                               gvBurnPoint, &sInfo );
+        aPartSize.resize( sShape.nFirstPart );
+        return;
+    }
+
+    double *padfX = &(aPointX[sShape.nFirstPoint]);
+    double *padfY = &(aPointY[sShape.nFirstPoint]);
+
+    if( pfnTransformer != NULL )
+    {
+        anSuccess.resize( sShape.nPointCount );
+
+        pfnTransformer( pTransformArg, FALSE, sShape.nPointCount, 
+                        padfX, padfY, NULL, &(anSuccess[0]) );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Lines range, to find the chunks the shape may touch.  A         */
+/*      point that failed to transform may end anywhere, so that        */
+/*      shape goes in all the chunks.                                   */
+/* -------------------------------------------------------------------- */
+    sShape.dfMinY = padfY[0];
+    sShape.dfMaxY = padfY[0];
+    sShape.bFinite = TRUE;
+
+    for( i = 0; i < sShape.nPointCount; i++ )
+    {
+        if( !CPLIsFinite(padfY[i]) )
+            sShape.bFinite = FALSE;
+        else if( padfY[i] < sShape.dfMinY )
+            sShape.dfMinY = padfY[i];
+        else if( padfY[i] > sShape.dfMaxY )
+            sShape.dfMaxY = padfY[i];
+    }
+
+    aShapes.push_back( sShape );
+
+    for( i = 0; i < nBandCount; i++ )
+        aBurnValues.push_back( padfBurnValue[i] );
+}
+
+/************************************************************************/
+/*                             BurnChunk()                              */
+/*                                                                      */
+/*      Burn the listed shapes, in order, into the buffer of the        */
+/*      chunk of lines starting at nYOff.  The burn functions work on   */
+/*      copies of the line coordinates, shifted to the chunk, and of    */
+/*      the variants that they may modify, so several chunks may be     */
+/*      burnt at the same time.                                         */
+/************************************************************************/
+
+void GDALRasterizeShapeSet::BurnChunk( const std::vector<int> &anShapes,
+                                       unsigned char *pabyChunkBuf, int nYOff,
+                                       int nXSize, int nYSize, 
+                                       GDALDataType eType, int bAllTouched )
+
+{
+    std::vector<double> aChunkY, aChunkVariant;
+
+    for( unsigned int k = 0; k < anShapes.size(); k++ )
+    {
+        const GDALRasterizeShape *psShape = &(aShapes[anShapes[k]]);
+        double *padfVariant = NULL;
+        int     i;
+
+        aChunkY.resize( psShape->nPointCount );
+        for( i = 0; i < psShape->nPointCount; i++ )
+            aChunkY[i] = aPointY[psShape->nFirstPoint + i] - nYOff;
+
+        if( eBurnValueSrc != GBV_UserBurnValue )
+        {
+            aChunkVariant.assign( 
+                aPointVariant.begin() + psShape->nFirstPoint,
+                aPointVariant.begin() + psShape->nFirstPoint 
+                + psShape->nPointCount );
+            padfVariant = &(aChunkVariant[0]);
+        }
+
+        gv_burn_shape( pabyChunkBuf, nXSize, nYSize,
+                       nBandCount, eType, bAllTouched, 
+                       psShape->eFlatType, psShape->nPartCount,
+                       &(aPartSize[psShape->nFirstPart]),
+                       &(aPointX[psShape->nFirstPoint]),
+                       &(aChunkY[0]), padfVariant,
+                       &(aBurnValues[anShapes[k] * nBandCount]),
+                       eBurnValueSrc );
+    }
+}
+
+/************************************************************************/
+/*                     GDALRasterizeChunkJobMain()                      */
+/************************************************************************/
+
+typedef struct
+{
+    GDALRasterizeShapeSet  *poShapes;
+    const std::vector<int> *panShapes;
+    unsigned char          *pabyChunkBuf;
+    int                     nYOff;
+    int                     nXSize;
+    int                     nYSize;
+    GDALDataType            eType;
+    int                     bAllTouched;
+} GDALRasterizeChunkJob;
+
+static void GDALRasterizeChunkJobMain( void *pData )
+
+{
+    GDALRasterizeChunkJob *psJob = (GDALRasterizeChunkJob *) pData;
+
+    psJob->poShapes->BurnChunk( *(psJob->panShapes), psJob->pabyChunkBuf,
+                                psJob->nYOff, psJob->nXSize, psJob->nYSize,
+                                psJob->eType, psJob->bAllTouched );
+}
+
+/************************************************************************/
+/*                                Burn()                                */
+/*                                                                      */
+/*      Burn all the shapes into the dataset, chunk by chunk.  With     */
+/*      several threads, a group of chunks is read, burnt               */
+/*      concurrently, each in its own buffer, and written in order.     */
+/************************************************************************/
+
+CPLErr GDALRasterizeShapeSet::Burn( GDALDataset *poDS, int nBandCount,
+                                    int *panBandList, GDALDataType eType,
+                                    unsigned char *pabyChunkBuf, 
+                                    int nYChunkSize, int bAllTouched,
+                                    int nThreads,
+                                    GDALProgressFunc pfnProgress, 
+                                    void *pProgressArg )
+
+{
+    int nXSize = poDS->GetRasterXSize();
+    int nYSize = poDS->GetRasterYSize();
+    int nChunkCount = (nYSize + nYChunkSize - 1) / nYChunkSize;
+    int iShape, iChunk;
+
+/* -------------------------------------------------------------------- */
+/*      Bucket the shapes by chunk.  The burn functions only touch      */
+/*      the lines from the floor of the smallest line coordinate        */
+/*      minus one, to the floor of the largest plus one.                */
+/* -------------------------------------------------------------------- */
+    std::vector< std::vector<int> > aanBuckets( nChunkCount );
+
+    for( iShape = 0; iShape < (int) aShapes.size(); iShape++ )
+    {
+        const GDALRasterizeShape *psShape = &(aShapes[iShape]);
+        int   iFirstChunk = 0, iLastChunk = nChunkCount - 1;
+
+        if( psShape->bFinite )
+        {
+            double dfFirstLine = floor(psShape->dfMinY) - 1;
+            double dfLastLine = floor(psShape->dfMaxY) + 1;
+
+            if( dfLastLine < 0 || dfFirstLine >= nYSize )
+                continue;
+
+            if( dfFirstLine > 0 )
+                iFirstChunk = ((int) dfFirstLine) / nYChunkSize;
+            if( dfLastLine < nYSize )
+                iLastChunk = ((int) dfLastLine) / nYChunkSize;
+        }
+
+        for( iChunk = iFirstChunk; iChunk <= iLastChunk; iChunk++ )
+            aanBuckets[iChunk].push_back( iShape );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Allocate a buffer per thread, the first one being the           */
+/*      caller's.  If memory is short, use fewer threads.               */
+/* -------------------------------------------------------------------- */
+    int nScanlineBytes = nBandCount * nXSize * (GDALGetDataTypeSize(eType)/8);
+    std::vector<unsigned char *> apabyChunkBufs;
+    std::vector<GDALRasterizeChunkJob> asJobs;
+    std::vector<void *> apJobs;
+    int iBuf;
+
+    apabyChunkBufs.push_back( pabyChunkBuf );
+    while( (int) apabyChunkBufs.size() < MIN(nThreads, nChunkCount) )
+    {
+        unsigned char *pabyBuf = (unsigned char *)
+            VSIMalloc( nYChunkSize * nScanlineBytes );
+
+        if( pabyBuf == NULL )
             break;
-        case wkbLineString:
-        case wkbMultiLineString:
+        apabyChunkBufs.push_back( pabyBuf );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Burn the chunks that have shapes, a group at a time.            */
+/* -------------------------------------------------------------------- */
+    CPLErr eErr = CE_None;
+
+    iChunk = 0;
+    while( iChunk < nChunkCount && eErr == CE_None )
+    {
+        asJobs.resize( 0 );
+
+        for( ; iChunk < nChunkCount 
+                 && asJobs.size() < apabyChunkBufs.size(); iChunk++ )
         {
-            if( bAllTouched )
-                GDALdllImageLineAllTouched( sInfo.nXSize, nYSize, 
-                                            aPartSize.size(), &(aPartSize[0]), 
-                                            &(aPointX[0]), &(aPointY[0]), 
-                                            (eBurnValueSrc == GBV_UserBurnValue)?
-                                                NULL : &(aPointVariant[0]),
-                                            gvBurnPoint, &sInfo );
-            else
-                GDALdllImageLine( sInfo.nXSize, nYSize, 
-                                  aPartSize.size(), &(aPartSize[0]), 
-                                  &(aPointX[0]), &(aPointY[0]), 
-                                  (eBurnValueSrc == GBV_UserBurnValue)?
-                                      NULL : &(aPointVariant[0]),
-                                  gvBurnPoint, &sInfo );
+            GDALRasterizeChunkJob sJob;
+
+            if( aanBuckets[iChunk].size() == 0 )
+                continue;
+
+            sJob.poShapes = this;
+            sJob.panShapes = &(aanBuckets[iChunk]);
+            sJob.pabyChunkBuf = apabyChunkBufs[asJobs.size()];
+            sJob.nYOff = iChunk * nYChunkSize;
+            sJob.nXSize = nXSize;
+            sJob.nYSize = MIN(nYChunkSize, nYSize - sJob.nYOff);
+            sJob.eType = eType;
+            sJob.bAllTouched = bAllTouched;
+
+            eErr = poDS->RasterIO( GF_Read, 0, sJob.nYOff, 
+                                   nXSize, sJob.nYSize, 
+                                   sJob.pabyChunkBuf, nXSize, sJob.nYSize,
+                                   eType, nBandCount, panBandList, 0, 0, 0 );
+            if( eErr != CE_None )
+                break;
+
+            asJobs.push_back( sJob );
         }
-        break;
 
-        default:
+        if( eErr != CE_None )
+            break;
+
+        apJobs.resize( asJobs.size() );
+        for( iBuf = 0; iBuf < (int) asJobs.size(); iBuf++ )
+            apJobs[iBuf] = &(asJobs[iBuf]);
+
+        if( asJobs.size() > 0 )
+            CPLRunJobs( asJobs.size(), &(apJobs[0]), 
+                        GDALRasterizeChunkJobMain, nThreads );
+
+        for( iBuf = 0; iBuf < (int) asJobs.size() && eErr == CE_None; iBuf++ )
         {
-            GDALdllImageFilledPolygon( sInfo.nXSize, nYSize, 
-                                       aPartSize.size(), &(aPartSize[0]), 
-                                       &(aPointX[0]), &(aPointY[0]), 
-                                       (eBurnValueSrc == GBV_UserBurnValue)?
-                                           NULL : &(aPointVariant[0]),
-                                       gvBurnScanline, &sInfo );
-            if( bAllTouched )
-            {
-                /* Reverting the variants to the first value because the
-                   polygon is filled using the variant from the first point of
-                   the first segment. Should be removed when the code to full
-                   polygons more appropriately is added. */
-                if(eBurnValueSrc == GBV_UserBurnValue)
-                {
-                GDALdllImageLineAllTouched( sInfo.nXSize, nYSize, 
-                                            aPartSize.size(), &(aPartSize[0]), 
-                                            &(aPointX[0]), &(aPointY[0]), 
-                                            NULL,
-                                            gvBurnPoint, &sInfo );
-                }
-                else
-                {
-                for( i = 0, n = 0; i < aPartSize.size(); i++ )
-                    for( j = 0; j < aPartSize[i]; j++ )
-                        aPointVariant[n++] = aPointVariant[0];
-                   
-                GDALdllImageLineAllTouched( sInfo.nXSize, nYSize, 
-                                            aPartSize.size(), &(aPartSize[0]), 
-                                            &(aPointX[0]), &(aPointY[0]), 
-                                            &(aPointVariant[0]),
-                                            gvBurnPoint, &sInfo );
-                }
-            }
+            GDALRasterizeChunkJob *psJob = &(asJobs[iBuf]);
+
+            eErr = poDS->RasterIO( GF_Write, 0, psJob->nYOff, 
+                                   nXSize, psJob->nYSize, 
+                                   psJob->pabyChunkBuf, nXSize, psJob->nYSize,
+                                   eType, nBandCount, panBandList, 0, 0, 0 );
+        }
+
+        if( eErr == CE_None 
+            && !pfnProgress( iChunk / (double) nChunkCount,
+                             "", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
         }
-        break;
     }
+
+    for( iBuf = 1; iBuf < (int) apabyChunkBufs.size(); iBuf++ )
+        VSIFree( apabyChunkBufs[iBuf] );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                     GDALRasterizeGetMaxMemory()                      */
+/************************************************************************/
+
+static size_t GDALRasterizeGetMaxMemory( char **papszOptions )
+
+{
+    const char *pszMaxMemory = 
+        CSLFetchNameValue( papszOptions, "SINGLE_PASS_MAX_MEMORY" );
+    int nMaxMemoryMB = pszMaxMemory ? atoi(pszMaxMemory) : 100;
+
+    if( nMaxMemoryMB < 1 )
+        nMaxMemoryMB = 1;
+
+    return ((size_t) nMaxMemoryMB) * 1024 * 1024;
 }
 
 /************************************************************************/
@@ -460,6 +858,18 @@ gv_rasterize_one_shape( unsigned char *pabyChunkBuf, int nYOff,
  * Defaults to GDALBurnValueSrc.GBV_UserBurnValue in which case just the
  * dfBurnValue is burned. This is implemented only for points and lines for
  * now. The M value may be supported in the future.</dd>
+ * <dt>"SINGLE_PASS":</dt> <dd>When the raster is processed in more than one
+ * chunk, the geometries are transformed only once, and each chunk is burnt
+ * from the geometries that may touch it.  May be set to FALSE to transform
+ * all the geometries again for every chunk.  Defaults to TRUE.</dd>
+ * <dt>"SINGLE_PASS_MAX_MEMORY":</dt> <dd>The memory, in megabytes, that the
+ * transformed geometries may use in the single pass mode.  If they need
+ * more, they are burnt in several passes over the raster.  Defaults to
+ * 100.</dd>
+ * <dt>"NUM_THREADS":</dt> <dd>The number of threads, or ALL_CPUS, burning
+ * chunks concurrently in the single pass mode.  The chunk buffer memory is
+ * then shared between as many chunks.  Defaults to the GDAL_NUM_THREADS
+ * configuration option, or 1.</dd>
  * </dl>
  * @param pfnProgress the progress function to report completion.
  * @param pProgressArg callback data for progress function.
@@ -542,9 +952,24 @@ CPLErr GDALRasterizeGeometries( GDALDatasetH hDS,
     nScanlineBytes = nBandCount * poDS->GetRasterXSize()
         * (GDALGetDataTypeSize(eType)/8);
     nYChunkSize = 10000000 / nScanlineBytes;
+    if( nYChunkSize < 1 )
+        nYChunkSize = 1;
     if( nYChunkSize > poDS->GetRasterYSize() )
         nYChunkSize = poDS->GetRasterYSize();
 
+/* -------------------------------------------------------------------- */
+/*      With several threads, share that memory between as many        */
+/*      chunks, burnt concurrently.                                     */
+/* -------------------------------------------------------------------- */
+    int bSinglePass = CSLFetchBoolean( papszOptions, "SINGLE_PASS", TRUE );
+    int nThreads = 
+        CPLGetNumThreads( CSLFetchNameValue( papszOptions, "NUM_THREADS" ) );
+
+    if( bSinglePass && nThreads > 1 )
+        nYChunkSize = (nYChunkSize + nThreads - 1) / nThreads;
+
+    bSinglePass = bSinglePass && nYChunkSize < poDS->GetRasterYSize();
+
     pabyChunkBuf = (unsigned char *) VSIMalloc(nYChunkSize * nScanlineBytes);
     if( pabyChunkBuf == NULL )
     {
@@ -560,8 +985,47 @@ CPLErr GDALRasterizeGeometries( GDALDatasetH hDS,
 
     pfnProgress( 0.0, NULL, pProgressArg );
 
+/* -------------------------------------------------------------------- */
+/*      If more than one chunk is needed, transform the geometries      */
+/*      once, and burn each chunk from the shapes that may touch it,    */
+/*      in batches that fit in the memory budget.                       */
+/* -------------------------------------------------------------------- */
+    if( bSinglePass )
+    {
+        GDALRasterizeShapeSet oShapes( nBandCount, eBurnValueSource );
+        size_t nMaxMemory = GDALRasterizeGetMaxMemory( papszOptions );
+        int    iShape, iFirstShape = 0;
+
+        for( iShape = 0; iShape < nGeomCount && eErr == CE_None; iShape++ )
+        {
+            oShapes.AddShape( (OGRGeometry *) pahGeometries[iShape],
+                              padfGeomBurnValue + iShape*nBandCount,
+                              pfnTransformer, pTransformArg );
+
+            if( iShape < nGeomCount - 1 
+                && oShapes.GetMemoryUsage() < nMaxMemory )
+                continue;
+
+            void *pScaledProgress =
+                GDALCreateScaledProgress( iFirstShape / (double) nGeomCount,
+                                          (iShape + 1) / (double) nGeomCount,
+                                          pfnProgress, pProgressArg );
+            eErr = oShapes.Burn( poDS, nBandCount, panBandList, eType,
+                                 pabyChunkBuf, nYChunkSize, bAllTouched,
+                                 nThreads, 
+                                 GDALScaledProgress, pScaledProgress );
+            GDALDestroyScaledProgress( pScaledProgress );
+
+            oShapes.Clear();
+            iFirstShape = iShape + 1;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Otherwise loop over image in designated chunks.                 */
+/* -------------------------------------------------------------------- */
     for( iY = 0; 
-         iY < poDS->GetRasterYSize() && eErr == CE_None; 
+         !bSinglePass && iY < poDS->GetRasterYSize() && eErr == CE_None; 
          iY += nYChunkSize )
     {
         int	nThisYChunkSize;
@@ -670,6 +1134,20 @@ CPLErr GDALRasterizeGeometries( GDALDatasetH hDS,
  * is. This is implemented properly only for points and lines for now. Polygons
  * will be burned using the Z value from the first point. The M value may be
  * supported in the future.</dd>
+ * <dt>"SINGLE_PASS":</dt> <dd>When the raster is processed in more than one
+ * chunk, the features of each layer are read and transformed only once, and
+ * each chunk is burnt from the features that may touch it, instead of
+ * reading all the features again for every chunk.  May be set to FALSE to
+ * read them for every chunk.  Defaults to TRUE.</dd>
+ * <dt>"SINGLE_PASS_MAX_MEMORY":</dt> <dd>The memory, in megabytes, that the
+ * transformed features may use in the single pass mode.  If more features
+ * are read, they are burnt in several passes over the raster.  Defaults to
+ * 100.</dd>
+ * <dt>"NUM_THREADS":</dt> <dd>The number of threads, or ALL_CPUS, burning
+ * chunks concurrently in the single pass mode.  Unless CHUNKYSIZE is set,
+ * the default chunk memory is then shared between as many chunks.  Defaults
+ * to the GDAL_NUM_THREADS configuration option, or 1.</dd>
+ * </dl>
  * @param pfnProgress the progress function to report completion.
  * @param pProgressArg callback data for progress function.
  *
@@ -745,6 +1223,20 @@ CPLErr GDALRasterizeLayers( GDALDatasetH hDS,
     if( nYChunkSize > poDS->GetRasterYSize() )
         nYChunkSize = poDS->GetRasterYSize();
 
+/* -------------------------------------------------------------------- */
+/*      With several threads, share the default chunk memory between    */
+/*      as many chunks, burnt concurrently.                             */
+/* -------------------------------------------------------------------- */
+    int bSinglePass = CSLFetchBoolean( papszOptions, "SINGLE_PASS", TRUE );
+    int nThreads = 
+        CPLGetNumThreads( CSLFetchNameValue( papszOptions, "NUM_THREADS" ) );
+
+    if( bSinglePass && nThreads > 1 
+        && !(pszYChunkSize && atoi(pszYChunkSize)) )
+        nYChunkSize = (nYChunkSize + nThreads - 1) / nThreads;
+
+    bSinglePass = bSinglePass && nYChunkSize < poDS->GetRasterYSize();
+
     pabyChunkBuf = (unsigned char *) VSIMalloc(nYChunkSize * nScanlineBytes);
     if( pabyChunkBuf == NULL )
     {
@@ -781,6 +1273,9 @@ CPLErr GDALRasterizeLayers( GDALDatasetH hDS,
     const char  *pszBurnAttribute =
         CSLFetchNameValue( papszOptions, "ATTRIBUTE" );
 
+    size_t      nMaxMemory = GDALRasterizeGetMaxMemory( papszOptions );
+    GDALRasterizeShapeSet oShapes( nBandCount, eBurnValueSource );
+
     pfnProgress( 0.0, NULL, pProgressArg );
 
     for( iLayer = 0; iLayer < nLayerCount; iLayer++ )
@@ -856,11 +1351,81 @@ CPLErr GDALRasterizeLayers( GDALDatasetH hDS,
         poLayer->ResetReading();
 
 /* -------------------------------------------------------------------- */
-/*      Loop over image in designated chunks.                           */
+/*      Read and transform the features once, and burn each chunk of    */
+/*      the image from the shapes that may touch it.  If they do not    */
+/*      fit in the memory budget, the features are burnt in batches,    */
+/*      each in a pass over the image, which keeps the burn order.      */
+/* -------------------------------------------------------------------- */
+        if( bSinglePass )
+        {
+            int     nFeatureCount = poLayer->GetFeatureCount( FALSE );
+            int     nRead = 0;
+            double  dfLayerStart = iLayer / (double) nLayerCount;
+            double  dfProgress = dfLayerStart;
+            double  *padfAttrValues = 
+                (double *) CPLMalloc(sizeof(double) * nBandCount);
+
+            while( eErr == CE_None )
+            {
+                poFeat = poLayer->GetNextFeature();
+                if( poFeat != NULL )
+                {
+                    if ( pszBurnAttribute )
+                    {
+                        int         iBand;
+                        double      dfAttrValue;
+
+                        dfAttrValue = poFeat->GetFieldAsDouble( iBurnField );
+                        for (iBand = 0 ; iBand < nBandCount ; iBand++)
+                            padfAttrValues[iBand] = dfAttrValue;
+
+                        padfBurnValues = padfAttrValues;
+                    }
+
+                    oShapes.AddShape( poFeat->GetGeometryRef(),
+                                      padfBurnValues,
+                                      pfnTransformer, pTransformArg );
+                    delete poFeat;
+                    nRead++;
+
+                    if( oShapes.GetMemoryUsage() < nMaxMemory )
+                        continue;
+                }
+
+                double  dfNext = dfProgress;
+
+                if( poFeat == NULL )
+                    dfNext = (iLayer + 1) / (double) nLayerCount;
+                else if( nFeatureCount > 0 )
+                    dfNext = dfLayerStart 
+                        + MIN(nRead / (double) nFeatureCount, 1.0) 
+                        / nLayerCount;
+
+                void *pScaledProgress =
+                    GDALCreateScaledProgress( dfProgress, dfNext,
+                                              pfnProgress, pProgressArg );
+                eErr = oShapes.Burn( poDS, nBandCount, panBandList, eType,
+                                     pabyChunkBuf, nYChunkSize, bAllTouched,
+                                     nThreads,
+                                     GDALScaledProgress, pScaledProgress );
+                GDALDestroyScaledProgress( pScaledProgress );
+
+                oShapes.Clear();
+                dfProgress = dfNext;
+
+                if( poFeat == NULL )
+                    break;
+            }
+
+            CPLFree( padfAttrValues );
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Otherwise loop over image in designated chunks.                 */
 /* -------------------------------------------------------------------- */
         int     iY;
         for( iY = 0; 
-             iY < poDS->GetRasterYSize() && eErr == CE_None; 
+             !bSinglePass && iY < poDS->GetRasterYSize() && eErr == CE_None;
              iY += nYChunkSize )
         {
             int	nThisYChunkSize;
@@ -30,6 +30,7 @@
 #include "gdal_alg_priv.h"
 #include "cpl_conv.h"
 #include <vector>
+#include <limits.h>
 
 CPL_CVSID("$Id: gdalrasterpolygonenumerator.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -85,11 +86,18 @@ void GDALRasterPolygonEnumerator::Clear()
 void GDALRasterPolygonEnumerator::MergePolygon( int nSrcId, int nDstId )
 
 {
+    // Follow the maps to the final ids, halving the paths on the way.
     while( panPolyIdMap[nDstId] != nDstId )
+    {
+        panPolyIdMap[nDstId] = panPolyIdMap[panPolyIdMap[nDstId]];
         nDstId = panPolyIdMap[nDstId];
+    }
 
     while( panPolyIdMap[nSrcId] != nSrcId )
+    {
+        panPolyIdMap[nSrcId] = panPolyIdMap[panPolyIdMap[nSrcId]];
         nSrcId = panPolyIdMap[nSrcId];
+    }
 
     if( nSrcId == nDstId )
         return;
@@ -187,38 +195,222 @@ void GDALRasterPolygonEnumerator::ProcessLine(
 
 /* -------------------------------------------------------------------- */
 /*      Process each pixel comparing to the previous pixel, and to      */
-/*      the last line.                                                  */
+/*      the last line.  With 8 connectedness a pixel may join up to     */
+/*      three polygons of the last line, so all are merged.             */
 /* -------------------------------------------------------------------- */
     for( i = 0; i < nXSize; i++ )
     {
-        if( i > 0 && panThisLineVal[i] == panThisLineVal[i-1] )
-        {
-            panThisLineId[i] = panThisLineId[i-1];        
+        const GInt32 nValue = panThisLineVal[i];
+        int          nId = -1;
 
-            if( panLastLineVal[i] == panThisLineVal[i] 
-                && (panPolyIdMap[panLastLineId[i]]
-                    != panPolyIdMap[panThisLineId[i]]) )
-            {
-                MergePolygon( panLastLineId[i], panThisLineId[i] );
-            }
-        }
-        else if( panLastLineVal[i] == panThisLineVal[i] )
+        if( i > 0 && panThisLineVal[i-1] == nValue )
+            nId = panThisLineId[i-1];
+
+        if( panLastLineVal[i] == nValue )
         {
-            panThisLineId[i] = panLastLineId[i];
+            if( nId == -1 )
+                nId = panLastLineId[i];
+            else if( panPolyIdMap[panLastLineId[i]] != panPolyIdMap[nId] )
+                MergePolygon( panLastLineId[i], nId );
         }
-        else if( i > 0 && nConnectedness == 8 
-                 && panLastLineVal[i-1] == panThisLineVal[i] )
+
+        if( nConnectedness == 8 )
         {
-            panThisLineId[i] = panLastLineId[i-1];
+            int iNeighbour;
+
+            for( iNeighbour = i - 1; iNeighbour <= i + 1; iNeighbour += 2 )
+            {
+                if( iNeighbour < 0 || iNeighbour >= nXSize 
+                    || panLastLineVal[iNeighbour] != nValue )
+                    continue;
+
+                if( nId == -1 )
+                    nId = panLastLineId[iNeighbour];
+                else if( panPolyIdMap[panLastLineId[iNeighbour]]
+                         != panPolyIdMap[nId] )
+                    MergePolygon( panLastLineId[iNeighbour], nId );
+            }
         }
-        else if( i < nXSize-1 && nConnectedness == 8 
-                 && panLastLineVal[i+1] == panThisLineVal[i] )
+
+        if( nId == -1 )
+            nId = NewPolygon( nValue );
+
+        panThisLineId[i] = nId;
+    }
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                      GDALRasterPolygonLabeller                       */
+/* ==================================================================== */
+/************************************************************************/
+
+/************************************************************************/
+/*                     GDALRasterPolygonLabeller()                      */
+/************************************************************************/
+
+GDALRasterPolygonLabeller::GDALRasterPolygonLabeller( int nConnectedness )
+
+{
+    this->nConnectedness = nConnectedness;
+    CPLAssert( nConnectedness == 4 || nConnectedness == 8 );
+}
+
+/************************************************************************/
+/*                             NewPolygon()                             */
+/************************************************************************/
+
+int GDALRasterPolygonLabeller::NewPolygon( GInt32 nValue, int iLine )
+
+{
+    int nId;
+
+    if( !anFreeIds.empty() )
+    {
+        nId = anFreeIds.back();
+        anFreeIds.pop_back();
+    }
+    else
+    {
+        nId = (int) anParent.size();
+        anParent.push_back( 0 );
+        anRank.push_back( 0 );
+        anValue.push_back( 0 );
+        anLastLine.push_back( 0 );
+    }
+
+    anParent[nId] = nId;
+    anRank[nId] = 0;
+    anValue[nId] = nValue;
+    anLastLine[nId] = iLine;
+
+    return nId;
+}
+
+/************************************************************************/
+/*                                Find()                                */
+/*                                                                      */
+/*      The id of the polygon a (possibly merged) id belongs to.        */
+/************************************************************************/
+
+int GDALRasterPolygonLabeller::Find( int nId )
+
+{
+    while( anParent[nId] != nId )
+    {
+        anParent[nId] = anParent[anParent[nId]];
+        nId = anParent[nId];
+    }
+
+    return nId;
+}
+
+/************************************************************************/
+/*                               Union()                                */
+/************************************************************************/
+
+void GDALRasterPolygonLabeller::Union( int nId1, int nId2 )
+
+{
+    nId1 = Find( nId1 );
+    nId2 = Find( nId2 );
+
+    if( nId1 == nId2 )
+        return;
+
+    if( anRank[nId1] > anRank[nId2] )
+    {
+        int nTmp = nId1;
+        nId1 = nId2;
+        nId2 = nTmp;
+    }
+    else if( anRank[nId1] == anRank[nId2] )
+        anRank[nId2]++;
+
+    // nId1 is merged into nId2.
+    anParent[nId1] = nId2;
+    anLastLine[nId2] = MAX(anLastLine[nId1], anLastLine[nId2]);
+
+    anMerges.push_back( nId1 );
+    anMerges.push_back( nId2 );
+    anMergedIds.push_back( nId1 );
+}
+
+/************************************************************************/
+/*                              Release()                               */
+/*                                                                      */
+/*      Release the id of a closed polygon.  It won't be reused         */
+/*      before the next line.                                           */
+/************************************************************************/
+
+void GDALRasterPolygonLabeller::Release( int nId )
+
+{
+    anLastLine[nId] = INT_MAX;
+    anFreeIds.push_back( nId );
+}
+
+/************************************************************************/
+/*                            ProcessLine()                             */
+/************************************************************************/
+
+void GDALRasterPolygonLabeller::ProcessLine( 
+    GInt32 *panLastLineVal, GInt32 *panThisLineVal,
+    GInt32 *panLastLineId,  GInt32 *panThisLineId,
+    int nXSize, int iLine )
+
+{
+    int i, iNeighbour;
+
+/* -------------------------------------------------------------------- */
+/*      The ids merged on the last line are no longer referenced.       */
+/* -------------------------------------------------------------------- */
+    anFreeIds.insert( anFreeIds.end(), 
+                      anMergedIds.begin(), anMergedIds.end() );
+    anMergedIds.clear();
+    anMerges.clear();
+
+/* -------------------------------------------------------------------- */
+/*      Join each pixel to the polygons of its neighbours of the same   */
+/*      value on the left and on the last line.                         */
+/* -------------------------------------------------------------------- */
+    const int nLastNeighbours = (nConnectedness == 8) ? 1 : 0;
+
+    for( i = 0; i < nXSize; i++ )
+    {
+        const GInt32 nValue = panThisLineVal[i];
+        int          nId = -1;
+
+        if( i > 0 && panThisLineVal[i-1] == nValue )
+            nId = panThisLineId[i-1];
+
+        for( iNeighbour = i - nLastNeighbours; 
+             panLastLineVal != NULL && iNeighbour <= i + nLastNeighbours;
+             iNeighbour++ )
         {
-            panThisLineId[i] = panLastLineId[i+1];
+            if( iNeighbour < 0 || iNeighbour >= nXSize
+                || panLastLineVal[iNeighbour] != nValue )
+                continue;
+
+            if( nId == -1 )
+                nId = panLastLineId[iNeighbour];
+            else
+                Union( panLastLineId[iNeighbour], nId );
         }
-        else
-            panThisLineId[i] = 
-                NewPolygon( panThisLineVal[i] );
+
+        if( nId == -1 )
+            nId = NewPolygon( nValue, iLine );
+
+        panThisLineId[i] = nId;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Replace the ids by the final ones, which are on this line.      */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < nXSize; i++ )
+    {
+        panThisLineId[i] = Find( panThisLineId[i] );
+        anLastLine[panThisLineId[i]] = iLine;
     }
 }
 
@@ -0,0 +1,665 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL
+ * Purpose:  Terrain analysis of an elevation band (hillshade, slope, aspect,
+ *           TRI, TPI and roughness), by whole lines and on several threads.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************
+ *
+ * The formulas are the ones of the gdaldem utility:
+ *
+ * Slope and aspect calculations based on original method for GRASS GIS 4.1
+ * by Michael Shapiro, U.S.Army Construction Engineering Research Laboratory
+ *    Olga Waupotitsch, U.S.Army Construction Engineering Research Laboratory
+ *    Marjorie Larson, U.S.Army Construction Engineering Research Laboratory
+ * as found in GRASS's r.slope.aspect module.
+ *
+ * Horn's formula is used to find the first order derivatives in x and y
+ * directions for slope and aspect calculations: Horn, B. K. P. (1981).
+ * "Hill Shading and the Reflectance Map", Proceedings of the IEEE, 69(1):14-47.
+ *
+ * Shaded relief based on original method for GRASS GIS 4.1 by Jim Westervelt,
+ * U.S. Army Construction Engineering Research Laboratory
+ * as found in GRASS's r.shaded.relief (formerly shade.rel.sh) module.
+ *
+ * TRI, TPI and roughness follow Wilson et al. (2007), "Multiscale terrain
+ * analysis of multibeam bathymetry data for habitat mapping on the
+ * continental slope", Marine Geodesy, 30, 3-35.
+ ****************************************************************************/
+
+#include "gdal_alg.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_multiproc.h"
+
+CPL_CVSID("$Id$");
+
+#ifndef M_PI
+# define M_PI  3.1415926535897932384626433832795
+#endif
+
+/************************************************************************/
+/*                      GDALTerrainProcessLines()                       */
+/************************************************************************/
+
+/**
+ * Compute terrain products for a few lines of an elevation raster.
+ *
+ * Each output line is computed from the 3x3 windows centered on the
+ * pixels of the matching source line, using the source lines above and
+ * below it.  The first and last pixels of the lines, and the pixels
+ * whose window holds a source nodata value, are set to the nodata value
+ * of the product.
+ *
+ * The horizontal and vertical gradients of each line are computed once,
+ * and shared by the hillshade, slope and aspect products.  The lines are
+ * processed as a whole by simple loops, the nodata windows being masked
+ * afterwards, rather than pixel by pixel.
+ *
+ * @param psOptions the parameters of the products.
+ * @param nProducts the number of products to compute.
+ * @param paeProducts the list of the products to compute.
+ * @param nXSize the number of pixels of a line.
+ * @param nLines the number of lines to compute.
+ * @param papafSrcLines nLines + 2 consecutive source lines, the first
+ * one being above the first line to compute.
+ * @param bSrcHasNoData whether the source has a nodata value.
+ * @param fSrcNoDataValue the source nodata value.
+ * @param pafDstNoDataValues the nodata value of each product.
+ * @param papafDst for each product, a buffer of nLines lines of nXSize
+ * values where it is computed.
+ *
+ * @return CE_None on success or CE_Failure if the working buffers cannot
+ * be allocated.
+ */
+
+CPLErr GDALTerrainProcessLines( const GDALTerrainOptions *psOptions,
+                                int nProducts,
+                                const GDALTerrainProduct *paeProducts,
+                                int nXSize, int nLines,
+                                const float * const *papafSrcLines,
+                                int bSrcHasNoData, float fSrcNoDataValue,
+                                const float *pafDstNoDataValues,
+                                float **papafDst )
+
+{
+    int     iProduct, iLine, j;
+    int     bNeedGradient = FALSE;
+
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+    {
+        if( paeProducts[iProduct] == GTP_Hillshade
+            || paeProducts[iProduct] == GTP_Slope
+            || paeProducts[iProduct] == GTP_Aspect )
+            bNeedGradient = TRUE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Allocate the gradient and mask lines.                           */
+/* -------------------------------------------------------------------- */
+    float   *pafX = NULL, *pafY = NULL;
+    GByte   *pabyColValid = NULL, *pabyValid = NULL;
+    int      bOK = TRUE;
+
+    if( bNeedGradient )
+    {
+        pafX = (float *) VSIMalloc( sizeof(float) * nXSize );
+        pafY = (float *) VSIMalloc( sizeof(float) * nXSize );
+        bOK = pafX != NULL && pafY != NULL;
+    }
+    if( bSrcHasNoData )
+    {
+        pabyColValid = (GByte *) VSIMalloc( nXSize );
+        pabyValid = (GByte *) VSIMalloc( nXSize );
+        bOK = bOK && pabyColValid != NULL && pabyValid != NULL;
+    }
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate terrain analysis buffers." );
+        CPLFree( pafX );
+        CPLFree( pafY );
+        CPLFree( pabyColValid );
+        CPLFree( pabyValid );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Precompute the hillshade parameters.                            */
+/* -------------------------------------------------------------------- */
+    const double degreesToRadians = M_PI / 180.0;
+    const double radiansToDegrees = 180.0 / M_PI;
+    const double nsres = psOptions->dfNSRes;
+    const double ewres = psOptions->dfEWRes;
+    const double scale = psOptions->dfScale;
+    const double sin_altRadians =
+        sin(psOptions->dfAltitude * degreesToRadians);
+    const double azRadians = psOptions->dfAzimuth * degreesToRadians;
+    const double z_scale_factor = psOptions->dfZFactor / (8 * scale);
+    const double cos_altRadians_mul_z_scale_factor =
+        cos(psOptions->dfAltitude * degreesToRadians) * z_scale_factor;
+    const double square_z_scale_factor = z_scale_factor * z_scale_factor;
+
+    for( iLine = 0; iLine < nLines; iLine++ )
+    {
+        // Move a 3x3 window over each pixel of the line L2:
+        //
+        //      L1[j-1] L1[j] L1[j+1]
+        //      L2[j-1] L2[j] L2[j+1]
+        //      L3[j-1] L3[j] L3[j+1]
+        const float *L1 = papafSrcLines[iLine];
+        const float *L2 = papafSrcLines[iLine + 1];
+        const float *L3 = papafSrcLines[iLine + 2];
+
+/* -------------------------------------------------------------------- */
+/*      Mask of the windows free of nodata: first by column, then       */
+/*      over three columns.                                             */
+/* -------------------------------------------------------------------- */
+        if( bSrcHasNoData )
+        {
+            for( j = 0; j < nXSize; j++ )
+                pabyColValid[j] = (GByte) ( (L1[j] != fSrcNoDataValue)
+                                            & (L2[j] != fSrcNoDataValue)
+                                            & (L3[j] != fSrcNoDataValue) );
+
+            for( j = 1; j < nXSize - 1; j++ )
+                pabyValid[j] = pabyColValid[j-1] & pabyColValid[j]
+                             & pabyColValid[j+1];
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Horn's gradients, unscaled: west minus east, and south minus    */
+/*      north.                                                          */
+/* -------------------------------------------------------------------- */
+        if( bNeedGradient )
+        {
+            for( j = 1; j < nXSize - 1; j++ )
+            {
+                pafX[j] = (L1[j-1] + L2[j-1] + L2[j-1] + L3[j-1]) -
+                          (L1[j+1] + L2[j+1] + L2[j+1] + L3[j+1]);
+                pafY[j] = (L3[j-1] + L3[j] + L3[j] + L3[j+1]) -
+                          (L1[j-1] + L1[j] + L1[j] + L1[j+1]);
+            }
+        }
+
+        for( iProduct = 0; iProduct < nProducts; iProduct++ )
+        {
+            const float fDstNoDataValue = pafDstNoDataValues[iProduct];
+            float      *pafOut = papafDst[iProduct] + iLine * nXSize;
+
+            // Exclude the edges
+            pafOut[0] = fDstNoDataValue;
+            if( nXSize > 1 )
+                pafOut[nXSize - 1] = fDstNoDataValue;
+
+            switch( paeProducts[iProduct] )
+            {
+              case GTP_Hillshade:
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    const double x = pafX[j] / ewres;
+                    const double y = pafY[j] / nsres;
+                    const double xx_plus_yy = x * x + y * y;
+                    const double aspect = atan2(x,y);
+                    double cang;
+
+                    cang = (sin_altRadians -
+                            cos_altRadians_mul_z_scale_factor *
+                            sqrt(xx_plus_yy) * sin(aspect - azRadians)) /
+                           sqrt(1 + square_z_scale_factor * xx_plus_yy);
+
+                    if (cang <= 0.0)
+                        cang = 1.0;
+                    else
+                        cang = 1.0 + (254.0 * cang);
+
+                    pafOut[j] = (float) cang;
+                }
+                break;
+
+              case GTP_Slope:
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    const double dx = pafX[j] / ewres;
+                    const double dy = pafY[j] / nsres;
+                    const double key = dx * dx + dy * dy;
+
+                    if( psOptions->bSlopeInPercent )
+                        pafOut[j] = (float) (100*(sqrt(key) / (8*scale)));
+                    else
+                        pafOut[j] = (float)
+                            (atan(sqrt(key) / (8*scale)) * radiansToDegrees);
+                }
+                break;
+
+              case GTP_Aspect:
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    // East minus west, and south minus north.
+                    const double dx = -pafX[j];
+                    const double dy = pafY[j];
+                    float        aspect;
+
+                    aspect = atan2(dy,-dx) / degreesToRadians;
+
+                    if (dx == 0 && dy == 0)
+                    {
+                        /* Flat area */
+                        aspect = fDstNoDataValue;
+                    }
+                    else if ( !psOptions->bAspectTrigonometric )
+                    {
+                        if (aspect > 90.0)
+                            aspect = 450.0 - aspect;
+                        else
+                            aspect = 90.0 - aspect;
+                    }
+                    else
+                    {
+                        if (aspect < 0)
+                            aspect += 360.0;
+                    }
+
+                    if (aspect == 360.0)
+                        aspect = 0.0;
+
+                    pafOut[j] = aspect;
+                }
+                break;
+
+              case GTP_TRI:
+                // Terrain Ruggedness is average difference in height
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    pafOut[j] = (fabs(L1[j-1]-L2[j]) +
+                                 fabs(L1[j]-L2[j]) +
+                                 fabs(L1[j+1]-L2[j]) +
+                                 fabs(L2[j-1]-L2[j]) +
+                                 fabs(L2[j+1]-L2[j]) +
+                                 fabs(L3[j-1]-L2[j]) +
+                                 fabs(L3[j]-L2[j]) +
+                                 fabs(L3[j+1]-L2[j]))/8;
+                }
+                break;
+
+              case GTP_TPI:
+                // Terrain Position is the difference between the central
+                // cell and the mean of the surrounding cells
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    pafOut[j] = L2[j] -
+                        ((L1[j-1]+
+                          L1[j]+
+                          L1[j+1]+
+                          L2[j-1]+
+                          L2[j+1]+
+                          L3[j-1]+
+                          L3[j]+
+                          L3[j+1])/8);
+                }
+                break;
+
+              case GTP_Roughness:
+                // Roughness is the largest difference between any two cells
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    const float afWin[9] = { L1[j-1], L1[j], L1[j+1],
+                                             L2[j-1], L2[j], L2[j+1],
+                                             L3[j-1], L3[j], L3[j+1] };
+                    float fMin = afWin[0];
+                    float fMax = afWin[0];
+
+                    for( int k = 1; k < 9; k++ )
+                    {
+                        if( afWin[k] > fMax )
+                            fMax = afWin[k];
+                        if( afWin[k] < fMin )
+                            fMin = afWin[k];
+                    }
+                    pafOut[j] = fMax - fMin;
+                }
+                break;
+            }
+
+            if( bSrcHasNoData )
+            {
+                for( j = 1; j < nXSize - 1; j++ )
+                {
+                    if( !pabyValid[j] )
+                        pafOut[j] = fDstNoDataValue;
+                }
+            }
+        }
+    }
+
+    CPLFree( pafX );
+    CPLFree( pafY );
+    CPLFree( pabyColValid );
+    CPLFree( pabyValid );
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                       GDALTerrainStripJobMain()                      */
+/*                                                                      */
+/*      Compute a strip of the lines of a chunk.                        */
+/************************************************************************/
+
+typedef struct
+{
+    const GDALTerrainOptions *psOptions;
+    int                 nProducts;
+    const GDALTerrainProduct *paeProducts;
+    int                 nXSize;
+    int                 iFirstLine;
+    int                 nLines;
+    const float * const *papafSrcLines;
+    int                 bSrcHasNoData;
+    float               fSrcNoDataValue;
+    const float        *pafDstNoDataValues;
+    float             **papafChunk;
+    float             **papafDst;
+    CPLErr              eErr;
+} GDALTerrainStripJob;
+
+static void GDALTerrainStripJobMain( void *pData )
+
+{
+    GDALTerrainStripJob *psJob = (GDALTerrainStripJob *) pData;
+    int iProduct;
+
+    for( iProduct = 0; iProduct < psJob->nProducts; iProduct++ )
+        psJob->papafDst[iProduct] = psJob->papafChunk[iProduct]
+            + psJob->iFirstLine * psJob->nXSize;
+
+    psJob->eErr =
+        GDALTerrainProcessLines( psJob->psOptions,
+                                 psJob->nProducts, psJob->paeProducts,
+                                 psJob->nXSize, psJob->nLines,
+                                 psJob->papafSrcLines + psJob->iFirstLine,
+                                 psJob->bSrcHasNoData,
+                                 psJob->fSrcNoDataValue,
+                                 psJob->pafDstNoDataValues,
+                                 psJob->papafDst );
+}
+
+/************************************************************************/
+/*                       GDALTerrainProcessing()                        */
+/************************************************************************/
+
+/**
+ * Compute terrain products of an elevation band.
+ *
+ * Computes one or more of the hillshade, slope, aspect, TRI, TPI and
+ * roughness of the source band, as the gdaldem utility does, in a single
+ * pass over the source.  The first and last lines and columns of the
+ * products, and the pixels next to a source nodata pixel, are set to the
+ * nodata value of the destination band, or 0 if it has none.  A flat
+ * pixel has the nodata value as aspect.
+ *
+ * The source is read by chunks of lines.  The lines of each chunk are
+ * split in strips computed on separate threads by
+ * GDALTerrainProcessLines(), and the chunk is then written to the
+ * destination bands.
+ *
+ * The following options are supported:
+ * <dl>
+ * <dt>"NUM_THREADS":</dt> <dd>The number of threads, or ALL_CPUS, computing
+ * the strips of each chunk.  Defaults to the GDAL_NUM_THREADS configuration
+ * option, or 1.</dd>
+ * </dl>
+ *
+ * @param hSrcBand the elevation band.
+ * @param psOptions the parameters of the products.
+ * @param nProducts the number of products to compute.
+ * @param paeProducts the list of the products to compute.
+ * @param pahDstBands the band where each product is written, of the same
+ * size as the source band.
+ * @param papszOptions a list of NAME=VALUE options, or NULL.
+ * @param pfnProgress the progress function to report completion.
+ * @param pProgressArg callback data for progress function.
+ *
+ * @return CE_None on success or CE_Failure on error.
+ */
+
+CPLErr GDALTerrainProcessing( GDALRasterBandH hSrcBand,
+                              const GDALTerrainOptions *psOptions,
+                              int nProducts,
+                              const GDALTerrainProduct *paeProducts,
+                              GDALRasterBandH *pahDstBands,
+                              char **papszOptions,
+                              GDALProgressFunc pfnProgress,
+                              void *pProgressArg )
+
+{
+    VALIDATE_POINTER1( hSrcBand, "GDALTerrainProcessing", CE_Failure );
+    VALIDATE_POINTER1( psOptions, "GDALTerrainProcessing", CE_Failure );
+
+    const int nXSize = GDALGetRasterBandXSize(hSrcBand);
+    const int nYSize = GDALGetRasterBandYSize(hSrcBand);
+    int       iProduct, i;
+
+    if( pfnProgress == NULL )
+        pfnProgress = GDALDummyProgress;
+
+    if( nProducts < 1 )
+    {
+        CPLError( CE_Failure, CPLE_IllegalArg, "No terrain product given." );
+        return CE_Failure;
+    }
+
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+    {
+        if( GDALGetRasterBandXSize(pahDstBands[iProduct]) != nXSize
+            || GDALGetRasterBandYSize(pahDstBands[iProduct]) != nYSize )
+        {
+            CPLError( CE_Failure, CPLE_IllegalArg,
+                      "Destination band %d is not the size of the source.",
+                      iProduct + 1 );
+            return CE_Failure;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Initialize progress counter.                                    */
+/* -------------------------------------------------------------------- */
+    if( !pfnProgress( 0.0, NULL, pProgressArg ) )
+    {
+        CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+        return CE_Failure;
+    }
+
+    int    bSrcHasNoData;
+    float  fSrcNoDataValue = (float)
+        GDALGetRasterNoDataValue(hSrcBand, &bSrcHasNoData);
+    float *pafDstNoDataValues =
+        (float *) CPLMalloc( sizeof(float) * nProducts );
+
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+    {
+        int bDstHasNoData;
+
+        pafDstNoDataValues[iProduct] = (float)
+            GDALGetRasterNoDataValue(pahDstBands[iProduct], &bDstHasNoData);
+        if( !bDstHasNoData )
+            pafDstNoDataValues[iProduct] = 0.0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Chunks of output lines hold about a million pixels, and the     */
+/*      source buffer the line above and below them.                    */
+/* -------------------------------------------------------------------- */
+    const int nThreads =
+        CPLGetNumThreads( CSLFetchNameValue( papszOptions, "NUM_THREADS" ) );
+    int       nChunkLines = MAX(1, 1048576 / MAX(nXSize, 1));
+
+    nChunkLines = MAX(nChunkLines, nThreads);
+    nChunkLines = MIN(nChunkLines, MAX(nYSize - 2, 1));
+
+    float  *pafSrc = (float *)
+        VSIMalloc( sizeof(float) * nXSize * (size_t)(nChunkLines + 2) );
+    float **papafChunk = (float **) CPLCalloc( sizeof(float*), nProducts );
+    int     bOK = pafSrc != NULL;
+
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+    {
+        papafChunk[iProduct] = (float *)
+            VSIMalloc( sizeof(float) * nXSize * (size_t)nChunkLines );
+        bOK = bOK && papafChunk[iProduct] != NULL;
+    }
+
+    const float **papafSrcLines =
+        (const float **) CPLMalloc( sizeof(float*) * (nChunkLines + 2) );
+
+    for( i = 0; bOK && i < nChunkLines + 2; i++ )
+        papafSrcLines[i] = pafSrc + i * (size_t)nXSize;
+
+/* -------------------------------------------------------------------- */
+/*      Prepare the strip jobs.                                         */
+/* -------------------------------------------------------------------- */
+    const int nJobs = MIN(nThreads, nChunkLines);
+    GDALTerrainStripJob *pasJobs = (GDALTerrainStripJob *)
+        CPLCalloc( sizeof(GDALTerrainStripJob), nJobs );
+    void  **papJobs = (void **) CPLCalloc( sizeof(void*), nJobs );
+    int     iJob;
+
+    for( iJob = 0; iJob < nJobs; iJob++ )
+    {
+        pasJobs[iJob].psOptions = psOptions;
+        pasJobs[iJob].nProducts = nProducts;
+        pasJobs[iJob].paeProducts = paeProducts;
+        pasJobs[iJob].nXSize = nXSize;
+        pasJobs[iJob].papafSrcLines = papafSrcLines;
+        pasJobs[iJob].bSrcHasNoData = bSrcHasNoData;
+        pasJobs[iJob].fSrcNoDataValue = fSrcNoDataValue;
+        pasJobs[iJob].pafDstNoDataValues = pafDstNoDataValues;
+        pasJobs[iJob].papafChunk = papafChunk;
+        pasJobs[iJob].papafDst =
+            (float **) CPLCalloc( sizeof(float*), nProducts );
+        papJobs[iJob] = pasJobs + iJob;
+    }
+
+    CPLErr eErr = CE_None;
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate terrain analysis buffers." );
+        eErr = CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Exclude the first and last lines.                               */
+/* -------------------------------------------------------------------- */
+    for( iProduct = 0; eErr == CE_None && iProduct < nProducts; iProduct++ )
+    {
+        float *pafLine = papafChunk[iProduct];
+
+        for( i = 0; i < nXSize; i++ )
+            pafLine[i] = pafDstNoDataValues[iProduct];
+
+        eErr = GDALRasterIO( pahDstBands[iProduct], GF_Write,
+                             0, 0, nXSize, 1,
+                             pafLine, nXSize, 1, GDT_Float32, 0, 0 );
+        if( eErr == CE_None && nYSize > 1 )
+            eErr = GDALRasterIO( pahDstBands[iProduct], GF_Write,
+                                 0, nYSize - 1, nXSize, 1,
+                                 pafLine, nXSize, 1, GDT_Float32, 0, 0 );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Process the inner lines by chunks.                              */
+/* -------------------------------------------------------------------- */
+    int nYOff;
+
+    for( nYOff = 1; eErr == CE_None && nYOff < nYSize - 1;
+         nYOff += nChunkLines )
+    {
+        const int nLines = MIN(nChunkLines, nYSize - 1 - nYOff);
+
+        eErr = GDALRasterIO( hSrcBand, GF_Read,
+                             0, nYOff - 1, nXSize, nLines + 2,
+                             pafSrc, nXSize, nLines + 2, GDT_Float32, 0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        // Share the lines evenly between the jobs.
+        const int nStripJobs = MIN(nJobs, nLines);
+
+        for( iJob = 0; iJob < nStripJobs; iJob++ )
+        {
+            pasJobs[iJob].iFirstLine = (int)
+                (((GIntBig) nLines * iJob) / nStripJobs);
+            pasJobs[iJob].nLines = (int)
+                (((GIntBig) nLines * (iJob + 1)) / nStripJobs)
+                - pasJobs[iJob].iFirstLine;
+        }
+
+        CPLRunJobs( nStripJobs, papJobs, GDALTerrainStripJobMain, nThreads );
+
+        for( iJob = 0; iJob < nStripJobs; iJob++ )
+        {
+            if( pasJobs[iJob].eErr != CE_None )
+                eErr = CE_Failure;
+        }
+
+        for( iProduct = 0; eErr == CE_None && iProduct < nProducts;
+             iProduct++ )
+        {
+            eErr = GDALRasterIO( pahDstBands[iProduct], GF_Write,
+                                 0, nYOff, nXSize, nLines,
+                                 papafChunk[iProduct], nXSize, nLines,
+                                 GDT_Float32, 0, 0 );
+        }
+
+        if( eErr == CE_None
+            && !pfnProgress( 1.0 * (nYOff + nLines) / nYSize, NULL,
+                             pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+    if( eErr == CE_None )
+        pfnProgress( 1.0, NULL, pProgressArg );
+
+/* -------------------------------------------------------------------- */
+/*      Cleanup.                                                        */
+/* -------------------------------------------------------------------- */
+    for( iJob = 0; iJob < nJobs; iJob++ )
+        CPLFree( pasJobs[iJob].papafDst );
+    CPLFree( pasJobs );
+    CPLFree( papJobs );
+
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+        VSIFree( papafChunk[iProduct] );
+    CPLFree( papafChunk );
+    CPLFree( papafSrcLines );
+    VSIFree( pafSrc );
+    CPLFree( pafDstNoDataValues );
+
+    return eErr;
+}
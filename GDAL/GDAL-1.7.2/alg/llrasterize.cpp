@@ -30,11 +30,6 @@
 #include "gdal_alg.h"
 #include "gdal_alg_priv.h"
 
-static int llCompareInt(const void *a, const void *b)
-{
-	return (*(const int *)a) - (*(const int *)b);
-}
-
 static void llSwapDouble(double *a, double *b)
 {
 	double temp = *a;
@@ -42,6 +37,43 @@ static void llSwapDouble(double *a, double *b)
 	*b = temp;
 }
 
+/************************************************************************/
+/*                              llEdge                                  */
+/*                                                                      */
+/*      A non horizontal polygon edge, from its lower end (dfY1) to     */
+/*      its upper end (dfY2), with the crossing of the current          */
+/*      scanline when it is in the active edge table.                   */
+/************************************************************************/
+
+typedef struct
+{
+    double  dfX1, dfY1;
+    double  dfX2, dfY2;
+    int     nX;
+} llEdge;
+
+typedef struct
+{
+    double  dfY;
+    int     nX1, nX2;
+} llHorizontalEdge;
+
+static int llCompareEdgeY1( const void *a, const void *b )
+{
+    double dfY1 = ((const llEdge *) a)->dfY1;
+    double dfY2 = ((const llEdge *) b)->dfY1;
+
+    return (dfY1 < dfY2) ? -1 : (dfY1 > dfY2) ? 1 : 0;
+}
+
+static int llCompareHorizontalEdgeY( const void *a, const void *b )
+{
+    double dfY1 = ((const llHorizontalEdge *) a)->dfY;
+    double dfY2 = ((const llHorizontalEdge *) b)->dfY;
+
+    return (dfY1 < dfY2) ? -1 : (dfY1 > dfY2) ? 1 : 0;
+}
+
 /************************************************************************/
 /*                       dllImageFilledPolygon()                        */
 /*                                                                      */
@@ -100,18 +132,16 @@ No known bug
     int y;
     int miny, maxy,minx,maxx;
     double dminy, dmaxy;
-    double dx1, dy1;
-    double dx2, dy2;
     double dy;
     double intersect;
     
 
     int ind1, ind2;
-    int ints, n, part;
-    int *polyInts, polyAllocated;
+    int n, part;
 
-  
-    int horizontal_x1, horizontal_x2;
+    llEdge *pasEdges, **papsActive;
+    llHorizontalEdge *pasHorizontal;
+    int nEdges, nHorizontal, nAllLines, nActive, iNextEdge, iNextHorizontal;
 
 
     if (!nPartCount) {
@@ -122,9 +152,6 @@ No known bug
     for( part = 0; part < nPartCount; part++ )
         n += panPartSize[part];
     
-    polyInts = (int *) malloc(sizeof(int) * n);
-    polyAllocated = n;
-    
     dminy = padfY[0];
     dmaxy = padfY[0];
     for (i=1; (i < n); i++) {
@@ -149,22 +176,34 @@ No known bug
     minx = 0;
     maxx = nRasterXSize - 1;
 
-    /* Fix in 1.3: count a vertex only once */
-    for (y=miny; y <= maxy; y++) {
-        int	partoffset = 0;
+    if( miny > maxy )
+        return;
 
-        dy = y +0.5; /* center height of line*/
-         
+/* -------------------------------------------------------------------- */
+/*      Build the edge table once, instead of looking at every edge     */
+/*      of the polygon for every line.  Edges are ordered by their      */
+/*      lower end, and each is active for the line centers in           */
+/*      [dfY1,dfY2[.  Horizontal edges only fill themselves, on the     */
+/*      line whose center they lie on, and only the bottom ones         */
+/*      (first point on the right), the top ones being filled by the    */
+/*      regular spans.  An edge with a NaN end is considered            */
+/*      horizontal on all lines, as the per line test used to do, and   */
+/*      is kept at the end of the horizontal edge list.                 */
+/* -------------------------------------------------------------------- */
+    pasEdges = (llEdge *) malloc(sizeof(llEdge) * n);
+    papsActive = (llEdge **) malloc(sizeof(llEdge *) * n);
+    pasHorizontal = (llHorizontalEdge *) malloc(sizeof(llHorizontalEdge) * n);
+    nEdges = 0;
+    nHorizontal = 0;
+    nAllLines = 0;
 
-        part = 0;
-        ints = 0;
+    {
+        int	partoffset = 0;
 
-        /*Initialize polyInts, otherwise it can sometimes causes a seg fault */
-        memset(polyInts, -1, sizeof(int) * n);
+        part = 0;
 
         for (i=0; (i < n); i++) {
-        
-            
+
             if( i == partoffset + panPartSize[part] ) {
                 partoffset += panPartSize[part];
                 part++;
@@ -177,75 +216,119 @@ No known bug
                 ind1 = i-1;
                 ind2 = i;
             }
-	    
 
-            dy1 = padfY[ind1];
-            dy2 = padfY[ind2];
-            
+            if (padfY[ind1] < padfY[ind2]) {
+                llEdge *psEdge = pasEdges + nEdges++;
+
+                psEdge->dfX1 = padfX[ind1];
+                psEdge->dfY1 = padfY[ind1];
+                psEdge->dfX2 = padfX[ind2];
+                psEdge->dfY2 = padfY[ind2];
+            } else if (padfY[ind1] > padfY[ind2]) {
+                llEdge *psEdge = pasEdges + nEdges++;
+
+                psEdge->dfX1 = padfX[ind2];
+                psEdge->dfY1 = padfY[ind2];
+                psEdge->dfX2 = padfX[ind1];
+                psEdge->dfY2 = padfY[ind1];
+            } else if (padfX[ind1] > padfX[ind2]) {
+                llHorizontalEdge *psEdge;
+
+                if( CPLIsNan(padfY[ind1]) || CPLIsNan(padfY[ind2]) )
+                    psEdge = pasHorizontal + n - 1 - nAllLines;
+                else
+                    psEdge = pasHorizontal + nHorizontal;
+
+                psEdge->nX1 = (int) floor(padfX[ind2]+0.5);
+                psEdge->nX2 = (int) floor(padfX[ind1]+0.5);
+                psEdge->dfY = padfY[ind1];
+
+                if ( (psEdge->nX1 >  maxx) ||  (psEdge->nX2 <= minx) )
+                    continue;
+
+                if( CPLIsNan(padfY[ind1]) || CPLIsNan(padfY[ind2]) )
+                    nAllLines++;
+                else
+                    nHorizontal++;
+            }
+        }
+    }
 
-            if( (dy1 < dy && dy2 < dy) || (dy1 > dy && dy2 > dy) )
+    qsort( pasEdges, nEdges, sizeof(llEdge), llCompareEdgeY1 );
+    qsort( pasHorizontal, nHorizontal, sizeof(llHorizontalEdge), 
+           llCompareHorizontalEdgeY );
+
+    nActive = 0;
+    iNextEdge = 0;
+    iNextHorizontal = 0;
+
+    /* Fix in 1.3: count a vertex only once */
+    for (y=miny; y <= maxy; y++) {
+        int j, k;
+
+        dy = y +0.5; /* center height of line*/
+
+/* -------------------------------------------------------------------- */
+/*      Fill the horizontal edges of this line.                         */
+/* -------------------------------------------------------------------- */
+        while( iNextHorizontal < nHorizontal 
+               && pasHorizontal[iNextHorizontal].dfY < dy )
+            iNextHorizontal++;
+
+        for( j = iNextHorizontal; 
+             j < nHorizontal && pasHorizontal[j].dfY == dy; j++ )
+            pfnScanlineFunc( pCBData, y, pasHorizontal[j].nX1, pasHorizontal[j].nX2 - 1, (dfVariant == NULL)?0:dfVariant[0] );
+
+        for( j = n - nAllLines; j < n; j++ )
+            pfnScanlineFunc( pCBData, y, pasHorizontal[j].nX1, pasHorizontal[j].nX2 - 1, (dfVariant == NULL)?0:dfVariant[0] );
+
+/* -------------------------------------------------------------------- */
+/*      Update the active edges, and their crossings with the line      */
+/*      center.  They are kept in the order of their crossings with     */
+/*      the previous line, which changes little from line to line,      */
+/*      so an insertion sort is cheap.                                  */
+/* -------------------------------------------------------------------- */
+        while( iNextEdge < nEdges && pasEdges[iNextEdge].dfY1 <= dy )
+            papsActive[nActive++] = pasEdges + iNextEdge++;
+
+        for( j = 0, k = 0; j < nActive; j++ )
+        {
+            llEdge *psEdge = papsActive[j];
+
+            if( !(dy < psEdge->dfY2) )
                 continue;
 
-            if (dy1 < dy2) {
-                dx1 = padfX[ind1];
-                dx2 = padfX[ind2];
-            } else if (dy1 > dy2) {
-                dy2 = padfY[ind1];
-                dy1 = padfY[ind2];
-                dx2 = padfX[ind1];
-                dx1 = padfX[ind2];
-            } else /* if (fabs(dy1-dy2)< 1.e-6) */
-	    {
-                
-                /*AE: DO NOT skip bottom horizontal segments 
-		  -Fill them separately- 
-		  They are not taken into account twice.*/
-		if (padfX[ind1] > padfX[ind2])
-		{
-		    horizontal_x1 = (int) floor(padfX[ind2]+0.5);
-		    horizontal_x2 = (int) floor(padfX[ind1]+0.5);
-		
-                    if  ( (horizontal_x1 >  maxx) ||  (horizontal_x2 <= minx) )
-                        continue;
-
-		    /*fill the horizontal segment (separately from the rest)*/
-		    pfnScanlineFunc( pCBData, y, horizontal_x1, horizontal_x2 - 1, (dfVariant == NULL)?0:dfVariant[0] );
-		    continue;
-		}
-		else /*skip top horizontal segments (they are already filled in the regular loop)*/
-		    continue;
-
-	    }
-
-            if(( dy < dy2 ) && (dy >= dy1))
-            {
-                
-                intersect = (dy-dy1) * (dx2-dx1) / (dy2-dy1) + dx1;
+            intersect = (dy-psEdge->dfY1) * (psEdge->dfX2-psEdge->dfX1) 
+                / (psEdge->dfY2-psEdge->dfY1) + psEdge->dfX1;
+            psEdge->nX = (int) floor(intersect+0.5);
 
-		polyInts[ints++] = (int) floor(intersect+0.5);
-	    }
-	}
+            papsActive[k++] = psEdge;
+        }
+        nActive = k;
 
-        /* 
-         * It would be more efficient to do this inline, to avoid 
-         * a function call for each comparison.
-	 * NOTE - mloskot: make llCompareInt a functor and use std
-	 * algorithm and it will be optimized and expanded
-	 * automatically in compile-time, with modularity preserved.
-         */
-        qsort(polyInts, ints, sizeof(int), llCompareInt);
+        for( j = 1; j < nActive; j++ )
+        {
+            llEdge *psEdge = papsActive[j];
 
+            for( k = j; k > 0 && papsActive[k-1]->nX > psEdge->nX; k-- )
+                papsActive[k] = papsActive[k-1];
+            papsActive[k] = psEdge;
+        }
 
-        for (i=0; (i < (ints)); i+=2)
+        for (i=0; (i+1 < nActive); i+=2)
         {
-            if( polyInts[i] <= maxx && polyInts[i+1] > minx )
+            int nX1 = papsActive[i]->nX, nX2 = papsActive[i+1]->nX;
+
+            if( nX1 <= maxx && nX2 > minx )
             {
-                pfnScanlineFunc( pCBData, y, polyInts[i], polyInts[i+1] - 1, (dfVariant == NULL)?0:dfVariant[0] );
+                pfnScanlineFunc( pCBData, y, nX1, nX2 - 1, (dfVariant == NULL)?0:dfVariant[0] );
             }
         }
     }
 
-    free( polyInts );
+    free( pasEdges );
+    free( papsActive );
+    free( pasHorizontal );
 }
 
 /************************************************************************/
@@ -29,6 +29,7 @@
 #include "gdal_alg_priv.h"
 #include "cpl_conv.h"
 #include <vector>
+#include <algorithm>
 
 CPL_CVSID("$Id: polygonize.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -39,24 +40,26 @@ CPL_CVSID("$Id: polygonize.cpp 1 2011-07-16 23:22:47Z dcollins $");
 /*                               RPolygon                               */
 /*									*/
 /*      This is a helper class to hold polygons while they are being    */
-/*      formed in memory, and to provide services to coalesce a much    */
-/*      of edge sections into complete rings.                           */
+/*      formed in memory, and to provide services to assemble the       */
+/*      pixel edges into complete rings.                                */
 /* ==================================================================== */
 /************************************************************************/
 
 class RPolygon {
 public:
-    RPolygon( int nValue ) { nPolyValue = nValue; nLastLineUpdated = -1; }
+    RPolygon( int nValue ) { nPolyValue = nValue; }
 
     int              nPolyValue;
-    int              nLastLineUpdated;
+
+    // Directed edges as x1,y1,x2,y2 quadruplets, with the polygon on 
+    // their right side in pixel/line coordinates.
+    std::vector<int> anEdges;
 
     std::vector< std::vector<int> > aanXY;
 
-    void             AddSegment( int x1, int y1, int x2, int y2 );
+    int              AddEdge( int x1, int y1, int x2, int y2 );
     void             Dump();
-    void             Coalesce();
-    void             Merge( int iBaseString, int iSrcString, int iDirection );
+    void             BuildRings();
 };
 
 /************************************************************************/
@@ -66,8 +69,8 @@ void RPolygon::Dump()
 {
     size_t iString;
 
-    printf( "RPolygon: Value=%d, LastLineUpdated=%d\n",
-            nPolyValue, nLastLineUpdated );
+    printf( "RPolygon: Value=%d, %d edges\n",
+            nPolyValue, (int) anEdges.size() / 4 );
     
     for( iString = 0; iString < aanXY.size(); iString++ )
     {
@@ -83,173 +86,144 @@ void RPolygon::Dump()
 }
 
 /************************************************************************/
-/*                              Coalesce()                              */
+/*                              AddEdge()                               */
+/*                                                                      */
+/*      Append an edge, returning its index.                            */
 /************************************************************************/
 
-void RPolygon::Coalesce()
+int RPolygon::AddEdge( int x1, int y1, int x2, int y2 )
 
 {
-    size_t iBaseString;
-
-/* -------------------------------------------------------------------- */
-/*      Iterate over loops starting from the first, trying to merge     */
-/*      other segments into them.                                       */
-/* -------------------------------------------------------------------- */
-    for( iBaseString = 0; iBaseString < aanXY.size(); iBaseString++ )
-    {
-        std::vector<int> &anBase = aanXY[iBaseString];
-        int bMergeHappened = TRUE;
+    int iEdge = (int) anEdges.size() / 4;
 
-/* -------------------------------------------------------------------- */
-/*      Keep trying to merge the following strings into our target      */
-/*      "base" string till we have tried them all once without any      */
-/*      mergers.                                                        */
-/* -------------------------------------------------------------------- */
-        while( bMergeHappened )
-        {
-            size_t iString;
-
-            bMergeHappened = FALSE;
-
-/* -------------------------------------------------------------------- */
-/*      Loop over the following strings, trying to find one we can      */
-/*      merge onto the end of our base string.                          */
-/* -------------------------------------------------------------------- */
-            for( iString = iBaseString+1; 
-                 iString < aanXY.size(); 
-                 iString++ )
-            {
-                std::vector<int> &anString = aanXY[iString];
-
-                if( anBase[anBase.size()-2] == anString[0]
-                    && anBase[anBase.size()-1] == anString[1] )
-                {
-                    Merge( iBaseString, iString, 1 );
-                    bMergeHappened = TRUE;
-                }
-                else if( anBase[anBase.size()-2] == anString[anString.size()-2]
-                         && anBase[anBase.size()-1] == anString[anString.size()-1] )
-                {
-                    Merge( iBaseString, iString, -1 );
-                    bMergeHappened = TRUE;
-                }
-            }
-        }
-
-        /* At this point our loop *should* be closed! */
-
-        CPLAssert( anBase[0] == anBase[anBase.size()-2]
-                   && anBase[1] == anBase[anBase.size()-1] );
-    }
+    anEdges.push_back( x1 );
+    anEdges.push_back( y1 );
+    anEdges.push_back( x2 );
+    anEdges.push_back( y2 );
 
+    return iEdge;
 }
 
 /************************************************************************/
-/*                               Merge()                                */
+/*                             BuildRings()                             */
+/*                                                                      */
+/*      Chain the edges into rings.  The edges are sorted by start      */
+/*      vertex, so that the edge following another is found by a       */
+/*      binary search, and the whole is O(n log n) in the number of     */
+/*      edges.                                                          */
+/*                                                                      */
+/*      Where the polygon touches itself at a vertex, two edges leave   */
+/*      it, and we take the leftmost turn, so that the ring keeps on    */
+/*      following the same neighbouring region.  This separates the     */
+/*      outer ring from the holes touching it.  The ring starting at    */
+/*      the top left vertex is the outer ring, and comes first.         */
 /************************************************************************/
 
-void RPolygon::Merge( int iBaseString, int iSrcString, int iDirection )
+void RPolygon::BuildRings()
 
 {
-    std::vector<int> &anBase = aanXY[iBaseString];
-    std::vector<int> &anString = aanXY[iSrcString];
-    int iStart, iEnd, i;
+    typedef std::pair<GIntBig,int> StartVertex;
 
-    if( iDirection == 1 )
-    {
-        iStart = 1;
-        iEnd = anString.size() / 2; 
-    }
-    else
-    {
-        iStart = anString.size() / 2 - 2;
-        iEnd = -1; 
-    }
-    
-    for( i = iStart; i != iEnd; i += iDirection )
-    {
-        anBase.push_back( anString[i*2+0] );
-        anBase.push_back( anString[i*2+1] );
-    }
-    
-    if( iSrcString < ((int) aanXY.size())-1 )
-        aanXY[iSrcString] = aanXY[aanXY.size()-1];
+    int nEdges = (int) anEdges.size() / 4;
+    int iEdge;
+    std::vector<StartVertex> aoStarts( nEdges );
+    std::vector<char> abUsed( nEdges, FALSE );
 
-    size_t nSize = aanXY.size(); 
-    aanXY.resize(nSize-1);
-}
+#define VERTEX_KEY(x,y) ((((GIntBig) (y)) << 32) | (GIntBig) (x))
 
-/************************************************************************/
-/*                             AddSegment()                             */
-/************************************************************************/
+    for( iEdge = 0; iEdge < nEdges; iEdge++ )
+        aoStarts[iEdge] = StartVertex( VERTEX_KEY( anEdges[iEdge*4],
+                                                   anEdges[iEdge*4+1] ),
+                                       iEdge );
 
-void RPolygon::AddSegment( int x1, int y1, int x2, int y2 )
+    std::sort( aoStarts.begin(), aoStarts.end() );
 
-{
-    nLastLineUpdated = MAX(y1, y2);
+    aanXY.clear();
+
+    for( int iFirst = 0; iFirst < nEdges; iFirst++ )
+    {
+        int iStart = aoStarts[iFirst].second;
+
+        if( abUsed[iStart] )
+            continue;
 
 /* -------------------------------------------------------------------- */
-/*      Is there an existing string ending with this?                   */
+/*      Follow the edges from this one till we are back to it, only     */
+/*      keeping the vertices where the direction changes.               */
 /* -------------------------------------------------------------------- */
-    size_t iString;
+        aanXY.resize( aanXY.size() + 1 );
+        std::vector<int> &anRing = aanXY[aanXY.size()-1];
+        const int *panEdge = &(anEdges[iStart*4]);
 
-    for( iString = 0; iString < aanXY.size(); iString++ )
-    {
-        std::vector<int> &anString = aanXY[iString];
-        size_t nSSize = anString.size();
-        
-        if( anString[nSSize-2] == x1 
-            && anString[nSSize-1] == y1 )
+        anRing.push_back( panEdge[0] );
+        anRing.push_back( panEdge[1] );
+        abUsed[iStart] = TRUE;
+
+        int nX = panEdge[2], nY = panEdge[3];
+        int nDX = (panEdge[2] > panEdge[0]) - (panEdge[2] < panEdge[0]);
+        int nDY = (panEdge[3] > panEdge[1]) - (panEdge[3] < panEdge[1]);
+
+        for( ;; )
         {
-            int nTemp;
+            std::vector<StartVertex>::iterator oIter =
+                std::lower_bound( aoStarts.begin(), aoStarts.end(),
+                                  StartVertex( VERTEX_KEY(nX,nY), -1 ) );
+            int iBest = -1, nBestCross = 2, nBestDX = 0, nBestDY = 0;
 
-            nTemp = x2;
-            x2 = x1;
-            x1 = nTemp;
+            for( ; oIter != aoStarts.end() 
+                     && oIter->first == VERTEX_KEY(nX,nY); ++oIter )
+            {
+                iEdge = oIter->second;
+                if( abUsed[iEdge] && iEdge != iStart )
+                    continue;
 
-            nTemp = y2;
-            y2 = y1;
-            y1 = nTemp;
-        }
+                panEdge = &(anEdges[iEdge*4]);
 
-        if( anString[nSSize-2] == x2 
-            && anString[nSSize-1] == y2 )
-        {
-            // We are going to add a segment, but should we just extend 
-            // an existing segment already going in the right direction?
+                int nEX = (panEdge[2] > panEdge[0]) - (panEdge[2] < panEdge[0]);
+                int nEY = (panEdge[3] > panEdge[1]) - (panEdge[3] < panEdge[1]);
+                int nCross = nDX * nEY - nDY * nEX;
 
-            int nLastLen = MAX(ABS(anString[nSSize-4]-anString[nSSize-2]),
-                               ABS(anString[nSSize-3]-anString[nSSize-1]));
-            
-            if( nSSize >= 4 
-                && (anString[nSSize-4] - anString[nSSize-2]
-                    == (anString[nSSize-2] - x1)*nLastLen)
-                && (anString[nSSize-3] - anString[nSSize-1]
-                    == (anString[nSSize-1] - y1)*nLastLen) )
+                if( nCross < nBestCross )
+                {
+                    iBest = iEdge;
+                    nBestCross = nCross;
+                    nBestDX = nEX;
+                    nBestDY = nEY;
+                }
+            }
+
+            if( iBest == -1 )
             {
-                anString.pop_back();
-                anString.pop_back();
+                CPLError( CE_Warning, CPLE_AppDefined,
+                          "Unclosed ring at (%d,%d) in RPolygon::BuildRings().",
+                          nX, nY );
+                break;
             }
 
-            anString.push_back( x1 );
-            anString.push_back( y1 );
-            return;
+            if( iBest == iStart )
+                break;
+
+            if( nBestDX != nDX || nBestDY != nDY )
+            {
+                anRing.push_back( nX );
+                anRing.push_back( nY );
+            }
+
+            abUsed[iBest] = TRUE;
+            panEdge = &(anEdges[iBest*4]);
+            nX = panEdge[2];
+            nY = panEdge[3];
+            nDX = nBestDX;
+            nDY = nBestDY;
         }
-    }
 
-/* -------------------------------------------------------------------- */
-/*      Create a new string.                                            */
-/* -------------------------------------------------------------------- */
-    size_t nSize = aanXY.size();
-    aanXY.resize(nSize + 1);
-    std::vector<int> &anString = aanXY[nSize];
+        anRing.push_back( anRing[0] );
+        anRing.push_back( anRing[1] );
+    }
 
-    anString.push_back( x1 );
-    anString.push_back( y1 );
-    anString.push_back( x2 );
-    anString.push_back( y2 );
+#undef VERTEX_KEY
 
-    return;
+    std::vector<int>().swap( anEdges );
 }
 
 /************************************************************************/
@@ -259,67 +233,89 @@ void RPolygon::AddSegment( int x1, int y1, int x2, int y2 )
 /************************************************************************/
 
 /************************************************************************/
-/*                              AddEdges()                              */
+/*                            GetRPolygon()                             */
+/************************************************************************/
+
+static RPolygon *GetRPolygon( std::vector<RPolygon*> &apoPoly,
+                              GDALRasterPolygonLabeller &oLabeller, int nId )
+
+{
+    if( apoPoly[nId] == NULL )
+        apoPoly[nId] = new RPolygon( oLabeller.GetValue( nId ) );
+
+    return apoPoly[nId];
+}
+
+/************************************************************************/
+/*                          AddVerticalEdge()                           */
 /*                                                                      */
-/*      Examine one pixel and compare to its neighbour above            */
-/*      (previous) and right.  If they are different polygon ids        */
-/*      then add the pixel edge to this polygon and the one on the      */
-/*      other side of the edge.                                         */
+/*      Add the one pixel high edge of a polygon from (nX,nY1) to       */
+/*      (nX,nY2), extending the edge added on this column for the       */
+/*      last line if it is still the edge of the polygon.               */
 /************************************************************************/
 
-static void AddEdges( GInt32 *panThisLineId, GInt32 *panLastLineId, 
-                      GInt32 *panPolyIdMap, GInt32 *panPolyValue,
-                      RPolygon **papoPoly, int iX, int iY )
+static void AddVerticalEdge( RPolygon *poPoly, int &iColumnEdge,
+                             int nX, int nY1, int nY2 )
 
 {
-    int nThisId = panThisLineId[iX];
-    int nRightId = panThisLineId[iX+1];
-    int nPreviousId = panLastLineId[iX];
-    int iXReal = iX - 1;
-
-    if( nThisId != -1 )
-        nThisId = panPolyIdMap[nThisId];
-    if( nRightId != -1 )
-        nRightId = panPolyIdMap[nRightId];
-    if( nPreviousId != -1 )
-        nPreviousId = panPolyIdMap[nPreviousId];
-
-    if( nThisId != nPreviousId )
+    std::vector<int> &anEdges = poPoly->anEdges;
+
+    if( iColumnEdge >= 0 && iColumnEdge * 4 < (int) anEdges.size() )
     {
-        if( nThisId != -1 )
-        {
-            if( papoPoly[nThisId] == NULL )
-                papoPoly[nThisId] = new RPolygon( panPolyValue[nThisId] );
+        int *panEdge = &(anEdges[iColumnEdge*4]);
 
-            papoPoly[nThisId]->AddSegment( iXReal, iY, iXReal+1, iY );
+        // Going down, the edge ends where the new one starts.  Going
+        // up, it starts where the new one ends.
+        if( nY2 > nY1 && panEdge[0] == nX && panEdge[2] == nX
+            && panEdge[3] == nY1 && panEdge[1] < nY1 )
+        {
+            panEdge[3] = nY2;
+            return;
         }
-        if( nPreviousId != -1 )
+        if( nY2 < nY1 && panEdge[0] == nX && panEdge[2] == nX
+            && panEdge[1] == nY2 && panEdge[3] < nY2 )
         {
-            if( papoPoly[nPreviousId] == NULL )
-                papoPoly[nPreviousId] = new RPolygon(panPolyValue[nPreviousId]);
-
-            papoPoly[nPreviousId]->AddSegment( iXReal, iY, iXReal+1, iY );
+            panEdge[1] = nY1;
+            return;
         }
     }
 
-    if( nThisId != nRightId )
-    {
-        if( nThisId != -1 )
-        {
-            if( papoPoly[nThisId] == NULL )
-                papoPoly[nThisId] = new RPolygon(panPolyValue[nThisId]);
+    iColumnEdge = poPoly->AddEdge( nX, nY1, nX, nY2 );
+}
 
-            papoPoly[nThisId]->AddSegment( iXReal+1, iY, iXReal+1, iY+1 );
-        }
+/************************************************************************/
+/*                         AddHorizontalEdge()                          */
+/*                                                                      */
+/*      Add the one pixel wide edge of a polygon from (nX1,nY) to       */
+/*      (nX2,nY), extending the last edge of the polygon if it is       */
+/*      the previous pixel edge of the same run.                        */
+/************************************************************************/
 
-        if( nRightId != -1 )
-        {
-            if( papoPoly[nRightId] == NULL )
-                papoPoly[nRightId] = new RPolygon(panPolyValue[nRightId]);
+static void AddHorizontalEdge( RPolygon *poPoly, int nX1, int nX2, int nY )
+
+{
+    std::vector<int> &anEdges = poPoly->anEdges;
 
-            papoPoly[nRightId]->AddSegment( iXReal+1, iY, iXReal+1, iY+1 );
+    if( !anEdges.empty() )
+    {
+        int *panEdge = &(anEdges[anEdges.size()-4]);
+
+        if( panEdge[1] == nY && panEdge[3] == nY )
+        {
+            if( nX2 > nX1 && panEdge[2] == nX1 && panEdge[0] < nX1 )
+            {
+                panEdge[2] = nX2;
+                return;
+            }
+            if( nX2 < nX1 && panEdge[0] == nX2 && panEdge[2] < nX2 )
+            {
+                panEdge[0] = nX1;
+                return;
+            }
         }
     }
+
+    poPoly->AddEdge( nX1, nY, nX2, nY );
 }
 
 /************************************************************************/
@@ -335,9 +331,9 @@ EmitPolygonToLayer( OGRLayerH hOutLayer, int iPixValField,
     OGRGeometryH hPolygon;
 
 /* -------------------------------------------------------------------- */
-/*      Turn bits of lines into coherent rings.                         */
+/*      Turn the pixel edges into coherent rings.                       */
 /* -------------------------------------------------------------------- */
-    poRPoly->Coalesce();
+    poRPoly->BuildRings();
 
 /* -------------------------------------------------------------------- */
 /*      Create the polygon geometry.                                    */
@@ -453,10 +449,13 @@ GPMaskImageData( GDALRasterBandH hMaskBand, GByte* pabyMaskLine, int iY, int nXS
  * do this when the layer is created, presumably matching the raster 
  * coordinate system. 
  *
- * The algorithm used attempts to minimize memory use so that very large
- * rasters can be processed.  However, if the raster has many polygons 
- * or very large/complex polygons, the memory use for holding polygon 
- * enumerations and active polygon geometries may grow to be quite large. 
+ * The raster is read in a single pass.  Pixels are labelled with a 
+ * union-find structure as lines are read, and each polygon is written out
+ * and forgotten as soon as a line no longer touches it, so that the memory
+ * use is proportional to the raster width and to the polygons crossing 
+ * the current line, not to the whole raster.  Very large or complex 
+ * polygons are held in memory as their pixel edges till they are closed,
+ * and their rings are assembled in O(n log n) of their edge count.
  *
  * The algorithm will generally produce very dense polygon geometries, with
  * edges that follow exactly on pixel boundaries for all non-interior pixels.
@@ -514,13 +513,16 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
     CPLErr eErr = CE_None;
     int nXSize = GDALGetRasterBandXSize( hSrcBand );
     int nYSize = GDALGetRasterBandYSize( hSrcBand );
-    GInt32 *panLastLineVal = (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize + 2);
-    GInt32 *panThisLineVal = (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize + 2);
-    GInt32 *panLastLineId =  (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize + 2);
-    GInt32 *panThisLineId =  (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize + 2);
+    GInt32 *panLastLineVal = (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize);
+    GInt32 *panThisLineVal = (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize);
+    GInt32 *panLastLineId =  (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize);
+    GInt32 *panThisLineId =  (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize);
+    GInt32 *panLeftEdge =    (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize + 1);
+    GInt32 *panRightEdge =   (GInt32 *) VSIMalloc2(sizeof(GInt32),nXSize + 1);
     GByte *pabyMaskLine = (hMaskBand != NULL) ? (GByte *) VSIMalloc(nXSize) : NULL;
     if (panLastLineVal == NULL || panThisLineVal == NULL ||
         panLastLineId == NULL || panThisLineId == NULL ||
+        panLeftEdge == NULL || panRightEdge == NULL ||
         (hMaskBand != NULL && pabyMaskLine == NULL))
     {
         CPLError(CE_Failure, CPLE_OutOfMemory,
@@ -529,6 +531,8 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
         CPLFree( panLastLineId );
         CPLFree( panThisLineVal );
         CPLFree( panLastLineVal );
+        CPLFree( panLeftEdge );
+        CPLFree( panRightEdge );
         CPLFree( pabyMaskLine );
         return CE_Failure;
     }
@@ -544,89 +548,33 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
         GDALGetGeoTransform( hSrcDS, adfGeoTransform );
 
 /* -------------------------------------------------------------------- */
-/*      The first pass over the raster is only used to build up the     */
-/*      polygon id map so we will know in advance what polygons are     */
-/*      what on the second pass.                                        */
+/*      Polygon ids of -1 stand for the outside of the raster, and      */
+/*      for the masked out pixels.  The edge indices on each column     */
+/*      are those of the vertical edges of the last line, for the       */
+/*      polygons on their left and on their right.                      */
 /* -------------------------------------------------------------------- */
-    int iY;
-    GDALRasterPolygonEnumerator oFirstEnum;
-
-    for( iY = 0; eErr == CE_None && iY < nYSize; iY++ )
-    {
-        eErr = GDALRasterIO( 
-            hSrcBand,
-            GF_Read, 0, iY, nXSize, 1, 
-            panThisLineVal, nXSize, 1, GDT_Int32, 0, 0 );
-        
-        if( eErr == CE_None && hMaskBand != NULL )
-            eErr = GPMaskImageData( hMaskBand, pabyMaskLine, iY, nXSize, panThisLineVal );
-
-        if( iY == 0 )
-            oFirstEnum.ProcessLine( 
-                NULL, panThisLineVal, NULL, panThisLineId, nXSize );
-        else
-            oFirstEnum.ProcessLine(
-                panLastLineVal, panThisLineVal, 
-                panLastLineId,  panThisLineId, 
-                nXSize );
-
-        // swap lines
-        GInt32 *panTmp = panLastLineVal;
-        panLastLineVal = panThisLineVal;
-        panThisLineVal = panTmp;
+    int iX, iY;
 
-        panTmp = panThisLineId;
-        panThisLineId = panLastLineId;
-        panLastLineId = panTmp;
+    for( iX = 0; iX < nXSize; iX++ )
+        panLastLineId[iX] = -1;
 
-/* -------------------------------------------------------------------- */
-/*      Report progress, and support interrupts.                        */
-/* -------------------------------------------------------------------- */
-        if( eErr == CE_None 
-            && !pfnProgress( 0.10 * ((iY+1) / (double) nYSize), 
-                             "", pProgressArg ) )
-        {
-            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-            eErr = CE_Failure;
-        }
+    for( iX = 0; iX < nXSize + 1; iX++ )
+    {
+        panLeftEdge[iX] = -1;
+        panRightEdge[iX] = -1;
     }
 
-/* -------------------------------------------------------------------- */
-/*      Make a pass through the maps, ensuring every polygon id         */
-/*      points to the final id it should use, not an intermediate       */
-/*      value.                                                          */
-/* -------------------------------------------------------------------- */
-    oFirstEnum.CompleteMerges();
-
-/* -------------------------------------------------------------------- */
-/*      Initialize ids to -1 to serve as a nodata value for the         */
-/*      previous line, and past the beginning and end of the            */
-/*      scanlines.                                                      */
-/* -------------------------------------------------------------------- */
-    int iX;
-
-    panThisLineId[0] = -1;
-    panThisLineId[nXSize+1] = -1;
-
-    for( iX = 0; iX < nXSize+2; iX++ )
-        panLastLineId[iX] = -1;
-
-/* -------------------------------------------------------------------- */
-/*      We will use a new enumerator for the second pass primariliy     */
-/*      so we can preserve the first pass map.                          */
-/* -------------------------------------------------------------------- */
-    GDALRasterPolygonEnumerator oSecondEnum;
-    RPolygon **papoPoly = (RPolygon **) 
-        CPLCalloc(sizeof(RPolygon*),oFirstEnum.nNextPolygonId);
+    GDALRasterPolygonLabeller oLabeller;
+    std::vector<RPolygon*> apoPoly;
 
 /* ==================================================================== */
-/*      Second pass during which we will actually collect polygon       */
-/*      edges as geometries.                                            */
+/*      Single pass, one line further than the raster so that the       */
+/*      polygons of the last line are closed.                           */
 /* ==================================================================== */
     for( iY = 0; eErr == CE_None && iY < nYSize+1; iY++ )
     {
 /* -------------------------------------------------------------------- */
-/*      Read the image data.                                            */
+/*      Read the image data, and label the pixels.                      */
 /* -------------------------------------------------------------------- */
         if( iY < nYSize )
         {
@@ -635,64 +583,146 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
 
             if( eErr == CE_None && hMaskBand != NULL )
                 eErr = GPMaskImageData( hMaskBand, pabyMaskLine, iY, nXSize, panThisLineVal );
+
+            if( eErr != CE_None )
+                break;
+
+            oLabeller.ProcessLine( iY == 0 ? NULL : panLastLineVal, 
+                                   panThisLineVal,
+                                   panLastLineId, panThisLineId, 
+                                   nXSize, iY );
         }
 
-        if( eErr != CE_None )
-            continue;
+/* -------------------------------------------------------------------- */
+/*      Merge the edges of the polygons joined on this line, the        */
+/*      smaller list into the larger one.                               */
+/* -------------------------------------------------------------------- */
+        size_t iMerge;
+
+        apoPoly.resize( oLabeller.GetIdCount(), NULL );
+
+        for( iMerge = 0; 
+             iY < nYSize && iMerge < oLabeller.anMerges.size(); 
+             iMerge += 2 )
+        {
+            int nFrom = oLabeller.anMerges[iMerge];
+            int nInto = oLabeller.anMerges[iMerge+1];
+
+            if( apoPoly[nFrom] == NULL )
+                continue;
+
+            if( apoPoly[nInto] == NULL )
+            {
+                apoPoly[nInto] = apoPoly[nFrom];
+                apoPoly[nFrom] = NULL;
+                continue;
+            }
+
+            std::vector<int> &anFrom = apoPoly[nFrom]->anEdges;
+            std::vector<int> &anInto = apoPoly[nInto]->anEdges;
+
+            if( anFrom.size() > anInto.size() )
+                anFrom.swap( anInto );
+
+            anInto.insert( anInto.end(), anFrom.begin(), anFrom.end() );
+
+            delete apoPoly[nFrom];
+            apoPoly[nFrom] = NULL;
+        }
 
 /* -------------------------------------------------------------------- */
-/*      Determine what polygon the various pixels belong to (redoing    */
-/*      the same thing done in the first pass above).                   */
+/*      Get the polygons of the last line as they are now, and use -1   */
+/*      past the bottom of the raster.                                  */
 /* -------------------------------------------------------------------- */
-        if( iY == nYSize )
+        for( iX = 0; iX < nXSize; iX++ )
         {
-            for( iX = 0; iX < nXSize+2; iX++ )
+            if( panLastLineId[iX] != -1 )
+                panLastLineId[iX] = oLabeller.Find( panLastLineId[iX] );
+
+            if( iY == nYSize )
                 panThisLineId[iX] = -1;
         }
-        else if( iY == 0 )
-            oSecondEnum.ProcessLine( 
-                NULL, panThisLineVal, NULL, panThisLineId+1, nXSize );
-        else
-            oSecondEnum.ProcessLine(
-                panLastLineVal, panThisLineVal, 
-                panLastLineId+1,  panThisLineId+1, 
-                nXSize );
 
 /* -------------------------------------------------------------------- */
-/*      Add polygon edges to our polygon list for the pixel             */
-/*      boundaries within and above this line.                          */
+/*      Add the horizontal edges between the last line and this one.    */
+/*      Masked out pixels are handled as being outside of the raster.   */
 /* -------------------------------------------------------------------- */
-        for( iX = 0; iX < nXSize+1; iX++ )
+        for( iX = 0; iX < nXSize; iX++ )
         {
-            AddEdges( panThisLineId, panLastLineId, 
-                      oFirstEnum.panPolyIdMap, oFirstEnum.panPolyValue,
-                      papoPoly, iX, iY );
+            int nThisId = panThisLineId[iX];
+            int nPreviousId = panLastLineId[iX];
+
+            if( hMaskBand != NULL )
+            {
+                if( nThisId != -1 && panThisLineVal[iX] == GP_NODATA_MARKER )
+                    nThisId = -1;
+                if( nPreviousId != -1 
+                    && panLastLineVal[iX] == GP_NODATA_MARKER )
+                    nPreviousId = -1;
+            }
+
+            if( nThisId == nPreviousId )
+                continue;
+
+            if( nThisId != -1 )
+                AddHorizontalEdge( GetRPolygon( apoPoly, oLabeller, nThisId ),
+                                   iX, iX+1, iY );
+
+            if( nPreviousId != -1 )
+                AddHorizontalEdge( GetRPolygon( apoPoly, oLabeller, 
+                                                nPreviousId ),
+                                   iX+1, iX, iY );
         }
 
 /* -------------------------------------------------------------------- */
-/*      Periodically we scan out polygons and write out those that      */
-/*      haven't been added to on the last line as we can be sure        */
-/*      they are complete.                                              */
+/*      Add the vertical edges between the pixels of this line.         */
 /* -------------------------------------------------------------------- */
-        if( iY % 8 == 7 )
+        int nLeftId = -1;
+
+        for( iX = 0; iY < nYSize && iX < nXSize+1; iX++ )
         {
-            for( iX = 0; 
-                 eErr == CE_None && iX < oSecondEnum.nNextPolygonId; 
-                 iX++ )
+            int nRightId = iX < nXSize ? panThisLineId[iX] : -1;
+
+            if( hMaskBand != NULL && nRightId != -1
+                && panThisLineVal[iX] == GP_NODATA_MARKER )
+                nRightId = -1;
+
+            if( nLeftId != nRightId )
             {
-                if( papoPoly[iX] && papoPoly[iX]->nLastLineUpdated < iY-1 )
-                {
-                    if( hMaskBand == NULL
-                        || papoPoly[iX]->nPolyValue != GP_NODATA_MARKER )
-                    {
-                        eErr = 
-                            EmitPolygonToLayer( hOutLayer, iPixValField, 
-                                                papoPoly[iX], adfGeoTransform );
-                    }
-                    delete papoPoly[iX];
-                    papoPoly[iX] = NULL;
-                }
+                if( nLeftId != -1 )
+                    AddVerticalEdge( GetRPolygon( apoPoly, oLabeller, nLeftId ),
+                                     panLeftEdge[iX], iX, iY, iY+1 );
+
+                if( nRightId != -1 )
+                    AddVerticalEdge( GetRPolygon( apoPoly, oLabeller, 
+                                                  nRightId ),
+                                     panRightEdge[iX], iX, iY+1, iY );
+            }
+
+            nLeftId = nRightId;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      The polygons of the last line that do not reach this line are   */
+/*      complete: write them out, and release their ids.                */
+/* -------------------------------------------------------------------- */
+        for( iX = 0; iX < nXSize; iX++ )
+        {
+            int nId = panLastLineId[iX];
+
+            if( nId == -1 || !oLabeller.IsClosed( nId, iY ) )
+                continue;
+
+            if( apoPoly[nId] != NULL )
+            {
+                if( eErr == CE_None )
+                    eErr = EmitPolygonToLayer( hOutLayer, iPixValField, 
+                                               apoPoly[nId], adfGeoTransform );
+                delete apoPoly[nId];
+                apoPoly[nId] = NULL;
             }
+
+            oLabeller.Release( nId );
         }
 
 /* -------------------------------------------------------------------- */
@@ -711,7 +741,7 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
 /*      Report progress, and support interrupts.                        */
 /* -------------------------------------------------------------------- */
         if( eErr == CE_None 
-            && !pfnProgress( 0.10 + 0.90 * ((iY+1) / (double) nYSize), 
+            && !pfnProgress( MIN(1.0, (iY+1) / (double) nYSize), 
                              "", pProgressArg ) )
         {
             CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
@@ -720,34 +750,20 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
     }
 
 /* -------------------------------------------------------------------- */
-/*      Make a cleanup pass for all unflushed polygons.                 */
+/*      Cleanup, including the polygons left open by an error.          */
 /* -------------------------------------------------------------------- */
-    for( iX = 0; eErr == CE_None && iX < oSecondEnum.nNextPolygonId; iX++ )
-    {
-        if( papoPoly[iX] )
-        {
-            if( hMaskBand == NULL
-                || papoPoly[iX]->nPolyValue != GP_NODATA_MARKER )
-            {
-                eErr = 
-                    EmitPolygonToLayer( hOutLayer, iPixValField, 
-                                        papoPoly[iX], adfGeoTransform );
-            }
-            delete papoPoly[iX];
-            papoPoly[iX] = NULL;
-        }
-    }
+    size_t iPoly;
+
+    for( iPoly = 0; iPoly < apoPoly.size(); iPoly++ )
+        delete apoPoly[iPoly];
 
-/* -------------------------------------------------------------------- */
-/*      Cleanup                                                         */
-/* -------------------------------------------------------------------- */
     CPLFree( panThisLineId );
     CPLFree( panLastLineId );
     CPLFree( panThisLineVal );
     CPLFree( panLastLineVal );
+    CPLFree( panLeftEdge );
+    CPLFree( panRightEdge );
     CPLFree( pabyMaskLine );
-    CPLFree( papoPoly );
 
     return eErr;
 }
-
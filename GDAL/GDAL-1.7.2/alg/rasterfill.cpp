@@ -30,6 +30,7 @@
 #include "gdal_alg.h"
 #include "cpl_conv.h"
 #include "cpl_string.h"
+#include "cpl_multiproc.h"
 
 CPL_CVSID("$Id: rasterfill.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -324,6 +325,560 @@ end:
     return eErr;
 }
  
+/************************************************************************/
+/*                            GDALFillLevel                             */
+/*                                                                      */
+/*      A level of the pyramid of GDALFillPyramid(), or a chunk of      */
+/*      lines of the band itself.                                       */
+/************************************************************************/
+
+typedef struct
+{
+    int    nXSize;
+    int    nYSize;
+    float *pafValue;
+    GByte *pabyValid;
+} GDALFillLevel;
+
+typedef struct
+{
+    int            bReduce;
+    GDALFillLevel *psFine;
+    int            nFineYOff;    // Line of the level where psFine starts.
+    GDALFillLevel *psCoarse;
+    double        *padfFineOut;  // The band values, when psFine is a chunk.
+
+    // Rows computed, of psCoarse when reducing and of psFine otherwise.
+    int            iFirstRow;
+    int            nRows;
+
+    // Cells left empty when reducing, pixels filled otherwise.
+    int            nCount;
+} GDALFillJob;
+
+/************************************************************************/
+/*                         GDALFillReduceRows()                         */
+/*                                                                      */
+/*      Average the valid pixels of each 2x2 block of the finer         */
+/*      level into a cell of the coarser one.                           */
+/************************************************************************/
+
+static void GDALFillReduceRows( GDALFillJob *psJob )
+
+{
+    const GDALFillLevel *psFine = psJob->psFine;
+    GDALFillLevel       *psCoarse = psJob->psCoarse;
+    int                  iRow, iX, iFineRow, iFineX;
+
+    psJob->nCount = 0;
+
+    for( iRow = psJob->iFirstRow; iRow < psJob->iFirstRow + psJob->nRows;
+         iRow++ )
+    {
+        const int nFirstFineRow = 2 * iRow - psJob->nFineYOff;
+        const int nEndFineRow = MIN(nFirstFineRow + 2, psFine->nYSize);
+        float    *pafValue = psCoarse->pafValue + iRow * (size_t) psCoarse->nXSize;
+        GByte    *pabyValid =
+            psCoarse->pabyValid + iRow * (size_t) psCoarse->nXSize;
+
+        for( iX = 0; iX < psCoarse->nXSize; iX++ )
+        {
+            const int nEndFineX = MIN(2 * iX + 2, psFine->nXSize);
+            double    dfSum = 0.0;
+            int       nValid = 0;
+
+            for( iFineRow = nFirstFineRow; iFineRow < nEndFineRow; iFineRow++ )
+            {
+                const size_t iOffset = iFineRow * (size_t) psFine->nXSize;
+
+                for( iFineX = 2 * iX; iFineX < nEndFineX; iFineX++ )
+                {
+                    if( psFine->pabyValid[iOffset + iFineX] )
+                    {
+                        dfSum += psFine->pafValue[iOffset + iFineX];
+                        nValid++;
+                    }
+                }
+            }
+
+            if( nValid > 0 )
+            {
+                pafValue[iX] = (float) (dfSum / nValid);
+                pabyValid[iX] = 1;
+            }
+            else
+            {
+                pabyValid[iX] = 0;
+                psJob->nCount++;
+            }
+        }
+    }
+}
+
+/************************************************************************/
+/*                          GDALFillUpsample()                          */
+/*                                                                      */
+/*      Bilinear interpolation of the valid cells of the coarser        */
+/*      level around a pixel of the finer one, whose center is a        */
+/*      quarter of a cell off the nearest cell center.                  */
+/************************************************************************/
+
+static int GDALFillUpsample( const GDALFillLevel *psCoarse, int iX, int iY,
+                             double *pdfValue )
+
+{
+    const int    iX0 = (iX & 1) ? iX / 2 : iX / 2 - 1;
+    const int    iY0 = (iY & 1) ? iY / 2 : iY / 2 - 1;
+    const double dfFracX = (iX & 1) ? 0.25 : 0.75;
+    const double dfFracY = (iY & 1) ? 0.25 : 0.75;
+    double       dfSum = 0.0, dfWeightSum = 0.0;
+    int          i, j;
+
+    for( j = 0; j < 2; j++ )
+    {
+        const int iCY = iY0 + j;
+
+        if( iCY < 0 || iCY >= psCoarse->nYSize )
+            continue;
+
+        const double dfWeightY = j ? dfFracY : 1.0 - dfFracY;
+        const size_t iOffset = iCY * (size_t) psCoarse->nXSize;
+
+        for( i = 0; i < 2; i++ )
+        {
+            const int iCX = iX0 + i;
+
+            if( iCX < 0 || iCX >= psCoarse->nXSize
+                || !psCoarse->pabyValid[iOffset + iCX] )
+                continue;
+
+            const double dfWeight = dfWeightY * (i ? dfFracX : 1.0 - dfFracX);
+
+            dfSum += dfWeight * psCoarse->pafValue[iOffset + iCX];
+            dfWeightSum += dfWeight;
+        }
+    }
+
+    if( dfWeightSum == 0.0 )
+        return FALSE;
+
+    *pdfValue = dfSum / dfWeightSum;
+    return TRUE;
+}
+
+/************************************************************************/
+/*                         GDALFillExpandRows()                         */
+/*                                                                      */
+/*      Fill the empty pixels of the finer level from the coarser       */
+/*      one.  The filled pixels of a chunk of the band are flagged 2.   */
+/************************************************************************/
+
+static void GDALFillExpandRows( GDALFillJob *psJob )
+
+{
+    GDALFillLevel       *psFine = psJob->psFine;
+    const GDALFillLevel *psCoarse = psJob->psCoarse;
+    int                  iRow, iX;
+
+    psJob->nCount = 0;
+
+    for( iRow = psJob->iFirstRow; iRow < psJob->iFirstRow + psJob->nRows;
+         iRow++ )
+    {
+        const size_t iOffset =
+            (iRow - psJob->nFineYOff) * (size_t) psFine->nXSize;
+
+        for( iX = 0; iX < psFine->nXSize; iX++ )
+        {
+            double dfValue;
+
+            if( psFine->pabyValid[iOffset + iX]
+                || !GDALFillUpsample( psCoarse, iX, iRow, &dfValue ) )
+                continue;
+
+            if( psJob->padfFineOut != NULL )
+            {
+                psJob->padfFineOut[iOffset + iX] = dfValue;
+                psFine->pabyValid[iOffset + iX] = 2;
+            }
+            else
+            {
+                psFine->pafValue[iOffset + iX] = (float) dfValue;
+                psFine->pabyValid[iOffset + iX] = 1;
+            }
+            psJob->nCount++;
+        }
+    }
+}
+
+/************************************************************************/
+/*                          GDALFillJobMain()                           */
+/************************************************************************/
+
+static void GDALFillJobMain( void *pData )
+
+{
+    GDALFillJob *psJob = (GDALFillJob *) pData;
+
+    if( psJob->bReduce )
+        GDALFillReduceRows( psJob );
+    else
+        GDALFillExpandRows( psJob );
+}
+
+/************************************************************************/
+/*                          GDALFillRunRows()                           */
+/*                                                                      */
+/*      Share rows between the jobs, run them, and return the sum of    */
+/*      their counts.                                                   */
+/************************************************************************/
+
+static int GDALFillRunRows( GDALFillJob *pasJobs, void **papJobs,
+                            int nThreads, int bReduce,
+                            GDALFillLevel *psFine, int nFineYOff,
+                            GDALFillLevel *psCoarse, double *padfFineOut,
+                            int iFirstRow, int nRows )
+
+{
+    const int nJobs = MAX(1, MIN(nThreads, nRows));
+    int       iJob, nCount = 0;
+
+    for( iJob = 0; iJob < nJobs; iJob++ )
+    {
+        GDALFillJob *psJob = pasJobs + iJob;
+
+        psJob->bReduce = bReduce;
+        psJob->psFine = psFine;
+        psJob->nFineYOff = nFineYOff;
+        psJob->psCoarse = psCoarse;
+        psJob->padfFineOut = padfFineOut;
+        psJob->iFirstRow = iFirstRow + (int)
+            (((GIntBig) nRows * iJob) / nJobs);
+        psJob->nRows = iFirstRow + (int)
+            (((GIntBig) nRows * (iJob + 1)) / nJobs) - psJob->iFirstRow;
+        papJobs[iJob] = psJob;
+    }
+
+    CPLRunJobs( nJobs, papJobs, GDALFillJobMain, nThreads );
+
+    for( iJob = 0; iJob < nJobs; iJob++ )
+        nCount += pasJobs[iJob].nCount;
+
+    return nCount;
+}
+
+/************************************************************************/
+/*                          GDALFillPyramid()                           */
+/*                                                                      */
+/*      The ALGORITHM=PYRAMID implementation of GDALFillNodata().  A    */
+/*      first pass over the band by chunks of lines averages the        */
+/*      valid pixels into a pyramid of levels of halved size, held in   */
+/*      memory, until a level has no empty cell.  Going back down,      */
+/*      the empty cells of each level are interpolated from the one     */
+/*      above, and a second pass over the band fills its nodata         */
+/*      pixels from the first level.  The rows of each step are         */
+/*      shared between threads.                                         */
+/************************************************************************/
+
+static CPLErr
+GDALFillPyramid( GDALRasterBandH hTargetBand, GDALRasterBandH hMaskBand,
+                 double dfMaxSearchDist, int nSmoothingIterations,
+                 int nThreads,
+                 GDALProgressFunc pfnProgress, void *pProgressArg )
+
+{
+    const int nXSize = GDALGetRasterBandXSize( hTargetBand );
+    const int nYSize = GDALGetRasterBandYSize( hTargetBand );
+    CPLErr    eErr = CE_None;
+    int       i, iLevel;
+
+    if( !pfnProgress( 0.0, "Filling...", pProgressArg ) )
+    {
+        CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The cells of level n are 2^n pixels wide, and the levels stop   */
+/*      at the search distance, and at a single cell.                   */
+/* -------------------------------------------------------------------- */
+    int nMaxLevels = 1;
+
+    while( nMaxLevels < 30 && (1 << (nMaxLevels + 1)) <= dfMaxSearchDist )
+        nMaxLevels++;
+
+    GDALFillLevel *pasLevels = (GDALFillLevel *)
+        CPLCalloc( sizeof(GDALFillLevel), nMaxLevels + 1 );
+
+    pasLevels[0].nXSize = nXSize;
+    pasLevels[0].nYSize = nYSize;
+    for( iLevel = 1; iLevel <= nMaxLevels; iLevel++ )
+    {
+        pasLevels[iLevel].nXSize = (pasLevels[iLevel-1].nXSize + 1) / 2;
+        pasLevels[iLevel].nYSize = (pasLevels[iLevel-1].nYSize + 1) / 2;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Chunks of an even number of lines, of about a million pixels.   */
+/* -------------------------------------------------------------------- */
+    int nChunkLines = MAX(2, (1048576 / MAX(nXSize, 1)) / 2 * 2);
+
+    nChunkLines = MIN(nChunkLines, nYSize);
+
+    GDALFillLevel sChunk;
+    double       *padfChunk = (double *)
+        VSIMalloc( sizeof(double) * nXSize * (size_t) nChunkLines );
+
+    sChunk.nXSize = nXSize;
+    sChunk.nYSize = 0;
+    sChunk.pafValue = (float *)
+        VSIMalloc( sizeof(float) * nXSize * (size_t) nChunkLines );
+    sChunk.pabyValid = (GByte *) VSIMalloc( nXSize * (size_t) nChunkLines );
+
+    GDALFillJob *pasJobs = (GDALFillJob *)
+        CPLCalloc( sizeof(GDALFillJob), MAX(nThreads, 1) );
+    void       **papJobs = (void **) CPLCalloc( sizeof(void*), MAX(nThreads, 1) );
+
+    GDALDatasetH    hFiltMaskDS = NULL;
+    GDALRasterBandH hFiltMaskBand = NULL;
+    GDALDriverH     hDriver = GDALGetDriverByName( "GTiff" );
+    CPLString       osFiltMaskTmpFile;
+
+    if( padfChunk == NULL || sChunk.pafValue == NULL
+        || sChunk.pabyValid == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Could not allocate enough memory for temporary buffers" );
+        eErr = CE_Failure;
+    }
+
+/* ==================================================================== */
+/*      Average the band into the first level.                          */
+/* ==================================================================== */
+    int nYOff, nLines, nEmptyPixels = 0, nEmptyCells = 0, nLevels = 1;
+
+    if( eErr == CE_None )
+    {
+        pasLevels[1].pafValue = (float *)
+            VSIMalloc3( sizeof(float), pasLevels[1].nXSize,
+                        pasLevels[1].nYSize );
+        pasLevels[1].pabyValid = (GByte *)
+            VSIMalloc2( pasLevels[1].nXSize, pasLevels[1].nYSize );
+        if( pasLevels[1].pafValue == NULL || pasLevels[1].pabyValid == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Could not allocate enough memory for temporary buffers" );
+            eErr = CE_Failure;
+        }
+    }
+
+    for( nYOff = 0; eErr == CE_None && nYOff < nYSize; nYOff += nLines )
+    {
+        nLines = MIN(nChunkLines, nYSize - nYOff);
+        sChunk.nYSize = nLines;
+
+        eErr = GDALRasterIO( hMaskBand, GF_Read, 0, nYOff, nXSize, nLines,
+                             sChunk.pabyValid, nXSize, nLines, GDT_Byte,
+                             0, 0 );
+        if( eErr == CE_None )
+            eErr = GDALRasterIO( hTargetBand, GF_Read,
+                                 0, nYOff, nXSize, nLines,
+                                 sChunk.pafValue, nXSize, nLines,
+                                 GDT_Float32, 0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        for( i = 0; i < nXSize * nLines; i++ )
+        {
+            if( sChunk.pabyValid[i] )
+                sChunk.pabyValid[i] = 1;
+            else
+                nEmptyPixels++;
+        }
+
+        nEmptyCells +=
+            GDALFillRunRows( pasJobs, papJobs, nThreads, TRUE,
+                             &sChunk, nYOff, pasLevels + 1, NULL,
+                             nYOff / 2, (nLines + 1) / 2 );
+
+        if( !pfnProgress( 0.5 * (nYOff + nLines) / nYSize,
+                          "Filling...", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+    if( eErr != CE_None || nEmptyPixels == 0 )
+        goto end;
+
+/* -------------------------------------------------------------------- */
+/*      Build the levels above, as long as there are empty cells.       */
+/* -------------------------------------------------------------------- */
+    while( nEmptyCells > 0 && nLevels < nMaxLevels
+           && (pasLevels[nLevels].nXSize > 1 || pasLevels[nLevels].nYSize > 1) )
+    {
+        GDALFillLevel *psLevel = pasLevels + nLevels + 1;
+
+        psLevel->pafValue = (float *)
+            VSIMalloc3( sizeof(float), psLevel->nXSize, psLevel->nYSize );
+        psLevel->pabyValid = (GByte *)
+            VSIMalloc2( psLevel->nXSize, psLevel->nYSize );
+        if( psLevel->pafValue == NULL || psLevel->pabyValid == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Could not allocate enough memory for temporary buffers" );
+            eErr = CE_Failure;
+            goto end;
+        }
+
+        nEmptyCells =
+            GDALFillRunRows( pasJobs, papJobs, nThreads, TRUE,
+                             pasLevels + nLevels, 0, psLevel, NULL,
+                             0, psLevel->nYSize );
+        nLevels++;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      And fill them back down.                                        */
+/* -------------------------------------------------------------------- */
+    for( iLevel = nLevels - 1; iLevel >= 1; iLevel-- )
+        GDALFillRunRows( pasJobs, papJobs, nThreads, FALSE,
+                         pasLevels + iLevel, 0, pasLevels + iLevel + 1, NULL,
+                         0, pasLevels[iLevel].nYSize );
+
+/* -------------------------------------------------------------------- */
+/*      The smoothing filter needs a mask of the filled pixels.         */
+/* -------------------------------------------------------------------- */
+    if( nSmoothingIterations > 0 )
+    {
+        static const char *apszOptions[] = { "COMPRESS=LZW", NULL };
+
+        if( hDriver == NULL )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "GDALFillNodata needs GTiff driver" );
+            eErr = CE_Failure;
+            goto end;
+        }
+
+        osFiltMaskTmpFile = CPLGenerateTempFilename("");
+        osFiltMaskTmpFile += "fill_filtmask_work.tif";
+        hFiltMaskDS =
+            GDALCreate( hDriver, osFiltMaskTmpFile, nXSize, nYSize, 1,
+                        GDT_Byte, (char **) apszOptions );
+        if( hFiltMaskDS == NULL )
+        {
+            eErr = CE_Failure;
+            goto end;
+        }
+        hFiltMaskBand = GDALGetRasterBand( hFiltMaskDS, 1 );
+    }
+
+/* ==================================================================== */
+/*      Fill the nodata pixels of the band from the first level.        */
+/* ==================================================================== */
+    for( nYOff = 0; eErr == CE_None && nYOff < nYSize; nYOff += nLines )
+    {
+        int nFilled = 0;
+
+        nLines = MIN(nChunkLines, nYSize - nYOff);
+        sChunk.nYSize = nLines;
+
+        eErr = GDALRasterIO( hMaskBand, GF_Read, 0, nYOff, nXSize, nLines,
+                             sChunk.pabyValid, nXSize, nLines, GDT_Byte,
+                             0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        int bHasEmpty = FALSE;
+
+        for( i = 0; i < nXSize * nLines; i++ )
+        {
+            if( sChunk.pabyValid[i] )
+                sChunk.pabyValid[i] = 1;
+            else
+                bHasEmpty = TRUE;
+        }
+
+        if( bHasEmpty )
+        {
+            eErr = GDALRasterIO( hTargetBand, GF_Read,
+                                 0, nYOff, nXSize, nLines,
+                                 padfChunk, nXSize, nLines,
+                                 GDT_Float64, 0, 0 );
+            if( eErr != CE_None )
+                break;
+
+            nFilled = GDALFillRunRows( pasJobs, papJobs, nThreads, FALSE,
+                                       &sChunk, nYOff, pasLevels + 1,
+                                       padfChunk, nYOff, nLines );
+        }
+
+        if( nFilled > 0 )
+            eErr = GDALRasterIO( hTargetBand, GF_Write,
+                                 0, nYOff, nXSize, nLines,
+                                 padfChunk, nXSize, nLines,
+                                 GDT_Float64, 0, 0 );
+
+        if( eErr == CE_None && hFiltMaskBand != NULL )
+        {
+            for( i = 0; i < nXSize * nLines; i++ )
+                sChunk.pabyValid[i] = sChunk.pabyValid[i] == 2 ? 255 : 0;
+
+            eErr = GDALRasterIO( hFiltMaskBand, GF_Write,
+                                 0, nYOff, nXSize, nLines,
+                                 sChunk.pabyValid, nXSize, nLines,
+                                 GDT_Byte, 0, 0 );
+        }
+
+        if( eErr == CE_None
+            && !pfnProgress( 0.5 + 0.5 * (nYOff + nLines) / nYSize,
+                             "Filling...", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Smooth the filled pixels.                                       */
+/* -------------------------------------------------------------------- */
+    if( eErr == CE_None && hFiltMaskBand != NULL )
+    {
+        // force masks to be to flushed and recomputed.
+        GDALFlushRasterCache( hMaskBand );
+
+        eErr = GDALMultiFilter( hTargetBand, hMaskBand, hFiltMaskBand,
+                                nSmoothingIterations,
+                                pfnProgress, pProgressArg );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Cleanup.                                                        */
+/* -------------------------------------------------------------------- */
+end:
+    for( iLevel = 1; iLevel <= nMaxLevels; iLevel++ )
+    {
+        CPLFree( pasLevels[iLevel].pafValue );
+        CPLFree( pasLevels[iLevel].pabyValid );
+    }
+    CPLFree( pasLevels );
+    CPLFree( padfChunk );
+    CPLFree( sChunk.pafValue );
+    CPLFree( sChunk.pabyValid );
+    CPLFree( pasJobs );
+    CPLFree( papJobs );
+
+    if( hFiltMaskDS != NULL )
+    {
+        GDALClose( hFiltMaskDS );
+        GDALDeleteDataset( hDriver, osFiltMaskTmpFile );
+    }
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                             QUAD_CHECK()                             */
 /*                                                                      */
@@ -375,8 +930,20 @@ if( quad_value != nNoDataVal ) 						\
  * @param bDeprecatedOption unused argument, should be zero.
  * @param nSmoothingIterations the number of 3x3 smoothing filter passes to 
  * run (0 or more).
- * @param papszOptions additional name=value options in a string list (none 
- * supported at this time - just pass NULL).
+ * @param papszOptions additional name=value options in a string list, or
+ * NULL:
+ * <dl>
+ * <dt>"ALGORITHM":</dt> <dd>INV_DIST, the default, for the conic search
+ * described above, or PYRAMID.  PYRAMID averages the valid pixels into a
+ * pyramid of levels of halved resolution, then fills the empty cells of
+ * each level, from the coarsest, by bilinear interpolation of the level
+ * above.  Its cost per pixel is bounded whatever the size of the nodata
+ * areas, and the result is smooth without filter passes.  Nodata pixels
+ * are filled up to about dfMaxSearchDist pixels from valid ones.</dd>
+ * <dt>"NUM_THREADS":</dt> <dd>The number of threads, or ALL_CPUS, computing
+ * the PYRAMID levels and fill.  Defaults to the GDAL_NUM_THREADS
+ * configuration option, or 1.</dd>
+ * </dl>
  * @param pfnProgress the progress function to report completion.
  * @param pProgressArg callback data for progress function.
  * 
@@ -423,12 +990,31 @@ GDALFillNodata( GDALRasterBandH hTargetBand,
     if( hMaskBand == NULL )
         hMaskBand = GDALGetMaskBand( hTargetBand );
 
-/* -------------------------------------------------------------------- */
-/*      Initialize progress counter.                                    */
-/* -------------------------------------------------------------------- */
     if( pfnProgress == NULL )
         pfnProgress = GDALDummyProgress;
 
+/* -------------------------------------------------------------------- */
+/*      Use the pyramid?                                                */
+/* -------------------------------------------------------------------- */
+    const char *pszAlgorithm = CSLFetchNameValue( papszOptions, "ALGORITHM" );
+
+    if( pszAlgorithm != NULL && EQUAL(pszAlgorithm,"PYRAMID") )
+        return GDALFillPyramid(
+            hTargetBand, hMaskBand, dfMaxSearchDist, nSmoothingIterations,
+            CPLGetNumThreads( CSLFetchNameValue( papszOptions,
+                                                 "NUM_THREADS" ) ),
+            pfnProgress, pProgressArg );
+    else if( pszAlgorithm != NULL && !EQUAL(pszAlgorithm,"INV_DIST") )
+    {
+        CPLError( CE_Failure, CPLE_IllegalArg,
+                  "Unsupported ALGORITHM value '%s', should be INV_DIST "
+                  "or PYRAMID.", pszAlgorithm );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Initialize progress counter.                                    */
+/* -------------------------------------------------------------------- */
     if( !pfnProgress( 0.0, "Filling...", pProgressArg ) )
     {
         CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
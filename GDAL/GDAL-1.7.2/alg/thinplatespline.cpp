@@ -31,6 +31,7 @@
  ****************************************************************************/
 
 #include "thinplatespline.h"
+#include "cpl_string.h"
 
 #ifdef HAVE_FLOAT_H
 #  include <float.h>
@@ -43,6 +44,10 @@
 #  define FLT_MIN 1e-37
 #endif
 
+#ifndef M_PI
+#  define M_PI  3.1415926535897932384626433832795
+#endif
+
 VizGeorefSpline2D* viz_xy2llz;
 VizGeorefSpline2D* viz_llz2xy;
 
@@ -50,13 +55,21 @@ VizGeorefSpline2D* viz_llz2xy;
 //// vizGeorefSpline2D
 /////////////////////////////////////////////////////////////////////////////////////
 
-#define A(r,c) _AA[ _nof_eqs * (r) + (c) ]
-#define Ainv(r,c) _Ainv[ _nof_eqs * (r) + (c) ]
-
+/* Tile size of the blocked Cholesky factorization, and length of the */
+/* inner products accumulated at once, so that the rows of two tiles  */
+/* stay in cache. */
+#define VIZ_CHOL_TILE  32
+#define VIZ_CHOL_DEPTH 256
 
-#define VIZ_GEOREF_SPLINE_DEBUG 0
+/* Minimum number of points for the far field approximation, average */
+/* number of points per cell, and maximum error of the approximation  */
+/* relative to the range of the values. */
+#define VIZ_FARFIELD_MIN_POINTS  1000
+#define VIZ_FARFIELD_CELL_POINTS 8
+#define VIZ_FARFIELD_TOLERANCE   1e-8
 
-int matrixInvert( int N, double input[], double output[] );
+static int choleskyFactor( int N, double *K, int nStride );
+static int luSolve( int N, double *A, int nRHS, double **papdfB );
 
 void VizGeorefSpline2D::grow_points()
 
@@ -170,8 +183,9 @@ int VizGeorefSpline2D::delete_point(const double Px, const double Py )
 
 int VizGeorefSpline2D::solve(void)
 {
-    int r, c, v;
     int p;
+
+    free_farfield();
 	
     //	No points at all
     if ( _nof_points < 1 )
@@ -274,77 +288,317 @@ int VizGeorefSpline2D::solve(void)
     }
 	
     type = VIZ_GEOREF_SPLINE_FULL;
-    // Make the necessary memory allocations
-    if ( _AA )
-        CPLFree(_AA);
-    if ( _Ainv )
-        CPLFree(_Ainv);
-	
+
     _nof_eqs = _nof_points + 3;
-	
-    _AA = ( double * )CPLCalloc( _nof_eqs * _nof_eqs, sizeof( double ) );
-    _Ainv = ( double * )CPLCalloc( _nof_eqs * _nof_eqs, sizeof( double ) );
-	
-    // Calc the values of the matrix A
-    for ( r = 0; r < 3; r++ )
-        for ( c = 0; c < 3; c++ )
-            A(r,c) = 0.0;
-		
-    for ( c = 0; c < _nof_points; c++ )
+
+    // GDAL_TPS_SOLVER=LU and GDAL_TPS_FARFIELD=NO select the plain dense
+    // solve and the exact evaluation, as a reference for gdaltpsbench.
+    int bSolved = FALSE;
+
+    if ( !EQUAL(CPLGetConfigOption( "GDAL_TPS_SOLVER", "NULLSPACE" ), "LU") )
     {
-        A(0,c+3) = 1.0;
-        A(1,c+3) = x[c];
-        A(2,c+3) = y[c];
-			
-        A(c+3,0) = 1.0;
-        A(c+3,1) = x[c];
-        A(c+3,2) = y[c];
+        bSolved = solve_nullspace();
+
+        // The kernel restricted to the null space of the affine terms
+        // should be positive definite, unless some points are (nearly)
+        // duplicated.  Fall back to solving the whole system with pivoting.
+        if ( !bSolved )
+            CPLDebug( "TPS", 
+                      "Cholesky factorization failed, using LU factorization" );
     }
-		
-    for ( r = 0; r < _nof_points; r++ )
-        for ( c = r; c < _nof_points; c++ )
+
+    if ( !bSolved && !solve_lu() )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "There is a problem to solve the interpolation system" );
+        return(0);
+    }
+
+    if ( _nof_points >= VIZ_FARFIELD_MIN_POINTS
+         && CSLTestBoolean( CPLGetConfigOption( "GDAL_TPS_FARFIELD", "YES" ) ) )
+        build_farfield();
+
+    return(4);
+}
+
+/************************************************************************/
+/*                          solve_nullspace()                           */
+/*                                                                      */
+/*      The system to solve is                                          */
+/*                                                                      */
+/*          K w + P a = rhs                                             */
+/*          P^T w     = 0                                               */
+/*                                                                      */
+/*      with K the kernel matrix of the points, P the [1 x y] matrix    */
+/*      of their affine terms, w the kernel weights and a the affine    */
+/*      coefficients.  With P = Q [R; 0] the QR factorization of P,     */
+/*      the weights are w = Q [0; t], with t solution of                */
+/*                                                                      */
+/*          (Q^T K Q)22 t = (Q^T rhs)2                                  */
+/*                                                                      */
+/*      whose matrix is positive definite for distinct points, and      */
+/*      then a = R^-1 ((Q^T rhs)1 - (Q^T K Q)12 t).  Q is the product    */
+/*      of three Householder reflections, so that forming Q^T K Q is    */
+/*      cheap, and a Cholesky factorization is about six times faster   */
+/*      than the LU factorization of the whole system.                  */
+/************************************************************************/
+
+int VizGeorefSpline2D::solve_nullspace()
+
+{
+    const int N = _nof_points;
+    const int M = N - 3;
+    int r, c, v, j;
+
+    double *K = (double *) VSIMalloc3( N, N, sizeof(double) );
+    double *V = (double *) VSIMalloc3( 3, N, sizeof(double) );
+    double *P = (double *) VSIMalloc3( 3, N, sizeof(double) );
+    double *work = (double *) VSIMalloc2( N, sizeof(double) );
+
+    if ( K == NULL || V == NULL || P == NULL || work == NULL )
+    {
+        CPLFree( K );
+        CPLFree( V );
+        CPLFree( P );
+        CPLFree( work );
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Out of memory in VizGeorefSpline2D::solve()" );
+        return 0;
+    }
+
+    for ( r = 0; r < N; r++ )
+    {
+        K[r * N + r] = 0.0;
+        for ( c = 0; c < r; c++ )
+            K[r * N + c] = K[c * N + r] =
+                base_func( x[r], y[r], x[c], y[c] );
+
+        P[r] = 1.0;
+        P[N + r] = x[r];
+        P[2 * N + r] = y[r];
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Householder QR factorization of P, the columns of P being       */
+/*      stored contiguously.  V holds the reflection vectors, with an   */
+/*      implicit 1 at their diagonal element.                           */
+/* -------------------------------------------------------------------- */
+    double tau[3], R[3][3];
+    int    bOK = TRUE;
+
+    for ( j = 0; j < 3 && bOK; j++ )
+    {
+        double *pj = P + j * N;
+        double *vj = V + j * N;
+        double alpha = pj[j], sigma = 0.0, beta, norm = 0.0;
+
+        for ( r = 0; r < N; r++ )
+            norm += P[j * N + r] * P[j * N + r];
+
+        for ( r = j + 1; r < N; r++ )
+            sigma += pj[r] * pj[r];
+
+        beta = sqrt( alpha * alpha + sigma );
+        if ( alpha > 0 )
+            beta = -beta;
+
+        // Collinear points: R would be singular.
+        if ( fabs( beta ) <= 1e-10 * sqrt( norm ) )
+        {
+            bOK = FALSE;
+            break;
+        }
+
+        tau[j] = ( beta - alpha ) / beta;
+        for ( r = 0; r < j; r++ )
+            vj[r] = 0.0;
+        vj[j] = 1.0;
+        for ( r = j + 1; r < N; r++ )
+            vj[r] = pj[r] / ( alpha - beta );
+
+        R[j][j] = beta;
+        for ( c = j + 1; c < 3; c++ )
         {
-            A(r+3,c+3) = base_func( x[r], y[r], x[c], y[c] );
-            if ( r != c )
-                A(c+3,r+3 ) = A(r+3,c+3);
+            double *pc = P + c * N, dot = 0.0;
+
+            for ( r = j; r < N; r++ )
+                dot += vj[r] * pc[r];
+            dot *= tau[j];
+            for ( r = j; r < N; r++ )
+                pc[r] -= dot * vj[r];
+            R[j][c] = pc[j];
         }
-			
-#if VIZ_GEOREF_SPLINE_DEBUG
-			
-    for ( r = 0; r < _nof_eqs; r++ )
+    }
+
+/* -------------------------------------------------------------------- */
+/*      K <- H K H for each reflection H = I - tau v v^T, as the        */
+/*      symmetric rank 2 update K - v q^T - q v^T, with p = tau K v     */
+/*      and q = p - tau/2 (p.v) v.                                      */
+/* -------------------------------------------------------------------- */
+    for ( j = 0; j < 3 && bOK; j++ )
     {
-        for ( c = 0; c < _nof_eqs; c++ )
-            fprintf(stderr, "%f", A(r,c));
-        fprintf(stderr, "\n");
+        double *vj = V + j * N, pv = 0.0;
+
+        for ( r = 0; r < N; r++ )
+        {
+            double *Kr = K + r * N, dot = 0.0;
+
+            for ( c = j; c < N; c++ )
+                dot += Kr[c] * vj[c];
+            work[r] = tau[j] * dot;
+        }
+        for ( r = j; r < N; r++ )
+            pv += work[r] * vj[r];
+        for ( r = 0; r < N; r++ )
+            work[r] -= 0.5 * tau[j] * pv * vj[r];
+
+        for ( r = 0; r < N; r++ )
+        {
+            double *Kr = K + r * N;
+
+            for ( c = 0; c < N; c++ )
+                Kr[c] -= vj[r] * work[c] + work[r] * vj[c];
+        }
     }
-			
-#endif
-			
-    // Invert the matrix
-    int status = matrixInvert( _nof_eqs, _AA, _Ainv );
-			
-    if ( !status )
+
+/* -------------------------------------------------------------------- */
+/*      Factorize the trailing block, and solve for each variable.      */
+/* -------------------------------------------------------------------- */
+    if ( bOK )
+        bOK = choleskyFactor( M, K + 3 * N + 3, N );
+
+    for ( v = 0; v < _nof_vars && bOK; v++ )
+    {
+        double *z = work;
+
+        // z = Q^T rhs
+        memcpy( z, rhs[v] + 3, sizeof(double) * N );
+        for ( j = 0; j < 3; j++ )
+        {
+            double *vj = V + j * N, dot = 0.0;
+
+            for ( r = j; r < N; r++ )
+                dot += vj[r] * z[r];
+            dot *= tau[j];
+            for ( r = j; r < N; r++ )
+                z[r] -= dot * vj[r];
+        }
+
+        // L L^T t = z2, t overwriting z2
+        double *t = z + 3;
+        const double *L = K + 3 * N + 3;
+
+        for ( r = 0; r < M; r++ )
+        {
+            const double *Lr = L + (size_t) r * N;
+            double sum = t[r];
+
+            for ( c = 0; c < r; c++ )
+                sum -= Lr[c] * t[c];
+            t[r] = sum / Lr[r];
+        }
+        for ( r = M - 1; r >= 0; r-- )
+        {
+            const double *Lr = L + (size_t) r * N;
+
+            t[r] /= Lr[r];
+            for ( c = 0; c < r; c++ )
+                t[c] -= Lr[c] * t[r];
+        }
+
+        // a = R^-1 (z1 - (Q^T K Q)12 t)
+        double a[3];
+
+        for ( j = 0; j < 3; j++ )
+        {
+            const double *Kj = K + j * N + 3;
+
+            a[j] = z[j];
+            for ( c = 0; c < M; c++ )
+                a[j] -= Kj[c] * t[c];
+        }
+        for ( j = 2; j >= 0; j-- )
+        {
+            for ( c = j + 1; c < 3; c++ )
+                a[j] -= R[j][c] * a[c];
+            a[j] /= R[j][j];
+        }
+
+        // w = Q [0; t]
+        z[0] = z[1] = z[2] = 0.0;
+        for ( j = 2; j >= 0; j-- )
+        {
+            double *vj = V + j * N, dot = 0.0;
+
+            for ( r = j; r < N; r++ )
+                dot += vj[r] * z[r];
+            dot *= tau[j];
+            for ( r = j; r < N; r++ )
+                z[r] -= dot * vj[r];
+        }
+
+        for ( j = 0; j < 3; j++ )
+            coef[v][j] = a[j];
+        memcpy( coef[v] + 3, z, sizeof(double) * N );
+    }
+
+    CPLFree( K );
+    CPLFree( V );
+    CPLFree( P );
+    CPLFree( work );
+
+    return bOK;
+}
+
+/************************************************************************/
+/*                              solve_lu()                              */
+/*                                                                      */
+/*      Solve the whole system by LU factorization with partial         */
+/*      pivoting.                                                       */
+/************************************************************************/
+
+int VizGeorefSpline2D::solve_lu()
+
+{
+    const int N = _nof_eqs;
+    int r, c, v;
+
+    double *A = (double *) VSIMalloc3( N, N, sizeof(double) );
+
+    if ( A == NULL )
     {
-        fprintf(stderr, " There is a problem to invert the interpolation matrix\n");
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Out of memory in VizGeorefSpline2D::solve()" );
         return 0;
     }
-			
-    // calc the coefs
+
+    memset( A, 0, sizeof(double) * 3 * N );
+    for ( c = 0; c < _nof_points; c++ )
+    {
+        double *Ac = A + (size_t) (c + 3) * N;
+
+        A[c+3] = Ac[0] = 1.0;
+        A[N + c+3] = Ac[1] = x[c];
+        A[2*N + c+3] = Ac[2] = y[c];
+
+        for ( r = 0; r < _nof_points; r++ )
+            Ac[r+3] = base_func( x[c], y[c], x[r], y[r] );
+    }
+
     for ( v = 0; v < _nof_vars; v++ )
-        for ( r = 0; r < _nof_eqs; r++ )
-        {
-            coef[v][r] = 0.0;
-            for ( c = 0; c < _nof_eqs; c++ )
-                coef[v][r] += Ainv(r,c) * rhs[v][c];
-        }
-				
-    return(4);
+        memcpy( coef[v], rhs[v], sizeof(double) * N );
+
+    int bOK = luSolve( N, A, _nof_vars, coef );
+
+    CPLFree( A );
+
+    return bOK;
 }
 
 int VizGeorefSpline2D::get_point( const double Px, const double Py, double *vars )
 {
 	int v, r;
-	double tmp, Pu;
+	double Pu;
 	double fact;
 	int leftP=0, rightP=0, found = 0;
 	
@@ -392,15 +646,8 @@ int VizGeorefSpline2D::get_point( const double Px, const double Py, double *vars
 			fact * rhs[v][rightP+3];
 		break;
 	case VIZ_GEOREF_SPLINE_FULL :
-		for ( v = 0; v < _nof_vars; v++ )
-			vars[v] = coef[v][0] + coef[v][1] * Px + coef[v][2] * Py;
-		
-		for ( r = 0; r < _nof_points; r++ )
-		{
-			tmp = base_func( Px, Py, x[r], y[r] );
-			for ( v= 0; v < _nof_vars; v++ )
-				vars[v] += coef[v][r+3] * tmp;
-		}
+		if ( _far_values == NULL || !get_point_farfield( Px, Py, vars ) )
+			get_point_exact( Px, Py, vars );
 		break;
 	case VIZ_GEOREF_SPLINE_POINT_WAS_ADDED :
 		fprintf(stderr, " A point was added after the last solve\n");
@@ -423,148 +670,541 @@ int VizGeorefSpline2D::get_point( const double Px, const double Py, double *vars
 	return(1);
 }
 
-double VizGeorefSpline2D::base_func( const double x1, const double y1,
-						  const double x2, const double y2 )
+/************************************************************************/
+/*                          get_point_exact()                           */
+/************************************************************************/
+
+void VizGeorefSpline2D::get_point_exact( const double Px, const double Py, 
+                                         double *vars )
+
 {
-	if ( ( x1 == x2 ) && (y1 == y2 ) )
-		return 0.0;
-	
-	double dist  = ( x2 - x1 ) * ( x2 - x1 ) + ( y2 - y1 ) * ( y2 - y1 );
-	
-	return dist * log( dist );	
+    int v, r;
+    double tmp;
+
+    for ( v = 0; v < _nof_vars; v++ )
+        vars[v] = coef[v][0] + coef[v][1] * Px + coef[v][2] * Py;
+		
+    for ( r = 0; r < _nof_points; r++ )
+    {
+        tmp = base_func( Px, Py, x[r], y[r] );
+        for ( v= 0; v < _nof_vars; v++ )
+            vars[v] += coef[v][r+3] * tmp;
+    }
 }
 
-int matrixInvert( int N, double input[], double output[] )
+/************************************************************************/
+/*                           build_farfield()                           */
+/*                                                                      */
+/*      Evaluating the spline costs one logarithm per point.  With      */
+/*      many points, the points are bucketed in cells of about          */
+/*      VIZ_FARFIELD_CELL_POINTS points, and within a cell the sum of   */
+/*      the affine terms and of the kernels of the points more than     */
+/*      two cells away, which is smooth there, is interpolated by a     */
+/*      polynomial at Chebyshev nodes.  Only the kernels of the nearby  */
+/*      points are then evaluated.  The approximation is checked        */
+/*      against the exact spline in every cell and at the points, and   */
+/*      dropped if its error exceeds VIZ_FARFIELD_TOLERANCE times the   */
+/*      range of the values.                                            */
+/************************************************************************/
+
+int VizGeorefSpline2D::build_farfield()
+
 {
-    // Receives an array of dimension NxN as input.  This is passed as a one-
-    // dimensional array of N-squared size.  It produces the inverse of the
-    // input matrix, returned as output, also of size N-squared.  The Gauss-
-    // Jordan Elimination method is used.  (Adapted from a BASIC routine in
-    // "Basic Scientific Subroutines Vol. 1", courtesy of Scott Edwards.)
-	
-    // Array elements 0...N-1 are for the first row, N...2N-1 are for the
-    // second row, etc.
-	
-    // We need to have a temporary array of size N x 2N.  We'll refer to the
-    // "left" and "right" halves of this array.
-	
-    int row, col;
-	
-#if 0
-    fprintf(stderr, "Matrix Inversion input matrix (N=%d)\n", N);
-    for ( row=0; row<N; row++ )
+    const int nOrder = VIZ_FARFIELD_ORDER;
+    const int nStride = 2 + _nof_vars;
+    int i, v, cx, cy, a, b;
+
+/* -------------------------------------------------------------------- */
+/*      Setup cells of about the same size in x and y over the points.  */
+/* -------------------------------------------------------------------- */
+    double xmin = x[0], xmax = x[0], ymin = y[0], ymax = y[0];
+
+    for ( i = 1; i < _nof_points; i++ )
+    {
+        xmin = MIN( xmin, x[i] );
+        xmax = MAX( xmax, x[i] );
+        ymin = MIN( ymin, y[i] );
+        ymax = MAX( ymax, y[i] );
+    }
+
+    double dfCells = _nof_points / (double) VIZ_FARFIELD_CELL_POINTS;
+    double dfAspect = ( xmax - xmin ) / ( ymax - ymin );
+
+    _far_nx = MAX( 1, (int) ( sqrt( dfCells * dfAspect ) + 0.5 ) );
+    _far_ny = MAX( 1, (int) ( dfCells / _far_nx + 0.5 ) );
+
+    // Without cells beyond the near ones, nothing would be gained.
+    if ( _far_nx < 8 || _far_ny < 8 )
+    {
+        _far_nx = _far_ny = 0;
+        return FALSE;
+    }
+
+    _far_x0 = xmin;
+    _far_y0 = ymin;
+    _far_dx = ( xmax - xmin ) / _far_nx;
+    _far_dy = ( ymax - ymin ) / _far_ny;
+
+    const int nCells = _far_nx * _far_ny;
+
+    _far_start = (int *) VSICalloc( nCells + 1, sizeof(int) );
+    _far_points = (double *) VSIMalloc3( _nof_points, nStride, 
+                                         sizeof(double) );
+    _far_values = (double *) VSIMalloc3( nCells, 
+                                         nOrder * nOrder * _nof_vars,
+                                         sizeof(double) );
+    int *panCell = (int *) VSIMalloc2( _nof_points, sizeof(int) );
+
+    if ( _far_start == NULL || _far_points == NULL || _far_values == NULL 
+         || panCell == NULL )
     {
-        for ( col=0; col<N; col++ )
+        CPLFree( panCell );
+        free_farfield();
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Sort the points by cell.                                        */
+/* -------------------------------------------------------------------- */
+    for ( i = 0; i < _nof_points; i++ )
+    {
+        cx = MIN( _far_nx - 1, (int) ( ( x[i] - _far_x0 ) / _far_dx ) );
+        cy = MIN( _far_ny - 1, (int) ( ( y[i] - _far_y0 ) / _far_dy ) );
+        panCell[i] = cy * _far_nx + cx;
+        _far_start[panCell[i] + 1]++;
+    }
+
+    for ( i = 0; i < nCells; i++ )
+        _far_start[i + 1] += _far_start[i];
+
+    for ( i = 0; i < _nof_points; i++ )
+    {
+        double *pt = _far_points + (size_t) nStride * _far_start[panCell[i]]++;
+
+        pt[0] = x[i];
+        pt[1] = y[i];
+        for ( v = 0; v < _nof_vars; v++ )
+            pt[2 + v] = coef[v][i + 3];
+    }
+
+    for ( i = nCells; i > 0; i-- )
+        _far_start[i] = _far_start[i - 1];
+    _far_start[0] = 0;
+
+    CPLFree( panCell );
+
+/* -------------------------------------------------------------------- */
+/*      Compute the far field at the Chebyshev nodes of each cell.      */
+/* -------------------------------------------------------------------- */
+    for ( a = 0; a < nOrder; a++ )
+    {
+        double theta = ( 2 * a + 1 ) * M_PI / ( 2 * nOrder );
+
+        _cheb_t[a] = cos( theta );
+        _cheb_w[a] = ( a % 2 ? -1 : 1 ) * sin( theta );
+    }
+
+    double adfExact[VIZGEOREF_MAX_VARS], adfNear[VIZGEOREF_MAX_VARS];
+
+    for ( cy = 0; cy < _far_ny; cy++ )
+    {
+        for ( cx = 0; cx < _far_nx; cx++ )
         {
-            fprintf(stderr, "%5.2f ", input[row*N + col ]  );
+            double *F = _far_values 
+                + (size_t) (cy * _far_nx + cx) * nOrder * nOrder * _nof_vars;
+
+            for ( b = 0; b < nOrder; b++ )
+            {
+                double Py = _far_y0 + ( cy + 0.5 * ( _cheb_t[b] + 1 ) ) * _far_dy;
+
+                for ( a = 0; a < nOrder; a++ )
+                {
+                    double Px = _far_x0 
+                        + ( cx + 0.5 * ( _cheb_t[a] + 1 ) ) * _far_dx;
+
+                    get_point_exact( Px, Py, adfExact );
+                    for ( v = 0; v < _nof_vars; v++ )
+                        adfNear[v] = 0.0;
+                    add_near_field( cx, cy, Px, Py, adfNear );
+
+                    for ( v = 0; v < _nof_vars; v++ )
+                        F[(v * nOrder + b) * nOrder + a] = 
+                            adfExact[v] - adfNear[v];
+                }
+            }
         }
-        fprintf(stderr, "\n");
     }
-#endif
-	
-    int tempSize = 2 * N * N;
-    double* temp = (double*) new double[ tempSize ];
-    double ftemp;
-	
-    if (temp == 0) {
-		
-        fprintf(stderr, "matrixInvert(): ERROR - memory allocation failed.\n");
-        return false;
+
+/* -------------------------------------------------------------------- */
+/*      Check the approximation at a point inside each cell, and at     */
+/*      the points themselves.                                          */
+/* -------------------------------------------------------------------- */
+    double dfMaxError = 0.0, dfRange = 0.0;
+    double adfApprox[VIZGEOREF_MAX_VARS];
+
+    for ( v = 0; v < _nof_vars; v++ )
+    {
+        double dfMin = rhs[v][3], dfMax = rhs[v][3];
+
+        for ( i = 1; i < _nof_points; i++ )
+        {
+            dfMin = MIN( dfMin, rhs[v][i + 3] );
+            dfMax = MAX( dfMax, rhs[v][i + 3] );
+        }
+        dfRange = MAX( dfRange, dfMax - dfMin );
     }
-	
-    // First create a double-width matrix with the input array on the left
-    // and the identity matrix on the right.
-	
-    for ( row=0; row<N; row++ )
+
+    for ( i = 0; i < nCells + _nof_points; i++ )
     {
-        for ( col=0; col<N; col++ )
+        double Px, Py;
+
+        if ( i < nCells )
+        {
+            Px = _far_x0 + ( i % _far_nx + 0.37 ) * _far_dx;
+            Py = _far_y0 + ( i / _far_nx + 0.71 ) * _far_dy;
+            get_point_exact( Px, Py, adfExact );
+        }
+        else
         {
-            // Our index into the temp array is X2 because it's twice as wide
-            // as the input matrix.
-			
-            temp[ 2*row*N + col ] = input[ row*N+col ];	// left = input matrix
-            temp[ 2*row*N + col + N ] = 0.0f;			// right = 0
+            Px = x[i - nCells];
+            Py = y[i - nCells];
+            for ( v = 0; v < _nof_vars; v++ )
+                adfExact[v] = rhs[v][i - nCells + 3];
         }
-        temp[ 2*row*N + row + N ] = 1.0f;		// 1 on the diagonal of RHS
+
+        // Points rounded off the edge of the cells are computed exactly.
+        if ( !get_point_farfield( Px, Py, adfApprox ) )
+            continue;
+
+        for ( v = 0; v < _nof_vars; v++ )
+            dfMaxError = MAX( dfMaxError, fabs( adfApprox[v] - adfExact[v] ) );
     }
-	
-    // Now perform row-oriented operations to convert the left hand side
-    // of temp to the identity matrix.  The inverse of input will then be
-    // on the right.
-	
-    int max;
-    int k=0;
-    for (k = 0; k < N; k++)
-    {
-        if (k+1 < N)	// if not on the last row
-        {              
-            max = k;
-            for (row = k+1; row < N; row++) // find the maximum element
-            {  
-                if (fabs( temp[row*2*N + k] ) > fabs( temp[max*2*N + k] ))
-                {
-                    max = row;
-                }
-            }
-			
-            if (max != k)	// swap all the elements in the two rows
-            {        
-                for (col=k; col<2*N; col++)
-                {
-                    ftemp = temp[k*2*N + col];
-                    temp[k*2*N + col] = temp[max*2*N + col];
-                    temp[max*2*N + col] = ftemp;
-                }
-            }
+
+    CPLDebug( "TPS", "Far field approximation with %dx%d cells, "
+              "relative error %g", 
+              _far_nx, _far_ny, dfMaxError / dfRange );
+
+    if ( !( dfMaxError <= VIZ_FARFIELD_TOLERANCE * dfRange ) )
+    {
+        free_farfield();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                           free_farfield()                            */
+/************************************************************************/
+
+void VizGeorefSpline2D::free_farfield()
+
+{
+    CPLFree( _far_start );
+    CPLFree( _far_points );
+    CPLFree( _far_values );
+    _far_start = NULL;
+    _far_points = NULL;
+    _far_values = NULL;
+    _far_nx = _far_ny = 0;
+}
+
+/************************************************************************/
+/*                             cheb_basis()                             */
+/*                                                                      */
+/*      Values at t in [-1,1] of the Lagrange polynomials of the        */
+/*      Chebyshev nodes, with the barycentric formula.                  */
+/************************************************************************/
+
+void VizGeorefSpline2D::cheb_basis( double t, double *l )
+
+{
+    double sum = 0.0;
+    int k;
+
+    for ( k = 0; k < VIZ_FARFIELD_ORDER; k++ )
+    {
+        double d = t - _cheb_t[k];
+
+        if ( d == 0.0 )
+        {
+            for ( int j = 0; j < VIZ_FARFIELD_ORDER; j++ )
+                l[j] = ( j == k ) ? 1.0 : 0.0;
+            return;
         }
-		
-        ftemp = temp[ k*2*N + k ];
-        if ( ftemp == 0.0f ) // matrix cannot be inverted
+        l[k] = _cheb_w[k] / d;
+        sum += l[k];
+    }
+
+    for ( k = 0; k < VIZ_FARFIELD_ORDER; k++ )
+        l[k] /= sum;
+}
+
+/************************************************************************/
+/*                           add_near_field()                           */
+/*                                                                      */
+/*      Add the kernels of the points of the 5x5 cells around a cell.   */
+/*      The cells of a row being consecutive, so are their points.      */
+/************************************************************************/
+
+void VizGeorefSpline2D::add_near_field( int cx, int cy, 
+                                        const double Px, const double Py,
+                                        double *vars )
+
+{
+    const int nStride = 2 + _nof_vars;
+    const int cx0 = MAX( 0, cx - 2 ), cx1 = MIN( _far_nx - 1, cx + 2 );
+    int row, v;
+
+    for ( row = MAX( 0, cy - 2 ); row <= MIN( _far_ny - 1, cy + 2 ); row++ )
+    {
+        const double *pt = _far_points 
+            + (size_t) nStride * _far_start[row * _far_nx + cx0];
+        const double *ptEnd = _far_points 
+            + (size_t) nStride * _far_start[row * _far_nx + cx1 + 1];
+
+        for ( ; pt < ptEnd; pt += nStride )
         {
-            delete[] temp;
-            return false;
+            double tmp = base_func( Px, Py, pt[0], pt[1] );
+
+            for ( v = 0; v < _nof_vars; v++ )
+                vars[v] += pt[2 + v] * tmp;
         }
-		
-        for ( col=k; col<2*N; col++ )
+    }
+}
+
+/************************************************************************/
+/*                         get_point_farfield()                         */
+/*                                                                      */
+/*      Returns FALSE if the point is outside of the cells.             */
+/************************************************************************/
+
+int VizGeorefSpline2D::get_point_farfield( const double Px, const double Py,
+                                           double *vars )
+
+{
+    const int nOrder = VIZ_FARFIELD_ORDER;
+    double fx = ( Px - _far_x0 ) / _far_dx;
+    double fy = ( Py - _far_y0 ) / _far_dy;
+
+    if ( !( fx >= 0.0 && fx <= _far_nx && fy >= 0.0 && fy <= _far_ny ) )
+        return FALSE;
+
+    int cx = MIN( _far_nx - 1, (int) fx );
+    int cy = MIN( _far_ny - 1, (int) fy );
+    double lx[VIZ_FARFIELD_ORDER], ly[VIZ_FARFIELD_ORDER];
+    int v, a, b;
+
+    cheb_basis( 2 * ( fx - cx ) - 1, lx );
+    cheb_basis( 2 * ( fy - cy ) - 1, ly );
+
+    const double *F = _far_values 
+        + (size_t) (cy * _far_nx + cx) * nOrder * nOrder * _nof_vars;
+
+    for ( v = 0; v < _nof_vars; v++ )
+    {
+        double sum = 0.0;
+
+        for ( b = 0; b < nOrder; b++ )
         {
-            temp[ k*2*N + col ] /= ftemp;
+            const double *Fb = F + (v * nOrder + b) * nOrder;
+            double row = 0.0;
+
+            for ( a = 0; a < nOrder; a++ )
+                row += lx[a] * Fb[a];
+            sum += ly[b] * row;
         }
-		
-        for ( row=0; row<N; row++ )
+        vars[v] = sum;
+    }
+
+    add_near_field( cx, cy, Px, Py, vars );
+
+    return TRUE;
+}
+
+double VizGeorefSpline2D::base_func( const double x1, const double y1,
+						  const double x2, const double y2 )
+{
+	if ( ( x1 == x2 ) && (y1 == y2 ) )
+		return 0.0;
+	
+	double dist  = ( x2 - x1 ) * ( x2 - x1 ) + ( y2 - y1 ) * ( y2 - y1 );
+	
+	return dist * log( dist );	
+}
+
+/************************************************************************/
+/*                           choleskyFactor()                           */
+/*                                                                      */
+/*      In place Cholesky factorization K = L L^T of the lower          */
+/*      triangle of a symmetric matrix of N rows of nStride values.     */
+/*      The factorization proceeds by tiles, each tile of L being       */
+/*      computed from the inner products of the rows of two tiles,      */
+/*      a few hundred columns at a time.  Returns FALSE if the matrix   */
+/*      is not positive definite.                                       */
+/************************************************************************/
+
+static int choleskyFactor( int N, double *K, int nStride )
+
+{
+    int i0, j0, k0, i, j, k;
+
+    for ( i0 = 0; i0 < N; i0 += VIZ_CHOL_TILE )
+    {
+        int i1 = MIN( N, i0 + VIZ_CHOL_TILE );
+
+        for ( j0 = 0; j0 <= i0; j0 += VIZ_CHOL_TILE )
         {
-            if ( row != k )
+            int j1 = MIN( N, j0 + VIZ_CHOL_TILE );
+
+/* -------------------------------------------------------------------- */
+/*      Subtract the contribution of the columns left of the tile,      */
+/*      two rows by two rows so that each value loaded is used twice.   */
+/*      The upper half of the diagonal tiles is computed too, but       */
+/*      never used.                                                     */
+/* -------------------------------------------------------------------- */
+            for ( k0 = 0; k0 < j0; k0 += VIZ_CHOL_DEPTH )
             {
-                ftemp = temp[ row*2*N + k ];
-                for ( col=k; col<2*N; col++ ) 
+                int k1 = MIN( j0, k0 + VIZ_CHOL_DEPTH );
+
+                for ( i = i0; i < i1; i += 2 )
                 {
-                    temp[ row*2*N + col ] -= ftemp * temp[ k*2*N + col ];
+                    const double *Ki = K + (size_t) i * nStride;
+                    const double *Ki1 = ( i + 1 < i1 ) ? Ki + nStride : Ki;
+
+                    for ( j = j0; j < j1; j += 2 )
+                    {
+                        const double *Kj = K + (size_t) j * nStride;
+                        const double *Kj1 = ( j + 1 < j1 ) ? Kj + nStride : Kj;
+                        double s00 = 0.0, s01 = 0.0, s10 = 0.0, s11 = 0.0;
+
+                        for ( k = k0; k < k1; k++ )
+                        {
+                            s00 += Ki[k] * Kj[k];
+                            s01 += Ki[k] * Kj1[k];
+                            s10 += Ki1[k] * Kj[k];
+                            s11 += Ki1[k] * Kj1[k];
+                        }
+
+                        K[(size_t) i * nStride + j] -= s00;
+                        if ( j + 1 < j1 )
+                            K[(size_t) i * nStride + j + 1] -= s01;
+                        if ( i + 1 < i1 )
+                        {
+                            K[(size_t) (i + 1) * nStride + j] -= s10;
+                            if ( j + 1 < j1 )
+                                K[(size_t) (i + 1) * nStride + j + 1] -= s11;
+                        }
+                    }
+                }
+            }
+
+/* -------------------------------------------------------------------- */
+/*      Finish the tile with the columns inside it.                     */
+/* -------------------------------------------------------------------- */
+            for ( i = i0; i < i1; i++ )
+            {
+                double *Ki = K + (size_t) i * nStride;
+                int jEnd = ( j0 == i0 ) ? i + 1 : j1;
+
+                for ( j = j0; j < jEnd; j++ )
+                {
+                    const double *Kj = K + (size_t) j * nStride;
+                    double sum = Ki[j];
+
+                    for ( k = j0; k < j; k++ )
+                        sum -= Ki[k] * Kj[k];
+
+                    if ( i == j )
+                    {
+                        if ( !( sum > 0.0 ) )
+                            return FALSE;
+                        Ki[i] = sqrt( sum );
+                    }
+                    else
+                        Ki[j] = sum / Kj[j];
                 }
             }
         }
     }
-	
-    // Retrieve inverse from the right side of temp
-	
-    for (row = 0; row < N; row++)
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                              luSolve()                               */
+/*                                                                      */
+/*      Solve A X = B by LU factorization of the N x N matrix A with    */
+/*      partial pivoting, A being overwritten.  The nRHS columns of B   */
+/*      are overwritten by the solution.  Returns FALSE if A is         */
+/*      singular.                                                       */
+/************************************************************************/
+
+static int luSolve( int N, double *A, int nRHS, double **papdfB )
+
+{
+    int row, col, k, v;
+
+    for ( k = 0; k < N; k++ )
     {
-        for (col = 0; col < N; col++)
+        double *Ak = A + (size_t) k * N;
+        int     max = k;
+
+        for ( row = k + 1; row < N; row++ )
+            if ( fabs( A[(size_t) row * N + k] ) > fabs( A[(size_t) max * N + k] ) )
+                max = row;
+
+        if ( A[(size_t) max * N + k] == 0.0 )
+            return FALSE;
+
+        if ( max != k )
         {
-            output[row*N + col] = temp[row*2*N + col + N ];
+            double *Amax = A + (size_t) max * N;
+
+            for ( col = 0; col < N; col++ )
+            {
+                double tmp = Ak[col];
+                Ak[col] = Amax[col];
+                Amax[col] = tmp;
+            }
+            for ( v = 0; v < nRHS; v++ )
+            {
+                double tmp = papdfB[v][k];
+                papdfB[v][k] = papdfB[v][max];
+                papdfB[v][max] = tmp;
+            }
+        }
+
+        for ( row = k + 1; row < N; row++ )
+        {
+            double *Arow = A + (size_t) row * N;
+            double  f = Arow[k] / Ak[k];
+
+            if ( f == 0.0 )
+                continue;
+
+            Arow[k] = f;
+            for ( col = k + 1; col < N; col++ )
+                Arow[col] -= f * Ak[col];
+            for ( v = 0; v < nRHS; v++ )
+                papdfB[v][row] -= f * papdfB[v][k];
         }
     }
-	
-#if 0
-    fprintf(stderr, "Matrix Inversion result matrix:\n");
-    for ( row=0; row<N; row++ )
+
+    for ( v = 0; v < nRHS; v++ )
     {
-        for ( col=0; col<N; col++ )
+        double *b = papdfB[v];
+
+        for ( row = N - 1; row >= 0; row-- )
         {
-            fprintf(stderr, "%5.2f ", output[row*N + col ]  );
+            const double *Arow = A + (size_t) row * N;
+            double sum = b[row];
+
+            for ( col = row + 1; col < N; col++ )
+                sum -= Arow[col] * b[col];
+            b[row] = sum / Arow[row];
         }
-        fprintf(stderr, "\n");
     }
-#endif
-	
-    delete [] temp;       // free memory
-    return true;
+
+    return TRUE;
 }
@@ -49,6 +49,9 @@ typedef enum
 //#define VIZ_GEOREF_SPLINE_MAX_POINTS 40
 #define VIZGEOREF_MAX_VARS 2
 
+// Number of Chebyshev nodes per axis of the far field interpolation
+#define VIZ_FARFIELD_ORDER 8
+
 class VizGeorefSpline2D
 {
   public:
@@ -67,21 +70,19 @@ class VizGeorefSpline2D
         _nof_points = 0;
         _nof_vars = nof_vars;
         _max_nof_points = 0;
-        _AA = NULL;
-        _Ainv = NULL;
+        _far_nx = _far_ny = 0;
+        _far_start = NULL;
+        _far_points = NULL;
+        _far_values = NULL;
         grow_points();
         for ( int v = 0; v < _nof_vars; v++ )
             for ( int i = 0; i < 3; i++ )
-                rhs[i][v] = 0.0;
+                rhs[v][i] = 0.0;
         type = VIZ_GEOREF_SPLINE_ZERO_POINTS;
     }
 
     ~VizGeorefSpline2D(){
-        if ( _AA )
-            CPLFree(_AA);
-        if ( _Ainv )
-            CPLFree(_Ainv);
-
+        free_farfield();
         CPLFree( x );
         CPLFree( y );
         CPLFree( u );
@@ -126,16 +127,7 @@ class VizGeorefSpline2D
 	{
             _nof_points = 0;
             type = VIZ_GEOREF_SPLINE_ZERO_POINTS;
-            if ( _AA )
-            {
-                CPLFree(_AA);
-                _AA = NULL;
-            }
-            if ( _Ainv )
-            {
-                CPLFree(_Ainv);
-                _Ainv = NULL;
-            }
+            free_farfield();
             return _nof_points;
 	}
 
@@ -149,6 +141,18 @@ class VizGeorefSpline2D
     int solve(void);
 
   private:	
+    int solve_nullspace(void);
+    int solve_lu(void);
+
+    void get_point_exact( const double Px, const double Py, double *vars );
+
+    int build_farfield(void);
+    void free_farfield(void);
+    int get_point_farfield( const double Px, const double Py, double *vars );
+    void add_near_field( int cx, int cy, const double Px, const double Py,
+                         double *vars );
+    void cheb_basis( double t, double *l );
+
     double base_func( const double x1, const double y1,
                       const double x2, const double y2 );
 
@@ -174,8 +178,18 @@ class VizGeorefSpline2D
     double *u; // [VIZ_GEOREF_SPLINE_MAX_POINTS];
     int *unused; // [VIZ_GEOREF_SPLINE_MAX_POINTS];
     int *index; // [VIZ_GEOREF_SPLINE_MAX_POINTS];
-	
-    double *_AA, *_Ainv;
+
+    // Far field approximation: the points are bucketed in cells, and
+    // within a cell the contribution of the points more than two cells
+    // away (and the affine terms) is interpolated from its values at
+    // Chebyshev nodes.
+    int _far_nx, _far_ny;
+    double _far_x0, _far_y0, _far_dx, _far_dy;
+    int *_far_start;        // first point of each cell, in _far_points
+    double *_far_points;    // x, y and the coefficients, by cell
+    double *_far_values;    // values at the nodes, for each cell
+    double _cheb_t[VIZ_FARFIELD_ORDER];
+    double _cheb_w[VIZ_FARFIELD_ORDER];
 };
 
 
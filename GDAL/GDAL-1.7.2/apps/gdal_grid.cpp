@@ -543,53 +543,14 @@ static void ProcessLayer( OGRLayerH hSrcLayer, GDALDatasetH hDstDS,
         return;
     }
 
-    GUInt32 nXOffset, nYOffset;
-    int     nBlockXSize, nBlockYSize;
-
-    GDALGetBlockSize( hBand, &nBlockXSize, &nBlockYSize );
-    void    *pData =
-        CPLMalloc( nBlockXSize * nBlockYSize * GDALGetDataTypeSize(eType) );
-
-    GUInt32 nBlock = 0;
-    GUInt32 nBlockCount = ((nXSize + nBlockXSize - 1) / nBlockXSize)
-        * ((nYSize + nBlockYSize - 1) / nBlockYSize);
-
-    for ( nYOffset = 0; nYOffset < nYSize; nYOffset += nBlockYSize )
-    {
-        for ( nXOffset = 0; nXOffset < nXSize; nXOffset += nBlockXSize )
-        {
-            void *pScaledProgress;
-            pScaledProgress =
-                GDALCreateScaledProgress( 0.0,
-                                          (double)++nBlock / nBlockCount,
-                                          pfnProgress, NULL );
-
-            int nXRequest = nBlockXSize;
-            if (nXOffset + nXRequest > nXSize)
-                nXRequest = nXSize - nXOffset;
-
-            int nYRequest = nBlockYSize;
-            if (nYOffset + nYRequest > nYSize)
-                nYRequest = nYSize - nYOffset;
-
-            GDALGridCreate( eAlgorithm, pOptions,
-                            adfX.size(), &(adfX[0]), &(adfY[0]), &(adfZ[0]),
-                            dfXMin + dfDeltaX * nXOffset,
-                            dfXMin + dfDeltaX * (nXOffset + nXRequest),
-                            dfYMin + dfDeltaY * nYOffset,
-                            dfYMin + dfDeltaY * (nYOffset + nYRequest),
-                            nXRequest, nYRequest, eType, pData,
-                            GDALScaledProgress, pScaledProgress );
-
-            GDALRasterIO( hBand, GF_Write, nXOffset, nYOffset,
-                          nXRequest, nYRequest, pData,
-                          nXRequest, nYRequest, eType, 0, 0 );
-
-            GDALDestroyScaledProgress( pScaledProgress );
-        }
-    }
-
-    CPLFree( pData );
+/* -------------------------------------------------------------------- */
+/*      The lines are computed and written by chunks, on as many        */
+/*      threads as set by GDAL_NUM_THREADS.                             */
+/* -------------------------------------------------------------------- */
+    GDALGridCreateToBand( eAlgorithm, pOptions,
+                          adfX.size(), &(adfX[0]), &(adfY[0]), &(adfZ[0]),
+                          dfXMin, dfXMax, dfYMin, dfYMax, hBand, NULL,
+                          pfnProgress, NULL );
 }
 
 /************************************************************************/
@@ -57,6 +57,9 @@ static void Usage()
             "  --config PHOTOMETRIC_OVERVIEW {RGB,YCBCR,...} : TIFF photometric interp.\n"
             "  --config INTERLEAVE_OVERVIEW {PIXEL|BAND} : TIFF interleaving method\n"
             "  --config BIGTIFF_OVERVIEW {IF_NEEDED|IF_SAFER|YES|NO} : is BigTIFF used\n"
+            "For all overview formats:\n"
+            "  --config GDAL_NUM_THREADS {n|ALL_CPUS} : number of threads used\n"
+            "                                          to compute the overviews\n"
             "\n"
             "Examples:\n"
             " %% gdaladdo -r average abc.tif 2 4 8 16\n"
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Utilities
+ * Purpose:  Micro-benchmark of GDALCopyWords() for all data type pairs
+ *           and common pixel strides.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "gdal.h"
+#include "cpl_string.h"
+#include "cpl_conv.h"
+#include <time.h>
+
+CPL_CVSID("$Id$");
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+
+{
+    printf( "Usage: gdalcopywordsbench [-n words] [-i iterations]\n"
+            "                          [-src type] [-dst type]\n"
+            "                          [-srcstep n] [-dststep n]\n"
+            "\n"
+            "Times GDALCopyWords() for every source / destination data type\n"
+            "pair (or the ones selected) with packed buffers and with one\n"
+            "side interleaved with a step of 3 or 4 words (or the selected\n"
+            "steps).  Use --config GDAL_USE_SIMD NO to time the generic\n"
+            "code.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                             BenchPair()                              */
+/************************************************************************/
+
+static void BenchPair( GDALDataType eSrcType, int nSrcStep,
+                       GDALDataType eDstType, int nDstStep,
+                       int nWordCount, int nIterations )
+
+{
+    int nSrcWordSize = GDALGetDataTypeSize( eSrcType ) / 8;
+    int nDstWordSize = GDALGetDataTypeSize( eDstType ) / 8;
+    GByte *pabySrc, *pabyDst;
+
+    pabySrc = (GByte *) VSIMalloc3( nWordCount, nSrcWordSize, nSrcStep );
+    pabyDst = (GByte *) VSIMalloc3( nWordCount, nDstWordSize, nDstStep );
+    if( pabySrc == NULL || pabyDst == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        CPLFree( pabySrc );
+        CPLFree( pabyDst );
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Fill the source with values spanning (and exceeding) the range  */
+/*      of the small integer types so that clamping is exercised.       */
+/* -------------------------------------------------------------------- */
+    double *padfValues = (double *) CPLMalloc( sizeof(double) * nWordCount );
+    int     i;
+
+    for( i = 0; i < nWordCount; i++ )
+        padfValues[i] = ((i * 7919) % 70001) - 2000 + (i % 4) * 0.25;
+
+    GDALCopyWords( padfValues, GDT_Float64, sizeof(double),
+                   pabySrc, eSrcType, nSrcWordSize * nSrcStep, nWordCount );
+    CPLFree( padfValues );
+
+/* -------------------------------------------------------------------- */
+/*      Time the copies.                                                */
+/* -------------------------------------------------------------------- */
+    clock_t nStart = clock();
+
+    for( i = 0; i < nIterations; i++ )
+        GDALCopyWords( pabySrc, eSrcType, nSrcWordSize * nSrcStep,
+                       pabyDst, eDstType, nDstWordSize * nDstStep,
+                       nWordCount );
+
+    double dfSeconds = (clock() - nStart) / (double) CLOCKS_PER_SEC;
+    double dfMWords = nWordCount * (double) nIterations / 1e6;
+
+    printf( "%-9s step %d -> %-9s step %d : %9.1f Mwords/s\n",
+            GDALGetDataTypeName( eSrcType ), nSrcStep,
+            GDALGetDataTypeName( eDstType ), nDstStep,
+            dfSeconds > 0 ? dfMWords / dfSeconds : 0.0 );
+
+    CPLFree( pabySrc );
+    CPLFree( pabyDst );
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int nWordCount = 1024 * 1024, nIterations = 20;
+    int nSrcStep = 0, nDstStep = 0;
+    GDALDataType eSrcType = GDT_Unknown, eDstType = GDT_Unknown;
+    int i;
+
+    argc = GDALGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( EQUAL(argv[i],"-n") && i < argc-1 )
+            nWordCount = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-i") && i < argc-1 )
+            nIterations = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-srcstep") && i < argc-1 )
+            nSrcStep = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-dststep") && i < argc-1 )
+            nDstStep = atoi(argv[++i]);
+        else if( (EQUAL(argv[i],"-src") || EQUAL(argv[i],"-dst"))
+                 && i < argc-1 )
+        {
+            GDALDataType eType = GDALGetDataTypeByName( argv[i+1] );
+
+            if( eType == GDT_Unknown )
+            {
+                fprintf( stderr, "Unknown data type '%s'.\n", argv[i+1] );
+                Usage();
+            }
+            if( EQUAL(argv[i],"-src") )
+                eSrcType = eType;
+            else
+                eDstType = eType;
+            i++;
+        }
+        else
+            Usage();
+    }
+
+    if( nWordCount < 1 || nIterations < 1 || nSrcStep < 0 || nDstStep < 0 )
+        Usage();
+
+/* -------------------------------------------------------------------- */
+/*      Loop over the selected type pairs and strides.                  */
+/* -------------------------------------------------------------------- */
+    static const int anSteps[][2] = { {1, 1}, {1, 3}, {1, 4}, {3, 1}, {4, 1} };
+    int iSrcType, iDstType, iStep;
+
+    for( iSrcType = 1; iSrcType < GDT_TypeCount; iSrcType++ )
+    {
+        if( eSrcType != GDT_Unknown && iSrcType != eSrcType )
+            continue;
+
+        for( iDstType = 1; iDstType < GDT_TypeCount; iDstType++ )
+        {
+            if( eDstType != GDT_Unknown && iDstType != eDstType )
+                continue;
+
+            if( nSrcStep > 0 || nDstStep > 0 )
+            {
+                BenchPair( (GDALDataType) iSrcType, MAX(1,nSrcStep),
+                           (GDALDataType) iDstType, MAX(1,nDstStep),
+                           nWordCount, nIterations );
+                continue;
+            }
+
+            for( iStep = 0; iStep < (int) (sizeof(anSteps)/sizeof(anSteps[0]));
+                 iStep++ )
+                BenchPair( (GDALDataType) iSrcType, anSteps[iStep][0],
+                           (GDALDataType) iDstType, anSteps[iStep][1],
+                           nWordCount, nIterations );
+        }
+    }
+
+    CSLDestroy( argv );
+    GDALDestroyDriverManager();
+
+    return 0;
+}
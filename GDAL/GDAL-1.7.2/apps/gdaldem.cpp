@@ -89,6 +89,7 @@
 #include "cpl_string.h"
 #include "gdal.h"
 #include "gdal_priv.h"
+#include "gdal_alg.h"
 
 CPL_CVSID("$Id: gdaldem.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -145,362 +146,6 @@ static void Usage()
     exit( 1 );
 }
 
-/************************************************************************/
-/*                  GDALGeneric3x3Processing()                          */
-/************************************************************************/
-
-typedef float (*GDALGeneric3x3ProcessingAlg) (float* pafWindow, float fDstNoDataValue, void* pData);
-
-CPLErr GDALGeneric3x3Processing  ( GDALRasterBandH hSrcBand,
-                                   GDALRasterBandH hDstBand,
-                                   GDALGeneric3x3ProcessingAlg pfnAlg,
-                                   void* pData,
-                                   GDALProgressFunc pfnProgress,
-                                   void * pProgressData)
-{
-    CPLErr eErr;
-    float *pafThreeLineWin; /* 3 line rotating source buffer */
-    float *pafOutputBuf;     /* 1 line destination buffer */
-    int i, j;
-
-    int bSrcHasNoData, bDstHasNoData;
-    float fSrcNoDataValue = 0.0, fDstNoDataValue = 0.0;
-
-    int nXSize = GDALGetRasterBandXSize(hSrcBand);
-    int nYSize = GDALGetRasterBandYSize(hSrcBand);
-
-    if (pfnProgress == NULL)
-        pfnProgress = GDALDummyProgress;
-
-/* -------------------------------------------------------------------- */
-/*      Initialize progress counter.                                    */
-/* -------------------------------------------------------------------- */
-    if( !pfnProgress( 0.0, NULL, pProgressData ) )
-    {
-        CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-        return CE_Failure;
-    }
-
-    pafOutputBuf = (float *) CPLMalloc(sizeof(float)*nXSize);
-    pafThreeLineWin  = (float *) CPLMalloc(3*sizeof(float)*(nXSize+1));
-
-    fSrcNoDataValue = (float) GDALGetRasterNoDataValue(hSrcBand, &bSrcHasNoData);
-    fDstNoDataValue = (float) GDALGetRasterNoDataValue(hDstBand, &bDstHasNoData);
-    if (!bDstHasNoData)
-        fDstNoDataValue = 0.0;
-
-    // Move a 3x3 pafWindow over each cell 
-    // (where the cell in question is #4)
-    // 
-    //      0 1 2
-    //      3 4 5
-    //      6 7 8
-
-    /* Preload the first 2 lines */
-    for ( i = 0; i < 2 && i < nYSize; i++)
-    {
-        GDALRasterIO(   hSrcBand,
-                        GF_Read,
-                        0, i,
-                        nXSize, 1,
-                        pafThreeLineWin + i * nXSize,
-                        nXSize, 1,
-                        GDT_Float32,
-                        0, 0);
-    }
-    
-    // Exclude the edges
-    for (j = 0; j < nXSize; j++)
-    {
-        pafOutputBuf[j] = fDstNoDataValue;
-    }
-    GDALRasterIO(hDstBand, GF_Write,
-                 0, 0, nXSize, 1,
-                 pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
-
-    if (nYSize > 1)
-    {
-        GDALRasterIO(hDstBand, GF_Write,
-                     0, nYSize - 1, nXSize, 1,
-                     pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
-    }
-    
-    int nLine1Off = 0*nXSize;
-    int nLine2Off = 1*nXSize;
-    int nLine3Off = 2*nXSize;
-
-    for ( i = 1; i < nYSize-1; i++)
-    {
-        /* Read third line of the line buffer */
-        eErr = GDALRasterIO(   hSrcBand,
-                        GF_Read,
-                        0, i+1,
-                        nXSize, 1,
-                        pafThreeLineWin + nLine3Off,
-                        nXSize, 1,
-                        GDT_Float32,
-                        0, 0);
-        if (eErr != CE_None)
-            goto end;
-
-        // Exclude the edges
-        pafOutputBuf[0] = fDstNoDataValue;
-        if (nXSize > 1)
-            pafOutputBuf[nXSize - 1] = fDstNoDataValue;
-        
-        for (j = 1; j < nXSize - 1; j++)
-        {
-            float afWin[9];
-            afWin[0] = pafThreeLineWin[nLine1Off + j-1];
-            afWin[1] = pafThreeLineWin[nLine1Off + j];
-            afWin[2] = pafThreeLineWin[nLine1Off + j+1];
-            afWin[3] = pafThreeLineWin[nLine2Off + j-1];
-            afWin[4] = pafThreeLineWin[nLine2Off + j];
-            afWin[5] = pafThreeLineWin[nLine2Off + j+1];
-            afWin[6] = pafThreeLineWin[nLine3Off + j-1];
-            afWin[7] = pafThreeLineWin[nLine3Off + j];
-            afWin[8] = pafThreeLineWin[nLine3Off + j+1];
-
-            if (bSrcHasNoData && (
-                   afWin[0] == fSrcNoDataValue ||
-                   afWin[1] == fSrcNoDataValue ||
-                   afWin[2] == fSrcNoDataValue ||
-                   afWin[3] == fSrcNoDataValue ||
-                   afWin[4] == fSrcNoDataValue ||
-                   afWin[5] == fSrcNoDataValue ||
-                   afWin[6] == fSrcNoDataValue ||
-                   afWin[7] == fSrcNoDataValue ||
-                   afWin[8] == fSrcNoDataValue))
-            {
-                // We have nulls so write nullValue and move on
-                pafOutputBuf[j] = fDstNoDataValue;
-            }
-            else
-            {
-                // We have a valid 3x3 window.
-                pafOutputBuf[j] = pfnAlg(afWin, fDstNoDataValue, pData);
-            }
-        }
-
-        /* -----------------------------------------
-         * Write Line to Raster
-         */
-        eErr = GDALRasterIO(hDstBand, GF_Write, 0, i, nXSize, 1,
-                     pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
-        if (eErr != CE_None)
-            goto end;
-
-        if( !pfnProgress( 1.0 * (i+1) / nYSize, NULL, pProgressData ) )
-        {
-            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-            eErr = CE_Failure;
-            goto end;
-        }
-        
-        int nTemp = nLine1Off;
-        nLine1Off = nLine2Off;
-        nLine2Off = nLine3Off;
-        nLine3Off = nTemp;
-    }
-
-    pfnProgress( 1.0, NULL, pProgressData );
-    eErr = CE_None;
-
-end:
-    CPLFree(pafOutputBuf);
-    CPLFree(pafThreeLineWin);
-
-    return eErr;
-}
-
-
-/************************************************************************/
-/*                         GDALHillshade()                              */
-/************************************************************************/
-
-typedef struct
-{
-    double nsres;
-    double ewres;
-    double sin_altRadians;
-    double cos_altRadians_mul_z_scale_factor;
-    double azRadians;
-    double square_z_scale_factor;
-} GDALHillshadeAlgData;
-
-/* Unoptimized formulas are :
-    x = psData->z*((afWin[0] + afWin[3] + afWin[3] + afWin[6]) -
-        (afWin[2] + afWin[5] + afWin[5] + afWin[8])) /
-        (8.0 * psData->ewres * psData->scale);
-
-    y = psData->z*((afWin[6] + afWin[7] + afWin[7] + afWin[8]) -
-        (afWin[0] + afWin[1] + afWin[1] + afWin[2])) /
-        (8.0 * psData->nsres * psData->scale);
-
-    slope = M_PI / 2 - atan(sqrt(x*x + y*y));
-
-    aspect = atan2(x,y);
-
-    cang = sin(alt * degreesToRadians) * sin(slope) +
-           cos(alt * degreesToRadians) * cos(slope) *
-           cos(az * degreesToRadians - M_PI/2 - aspect);
-*/
-
-float GDALHillshadeAlg (float* afWin, float fDstNoDataValue, void* pData)
-{
-    GDALHillshadeAlgData* psData = (GDALHillshadeAlgData*)pData;
-    double x, y, aspect, xx_plus_yy, cang;
-    
-    // First Slope ...
-    x = ((afWin[0] + afWin[3] + afWin[3] + afWin[6]) -
-        (afWin[2] + afWin[5] + afWin[5] + afWin[8])) / psData->ewres;
-
-    y = ((afWin[6] + afWin[7] + afWin[7] + afWin[8]) -
-        (afWin[0] + afWin[1] + afWin[1] + afWin[2])) / psData->nsres;
-
-    xx_plus_yy = x * x + y * y;
-
-    // ... then aspect...
-    aspect = atan2(x,y);
-
-    // ... then the shade value
-    cang = (psData->sin_altRadians -
-           psData->cos_altRadians_mul_z_scale_factor * sqrt(xx_plus_yy) *
-           sin(aspect - psData->azRadians)) /
-           sqrt(1 + psData->square_z_scale_factor * xx_plus_yy);
-
-    if (cang <= 0.0) 
-        cang = 1.0;
-    else
-        cang = 1.0 + (254.0 * cang);
-        
-    return cang;
-}
-
-void*  GDALCreateHillshadeData(double* adfGeoTransform,
-                               double z,
-                               double scale,
-                               double alt,
-                               double az)
-{
-    GDALHillshadeAlgData* pData =
-        (GDALHillshadeAlgData*)CPLMalloc(sizeof(GDALHillshadeAlgData));
-        
-    const double degreesToRadians = M_PI / 180.0;
-    pData->nsres = adfGeoTransform[5];
-    pData->ewres = adfGeoTransform[1];
-    pData->sin_altRadians = sin(alt * degreesToRadians);
-    pData->azRadians = az * degreesToRadians;
-    double z_scale_factor = z / (8 * scale);
-    pData->cos_altRadians_mul_z_scale_factor =
-        cos(alt * degreesToRadians) * z_scale_factor;
-    pData->square_z_scale_factor = z_scale_factor * z_scale_factor;
-    return pData;
-}
-
-/************************************************************************/
-/*                         GDALSlope()                                  */
-/************************************************************************/
-
-typedef struct
-{
-    double nsres;
-    double ewres;
-    double scale;
-    int    slopeFormat;
-} GDALSlopeAlgData;
-
-float GDALSlopeAlg (float* afWin, float fDstNoDataValue, void* pData)
-{
-    const double radiansToDegrees = 180.0 / M_PI;
-    GDALSlopeAlgData* psData = (GDALSlopeAlgData*)pData;
-    double dx, dy, key;
-    
-    dx = ((afWin[0] + afWin[3] + afWin[3] + afWin[6]) - 
-          (afWin[2] + afWin[5] + afWin[5] + afWin[8]))/psData->ewres;
-
-    dy = ((afWin[6] + afWin[7] + afWin[7] + afWin[8]) - 
-          (afWin[0] + afWin[1] + afWin[1] + afWin[2]))/psData->nsres;
-
-    key = (dx * dx + dy * dy);
-
-    if (psData->slopeFormat == 1) 
-        return atan(sqrt(key) / (8*psData->scale)) * radiansToDegrees;
-    else
-        return 100*(sqrt(key) / (8*psData->scale));
-}
-
-void*  GDALCreateSlopeData(double* adfGeoTransform,
-                           double scale,
-                           int slopeFormat)
-{
-    GDALSlopeAlgData* pData =
-        (GDALSlopeAlgData*)CPLMalloc(sizeof(GDALSlopeAlgData));
-        
-    pData->nsres = adfGeoTransform[5];
-    pData->ewres = adfGeoTransform[1];
-    pData->scale = scale;
-    pData->slopeFormat = slopeFormat;
-    return pData;
-}
-
-/************************************************************************/
-/*                         GDALAspect()                                 */
-/************************************************************************/
-
-typedef struct
-{
-    int bAngleAsAzimuth;
-} GDALAspectAlgData;
-
-float GDALAspectAlg (float* afWin, float fDstNoDataValue, void* pData)
-{
-    const double degreesToRadians = M_PI / 180.0;
-    GDALAspectAlgData* psData = (GDALAspectAlgData*)pData;
-    double dx, dy;
-    float aspect;
-    
-    dx = ((afWin[2] + afWin[5] + afWin[5] + afWin[8]) -
-          (afWin[0] + afWin[3] + afWin[3] + afWin[6]));
-
-    dy = ((afWin[6] + afWin[7] + afWin[7] + afWin[8]) - 
-          (afWin[0] + afWin[1] + afWin[1] + afWin[2]));
-
-    aspect = atan2(dy,-dx) / degreesToRadians;
-
-    if (dx == 0 && dy == 0)
-    {
-        /* Flat area */
-        aspect = fDstNoDataValue;
-    } 
-    else if ( psData->bAngleAsAzimuth )
-    {
-        if (aspect > 90.0) 
-            aspect = 450.0 - aspect;
-        else
-            aspect = 90.0 - aspect;
-    }
-    else
-    {
-        if (aspect < 0)
-            aspect += 360.0;
-    }
-
-    if (aspect == 360.0) 
-        aspect = 0.0;
-
-    return aspect;
-}
-
-void*  GDALCreateAspectData(int bAngleAsAzimuth)
-{
-    GDALAspectAlgData* pData =
-        (GDALAspectAlgData*)CPLMalloc(sizeof(GDALAspectAlgData));
-        
-    pData->bAngleAsAzimuth = bAngleAsAzimuth;
-    return pData;
-}
-
 /************************************************************************/
 /*                      GDALColorRelief()                               */
 /************************************************************************/
@@ -1377,69 +1022,6 @@ CPLErr GDALGenerateVRTColorRelief(const char* pszDstFilename,
 }
 
 
-/************************************************************************/
-/*                         GDALTRIAlg()                                 */
-/************************************************************************/
-
-float GDALTRIAlg (float* afWin, float fDstNoDataValue, void* pData)
-{
-    // Terrain Ruggedness is average difference in height
-    return (fabs(afWin[0]-afWin[4]) +
-            fabs(afWin[1]-afWin[4]) +
-            fabs(afWin[2]-afWin[4]) +
-            fabs(afWin[3]-afWin[4]) +
-            fabs(afWin[5]-afWin[4]) +
-            fabs(afWin[6]-afWin[4]) +
-            fabs(afWin[7]-afWin[4]) +
-            fabs(afWin[8]-afWin[4]))/8;
-}
-
-
-/************************************************************************/
-/*                         GDALTPIAlg()                                 */
-/************************************************************************/
-
-float GDALTPIAlg (float* afWin, float fDstNoDataValue, void* pData)
-{
-    // Terrain Position is the difference between
-    // The central cell and the mean of the surrounding cells
-    return afWin[4] - 
-            ((afWin[0]+
-              afWin[1]+
-              afWin[2]+
-              afWin[3]+
-              afWin[5]+
-              afWin[6]+
-              afWin[7]+
-              afWin[8])/8);
-}
-
-/************************************************************************/
-/*                     GDALRoughnessAlg()                               */
-/************************************************************************/
-
-float GDALRoughnessAlg (float* afWin, float fDstNoDataValue, void* pData)
-{
-    // Roughness is the largest difference
-    //  between any two cells
-
-    float pafRoughnessMin = afWin[0];
-    float pafRoughnessMax = afWin[0];
-
-    for ( int k = 1; k < 9; k++)
-    {
-        if (afWin[k] > pafRoughnessMax)
-        {
-            pafRoughnessMax=afWin[k];
-        }
-        if (afWin[k] < pafRoughnessMin)
-        {
-            pafRoughnessMin=afWin[k];
-        }
-    }
-    return pafRoughnessMax - pafRoughnessMin;
-}
-
 /************************************************************************/
 /* ==================================================================== */
 /*                       GDALGeneric3x3Dataset                        */
@@ -1452,11 +1034,12 @@ class GDALGeneric3x3Dataset : public GDALDataset
 {
     friend class GDALGeneric3x3RasterBand;
 
-    GDALGeneric3x3ProcessingAlg pfnAlg;
-    void*              pAlgData;
+    GDALTerrainOptions sOptions;
+    GDALTerrainProduct eProduct;
     GDALDatasetH       hSrcDS;
     GDALRasterBandH    hSrcBand;
     float*             apafSourceBuf[3];
+    float*             pafOutputBuf;
     int                bDstHasNoData;
     double             dfDstNoDataValue;
     int                nCurLine;
@@ -1467,8 +1050,8 @@ class GDALGeneric3x3Dataset : public GDALDataset
                                               GDALDataType eDstDataType,
                                               int bDstHasNoData,
                                               double dfDstNoDataValue,
-                                              GDALGeneric3x3ProcessingAlg pfnAlg,
-                                              void* pAlgData);
+                                              const GDALTerrainOptions* psOptions,
+                                              GDALTerrainProduct eProduct);
                        ~GDALGeneric3x3Dataset();
 
     CPLErr      GetGeoTransform( double * padfGeoTransform );
@@ -1500,13 +1083,13 @@ GDALGeneric3x3Dataset::GDALGeneric3x3Dataset(
                                      GDALDataType eDstDataType,
                                      int bDstHasNoData,
                                      double dfDstNoDataValue,
-                                     GDALGeneric3x3ProcessingAlg pfnAlg,
-                                     void* pAlgData)
+                                     const GDALTerrainOptions* psOptions,
+                                     GDALTerrainProduct eProduct)
 {
     this->hSrcDS = hSrcDS;
     this->hSrcBand = hSrcBand;
-    this->pfnAlg = pfnAlg;
-    this->pAlgData = pAlgData;
+    this->sOptions = *psOptions;
+    this->eProduct = eProduct;
     this->bDstHasNoData = bDstHasNoData;
     this->dfDstNoDataValue = dfDstNoDataValue;
     
@@ -1520,6 +1103,7 @@ GDALGeneric3x3Dataset::GDALGeneric3x3Dataset(
     apafSourceBuf[0] = (float *) CPLMalloc(sizeof(float)*nRasterXSize);
     apafSourceBuf[1] = (float *) CPLMalloc(sizeof(float)*nRasterXSize);
     apafSourceBuf[2] = (float *) CPLMalloc(sizeof(float)*nRasterXSize);
+    pafOutputBuf = (float *) CPLMalloc(sizeof(float)*nRasterXSize);
     
     nCurLine = -1;
 }
@@ -1529,6 +1113,7 @@ GDALGeneric3x3Dataset::~GDALGeneric3x3Dataset()
     CPLFree(apafSourceBuf[0]);
     CPLFree(apafSourceBuf[1]);
     CPLFree(apafSourceBuf[2]);
+    CPLFree(pafOutputBuf);
 }
 
 CPLErr GDALGeneric3x3Dataset::GetGeoTransform( double * padfGeoTransform )
@@ -1622,67 +1207,33 @@ CPLErr GDALGeneric3x3RasterBand::IReadBlock( int nBlockXOff,
         }
     }
 
-    int j;
-    
-    if (eDataType == GDT_Byte)
-    {
-        ((GByte*)pImage)[0] = (GByte) poGDS->dfDstNoDataValue;
-        if (nBlockXSize > 1)
-            ((GByte*)pImage)[nBlockXSize - 1] = (GByte) poGDS->dfDstNoDataValue;
-    }
-    else
-    {
-        ((float*)pImage)[0] = (float) poGDS->dfDstNoDataValue;
-        if (nBlockXSize > 1)
-            ((float*)pImage)[nBlockXSize - 1] = (float) poGDS->dfDstNoDataValue;
-    }
-    
     int bSrcHasNoData;
-    double dfSrcNoDataValue = GDALGetRasterNoDataValue(poGDS->hSrcBand,
-                                                       &bSrcHasNoData);
+    float fSrcNoDataValue = (float) GDALGetRasterNoDataValue(poGDS->hSrcBand,
+                                                             &bSrcHasNoData);
+    float fDstNoDataValue = (float) poGDS->dfDstNoDataValue;
+    float* pafOutputBuf = (eDataType == GDT_Byte) ? poGDS->pafOutputBuf :
+                                                    (float*) pImage;
+    const float* apafLines[3] = { poGDS->apafSourceBuf[0],
+                                  poGDS->apafSourceBuf[1],
+                                  poGDS->apafSourceBuf[2] };
+
+    CPLErr eErr = GDALTerrainProcessLines(&poGDS->sOptions, 1,
+                                          &poGDS->eProduct,
+                                          nBlockXSize, 1, apafLines,
+                                          bSrcHasNoData, fSrcNoDataValue,
+                                          &fDstNoDataValue, &pafOutputBuf);
+    if (eErr != CE_None)
+        return eErr;
 
-    for(j=1;j<nBlockXSize - 1;j++)
+    if (eDataType == GDT_Byte)
     {
-        float afWin[9];
-        afWin[0] = poGDS->apafSourceBuf[0][j-1];
-        afWin[1] = poGDS->apafSourceBuf[0][j];
-        afWin[2] = poGDS->apafSourceBuf[0][j+1];
-        afWin[3] = poGDS->apafSourceBuf[1][j-1];
-        afWin[4] = poGDS->apafSourceBuf[1][j];
-        afWin[5] = poGDS->apafSourceBuf[1][j+1];
-        afWin[6] = poGDS->apafSourceBuf[2][j-1];
-        afWin[7] = poGDS->apafSourceBuf[2][j];
-        afWin[8] = poGDS->apafSourceBuf[2][j+1];
-
-        // Check if afWin has null value
-        int bContainsNull = FALSE;
-        if (bSrcHasNoData)
-        {
-            for ( int n = 0; n <= 8; n++)
-            {
-                if(afWin[n] == dfSrcNoDataValue)
-                {
-                    bContainsNull = TRUE;
-                    break;
-                }
-            }
-        }
-
-        if (bContainsNull)
+        int j;
+        for(j=0;j<nBlockXSize;j++)
         {
-            // We have nulls so write nullValue and move on
-            if (eDataType == GDT_Byte)
+            if (pafOutputBuf[j] == fDstNoDataValue)
                 ((GByte*)pImage)[j] = (GByte) poGDS->dfDstNoDataValue;
             else
-                ((float*)pImage)[j] = (float) poGDS->dfDstNoDataValue;
-        } else {
-            // We have a valid 3x3 window.
-            if (eDataType == GDT_Byte)
-                ((GByte*)pImage)[j] = (GByte) (poGDS->pfnAlg(
-                        afWin, poGDS->dfDstNoDataValue, poGDS->pAlgData) + 0.5);
-            else
-                ((float*)pImage)[j] = (float) poGDS->pfnAlg(
-                        afWin, poGDS->dfDstNoDataValue, poGDS->pAlgData);
+                ((GByte*)pImage)[j] = (GByte) (pafOutputBuf[j] + 0.5);
         }
     }
     
@@ -1979,27 +1530,29 @@ int main( int argc, char ** argv )
 
     double dfDstNoDataValue = 0;
     int bDstHasNoData = FALSE;
-    void* pData = NULL;
-    GDALGeneric3x3ProcessingAlg pfnAlg = NULL;
+    GDALTerrainOptions sOptions;
+    GDALTerrainProduct eProduct = GTP_Hillshade;
+
+    sOptions.dfEWRes = adfGeoTransform[1];
+    sOptions.dfNSRes = adfGeoTransform[5];
+    sOptions.dfScale = scale;
+    sOptions.dfZFactor = z;
+    sOptions.dfAzimuth = az;
+    sOptions.dfAltitude = alt;
+    sOptions.bSlopeInPercent = (slopeFormat == 0);
+    sOptions.bAspectTrigonometric = !bAngleAsAzimuth;
 
     if (eUtilityMode == HILL_SHADE)
     {
         dfDstNoDataValue = 0;
         bDstHasNoData = TRUE;
-        pData = GDALCreateHillshadeData   (adfGeoTransform,
-                                           z,
-                                           scale,
-                                           alt,
-                                           az);
-        pfnAlg = GDALHillshadeAlg;
+        eProduct = GTP_Hillshade;
     }
     else if (eUtilityMode == SLOPE)
     {
         dfDstNoDataValue = -9999;
         bDstHasNoData = TRUE;
-
-        pData = GDALCreateSlopeData(adfGeoTransform, scale, slopeFormat);
-        pfnAlg = GDALSlopeAlg;
+        eProduct = GTP_Slope;
     }
 
     else if (eUtilityMode == ASPECT)
@@ -2010,26 +1563,25 @@ int main( int argc, char ** argv )
             bDstHasNoData = TRUE;
         }
 
-        pData = GDALCreateAspectData(bAngleAsAzimuth);
-        pfnAlg = GDALAspectAlg;
+        eProduct = GTP_Aspect;
     }
     else if (eUtilityMode == TRI)
     {
         dfDstNoDataValue = -9999;
         bDstHasNoData = TRUE;
-        pfnAlg = GDALTRIAlg;
+        eProduct = GTP_TRI;
     }
     else if (eUtilityMode == TPI)
     {
         dfDstNoDataValue = -9999;
         bDstHasNoData = TRUE;
-        pfnAlg = GDALTPIAlg;
+        eProduct = GTP_TPI;
     }
     else if (eUtilityMode == ROUGHNESS)
     {
         dfDstNoDataValue = -9999;
         bDstHasNoData = TRUE;
-        pfnAlg = GDALRoughnessAlg;
+        eProduct = GTP_Roughness;
     }
     
     GDALDataType eDstDataType = (eUtilityMode == HILL_SHADE ||
@@ -2048,8 +1600,6 @@ int main( int argc, char ** argv )
                                        bAddAlpha);
             GDALClose(hSrcDataset);
         
-            CPLFree(pData);
-
             GDALDestroyDriverManager();
             CSLDestroy( argv );
             CSLDestroy( papszCreateOptions );
@@ -2083,8 +1633,8 @@ int main( int argc, char ** argv )
                                           eDstDataType,
                                           bDstHasNoData,
                                           dfDstNoDataValue,
-                                          pfnAlg,
-                                          pData);
+                                          &sOptions,
+                                          eProduct);
 
         GDALDatasetH hOutDS = GDALCreateCopy(
                                  hDriver, pszDstFilename, hIntermediateDataset, 
@@ -2095,8 +1645,6 @@ int main( int argc, char ** argv )
             GDALClose( hOutDS );
         GDALClose(hIntermediateDataset);
         GDALClose(hSrcDataset);
-        
-        CPLFree(pData);
 
         GDALDestroyDriverManager();
         CSLDestroy( argv );
@@ -2149,15 +1697,14 @@ int main( int argc, char ** argv )
         if (bDstHasNoData)
             GDALSetRasterNoDataValue(hDstBand, dfDstNoDataValue);
         
-        GDALGeneric3x3Processing(hSrcBand, hDstBand,
-                                 pfnAlg, pData,
-                                 pfnProgress, NULL);
+        GDALTerrainProcessing(hSrcBand, &sOptions, 1, &eProduct,
+                              &hDstBand, NULL,
+                              pfnProgress, NULL);
                                     
     }
 
     GDALClose(hSrcDataset);
     GDALClose(hDstDataset);
-    CPLFree(pData);
 
     GDALDestroyDriverManager();
     CSLDestroy( argv );
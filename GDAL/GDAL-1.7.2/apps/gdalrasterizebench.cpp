@@ -0,0 +1,204 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Utilities
+ * Purpose:  Benchmark of GDALRasterizeLayers() reading the layer for every
+ *           chunk, in a single pass, and in a single pass with threads.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "gdal.h"
+#include "gdal_alg.h"
+#include "ogr_api.h"
+#include "cpl_string.h"
+#include "cpl_conv.h"
+#include "cpl_multiproc.h"
+#include "gdalbench.h"
+
+CPL_CVSID("$Id$");
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+
+{
+    printf( "Usage: gdalrasterizebench [-ts xsize ysize] [-ot Byte|Float32]\n"
+            "                          [-at] [-a attribute] [-l layername]\n"
+            "                          [-chunkysize lines] [-threads n]\n"
+            "                          src_datasource\n"
+            "\n"
+            "Rasterizes a layer (the first one by default) over its extent\n"
+            "into an in-memory raster, reading the features again for every\n"
+            "chunk of lines, then in a single pass, then in a single pass\n"
+            "with several threads (ALL_CPUS by default), and checks that the\n"
+            "three rasters are identical.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int          nXSize = 8000, nYSize = 8000, i;
+    GDALDataType eType = GDT_Byte;
+    const char  *pszSource = NULL, *pszLayer = NULL;
+    const char  *pszAttribute = NULL, *pszChunkYSize = NULL;
+    const char  *pszThreads = "ALL_CPUS";
+    int          bAllTouched = FALSE;
+
+    GDALAllRegister();
+    OGRRegisterAll();
+
+    argc = GDALGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( EQUAL(argv[i],"-ts") && i < argc-2 )
+        {
+            nXSize = atoi(argv[++i]);
+            nYSize = atoi(argv[++i]);
+        }
+        else if( EQUAL(argv[i],"-ot") && i < argc-1 )
+            eType = GDALGetDataTypeByName( argv[++i] );
+        else if( EQUAL(argv[i],"-at") )
+            bAllTouched = TRUE;
+        else if( EQUAL(argv[i],"-a") && i < argc-1 )
+            pszAttribute = argv[++i];
+        else if( EQUAL(argv[i],"-l") && i < argc-1 )
+            pszLayer = argv[++i];
+        else if( EQUAL(argv[i],"-chunkysize") && i < argc-1 )
+            pszChunkYSize = argv[++i];
+        else if( EQUAL(argv[i],"-threads") && i < argc-1 )
+            pszThreads = argv[++i];
+        else if( argv[i][0] == '-' || pszSource != NULL )
+            Usage();
+        else
+            pszSource = argv[i];
+    }
+
+    if( pszSource == NULL || nXSize < 1 || nYSize < 1
+        || (eType != GDT_Byte && eType != GDT_Float32) )
+        Usage();
+
+/* -------------------------------------------------------------------- */
+/*      Open the layer, and create a raster covering its extent.        */
+/* -------------------------------------------------------------------- */
+    OGRDataSourceH hSrcDS = OGROpen( pszSource, FALSE, NULL );
+    OGRLayerH      hLayer = NULL;
+    OGREnvelope    sExtent;
+
+    if( hSrcDS != NULL )
+        hLayer = pszLayer ? OGR_DS_GetLayerByName( hSrcDS, pszLayer )
+                          : OGR_DS_GetLayer( hSrcDS, 0 );
+    if( hLayer == NULL
+        || OGR_L_GetExtent( hLayer, &sExtent, TRUE ) != OGRERR_NONE )
+    {
+        fprintf( stderr, "Failed to open a layer of %s.\n", pszSource );
+        exit( 1 );
+    }
+
+    GDALDatasetH hDS =
+        GDALCreate( GDALGetDriverByName( "MEM" ), "", nXSize, nYSize, 1,
+                    eType, NULL );
+    if( hDS == NULL )
+        exit( 1 );
+
+    double adfGeoTransform[6];
+
+    adfGeoTransform[0] = sExtent.MinX;
+    adfGeoTransform[1] = (sExtent.MaxX - sExtent.MinX) / nXSize;
+    adfGeoTransform[2] = 0.0;
+    adfGeoTransform[3] = sExtent.MaxY;
+    adfGeoTransform[4] = 0.0;
+    adfGeoTransform[5] = -(sExtent.MaxY - sExtent.MinY) / nYSize;
+    GDALSetGeoTransform( hDS, adfGeoTransform );
+
+    printf( "%d features into %dx%d %s, %d thread(s) available\n",
+            OGR_L_GetFeatureCount( hLayer, TRUE ), nXSize, nYSize,
+            GDALGetDataTypeName( eType ), CPLGetNumThreads( pszThreads ) );
+
+/* -------------------------------------------------------------------- */
+/*      Time each mode.                                                 */
+/* -------------------------------------------------------------------- */
+    static const char *apszModes[] = { "per chunk", "single pass",
+                                       "threaded" };
+    int    anBandList[1] = { 1 };
+    double adfBurnValues[1] = { 255.0 };
+    int    nReference = -1;
+
+    for( int iMode = 0; iMode < 3; iMode++ )
+    {
+        char **papszOptions = NULL;
+
+        if( pszAttribute )
+            papszOptions = CSLSetNameValue( papszOptions, "ATTRIBUTE",
+                                            pszAttribute );
+        if( bAllTouched )
+            papszOptions = CSLSetNameValue( papszOptions, "ALL_TOUCHED",
+                                            "TRUE" );
+        if( pszChunkYSize )
+            papszOptions = CSLSetNameValue( papszOptions, "CHUNKYSIZE",
+                                            pszChunkYSize );
+        papszOptions = CSLSetNameValue( papszOptions, "SINGLE_PASS",
+                                        iMode == 0 ? "NO" : "YES" );
+        papszOptions = CSLSetNameValue( papszOptions, "NUM_THREADS",
+                                        iMode == 2 ? pszThreads : "1" );
+
+        GDALFillRaster( GDALGetRasterBand( hDS, 1 ), 0.0, 0.0 );
+
+        double dfStart = GetWallTime();
+        CPLErr eErr =
+            GDALRasterizeLayers( hDS, 1, anBandList, 1, &hLayer, NULL, NULL,
+                                 adfBurnValues, papszOptions, NULL, NULL );
+        double dfSeconds = GetWallTime() - dfStart;
+        int    nChecksum =
+            GDALChecksumImage( GDALGetRasterBand( hDS, 1 ), 0, 0,
+                               nXSize, nYSize );
+
+        printf( "%-12s %8.3fs  checksum %d%s%s\n", apszModes[iMode],
+                dfSeconds, nChecksum, eErr != CE_None ? " (FAILED)" : "",
+                nReference >= 0 && nChecksum != nReference
+                ? " (MISMATCH)" : "" );
+
+        if( nReference < 0 )
+            nReference = nChecksum;
+
+        CSLDestroy( papszOptions );
+    }
+
+    GDALClose( hDS );
+    OGR_DS_Destroy( hSrcDS );
+
+    CSLDestroy( argv );
+    GDALDestroyDriverManager();
+    OGRCleanupAll();
+
+    return 0;
+}
@@ -0,0 +1,314 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Utilities
+ * Purpose:  Accuracy and timing check of the thin plate spline transformer,
+ *           comparing its fast solve and far field evaluation to a plain
+ *           dense solve with exact evaluation.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "gdal.h"
+#include "gdal_alg.h"
+#include "cpl_string.h"
+#include "cpl_conv.h"
+#include "gdalbench.h"
+
+CPL_CVSID("$Id$");
+
+/* Size of the raster the GCPs are spread over, in pixels and lines. */
+#define BENCH_RASTER_SIZE 10000.0
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+
+{
+    printf( "Usage: gdaltpsbench [-n gcp_count] [-grid size] [-noise meters]\n"
+            "                    [-clusters count] [-seed n]\n"
+            "\n"
+            "Builds thin plate spline transformers from a random and from a\n"
+            "clustered set of GCPs (1500 by default), mapping a %.0fx%.0f\n"
+            "raster to projected coordinates through a smooth distortion.\n"
+            "Each is built with the plain dense LU solve and exact\n"
+            "evaluation (GDAL_TPS_SOLVER=LU, GDAL_TPS_FARFIELD=NO), which is\n"
+            "the reference, then with the default solve and exact evaluation,\n"
+            "then with the default solve and far field evaluation.  Reports\n"
+            "the solve and evaluation times, the largest misfit at the GCPs,\n"
+            "and the largest difference to the reference over a grid of\n"
+            "points (200x200 by default) covering the raster and a margin.\n",
+            BENCH_RASTER_SIZE, BENCH_RASTER_SIZE );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                             BenchRandom()                            */
+/*                                                                      */
+/*      Portable generator, so that runs can be compared across         */
+/*      platforms.  Returns a value in [0,1).                           */
+/************************************************************************/
+
+static double BenchRandom( GUInt32 *pnState )
+
+{
+    *pnState = *pnState * 1664525 + 1013904223;
+    return (*pnState >> 8) / 16777216.0;
+}
+
+/************************************************************************/
+/*                            MakeGCPs()                                */
+/*                                                                      */
+/*      Spread the GCPs uniformly over the raster, or around a few      */
+/*      cluster centers, and compute their georeferenced position       */
+/*      through a smooth non affine distortion.                         */
+/************************************************************************/
+
+static GDAL_GCP *MakeGCPs( int nGCPCount, int nClusters, double dfNoise,
+                           GUInt32 *pnState )
+
+{
+    GDAL_GCP *pasGCPs = (GDAL_GCP *) CPLCalloc( nGCPCount, sizeof(GDAL_GCP) );
+    double   *padfCenters = NULL;
+    int       i;
+
+    GDALInitGCPs( nGCPCount, pasGCPs );
+
+    if( nClusters > 0 )
+    {
+        padfCenters = (double *) CPLMalloc( sizeof(double) * 2 * nClusters );
+        for( i = 0; i < 2 * nClusters; i++ )
+            padfCenters[i] =
+                BENCH_RASTER_SIZE * (0.1 + 0.8 * BenchRandom( pnState ));
+    }
+
+    for( i = 0; i < nGCPCount; i++ )
+    {
+        double dfPixel, dfLine;
+
+        if( nClusters > 0 )
+        {
+            int iCluster = i % nClusters;
+            double dfRadius = 0.03 * BENCH_RASTER_SIZE;
+
+            /* Sum of uniforms, roughly gaussian around the center. */
+            dfPixel = padfCenters[2*iCluster] + dfRadius
+                * (BenchRandom( pnState ) + BenchRandom( pnState ) - 1.0);
+            dfLine = padfCenters[2*iCluster+1] + dfRadius
+                * (BenchRandom( pnState ) + BenchRandom( pnState ) - 1.0);
+        }
+        else
+        {
+            dfPixel = BENCH_RASTER_SIZE * BenchRandom( pnState );
+            dfLine = BENCH_RASTER_SIZE * BenchRandom( pnState );
+        }
+
+        pasGCPs[i].dfGCPPixel = dfPixel;
+        pasGCPs[i].dfGCPLine = dfLine;
+        pasGCPs[i].dfGCPX = 500000.0 + 30.0 * dfPixel + 2.0 * dfLine
+            + 1e-4 * dfPixel * dfLine + 400.0 * sin( dfPixel / 1500.0 )
+            + dfNoise * (2.0 * BenchRandom( pnState ) - 1.0);
+        pasGCPs[i].dfGCPY = 4000000.0 - 1.5 * dfPixel - 30.0 * dfLine
+            - 2e-4 * dfLine * dfLine + 300.0 * cos( dfLine / 2000.0 )
+            + dfNoise * (2.0 * BenchRandom( pnState ) - 1.0);
+    }
+
+    CPLFree( padfCenters );
+
+    return pasGCPs;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int     nGCPCount = 1500, nGridSize = 200, nClusters = 12, i;
+    double  dfNoise = 0.0;
+    GUInt32 nSeed = 1;
+
+    GDALAllRegister();
+
+    argc = GDALGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( EQUAL(argv[i],"-n") && i < argc-1 )
+            nGCPCount = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-grid") && i < argc-1 )
+            nGridSize = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-noise") && i < argc-1 )
+            dfNoise = atof(argv[++i]);
+        else if( EQUAL(argv[i],"-clusters") && i < argc-1 )
+            nClusters = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-seed") && i < argc-1 )
+            nSeed = (GUInt32) atoi(argv[++i]);
+        else
+            Usage();
+    }
+
+    if( nGCPCount < 3 || nGridSize < 2 || nClusters < 1 )
+        Usage();
+
+/* -------------------------------------------------------------------- */
+/*      Grid of check points, covering the raster and a 10% margin      */
+/*      where the spline extrapolates.                                  */
+/* -------------------------------------------------------------------- */
+    int     nGridPoints = nGridSize * nGridSize;
+    double *padfGridX = (double *) CPLMalloc( sizeof(double) * nGridPoints );
+    double *padfGridY = (double *) CPLMalloc( sizeof(double) * nGridPoints );
+    double *padfRefX = (double *) CPLMalloc( sizeof(double) * nGridPoints );
+    double *padfRefY = (double *) CPLMalloc( sizeof(double) * nGridPoints );
+    double *padfGCPX = (double *) CPLMalloc( sizeof(double) * nGCPCount );
+    double *padfGCPY = (double *) CPLMalloc( sizeof(double) * nGCPCount );
+    double *padfZ = (double *) CPLCalloc( sizeof(double),
+                                          MAX(nGridPoints,nGCPCount) );
+    int    *panSuccess = (int *) CPLMalloc( sizeof(int)
+                                            * MAX(nGridPoints,nGCPCount) );
+
+    printf( "%d GCPs, %dx%d check points, noise %g\n",
+            nGCPCount, nGridSize, nGridSize, dfNoise );
+
+    static const char *apszSets[] = { "random", "clustered" };
+    static const char *apszModes[] = { "dense LU, exact",
+                                       "default, exact",
+                                       "default, far field" };
+
+    for( int iSet = 0; iSet < 2; iSet++ )
+    {
+        GUInt32   nState = nSeed;
+        GDAL_GCP *pasGCPs = MakeGCPs( nGCPCount, iSet == 0 ? 0 : nClusters,
+                                      dfNoise, &nState );
+
+        for( int iMode = 0; iMode < 3; iMode++ )
+        {
+            CPLSetConfigOption( "GDAL_TPS_SOLVER", iMode == 0 ? "LU" : NULL );
+            CPLSetConfigOption( "GDAL_TPS_FARFIELD", iMode < 2 ? "NO" : NULL );
+
+/* -------------------------------------------------------------------- */
+/*      Build the transformer.                                          */
+/* -------------------------------------------------------------------- */
+            double dfStart = GetWallTime();
+            void  *hTransformArg =
+                GDALCreateTPSTransformer( nGCPCount, pasGCPs, FALSE );
+            double dfSolveSeconds = GetWallTime() - dfStart;
+
+            if( hTransformArg == NULL )
+            {
+                printf( "%-10s %-20s (FAILED)\n",
+                        apszSets[iSet], apszModes[iMode] );
+                continue;
+            }
+
+/* -------------------------------------------------------------------- */
+/*      Misfit at the GCPs, which the spline should interpolate.        */
+/* -------------------------------------------------------------------- */
+            double dfMisfit = 0.0;
+
+            for( i = 0; i < nGCPCount; i++ )
+            {
+                padfGCPX[i] = pasGCPs[i].dfGCPPixel;
+                padfGCPY[i] = pasGCPs[i].dfGCPLine;
+                padfZ[i] = 0.0;
+            }
+            GDALTPSTransform( hTransformArg, FALSE, nGCPCount,
+                              padfGCPX, padfGCPY, padfZ, panSuccess );
+            for( i = 0; i < nGCPCount; i++ )
+            {
+                dfMisfit = MAX(dfMisfit,
+                               fabs(padfGCPX[i] - pasGCPs[i].dfGCPX));
+                dfMisfit = MAX(dfMisfit,
+                               fabs(padfGCPY[i] - pasGCPs[i].dfGCPY));
+            }
+
+/* -------------------------------------------------------------------- */
+/*      Transform the grid, and compare it to the reference.            */
+/* -------------------------------------------------------------------- */
+            for( i = 0; i < nGridPoints; i++ )
+            {
+                padfGridX[i] = BENCH_RASTER_SIZE
+                    * (-0.1 + 1.2 * (i % nGridSize) / (nGridSize - 1));
+                padfGridY[i] = BENCH_RASTER_SIZE
+                    * (-0.1 + 1.2 * (i / nGridSize) / (nGridSize - 1));
+                padfZ[i] = 0.0;
+            }
+
+            dfStart = GetWallTime();
+            GDALTPSTransform( hTransformArg, FALSE, nGridPoints,
+                              padfGridX, padfGridY, padfZ, panSuccess );
+            double dfEvalSeconds = GetWallTime() - dfStart;
+
+            double dfMaxDiff = 0.0, dfRange = 0.0;
+
+            for( i = 0; i < nGridPoints; i++ )
+            {
+                if( iMode == 0 )
+                {
+                    padfRefX[i] = padfGridX[i];
+                    padfRefY[i] = padfGridY[i];
+                }
+                dfMaxDiff = MAX(dfMaxDiff, fabs(padfGridX[i] - padfRefX[i]));
+                dfMaxDiff = MAX(dfMaxDiff, fabs(padfGridY[i] - padfRefY[i]));
+                dfRange = MAX(dfRange, fabs(padfRefX[i] - padfRefX[0]));
+                dfRange = MAX(dfRange, fabs(padfRefY[i] - padfRefY[0]));
+            }
+
+/* -------------------------------------------------------------------- */
+/*      Flag differences above 1e-7 of the range of the values: the     */
+/*      far field interpolation is meant to stay within 1e-8 of it.     */
+/* -------------------------------------------------------------------- */
+            printf( "%-10s %-20s solve %8.3fs  eval %7.3fs  "
+                    "GCP misfit %9.3g  max diff %9.3g%s\n",
+                    apszSets[iSet], apszModes[iMode],
+                    dfSolveSeconds, dfEvalSeconds, dfMisfit, dfMaxDiff,
+                    dfMaxDiff > 1e-7 * dfRange ? " (MISMATCH)" : "" );
+
+            GDALDestroyTPSTransformer( hTransformArg );
+        }
+
+        GDALDeinitGCPs( nGCPCount, pasGCPs );
+        CPLFree( pasGCPs );
+    }
+
+    CPLSetConfigOption( "GDAL_TPS_SOLVER", NULL );
+    CPLSetConfigOption( "GDAL_TPS_FARFIELD", NULL );
+
+    CPLFree( padfGridX );
+    CPLFree( padfGridY );
+    CPLFree( padfRefX );
+    CPLFree( padfRefY );
+    CPLFree( padfGCPX );
+    CPLFree( padfGCPY );
+    CPLFree( padfZ );
+    CPLFree( panSuccess );
+
+    CSLDestroy( argv );
+    GDALDestroyDriverManager();
+
+    return 0;
+}
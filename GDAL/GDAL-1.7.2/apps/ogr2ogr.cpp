@@ -1311,6 +1311,16 @@ static int TranslateLayer( OGRDataSource *poSrcDS,
     
     poSrcLayer->ResetReading();
 
+/* -------------------------------------------------------------------- */
+/*      Features are read and written one at a time, so let the         */
+/*      definitions recycle them unless the pool size was configured.   */
+/* -------------------------------------------------------------------- */
+    if( CPLGetConfigOption( "OGR_FEATURE_POOL_SIZE", NULL ) == NULL )
+    {
+        poSrcLayer->GetLayerDefn()->SetFeaturePoolSize( 1 );
+        poDstLayer->GetLayerDefn()->SetFeaturePoolSize( 1 );
+    }
+
     if( nGroupTransactions )
         poDstLayer->StartTransaction();
 
@@ -0,0 +1,242 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  Benchmark of spatially filtered reads of a shapefile without
+ *           spatial index, with a .qix quadtree and with a packed R-tree.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_api.h"
+#include "ogrsf_frmts.h"
+#include "ogr_p.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include <time.h>
+
+CPL_CVSID("$Id$");
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+
+{
+    printf( "Usage: ogrspatialbench [-q queries] [-size fraction] [-seed n]\n"
+            "                       shapefile\n"
+            "\n"
+            "Times the given number of reads of the first layer of the\n"
+            "shapefile through random rectangular spatial filters, each the\n"
+            "given fraction of the layer extent wide and high, first without\n"
+            "spatial index, then with a .qix quadtree and with a packed\n"
+            "R-tree (.osi).  The index creation is timed too.  The shapefile\n"
+            "must be writable, and its existing spatial index is removed.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                            RunQueries()                              */
+/*                                                                      */
+/*      Reopen the shapefile, so that no index data is cached, and      */
+/*      run the queries.  Returns the total number of features read.    */
+/************************************************************************/
+
+static int RunQueries( const char *pszFilename, int nQueries,
+                       const double *padfWindows, double *pdfSeconds )
+
+{
+    OGRDataSource *poDS = OGRSFDriverRegistrar::Open( pszFilename, FALSE );
+
+    if( poDS == NULL || poDS->GetLayerCount() < 1 )
+    {
+        fprintf( stderr, "Failed to open %s.\n", pszFilename );
+        exit( 1 );
+    }
+
+    OGRLayer *poLayer = poDS->GetLayer( 0 );
+    clock_t   nStart = clock();
+    int       nTotal = 0;
+
+    for( int i = 0; i < nQueries; i++ )
+    {
+        const double *padfWindow = padfWindows + i * 4;
+        OGRFeature   *poFeature;
+
+        poLayer->SetSpatialFilterRect( padfWindow[0], padfWindow[1],
+                                       padfWindow[2], padfWindow[3] );
+        poLayer->ResetReading();
+
+        while( (poFeature = poLayer->GetNextFeature()) != NULL )
+        {
+            nTotal++;
+            delete poFeature;
+        }
+    }
+
+    *pdfSeconds = (clock() - nStart) / (double) CLOCKS_PER_SEC;
+
+    OGRDataSource::DestroyDataSource( poDS );
+
+    return nTotal;
+}
+
+/************************************************************************/
+/*                            RunStatement()                            */
+/************************************************************************/
+
+static double RunStatement( const char *pszFilename, const char *pszSQL,
+                            int bQuiet )
+
+{
+    OGRDataSource *poDS = OGRSFDriverRegistrar::Open( pszFilename, TRUE );
+
+    if( poDS == NULL || poDS->GetLayerCount() < 1 )
+    {
+        fprintf( stderr, "Failed to open %s in update mode.\n", pszFilename );
+        exit( 1 );
+    }
+
+    CPLString osSQL;
+    clock_t   nStart = clock();
+
+    osSQL.Printf( pszSQL, poDS->GetLayer(0)->GetLayerDefn()->GetName() );
+
+    if( bQuiet )
+        CPLPushErrorHandler( CPLQuietErrorHandler );
+    poDS->ExecuteSQL( osSQL, NULL, NULL );
+    if( bQuiet )
+        CPLPopErrorHandler();
+
+    double dfSeconds = (clock() - nStart) / (double) CLOCKS_PER_SEC;
+
+    OGRDataSource::DestroyDataSource( poDS );
+
+    return dfSeconds;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int         nQueries = 1000, nSeed = 1;
+    double      dfSize = 0.01;
+    const char *pszFilename = NULL;
+    int         i;
+
+    argc = OGRGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( EQUAL(argv[i],"-q") && i < argc-1 )
+            nQueries = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-size") && i < argc-1 )
+            dfSize = atof(argv[++i]);
+        else if( EQUAL(argv[i],"-seed") && i < argc-1 )
+            nSeed = atoi(argv[++i]);
+        else if( argv[i][0] == '-' || pszFilename != NULL )
+            Usage();
+        else
+            pszFilename = argv[i];
+    }
+
+    if( pszFilename == NULL || nQueries < 1 || dfSize <= 0.0 )
+        Usage();
+
+    OGRRegisterAll();
+
+/* -------------------------------------------------------------------- */
+/*      Draw the query windows in the layer extent.                     */
+/* -------------------------------------------------------------------- */
+    OGRDataSource *poDS = OGRSFDriverRegistrar::Open( pszFilename, FALSE );
+    OGREnvelope    sExtent;
+
+    if( poDS == NULL || poDS->GetLayerCount() < 1
+        || poDS->GetLayer(0)->GetExtent( &sExtent, TRUE ) != OGRERR_NONE )
+    {
+        fprintf( stderr, "Failed to get the extent of %s.\n", pszFilename );
+        exit( 1 );
+    }
+    OGRDataSource::DestroyDataSource( poDS );
+
+    double  dfWidth = (sExtent.MaxX - sExtent.MinX) * dfSize;
+    double  dfHeight = (sExtent.MaxY - sExtent.MinY) * dfSize;
+    double *padfWindows = (double *) CPLMalloc( sizeof(double) * 4 * nQueries );
+
+    srand( nSeed );
+    for( i = 0; i < nQueries; i++ )
+    {
+        double dfX = sExtent.MinX + (sExtent.MaxX - sExtent.MinX - dfWidth)
+            * (rand() / (double) RAND_MAX);
+        double dfY = sExtent.MinY + (sExtent.MaxY - sExtent.MinY - dfHeight)
+            * (rand() / (double) RAND_MAX);
+
+        padfWindows[i*4+0] = dfX;
+        padfWindows[i*4+1] = dfY;
+        padfWindows[i*4+2] = dfX + dfWidth;
+        padfWindows[i*4+3] = dfY + dfHeight;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Time each kind of index.                                        */
+/* -------------------------------------------------------------------- */
+    static const char *apszTypes[] = { NULL, "QIX", "RTREE" };
+    int nReference = -1;
+
+    for( int iType = 0; iType < 3; iType++ )
+    {
+        double dfCreate = 0.0, dfQuery;
+        int    nTotal;
+
+        RunStatement( pszFilename, "DROP SPATIAL INDEX ON %s", TRUE );
+
+        if( apszTypes[iType] != NULL )
+            dfCreate = RunStatement( pszFilename,
+                                     CPLSPrintf( "CREATE SPATIAL INDEX ON %%s "
+                                                 "TYPE %s", apszTypes[iType] ),
+                                     FALSE );
+
+        nTotal = RunQueries( pszFilename, nQueries, padfWindows, &dfQuery );
+
+        printf( "%-6s create %8.3fs  %d queries %8.3fs  %d features%s\n",
+                apszTypes[iType] ? apszTypes[iType] : "none",
+                dfCreate, nQueries, dfQuery, nTotal,
+                nReference >= 0 && nTotal != nReference ? " (MISMATCH)" : "" );
+
+        if( nReference < 0 )
+            nReference = nTotal;
+    }
+
+    RunStatement( pszFilename, "DROP SPATIAL INDEX ON %s", TRUE );
+
+    CPLFree( padfWindows );
+    CSLDestroy( argv );
+    OGRCleanupAll();
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  Micro-benchmark of OGR SQL statements over a generated
+ *           in-memory layer.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_api.h"
+#include "ogrsf_frmts.h"
+#include "ogr_p.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include <time.h>
+
+CPL_CVSID("$Id$");
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+
+{
+    printf( "Usage: ogrsqlbench [-n features] [-distinct n] [-sql statement]*\n"
+            "\n"
+            "Builds an in-memory layer named 'bench' of the requested number\n"
+            "of features with the fields id (Integer, unique), ival (Integer),\n"
+            "rval (Real) and sval (String), the last three cycling through\n"
+            "the requested number of distinct values, and times the\n"
+            "execution of each statement, including reading all its result\n"
+            "features.  Without -sql a default set of statements is run.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                           CreateBenchLayer()                         */
+/************************************************************************/
+
+static OGRLayer *CreateBenchLayer( OGRDataSource *poDS,
+                                   int nFeatures, int nDistinct )
+
+{
+    OGRLayer *poLayer = poDS->CreateLayer( "bench", NULL, wkbNone, NULL );
+
+    if( poLayer == NULL )
+        return NULL;
+
+    OGRFieldDefn oId( "id", OFTInteger );
+    OGRFieldDefn oIVal( "ival", OFTInteger );
+    OGRFieldDefn oRVal( "rval", OFTReal );
+    OGRFieldDefn oSVal( "sval", OFTString );
+
+    poLayer->CreateField( &oId );
+    poLayer->CreateField( &oIVal );
+    poLayer->CreateField( &oRVal );
+    poLayer->CreateField( &oSVal );
+
+/* -------------------------------------------------------------------- */
+/*      Scatter the values so that neither the ids nor the values       */
+/*      come in sorted order.                                           */
+/* -------------------------------------------------------------------- */
+    OGRFeature oFeature( poLayer->GetLayerDefn() );
+    int i;
+
+    for( i = 0; i < nFeatures; i++ )
+    {
+        int nValue = (int) ((i * (GIntBig) 7919) % nDistinct);
+
+        oFeature.SetFID( OGRNullFID );
+        oFeature.SetField( 0, i );
+        oFeature.SetField( 1, nValue );
+        oFeature.SetField( 2, nValue * 0.25 );
+        oFeature.SetField( 3, CPLSPrintf( "value%d", nValue ) );
+
+        if( poLayer->CreateFeature( &oFeature ) != OGRERR_NONE )
+            return NULL;
+    }
+
+    return poLayer;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int nFeatures = 1000000, nDistinct = -1;
+    char **papszStatements = NULL;
+    int i;
+
+    argc = OGRGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( EQUAL(argv[i],"-n") && i < argc-1 )
+            nFeatures = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-distinct") && i < argc-1 )
+            nDistinct = atoi(argv[++i]);
+        else if( EQUAL(argv[i],"-sql") && i < argc-1 )
+            papszStatements = CSLAddString( papszStatements, argv[++i] );
+        else
+            Usage();
+    }
+
+    if( nDistinct < 0 )
+        nDistinct = nFeatures;
+
+    if( nFeatures < 1 || nDistinct < 1 )
+        Usage();
+
+    if( papszStatements == NULL )
+    {
+        papszStatements =
+            CSLAddString( papszStatements, "SELECT DISTINCT ival FROM bench" );
+        papszStatements =
+            CSLAddString( papszStatements, "SELECT DISTINCT rval FROM bench" );
+        papszStatements =
+            CSLAddString( papszStatements, "SELECT DISTINCT sval FROM bench" );
+        papszStatements =
+            CSLAddString( papszStatements,
+                          "SELECT COUNT(DISTINCT ival) FROM bench" );
+        papszStatements =
+            CSLAddString( papszStatements,
+                  "SELECT MIN(rval), MAX(rval), AVG(rval), SUM(ival) "
+                  "FROM bench" );
+        papszStatements =
+            CSLAddString( papszStatements,
+                          "SELECT * FROM bench ORDER BY sval" );
+        papszStatements =
+            CSLAddString( papszStatements,
+                          "SELECT id FROM bench ORDER BY rval DESC, id" );
+        papszStatements =
+            CSLAddString( papszStatements,
+                  "SELECT id FROM bench WHERE ival > 500 AND "
+                  "(sval LIKE 'value1%' OR rval IN (1.5, 2.5, 3.5))" );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Build the layer.                                                */
+/* -------------------------------------------------------------------- */
+    OGRRegisterAll();
+
+    OGRSFDriver *poDriver =
+        OGRSFDriverRegistrar::GetRegistrar()->GetDriverByName( "Memory" );
+    OGRDataSource *poDS = NULL;
+
+    if( poDriver != NULL )
+        poDS = poDriver->CreateDataSource( "bench", NULL );
+
+    if( poDS == NULL || CreateBenchLayer( poDS, nFeatures, nDistinct ) == NULL )
+    {
+        fprintf( stderr, "Failed to create the in-memory layer.\n" );
+        exit( 1 );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Run the statements.                                             */
+/* -------------------------------------------------------------------- */
+    for( i = 0; papszStatements[i] != NULL; i++ )
+    {
+        clock_t nStart = clock();
+        int nResultCount = 0;
+        OGRLayer *poResult = poDS->ExecuteSQL( papszStatements[i],
+                                               NULL, NULL );
+
+        if( poResult != NULL )
+        {
+            OGRFeature *poFeature;
+
+            while( (poFeature = poResult->GetNextFeature()) != NULL )
+            {
+                nResultCount++;
+                delete poFeature;
+            }
+            poDS->ReleaseResultSet( poResult );
+        }
+
+        printf( "%8.3fs %9d features : %s\n",
+                (clock() - nStart) / (double) CLOCKS_PER_SEC,
+                nResultCount, papszStatements[i] );
+    }
+
+    OGRDataSource::DestroyDataSource( poDS );
+    CSLDestroy( papszStatements );
+    CSLDestroy( argv );
+    OGRCleanupAll();
+
+    return 0;
+}
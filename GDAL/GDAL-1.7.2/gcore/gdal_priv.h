@@ -393,6 +393,23 @@ public:
                                    int, const GDALColorEntry * );
 };
 
+/* ******************************************************************** */
+/*                          GDALRIOResampleAlg                          */
+/* ******************************************************************** */
+
+/** Resampling applied by the default RasterIO() implementation when the
+    buffer size differs from the window size (GDAL_RASTERIO_RESAMPLING). */
+typedef enum
+{
+    GRIORA_NearestNeighbour = 0,
+    GRIORA_Bilinear = 1,
+    GRIORA_Cubic = 2,
+    GRIORA_Average = 3,
+    GRIORA_Mode = 4
+} GDALRIOResampleAlg;
+
+GDALRIOResampleAlg CPL_DLL GDALGetRasterIOResampling();
+
 /* ******************************************************************** */
 /*                            GDALRasterBand                            */
 /* ******************************************************************** */
@@ -442,6 +459,9 @@ class CPL_DLL GDALRasterBand : public GDALMajorObject
     CPLErr         OverviewRasterIO( GDALRWFlag, int, int, int, int,
                                      void *, int, int, GDALDataType,
                                      int, int );
+    CPLErr         ResampledRasterIO( int, int, int, int,
+                                      void *, int, int, GDALDataType,
+                                      int, int, GDALRIOResampleAlg );
 
     int            InitBlockInfo();
 
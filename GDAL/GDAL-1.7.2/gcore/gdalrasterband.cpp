@@ -128,6 +128,14 @@ GDALRasterBand::~GDALRasterBand()
  * Some formats may efficiently implement decimation into a buffer by
  * reading from lower resolution overview images.
  *
+ * Decimation and replication on read default to nearest neighbour
+ * sampling.  Setting the GDAL_RASTERIO_RESAMPLING configuration option
+ * (possibly as a thread local option) to AVERAGE, BILINEAR, CUBIC or MODE
+ * makes the default implementation compute each buffer pixel with that
+ * kernel instead, from the best overview that is at least as detailed
+ * as the request, ignoring pixels matching the nodata value.  Formats
+ * overriding IRasterIO() with their own decimation may not honour it.
+ *
  * For highest performance full resolution data access, read and write
  * on "block boundaries" as returned by GetBlockSize(), or use the
  * ReadBlock() and WriteBlock() methods.
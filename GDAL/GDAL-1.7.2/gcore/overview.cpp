@@ -28,6 +28,14 @@
  ****************************************************************************/
 
 #include "gdal_priv.h"
+#include "cpl_multiproc.h"
+
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define HAVE_SSE2_OVERVIEW
+#  include <emmintrin.h>
+#endif
 
 CPL_CVSID("$Id: overview.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -42,6 +50,11 @@ typedef enum
 
 /************************************************************************/
 /*                       GDALDownsampleChunk32R()                       */
+/*                                                                      */
+/*      Compute the overview pixels covered by a source chunk into a    */
+/*      newly allocated buffer, returned with the destination window    */
+/*      it covers.  The overview band itself is not written to, so      */
+/*      that several chunks can be computed concurrently.               */
 /************************************************************************/
 
 static CPLErr
@@ -54,7 +67,10 @@ GDALDownsampleChunk32R( int nSrcWidth, int nSrcHeight,
                         const char * pszResampling,
                         int bHasNoData, float fNoDataValue,
                         GDALColorTable* poColorTable,
-                        GDALDataType eSrcDataType)
+                        GDALDataType eSrcDataType,
+                        float ** ppafDstBuffer,
+                        int * pnDstXOff, int * pnDstXSize,
+                        int * pnDstYOff, int * pnDstYSize )
 
 {
 /* -------------------------------------------------------------------- */
@@ -89,8 +105,10 @@ GDALDownsampleChunk32R( int nSrcWidth, int nSrcHeight,
 /*      Create the filter kernel and allocate scanline buffer.          */
 /* -------------------------------------------------------------------- */
     int      nDstXOff, nDstXOff2, nDstYOff, nDstYOff2, nOXSize, nOYSize;
-    float    *pafDstScanline;
+    float    *pafDstBuffer, *pafDstScanline;
     int nGaussMatrixDim = 3;
+
+    *ppafDstBuffer = NULL;
     const int *panGaussMatrix;
     static const int anGaussMatrix3x3[] ={
         1,2,1,
@@ -144,15 +162,6 @@ GDALDownsampleChunk32R( int nSrcWidth, int nSrcHeight,
     if( nChunkXOff + nChunkXSize == nSrcWidth )
         nDstXOff2 = nOXSize;
 
-
-    pafDstScanline = (float *) VSIMalloc((nDstXOff2 - nDstXOff) * sizeof(float));
-    if( pafDstScanline == NULL )
-    {
-        CPLError( CE_Failure, CPLE_OutOfMemory,
-                  "GDALDownsampleChunk32R: Out of memory for line buffer." );
-        return CE_Failure;
-    }
-
 /* -------------------------------------------------------------------- */
 /*      Figure out the line to start writing to, and the first line     */
 /*      to not write to.  In theory this approach should ensure that    */
@@ -166,6 +175,23 @@ GDALDownsampleChunk32R( int nSrcWidth, int nSrcHeight,
     if( nChunkYOff + nChunkYSize == nSrcHeight )
         nDstYOff2 = nOYSize;
 
+    *pnDstXOff = nDstXOff;
+    *pnDstXSize = nDstXOff2 - nDstXOff;
+    *pnDstYOff = nDstYOff;
+    *pnDstYSize = nDstYOff2 - nDstYOff;
+
+    if( nDstXOff2 <= nDstXOff || nDstYOff2 <= nDstYOff )
+        return CE_None;
+
+    pafDstBuffer = (float *) 
+        VSIMalloc3((nDstXOff2 - nDstXOff), (nDstYOff2 - nDstYOff), sizeof(float));
+    if( pafDstBuffer == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "GDALDownsampleChunk32R: Out of memory for output buffer." );
+        return CE_Failure;
+    }
+
 
     int nEntryCount = 0;
     GDALColorEntry* aEntries = NULL;
@@ -187,12 +213,15 @@ GDALDownsampleChunk32R( int nSrcWidth, int nSrcHeight,
 /* ==================================================================== */
 /*      Loop over destination scanlines.                                */
 /* ==================================================================== */
-    for( int iDstLine = nDstYOff; iDstLine < nDstYOff2 && eErr == CE_None; iDstLine++ )
+    for( int iDstLine = nDstYOff; iDstLine < nDstYOff2; iDstLine++ )
     {
         float *pafSrcScanline;
         GByte *pabySrcScanlineNodataMask;
         int   nSrcYOff, nSrcYOff2 = 0, iDstPixel;
 
+        pafDstScanline = pafDstBuffer 
+            + (iDstLine - nDstYOff) * (nDstXOff2 - nDstXOff);
+
         if (eResampling == GRM_Gauss)
         {
             nSrcYOff = (int) (0.5 + (iDstLine/(double)nOYSize) * nSrcHeight);
@@ -625,13 +654,10 @@ GDALDownsampleChunk32R( int nSrcWidth, int nSrcHeight,
                 }
             } // end of gauss
         }
-
-        eErr = poOverview->RasterIO( GF_Write, nDstXOff, iDstLine, nDstXOff2 - nDstXOff, 1, 
-                                     pafDstScanline, nDstXOff2 - nDstXOff, 1, GDT_Float32, 
-                                     0, 0 );
     }
 
-    CPLFree( pafDstScanline );
+    *ppafDstBuffer = pafDstBuffer;
+
     CPLFree( aEntries );
     CPLFree( pafVals );
     CPLFree( panSums );
@@ -647,24 +673,20 @@ static CPLErr
 GDALDownsampleChunkC32R( int nSrcWidth, int nSrcHeight, 
                          float * pafChunk, int nChunkYOff, int nChunkYSize,
                          GDALRasterBand * poOverview,
-                         const char * pszResampling )
+                         const char * pszResampling,
+                         float ** ppafDstBuffer,
+                         int * pnDstXOff, int * pnDstXSize,
+                         int * pnDstYOff, int * pnDstYSize )
     
 {
     int      nDstYOff, nDstYOff2, nOXSize, nOYSize;
-    float    *pafDstScanline;
-    CPLErr   eErr = CE_None;
+    float    *pafDstBuffer, *pafDstScanline;
+
+    *ppafDstBuffer = NULL;
 
     nOXSize = poOverview->GetXSize();
     nOYSize = poOverview->GetYSize();
 
-    pafDstScanline = (float *) VSIMalloc(nOXSize * sizeof(float) * 2);
-    if( pafDstScanline == NULL )
-    {
-        CPLError( CE_Failure, CPLE_OutOfMemory,
-                  "GDALDownsampleChunkC32R: Out of memory for line buffer." );
-        return CE_Failure;
-    }
-
 /* -------------------------------------------------------------------- */
 /*      Figure out the line to start writing to, and the first line     */
 /*      to not write to.  In theory this approach should ensure that    */
@@ -677,15 +699,34 @@ GDALDownsampleChunkC32R( int nSrcWidth, int nSrcHeight,
 
     if( nChunkYOff + nChunkYSize == nSrcHeight )
         nDstYOff2 = nOYSize;
+
+    *pnDstXOff = 0;
+    *pnDstXSize = nOXSize;
+    *pnDstYOff = nDstYOff;
+    *pnDstYSize = nDstYOff2 - nDstYOff;
+
+    if( nDstYOff2 <= nDstYOff )
+        return CE_None;
+
+    pafDstBuffer = (float *) 
+        VSIMalloc3(nOXSize, (nDstYOff2 - nDstYOff), sizeof(float) * 2);
+    if( pafDstBuffer == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "GDALDownsampleChunkC32R: Out of memory for output buffer." );
+        return CE_Failure;
+    }
     
 /* ==================================================================== */
 /*      Loop over destination scanlines.                                */
 /* ==================================================================== */
-    for( int iDstLine = nDstYOff; iDstLine < nDstYOff2 && eErr == CE_None; iDstLine++ )
+    for( int iDstLine = nDstYOff; iDstLine < nDstYOff2; iDstLine++ )
     {
         float *pafSrcScanline;
         int   nSrcYOff, nSrcYOff2, iDstPixel;
 
+        pafDstScanline = pafDstBuffer + (iDstLine - nDstYOff) * nOXSize * 2;
+
         nSrcYOff = (int) (0.5 + (iDstLine/(double)nOYSize) * nSrcHeight);
         if( nSrcYOff < nChunkYOff )
             nSrcYOff = nChunkYOff;
@@ -787,13 +828,505 @@ GDALDownsampleChunkC32R( int nSrcWidth, int nSrcHeight,
                 }
             }
         }
+    }
+
+    *ppafDstBuffer = pafDstBuffer;
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                        GDALAverage2x2Line()                          */
+/*                                                                      */
+/*      Average non overlapping 2x2 windows of two source lines into    */
+/*      one destination line, rounding half away from zero as the       */
+/*      Float32 path does.  SSE2 versions handle 8 output pixels at     */
+/*      a time, the remainder being done by the scalar code.            */
+/************************************************************************/
+
+static void GDALAverage2x2Line( const GByte *pabySrc0, const GByte *pabySrc1,
+                                GByte *pabyDst, int nDstCount )
+
+{
+    int iDst = 0;
+
+#ifdef HAVE_SSE2_OVERVIEW
+    const __m128i xmmMaskLow = _mm_set1_epi16( 0x00ff );
+    const __m128i xmmTwo = _mm_set1_epi16( 2 );
+
+    for( ; iDst + 8 <= nDstCount; iDst += 8 )
+    {
+        __m128i xmm0 = _mm_loadu_si128( (const __m128i *) (pabySrc0 + iDst*2) );
+        __m128i xmm1 = _mm_loadu_si128( (const __m128i *) (pabySrc1 + iDst*2) );
+        __m128i xmmSum = _mm_add_epi16( 
+            _mm_add_epi16( _mm_and_si128( xmm0, xmmMaskLow ),
+                           _mm_srli_epi16( xmm0, 8 ) ),
+            _mm_add_epi16( _mm_and_si128( xmm1, xmmMaskLow ),
+                           _mm_srli_epi16( xmm1, 8 ) ) );
+
+        xmmSum = _mm_srli_epi16( _mm_add_epi16( xmmSum, xmmTwo ), 2 );
+        _mm_storel_epi64( (__m128i *) (pabyDst + iDst),
+                          _mm_packus_epi16( xmmSum, xmmSum ) );
+    }
+#endif
+
+    for( ; iDst < nDstCount; iDst++ )
+    {
+        int nSum = pabySrc0[iDst*2] + pabySrc0[iDst*2+1]
+                 + pabySrc1[iDst*2] + pabySrc1[iDst*2+1];
+
+        pabyDst[iDst] = (GByte) ((nSum + 2) >> 2);
+    }
+}
+
+static void GDALAverage2x2Line( const GUInt16 *panSrc0, const GUInt16 *panSrc1,
+                                GUInt16 *panDst, int nDstCount )
+
+{
+    int iDst = 0;
+
+#ifdef HAVE_SSE2_OVERVIEW
+    const __m128i xmmMaskLow = _mm_set1_epi32( 0x0000ffff );
+    const __m128i xmmBias = _mm_set1_epi32( 2 - 32768 * 4 );
+    const __m128i xmmSignBit = _mm_set1_epi16( (short) 0x8000 );
+
+    for( ; iDst + 8 <= nDstCount; iDst += 8 )
+    {
+        __m128i axmmRes[2];
+
+        for( int i = 0; i < 2; i++ )
+        {
+            __m128i xmm0 = _mm_loadu_si128( 
+                (const __m128i *) (panSrc0 + iDst*2 + i*8) );
+            __m128i xmm1 = _mm_loadu_si128( 
+                (const __m128i *) (panSrc1 + iDst*2 + i*8) );
+            __m128i xmmSum = _mm_add_epi32( 
+                _mm_add_epi32( _mm_and_si128( xmm0, xmmMaskLow ),
+                               _mm_srli_epi32( xmm0, 16 ) ),
+                _mm_add_epi32( _mm_and_si128( xmm1, xmmMaskLow ),
+                               _mm_srli_epi32( xmm1, 16 ) ) );
+
+            /* Shift into the signed range so that the signed saturating */
+            /* pack can be used, and flip the sign bit back afterwards. */
+            axmmRes[i] = _mm_srai_epi32( _mm_add_epi32( xmmSum, xmmBias ), 2 );
+        }
+
+        _mm_storeu_si128( (__m128i *) (panDst + iDst),
+                          _mm_xor_si128( _mm_packs_epi32( axmmRes[0], axmmRes[1] ),
+                                         xmmSignBit ) );
+    }
+#endif
+
+    for( ; iDst < nDstCount; iDst++ )
+    {
+        int nSum = panSrc0[iDst*2] + panSrc0[iDst*2+1]
+                 + panSrc1[iDst*2] + panSrc1[iDst*2+1];
+
+        panDst[iDst] = (GUInt16) ((nSum + 2) >> 2);
+    }
+}
+
+static void GDALAverage2x2Line( const GInt16 *panSrc0, const GInt16 *panSrc1,
+                                GInt16 *panDst, int nDstCount )
+
+{
+    int iDst = 0;
+
+#ifdef HAVE_SSE2_OVERVIEW
+    const __m128i xmmTwo = _mm_set1_epi32( 2 );
+
+    for( ; iDst + 8 <= nDstCount; iDst += 8 )
+    {
+        __m128i axmmRes[2];
+
+        for( int i = 0; i < 2; i++ )
+        {
+            __m128i xmm0 = _mm_loadu_si128( 
+                (const __m128i *) (panSrc0 + iDst*2 + i*8) );
+            __m128i xmm1 = _mm_loadu_si128( 
+                (const __m128i *) (panSrc1 + iDst*2 + i*8) );
+            __m128i xmmSum = _mm_add_epi32( 
+                _mm_add_epi32( _mm_srai_epi32( _mm_slli_epi32( xmm0, 16 ), 16 ),
+                               _mm_srai_epi32( xmm0, 16 ) ),
+                _mm_add_epi32( _mm_srai_epi32( _mm_slli_epi32( xmm1, 16 ), 16 ),
+                               _mm_srai_epi32( xmm1, 16 ) ) );
+
+            /* (nSum + 2 - (nSum < 0)) >> 2 rounds half away from zero */
+            axmmRes[i] = _mm_srai_epi32( 
+                _mm_add_epi32( _mm_add_epi32( xmmSum, xmmTwo ),
+                               _mm_srai_epi32( xmmSum, 31 ) ), 2 );
+        }
+
+        _mm_storeu_si128( (__m128i *) (panDst + iDst),
+                          _mm_packs_epi32( axmmRes[0], axmmRes[1] ) );
+    }
+#endif
+
+    for( ; iDst < nDstCount; iDst++ )
+    {
+        int nSum = panSrc0[iDst*2] + panSrc0[iDst*2+1]
+                 + panSrc1[iDst*2] + panSrc1[iDst*2+1];
+
+        panDst[iDst] = (GInt16) ((nSum + 2 - (nSum < 0)) >> 2);
+    }
+}
+
+/************************************************************************/
+/*                        GDALDownsampleChunkT()                        */
+/*                                                                      */
+/*      Nearest and average downsampling working directly on the       */
+/*      source data type, for Byte, UInt16 and Int16 bands whose        */
+/*      overviews have the same type.  This avoids the promotion of     */
+/*      the chunk to Float32 while producing the same values as         */
+/*      GDALDownsampleChunk32R().                                       */
+/************************************************************************/
+
+template <class T>
+static CPLErr
+GDALDownsampleChunkT( int nSrcWidth, int nSrcHeight, 
+                      T * paChunk,
+                      GByte * pabyChunkNodataMask,
+                      int nChunkXOff, int nChunkXSize,
+                      int nChunkYOff, int nChunkYSize,
+                      GDALRasterBand * poOverview,
+                      const char * pszResampling,
+                      int bHasNoData, float fNoDataValue,
+                      void ** ppDstBuffer,
+                      int * pnDstXOff, int * pnDstXSize,
+                      int * pnDstYOff, int * pnDstYSize )
+
+{
+    int      nDstXOff, nDstXOff2, nDstYOff, nDstYOff2, nOXSize, nOYSize;
+    int      bAverage = !EQUALN(pszResampling, "NEAR", 4);
+    T       *paDstBuffer;
+    T        tNoDataValue = 0;
+
+    if( bHasNoData )
+    {
+        /* Same clamping as the Float32 to T conversion of RasterIO() */
+        double dfNoDataValue = fNoDataValue;
+        if( dfNoDataValue < std::numeric_limits<T>::min() )
+            dfNoDataValue = std::numeric_limits<T>::min();
+        else if( dfNoDataValue > std::numeric_limits<T>::max() )
+            dfNoDataValue = std::numeric_limits<T>::max();
+        tNoDataValue = (T) (dfNoDataValue >= 0 ? dfNoDataValue + 0.5
+                                                : dfNoDataValue - 0.5);
+    }
+
+    *ppDstBuffer = NULL;
+
+    nOXSize = poOverview->GetXSize();
+    nOYSize = poOverview->GetYSize();
+
+/* -------------------------------------------------------------------- */
+/*      Figure out the destination window as GDALDownsampleChunk32R()   */
+/*      does.                                                           */
+/* -------------------------------------------------------------------- */
+    nDstXOff = (int) (0.5 + (nChunkXOff/(double)nSrcWidth) * nOXSize);
+    nDstXOff2 = (int) 
+        (0.5 + ((nChunkXOff+nChunkXSize)/(double)nSrcWidth) * nOXSize);
+
+    if( nChunkXOff + nChunkXSize == nSrcWidth )
+        nDstXOff2 = nOXSize;
+
+    nDstYOff = (int) (0.5 + (nChunkYOff/(double)nSrcHeight) * nOYSize);
+    nDstYOff2 = (int) 
+        (0.5 + ((nChunkYOff+nChunkYSize)/(double)nSrcHeight) * nOYSize);
+
+    if( nChunkYOff + nChunkYSize == nSrcHeight )
+        nDstYOff2 = nOYSize;
+
+    *pnDstXOff = nDstXOff;
+    *pnDstXSize = nDstXOff2 - nDstXOff;
+    *pnDstYOff = nDstYOff;
+    *pnDstYSize = nDstYOff2 - nDstYOff;
+
+    if( nDstXOff2 <= nDstXOff || nDstYOff2 <= nDstYOff )
+        return CE_None;
+
+    paDstBuffer = (T *) 
+        VSIMalloc3((nDstXOff2 - nDstXOff), (nDstYOff2 - nDstYOff), sizeof(T));
+    if( paDstBuffer == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "GDALDownsampleChunkT: Out of memory for output buffer." );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Fast path for an exact 2x2 average without mask.                */
+/* -------------------------------------------------------------------- */
+    if( bAverage && pabyChunkNodataMask == NULL
+        && nSrcWidth == 2 * nOXSize && nSrcHeight == 2 * nOYSize
+        && (nChunkXOff % 2) == 0 && (nChunkXSize % 2) == 0
+        && (nChunkYOff % 2) == 0 && (nChunkYSize % 2) == 0 )
+    {
+        for( int iDstLine = nDstYOff; iDstLine < nDstYOff2; iDstLine++ )
+        {
+            T *paSrc0 = paChunk + (iDstLine * 2 - nChunkYOff) * nChunkXSize;
+
+            GDALAverage2x2Line( paSrc0, paSrc0 + nChunkXSize,
+                                paDstBuffer + (iDstLine - nDstYOff) 
+                                                * (nDstXOff2 - nDstXOff),
+                                nDstXOff2 - nDstXOff );
+        }
+
+        *ppDstBuffer = paDstBuffer;
+        return CE_None;
+    }
+
+/* ==================================================================== */
+/*      Loop over destination scanlines.                                */
+/* ==================================================================== */
+    for( int iDstLine = nDstYOff; iDstLine < nDstYOff2; iDstLine++ )
+    {
+        T     *paSrcScanline, *paDstScanline;
+        GByte *pabySrcScanlineNodataMask;
+        int   nSrcYOff, nSrcYOff2, iDstPixel;
+
+        paDstScanline = paDstBuffer 
+            + (iDstLine - nDstYOff) * (nDstXOff2 - nDstXOff);
+
+        nSrcYOff = (int) (0.5 + (iDstLine/(double)nOYSize) * nSrcHeight);
+        if ( nSrcYOff < nChunkYOff )
+            nSrcYOff = nChunkYOff;
+            
+        nSrcYOff2 = 
+            (int) (0.5 + ((iDstLine+1)/(double)nOYSize) * nSrcHeight);
+
+        if( nSrcYOff2 > nSrcHeight || iDstLine == nOYSize-1 )
+            nSrcYOff2 = nSrcHeight;
+        if( nSrcYOff2 > nChunkYOff + nChunkYSize)
+            nSrcYOff2 = nChunkYOff + nChunkYSize;
+
+        paSrcScanline = paChunk + ((nSrcYOff-nChunkYOff) * nChunkXSize);
+        if (pabyChunkNodataMask != NULL)
+            pabySrcScanlineNodataMask = pabyChunkNodataMask + ((nSrcYOff-nChunkYOff) * nChunkXSize);
+        else
+            pabySrcScanlineNodataMask = NULL;
+
+/* -------------------------------------------------------------------- */
+/*      Loop over destination pixels                                    */
+/* -------------------------------------------------------------------- */
+        for( iDstPixel = nDstXOff; iDstPixel < nDstXOff2; iDstPixel++ )
+        {
+            int   nSrcXOff, nSrcXOff2;
+
+            nSrcXOff =
+                (int) (0.5 + (iDstPixel/(double)nOXSize) * nSrcWidth);
+            if ( nSrcXOff < nChunkXOff )
+                nSrcXOff = nChunkXOff;
+            nSrcXOff2 = (int) 
+                (0.5 + ((iDstPixel+1)/(double)nOXSize) * nSrcWidth);
+
+            if( nSrcXOff2 > nSrcWidth || iDstPixel == nOXSize-1 )
+                nSrcXOff2 = nSrcWidth;
+            if( nSrcXOff2 > nChunkXOff + nChunkXSize )
+                nSrcXOff2 = nChunkXOff + nChunkXSize;
+
+            if( !bAverage )
+            {
+                paDstScanline[iDstPixel - nDstXOff] = 
+                    paSrcScanline[nSrcXOff - nChunkXOff];
+                continue;
+            }
+
+            GIntBig nTotal = 0;
+            int     nCount = 0, iX, iY;
+
+            for( iY = nSrcYOff; iY < nSrcYOff2; iY++ )
+            {
+                int iOff = (iY-nSrcYOff)*nChunkXSize - nChunkXOff;
+
+                if( pabySrcScanlineNodataMask == NULL )
+                {
+                    for( iX = nSrcXOff; iX < nSrcXOff2; iX++ )
+                        nTotal += paSrcScanline[iX + iOff];
+                    nCount += nSrcXOff2 - nSrcXOff;
+                }
+                else
+                {
+                    for( iX = nSrcXOff; iX < nSrcXOff2; iX++ )
+                    {
+                        if( pabySrcScanlineNodataMask[iX + iOff] )
+                        {
+                            nTotal += paSrcScanline[iX + iOff];
+                            nCount++;
+                        }
+                    }
+                }
+            }
+
+            if( nCount == 0 )
+                paDstScanline[iDstPixel - nDstXOff] = tNoDataValue;
+            else if( nTotal >= 0 )
+                paDstScanline[iDstPixel - nDstXOff] = 
+                    (T) ((nTotal + nCount / 2) / nCount);
+            else
+                paDstScanline[iDstPixel - nDstXOff] = 
+                    (T) -((-nTotal + nCount / 2) / nCount);
+        }
+    }
+
+    *ppDstBuffer = paDstBuffer;
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                     GDALGetOverviewWorkDataType()                    */
+/*                                                                      */
+/*      Return the data type in which the chunks should be read and     */
+/*      downsampled: the source type when GDALDownsampleChunkT() can    */
+/*      handle the request, GDT_Float32 otherwise.                      */
+/************************************************************************/
+
+static GDALDataType
+GDALGetOverviewWorkDataType( GDALDataType eSrcDataType,
+                             const char * pszResampling,
+                             GDALColorTable * poColorTable,
+                             int nOverviews, GDALRasterBand ** papoOvrBands )
+
+{
+    if( eSrcDataType != GDT_Byte && eSrcDataType != GDT_UInt16 
+        && eSrcDataType != GDT_Int16 )
+        return GDT_Float32;
+
+    if( !EQUALN(pszResampling, "NEAR", 4) 
+        && !(EQUAL(pszResampling, "AVERAGE") && poColorTable == NULL) )
+        return GDT_Float32;
+
+    if( !CSLTestBoolean( CPLGetConfigOption( "GDAL_OVR_NATIVE_TYPES", "YES" ) ) )
+        return GDT_Float32;
 
-        eErr = poOverview->RasterIO( GF_Write, 0, iDstLine, nOXSize, 1, 
-                                     pafDstScanline, nOXSize, 1, GDT_CFloat32, 
-                                     0, 0 );
+    for( int iOverview = 0; iOverview < nOverviews; iOverview++ )
+    {
+        if( papoOvrBands[iOverview]->GetRasterDataType() != eSrcDataType )
+            return GDT_Float32;
     }
 
-    CPLFree( pafDstScanline );
+    return eSrcDataType;
+}
+
+/************************************************************************/
+/*                      GDALOverviewChunkJobMain()                      */
+/*                                                                      */
+/*      One unit of overview computation: the downsampling of one       */
+/*      source chunk of one band into one overview band.  Jobs only     */
+/*      touch memory buffers, so a batch of them can be run on worker   */
+/*      threads while reading and writing stays on the calling thread.  */
+/************************************************************************/
+
+typedef struct
+{
+    int             nSrcWidth;
+    int             nSrcHeight;
+    GDALDataType    eWrkDataType;
+    void           *pChunk;
+    GByte          *pabyChunkNodataMask;
+    int             nChunkXOff;
+    int             nChunkXSize;
+    int             nChunkYOff;
+    int             nChunkYSize;
+    GDALRasterBand *poOverview;
+    const char     *pszResampling;
+    int             bHasNoData;
+    float           fNoDataValue;
+    GDALColorTable *poColorTable;
+    GDALDataType    eSrcDataType;
+
+    void           *pDstBuffer;
+    int             nDstXOff;
+    int             nDstXSize;
+    int             nDstYOff;
+    int             nDstYSize;
+    CPLErr          eErr;
+} GDALOverviewChunkJob;
+
+static void GDALOverviewChunkJobMain( void *pData )
+
+{
+    GDALOverviewChunkJob *psJob = (GDALOverviewChunkJob *) pData;
+
+#define DOWNSAMPLE_NATIVE(T) \
+        psJob->eErr = \
+            GDALDownsampleChunkT<T>( psJob->nSrcWidth, psJob->nSrcHeight, \
+                                     (T *) psJob->pChunk, \
+                                     psJob->pabyChunkNodataMask, \
+                                     psJob->nChunkXOff, psJob->nChunkXSize, \
+                                     psJob->nChunkYOff, psJob->nChunkYSize, \
+                                     psJob->poOverview, psJob->pszResampling, \
+                                     psJob->bHasNoData, psJob->fNoDataValue, \
+                                     &(psJob->pDstBuffer), \
+                                     &(psJob->nDstXOff), &(psJob->nDstXSize), \
+                                     &(psJob->nDstYOff), &(psJob->nDstYSize) )
+
+    switch( psJob->eWrkDataType )
+    {
+      case GDT_Byte:
+        DOWNSAMPLE_NATIVE(GByte);
+        break;
+
+      case GDT_UInt16:
+        DOWNSAMPLE_NATIVE(GUInt16);
+        break;
+
+      case GDT_Int16:
+        DOWNSAMPLE_NATIVE(GInt16);
+        break;
+
+      case GDT_Float32:
+        psJob->eErr = 
+            GDALDownsampleChunk32R( psJob->nSrcWidth, psJob->nSrcHeight,
+                                    (float *) psJob->pChunk,
+                                    psJob->pabyChunkNodataMask,
+                                    psJob->nChunkXOff, psJob->nChunkXSize,
+                                    psJob->nChunkYOff, psJob->nChunkYSize,
+                                    psJob->poOverview, psJob->pszResampling,
+                                    psJob->bHasNoData, psJob->fNoDataValue,
+                                    psJob->poColorTable, psJob->eSrcDataType,
+                                    (float **) &(psJob->pDstBuffer),
+                                    &(psJob->nDstXOff), &(psJob->nDstXSize),
+                                    &(psJob->nDstYOff), &(psJob->nDstYSize) );
+        break;
+
+      default:
+        psJob->eErr = 
+            GDALDownsampleChunkC32R( psJob->nSrcWidth, psJob->nSrcHeight,
+                                     (float *) psJob->pChunk,
+                                     psJob->nChunkYOff, psJob->nChunkYSize,
+                                     psJob->poOverview, psJob->pszResampling,
+                                     (float **) &(psJob->pDstBuffer),
+                                     &(psJob->nDstXOff), &(psJob->nDstXSize),
+                                     &(psJob->nDstYOff), &(psJob->nDstYSize) );
+        break;
+    }
+
+#undef DOWNSAMPLE_NATIVE
+}
+
+/************************************************************************/
+/*                     GDALOverviewChunkJobWrite()                      */
+/*                                                                      */
+/*      Write the result of a completed job to its overview band,       */
+/*      and release its output buffer.                                  */
+/************************************************************************/
+
+static CPLErr GDALOverviewChunkJobWrite( GDALOverviewChunkJob *psJob )
+
+{
+    CPLErr eErr = psJob->eErr;
+
+    if( eErr == CE_None && psJob->pDstBuffer != NULL )
+        eErr = psJob->poOverview->RasterIO( GF_Write, 
+                                            psJob->nDstXOff, psJob->nDstYOff,
+                                            psJob->nDstXSize, psJob->nDstYSize,
+                                            psJob->pDstBuffer,
+                                            psJob->nDstXSize, psJob->nDstYSize,
+                                            psJob->eWrkDataType, 0, 0 );
+
+    CPLFree( psJob->pDstBuffer );
+    psJob->pDstBuffer = NULL;
 
     return eErr;
 }
@@ -916,6 +1449,10 @@ GDALRegenerateCascadingOverviews(
  * that only a given RGB triplet (in case of a RGB image) will be considered as the
  * nodata value and not each value of the triplet independantly per band.
  *
+ * The GDAL_NUM_THREADS configuration option (a number or ALL_CPUS) can be
+ * set to compute several source swaths concurrently.  Reading and writing
+ * are still done in order from the calling thread.
+ *
  * @param hSrcBand the source (base level) band. 
  * @param nOverviewCount the number of downsampled bands being generated.
  * @param pahOvrBands the list of downsampled bands to be generated.
@@ -998,10 +1535,15 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
                                                  pProgressData );
 
 /* -------------------------------------------------------------------- */
-/*      Setup one horizontal swath to read from the raw buffer.         */
+/*      Setup horizontal swaths to read from the raw buffer.  When      */
+/*      several threads are requested (GDAL_NUM_THREADS) we read one    */
+/*      swath per thread, downsample them concurrently and then         */
+/*      write the results in order.                                     */
 /* -------------------------------------------------------------------- */
-    float *pafChunk;
-    GByte *pabyChunkNodataMask = NULL;
+    void  **papChunk;
+    GByte **papabyChunkNodataMask;
+    int    nThreads = CPLGetNumThreads( NULL );
+    int    nSwathCount = nThreads, iSwath;
 
     poSrcBand->GetBlockSize( &nFRXBlockSize, &nFRYBlockSize );
     
@@ -1013,21 +1555,49 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
     if( GDALDataTypeIsComplex( poSrcBand->GetRasterDataType() ) )
         eType = GDT_CFloat32;
     else
-        eType = GDT_Float32;
+        eType = GDALGetOverviewWorkDataType( poSrcBand->GetRasterDataType(),
+                                             pszResampling, poColorTable,
+                                             nOverviewCount, papoOvrBands );
 
     nWidth = poSrcBand->GetXSize();
-    pafChunk = (float *) 
-        VSIMalloc3((GDALGetDataTypeSize(eType)/8), nFullResYChunk, nWidth );
-    if (bUseNoDataMask)
+
+    if( nSwathCount > 1 )
+    {
+        int nSwaths = (poSrcBand->GetYSize() + nFullResYChunk - 1) / nFullResYChunk;
+        if( nSwathCount > nSwaths )
+            nSwathCount = nSwaths;
+        if( nSwathCount < 1 )
+            nSwathCount = 1;
+    }
+
+    papChunk = (void **) CPLCalloc( sizeof(void*), nSwathCount );
+    papabyChunkNodataMask = (GByte **) CPLCalloc( sizeof(GByte*), nSwathCount );
+
+    int bOutOfMemory = FALSE;
+    for( iSwath = 0; iSwath < nSwathCount; iSwath++ )
     {
-        pabyChunkNodataMask = (GByte *) 
-            (GByte*) VSIMalloc2( nFullResYChunk, nWidth );
+        papChunk[iSwath] = 
+            VSIMalloc3((GDALGetDataTypeSize(eType)/8), nFullResYChunk, nWidth );
+        if (bUseNoDataMask)
+        {
+            papabyChunkNodataMask[iSwath] = (GByte *) 
+                VSIMalloc2( nFullResYChunk, nWidth );
+        }
+
+        if( papChunk[iSwath] == NULL 
+            || (bUseNoDataMask && papabyChunkNodataMask[iSwath] == NULL) )
+            bOutOfMemory = TRUE;
     }
 
-    if( pafChunk == NULL || (bUseNoDataMask && pabyChunkNodataMask == NULL))
+    if( bOutOfMemory )
     {
-        CPLFree(pafChunk);
-        CPLFree(pabyChunkNodataMask);
+        for( iSwath = 0; iSwath < nSwathCount; iSwath++ )
+        {
+            CPLFree(papChunk[iSwath]);
+            CPLFree(papabyChunkNodataMask[iSwath]);
+        }
+        CPLFree(papChunk);
+        CPLFree(papabyChunkNodataMask);
         CPLError( CE_Failure, CPLE_OutOfMemory, 
                   "Out of memory in GDALRegenerateOverviews()." );
 
@@ -1036,80 +1606,127 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
 
     fNoDataValue = (float) poSrcBand->GetNoDataValue(&bHasNoData);
 
+    GDALOverviewChunkJob *pasJobs = (GDALOverviewChunkJob *)
+        CPLCalloc( sizeof(GDALOverviewChunkJob), nSwathCount * nOverviewCount );
+    void **papJobs = (void **) 
+        CPLCalloc( sizeof(void*), nSwathCount * nOverviewCount );
+
 /* -------------------------------------------------------------------- */
 /*      Loop over image operating on chunks.                            */
 /* -------------------------------------------------------------------- */
     int  nChunkYOff = 0;
     CPLErr eErr = CE_None;
 
-    for( nChunkYOff = 0; 
-         nChunkYOff < poSrcBand->GetYSize() && eErr == CE_None; 
-         nChunkYOff += nFullResYChunk )
+    while( nChunkYOff < poSrcBand->GetYSize() && eErr == CE_None )
     {
-        if( !pfnProgress( nChunkYOff / (double) poSrcBand->GetYSize(), 
-                          NULL, pProgressData ) )
+        int nJobs = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Read a batch of swaths.                                         */
+/* -------------------------------------------------------------------- */
+        for( iSwath = 0;
+             iSwath < nSwathCount && nChunkYOff < poSrcBand->GetYSize() 
+                 && eErr == CE_None;
+             iSwath++, nChunkYOff += nFullResYChunk )
         {
-            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-            eErr = CE_Failure;
-        }
+            void  *pChunk = papChunk[iSwath];
+            float *pafChunk = (float *) pChunk;
+            GByte *pabyChunkNodataMask = papabyChunkNodataMask[iSwath];
+
+            if( !pfnProgress( nChunkYOff / (double) poSrcBand->GetYSize(), 
+                              NULL, pProgressData ) )
+            {
+                CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+                eErr = CE_Failure;
+            }
 
-        if( nFullResYChunk + nChunkYOff > poSrcBand->GetYSize() )
-            nFullResYChunk = poSrcBand->GetYSize() - nChunkYOff;
+            if( nFullResYChunk + nChunkYOff > poSrcBand->GetYSize() )
+                nFullResYChunk = poSrcBand->GetYSize() - nChunkYOff;
         
-        /* read chunk */
-        if (eErr == CE_None)
-            eErr = poSrcBand->RasterIO( GF_Read, 0, nChunkYOff, nWidth, nFullResYChunk, 
-                                pafChunk, nWidth, nFullResYChunk, eType,
-                                0, 0 );
-        if (eErr == CE_None && bUseNoDataMask)
-            eErr = poSrcBand->GetMaskBand()->RasterIO( GF_Read, 0, nChunkYOff, nWidth, nFullResYChunk, 
-                                pabyChunkNodataMask, nWidth, nFullResYChunk, GDT_Byte,
-                                0, 0 );
-
-        /* special case to promote 1bit data to 8bit 0/255 values */
-        if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE") )
-        {
-            int i;
+            /* read chunk */
+            if (eErr == CE_None)
+                eErr = poSrcBand->RasterIO( GF_Read, 0, nChunkYOff, nWidth, nFullResYChunk, 
+                                    pChunk, nWidth, nFullResYChunk, eType,
+                                    0, 0 );
+            if (eErr == CE_None && bUseNoDataMask)
+                eErr = poSrcBand->GetMaskBand()->RasterIO( GF_Read, 0, nChunkYOff, nWidth, nFullResYChunk, 
+                                    pabyChunkNodataMask, nWidth, nFullResYChunk, GDT_Byte,
+                                    0, 0 );
+
+            /* special case to promote 1bit data to 8bit 0/255 values */
+            if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE") )
+            {
+                int i;
 
-            for( i = nFullResYChunk*nWidth - 1; i >= 0; i-- )
+                for( i = nFullResYChunk*nWidth - 1; i >= 0; i-- )
+                {
+                    if( pafChunk[i] == 1.0 )
+                        pafChunk[i] = 255.0;
+                }
+            }
+            else if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE_MINISWHITE") )
             {
-                if( pafChunk[i] == 1.0 )
-                    pafChunk[i] = 255.0;
+                int i;
+
+                for( i = nFullResYChunk*nWidth - 1; i >= 0; i-- )
+                {
+                    if( pafChunk[i] == 1.0 )
+                        pafChunk[i] = 0.0;
+                    else if( pafChunk[i] == 0.0 )
+                        pafChunk[i] = 255.0;
+                }
             }
-        }
-        else if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE_MINISWHITE") )
-        {
-            int i;
 
-            for( i = nFullResYChunk*nWidth - 1; i >= 0; i-- )
+            for( int iOverview = 0; iOverview < nOverviewCount; iOverview++ )
             {
-                if( pafChunk[i] == 1.0 )
-                    pafChunk[i] = 0.0;
-                else if( pafChunk[i] == 0.0 )
-                    pafChunk[i] = 255.0;
+                GDALOverviewChunkJob *psJob = pasJobs + nJobs;
+
+                psJob->nSrcWidth = nWidth;
+                psJob->nSrcHeight = poSrcBand->GetYSize();
+                psJob->eWrkDataType = eType;
+                psJob->pChunk = pChunk;
+                psJob->pabyChunkNodataMask = pabyChunkNodataMask;
+                psJob->nChunkXOff = 0;
+                psJob->nChunkXSize = nWidth;
+                psJob->nChunkYOff = nChunkYOff;
+                psJob->nChunkYSize = nFullResYChunk;
+                psJob->poOverview = papoOvrBands[iOverview];
+                psJob->pszResampling = pszResampling;
+                psJob->bHasNoData = bHasNoData;
+                psJob->fNoDataValue = fNoDataValue;
+                psJob->poColorTable = poColorTable;
+                psJob->eSrcDataType = poSrcBand->GetRasterDataType();
+                psJob->pDstBuffer = NULL;
+                psJob->eErr = CE_None;
+
+                papJobs[nJobs++] = psJob;
             }
         }
-        
-        for( int iOverview = 0; iOverview < nOverviewCount && eErr == CE_None; iOverview++ )
+
+/* -------------------------------------------------------------------- */
+/*      Downsample them, and write the results in order.                */
+/* -------------------------------------------------------------------- */
+        if( eErr == CE_None )
+            CPLRunJobs( nJobs, papJobs, GDALOverviewChunkJobMain, nThreads );
+
+        for( int iJob = 0; iJob < nJobs; iJob++ )
         {
-            if( eType == GDT_Float32 )
-                eErr = GDALDownsampleChunk32R(nWidth, poSrcBand->GetYSize(), 
-                                              pafChunk,
-                                              pabyChunkNodataMask,
-                                              0, nWidth,
-                                              nChunkYOff, nFullResYChunk,
-                                              papoOvrBands[iOverview], pszResampling,
-                                              bHasNoData, fNoDataValue, poColorTable,
-                                              poSrcBand->GetRasterDataType());
+            if( eErr == CE_None )
+                eErr = GDALOverviewChunkJobWrite( pasJobs + iJob );
             else
-                eErr = GDALDownsampleChunkC32R(nWidth, poSrcBand->GetYSize(), 
-                                               pafChunk, nChunkYOff, nFullResYChunk,
-                                               papoOvrBands[iOverview], pszResampling);
+                CPLFree( pasJobs[iJob].pDstBuffer );
         }
     }
 
-    VSIFree( pafChunk );
-    VSIFree( pabyChunkNodataMask );
+    for( iSwath = 0; iSwath < nSwathCount; iSwath++ )
+    {
+        VSIFree( papChunk[iSwath] );
+        VSIFree( papabyChunkNodataMask[iSwath] );
+    }
+    CPLFree( papChunk );
+    CPLFree( papabyChunkNodataMask );
+    CPLFree( pasJobs );
+    CPLFree( papJobs );
     
 /* -------------------------------------------------------------------- */
 /*      Renormalized overview mean / stddev if needed.                  */
@@ -1171,6 +1788,10 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
  * that only a given RGB triplet (in case of a RGB image) will be considered as the
  * nodata value and not each value of the triplet independantly per band.
  *
+ * The GDAL_NUM_THREADS configuration option (a number or ALL_CPUS) can be
+ * set to compute the blocks of several bands and source chunks concurrently.
+ * The overview blocks are still written in the above order.
+ *
  * @param nBands the number of bands, size of papoSrcBands and size of
  *               first dimension of papapoOverviewBands
  * @param papoSrcBands the list of source bands to downsample
@@ -1278,6 +1899,7 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
 
     int* pabHasNoData = (int*)CPLMalloc(nBands * sizeof(int));
     float* pafNoDataValue = (float*)CPLMalloc(nBands * sizeof(float));
+    int nThreads = CPLGetNumThreads( NULL );
 
     for(iBand=0;iBand<nBands;iBand++)
     {
@@ -1311,52 +1933,80 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
         int nFullResXChunk = (nDstBlockXSize * nSrcWidth) / nDstWidth;
         int nFullResYChunk = (nDstBlockYSize * nSrcHeight) / nDstHeight;
 
-        float** papafChunk = (float**) CPLMalloc(nBands * sizeof(void*));
-        GByte* pabyChunkNoDataMask = NULL;
-        for(iBand=0;iBand<nBands;iBand++)
+        /* With several threads, a batch of source chunks is read for all */
+        /* the bands, the (chunk, band) pairs are downsampled concurrently */
+        /* and the resulting overview blocks are written in order. */
+        int nXChunks = (nSrcWidth + nFullResXChunk - 1) / nFullResXChunk;
+        int nYChunks = (nSrcHeight + nFullResYChunk - 1) / nFullResYChunk;
+        int nTotalChunks = nXChunks * nYChunks;
+        int nBatchChunks = 1, iChunk;
+
+        if( nThreads > 1 )
         {
-            papafChunk[iBand] = (float*) VSIMalloc3(nFullResXChunk, nFullResYChunk, sizeof(float));
-            if( papafChunk[iBand] == NULL )
+            nBatchChunks = (nThreads + nBands - 1) / nBands;
+            if( nBatchChunks > nTotalChunks )
+                nBatchChunks = nTotalChunks;
+            if( nBatchChunks < 1 )
+                nBatchChunks = 1;
+        }
+
+        GDALDataType eWrkDataType = 
+            GDALGetOverviewWorkDataType( eDataType, pszResampling, NULL,
+                                         1, &(papapoOverviewBands[0][iOverview]) );
+        void** papChunk = (void**) 
+            CPLCalloc(nBatchChunks * nBands, sizeof(void*));
+        GByte** papabyChunkNoDataMask = (GByte**) 
+            CPLCalloc(nBatchChunks, sizeof(void*));
+        int bOutOfMemory = FALSE;
+
+        for(iChunk=0;iChunk<nBatchChunks && !bOutOfMemory;iChunk++)
+        {
+            for(iBand=0;iBand<nBands;iBand++)
             {
-                while ( --iBand >= 0)
-                    CPLFree(papafChunk[iBand]);
-                CPLFree(papafChunk);
-                CPLFree(pabHasNoData);
-                CPLFree(pafNoDataValue);
-
-                CPLError( CE_Failure, CPLE_OutOfMemory,
-                        "GDALRegenerateOverviewsMultiBand: Out of memory." );
-                return CE_Failure;
+                papChunk[iChunk*nBands+iBand] = 
+                    VSIMalloc3(nFullResXChunk, nFullResYChunk, 
+                               GDALGetDataTypeSize(eWrkDataType) / 8);
+                if( papChunk[iChunk*nBands+iBand] == NULL )
+                    bOutOfMemory = TRUE;
+            }
+            if (bUseNoDataMask)
+            {
+                papabyChunkNoDataMask[iChunk] = (GByte*) 
+                    VSIMalloc2(nFullResXChunk, nFullResYChunk);
+                if( papabyChunkNoDataMask[iChunk] == NULL )
+                    bOutOfMemory = TRUE;
             }
         }
-        if (bUseNoDataMask)
+
+        if( bOutOfMemory )
         {
-            pabyChunkNoDataMask = (GByte*) VSIMalloc2(nFullResXChunk, nFullResYChunk);
-            if( pabyChunkNoDataMask == NULL )
+            for(iChunk=0;iChunk<nBatchChunks;iChunk++)
             {
                 for(iBand=0;iBand<nBands;iBand++)
-                {
-                    CPLFree(papafChunk[iBand]);
-                }
-                CPLFree(papafChunk);
-                CPLFree(pabHasNoData);
-                CPLFree(pafNoDataValue);
-
-                CPLError( CE_Failure, CPLE_OutOfMemory,
-                        "GDALRegenerateOverviewsMultiBand: Out of memory." );
-                return CE_Failure;
+                    CPLFree(papChunk[iChunk*nBands+iBand]);
+                CPLFree(papabyChunkNoDataMask[iChunk]);
             }
+            CPLFree(papChunk);
+            CPLFree(papabyChunkNoDataMask);
+            CPLFree(pabHasNoData);
+            CPLFree(pafNoDataValue);
+
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                    "GDALRegenerateOverviewsMultiBand: Out of memory." );
+            return CE_Failure;
         }
 
-        int nChunkYOff;
+        GDALOverviewChunkJob *pasJobs = (GDALOverviewChunkJob *)
+            CPLCalloc( sizeof(GDALOverviewChunkJob), nBatchChunks * nBands );
+        void **papJobs = (void **) 
+            CPLCalloc( sizeof(void*), nBatchChunks * nBands );
+
         /* Iterate on destination overview, block by block */
-        for( nChunkYOff = 0; nChunkYOff < nSrcHeight && eErr == CE_None; nChunkYOff += nFullResYChunk )
+        int iChunkStart;
+        for( iChunkStart = 0; iChunkStart < nTotalChunks && eErr == CE_None; 
+             iChunkStart += nBatchChunks )
         {
-            int nYCount;
-            if  (nChunkYOff + nFullResYChunk <= nSrcHeight)
-                nYCount = nFullResYChunk;
-            else
-                nYCount = nSrcHeight - nChunkYOff;
+            int nJobs = 0;
 
             if( !pfnProgress( dfCurPixelCount / dfTotalPixelCount, 
                               NULL, pProgressData ) )
@@ -1365,15 +2015,27 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
                 eErr = CE_Failure;
             }
 
-            int nChunkXOff;
-            for( nChunkXOff = 0; nChunkXOff < nSrcWidth && eErr == CE_None; nChunkXOff += nFullResXChunk )
+            for( iChunk = 0; 
+                 iChunk < nBatchChunks && iChunkStart + iChunk < nTotalChunks
+                     && eErr == CE_None;
+                 iChunk++ )
             {
-                int nXCount;
+                int nChunkXOff = 
+                    ((iChunkStart + iChunk) % nXChunks) * nFullResXChunk;
+                int nChunkYOff = 
+                    ((iChunkStart + iChunk) / nXChunks) * nFullResYChunk;
+                int nXCount, nYCount;
+
                 if  (nChunkXOff + nFullResXChunk <= nSrcWidth)
                     nXCount = nFullResXChunk;
                 else
                     nXCount = nSrcWidth - nChunkXOff;
 
+                if  (nChunkYOff + nFullResYChunk <= nSrcHeight)
+                    nYCount = nFullResYChunk;
+                else
+                    nYCount = nSrcHeight - nChunkYOff;
+
                 /* Read the source buffers for all the bands */
                 for(iBand=0;iBand<nBands && eErr == CE_None;iBand++)
                 {
@@ -1385,9 +2047,9 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
                     eErr = poSrcBand->RasterIO( GF_Read,
                                                 nChunkXOff, nChunkYOff,
                                                 nXCount, nYCount, 
-                                                papafChunk[iBand],
+                                                papChunk[iChunk*nBands+iBand],
                                                 nXCount, nYCount,
-                                                GDT_Float32, 0, 0 );
+                                                eWrkDataType, 0, 0 );
                 }
 
                 if (bUseNoDataMask && eErr == CE_None)
@@ -1400,39 +2062,68 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
                     eErr = poSrcBand->GetMaskBand()->RasterIO( GF_Read,
                                                                nChunkXOff, nChunkYOff,
                                                                nXCount, nYCount, 
-                                                               pabyChunkNoDataMask,
+                                                               papabyChunkNoDataMask[iChunk],
                                                                nXCount, nYCount,
                                                                GDT_Byte, 0, 0 );
                 }
 
-                /* Compute the resulting overview block */
-                for(iBand=0;iBand<nBands && eErr == CE_None;iBand++)
+                /* Prepare the computation of the resulting overview block */
+                for(iBand=0;iBand<nBands;iBand++)
                 {
-                    eErr = GDALDownsampleChunk32R(nSrcWidth, nSrcHeight,
-                                                  papafChunk[iBand],
-                                                  pabyChunkNoDataMask,
-                                                  nChunkXOff, nXCount,
-                                                  nChunkYOff, nYCount,
-                                                  papapoOverviewBands[iBand][iOverview],
-                                                  pszResampling,
-                                                  pabHasNoData[iBand],
-                                                  pafNoDataValue[iBand],
-                                                  /*poColorTable*/ NULL,
-                                                  eDataType);
+                    GDALOverviewChunkJob *psJob = pasJobs + nJobs;
+
+                    psJob->nSrcWidth = nSrcWidth;
+                    psJob->nSrcHeight = nSrcHeight;
+                    psJob->eWrkDataType = eWrkDataType;
+                    psJob->pChunk = papChunk[iChunk*nBands+iBand];
+                    psJob->pabyChunkNodataMask = papabyChunkNoDataMask[iChunk];
+                    psJob->nChunkXOff = nChunkXOff;
+                    psJob->nChunkXSize = nXCount;
+                    psJob->nChunkYOff = nChunkYOff;
+                    psJob->nChunkYSize = nYCount;
+                    psJob->poOverview = papapoOverviewBands[iBand][iOverview];
+                    psJob->pszResampling = pszResampling;
+                    psJob->bHasNoData = pabHasNoData[iBand];
+                    psJob->fNoDataValue = pafNoDataValue[iBand];
+                    psJob->poColorTable = NULL;
+                    psJob->eSrcDataType = eDataType;
+                    psJob->pDstBuffer = NULL;
+                    psJob->eErr = CE_None;
+
+                    papJobs[nJobs++] = psJob;
                 }
+
+                dfCurPixelCount += (double)nXCount * nYCount;
             }
 
-            dfCurPixelCount += (double)nYCount * nSrcWidth;
+            /* Compute the resulting overview blocks, and write them in order */
+            if( eErr == CE_None )
+                CPLRunJobs( nJobs, papJobs, GDALOverviewChunkJobMain, nThreads );
+
+            for( int iJob = 0; iJob < nJobs; iJob++ )
+            {
+                if( eErr == CE_None )
+                    eErr = GDALOverviewChunkJobWrite( pasJobs + iJob );
+                else
+                    CPLFree( pasJobs[iJob].pDstBuffer );
+            }
         }
 
         /* Flush the data to overviews */
         for(iBand=0;iBand<nBands;iBand++)
         {
-            CPLFree(papafChunk[iBand]);
             papapoOverviewBands[iBand][iOverview]->FlushCache();
         }
-        CPLFree(papafChunk);
-        CPLFree(pabyChunkNoDataMask);
+        for(iChunk=0;iChunk<nBatchChunks;iChunk++)
+        {
+            for(iBand=0;iBand<nBands;iBand++)
+                CPLFree(papChunk[iChunk*nBands+iBand]);
+            CPLFree(papabyChunkNoDataMask[iChunk]);
+        }
+        CPLFree(papChunk);
+        CPLFree(papabyChunkNoDataMask);
+        CPLFree(pasJobs);
+        CPLFree(papJobs);
 
     }
 
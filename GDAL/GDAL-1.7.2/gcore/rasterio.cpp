@@ -40,6 +40,13 @@
 #define USE_NEW_COPYWORDS 1
 #endif
 
+#if defined(USE_NEW_COPYWORDS) \
+    && (defined(__SSE2__) || defined(_M_X64) \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define HAVE_SSE2_COPYWORDS
+#  include <emmintrin.h>
+#endif
+
 
 CPL_CVSID("$Id: rasterio.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -297,6 +304,21 @@ CPLErr GDALRasterBand::IRasterIO( GDALRWFlag eRWFlag,
         return CE_None;
     }
 
+/* ==================================================================== */
+/*      If a resampling other than nearest neighbour was requested      */
+/*      with GDAL_RASTERIO_RESAMPLING, compute the read buffer from     */
+/*      full resolution data.                                           */
+/* ==================================================================== */
+    if( eRWFlag == GF_Read && !GDALDataTypeIsComplex( eDataType ) )
+    {
+        GDALRIOResampleAlg eResampleAlg = GDALGetRasterIOResampling();
+
+        if( eResampleAlg != GRIORA_NearestNeighbour )
+            return ResampledRasterIO( nXOff, nYOff, nXSize, nYSize,
+                                      pData, nBufXSize, nBufYSize, eBufType,
+                                      nPixelSpace, nLineSpace, eResampleAlg );
+    }
+
 /* ==================================================================== */
 /*      Loop reading required source blocks to satisfy output           */
 /*      request.  This is the most general implementation.              */
@@ -827,6 +849,380 @@ static void GDALCopyWordsT(const Tin* const pSrcData, int nSrcPixelOffset,
     }
 }
 
+/************************************************************************/
+/*                        GDALCopyWordsUseSIMD()                        */
+/************************************************************************/
+/**
+ * Returns whether the vectorized GDALCopyWordsT() overloads below may be
+ * used.  They can be disabled with GDAL_USE_SIMD=NO (read once), which
+ * is mostly useful to compare against the generic code.
+ */
+
+inline int GDALCopyWordsUseSIMD()
+{
+    static int bUseSIMD = -1;
+
+    if( bUseSIMD < 0 )
+        bUseSIMD = CSLTestBoolean( CPLGetConfigOption( "GDAL_USE_SIMD", 
+                                                       "YES" ) );
+    return bUseSIMD;
+}
+
+#ifdef HAVE_SSE2_COPYWORDS
+
+/************************************************************************/
+/*                    GDALCopyWordsT() SSE2 overloads                   */
+/************************************************************************/
+/*
+ * Non-template overloads of GDALCopyWordsT() for the most common
+ * conversions.  When both buffers are packed they convert 16 (or 8) 
+ * words at a time with SSE2 instructions, applying the same rounding and
+ * clamping rules as CopyWord(), and hand the remaining words (or strided
+ * buffers) to the generic template.
+ */
+
+inline void GDALCopyWordsT(const GByte* const pSrcData, int nSrcPixelOffset,
+                           float* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 1 && nDstPixelOffset == 4 
+        && GDALCopyWordsUseSIMD() )
+    {
+        const __m128i xmmZero = _mm_setzero_si128();
+
+        for( ; n + 16 <= nWordCount; n += 16 )
+        {
+            __m128i xmm = 
+                _mm_loadu_si128( (const __m128i *) (pSrcData + n) );
+            __m128i xmmLo = _mm_unpacklo_epi8( xmm, xmmZero );
+            __m128i xmmHi = _mm_unpackhi_epi8( xmm, xmmZero );
+
+            _mm_storeu_ps( pDstData + n, 
+                _mm_cvtepi32_ps( _mm_unpacklo_epi16( xmmLo, xmmZero ) ) );
+            _mm_storeu_ps( pDstData + n + 4, 
+                _mm_cvtepi32_ps( _mm_unpackhi_epi16( xmmLo, xmmZero ) ) );
+            _mm_storeu_ps( pDstData + n + 8, 
+                _mm_cvtepi32_ps( _mm_unpacklo_epi16( xmmHi, xmmZero ) ) );
+            _mm_storeu_ps( pDstData + n + 12, 
+                _mm_cvtepi32_ps( _mm_unpackhi_epi16( xmmHi, xmmZero ) ) );
+        }
+    }
+
+    GDALCopyWordsT<GByte, float>( pSrcData + n, nSrcPixelOffset,
+                                  pDstData + n, nDstPixelOffset,
+                                  nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const GUInt16* const pSrcData, int nSrcPixelOffset,
+                           float* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 2 && nDstPixelOffset == 4 
+        && GDALCopyWordsUseSIMD() )
+    {
+        const __m128i xmmZero = _mm_setzero_si128();
+
+        for( ; n + 8 <= nWordCount; n += 8 )
+        {
+            __m128i xmm = 
+                _mm_loadu_si128( (const __m128i *) (pSrcData + n) );
+
+            _mm_storeu_ps( pDstData + n, 
+                _mm_cvtepi32_ps( _mm_unpacklo_epi16( xmm, xmmZero ) ) );
+            _mm_storeu_ps( pDstData + n + 4, 
+                _mm_cvtepi32_ps( _mm_unpackhi_epi16( xmm, xmmZero ) ) );
+        }
+    }
+
+    GDALCopyWordsT<GUInt16, float>( pSrcData + n, nSrcPixelOffset,
+                                    pDstData + n, nDstPixelOffset,
+                                    nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const GInt16* const pSrcData, int nSrcPixelOffset,
+                           float* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 2 && nDstPixelOffset == 4 
+        && GDALCopyWordsUseSIMD() )
+    {
+        for( ; n + 8 <= nWordCount; n += 8 )
+        {
+            __m128i xmm = 
+                _mm_loadu_si128( (const __m128i *) (pSrcData + n) );
+
+            // Sign extend by placing each word in the high half of a
+            // dword and shifting it back arithmetically.
+            _mm_storeu_ps( pDstData + n, _mm_cvtepi32_ps( 
+                _mm_srai_epi32( _mm_unpacklo_epi16( xmm, xmm ), 16 ) ) );
+            _mm_storeu_ps( pDstData + n + 4, _mm_cvtepi32_ps( 
+                _mm_srai_epi32( _mm_unpackhi_epi16( xmm, xmm ), 16 ) ) );
+        }
+    }
+
+    GDALCopyWordsT<GInt16, float>( pSrcData + n, nSrcPixelOffset,
+                                   pDstData + n, nDstPixelOffset,
+                                   nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const float* const pSrcData, int nSrcPixelOffset,
+                           GByte* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 4 && nDstPixelOffset == 1 
+        && GDALCopyWordsUseSIMD() )
+    {
+        const __m128 xmmHalf = _mm_set1_ps( 0.5f );
+        const __m128 xmmMin = _mm_setzero_ps();
+        const __m128 xmmMax = _mm_set1_ps( 255.0f );
+
+        for( ; n + 16 <= nWordCount; n += 16 )
+        {
+            __m128i axmm[4];
+
+            for( int i = 0; i < 4; i++ )
+            {
+                __m128 xmm = _mm_add_ps( _mm_loadu_ps( pSrcData + n + 4*i ),
+                                         xmmHalf );
+                xmm = _mm_min_ps( _mm_max_ps( xmm, xmmMin ), xmmMax );
+                axmm[i] = _mm_cvttps_epi32( xmm );
+            }
+
+            __m128i xmmLo = _mm_packs_epi32( axmm[0], axmm[1] );
+            __m128i xmmHi = _mm_packs_epi32( axmm[2], axmm[3] );
+
+            _mm_storeu_si128( (__m128i *) (pDstData + n), 
+                              _mm_packus_epi16( xmmLo, xmmHi ) );
+        }
+    }
+
+    GDALCopyWordsT<float, GByte>( pSrcData + n, nSrcPixelOffset,
+                                  pDstData + n, nDstPixelOffset,
+                                  nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const float* const pSrcData, int nSrcPixelOffset,
+                           GUInt16* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 4 && nDstPixelOffset == 2 
+        && GDALCopyWordsUseSIMD() )
+    {
+        const __m128 xmmHalf = _mm_set1_ps( 0.5f );
+        const __m128 xmmMin = _mm_setzero_ps();
+        const __m128 xmmMax = _mm_set1_ps( 65535.0f );
+        const __m128i xmmBias = _mm_set1_epi32( 32768 );
+        const __m128i xmmSignBit = _mm_set1_epi16( (short) 0x8000 );
+
+        for( ; n + 8 <= nWordCount; n += 8 )
+        {
+            __m128i axmm[2];
+
+            for( int i = 0; i < 2; i++ )
+            {
+                __m128 xmm = _mm_add_ps( _mm_loadu_ps( pSrcData + n + 4*i ),
+                                         xmmHalf );
+                xmm = _mm_min_ps( _mm_max_ps( xmm, xmmMin ), xmmMax );
+                // No unsigned saturating pack in SSE2: bias to the signed
+                // range, pack, and flip the sign bit back.
+                axmm[i] = _mm_sub_epi32( _mm_cvttps_epi32( xmm ), xmmBias );
+            }
+
+            _mm_storeu_si128( (__m128i *) (pDstData + n), 
+                              _mm_xor_si128( _mm_packs_epi32( axmm[0], 
+                                                              axmm[1] ),
+                                             xmmSignBit ) );
+        }
+    }
+
+    GDALCopyWordsT<float, GUInt16>( pSrcData + n, nSrcPixelOffset,
+                                    pDstData + n, nDstPixelOffset,
+                                    nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const float* const pSrcData, int nSrcPixelOffset,
+                           GInt16* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 4 && nDstPixelOffset == 2 
+        && GDALCopyWordsUseSIMD() )
+    {
+        const __m128 xmmHalf = _mm_set1_ps( 0.5f );
+        const __m128 xmmSignMask = _mm_set1_ps( -0.0f );
+        const __m128 xmmMin = _mm_set1_ps( -32768.0f );
+        const __m128 xmmMax = _mm_set1_ps( 32767.0f );
+
+        for( ; n + 8 <= nWordCount; n += 8 )
+        {
+            __m128i axmm[2];
+
+            for( int i = 0; i < 2; i++ )
+            {
+                __m128 xmm = _mm_loadu_ps( pSrcData + n + 4*i );
+                // Round half away from zero, as CopyWord() does.
+                xmm = _mm_add_ps( xmm, 
+                    _mm_or_ps( _mm_and_ps( xmm, xmmSignMask ), xmmHalf ) );
+                xmm = _mm_min_ps( _mm_max_ps( xmm, xmmMin ), xmmMax );
+                axmm[i] = _mm_cvttps_epi32( xmm );
+            }
+
+            _mm_storeu_si128( (__m128i *) (pDstData + n), 
+                              _mm_packs_epi32( axmm[0], axmm[1] ) );
+        }
+    }
+
+    GDALCopyWordsT<float, GInt16>( pSrcData + n, nSrcPixelOffset,
+                                   pDstData + n, nDstPixelOffset,
+                                   nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const float* const pSrcData, int nSrcPixelOffset,
+                           double* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 4 && nDstPixelOffset == 8 
+        && GDALCopyWordsUseSIMD() )
+    {
+        for( ; n + 4 <= nWordCount; n += 4 )
+        {
+            __m128 xmm = _mm_loadu_ps( pSrcData + n );
+
+            _mm_storeu_pd( pDstData + n, _mm_cvtps_pd( xmm ) );
+            _mm_storeu_pd( pDstData + n + 2, 
+                           _mm_cvtps_pd( _mm_movehl_ps( xmm, xmm ) ) );
+        }
+    }
+
+    GDALCopyWordsT<float, double>( pSrcData + n, nSrcPixelOffset,
+                                   pDstData + n, nDstPixelOffset,
+                                   nWordCount - n );
+}
+
+inline void GDALCopyWordsT(const double* const pSrcData, int nSrcPixelOffset,
+                           float* const pDstData, int nDstPixelOffset,
+                           int nWordCount)
+{
+    int n = 0;
+
+    if( nSrcPixelOffset == 8 && nDstPixelOffset == 4 
+        && GDALCopyWordsUseSIMD() )
+    {
+        for( ; n + 4 <= nWordCount; n += 4 )
+        {
+            __m128 xmmLo = _mm_cvtpd_ps( _mm_loadu_pd( pSrcData + n ) );
+            __m128 xmmHi = _mm_cvtpd_ps( _mm_loadu_pd( pSrcData + n + 2 ) );
+
+            _mm_storeu_ps( pDstData + n, _mm_movelh_ps( xmmLo, xmmHi ) );
+        }
+    }
+
+    GDALCopyWordsT<double, float>( pSrcData + n, nSrcPixelOffset,
+                                   pDstData + n, nDstPixelOffset,
+                                   nWordCount - n );
+}
+
+#endif /* def HAVE_SSE2_COPYWORDS */
+
+/************************************************************************/
+/*                        GDALInterleaveWordsT()                        */
+/************************************************************************/
+/**
+ * Copy words of the same type between a packed buffer and a buffer with
+ * a stride of a fixed number of words, such as one band of a pixel
+ * interleaved buffer.  The constant stride lets the compiler unroll and
+ * schedule the loop, which the generic GDALCopyWordsT() cannot do.
+ *
+ * @param pSrcData the source data buffer
+ * @param pDstData the destination data buffer
+ * @param nWordCount the total number of pixel words to copy
+ */
+
+template <class T, int nSrcStep, int nDstStep>
+inline void GDALInterleaveWordsT(const T* pSrcData, T* pDstData,
+                                 int nWordCount)
+{
+    int n = 0;
+
+    for( ; n + 4 <= nWordCount; n += 4 )
+    {
+        pDstData[0]            = pSrcData[0];
+        pDstData[nDstStep]     = pSrcData[nSrcStep];
+        pDstData[2 * nDstStep] = pSrcData[2 * nSrcStep];
+        pDstData[3 * nDstStep] = pSrcData[3 * nSrcStep];
+        pSrcData += 4 * nSrcStep;
+        pDstData += 4 * nDstStep;
+    }
+
+    for( ; n < nWordCount; n++ )
+    {
+        *pDstData = *pSrcData;
+        pSrcData += nSrcStep;
+        pDstData += nDstStep;
+    }
+}
+
+/************************************************************************/
+/*                         GDALInterleaveWords()                        */
+/************************************************************************/
+/**
+ * Dispatch same type copies between packed buffers and buffers with a 
+ * stride of 2, 3 or 4 words to GDALInterleaveWordsT().
+ *
+ * @return true if the copy was done, false if the caller should fall back
+ * to the generic implementation.
+ */
+
+template <class T>
+inline bool GDALInterleaveWords(const void* pSrcData, int nSrcPixelOffset,
+                                void* pDstData, int nDstPixelOffset,
+                                int nWordCount)
+{
+    const T* pSrc = static_cast<const T*>(pSrcData);
+    T* pDst = static_cast<T*>(pDstData);
+    const int nSize = static_cast<int>(sizeof(T));
+
+    if( nSrcPixelOffset == nSize )
+    {
+        if( nDstPixelOffset == 2 * nSize )
+            GDALInterleaveWordsT<T, 1, 2>( pSrc, pDst, nWordCount );
+        else if( nDstPixelOffset == 3 * nSize )
+            GDALInterleaveWordsT<T, 1, 3>( pSrc, pDst, nWordCount );
+        else if( nDstPixelOffset == 4 * nSize )
+            GDALInterleaveWordsT<T, 1, 4>( pSrc, pDst, nWordCount );
+        else
+            return false;
+    }
+    else if( nDstPixelOffset == nSize )
+    {
+        if( nSrcPixelOffset == 2 * nSize )
+            GDALInterleaveWordsT<T, 2, 1>( pSrc, pDst, nWordCount );
+        else if( nSrcPixelOffset == 3 * nSize )
+            GDALInterleaveWordsT<T, 3, 1>( pSrc, pDst, nWordCount );
+        else if( nSrcPixelOffset == 4 * nSize )
+            GDALInterleaveWordsT<T, 4, 1>( pSrc, pDst, nWordCount );
+        else
+            return false;
+    }
+    else
+        return false;
+
+    return true;
+}
+
 /************************************************************************/
 /*                   GDALCopyWordsComplexT()                            */
 /************************************************************************/
@@ -1194,6 +1590,46 @@ GDALCopyWords( void * pSrcData, GDALDataType eSrcType, int nSrcPixelOffset,
         return;
     }
 
+    // Same type copies to or from a pixel interleaved buffer of 2 to 4
+    // bands get their own unrolled loops.
+    if (eSrcType == eDstType && nSrcDataTypeSize > 0 
+        && (nSrcPixelOffset == nSrcDataTypeSize 
+            || nDstPixelOffset == nSrcDataTypeSize)
+        && (nSrcPixelOffset % nSrcDataTypeSize) == 0
+        && (nDstPixelOffset % nSrcDataTypeSize) == 0)
+    {
+        bool bDone = false;
+
+        switch (nSrcDataTypeSize)
+        {
+        case 1:
+            bDone = GDALInterleaveWords<GByte>(pSrcData, nSrcPixelOffset,
+                                               pDstData, nDstPixelOffset,
+                                               nWordCount);
+            break;
+        case 2:
+            bDone = GDALInterleaveWords<GUInt16>(pSrcData, nSrcPixelOffset,
+                                                 pDstData, nDstPixelOffset,
+                                                 nWordCount);
+            break;
+        case 4:
+            bDone = GDALInterleaveWords<GUInt32>(pSrcData, nSrcPixelOffset,
+                                                 pDstData, nDstPixelOffset,
+                                                 nWordCount);
+            break;
+        case 8:
+            bDone = GDALInterleaveWords<GUIntBig>(pSrcData, nSrcPixelOffset,
+                                                  pDstData, nDstPixelOffset,
+                                                  nWordCount);
+            break;
+        default:
+            break;
+        }
+
+        if (bDone)
+            return;
+    }
+
     // Handle the more general case -- deals with conversion of data types
     // directly.
     switch (eSrcType)
@@ -2080,6 +2516,16 @@ int GDALBandGetBestOverviewLevel(GDALRasterBand* poBand,
 /*      downsampled) that is still less than (or only a little more)    */
 /*      downsampled than the request.                                   */
 /* -------------------------------------------------------------------- */
+/* -------------------------------------------------------------------- */
+/*      When resampling, an overview coarser than the request would     */
+/*      have to be upsampled again, so only accept those that are at    */
+/*      least as detailed as the request.                               */
+/* -------------------------------------------------------------------- */
+    double dfMaxResolutionFactor = 1.2;
+
+    if( GDALGetRasterIOResampling() != GRIORA_NearestNeighbour )
+        dfMaxResolutionFactor = 1.0 + 1e-6;
+
     int nOverviewCount = poBand->GetOverviewCount();
     GDALRasterBand* poBestOverview = NULL;
     double dfBestResolution = 0;
@@ -2101,7 +2547,7 @@ int GDALBandGetBestOverviewLevel(GDALRasterBand* poBand,
 
         // Is it nearly the requested resolution and better (lower) than
         // the current best resolution?
-        if( dfResolution >= dfDesiredResolution * 1.2 
+        if( dfResolution >= dfDesiredResolution * dfMaxResolutionFactor
             || dfResolution <= dfBestResolution )
             continue;
 
@@ -2187,6 +2633,443 @@ CPLErr GDALRasterBand::OverviewRasterIO( GDALRWFlag eRWFlag,
                                      nPixelSpace, nLineSpace );
 }
 
+/************************************************************************/
+/*                     GDALGetRasterIOResampling()                      */
+/*                                                                      */
+/*      Returns the resampling method to be used by the default         */
+/*      RasterIO() implementation for non 1:1 reads, as selected        */
+/*      with the GDAL_RASTERIO_RESAMPLING configuration option.         */
+/************************************************************************/
+
+GDALRIOResampleAlg GDALGetRasterIOResampling()
+
+{
+    const char *pszResampling = 
+        CPLGetConfigOption( "GDAL_RASTERIO_RESAMPLING", NULL );
+
+    if( pszResampling == NULL || EQUALN(pszResampling,"NEAR",4) )
+        return GRIORA_NearestNeighbour;
+    else if( EQUAL(pszResampling,"BILINEAR") )
+        return GRIORA_Bilinear;
+    else if( EQUAL(pszResampling,"CUBIC") )
+        return GRIORA_Cubic;
+    else if( EQUALN(pszResampling,"AVER",4) )
+        return GRIORA_Average;
+    else if( EQUAL(pszResampling,"MODE") )
+        return GRIORA_Mode;
+
+    CPLDebug( "GDAL", 
+              "Unsupported GDAL_RASTERIO_RESAMPLING=%s, using NEAREST.",
+              pszResampling );
+    return GRIORA_NearestNeighbour;
+}
+
+/************************************************************************/
+/*                      GDALComputeResampleTaps()                       */
+/*                                                                      */
+/*      Compute, for each buffer pixel along one axis, the first        */
+/*      contributing source pixel, the number of contributing           */
+/*      pixels and their weights (nMaxTaps weights per buffer pixel).   */
+/************************************************************************/
+
+static double GDALCubicKernel( double dfX )
+
+{
+    dfX = fabs(dfX);
+    if( dfX < 1.0 )
+        return (1.5 * dfX - 2.5) * dfX * dfX + 1.0;
+    else if( dfX < 2.0 )
+        return ((-0.5 * dfX + 2.5) * dfX - 4.0) * dfX + 2.0;
+    return 0.0;
+}
+
+static int GDALComputeResampleTaps( GDALRIOResampleAlg eResampleAlg,
+                                    int nOff, int nSize, int nBufSize,
+                                    int nRasterSize,
+                                    int *panStart, int *panCount,
+                                    double **ppadfWeights )
+
+{
+    double dfRatio = nSize / (double) nBufSize;
+    double dfScale = MAX(1.0, dfRatio);
+    double dfRadius;
+    int    nMaxTaps;
+
+    if( eResampleAlg == GRIORA_Average || eResampleAlg == GRIORA_Mode )
+        dfRadius = dfRatio / 2;
+    else if( eResampleAlg == GRIORA_Cubic )
+        dfRadius = 2 * dfScale;
+    else
+        dfRadius = dfScale;
+
+    nMaxTaps = (int) ceil(2 * dfRadius) + 2;
+
+    double *padfWeights = (double *) 
+        VSIMalloc3( nBufSize, nMaxTaps, sizeof(double) );
+    if( padfWeights == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Out of memory allocating resampling weights." );
+        return 0;
+    }
+
+    for( int iBuf = 0; iBuf < nBufSize; iBuf++ )
+    {
+        double *padfTapWeights = padfWeights + (size_t) iBuf * nMaxTaps;
+        int     nStart, nEnd;
+
+        if( eResampleAlg == GRIORA_Average || eResampleAlg == GRIORA_Mode )
+        {
+/* -------------------------------------------------------------------- */
+/*      Box filter: each source pixel is weighted by the fraction of    */
+/*      it covered by the footprint of the buffer pixel.                */
+/* -------------------------------------------------------------------- */
+            double dfSrc0 = nOff + iBuf * dfRatio;
+            double dfSrc1 = nOff + (iBuf + 1) * dfRatio;
+
+            nStart = (int) floor(dfSrc0);
+            nEnd = (int) ceil(dfSrc1);
+            if( nEnd <= nStart )
+                nEnd = nStart + 1;
+            nStart = MAX(0, nStart);
+            nEnd = MIN(nRasterSize, MIN(nEnd, nStart + nMaxTaps));
+
+            for( int i = nStart; i < nEnd; i++ )
+                padfTapWeights[i - nStart] = 
+                    MIN(dfSrc1, i + 1.0) - MAX(dfSrc0, (double) i);
+        }
+        else
+        {
+/* -------------------------------------------------------------------- */
+/*      Triangle or cubic kernel centered on the buffer pixel,          */
+/*      stretched by the decimation factor when downsampling.           */
+/* -------------------------------------------------------------------- */
+            double dfCenter = nOff + (iBuf + 0.5) * dfRatio - 0.5;
+
+            nStart = (int) ceil(dfCenter - dfRadius);
+            nEnd = (int) floor(dfCenter + dfRadius) + 1;
+            nStart = MAX(0, nStart);
+            nEnd = MIN(nRasterSize, MIN(nEnd, nStart + nMaxTaps));
+
+            for( int i = nStart; i < nEnd; i++ )
+            {
+                double dfDist = (i - dfCenter) / dfScale;
+
+                if( eResampleAlg == GRIORA_Cubic )
+                    padfTapWeights[i - nStart] = GDALCubicKernel( dfDist );
+                else
+                    padfTapWeights[i - nStart] = MAX(0.0, 1.0 - fabs(dfDist));
+            }
+
+            // Degenerate case at the raster edge: use nearest pixel.
+            if( nEnd <= nStart )
+            {
+                nStart = MAX(0, MIN(nRasterSize - 1, (int) floor(dfCenter + 0.5)));
+                nEnd = nStart + 1;
+                padfTapWeights[0] = 1.0;
+            }
+        }
+
+        panStart[iBuf] = nStart;
+        panCount[iBuf] = nEnd - nStart;
+    }
+
+    *ppadfWeights = padfWeights;
+    return nMaxTaps;
+}
+
+/************************************************************************/
+/*                         ResampledRasterIO()                          */
+/*                                                                      */
+/*      Read a window into a buffer of a different size applying a      */
+/*      bilinear, cubic, average or mode resampling kernel instead of   */
+/*      nearest neighbour decimation.  Source data is fetched at full   */
+/*      resolution in strips of lines, and pixels matching the nodata   */
+/*      value are excluded from the computation.                        */
+/************************************************************************/
+
+CPLErr GDALRasterBand::ResampledRasterIO( int nXOff, int nYOff,
+                                          int nXSize, int nYSize,
+                                          void * pData,
+                                          int nBufXSize, int nBufYSize,
+                                          GDALDataType eBufType,
+                                          int nPixelSpace, int nLineSpace,
+                                          GDALRIOResampleAlg eResampleAlg )
+
+{
+    int    *panXStart, *panXCount, *panYStart, *panYCount;
+    double *padfXWeights = NULL, *padfYWeights = NULL;
+    int     nXMaxTaps, nYMaxTaps;
+    CPLErr  eErr = CE_None;
+
+    panXStart = (int *) VSIMalloc2( nBufXSize, sizeof(int) );
+    panXCount = (int *) VSIMalloc2( nBufXSize, sizeof(int) );
+    panYStart = (int *) VSIMalloc2( nBufYSize, sizeof(int) );
+    panYCount = (int *) VSIMalloc2( nBufYSize, sizeof(int) );
+    if( panXStart == NULL || panXCount == NULL 
+        || panYStart == NULL || panYCount == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Out of memory in ResampledRasterIO()." );
+        CPLFree( panXStart );
+        CPLFree( panXCount );
+        CPLFree( panYStart );
+        CPLFree( panYCount );
+        return CE_Failure;
+    }
+
+    nXMaxTaps = GDALComputeResampleTaps( eResampleAlg, nXOff, nXSize, 
+                                         nBufXSize, nRasterXSize,
+                                         panXStart, panXCount, 
+                                         &padfXWeights );
+    nYMaxTaps = GDALComputeResampleTaps( eResampleAlg, nYOff, nYSize, 
+                                         nBufYSize, nRasterYSize,
+                                         panYStart, panYCount, 
+                                         &padfYWeights );
+    if( nXMaxTaps == 0 || nYMaxTaps == 0 )
+        eErr = CE_Failure;
+
+    int    bHasNoData = FALSE;
+    double dfNoDataValue = GetNoDataValue( &bHasNoData );
+
+    if( !bHasNoData )
+        dfNoDataValue = 0.0;
+
+/* -------------------------------------------------------------------- */
+/*      Without nodata, the bilinear, cubic and average kernels are     */
+/*      applied as a horizontal pass over each source line followed     */
+/*      by a vertical pass.                                             */
+/* -------------------------------------------------------------------- */
+    int     bSeparable = !bHasNoData && eResampleAlg != GRIORA_Mode;
+
+/* -------------------------------------------------------------------- */
+/*      Establish the source columns and lines needed, and the number   */
+/*      of source lines we process at once: as many as fit in 16MB      */
+/*      of strip, and of horizontally filtered lines if separable,      */
+/*      but no more than the window spans.                              */
+/* -------------------------------------------------------------------- */
+    int nSrcXOff = 0, nSrcXSize = 0, nSrcYEnd = 0, nStripMaxLines = 0;
+
+    if( eErr == CE_None )
+    {
+        int nSrcXEnd = 0, nSrcYOff = nRasterYSize;
+        int iBuf;
+
+        nSrcXOff = nRasterXSize;
+        for( iBuf = 0; iBuf < nBufXSize; iBuf++ )
+        {
+            nSrcXOff = MIN(nSrcXOff, panXStart[iBuf]);
+            nSrcXEnd = MAX(nSrcXEnd, panXStart[iBuf] + panXCount[iBuf]);
+        }
+        nSrcXSize = nSrcXEnd - nSrcXOff;
+
+        for( iBuf = 0; iBuf < nBufYSize; iBuf++ )
+        {
+            nSrcYOff = MIN(nSrcYOff, panYStart[iBuf]);
+            nSrcYEnd = MAX(nSrcYEnd, panYStart[iBuf] + panYCount[iBuf]);
+        }
+
+        double dfLineBytes = 
+            (nSrcXSize + (bSeparable ? nBufXSize : 0)) * (double) sizeof(double);
+
+        nStripMaxLines = MAX(nYMaxTaps, 
+                             (int) ((16 * 1024 * 1024) / dfLineBytes));
+        nStripMaxLines = MIN(nStripMaxLines, nSrcYEnd - nSrcYOff);
+    }
+    double *padfStrip = NULL, *padfLine = NULL, *padfHorz = NULL;
+    GByte  *pabyLine = NULL;
+    int     nBandDataSize = GDALGetDataTypeSize( eDataType ) / 8;
+    double *padfModeValues = NULL, *padfModeWeights = NULL;
+
+    if( eErr == CE_None )
+    {
+        padfStrip = (double *) 
+            VSIMalloc3( nSrcXSize, nStripMaxLines, sizeof(double) );
+        padfLine = (double *) VSIMalloc2( nBufXSize, sizeof(double) );
+        pabyLine = (GByte *) VSIMalloc2( nBufXSize, nBandDataSize );
+        if( bSeparable )
+            padfHorz = (double *) 
+                VSIMalloc3( nBufXSize, nStripMaxLines, sizeof(double) );
+        if( eResampleAlg == GRIORA_Mode )
+        {
+            padfModeValues = (double *) 
+                VSIMalloc3( nXMaxTaps, nYMaxTaps, sizeof(double) );
+            padfModeWeights = (double *) 
+                VSIMalloc3( nXMaxTaps, nYMaxTaps, sizeof(double) );
+        }
+        if( padfStrip == NULL || padfLine == NULL || pabyLine == NULL
+            || (bSeparable && padfHorz == NULL)
+            || (eResampleAlg == GRIORA_Mode 
+                && (padfModeValues == NULL || padfModeWeights == NULL)) )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Out of memory in ResampledRasterIO()." );
+            eErr = CE_Failure;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Loop over buffer lines, loading a new strip of source lines     */
+/*      whenever the current one does not hold the needed lines.        */
+/* -------------------------------------------------------------------- */
+    int nStripYOff = 0, nStripYSize = 0;
+
+    for( int iBufY = 0; iBufY < nBufYSize && eErr == CE_None; iBufY++ )
+    {
+        int nYStart = panYStart[iBufY];
+        int nYCount = panYCount[iBufY];
+
+        if( nStripYSize == 0 || nYStart < nStripYOff 
+            || nYStart + nYCount > nStripYOff + nStripYSize )
+        {
+            nStripYOff = nYStart;
+            nStripYSize = MIN(nStripMaxLines, nSrcYEnd - nStripYOff);
+
+            eErr = IRasterIO( GF_Read, nSrcXOff, nStripYOff, 
+                              nSrcXSize, nStripYSize,
+                              padfStrip, nSrcXSize, nStripYSize, GDT_Float64,
+                              sizeof(double), sizeof(double) * nSrcXSize );
+            if( eErr != CE_None )
+                break;
+
+            for( int iLine = 0; bSeparable && iLine < nStripYSize; iLine++ )
+            {
+                const double *padfSrc = padfStrip + (size_t) iLine * nSrcXSize;
+                double *padfDst = padfHorz + (size_t) iLine * nBufXSize;
+
+                for( int iBufX = 0; iBufX < nBufXSize; iBufX++ )
+                {
+                    const double *padfXTapWeights = 
+                        padfXWeights + (size_t) iBufX * nXMaxTaps;
+                    const double *padfSrcTaps = 
+                        padfSrc + panXStart[iBufX] - nSrcXOff;
+                    double dfSum = 0.0, dfWeightSum = 0.0;
+
+                    for( int iX = 0; iX < panXCount[iBufX]; iX++ )
+                    {
+                        dfSum += padfSrcTaps[iX] * padfXTapWeights[iX];
+                        dfWeightSum += padfXTapWeights[iX];
+                    }
+                    padfDst[iBufX] = 
+                        fabs(dfWeightSum) > 1e-10 ? dfSum / dfWeightSum : 0.0;
+                }
+            }
+        }
+
+        const double *padfYTapWeights = 
+            padfYWeights + (size_t) iBufY * nYMaxTaps;
+
+        if( bSeparable )
+        {
+            double dfWeightSum = 0.0;
+
+            memset( padfLine, 0, sizeof(double) * nBufXSize );
+            for( int iY = 0; iY < nYCount; iY++ )
+            {
+                const double *padfSrc = padfHorz 
+                    + (size_t)(nYStart + iY - nStripYOff) * nBufXSize;
+                double dfYWeight = padfYTapWeights[iY];
+
+                for( int iBufX = 0; iBufX < nBufXSize; iBufX++ )
+                    padfLine[iBufX] += padfSrc[iBufX] * dfYWeight;
+                dfWeightSum += dfYWeight;
+            }
+            for( int iBufX = 0; iBufX < nBufXSize; iBufX++ )
+                padfLine[iBufX] = 
+                    fabs(dfWeightSum) > 1e-10 ? padfLine[iBufX] / dfWeightSum
+                                              : 0.0;
+        }
+
+        for( int iBufX = 0; !bSeparable && iBufX < nBufXSize; iBufX++ )
+        {
+            const double *padfXTapWeights = 
+                padfXWeights + (size_t) iBufX * nXMaxTaps;
+            int nXStart = panXStart[iBufX] - nSrcXOff;
+            int nXCount = panXCount[iBufX];
+            double dfSum = 0.0, dfWeightSum = 0.0;
+            int nModeValues = 0;
+
+            for( int iY = 0; iY < nYCount; iY++ )
+            {
+                const double *padfSrc = padfStrip 
+                    + (size_t)(nYStart + iY - nStripYOff) * nSrcXSize
+                    + nXStart;
+                double dfYWeight = padfYTapWeights[iY];
+
+                for( int iX = 0; iX < nXCount; iX++ )
+                {
+                    double dfValue = padfSrc[iX];
+                    double dfWeight = dfYWeight * padfXTapWeights[iX];
+
+                    if( (bHasNoData && dfValue == dfNoDataValue)
+                        || dfWeight == 0.0 )
+                        continue;
+
+                    if( eResampleAlg == GRIORA_Mode )
+                    {
+                        int iMode;
+
+                        for( iMode = 0; iMode < nModeValues; iMode++ )
+                        {
+                            if( padfModeValues[iMode] == dfValue )
+                                break;
+                        }
+                        if( iMode == nModeValues )
+                        {
+                            padfModeValues[nModeValues] = dfValue;
+                            padfModeWeights[nModeValues++] = 0.0;
+                        }
+                        padfModeWeights[iMode] += dfWeight;
+                    }
+                    else
+                        dfSum += dfValue * dfWeight;
+
+                    dfWeightSum += dfWeight;
+                }
+            }
+
+            if( eResampleAlg == GRIORA_Mode && nModeValues > 0 )
+            {
+                int iBest = 0;
+
+                for( int iMode = 1; iMode < nModeValues; iMode++ )
+                {
+                    if( padfModeWeights[iMode] > padfModeWeights[iBest] )
+                        iBest = iMode;
+                }
+                padfLine[iBufX] = padfModeValues[iBest];
+            }
+            else if( fabs(dfWeightSum) > 1e-10 )
+                padfLine[iBufX] = dfSum / dfWeightSum;
+            else
+                padfLine[iBufX] = dfNoDataValue;
+        }
+
+        // Go through the band data type so that values are rounded and
+        // clamped as they would be for a nearest neighbour read.
+        GDALCopyWords( padfLine, GDT_Float64, sizeof(double),
+                       pabyLine, eDataType, nBandDataSize, nBufXSize );
+        GDALCopyWords( pabyLine, eDataType, nBandDataSize,
+                       ((GByte *) pData) + (size_t) iBufY * nLineSpace,
+                       eBufType, nPixelSpace, nBufXSize );
+    }
+
+    CPLFree( panXStart );
+    CPLFree( panXCount );
+    CPLFree( panYStart );
+    CPLFree( panYCount );
+    CPLFree( padfXWeights );
+    CPLFree( padfYWeights );
+    CPLFree( padfStrip );
+    CPLFree( padfLine );
+    CPLFree( padfHorz );
+    CPLFree( pabyLine );
+    CPLFree( padfModeValues );
+    CPLFree( padfModeWeights );
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                        GetBestOverviewLevel()                        */
 /*                                                                      */
@@ -2360,6 +3243,25 @@ GDALDataset::BlockBasedRasterIO( GDALRWFlag eRWFlag,
         }
     }
 
+/* -------------------------------------------------------------------- */
+/*      Resampled reads are handled band per band.                      */
+/* -------------------------------------------------------------------- */
+    if( eRWFlag == GF_Read
+        && (nXSize != nBufXSize || nYSize != nBufYSize)
+        && GDALGetRasterIOResampling() != GRIORA_NearestNeighbour )
+    {
+        CPLDebug( "GDAL", 
+                  "GDALDataset::BlockBasedRasterIO() ... "
+                  "resampled request, use std method." );
+        return GDALDataset::IRasterIO( eRWFlag, 
+                                       nXOff, nYOff, nXSize, nYSize, 
+                                       pData, nBufXSize, nBufYSize, 
+                                       eBufType, 
+                                       nBandCount, panBandMap,
+                                       nPixelSpace, nLineSpace, 
+                                       nBandSpace );
+    }
+
 /* ==================================================================== */
 /*      In this special case at full resolution we step through in      */
 /*      blocks, turning the request over to the per-band                */
@@ -2587,6 +3489,82 @@ GDALDataset::BlockBasedRasterIO( GDALRWFlag eRWFlag,
     return( CE_None );
 }
 
+/************************************************************************/
+/*                          GDALCopySwathInfo                           */
+/*                                                                      */
+/*      Layout of the swaths of GDALDatasetCopyWholeRaster().           */
+/************************************************************************/
+
+typedef struct
+{
+    GDALDataset  *poSrcDS;
+    GDALDataset  *poDstDS;
+    GDALDataType  eDT;
+    int           bInterleave;
+    int           nBandCount;
+    int           nXSize;
+    int           nYSize;
+    int           nSwathCols;
+    int           nSwathLines;
+    int           nXSwaths;
+    int           nYSwaths;
+    int           nSwaths;
+} GDALCopySwathInfo;
+
+/************************************************************************/
+/*                          GDALCopySwathIO()                           */
+/*                                                                      */
+/*      Read or write swath iSwath from / to pSwathBuf.  Swaths are     */
+/*      ordered by band (unless interleaved), then line, then column.   */
+/************************************************************************/
+
+static CPLErr GDALCopySwathIO( GDALCopySwathInfo *psInfo, GDALRWFlag eRWFlag,
+                               int iSwath, void *pSwathBuf )
+
+{
+    int nSwathsPerBand = psInfo->nXSwaths * psInfo->nYSwaths;
+    int iBand = iSwath / nSwathsPerBand;
+    int iY = ((iSwath % nSwathsPerBand) / psInfo->nXSwaths) 
+        * psInfo->nSwathLines;
+    int iX = (iSwath % psInfo->nXSwaths) * psInfo->nSwathCols;
+    int nThisLines = MIN(psInfo->nSwathLines, psInfo->nYSize - iY);
+    int nThisCols = MIN(psInfo->nSwathCols, psInfo->nXSize - iX);
+    int nBand = iBand + 1;
+    GDALDataset *poDS = 
+        (eRWFlag == GF_Read) ? psInfo->poSrcDS : psInfo->poDstDS;
+
+    if( psInfo->bInterleave )
+        return poDS->RasterIO( eRWFlag, iX, iY, nThisCols, nThisLines,
+                               pSwathBuf, nThisCols, nThisLines, 
+                               psInfo->eDT, psInfo->nBandCount, NULL, 
+                               0, 0, 0 );
+    else
+        return poDS->RasterIO( eRWFlag, iX, iY, nThisCols, nThisLines,
+                               pSwathBuf, nThisCols, nThisLines, 
+                               psInfo->eDT, 1, &nBand, 
+                               0, 0, 0 );
+}
+
+/************************************************************************/
+/*                      GDALCopySwathProgress()                         */
+/************************************************************************/
+
+static double GDALCopySwathProgress( GDALCopySwathInfo *psInfo, int iSwath )
+
+{
+    int nSwathsPerBand = psInfo->nXSwaths * psInfo->nYSwaths;
+    int iBand = iSwath / nSwathsPerBand;
+    int iY = ((iSwath % nSwathsPerBand) / psInfo->nXSwaths) 
+        * psInfo->nSwathLines;
+    int nThisLines = MIN(psInfo->nSwathLines, psInfo->nYSize - iY);
+
+    if( psInfo->bInterleave )
+        return (iY+nThisLines) / (float) psInfo->nYSize;
+    else
+        return iBand / (float)psInfo->nBandCount
+            + (iY+nThisLines) / (float) (psInfo->nYSize*psInfo->nBandCount);
+}
+
 /************************************************************************/
 /*                     GDALDatasetCopyWholeRaster()                     */
 /************************************************************************/
@@ -2720,8 +3698,6 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
                  "should be at least the size of the swath (%d)", GDALGetCacheMax(), nTargetSwathSize);
     }
 
-    void *pSwathBuf;
-
     int nPixelSize = (GDALGetDataTypeSize(eDT) / 8);
     if( bInterleave)
         nPixelSize *= nBandCount;
@@ -2781,7 +3757,35 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
         }
     }
 
-    pSwathBuf = VSIMalloc3(nSwathCols, nSwathLines, nPixelSize );
+/* -------------------------------------------------------------------- */
+/*      Describe the swaths.                                            */
+/* -------------------------------------------------------------------- */
+    GDALCopySwathInfo sInfo;
+
+    memset( &sInfo, 0, sizeof(sInfo) );
+    sInfo.poSrcDS = poSrcDS;
+    sInfo.poDstDS = poDstDS;
+    sInfo.eDT = eDT;
+    sInfo.bInterleave = bInterleave;
+    sInfo.nBandCount = nBandCount;
+    sInfo.nXSize = nXSize;
+    sInfo.nYSize = nYSize;
+    sInfo.nSwathCols = nSwathCols;
+    sInfo.nSwathLines = nSwathLines;
+    sInfo.nXSwaths = (nXSize + nSwathCols - 1) / nSwathCols;
+    sInfo.nYSwaths = (nYSize + nSwathLines - 1) / nSwathLines;
+    sInfo.nSwaths = sInfo.nXSwaths * sInfo.nYSwaths 
+        * (bInterleave ? 1 : nBandCount);
+
+/* -------------------------------------------------------------------- */
+/*      Allocate the swath buffer.                                      */
+/*                                                                      */
+/*      Reads and writes are not overlapped on separate threads:        */
+/*      both go through the block cache, which is not thread safe,      */
+/*      and reading the source could flush dirty destination blocks     */
+/*      while they are being written.                                   */
+/* -------------------------------------------------------------------- */
+    void *pSwathBuf = VSIMalloc3(nSwathCols, nSwathLines, nPixelSize );
     if( pSwathBuf == NULL )
     {
         CPLError( CE_Failure, CPLE_OutOfMemory,
@@ -2796,101 +3800,24 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
             nSwathCols, nSwathLines, bInterleave );
 
 /* ==================================================================== */
-/*      Band oriented (uninterleaved) case.                             */
+/*      Read then write each swath in turn.  Swaths go band by band,    */
+/*      unless pixel interleaved.                                       */
 /* ==================================================================== */
-    if( !bInterleave )
+    for( int iSwath = 0; iSwath < sInfo.nSwaths && eErr == CE_None; 
+         iSwath++ )
     {
-        int iBand, iX, iY;
-
-        for( iBand = 0; iBand < nBandCount && eErr == CE_None; iBand++ )
-        {
-            int nBand = iBand+1;
-
-            for( iY = 0; iY < nYSize && eErr == CE_None; iY += nSwathLines )
-            {
-                int nThisLines = nSwathLines;
-
-                if( iY + nThisLines > nYSize )
-                    nThisLines = nYSize - iY;
-
-                for( iX = 0; iX < nXSize && eErr == CE_None; iX += nSwathCols )
-                {
-                    int nThisCols = nSwathCols;
-
-                    if( iX + nThisCols > nXSize )
-                        nThisCols = nXSize - iX;
-
-                    eErr = poSrcDS->RasterIO( GF_Read, 
-                                            iX, iY, nThisCols, nThisLines,
-                                            pSwathBuf, nThisCols, nThisLines, 
-                                            eDT, 1, &nBand, 
-                                            0, 0, 0 );
-
-                    if( eErr == CE_None )
-                        eErr = poDstDS->RasterIO( GF_Write, 
-                                                iX, iY, nThisCols, nThisLines,
-                                                pSwathBuf, nThisCols, nThisLines, 
-                                                eDT, 1, &nBand,
-                                                0, 0, 0 );
-
-                    if( eErr == CE_None 
-                        && !pfnProgress( 
-                            iBand / (float)nBandCount
-                            + (iY+nThisLines) / (float) (nYSize*nBandCount),
-                            NULL, pProgressData ) )
-                    {
-                        eErr = CE_Failure;
-                        CPLError( CE_Failure, CPLE_UserInterrupt, 
-                                "User terminated CreateCopy()" );
-                    }
-                }
-            }
-        }
-    }
+        eErr = GDALCopySwathIO( &sInfo, GF_Read, iSwath, pSwathBuf );
 
-/* ==================================================================== */
-/*      Pixel interleaved case.                                         */
-/* ==================================================================== */
-    else /* if( bInterleave ) */
-    {
-        int iY, iX;
+        if( eErr == CE_None )
+            eErr = GDALCopySwathIO( &sInfo, GF_Write, iSwath, pSwathBuf );
 
-        for( iY = 0; iY < nYSize && eErr == CE_None; iY += nSwathLines )
+        if( eErr == CE_None 
+            && !pfnProgress( GDALCopySwathProgress( &sInfo, iSwath ),
+                             NULL, pProgressData ) )
         {
-            int nThisLines = nSwathLines;
-
-            if( iY + nThisLines > nYSize )
-                nThisLines = nYSize - iY;
-
-            for( iX = 0; iX < nXSize && eErr == CE_None; iX += nSwathCols )
-            {
-                int nThisCols = nSwathCols;
-
-                if( iX + nThisCols > nXSize )
-                    nThisCols = nXSize - iX;
-
-                eErr = poSrcDS->RasterIO( GF_Read, 
-                                        iX, iY, nThisCols, nThisLines,
-                                        pSwathBuf, nThisCols, nThisLines, 
-                                        eDT, nBandCount, NULL, 
-                                        0, 0, 0 );
-
-                if( eErr == CE_None )
-                    eErr = poDstDS->RasterIO( GF_Write, 
-                                            iX, iY, nThisCols, nThisLines,
-                                            pSwathBuf, nThisCols, nThisLines, 
-                                            eDT, nBandCount, NULL, 
-                                            0, 0, 0 );
-
-                if( eErr == CE_None 
-                    && !pfnProgress( (iY+nThisLines) / (float) nYSize,
-                                    NULL, pProgressData ) )
-                {
-                    eErr = CE_Failure;
-                    CPLError( CE_Failure, CPLE_UserInterrupt, 
-                            "User terminated CreateCopy()" );
-                }
-            }
+            eErr = CE_Failure;
+            CPLError( CE_Failure, CPLE_UserInterrupt, 
+                      "User terminated CreateCopy()" );
         }
     }
 
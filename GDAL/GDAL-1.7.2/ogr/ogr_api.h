@@ -193,11 +193,13 @@ typedef struct OGRFieldDefnHS   *OGRFieldDefnH;
 typedef struct OGRFeatureDefnHS *OGRFeatureDefnH;
 typedef struct OGRFeatureHS     *OGRFeatureH;
 typedef struct OGRStyleTableHS *OGRStyleTableH;
+typedef struct OGRFeatureBatchHS *OGRFeatureBatchH;
 #else
 typedef void *OGRFieldDefnH;
 typedef void *OGRFeatureDefnH;
 typedef void *OGRFeatureH;
 typedef void *OGRStyleTableH;
+typedef void *OGRFeatureBatchH;
 #endif
 
 /* OGRFieldDefn */
@@ -235,6 +237,7 @@ void   CPL_DLL OGR_FD_SetGeomType( OGRFeatureDefnH, OGRwkbGeometryType );
 int    CPL_DLL OGR_FD_Reference( OGRFeatureDefnH );
 int    CPL_DLL OGR_FD_Dereference( OGRFeatureDefnH );
 int    CPL_DLL OGR_FD_GetReferenceCount( OGRFeatureDefnH );
+void   CPL_DLL OGR_FD_SetFeaturePoolSize( OGRFeatureDefnH, int );
 
 /* OGRFeature */
 
@@ -290,6 +293,18 @@ OGRStyleTableH CPL_DLL OGR_F_GetStyleTable( OGRFeatureH );
 void   CPL_DLL OGR_F_SetStyleTableDirectly( OGRFeatureH, OGRStyleTableH );
 void   CPL_DLL OGR_F_SetStyleTable( OGRFeatureH, OGRStyleTableH );
 
+/* OGRFeatureBatch */
+
+OGRFeatureBatchH CPL_DLL OGR_FB_Create( void );
+void   CPL_DLL OGR_FB_Destroy( OGRFeatureBatchH );
+int    CPL_DLL OGR_FB_GetFeatureCount( OGRFeatureBatchH );
+long   CPL_DLL OGR_FB_GetFID( OGRFeatureBatchH, int );
+int    CPL_DLL OGR_FB_IsFieldSet( OGRFeatureBatchH, int, int );
+int    CPL_DLL OGR_FB_GetFieldAsInteger( OGRFeatureBatchH, int, int );
+double CPL_DLL OGR_FB_GetFieldAsDouble( OGRFeatureBatchH, int, int );
+const char CPL_DLL *OGR_FB_GetFieldAsString( OGRFeatureBatchH, int, int );
+const GByte CPL_DLL *OGR_FB_GetGeometryWKB( OGRFeatureBatchH, int, int * );
+
 /* -------------------------------------------------------------------- */
 /*      ogrsf_frmts.h                                                   */
 /* -------------------------------------------------------------------- */
@@ -313,6 +328,7 @@ void   CPL_DLL OGR_L_SetSpatialFilterRect( OGRLayerH,
 OGRErr CPL_DLL OGR_L_SetAttributeFilter( OGRLayerH, const char * );
 void   CPL_DLL OGR_L_ResetReading( OGRLayerH );
 OGRFeatureH CPL_DLL OGR_L_GetNextFeature( OGRLayerH );
+int    CPL_DLL OGR_L_GetNextFeatureBatch( OGRLayerH, OGRFeatureBatchH, int );
 OGRErr CPL_DLL OGR_L_SetNextByIndex( OGRLayerH, long );
 OGRFeatureH CPL_DLL OGR_L_GetFeature( OGRLayerH, long );
 OGRErr CPL_DLL OGR_L_SetFeature( OGRLayerH, OGRFeatureH );
@@ -90,6 +90,8 @@ class CPL_DLL OGRFieldDefn
     const OGRField     *GetDefaultRef() { return &uDefault; }
 };
 
+class OGRFeature;
+
 /************************************************************************/
 /*                            OGRFeatureDefn                            */
 /************************************************************************/
@@ -121,6 +123,14 @@ class CPL_DLL OGRFeatureDefn
     OGRwkbGeometryType eGeomType;
 
     char        *pszFeatureClassName;
+
+    int         nFeaturePoolSize;
+    int         nPooledFeatureCount;
+    OGRFeature  **papoFeaturePool;
+
+    void        FlushFeaturePool( int nKeep );
+
+    friend class OGRFeature;
     
   public:
                 OGRFeatureDefn( const char * pszName = NULL );
@@ -144,6 +154,9 @@ class CPL_DLL OGRFeatureDefn
     int         GetReferenceCount() { return nRefCount; }
     void        Release();
 
+    void        SetFeaturePoolSize( int nSize );
+    int         GetFeaturePoolSize() { return nFeaturePoolSize; }
+
     static OGRFeatureDefn  *CreateFeatureDefn( const char *pszName = NULL );
     static void         DestroyFeatureDefn( OGRFeatureDefn * );
 };
@@ -165,6 +178,13 @@ class CPL_DLL OGRFeature
     OGRGeometry         *poGeometry;
     OGRField            *pauFields;
 
+    int                 nPoolState;
+    void                **papRetainedBuffers;
+    OGRGeometry         *poRetainedGeometry;
+
+    void               *ReuseFieldBuffer( int iField, const void *pSource,
+                                          int nSize );
+
   protected: 
     char *              m_pszStyleString;
     OGRStyleTable       *m_poStyleTable;
@@ -184,6 +204,8 @@ class CPL_DLL OGRFeature
     OGRFeature         *Clone();
     virtual OGRBoolean  Equal( OGRFeature * poFeature );
 
+    void                Reset();
+
     int                 GetFieldCount() { return poDefn->GetFieldCount(); }
     OGRFieldDefn       *GetFieldDefnRef( int iField )
                                       { return poDefn->GetFieldDefn(iField); }
@@ -289,6 +311,90 @@ class CPL_DLL OGRFeature
     static void         DestroyFeature( OGRFeature * );
 };
 
+/************************************************************************/
+/*                           OGRFeatureBatch                            */
+/************************************************************************/
+
+typedef struct
+{
+    OGRFieldType eType;
+    GByte       *pabySet;
+    int         *panValues;     /* OFTInteger, or offsets of string values */
+    double      *padfValues;    /* OFTReal */
+    OGRField    *pasValues;     /* OFTDate, OFTTime and OFTDateTime */
+} OGRFeatureBatchColumn;
+
+/**
+ * A block of features of a layer, stored by columns.
+ *
+ * Integer and real fields are kept in plain arrays, date and time fields
+ * as OGRField, and the other fields as strings, list and binary fields
+ * using their GetFieldAsString() representation.  Geometries are kept as
+ * little endian WKB.  All storage is reused from one batch to the next,
+ * so that reading through OGRLayer::GetNextFeatureBatch() does not
+ * allocate memory per feature.  Values returned by reference are only
+ * valid until the batch is next filled.
+ */
+
+class CPL_DLL OGRFeatureBatch
+{
+  private:
+    OGRFeatureDefn      *poDefn;
+    int                 nFieldCount;
+    int                 nFeatureCount;
+    int                 nCapacity;
+
+    long               *panFIDs;
+    OGRFeatureBatchColumn *pasColumns;
+
+    char               *pachStrings;
+    int                 nStringsSize;
+    int                 nStringsMax;
+
+    GByte              *pabyWKB;
+    int                 nWKBSize;
+    int                 nWKBMax;
+    int                *panWKBOffset;
+    int                *panWKBSize;
+
+    OGRFeature         *poScratchFeature;
+
+    void                FreeColumns();
+    void                Grow( int nNewCapacity );
+    int                 AddString( const char *pszValue );
+
+  public:
+                        OGRFeatureBatch();
+                        ~OGRFeatureBatch();
+
+    void                Reset( OGRFeatureDefn *poDefn );
+    OGRFeatureDefn     *GetDefnRef() { return poDefn; }
+    int                 GetFeatureCount() { return nFeatureCount; }
+
+    long                GetFID( int iFeature ) { return panFIDs[iFeature]; }
+    int                 IsFieldSet( int iFeature, int iField )
+                        { return pasColumns[iField].pabySet[iFeature]; }
+    int                 GetFieldAsInteger( int iFeature, int iField );
+    double              GetFieldAsDouble( int iFeature, int iField );
+    const char         *GetFieldAsString( int iFeature, int iField );
+    OGRField           *GetRawFieldRef( int iFeature, int iField );
+    const int          *GetIntegerColumn( int iField );
+    const double       *GetRealColumn( int iField );
+    const GByte        *GetGeometryWKB( int iFeature, int *pnSize );
+    OGRFeature         *GetFeature( int iFeature );
+
+    int                 AddFeature( long nFID );
+    int                 AddFeature( OGRFeature *poFeature );
+    void                SetField( int iFeature, int iField, int nValue );
+    void                SetField( int iFeature, int iField, double dfValue );
+    void                SetField( int iFeature, int iField,
+                                  const char *pszValue );
+    void                SetField( int iFeature, int iField,
+                                  OGRField *psValue );
+    GByte              *ReserveGeometryWKB( int iFeature, int nSize );
+    OGRErr              SetGeometry( int iFeature, OGRGeometry *poGeom );
+};
+
 /************************************************************************/
 /*                           OGRFeatureQuery                            */
 /************************************************************************/
@@ -300,6 +406,7 @@ class CPL_DLL OGRFeatureQuery
   private:
     OGRFeatureDefn *poTargetDefn;
     void           *pSWQExpr;
+    void           *pProgram;
 
     char          **FieldCollector( void *, char ** );
     
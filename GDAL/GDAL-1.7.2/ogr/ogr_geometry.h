@@ -294,6 +294,7 @@ class CPL_DLL OGRLineString : public OGRCurve
     void        setPoint( int, double, double );
     void        setPoint( int, double, double, double );
     void        setPoints( int, OGRRawPoint *, double * = NULL );
+    void        setPoints( const OGRLineString * );
     void        setPoints( int, double * padfX, double * padfY,
                            double *padfZ = NULL );
     void        addPoint( OGRPoint * );
@@ -642,4 +643,71 @@ class CPL_DLL OGRGeometryFactory
                               double dfMaxAngleStepSizeDegrees );
 };
 
+/************************************************************************/
+/*                          OGRWkbGeometryView                          */
+/************************************************************************/
+
+/* Point sequence of a WKB geometry: a point, line string or ring. */
+typedef struct
+{
+    int         nOffset;        /* of the first coordinate in the WKB */
+    int         nPointCount;
+    int         bIs3D;
+    int         bSwap;
+} OGRWkbPointSequence;
+
+/**
+ * Read-only view of a geometry in a WKB buffer.
+ *
+ * The buffer is validated when attached, and the coordinates are then read
+ * in place: no OGRGeometry is built unless createGeometry() is called.
+ * The view does not copy the buffer, which must be kept unchanged as long
+ * as it is attached.  A view can be attached to many buffers in turn,
+ * reusing its small internal tables.
+ */
+
+class CPL_DLL OGRWkbGeometryView
+{
+    const GByte        *pabyData;
+    int                 nSize;
+    OGRwkbGeometryType  eGeometryType;
+
+    int                 nSequenceCount;
+    int                 nSequenceMax;
+    OGRWkbPointSequence *pasSequences;
+    int                 nPointCount;
+
+    int                 iCurSequence;
+    int                 nCurSequenceStart;
+
+    OGRErr              ParseGeometry( int nOffset, int nAvailable, 
+                                       int nDepth, 
+                                       OGRwkbGeometryType *peType,
+                                       int *pnConsumed );
+    void                AddSequence( int nOffset, int nPoints, int bIs3D,
+                                     int bSwap );
+
+  public:
+                        OGRWkbGeometryView();
+                        ~OGRWkbGeometryView();
+
+    OGRErr              Attach( const GByte *pabyWKB, int nBytes = -1 );
+    void                Detach();
+
+    const GByte        *GetData() { return pabyData; }
+    int                 WkbSize() { return nSize; }
+    OGRwkbGeometryType  getGeometryType() { return eGeometryType; }
+    int                 getCoordinateDimension();
+    OGRBoolean          IsEmpty() { return nPointCount == 0; }
+
+    void                getEnvelope( OGREnvelope * psEnvelope );
+    int                 getNumPoints() { return nPointCount; }
+    int                 getPoint( int iPoint, double *pdfX, double *pdfY,
+                                  double *pdfZ = NULL );
+
+    OGRErr              exportToWkb( OGRwkbByteOrder, unsigned char * );
+    OGRErr              createGeometry( OGRGeometry **ppoGeometry,
+                                        OGRSpatialReference *poSRS = NULL );
+};
+
 #endif /* ndef _OGR_GEOMETRY_H_INCLUDED */
@@ -33,6 +33,11 @@
 
 CPL_CVSID("$Id: ogrfeature.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
+/* Values of OGRFeature::nPoolState */
+#define OGR_FEATURE_NOT_POOLABLE  0   /* not created by CreateFeature() */
+#define OGR_FEATURE_POOLABLE      1
+#define OGR_FEATURE_IN_POOL       2   /* kept by its definition for reuse */
+
 /************************************************************************/
 /*                             OGRFeature()                             */
 /************************************************************************/
@@ -64,6 +69,10 @@ OGRFeature::OGRFeature( OGRFeatureDefn * poDefnIn )
     
     poGeometry = NULL;
 
+    nPoolState = OGR_FEATURE_NOT_POOLABLE;
+    papRetainedBuffers = NULL;
+    poRetainedGeometry = NULL;
+
     // we should likely be initializing from the defaults, but this will
     // usually be a waste. 
     pauFields = (OGRField *) CPLCalloc( poDefn->GetFieldCount(),
@@ -87,7 +96,7 @@ OGRFeature::OGRFeature( OGRFeatureDefn * poDefnIn )
  * destruction of all OGRFeatures that depend on it is likely to result in
  * a crash. 
  *
- * This function is the same as the C++ method OGRFeature::OGRFeature().
+ * This function is the same as the C++ method OGRFeature::CreateFeature().
  * 
  * @param hDefn handle to the feature class (layer) definition to 
  * which the feature will adhere.
@@ -101,7 +110,7 @@ OGRFeatureH OGR_F_Create( OGRFeatureDefnH hDefn )
 {
     VALIDATE_POINTER1( hDefn, "OGR_F_Create", NULL );
 
-    return (OGRFeatureH) new OGRFeature( (OGRFeatureDefn *) hDefn );
+    return (OGRFeatureH) OGRFeature::CreateFeature( (OGRFeatureDefn *) hDefn );
 }
 
 /************************************************************************/
@@ -114,6 +123,8 @@ OGRFeature::~OGRFeature()
     if( poGeometry != NULL )
         delete poGeometry;
 
+    delete poRetainedGeometry;
+
     for( int i = 0; i < poDefn->GetFieldCount(); i++ )
     {
         OGRFieldDefn    *poFDefn = poDefn->GetFieldDefn(i);
@@ -147,8 +158,17 @@ OGRFeature::~OGRFeature()
             break;
         }
     }
+
+    if( papRetainedBuffers != NULL )
+    {
+        for( int i = 0; i < poDefn->GetFieldCount(); i++ )
+            CPLFree( papRetainedBuffers[i] );
+        CPLFree( papRetainedBuffers );
+    }
     
-    poDefn->Release();
+    // Pooled features gave their reference back when entering the pool.
+    if( nPoolState != OGR_FEATURE_IN_POOL )
+        poDefn->Release();
 
     CPLFree( pauFields );
     CPLFree(m_pszStyleString);
@@ -175,7 +195,7 @@ OGRFeature::~OGRFeature()
 void OGR_F_Destroy( OGRFeatureH hFeat )
 
 {
-    delete (OGRFeature *) hFeat;
+    OGRFeature::DestroyFeature( (OGRFeature *) hFeat );
 }
 
 /************************************************************************/
@@ -189,18 +209,34 @@ void OGR_F_Destroy( OGRFeatureH hFeat )
  * applications creating features but wanting to ensure they       
  * are created out of the OGR/GDAL heap.                           
  * 
+ * When the definition has a feature pool (see
+ * OGRFeatureDefn::SetFeaturePoolSize()), a feature previously passed to
+ * DestroyFeature() is returned if there is one.
+ *
  * This method is the same as the C function OGR_F_Create().
  *
  * @param poDefn Feature definition defining schema.
  * 
  * @return new feature object with null fields and no geometry.  May be
- * deleted with delete. 
+ * deleted with delete, or DestroyFeature() to let it be reused.
  */
 
 OGRFeature *OGRFeature::CreateFeature( OGRFeatureDefn *poDefn )
 
 {
-    return new OGRFeature( poDefn );
+    OGRFeature *poFeature;
+
+    if( poDefn->nPooledFeatureCount > 0 )
+    {
+        poFeature = poDefn->papoFeaturePool[--poDefn->nPooledFeatureCount];
+        poDefn->Reference();
+    }
+    else
+        poFeature = new OGRFeature( poDefn );
+
+    poFeature->nPoolState = OGR_FEATURE_POOLABLE;
+
+    return poFeature;
 }
 
 /************************************************************************/
@@ -216,6 +252,11 @@ OGRFeature *OGRFeature::CreateFeature( OGRFeatureDefn *poDefn )
  * delete is done in the calling application the memory will be freed onto
  * the application heap which is inappropriate. 
  *
+ * When the feature was obtained from CreateFeature() and its definition
+ * has room left in its feature pool (see
+ * OGRFeatureDefn::SetFeaturePoolSize()), the feature is Reset() and kept
+ * for reuse instead.
+ *
  * This method is the same as the C function OGR_F_Destroy().
  * 
  * @param poFeature the feature to delete.
@@ -224,6 +265,31 @@ OGRFeature *OGRFeature::CreateFeature( OGRFeatureDefn *poDefn )
 void OGRFeature::DestroyFeature( OGRFeature *poFeature )
 
 {
+    if( poFeature == NULL )
+        return;
+
+/* -------------------------------------------------------------------- */
+/*      Keep the feature in the pool of its definition if there is      */
+/*      room.  The pool does not hold references on the definition,     */
+/*      so the last reference is never given to it.                     */
+/* -------------------------------------------------------------------- */
+    OGRFeatureDefn *poDefn = poFeature->poDefn;
+
+    if( poFeature->nPoolState == OGR_FEATURE_POOLABLE
+        && poDefn->nPooledFeatureCount < poDefn->nFeaturePoolSize
+        && poDefn->GetReferenceCount() > 1 )
+    {
+        poFeature->Reset();
+        poFeature->nPoolState = OGR_FEATURE_IN_POOL;
+
+        if( poDefn->papoFeaturePool == NULL )
+            poDefn->papoFeaturePool = (OGRFeature **)
+                CPLMalloc( sizeof(OGRFeature *) * poDefn->nFeaturePoolSize );
+        poDefn->papoFeaturePool[poDefn->nPooledFeatureCount++] = poFeature;
+        poDefn->Dereference();
+        return;
+    }
+
     delete poFeature;
 }
 
@@ -292,6 +358,9 @@ OGRErr OGRFeature::SetGeometryDirectly( OGRGeometry * poGeomIn )
     delete poGeometry;
     poGeometry = poGeomIn;
 
+    delete poRetainedGeometry;
+    poRetainedGeometry = NULL;
+
     // I should be verifying that the geometry matches the defn's type.
     
     return OGRERR_NONE;
@@ -327,6 +396,101 @@ OGRErr OGR_F_SetGeometryDirectly( OGRFeatureH hFeat, OGRGeometryH hGeom )
     return ((OGRFeature *) hFeat)->SetGeometryDirectly((OGRGeometry *) hGeom);
 }
 
+/************************************************************************/
+/*                       OGRCopyGeometryInPlace()                       */
+/*                                                                      */
+/*      Make poDst a copy of poSrc without allocating new objects,      */
+/*      when both have the same structure: same classes, dimensions     */
+/*      and numbers of rings and parts.  Returns FALSE otherwise, in    */
+/*      which case poDst may have been partially modified.              */
+/************************************************************************/
+
+static int OGRCopyGeometryInPlace( OGRGeometry *poDst, OGRGeometry *poSrc )
+
+{
+    OGRwkbGeometryType eType = wkbFlatten(poSrc->getGeometryType());
+    int                i;
+
+    if( wkbFlatten(poDst->getGeometryType()) != eType
+        || !EQUAL(poDst->getGeometryName(), poSrc->getGeometryName())
+        || poDst->getCoordinateDimension() != poSrc->getCoordinateDimension() )
+        return FALSE;
+
+    switch( eType )
+    {
+      case wkbPoint:
+      {
+          OGRPoint *poDstPoint = (OGRPoint *) poDst;
+          OGRPoint *poSrcPoint = (OGRPoint *) poSrc;
+
+          poDstPoint->setX( poSrcPoint->getX() );
+          poDstPoint->setY( poSrcPoint->getY() );
+          poDstPoint->setZ( poSrcPoint->getZ() );
+          poDstPoint->setCoordinateDimension( 
+              poSrcPoint->getCoordinateDimension() );
+          break;
+      }
+
+      case wkbLineString:
+        ((OGRLineString *) poDst)->setPoints( (OGRLineString *) poSrc );
+        if( !EQUAL(poSrc->getGeometryName(), "LINEARRING") )
+            poDst->setCoordinateDimension( poSrc->getCoordinateDimension() );
+        break;
+
+      case wkbPolygon:
+      {
+          OGRPolygon *poDstPoly = (OGRPolygon *) poDst;
+          OGRPolygon *poSrcPoly = (OGRPolygon *) poSrc;
+
+          if( poDstPoly->getNumInteriorRings() 
+              != poSrcPoly->getNumInteriorRings()
+              || (poDstPoly->getExteriorRing() == NULL)
+              != (poSrcPoly->getExteriorRing() == NULL) )
+              return FALSE;
+
+          if( poSrcPoly->getExteriorRing() != NULL
+              && !OGRCopyGeometryInPlace( poDstPoly->getExteriorRing(),
+                                          poSrcPoly->getExteriorRing() ) )
+              return FALSE;
+
+          for( i = 0; i < poSrcPoly->getNumInteriorRings(); i++ )
+          {
+              if( !OGRCopyGeometryInPlace( poDstPoly->getInteriorRing(i),
+                                           poSrcPoly->getInteriorRing(i) ) )
+                  return FALSE;
+          }
+          break;
+      }
+
+      case wkbMultiPoint:
+      case wkbMultiLineString:
+      case wkbMultiPolygon:
+      case wkbGeometryCollection:
+      {
+          OGRGeometryCollection *poDstGC = (OGRGeometryCollection *) poDst;
+          OGRGeometryCollection *poSrcGC = (OGRGeometryCollection *) poSrc;
+
+          if( poDstGC->getNumGeometries() != poSrcGC->getNumGeometries() )
+              return FALSE;
+
+          for( i = 0; i < poSrcGC->getNumGeometries(); i++ )
+          {
+              if( !OGRCopyGeometryInPlace( poDstGC->getGeometryRef(i),
+                                           poSrcGC->getGeometryRef(i) ) )
+                  return FALSE;
+          }
+          break;
+      }
+
+      default:
+        return FALSE;
+    }
+
+    poDst->assignSpatialReference( poSrc->getSpatialReference() );
+
+    return TRUE;
+}
+
 /************************************************************************/
 /*                            SetGeometry()                             */
 /************************************************************************/
@@ -352,12 +516,36 @@ OGRErr OGR_F_SetGeometryDirectly( OGRFeatureH hFeat, OGRGeometryH hGeom )
 OGRErr OGRFeature::SetGeometry( OGRGeometry * poGeomIn )
 
 {
-    delete poGeometry;
+    if( poGeomIn == poGeometry )
+        return OGRERR_NONE;
 
-    if( poGeomIn != NULL )
-        poGeometry = poGeomIn->clone();
-    else
+    if( poGeomIn == NULL )
+    {
+        delete poGeometry;
         poGeometry = NULL;
+        return OGRERR_NONE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Copy the coordinates in the current geometry, or the one kept   */
+/*      by Reset(), when it has the same structure.                     */
+/* -------------------------------------------------------------------- */
+    OGRGeometry *poTarget = poGeometry ? poGeometry : poRetainedGeometry;
+
+    if( poTarget != NULL && OGRCopyGeometryInPlace( poTarget, poGeomIn ) )
+    {
+        if( poTarget == poRetainedGeometry )
+        {
+            poGeometry = poRetainedGeometry;
+            poRetainedGeometry = NULL;
+        }
+        return OGRERR_NONE;
+    }
+
+    OGRGeometry *poNewGeometry = poGeomIn->clone();
+
+    delete poGeometry;
+    poGeometry = poNewGeometry;
 
     // I should be verifying that the geometry matches the defn's type.
     
@@ -473,7 +661,7 @@ OGRGeometryH OGR_F_GetGeometryRef( OGRFeatureH hFeat )
 OGRFeature *OGRFeature::Clone()
 
 {
-    OGRFeature  *poNew = new OGRFeature( poDefn );
+    OGRFeature  *poNew = CreateFeature( poDefn );
 
     poNew->SetGeometry( poGeometry );
 
@@ -514,6 +702,155 @@ OGRFeatureH OGR_F_Clone( OGRFeatureH hFeat )
     return (OGRFeatureH) ((OGRFeature *) hFeat)->Clone();
 }
 
+/************************************************************************/
+/*                               Reset()                                */
+/************************************************************************/
+
+/**
+ * \brief Clear the feature for reuse.
+ *
+ * All fields are unset, and the geometry, FID and style string are
+ * cleared, so the feature is as just created.  The buffers of string,
+ * list and binary fields and the geometry are kept however, to be reused
+ * by the next SetField() and SetGeometry() calls instead of allocating
+ * new ones.  This is done by DestroyFeature() on features it keeps for
+ * reuse, and is useful when a feature object is filled again and again,
+ * for instance to write a stream of features.
+ */
+
+void OGRFeature::Reset()
+
+{
+    for( int i = 0; i < poDefn->GetFieldCount(); i++ )
+    {
+        void *pBuffer = NULL;
+
+        if( !IsFieldSet(i) )
+            continue;
+
+        switch( poDefn->GetFieldDefn(i)->GetType() )
+        {
+          case OFTString:
+            pBuffer = pauFields[i].String;
+            break;
+
+          case OFTIntegerList:
+          case OFTRealList:
+            pBuffer = pauFields[i].IntegerList.paList;
+            break;
+
+          case OFTBinary:
+            pBuffer = pauFields[i].Binary.paData;
+            break;
+
+          default:
+            break;
+        }
+
+        if( pBuffer == NULL )
+        {
+            UnsetField( i );
+            continue;
+        }
+
+        if( papRetainedBuffers == NULL )
+            papRetainedBuffers = (void **)
+                CPLCalloc( sizeof(void *), poDefn->GetFieldCount() );
+
+        CPLFree( papRetainedBuffers[i] );
+        papRetainedBuffers[i] = pBuffer;
+
+        pauFields[i].Set.nMarker1 = OGRUnsetMarker;
+        pauFields[i].Set.nMarker2 = OGRUnsetMarker;
+    }
+
+    if( poGeometry != NULL )
+    {
+        delete poRetainedGeometry;
+        poRetainedGeometry = poGeometry;
+        poGeometry = NULL;
+    }
+
+    nFID = OGRNullFID;
+
+    CPLFree( m_pszStyleString );
+    m_pszStyleString = NULL;
+    CPLFree( m_pszTmpFieldValue );
+    m_pszTmpFieldValue = NULL;
+    m_poStyleTable = NULL;
+}
+
+/************************************************************************/
+/*                          ReuseFieldBuffer()                          */
+/*                                                                      */
+/*      Return a copy of nSize bytes of pSource for the value of a      */
+/*      string, list or binary field, reallocating the buffer of the    */
+/*      current value, or the one kept by Reset(), if there is one.     */
+/************************************************************************/
+
+void *OGRFeature::ReuseFieldBuffer( int iField, const void *pSource,
+                                    int nSize )
+
+{
+    void *pBuffer = NULL;
+    int   nOldSize = 0;
+
+    if( IsFieldSet(iField) )
+    {
+        switch( poDefn->GetFieldDefn(iField)->GetType() )
+        {
+          case OFTString:
+            pBuffer = pauFields[iField].String;
+            nOldSize = pBuffer ? strlen((char *) pBuffer) + 1 : 0;
+            break;
+
+          case OFTIntegerList:
+            pBuffer = pauFields[iField].IntegerList.paList;
+            nOldSize = pauFields[iField].IntegerList.nCount * sizeof(int);
+            break;
+
+          case OFTRealList:
+            pBuffer = pauFields[iField].RealList.paList;
+            nOldSize = pauFields[iField].RealList.nCount * sizeof(double);
+            break;
+
+          case OFTBinary:
+            pBuffer = pauFields[iField].Binary.paData;
+            nOldSize = pauFields[iField].Binary.nCount;
+            break;
+
+          default:
+            break;
+        }
+    }
+    else if( papRetainedBuffers != NULL )
+    {
+        pBuffer = papRetainedBuffers[iField];
+        papRetainedBuffers[iField] = NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The new value may be taken from the current one.                */
+/* -------------------------------------------------------------------- */
+    if( pBuffer != NULL && nSize > 0
+        && (GByte *) pSource < (GByte *) pBuffer + nOldSize
+        && (GByte *) pSource + nSize > (GByte *) pBuffer )
+    {
+        void *pNewBuffer = CPLMalloc( nSize );
+
+        memcpy( pNewBuffer, pSource, nSize );
+        CPLFree( pBuffer );
+
+        return pNewBuffer;
+    }
+
+    pBuffer = CPLRealloc( pBuffer, nSize );
+    if( nSize > 0 )
+        memcpy( pBuffer, pSource, nSize );
+
+    return pBuffer;
+}
+
 /************************************************************************/
 /*                           GetFieldCount()                            */
 /************************************************************************/
@@ -1867,10 +2204,11 @@ void OGRFeature::SetField( int iField, const char * pszValue )
     
     if( poFDefn->GetType() == OFTString )
     {
-        if( IsFieldSet(iField) )
-            CPLFree( pauFields[iField].String );
-            
-        pauFields[iField].String = CPLStrdup( pszValue );
+        if( pszValue == NULL )
+            pszValue = "";
+
+        pauFields[iField].String = (char *)
+            ReuseFieldBuffer( iField, pszValue, strlen(pszValue) + 1 );
     }
     else if( poFDefn->GetType() == OFTInteger )
     {
@@ -2283,16 +2621,23 @@ void OGRFeature::SetField( int iField, OGRField * puValue )
     }
     else if( poFDefn->GetType() == OFTString )
     {
-        if( IsFieldSet( iField ) )
-            CPLFree( pauFields[iField].String );
-        
         if( puValue->String == NULL )
+        {
+            if( IsFieldSet( iField ) )
+                CPLFree( pauFields[iField].String );
             pauFields[iField].String = NULL;
+        }
         else if( puValue->Set.nMarker1 == OGRUnsetMarker
                  && puValue->Set.nMarker2 == OGRUnsetMarker )
+        {
+            if( IsFieldSet( iField ) )
+                CPLFree( pauFields[iField].String );
             pauFields[iField] = *puValue;
+        }
         else
-            pauFields[iField].String = CPLStrdup( puValue->String );
+            pauFields[iField].String = (char *)
+                ReuseFieldBuffer( iField, puValue->String,
+                                  strlen(puValue->String) + 1 );
     }
     else if( poFDefn->GetType() == OFTDate
              || poFDefn->GetType() == OFTTime
@@ -2304,21 +2649,18 @@ void OGRFeature::SetField( int iField, OGRField * puValue )
     {
         int     nCount = puValue->IntegerList.nCount;
         
-        if( IsFieldSet( iField ) )
-            CPLFree( pauFields[iField].IntegerList.paList );
-        
         if( puValue->Set.nMarker1 == OGRUnsetMarker
             && puValue->Set.nMarker2 == OGRUnsetMarker )
         {
+            if( IsFieldSet( iField ) )
+                CPLFree( pauFields[iField].IntegerList.paList );
             pauFields[iField] = *puValue;
         }
         else
         {
-            pauFields[iField].IntegerList.paList =
-                (int *) CPLMalloc(sizeof(int) * nCount);
-            memcpy( pauFields[iField].IntegerList.paList,
-                    puValue->IntegerList.paList,
-                    sizeof(int) * nCount );
+            pauFields[iField].IntegerList.paList = (int *)
+                ReuseFieldBuffer( iField, puValue->IntegerList.paList,
+                                  sizeof(int) * nCount );
             pauFields[iField].IntegerList.nCount = nCount;
         }
     }
@@ -2326,21 +2668,18 @@ void OGRFeature::SetField( int iField, OGRField * puValue )
     {
         int     nCount = puValue->RealList.nCount;
 
-        if( IsFieldSet( iField ) )
-            CPLFree( pauFields[iField].RealList.paList );
-
         if( puValue->Set.nMarker1 == OGRUnsetMarker
             && puValue->Set.nMarker2 == OGRUnsetMarker )
         {
+            if( IsFieldSet( iField ) )
+                CPLFree( pauFields[iField].RealList.paList );
             pauFields[iField] = *puValue;
         }
         else
         {
-            pauFields[iField].RealList.paList =
-                (double *) CPLMalloc(sizeof(double) * nCount);
-            memcpy( pauFields[iField].RealList.paList,
-                    puValue->RealList.paList,
-                    sizeof(double) * nCount );
+            pauFields[iField].RealList.paList = (double *)
+                ReuseFieldBuffer( iField, puValue->RealList.paList,
+                                  sizeof(double) * nCount );
             pauFields[iField].RealList.nCount = nCount;
         }
     }
@@ -2366,22 +2705,20 @@ void OGRFeature::SetField( int iField, OGRField * puValue )
     }
     else if( poFDefn->GetType() == OFTBinary )
     {
-        if( IsFieldSet( iField ) )
-            CPLFree( pauFields[iField].Binary.paData );
-        
         if( puValue->Set.nMarker1 == OGRUnsetMarker
             && puValue->Set.nMarker2 == OGRUnsetMarker )
         {
+            if( IsFieldSet( iField ) )
+                CPLFree( pauFields[iField].Binary.paData );
             pauFields[iField] = *puValue;
         }
         else
         {
-            pauFields[iField].Binary.nCount = puValue->Binary.nCount;
-            pauFields[iField].Binary.paData = 
-                (GByte *) CPLMalloc(puValue->Binary.nCount);
-            memcpy( pauFields[iField].Binary.paData, 
-                    puValue->Binary.paData, 
-                    puValue->Binary.nCount );
+            int nCount = puValue->Binary.nCount;
+
+            pauFields[iField].Binary.paData = (GByte *)
+                ReuseFieldBuffer( iField, puValue->Binary.paData, nCount );
+            pauFields[iField].Binary.nCount = nCount;
         }
     }
     else
@@ -3276,6 +3613,22 @@ OGRErr OGRFeature::RemapFields( OGRFeatureDefn *poNewDefn,
     CPLFree( pauFields );
     pauFields = pauNewFields;
 
+/* -------------------------------------------------------------------- */
+/*      Buffers kept by Reset() are indexed on the old fields.  The     */
+/*      feature no longer matches the references held on the            */
+/*      definitions either, so it must not be pooled.                   */
+/* -------------------------------------------------------------------- */
+    if( papRetainedBuffers != NULL )
+    {
+        for( int i = 0; i < poDefn->GetFieldCount(); i++ )
+            CPLFree( papRetainedBuffers[i] );
+        CPLFree( papRetainedBuffers );
+        papRetainedBuffers = NULL;
+    }
+
+    if( poNewDefn != poDefn )
+        nPoolState = OGR_FEATURE_NOT_POOLABLE;
+
     poDefn = poNewDefn;
 
     return OGRERR_NONE;
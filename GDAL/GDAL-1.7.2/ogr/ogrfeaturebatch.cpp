@@ -0,0 +1,1069 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  The OGRFeatureBatch class implementation.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_feature.h"
+#include "ogr_api.h"
+#include "ogr_p.h"
+
+CPL_CVSID("$Id$");
+
+/************************************************************************/
+/*                          OGRFeatureBatch()                           */
+/************************************************************************/
+
+/**
+ * \brief Constructor
+ *
+ * The batch is empty, and gets its definition from the first call to
+ * Reset(), normally done by OGRLayer::GetNextFeatureBatch().
+ */
+
+OGRFeatureBatch::OGRFeatureBatch()
+
+{
+    poDefn = NULL;
+    nFieldCount = 0;
+    nFeatureCount = 0;
+    nCapacity = 0;
+
+    panFIDs = NULL;
+    pasColumns = NULL;
+
+    pachStrings = NULL;
+    nStringsSize = 0;
+    nStringsMax = 0;
+
+    pabyWKB = NULL;
+    nWKBSize = 0;
+    nWKBMax = 0;
+    panWKBOffset = NULL;
+    panWKBSize = NULL;
+
+    poScratchFeature = NULL;
+}
+
+/************************************************************************/
+/*                          ~OGRFeatureBatch()                          */
+/************************************************************************/
+
+OGRFeatureBatch::~OGRFeatureBatch()
+
+{
+    FreeColumns();
+
+    CPLFree( pachStrings );
+    CPLFree( pabyWKB );
+
+    if( poDefn != NULL )
+        poDefn->Release();
+}
+
+/************************************************************************/
+/*                            FreeColumns()                             */
+/************************************************************************/
+
+void OGRFeatureBatch::FreeColumns()
+
+{
+    for( int iField = 0; iField < nFieldCount; iField++ )
+    {
+        CPLFree( pasColumns[iField].pabySet );
+        CPLFree( pasColumns[iField].panValues );
+        CPLFree( pasColumns[iField].padfValues );
+        CPLFree( pasColumns[iField].pasValues );
+    }
+
+    CPLFree( pasColumns );
+    pasColumns = NULL;
+    nFieldCount = 0;
+
+    CPLFree( panFIDs );
+    CPLFree( panWKBOffset );
+    CPLFree( panWKBSize );
+    panFIDs = NULL;
+    panWKBOffset = NULL;
+    panWKBSize = NULL;
+    nCapacity = 0;
+    nFeatureCount = 0;
+
+    delete poScratchFeature;
+    poScratchFeature = NULL;
+}
+
+/************************************************************************/
+/*                               Reset()                                */
+/************************************************************************/
+
+/**
+ * \brief Empty the batch.
+ *
+ * The storage is kept for the next features as long as the definition
+ * does not change.  This is called by the layers before filling the batch.
+ *
+ * @param poDefnIn the definition of the features to come.
+ */
+
+void OGRFeatureBatch::Reset( OGRFeatureDefn *poDefnIn )
+
+{
+    nFeatureCount = 0;
+    nStringsSize = 0;
+    nWKBSize = 0;
+
+    if( poDefnIn == poDefn && poDefn->GetFieldCount() == nFieldCount )
+        return;
+
+    FreeColumns();
+
+    poDefnIn->Reference();
+    if( poDefn != NULL )
+        poDefn->Release();
+    poDefn = poDefnIn;
+
+    nFieldCount = poDefn->GetFieldCount();
+    pasColumns = (OGRFeatureBatchColumn *)
+        CPLCalloc( sizeof(OGRFeatureBatchColumn), MAX(1,nFieldCount) );
+
+    for( int iField = 0; iField < nFieldCount; iField++ )
+        pasColumns[iField].eType = poDefn->GetFieldDefn(iField)->GetType();
+
+    poScratchFeature = new OGRFeature( poDefn );
+}
+
+/************************************************************************/
+/*                                Grow()                                */
+/************************************************************************/
+
+void OGRFeatureBatch::Grow( int nNewCapacity )
+
+{
+    panFIDs = (long *) CPLRealloc( panFIDs, sizeof(long) * nNewCapacity );
+    panWKBOffset = (int *)
+        CPLRealloc( panWKBOffset, sizeof(int) * nNewCapacity );
+    panWKBSize = (int *) CPLRealloc( panWKBSize, sizeof(int) * nNewCapacity );
+
+    for( int iField = 0; iField < nFieldCount; iField++ )
+    {
+        OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+        psColumn->pabySet = (GByte *)
+            CPLRealloc( psColumn->pabySet, nNewCapacity );
+
+        switch( psColumn->eType )
+        {
+          case OFTReal:
+            psColumn->padfValues = (double *)
+                CPLRealloc( psColumn->padfValues,
+                            sizeof(double) * nNewCapacity );
+            break;
+
+          case OFTDate:
+          case OFTTime:
+          case OFTDateTime:
+            psColumn->pasValues = (OGRField *)
+                CPLRealloc( psColumn->pasValues,
+                            sizeof(OGRField) * nNewCapacity );
+            break;
+
+          default:
+            psColumn->panValues = (int *)
+                CPLRealloc( psColumn->panValues, sizeof(int) * nNewCapacity );
+            break;
+        }
+    }
+
+    nCapacity = nNewCapacity;
+}
+
+/************************************************************************/
+/*                             AddString()                              */
+/*                                                                      */
+/*      Copy a string in the pool, returning its offset.                */
+/************************************************************************/
+
+int OGRFeatureBatch::AddString( const char *pszValue )
+
+{
+    int nLength = strlen(pszValue) + 1;
+    int nOffset = nStringsSize;
+
+    if( nStringsSize + nLength > nStringsMax )
+    {
+        nStringsMax = MAX(nStringsMax * 2, nStringsSize + nLength + 4096);
+        pachStrings = (char *) CPLRealloc( pachStrings, nStringsMax );
+    }
+
+    memcpy( pachStrings + nOffset, pszValue, nLength );
+    nStringsSize += nLength;
+
+    return nOffset;
+}
+
+/************************************************************************/
+/*                             AddFeature()                             */
+/************************************************************************/
+
+/**
+ * \brief Append a feature with no field set and no geometry.
+ *
+ * Used by the layers to fill the batch, along with SetField() and
+ * SetGeometry().
+ *
+ * @param nFID the feature id.
+ *
+ * @return the index of the new feature in the batch.
+ */
+
+int OGRFeatureBatch::AddFeature( long nFID )
+
+{
+    if( nFeatureCount == nCapacity )
+        Grow( MAX(64, nCapacity * 2) );
+
+    int iFeature = nFeatureCount++;
+
+    panFIDs[iFeature] = nFID;
+    panWKBOffset[iFeature] = 0;
+    panWKBSize[iFeature] = 0;
+
+    for( int iField = 0; iField < nFieldCount; iField++ )
+    {
+        OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+        psColumn->pabySet[iFeature] = FALSE;
+        if( psColumn->eType == OFTInteger )
+            psColumn->panValues[iFeature] = 0;
+        else if( psColumn->eType == OFTReal )
+            psColumn->padfValues[iFeature] = 0.0;
+    }
+
+    return iFeature;
+}
+
+/**
+ * \brief Append a copy of a feature.
+ *
+ * This is what the generic OGRLayer::GetNextFeatureBatch() does with
+ * each feature it reads.
+ *
+ * @param poFeature the feature to copy, of the definition of the batch.
+ *
+ * @return the index of the new feature in the batch.
+ */
+
+int OGRFeatureBatch::AddFeature( OGRFeature *poFeature )
+
+{
+    int iFeature = AddFeature( poFeature->GetFID() );
+
+    for( int iField = 0; iField < nFieldCount; iField++ )
+    {
+        OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+        if( !poFeature->IsFieldSet( iField ) )
+            continue;
+
+        switch( psColumn->eType )
+        {
+          case OFTInteger:
+            psColumn->panValues[iFeature] =
+                poFeature->GetFieldAsInteger( iField );
+            break;
+
+          case OFTReal:
+            psColumn->padfValues[iFeature] =
+                poFeature->GetFieldAsDouble( iField );
+            break;
+
+          case OFTDate:
+          case OFTTime:
+          case OFTDateTime:
+            psColumn->pasValues[iFeature] =
+                *(poFeature->GetRawFieldRef( iField ));
+            break;
+
+          default:
+            psColumn->panValues[iFeature] =
+                AddString( poFeature->GetFieldAsString( iField ) );
+            break;
+        }
+
+        psColumn->pabySet[iFeature] = TRUE;
+    }
+
+    SetGeometry( iFeature, poFeature->GetGeometryRef() );
+
+    return iFeature;
+}
+
+/************************************************************************/
+/*                              SetField()                              */
+/************************************************************************/
+
+/**
+ * \brief Set a field of a feature of the batch from an integer.
+ *
+ * Conversions are done as OGRFeature::SetField() does them.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to set.
+ * @param nValue the value to assign.
+ */
+
+void OGRFeatureBatch::SetField( int iFeature, int iField, int nValue )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        psColumn->panValues[iFeature] = nValue;
+        break;
+
+      case OFTReal:
+        psColumn->padfValues[iFeature] = nValue;
+        break;
+
+      case OFTString:
+      {
+          char szTempBuffer[64];
+
+          sprintf( szTempBuffer, "%d", nValue );
+          psColumn->panValues[iFeature] = AddString( szTempBuffer );
+          break;
+      }
+
+      default:
+        return;
+    }
+
+    psColumn->pabySet[iFeature] = TRUE;
+}
+
+/**
+ * \brief Set a field of a feature of the batch from a double.
+ *
+ * Conversions are done as OGRFeature::SetField() does them.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to set.
+ * @param dfValue the value to assign.
+ */
+
+void OGRFeatureBatch::SetField( int iFeature, int iField, double dfValue )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        psColumn->panValues[iFeature] = (int) dfValue;
+        break;
+
+      case OFTReal:
+        psColumn->padfValues[iFeature] = dfValue;
+        break;
+
+      case OFTString:
+      {
+          char szTempBuffer[128];
+
+          sprintf( szTempBuffer, "%.16g", dfValue );
+          psColumn->panValues[iFeature] = AddString( szTempBuffer );
+          break;
+      }
+
+      default:
+        return;
+    }
+
+    psColumn->pabySet[iFeature] = TRUE;
+}
+
+/**
+ * \brief Set a field of a feature of the batch from a string.
+ *
+ * Conversions are done as OGRFeature::SetField() does them : integer and
+ * real fields are parsed with atoi() and atof(), date and time fields
+ * with OGRParseDate(), and list or binary fields are left unset.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to set.
+ * @param pszValue the value to assign.
+ */
+
+void OGRFeatureBatch::SetField( int iFeature, int iField,
+                                const char *pszValue )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        psColumn->panValues[iFeature] = atoi(pszValue);
+        break;
+
+      case OFTReal:
+        psColumn->padfValues[iFeature] = atof(pszValue);
+        break;
+
+      case OFTString:
+        psColumn->panValues[iFeature] = AddString( pszValue );
+        break;
+
+      case OFTDate:
+      case OFTTime:
+      case OFTDateTime:
+        if( !OGRParseDate( pszValue, psColumn->pasValues + iFeature, 0 ) )
+            return;
+        break;
+
+      default:
+        return;
+    }
+
+    psColumn->pabySet[iFeature] = TRUE;
+}
+
+/**
+ * \brief Set a field of a feature of the batch from a raw value.
+ *
+ * The value is interpreted according to the field type, as with
+ * OGRFeature::SetField( int, OGRField * ).
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to set.
+ * @param psValue the value to assign.
+ */
+
+void OGRFeatureBatch::SetField( int iFeature, int iField, OGRField *psValue )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    if( psValue->Set.nMarker1 == OGRUnsetMarker
+        && psValue->Set.nMarker2 == OGRUnsetMarker )
+        return;
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        psColumn->panValues[iFeature] = psValue->Integer;
+        break;
+
+      case OFTReal:
+        psColumn->padfValues[iFeature] = psValue->Real;
+        break;
+
+      case OFTString:
+        psColumn->panValues[iFeature] =
+            AddString( psValue->String ? psValue->String : "" );
+        break;
+
+      case OFTDate:
+      case OFTTime:
+      case OFTDateTime:
+        psColumn->pasValues[iFeature] = *psValue;
+        break;
+
+      default:
+        poScratchFeature->SetField( iField, psValue );
+        psColumn->panValues[iFeature] =
+            AddString( poScratchFeature->GetFieldAsString( iField ) );
+        poScratchFeature->UnsetField( iField );
+        break;
+    }
+
+    psColumn->pabySet[iFeature] = TRUE;
+}
+
+/************************************************************************/
+/*                         ReserveGeometryWKB()                         */
+/************************************************************************/
+
+/**
+ * \brief Reserve room for the WKB geometry of a feature of the batch.
+ *
+ * This lets layers write the WKB of a geometry directly, without
+ * building an OGRGeometry first.  The returned buffer is only valid
+ * until the next geometry is set.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param nSize the size of the WKB geometry in bytes.
+ *
+ * @return the buffer to write the little endian WKB geometry to.
+ */
+
+GByte *OGRFeatureBatch::ReserveGeometryWKB( int iFeature, int nSize )
+
+{
+    if( nWKBSize + nSize > nWKBMax )
+    {
+        nWKBMax = MAX(nWKBMax * 2, nWKBSize + nSize + 65536);
+        pabyWKB = (GByte *) CPLRealloc( pabyWKB, nWKBMax );
+    }
+
+    panWKBOffset[iFeature] = nWKBSize;
+    panWKBSize[iFeature] = nSize;
+    nWKBSize += nSize;
+
+    return pabyWKB + panWKBOffset[iFeature];
+}
+
+/************************************************************************/
+/*                            SetGeometry()                             */
+/************************************************************************/
+
+/**
+ * \brief Set the geometry of a feature of the batch.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param poGeom the geometry, copied as WKB.  May be NULL.
+ *
+ * @return OGRERR_NONE on success.
+ */
+
+OGRErr OGRFeatureBatch::SetGeometry( int iFeature, OGRGeometry *poGeom )
+
+{
+    if( poGeom == NULL )
+    {
+        panWKBSize[iFeature] = 0;
+        return OGRERR_NONE;
+    }
+
+    GByte *pabyTarget = ReserveGeometryWKB( iFeature, poGeom->WkbSize() );
+
+    return poGeom->exportToWkb( wkbNDR, pabyTarget );
+}
+
+/************************************************************************/
+/*                         GetFieldAsInteger()                          */
+/************************************************************************/
+
+/**
+ * \brief Fetch a field of a feature of the batch as an integer.
+ *
+ * Conversions are done as OGRFeature::GetFieldAsInteger() does them.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the field value, or 0 if it is not set.
+ */
+
+int OGRFeatureBatch::GetFieldAsInteger( int iFeature, int iField )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    if( !psColumn->pabySet[iFeature] )
+        return 0;
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        return psColumn->panValues[iFeature];
+
+      case OFTReal:
+        return (int) psColumn->padfValues[iFeature];
+
+      case OFTString:
+        return atoi( pachStrings + psColumn->panValues[iFeature] );
+
+      default:
+        return 0;
+    }
+}
+
+/************************************************************************/
+/*                          GetFieldAsDouble()                          */
+/************************************************************************/
+
+/**
+ * \brief Fetch a field of a feature of the batch as a double.
+ *
+ * Conversions are done as OGRFeature::GetFieldAsDouble() does them.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the field value, or 0.0 if it is not set.
+ */
+
+double OGRFeatureBatch::GetFieldAsDouble( int iFeature, int iField )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    if( !psColumn->pabySet[iFeature] )
+        return 0.0;
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        return psColumn->panValues[iFeature];
+
+      case OFTReal:
+        return psColumn->padfValues[iFeature];
+
+      case OFTString:
+        return atof( pachStrings + psColumn->panValues[iFeature] );
+
+      default:
+        return 0.0;
+    }
+}
+
+/************************************************************************/
+/*                          GetFieldAsString()                          */
+/************************************************************************/
+
+/**
+ * \brief Fetch a field of a feature of the batch as a string.
+ *
+ * Values are formatted as OGRFeature::GetFieldAsString() does.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the field value, or an empty string if it is not set.  The
+ * string is internal, and may change on the next call.
+ */
+
+const char *OGRFeatureBatch::GetFieldAsString( int iFeature, int iField )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    if( !psColumn->pabySet[iFeature] )
+        return "";
+
+    switch( psColumn->eType )
+    {
+      case OFTInteger:
+        poScratchFeature->SetField( iField, psColumn->panValues[iFeature] );
+        break;
+
+      case OFTReal:
+        poScratchFeature->SetField( iField, psColumn->padfValues[iFeature] );
+        break;
+
+      case OFTDate:
+      case OFTTime:
+      case OFTDateTime:
+        poScratchFeature->SetField( iField, psColumn->pasValues + iFeature );
+        break;
+
+      default:
+        return pachStrings + psColumn->panValues[iFeature];
+    }
+
+    return poScratchFeature->GetFieldAsString( iField );
+}
+
+/************************************************************************/
+/*                           GetRawFieldRef()                           */
+/************************************************************************/
+
+/**
+ * \brief Fetch a date or time field of a feature of the batch.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the internal value, or NULL if the field is not set or not a
+ * date or time field.
+ */
+
+OGRField *OGRFeatureBatch::GetRawFieldRef( int iFeature, int iField )
+
+{
+    OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+    if( psColumn->pasValues == NULL || !psColumn->pabySet[iFeature] )
+        return NULL;
+
+    return psColumn->pasValues + iFeature;
+}
+
+/************************************************************************/
+/*                          GetIntegerColumn()                          */
+/************************************************************************/
+
+/**
+ * \brief Fetch the values of an integer field for all the batch.
+ *
+ * Unset values are 0, IsFieldSet() telling them apart.
+ *
+ * @param iField the field to fetch.
+ *
+ * @return an internal array of GetFeatureCount() values, or NULL if the
+ * field is not of type OFTInteger.
+ */
+
+const int *OGRFeatureBatch::GetIntegerColumn( int iField )
+
+{
+    if( pasColumns[iField].eType != OFTInteger )
+        return NULL;
+
+    return pasColumns[iField].panValues;
+}
+
+/************************************************************************/
+/*                           GetRealColumn()                            */
+/************************************************************************/
+
+/**
+ * \brief Fetch the values of a real field for all the batch.
+ *
+ * Unset values are 0.0, IsFieldSet() telling them apart.
+ *
+ * @param iField the field to fetch.
+ *
+ * @return an internal array of GetFeatureCount() values, or NULL if the
+ * field is not of type OFTReal.
+ */
+
+const double *OGRFeatureBatch::GetRealColumn( int iField )
+
+{
+    if( pasColumns[iField].eType != OFTReal )
+        return NULL;
+
+    return pasColumns[iField].padfValues;
+}
+
+/************************************************************************/
+/*                           GetGeometryWKB()                           */
+/************************************************************************/
+
+/**
+ * \brief Fetch the geometry of a feature of the batch.
+ *
+ * @param iFeature the index of the feature in the batch.
+ * @param pnSize place to return the size of the WKB geometry in bytes.
+ *
+ * @return the internal little endian WKB geometry, or NULL if the feature
+ * has no geometry.
+ */
+
+const GByte *OGRFeatureBatch::GetGeometryWKB( int iFeature, int *pnSize )
+
+{
+    if( pnSize != NULL )
+        *pnSize = panWKBSize[iFeature];
+
+    if( panWKBSize[iFeature] == 0 )
+        return NULL;
+
+    return pabyWKB + panWKBOffset[iFeature];
+}
+
+/************************************************************************/
+/*                             GetFeature()                             */
+/************************************************************************/
+
+/**
+ * \brief Build an OGRFeature from a feature of the batch.
+ *
+ * List and binary fields, kept as strings in the batch, are not set.
+ *
+ * @param iFeature the index of the feature in the batch.
+ *
+ * @return a new feature, to be destroyed by the caller.
+ */
+
+OGRFeature *OGRFeatureBatch::GetFeature( int iFeature )
+
+{
+    OGRFeature *poFeature = new OGRFeature( poDefn );
+
+    poFeature->SetFID( panFIDs[iFeature] );
+
+    for( int iField = 0; iField < nFieldCount; iField++ )
+    {
+        OGRFeatureBatchColumn *psColumn = pasColumns + iField;
+
+        if( !psColumn->pabySet[iFeature] )
+            continue;
+
+        switch( psColumn->eType )
+        {
+          case OFTInteger:
+            poFeature->SetField( iField, psColumn->panValues[iFeature] );
+            break;
+
+          case OFTReal:
+            poFeature->SetField( iField, psColumn->padfValues[iFeature] );
+            break;
+
+          case OFTString:
+            poFeature->SetField( iField,
+                                 pachStrings + psColumn->panValues[iFeature] );
+            break;
+
+          case OFTDate:
+          case OFTTime:
+          case OFTDateTime:
+            poFeature->SetField( iField, psColumn->pasValues + iFeature );
+            break;
+
+          default:
+            break;
+        }
+    }
+
+    if( panWKBSize[iFeature] > 0 )
+    {
+        OGRGeometry *poGeom = NULL;
+
+        if( OGRGeometryFactory::createFromWkb(
+                pabyWKB + panWKBOffset[iFeature], NULL, &poGeom,
+                panWKBSize[iFeature] ) == OGRERR_NONE )
+            poFeature->SetGeometryDirectly( poGeom );
+    }
+
+    return poFeature;
+}
+
+/************************************************************************/
+/*                           OGR_FB_Create()                            */
+/************************************************************************/
+
+/**
+ * \brief Create an empty feature batch.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::OGRFeatureBatch().
+ *
+ * @return a handle to the new batch, to be destroyed with OGR_FB_Destroy().
+ */
+
+OGRFeatureBatchH OGR_FB_Create()
+
+{
+    return (OGRFeatureBatchH) new OGRFeatureBatch();
+}
+
+/************************************************************************/
+/*                           OGR_FB_Destroy()                           */
+/************************************************************************/
+
+/**
+ * \brief Destroy a feature batch.
+ *
+ * @param hBatch handle to the batch to destroy.
+ */
+
+void OGR_FB_Destroy( OGRFeatureBatchH hBatch )
+
+{
+    delete (OGRFeatureBatch *) hBatch;
+}
+
+/************************************************************************/
+/*                       OGR_FB_GetFeatureCount()                       */
+/************************************************************************/
+
+/**
+ * \brief Fetch the number of features in the batch.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::GetFeatureCount().
+ *
+ * @param hBatch handle to the batch.
+ *
+ * @return the number of features.
+ */
+
+int OGR_FB_GetFeatureCount( OGRFeatureBatchH hBatch )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_GetFeatureCount", 0 );
+
+    return ((OGRFeatureBatch *) hBatch)->GetFeatureCount();
+}
+
+/************************************************************************/
+/*                           OGR_FB_GetFID()                            */
+/************************************************************************/
+
+/**
+ * \brief Fetch the feature id of a feature of the batch.
+ *
+ * This function is the same as the C++ method OGRFeatureBatch::GetFID().
+ *
+ * @param hBatch handle to the batch.
+ * @param iFeature the index of the feature in the batch.
+ *
+ * @return the feature id.
+ */
+
+long OGR_FB_GetFID( OGRFeatureBatchH hBatch, int iFeature )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_GetFID", OGRNullFID );
+
+    return ((OGRFeatureBatch *) hBatch)->GetFID( iFeature );
+}
+
+/************************************************************************/
+/*                         OGR_FB_IsFieldSet()                          */
+/************************************************************************/
+
+/**
+ * \brief Test if a field of a feature of the batch is set.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::IsFieldSet().
+ *
+ * @param hBatch handle to the batch.
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to test.
+ *
+ * @return TRUE if the field is set, otherwise FALSE.
+ */
+
+int OGR_FB_IsFieldSet( OGRFeatureBatchH hBatch, int iFeature, int iField )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_IsFieldSet", FALSE );
+
+    return ((OGRFeatureBatch *) hBatch)->IsFieldSet( iFeature, iField );
+}
+
+/************************************************************************/
+/*                      OGR_FB_GetFieldAsInteger()                      */
+/************************************************************************/
+
+/**
+ * \brief Fetch a field of a feature of the batch as an integer.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::GetFieldAsInteger().
+ *
+ * @param hBatch handle to the batch.
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the field value.
+ */
+
+int OGR_FB_GetFieldAsInteger( OGRFeatureBatchH hBatch,
+                              int iFeature, int iField )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_GetFieldAsInteger", 0 );
+
+    return ((OGRFeatureBatch *) hBatch)->GetFieldAsInteger( iFeature, iField );
+}
+
+/************************************************************************/
+/*                      OGR_FB_GetFieldAsDouble()                       */
+/************************************************************************/
+
+/**
+ * \brief Fetch a field of a feature of the batch as a double.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::GetFieldAsDouble().
+ *
+ * @param hBatch handle to the batch.
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the field value.
+ */
+
+double OGR_FB_GetFieldAsDouble( OGRFeatureBatchH hBatch,
+                                int iFeature, int iField )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_GetFieldAsDouble", 0.0 );
+
+    return ((OGRFeatureBatch *) hBatch)->GetFieldAsDouble( iFeature, iField );
+}
+
+/************************************************************************/
+/*                      OGR_FB_GetFieldAsString()                       */
+/************************************************************************/
+
+/**
+ * \brief Fetch a field of a feature of the batch as a string.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::GetFieldAsString().
+ *
+ * @param hBatch handle to the batch.
+ * @param iFeature the index of the feature in the batch.
+ * @param iField the field to fetch.
+ *
+ * @return the field value.  This string is internal, and should not be
+ * modified, or freed.  Its lifetime may be very brief.
+ */
+
+const char *OGR_FB_GetFieldAsString( OGRFeatureBatchH hBatch,
+                                     int iFeature, int iField )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_GetFieldAsString", NULL );
+
+    return ((OGRFeatureBatch *) hBatch)->GetFieldAsString( iFeature, iField );
+}
+
+/************************************************************************/
+/*                       OGR_FB_GetGeometryWKB()                        */
+/************************************************************************/
+
+/**
+ * \brief Fetch the geometry of a feature of the batch as WKB.
+ *
+ * This function is the same as the C++ method
+ * OGRFeatureBatch::GetGeometryWKB().
+ *
+ * @param hBatch handle to the batch.
+ * @param iFeature the index of the feature in the batch.
+ * @param pnSize place to return the size of the geometry in bytes.
+ *
+ * @return the internal little endian WKB geometry, or NULL if the
+ * feature has no geometry.
+ */
+
+const GByte *OGR_FB_GetGeometryWKB( OGRFeatureBatchH hBatch,
+                                    int iFeature, int *pnSize )
+
+{
+    VALIDATE_POINTER1( hBatch, "OGR_FB_GetGeometryWKB", NULL );
+
+    return ((OGRFeatureBatch *) hBatch)->GetGeometryWKB( iFeature, pnSize );
+}
@@ -58,6 +58,10 @@ OGRFeatureDefn::OGRFeatureDefn( const char * pszName )
     nFieldCount = 0;
     papoFieldDefn = NULL;
     eGeomType = wkbUnknown;
+
+    nFeaturePoolSize = atoi(CPLGetConfigOption( "OGR_FEATURE_POOL_SIZE", "0" ));
+    nPooledFeatureCount = 0;
+    papoFeaturePool = NULL;
 }
 
 /************************************************************************/
@@ -97,6 +101,9 @@ OGRFeatureDefn::~OGRFeatureDefn()
                   "OGRFeatureDefn %s with a ref count of %d deleted!\n",
                   pszFeatureClassName, nRefCount );
     }
+
+    FlushFeaturePool( 0 );
+    CPLFree( papoFeaturePool );
     
     CPLFree( pszFeatureClassName );
 
@@ -145,6 +152,82 @@ void OGRFeatureDefn::Release()
         delete this;
 }
 
+/************************************************************************/
+/*                         SetFeaturePoolSize()                         */
+/************************************************************************/
+
+/**
+ * \brief Set the number of destroyed features kept for reuse.
+ *
+ * Features obtained from OGRFeature::CreateFeature() and passed to
+ * OGRFeature::DestroyFeature() are kept, up to this count, and handed out
+ * again by the next OGRFeature::CreateFeature() calls for this definition.
+ * A recycled feature keeps the buffers of its string, list and binary
+ * fields and its geometry, which SetField() and SetGeometry() then reuse,
+ * so a stream of features costs few allocations.
+ *
+ * The pool is not protected against concurrent access, so the features of
+ * a definition with a pool must be created and destroyed by a single
+ * thread.
+ *
+ * The default size is taken from the OGR_FEATURE_POOL_SIZE configuration
+ * option when the definition is created, and is 0 (no pooling) when it is
+ * not set.
+ *
+ * This method is the same as the C function OGR_FD_SetFeaturePoolSize().
+ *
+ * @param nSize the maximum number of features kept, 0 to disable pooling.
+ */
+
+void OGRFeatureDefn::SetFeaturePoolSize( int nSize )
+
+{
+    nFeaturePoolSize = MAX(0,nSize);
+    FlushFeaturePool( nFeaturePoolSize );
+
+    // The pool array is allocated on first use, with the current size.
+    if( papoFeaturePool != NULL )
+        papoFeaturePool = (OGRFeature **) 
+            CPLRealloc( papoFeaturePool, 
+                        sizeof(OGRFeature *) * nFeaturePoolSize );
+}
+
+/************************************************************************/
+/*                     OGR_FD_SetFeaturePoolSize()                      */
+/************************************************************************/
+
+/**
+ * \brief Set the number of destroyed features kept for reuse.
+ *
+ * This function is the same as the C++ method 
+ * OGRFeatureDefn::SetFeaturePoolSize().
+ *
+ * @param hDefn handle to the feature definition.
+ * @param nSize the maximum number of features kept, 0 to disable pooling.
+ */
+
+void OGR_FD_SetFeaturePoolSize( OGRFeatureDefnH hDefn, int nSize )
+
+{
+    VALIDATE_POINTER0( hDefn, "OGR_FD_SetFeaturePoolSize" );
+
+    ((OGRFeatureDefn *) hDefn)->SetFeaturePoolSize( nSize );
+}
+
+/************************************************************************/
+/*                          FlushFeaturePool()                          */
+/*                                                                      */
+/*      Destroy the pooled features beyond the nKeep first ones.        */
+/*      They do not hold a reference on this definition.                */
+/************************************************************************/
+
+void OGRFeatureDefn::FlushFeaturePool( int nKeep )
+
+{
+    while( nPooledFeatureCount > nKeep )
+        delete papoFeaturePool[--nPooledFeatureCount];
+}
+
 /************************************************************************/
 /*                           OGR_FD_Release()                           */
 /************************************************************************/
@@ -334,6 +417,9 @@ OGRFieldDefnH OGR_FD_GetFieldDefn( OGRFeatureDefnH hDefn, int iField )
 void OGRFeatureDefn::AddFieldDefn( OGRFieldDefn * poNewDefn )
 
 {
+    // Pooled features have room for the current fields only.
+    FlushFeaturePool( 0 );
+
     papoFieldDefn = (OGRFieldDefn **)
         CPLRealloc( papoFieldDefn, sizeof(void*)*(nFieldCount+1) );
 
@@ -44,6 +44,10 @@ const char* SpecialFieldNames[SPECIAL_FIELD_COUNT]
 const swq_field_type SpecialFieldTypes[SPECIAL_FIELD_COUNT] 
 = {SWQ_INTEGER, SWQ_STRING, SWQ_STRING, SWQ_STRING, SWQ_FLOAT};
 
+static void *OGRFeatureQueryBuildProgram( swq_expr *psExpr,
+                                          OGRFeatureDefn *poDefn );
+static void  OGRFeatureQueryFreeProgram( void *pProgram );
+
 /************************************************************************/
 /*                          OGRFeatureQuery()                           */
 /************************************************************************/
@@ -53,6 +57,7 @@ OGRFeatureQuery::OGRFeatureQuery()
 {
     poTargetDefn = NULL;
     pSWQExpr = NULL;
+    pProgram = NULL;
 }
 
 /************************************************************************/
@@ -62,6 +67,7 @@ OGRFeatureQuery::OGRFeatureQuery()
 OGRFeatureQuery::~OGRFeatureQuery()
 
 {
+    OGRFeatureQueryFreeProgram( pProgram );
     if( pSWQExpr != NULL )
         swq_expr_free( (swq_expr *) pSWQExpr );
 }
@@ -77,6 +83,9 @@ OGRErr OGRFeatureQuery::Compile( OGRFeatureDefn *poDefn,
 /* -------------------------------------------------------------------- */
 /*      Clear any existing expression.                                  */
 /* -------------------------------------------------------------------- */
+    OGRFeatureQueryFreeProgram( pProgram );
+    pProgram = NULL;
+
     if( pSWQExpr != NULL )
         swq_expr_free( (swq_expr *) pSWQExpr );
 
@@ -145,10 +154,16 @@ OGRErr OGRFeatureQuery::Compile( OGRFeatureDefn *poDefn,
         pSWQExpr = NULL;
     }
 
+/* -------------------------------------------------------------------- */
+/*      Lower the expression tree into a flat program for Evaluate().   */
+/* -------------------------------------------------------------------- */
+    if( pSWQExpr != NULL )
+        pProgram = OGRFeatureQueryBuildProgram( (swq_expr *) pSWQExpr,
+                                                poDefn );
+
     CPLFree( papszFieldNames );
     CPLFree( paeFieldTypes );
 
-
     return eErr;
 }
 
@@ -397,6 +412,488 @@ static int OGRFeatureQueryEvaluator( swq_field_op *op, OGRFeature *poFeature )
     }
 }
 
+/************************************************************************/
+/*                        OGRFeatureQueryProgram                        */
+/*                                                                      */
+/*      The expression tree produced by swq_expr_compile() is           */
+/*      lowered once into a flat list of typed instructions.  Leaf      */
+/*      comparisons carry their field index and pre-converted           */
+/*      constants, and AND/OR become conditional jumps over the         */
+/*      right hand operand so evaluation keeps its short-circuit        */
+/*      behaviour without recursion or a generic callback.  Anything    */
+/*      not handled here (special fields, unexpected operations) is     */
+/*      delegated to OGRFeatureQueryEvaluator() for the node.           */
+/************************************************************************/
+
+typedef enum {
+    OGRFQ_INT_EQ,
+    OGRFQ_INT_NE,
+    OGRFQ_INT_LT,
+    OGRFQ_INT_GT,
+    OGRFQ_INT_LE,
+    OGRFQ_INT_GE,
+    OGRFQ_INT_IN,
+    OGRFQ_REAL_EQ,
+    OGRFQ_REAL_NE,
+    OGRFQ_REAL_LT,
+    OGRFQ_REAL_GT,
+    OGRFQ_REAL_LE,
+    OGRFQ_REAL_GE,
+    OGRFQ_REAL_IN,
+    OGRFQ_STR_EQ,
+    OGRFQ_STR_NE,
+    OGRFQ_STR_LT,
+    OGRFQ_STR_GT,
+    OGRFQ_STR_LE,
+    OGRFQ_STR_GE,
+    OGRFQ_STR_IN,
+    OGRFQ_STR_LIKE,
+    OGRFQ_STR_LIKE_PREFIX,
+    OGRFQ_ISNULL,
+    OGRFQ_GENERIC,
+    OGRFQ_NOT,
+    OGRFQ_JUMP_IF_FALSE,
+    OGRFQ_JUMP_IF_TRUE
+} OGRFeatureQueryOpcode;
+
+typedef struct
+{
+    OGRFeatureQueryOpcode eOpcode;
+    int            iField;
+
+    /* Target instruction of jumps. */
+    int            nJumpTo;
+
+    /* Result of string comparisons against an unset field. */
+    int            bUnsetResult;
+
+    int            nValue;
+    double         dfValue;
+    const char    *pszValue;
+    int            nValueLen;
+
+    /* Pre-converted IN lists. */
+    int            nListCount;
+    int           *panList;
+    double        *padfList;
+    const char   **papszList;
+
+    swq_field_op  *psOp;
+} OGRFeatureQueryInstr;
+
+typedef struct
+{
+    OGRFeatureDefn       *poDefn;
+    int                   nInstrCount;
+    int                   nInstrMax;
+    OGRFeatureQueryInstr *pasInstr;
+} OGRFeatureQueryProgram;
+
+/************************************************************************/
+/*                     OGRFeatureQueryEmitInstr()                       */
+/************************************************************************/
+
+static OGRFeatureQueryInstr *
+OGRFeatureQueryEmitInstr( OGRFeatureQueryProgram *psProgram,
+                          OGRFeatureQueryOpcode eOpcode,
+                          swq_field_op *psOp )
+
+{
+    OGRFeatureQueryInstr *psInstr;
+
+    if( psProgram->nInstrCount == psProgram->nInstrMax )
+    {
+        psProgram->nInstrMax = psProgram->nInstrMax * 2 + 8;
+        psProgram->pasInstr = (OGRFeatureQueryInstr *)
+            CPLRealloc( psProgram->pasInstr,
+                        sizeof(OGRFeatureQueryInstr) * psProgram->nInstrMax );
+    }
+
+    psInstr = psProgram->pasInstr + psProgram->nInstrCount++;
+    memset( psInstr, 0, sizeof(OGRFeatureQueryInstr) );
+    psInstr->eOpcode = eOpcode;
+    psInstr->psOp = psOp;
+    if( psOp != NULL )
+        psInstr->iField = psOp->field_index;
+
+    return psInstr;
+}
+
+/************************************************************************/
+/*                      OGRFeatureQueryLowerLeaf()                      */
+/************************************************************************/
+
+static void OGRFeatureQueryLowerLeaf( OGRFeatureQueryProgram *psProgram,
+                                      swq_field_op *op )
+
+{
+    OGRFeatureQueryInstr *psInstr;
+    int nOpOffset = -1;
+
+/* -------------------------------------------------------------------- */
+/*      Special fields are computed on the fly from the feature, so     */
+/*      leave them to the generic evaluator.                            */
+/* -------------------------------------------------------------------- */
+    if( op->field_index < 0
+        || op->field_index >= psProgram->poDefn->GetFieldCount() )
+    {
+        OGRFeatureQueryEmitInstr( psProgram, OGRFQ_GENERIC, op );
+        return;
+    }
+
+    if( op->operation == SWQ_ISNULL )
+    {
+        OGRFeatureQueryEmitInstr( psProgram, OGRFQ_ISNULL, op );
+        return;
+    }
+
+    switch( op->operation )
+    {
+      case SWQ_EQ: nOpOffset = 0; break;
+      case SWQ_NE: nOpOffset = 1; break;
+      case SWQ_LT: nOpOffset = 2; break;
+      case SWQ_GT: nOpOffset = 3; break;
+      case SWQ_LE: nOpOffset = 4; break;
+      case SWQ_GE: nOpOffset = 5; break;
+      default: break;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Plain comparisons.                                              */
+/* -------------------------------------------------------------------- */
+    if( nOpOffset >= 0
+        && (op->field_type == SWQ_INTEGER || op->field_type == SWQ_FLOAT
+            || op->field_type == SWQ_STRING) )
+    {
+        if( op->field_type == SWQ_INTEGER )
+            psInstr = OGRFeatureQueryEmitInstr(
+                psProgram, (OGRFeatureQueryOpcode) (OGRFQ_INT_EQ + nOpOffset),
+                op );
+        else if( op->field_type == SWQ_FLOAT )
+            psInstr = OGRFeatureQueryEmitInstr(
+                psProgram, (OGRFeatureQueryOpcode) (OGRFQ_REAL_EQ + nOpOffset),
+                op );
+        else
+            psInstr = OGRFeatureQueryEmitInstr(
+                psProgram, (OGRFeatureQueryOpcode) (OGRFQ_STR_EQ + nOpOffset),
+                op );
+
+        psInstr->nValue = op->int_value;
+        psInstr->dfValue = op->float_value;
+        psInstr->pszValue = op->string_value;
+
+        if( op->operation == SWQ_EQ )
+            psInstr->bUnsetResult = (op->string_value[0] == '\0');
+        else
+            psInstr->bUnsetResult = (op->string_value[0] != '\0');
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      IN lists are converted to the field type once.                  */
+/* -------------------------------------------------------------------- */
+    if( op->operation == SWQ_IN
+        && (op->field_type == SWQ_INTEGER || op->field_type == SWQ_FLOAT
+            || op->field_type == SWQ_STRING) )
+    {
+        const char *pszSrc;
+        int nCount = 0;
+
+        for( pszSrc = op->string_value; *pszSrc != '\0';
+             pszSrc += strlen(pszSrc) + 1 )
+            nCount++;
+
+        if( op->field_type == SWQ_INTEGER )
+            psInstr = OGRFeatureQueryEmitInstr( psProgram, OGRFQ_INT_IN, op );
+        else if( op->field_type == SWQ_FLOAT )
+            psInstr = OGRFeatureQueryEmitInstr( psProgram, OGRFQ_REAL_IN, op );
+        else
+            psInstr = OGRFeatureQueryEmitInstr( psProgram, OGRFQ_STR_IN, op );
+
+        psInstr->nListCount = nCount;
+        psInstr->panList = (int *) CPLMalloc(sizeof(int) * (nCount+1));
+        psInstr->padfList = (double *) CPLMalloc(sizeof(double) * (nCount+1));
+        psInstr->papszList = (const char **)
+            CPLMalloc(sizeof(char *) * (nCount+1));
+
+        nCount = 0;
+        for( pszSrc = op->string_value; *pszSrc != '\0';
+             pszSrc += strlen(pszSrc) + 1 )
+        {
+            psInstr->panList[nCount] = atoi(pszSrc);
+            psInstr->padfList[nCount] = atof(pszSrc);
+            psInstr->papszList[nCount] = pszSrc;
+            nCount++;
+        }
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      LIKE.  Patterns that are only a literal prefix followed by a    */
+/*      single trailing '%' (or no wildcard at all) reduce to a         */
+/*      case insensitive string comparison.                             */
+/* -------------------------------------------------------------------- */
+    if( op->operation == SWQ_LIKE && op->field_type == SWQ_STRING )
+    {
+        const char *pszPattern = op->string_value;
+        int nLen = strlen(pszPattern);
+        int nLiteral = strcspn(pszPattern, "%_");
+
+        if( nLiteral == nLen
+            || (nLiteral == nLen - 1 && pszPattern[nLiteral] == '%') )
+        {
+            psInstr = OGRFeatureQueryEmitInstr( psProgram,
+                                                OGRFQ_STR_LIKE_PREFIX, op );
+            psInstr->nValueLen = nLiteral;
+
+            /* Without a trailing '%' the whole input must match. */
+            psInstr->nValue = (nLiteral == nLen);
+        }
+        else
+            psInstr = OGRFeatureQueryEmitInstr( psProgram,
+                                                OGRFQ_STR_LIKE, op );
+
+        psInstr->pszValue = pszPattern;
+        return;
+    }
+
+    OGRFeatureQueryEmitInstr( psProgram, OGRFQ_GENERIC, op );
+}
+
+/************************************************************************/
+/*                      OGRFeatureQueryLowerExpr()                      */
+/************************************************************************/
+
+static void OGRFeatureQueryLowerExpr( OGRFeatureQueryProgram *psProgram,
+                                      swq_expr *psExpr )
+
+{
+    if( psExpr->operation == SWQ_AND || psExpr->operation == SWQ_OR )
+    {
+        int iJump;
+
+        OGRFeatureQueryLowerExpr( psProgram,
+                                  (swq_expr *) psExpr->first_sub_expr );
+
+        OGRFeatureQueryEmitInstr( psProgram,
+                                  psExpr->operation == SWQ_AND ?
+                                  OGRFQ_JUMP_IF_FALSE : OGRFQ_JUMP_IF_TRUE,
+                                  NULL );
+        iJump = psProgram->nInstrCount - 1;
+
+        OGRFeatureQueryLowerExpr( psProgram,
+                                  (swq_expr *) psExpr->second_sub_expr );
+
+        psProgram->pasInstr[iJump].nJumpTo = psProgram->nInstrCount;
+    }
+    else if( psExpr->operation == SWQ_NOT )
+    {
+        OGRFeatureQueryLowerExpr( psProgram,
+                                  (swq_expr *) psExpr->second_sub_expr );
+        OGRFeatureQueryEmitInstr( psProgram, OGRFQ_NOT, NULL );
+    }
+    else
+        OGRFeatureQueryLowerLeaf( psProgram, psExpr );
+}
+
+/************************************************************************/
+/*                    OGRFeatureQueryBuildProgram()                     */
+/************************************************************************/
+
+static void *OGRFeatureQueryBuildProgram( swq_expr *psExpr,
+                                          OGRFeatureDefn *poDefn )
+
+{
+    OGRFeatureQueryProgram *psProgram;
+
+    psProgram = (OGRFeatureQueryProgram *)
+        CPLCalloc( 1, sizeof(OGRFeatureQueryProgram) );
+    psProgram->poDefn = poDefn;
+
+    OGRFeatureQueryLowerExpr( psProgram, psExpr );
+
+    return psProgram;
+}
+
+/************************************************************************/
+/*                     OGRFeatureQueryFreeProgram()                     */
+/************************************************************************/
+
+static void OGRFeatureQueryFreeProgram( void *pProgram )
+
+{
+    OGRFeatureQueryProgram *psProgram = (OGRFeatureQueryProgram *) pProgram;
+    int i;
+
+    if( psProgram == NULL )
+        return;
+
+    for( i = 0; i < psProgram->nInstrCount; i++ )
+    {
+        CPLFree( psProgram->pasInstr[i].panList );
+        CPLFree( psProgram->pasInstr[i].padfList );
+        CPLFree( psProgram->pasInstr[i].papszList );
+    }
+
+    CPLFree( psProgram->pasInstr );
+    CPLFree( psProgram );
+}
+
+/************************************************************************/
+/*                      OGRFeatureQueryRunProgram()                     */
+/************************************************************************/
+
+static int OGRFeatureQueryRunProgram( OGRFeatureQueryProgram *psProgram,
+                                      OGRFeature *poFeature )
+
+{
+    int bResult = FALSE;
+    int iInstr, i;
+
+    for( iInstr = 0; iInstr < psProgram->nInstrCount; iInstr++ )
+    {
+        const OGRFeatureQueryInstr *psInstr = psProgram->pasInstr + iInstr;
+        OGRField *psField;
+        int       bUnset;
+
+        switch( psInstr->eOpcode )
+        {
+          case OGRFQ_JUMP_IF_FALSE:
+            if( !bResult )
+                iInstr = psInstr->nJumpTo - 1;
+            continue;
+
+          case OGRFQ_JUMP_IF_TRUE:
+            if( bResult )
+                iInstr = psInstr->nJumpTo - 1;
+            continue;
+
+          case OGRFQ_NOT:
+            bResult = !bResult;
+            continue;
+
+          case OGRFQ_GENERIC:
+            bResult = OGRFeatureQueryEvaluator( psInstr->psOp, poFeature );
+            continue;
+
+          default:
+            break;
+        }
+
+        psField = poFeature->GetRawFieldRef( psInstr->iField );
+        bUnset = psField->Set.nMarker1 == OGRUnsetMarker
+            && psField->Set.nMarker2 == OGRUnsetMarker;
+
+        switch( psInstr->eOpcode )
+        {
+          case OGRFQ_INT_EQ:
+            bResult = psField->Integer == psInstr->nValue;
+            break;
+          case OGRFQ_INT_NE:
+            bResult = psField->Integer != psInstr->nValue;
+            break;
+          case OGRFQ_INT_LT:
+            bResult = psField->Integer < psInstr->nValue;
+            break;
+          case OGRFQ_INT_GT:
+            bResult = psField->Integer > psInstr->nValue;
+            break;
+          case OGRFQ_INT_LE:
+            bResult = psField->Integer <= psInstr->nValue;
+            break;
+          case OGRFQ_INT_GE:
+            bResult = psField->Integer >= psInstr->nValue;
+            break;
+          case OGRFQ_INT_IN:
+            bResult = FALSE;
+            for( i = 0; i < psInstr->nListCount && !bResult; i++ )
+                bResult = psInstr->panList[i] == psField->Integer;
+            break;
+
+          case OGRFQ_REAL_EQ:
+            bResult = psField->Real == psInstr->dfValue;
+            break;
+          case OGRFQ_REAL_NE:
+            bResult = psField->Real != psInstr->dfValue;
+            break;
+          case OGRFQ_REAL_LT:
+            bResult = psField->Real < psInstr->dfValue;
+            break;
+          case OGRFQ_REAL_GT:
+            bResult = psField->Real > psInstr->dfValue;
+            break;
+          case OGRFQ_REAL_LE:
+            bResult = psField->Real <= psInstr->dfValue;
+            break;
+          case OGRFQ_REAL_GE:
+            bResult = psField->Real >= psInstr->dfValue;
+            break;
+          case OGRFQ_REAL_IN:
+            bResult = FALSE;
+            for( i = 0; i < psInstr->nListCount && !bResult; i++ )
+                bResult = psInstr->padfList[i] == psField->Real;
+            break;
+
+          case OGRFQ_STR_EQ:
+            bResult = bUnset ? psInstr->bUnsetResult
+                : EQUAL(psField->String,psInstr->pszValue);
+            break;
+          case OGRFQ_STR_NE:
+            bResult = bUnset ? psInstr->bUnsetResult
+                : !EQUAL(psField->String,psInstr->pszValue);
+            break;
+          case OGRFQ_STR_LT:
+            bResult = bUnset ? psInstr->bUnsetResult
+                : strcmp(psField->String,psInstr->pszValue) < 0;
+            break;
+          case OGRFQ_STR_GT:
+            bResult = bUnset ? psInstr->bUnsetResult
+                : strcmp(psField->String,psInstr->pszValue) > 0;
+            break;
+          case OGRFQ_STR_LE:
+            bResult = bUnset ? psInstr->bUnsetResult
+                : strcmp(psField->String,psInstr->pszValue) <= 0;
+            break;
+          case OGRFQ_STR_GE:
+            bResult = bUnset ? psInstr->bUnsetResult
+                : strcmp(psField->String,psInstr->pszValue) >= 0;
+            break;
+          case OGRFQ_STR_IN:
+            bResult = FALSE;
+            if( !bUnset )
+            {
+                for( i = 0; i < psInstr->nListCount && !bResult; i++ )
+                    bResult = EQUAL(psInstr->papszList[i],psField->String);
+            }
+            break;
+          case OGRFQ_STR_LIKE:
+            bResult = !bUnset
+                && swq_test_like(psField->String, psInstr->pszValue);
+            break;
+          case OGRFQ_STR_LIKE_PREFIX:
+            if( bUnset )
+                bResult = FALSE;
+            else if( psInstr->nValue )
+                bResult = EQUAL(psField->String,psInstr->pszValue);
+            else
+                bResult = EQUALN(psField->String,psInstr->pszValue,
+                                 psInstr->nValueLen);
+            break;
+
+          case OGRFQ_ISNULL:
+            bResult = bUnset;
+            break;
+
+          default:
+            CPLAssert( FALSE );
+            bResult = FALSE;
+            break;
+        }
+    }
+
+    return bResult;
+}
+
 /************************************************************************/
 /*                              Evaluate()                              */
 /************************************************************************/
@@ -407,75 +904,487 @@ int OGRFeatureQuery::Evaluate( OGRFeature *poFeature )
     if( pSWQExpr == NULL )
         return FALSE;
 
+    if( pProgram != NULL 
+        && ((OGRFeatureQueryProgram *) pProgram)->poDefn 
+                                            == poFeature->GetDefnRef() )
+        return OGRFeatureQueryRunProgram( (OGRFeatureQueryProgram *) pProgram,
+                                          poFeature );
+
     return swq_expr_evaluate( (swq_expr *) pSWQExpr, 
                               (swq_op_evaluator) OGRFeatureQueryEvaluator, 
                               (void *) poFeature );
 }
 
 /************************************************************************/
-/*                       EvaluateAgainstIndices()                       */
+/*                      OGRFeatureQuerySortFIDs()                       */
 /*                                                                      */
-/*      Attempt to return a list of FIDs matching the given             */
-/*      attribute query conditions utilizing attribute indices.         */
-/*      Returns NULL if the result cannot be computed from the          */
-/*      available indices, or an "OGRNullFID" terminated list of        */
-/*      FIDs if it can.                                                 */
+/*      Sort an OGRNullFID terminated FID list in place, removing       */
+/*      duplicates.                                                     */
+/************************************************************************/
+
+static int OGRFeatureQueryCompareFID( const void *p1, const void *p2 )
+{
+    long nFID1 = *(const long *) p1, nFID2 = *(const long *) p2;
+
+    return nFID1 < nFID2 ? -1 : nFID1 > nFID2 ? 1 : 0;
+}
+
+static long *OGRFeatureQuerySortFIDs( long *panFIDs )
+
+{
+    int nCount = 0, i, nOut = 0;
+
+    if( panFIDs == NULL )
+        return NULL;
+
+    while( panFIDs[nCount] != OGRNullFID )
+        nCount++;
+
+    qsort( panFIDs, nCount, sizeof(long), OGRFeatureQueryCompareFID );
+
+    for( i = 0; i < nCount; i++ )
+    {
+        if( nOut == 0 || panFIDs[nOut-1] != panFIDs[i] )
+            panFIDs[nOut++] = panFIDs[i];
+    }
+    panFIDs[nOut] = OGRNullFID;
+
+    return panFIDs;
+}
+
+/************************************************************************/
+/*                      OGRFeatureQueryMergeFIDs()                      */
 /*                                                                      */
-/*      For now we only support equality tests on a single indexed      */
-/*      attribute field.  Eventually we should make this support        */
-/*      multi-part queries with ranges.                                 */
+/*      Intersection or union of two sorted FID lists, which are        */
+/*      freed.                                                          */
 /************************************************************************/
 
-long *OGRFeatureQuery::EvaluateAgainstIndices( OGRLayer *poLayer, 
-                                               OGRErr *peErr )
+static long *OGRFeatureQueryMergeFIDs( long *panFIDs1, long *panFIDs2,
+                                       int bIntersect )
 
 {
-    swq_expr *psExpr = (swq_expr *) pSWQExpr;
-    OGRAttrIndex *poIndex;
+    int nCount1 = 0, nCount2 = 0, i1 = 0, i2 = 0, nOut = 0;
+    long *panResult;
 
-    if( peErr != NULL )
-        *peErr = OGRERR_NONE;
+    while( panFIDs1[nCount1] != OGRNullFID )
+        nCount1++;
+    while( panFIDs2[nCount2] != OGRNullFID )
+        nCount2++;
 
-/* -------------------------------------------------------------------- */
-/*      Does the expression meet our requirements?  Do we have an       */
-/*      index on the targetted field?                                   */
-/* -------------------------------------------------------------------- */
-    if( psExpr == NULL || psExpr->operation != SWQ_EQ 
-        || poLayer->GetIndex() == NULL )
-        return NULL;
+    panResult = (long *) CPLMalloc( sizeof(long) * (nCount1 + nCount2 + 1) );
+
+    while( i1 < nCount1 || i2 < nCount2 )
+    {
+        if( i2 == nCount2 
+            || (i1 < nCount1 && panFIDs1[i1] < panFIDs2[i2]) )
+        {
+            if( !bIntersect )
+                panResult[nOut++] = panFIDs1[i1];
+            i1++;
+        }
+        else if( i1 == nCount1 || panFIDs2[i2] < panFIDs1[i1] )
+        {
+            if( !bIntersect )
+                panResult[nOut++] = panFIDs2[i2];
+            i2++;
+        }
+        else
+        {
+            panResult[nOut++] = panFIDs1[i1];
+            i1++;
+            i2++;
+        }
+    }
+    panResult[nOut] = OGRNullFID;
+
+    CPLFree( panFIDs1 );
+    CPLFree( panFIDs2 );
+
+    return panResult;
+}
+
+/************************************************************************/
+/*                     OGRFeatureQueryMatchesUnset()                    */
+/*                                                                      */
+/*      Can the comparison be true for a feature where the field is     */
+/*      unset?  Such features are not in the indexes.  Unset            */
+/*      integers compare as OGRUnsetMarker, unset strings equal '',     */
+/*      and unset reals never compare equal, less or greater.           */
+/************************************************************************/
+
+static int OGRFeatureQueryMatchesUnset( swq_field_op *op )
+
+{
+    if( op->field_type == SWQ_INTEGER )
+    {
+        switch( op->operation )
+        {
+          case SWQ_EQ: return OGRUnsetMarker == op->int_value;
+          case SWQ_LT: return OGRUnsetMarker < op->int_value;
+          case SWQ_GT: return OGRUnsetMarker > op->int_value;
+          case SWQ_LE: return OGRUnsetMarker <= op->int_value;
+          case SWQ_GE: return OGRUnsetMarker >= op->int_value;
+          case SWQ_IN:
+          {
+              const char *pszSrc;
+
+              for( pszSrc = op->string_value; *pszSrc != '\0';
+                   pszSrc += strlen(pszSrc) + 1 )
+              {
+                  if( atoi(pszSrc) == OGRUnsetMarker )
+                      return TRUE;
+              }
+              return FALSE;
+          }
+          default:
+            return TRUE;
+        }
+    }
+    else if( op->field_type == SWQ_STRING )
+    {
+        if( op->operation == SWQ_EQ )
+            return op->string_value[0] == '\0';
+
+        return op->operation != SWQ_LIKE && op->operation != SWQ_IN;
+    }
+
+    return op->operation == SWQ_NE || op->operation == SWQ_ISNULL;
+}
+
+/************************************************************************/
+/*                      OGRFeatureQueryIndexLeaf()                      */
+/*                                                                      */
+/*      Candidate FIDs of one comparison, from the attribute index      */
+/*      of its field, or NULL if it can't be resolved with it.          */
+/************************************************************************/
+
+static long *OGRFeatureQueryIndexLeaf( swq_field_op *op, OGRLayer *poLayer )
+
+{
+    OGRFeatureDefn *poDefn = poLayer->GetLayerDefn();
+    OGRAttrIndex   *poIndex;
 
-    poIndex = poLayer->GetIndex()->GetFieldIndex( psExpr->field_index );
-    if( poIndex == NULL )
+    if( op->field_index < 0 || op->field_index >= poDefn->GetFieldCount() )
         return NULL;
 
-/* -------------------------------------------------------------------- */
-/*      OK, we have an index, now we need to query it.                  */
-/* -------------------------------------------------------------------- */
-    OGRField sValue;
-    OGRFieldDefn *poFieldDefn;
+    poIndex = poLayer->GetIndex()->GetFieldIndex( op->field_index );
+    if( poIndex == NULL || OGRFeatureQueryMatchesUnset( op ) )
+        return NULL;
 
-    poFieldDefn = poLayer->GetLayerDefn()->GetFieldDefn(psExpr->field_index);
+    OGRFieldType eType = poDefn->GetFieldDefn( op->field_index )->GetType();
+    OGRField     sValue;
+    long        *panFIDs = NULL;
 
-    switch( poFieldDefn->GetType() )
+    switch( eType )
     {
       case OFTInteger:
-        sValue.Integer = psExpr->int_value;
+        sValue.Integer = op->int_value;
         break;
 
       case OFTReal:
-        sValue.Real = psExpr->float_value;
+        sValue.Real = op->float_value;
         break;
 
       case OFTString:
-        sValue.String = psExpr->string_value;
+        sValue.String = op->string_value;
         break;
 
       default:
-        CPLAssert( FALSE );
         return NULL;
     }
 
-    return poIndex->GetAllMatches( &sValue );
+    switch( op->operation )
+    {
+      case SWQ_EQ:
+        panFIDs = poIndex->GetAllMatches( &sValue );
+        break;
+
+/* -------------------------------------------------------------------- */
+/*      Ranges, only on numbers as "<" and ">" on strings are case      */
+/*      sensitive while "=" (and so the index order) is not.            */
+/* -------------------------------------------------------------------- */
+      case SWQ_LT:
+      case SWQ_LE:
+        if( eType != OFTString )
+            panFIDs = poIndex->GetRangeMatches( NULL, FALSE, &sValue,
+                                                op->operation == SWQ_LE );
+        break;
+
+      case SWQ_GT:
+      case SWQ_GE:
+        if( eType != OFTString )
+            panFIDs = poIndex->GetRangeMatches( &sValue, 
+                                                op->operation == SWQ_GE,
+                                                NULL, FALSE );
+        break;
+
+      case SWQ_IN:
+      {
+          const char *pszSrc;
+          int nCount = 0;
+
+          panFIDs = (long *) CPLMalloc( sizeof(long) );
+          panFIDs[0] = OGRNullFID;
+
+          for( pszSrc = op->string_value; *pszSrc != '\0';
+               pszSrc += strlen(pszSrc) + 1 )
+          {
+              long *panMatches;
+              int   nMatches = 0;
+
+              if( eType == OFTInteger )
+                  sValue.Integer = atoi(pszSrc);
+              else if( eType == OFTReal )
+                  sValue.Real = atof(pszSrc);
+              else
+                  sValue.String = (char *) pszSrc;
+
+              panMatches = poIndex->GetAllMatches( &sValue );
+              if( panMatches == NULL )
+              {
+                  CPLFree( panFIDs );
+                  return NULL;
+              }
+
+              while( panMatches[nMatches] != OGRNullFID )
+                  nMatches++;
+
+              panFIDs = (long *) 
+                  CPLRealloc( panFIDs, sizeof(long) * (nCount+nMatches+1) );
+              memcpy( panFIDs + nCount, panMatches, sizeof(long)*nMatches );
+              nCount += nMatches;
+              panFIDs[nCount] = OGRNullFID;
+
+              CPLFree( panMatches );
+          }
+          break;
+      }
+
+/* -------------------------------------------------------------------- */
+/*      LIKE patterns starting with some literal characters.            */
+/* -------------------------------------------------------------------- */
+      case SWQ_LIKE:
+        if( eType == OFTString )
+        {
+            int nPrefixLen = strcspn( op->string_value, "%_" );
+
+            if( nPrefixLen > 0 )
+            {
+                char *pszPrefix = CPLStrdup( op->string_value );
+
+                pszPrefix[nPrefixLen] = '\0';
+                panFIDs = poIndex->GetPrefixMatches( pszPrefix );
+                CPLFree( pszPrefix );
+            }
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return OGRFeatureQuerySortFIDs( panFIDs );
+}
+
+/************************************************************************/
+/*                     OGRFeatureQueryIndexBetween()                    */
+/*                                                                      */
+/*      Candidate FIDs of a lower and an upper bound on the same        */
+/*      numeric field, as in "x >= a AND x < b", read as one range      */
+/*      of its index rather than as the intersection of two.            */
+/************************************************************************/
+
+static long *OGRFeatureQueryIndexBetween( swq_field_op *op1, 
+                                          swq_field_op *op2,
+                                          OGRLayer *poLayer )
+
+{
+    OGRFeatureDefn *poDefn = poLayer->GetLayerDefn();
+
+    if( op1->operation == SWQ_LT || op1->operation == SWQ_LE )
+    {
+        swq_field_op *opTmp = op1;
+        op1 = op2;
+        op2 = opTmp;
+    }
+
+    if( (op1->operation != SWQ_GT && op1->operation != SWQ_GE)
+        || (op2->operation != SWQ_LT && op2->operation != SWQ_LE)
+        || op1->field_index != op2->field_index
+        || op1->field_index < 0 
+        || op1->field_index >= poDefn->GetFieldCount() )
+        return NULL;
+
+    OGRFieldType eType = poDefn->GetFieldDefn( op1->field_index )->GetType();
+    OGRAttrIndex *poIndex = 
+        poLayer->GetIndex()->GetFieldIndex( op1->field_index );
+    OGRField     sMin, sMax;
+
+    if( poIndex == NULL || (OGRFeatureQueryMatchesUnset( op1 )
+                            && OGRFeatureQueryMatchesUnset( op2 )) )
+        return NULL;
+
+    if( eType == OFTInteger )
+    {
+        sMin.Integer = op1->int_value;
+        sMax.Integer = op2->int_value;
+    }
+    else if( eType == OFTReal )
+    {
+        sMin.Real = op1->float_value;
+        sMax.Real = op2->float_value;
+    }
+    else
+        return NULL;
+
+    return OGRFeatureQuerySortFIDs( 
+        poIndex->GetRangeMatches( &sMin, op1->operation == SWQ_GE,
+                                  &sMax, op2->operation == SWQ_LE ) );
+}
+
+static long *OGRFeatureQueryIndexExpr( swq_expr *psExpr, OGRLayer *poLayer );
+
+/************************************************************************/
+/*                   OGRFeatureQueryCollectAndTerms()                   */
+/************************************************************************/
+
+static void OGRFeatureQueryCollectAndTerms( swq_expr *psExpr, 
+                                            swq_expr ***ppapsTerms,
+                                            int *pnTermCount )
+
+{
+    if( psExpr->operation == SWQ_AND )
+    {
+        OGRFeatureQueryCollectAndTerms( (swq_expr *) psExpr->first_sub_expr,
+                                        ppapsTerms, pnTermCount );
+        OGRFeatureQueryCollectAndTerms( (swq_expr *) psExpr->second_sub_expr,
+                                        ppapsTerms, pnTermCount );
+        return;
+    }
+
+    *ppapsTerms = (swq_expr **) 
+        CPLRealloc( *ppapsTerms, sizeof(swq_expr *) * (*pnTermCount + 1) );
+    (*ppapsTerms)[(*pnTermCount)++] = psExpr;
+}
+
+/************************************************************************/
+/*                       OGRFeatureQueryIndexAnd()                      */
+/*                                                                      */
+/*      Intersection of the candidates of the terms of a chain of       */
+/*      ANDs that can be resolved, pairing bounds on the same field     */
+/*      into ranges first.                                              */
+/************************************************************************/
+
+static long *OGRFeatureQueryIndexAnd( swq_expr *psExpr, OGRLayer *poLayer )
+
+{
+    swq_expr **papsTerms = NULL;
+    int        nTermCount = 0, i, j;
+    long      *panResult = NULL;
+
+    OGRFeatureQueryCollectAndTerms( psExpr, &papsTerms, &nTermCount );
+
+    for( i = 0; i < nTermCount; i++ )
+    {
+        long *panFIDs = NULL;
+
+        if( papsTerms[i] == NULL )
+            continue;
+
+        for( j = i + 1; j < nTermCount && panFIDs == NULL; j++ )
+        {
+            if( papsTerms[j] == NULL )
+                continue;
+
+            panFIDs = OGRFeatureQueryIndexBetween( papsTerms[i], papsTerms[j],
+                                                   poLayer );
+            if( panFIDs != NULL )
+                papsTerms[j] = NULL;
+        }
+
+        if( panFIDs == NULL )
+            panFIDs = OGRFeatureQueryIndexExpr( papsTerms[i], poLayer );
+
+        if( panFIDs == NULL )
+            continue;
+        else if( panResult == NULL )
+            panResult = panFIDs;
+        else
+            panResult = OGRFeatureQueryMergeFIDs( panResult, panFIDs, TRUE );
+    }
+
+    CPLFree( papsTerms );
+
+    return panResult;
+}
+
+/************************************************************************/
+/*                      OGRFeatureQueryIndexExpr()                      */
+/************************************************************************/
+
+static long *OGRFeatureQueryIndexExpr( swq_expr *psExpr, OGRLayer *poLayer )
+
+{
+    long *panFIDs1, *panFIDs2;
+
+    switch( psExpr->operation )
+    {
+      case SWQ_AND:
+        return OGRFeatureQueryIndexAnd( psExpr, poLayer );
+
+      case SWQ_OR:
+        panFIDs1 = OGRFeatureQueryIndexExpr( 
+            (swq_expr *) psExpr->first_sub_expr, poLayer );
+        if( panFIDs1 == NULL )
+            return NULL;
+
+        panFIDs2 = OGRFeatureQueryIndexExpr( 
+            (swq_expr *) psExpr->second_sub_expr, poLayer );
+        if( panFIDs2 == NULL )
+        {
+            CPLFree( panFIDs1 );
+            return NULL;
+        }
+
+        return OGRFeatureQueryMergeFIDs( panFIDs1, panFIDs2, FALSE );
+
+      case SWQ_NOT:
+        return NULL;
+
+      default:
+        return OGRFeatureQueryIndexLeaf( psExpr, poLayer );
+    }
+}
+
+/************************************************************************/
+/*                       EvaluateAgainstIndices()                       */
+/*                                                                      */
+/*      Attempt to return a list of FIDs matching the given             */
+/*      attribute query conditions utilizing attribute indices.         */
+/*      Returns NULL if the result cannot be computed from the          */
+/*      available indices, or an "OGRNullFID" terminated list of        */
+/*      FIDs in increasing order if it can.  The list may hold          */
+/*      features that do not match (because of truncated index          */
+/*      keys, or the other terms of an AND), so the query must still    */
+/*      be evaluated on them.                                           */
+/*                                                                      */
+/*      Equality, IN, numeric range and prefix LIKE comparisons on      */
+/*      indexed fields are used, combined through AND and OR.          */
+/************************************************************************/
+
+long *OGRFeatureQuery::EvaluateAgainstIndices( OGRLayer *poLayer, 
+                                               OGRErr *peErr )
+
+{
+    swq_expr *psExpr = (swq_expr *) pSWQExpr;
+
+    if( peErr != NULL )
+        *peErr = OGRERR_NONE;
+
+    if( psExpr == NULL || poLayer->GetIndex() == NULL )
+        return NULL;
+
+    return OGRFeatureQueryIndexExpr( psExpr, poLayer );
 }
 
 /************************************************************************/
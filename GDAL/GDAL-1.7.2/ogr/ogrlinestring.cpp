@@ -502,6 +502,33 @@ void OGRLineString::setPoints( int nPointsIn, OGRRawPoint * paoPointsIn,
 /*                             setPoints()                              */
 /************************************************************************/
 
+/**
+ * \brief Assign all points of another line string.
+ *
+ * The points and Z values of poOtherLine are copied in this line string,
+ * reusing the point arrays already allocated when they are large enough.
+ * The coordinate dimension follows the presence of Z values like in
+ * the other setPoints() methods.
+ *
+ * There is no SFCOM analog to this method.
+ *
+ * @param poOtherLine the line string to copy the points from.
+ */
+
+void OGRLineString::setPoints( const OGRLineString *poOtherLine )
+
+{
+    if( poOtherLine == this )
+        return;
+
+    setPoints( poOtherLine->nPointCount, poOtherLine->paoPoints,
+               poOtherLine->padfZ );
+}
+
+/************************************************************************/
+/*                             setPoints()                              */
+/************************************************************************/
+
 /**
  * \brief Assign all points in a line string.
  *
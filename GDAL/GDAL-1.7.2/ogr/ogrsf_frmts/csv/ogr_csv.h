@@ -79,6 +79,8 @@ class OGRCSVLayer : public OGRLayer
 
     void                ResetReading();
     OGRFeature *        GetNextFeature();
+    virtual int         GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                             int nMaxCount );
 
     OGRFeatureDefn *    GetLayerDefn() { return poFeatureDefn; }
 
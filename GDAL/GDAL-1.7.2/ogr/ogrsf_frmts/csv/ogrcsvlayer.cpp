@@ -290,7 +290,7 @@ OGRFeature * OGRCSVLayer::GetNextUnfilteredFeature()
 /* -------------------------------------------------------------------- */
     OGRFeature *poFeature;
 
-    poFeature = new OGRFeature( poFeatureDefn );
+    poFeature = OGRFeature::CreateFeature( poFeatureDefn );
 
 /* -------------------------------------------------------------------- */
 /*      Set attributes for any indicated attribute records.             */
@@ -362,12 +362,71 @@ OGRFeature *OGRCSVLayer::GetNextFeature()
                 || m_poAttrQuery->Evaluate( poFeature )) )
             break;
 
-        delete poFeature;
+        OGRFeature::DestroyFeature( poFeature );
     }
 
     return poFeature;
 }
 
+/************************************************************************/
+/*                        GetNextFeatureBatch()                         */
+/*                                                                      */
+/*      Without filter, set the batch fields straight from the          */
+/*      tokens of the records.                                          */
+/************************************************************************/
+
+int OGRCSVLayer::GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                      int nMaxCount )
+
+{
+    if( m_poFilterGeom != NULL || m_poAttrQuery != NULL )
+        return OGRLayer::GetNextFeatureBatch( poBatch, nMaxCount );
+
+    if( bNeedRewindBeforeRead )
+        ResetReading();
+
+    poBatch->Reset( poFeatureDefn );
+
+    while( poBatch->GetFeatureCount() < nMaxCount )
+    {
+        char **papszTokens = CSVReadParseLine2( fpCSV, chDelimiter );
+
+        if( papszTokens == NULL )
+            break;
+
+        int iFeature = poBatch->AddFeature( nNextFID++ );
+        int iAttr;
+        int nAttrCount = MIN(CSLCount(papszTokens),
+                             poFeatureDefn->GetFieldCount() );
+
+        for( iAttr = 0; iAttr < nAttrCount; iAttr++ )
+        {
+            if( iAttr == iWktGeomReadField && papszTokens[iAttr][0] != '\0' )
+            {
+                char *pszWKT = papszTokens[iAttr];
+                OGRGeometry *poGeom = NULL;
+
+                if( OGRGeometryFactory::createFromWkt( &pszWKT, NULL, &poGeom )
+                    == OGRERR_NONE )
+                {
+                    poBatch->SetGeometry( iFeature, poGeom );
+                    delete poGeom;
+                }
+            }
+
+            if( papszTokens[iAttr][0] != '\0'
+                || poFeatureDefn->GetFieldDefn(iAttr)->GetType() == OFTString )
+                poBatch->SetField( iFeature, iAttr, papszTokens[iAttr] );
+        }
+
+        CSLDestroy( papszTokens );
+
+        m_nFeaturesRead++;
+    }
+
+    return poBatch->GetFeatureCount();
+}
+
 /************************************************************************/
 /*                           TestCapability()                           */
 /************************************************************************/
@@ -60,6 +60,47 @@ OGRLayerAttrIndex::~OGRLayerAttrIndex()
     pszIndexPath = NULL;
 }
 
+/************************************************************************/
+/*                           UpdateFeature()                            */
+/*                                                                      */
+/*      Called by the layers on every write: replace the entries of     */
+/*      poOldFeature (NULL for a new feature) by those of poNewFeature  */
+/*      (NULL for a deleted feature).  Indexes that cannot remove       */
+/*      entries are dropped, rather than left returning stale FIDs.     */
+/************************************************************************/
+
+OGRErr OGRLayerAttrIndex::UpdateFeature( OGRFeature *poOldFeature,
+                                         OGRFeature *poNewFeature )
+
+{
+    OGRErr eErr = OGRERR_NONE;
+
+    if( poOldFeature != NULL )
+        eErr = RemoveFromIndex( poOldFeature );
+
+    if( eErr == OGRERR_NONE && poNewFeature != NULL )
+        eErr = AddToIndex( poNewFeature );
+
+    if( eErr == OGRERR_NONE )
+        return OGRERR_NONE;
+
+    OGRFeatureDefn *poDefn = poLayer->GetLayerDefn();
+
+    for( int iField = 0; iField < poDefn->GetFieldCount(); iField++ )
+    {
+        if( GetFieldIndex( iField ) == NULL )
+            continue;
+
+        CPLDebug( "OGR", "Dropping index on field %s of layer %s, "
+                  "which cannot be updated.",
+                  poDefn->GetFieldDefn(iField)->GetNameRef(),
+                  poDefn->GetName() );
+        DropIndex( iField );
+    }
+
+    return eErr;
+}
+
 /************************************************************************/
 /* ==================================================================== */
 /*                             OGRAttrIndex                             */
@@ -82,3 +123,35 @@ OGRAttrIndex::OGRAttrIndex()
 OGRAttrIndex::~OGRAttrIndex()
 {
 }
+
+/************************************************************************/
+/*                          GetRangeMatches()                           */
+/*                                                                      */
+/*      Return the FIDs of all entries with keys between psMin and      */
+/*      psMax (either may be NULL for an open range) as an              */
+/*      OGRNullFID terminated list, or NULL if the index does not       */
+/*      support range lookups.                                          */
+/************************************************************************/
+
+long *OGRAttrIndex::GetRangeMatches( OGRField * /*psMin*/, 
+                                     int /*bMinInclusive*/,
+                                     OGRField * /*psMax*/, 
+                                     int /*bMaxInclusive*/ )
+
+{
+    return NULL;
+}
+
+/************************************************************************/
+/*                          GetPrefixMatches()                          */
+/*                                                                      */
+/*      Return the FIDs of all entries of a string index starting       */
+/*      with pszPrefix, compared without regard to case, or NULL if     */
+/*      the index does not support prefix lookups.                      */
+/************************************************************************/
+
+long *OGRAttrIndex::GetPrefixMatches( const char * /*pszPrefix*/ )
+
+{
+    return NULL;
+}
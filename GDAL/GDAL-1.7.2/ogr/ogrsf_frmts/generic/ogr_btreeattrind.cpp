@@ -0,0 +1,1580 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  Implements a generic B-tree attribute index usable with any
+ *           layer, kept in memory and optionally saved to a .obi file.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_attrind.h"
+#include "ogr_spatialind.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+CPL_CVSID("$Id$");
+
+/* The .obi file holds all the indexes of a layer :
+ *
+ *   8 bytes signature "OGRBTI2\0", GIntBig total size and GIntBig latest
+ *   modification time of the files of the layer when the indexes were
+ *   written (see OGRGetSourceStamp()), GInt32 index count, and for each
+ *   index GInt32 field index, GInt32 field type, GInt32 name length,
+ *   the field name, GInt32 entry count, GUInt32 data size, followed by
+ *   the data : the entries in key order, each a GIntBig FID and the key
+ *   (GInt32 for integers, double for reals, GInt32 length and the
+ *   characters for strings).  All values are LSB first.
+ *
+ * Indexes are only read from the file when first used, and the whole
+ * file is rewritten when indexes are created, dropped or modified.  The
+ * file is ignored if the files of the layer were changed since.
+ */
+
+#define OGR_BTREE_SIGNATURE     "OGRBTI2"
+#define OGR_BTREE_NODE_SIZE     128
+
+typedef struct
+{
+    OGRField    sKey;
+    long        nFID;
+} OGRBTreeEntry;
+
+/* Leaves hold up to OGR_BTREE_NODE_SIZE-1 entries and are chained in key
+ * order.  Internal nodes hold up to OGR_BTREE_NODE_SIZE-1 children, and a
+ * copy of the lowest entry of each child in pasEntries. */
+typedef struct OGRBTreeNode_s
+{
+    int                     bLeaf;
+    int                     nCount;
+    OGRBTreeEntry          *pasEntries;
+    struct OGRBTreeNode_s **papoChildren;
+    struct OGRBTreeNode_s  *poNext;
+} OGRBTreeNode;
+
+/************************************************************************/
+/*                          OGRBTreeAttrIndex                           */
+/*                                                                      */
+/*      B-tree of (key, FID) entries for one field.  String keys are    */
+/*      ordered without regard to case, like the "=" and LIKE           */
+/*      operators compare them.                                         */
+/************************************************************************/
+
+class OGRBTreeLayerAttrIndex;
+
+class OGRBTreeAttrIndex : public OGRAttrIndex
+{
+public:
+    OGRBTreeLayerAttrIndex *poLIndex;
+    int           iField;
+    char         *pszFieldName;
+    OGRFieldType  eType;
+
+    OGRBTreeNode *poRoot;
+    int           nEntryCount;
+
+    int           bLoaded;
+    vsi_l_offset  nDataOffset;
+    GUInt32       nDataSize;
+    int           nFileEntryCount;
+
+                OGRBTreeAttrIndex( OGRBTreeLayerAttrIndex *, int iField,
+                                   const char *pszFieldName,
+                                   OGRFieldType eType );
+               ~OGRBTreeAttrIndex();
+
+    int         CompareKey( const OGRField *, const OGRField * );
+    int         CompareEntry( const OGRBTreeEntry *, const OGRBTreeEntry * );
+    void        CopyEntry( OGRBTreeEntry *psDst, const OGRBTreeEntry *psSrc );
+    void        FreeEntry( OGRBTreeEntry * );
+
+    OGRBTreeNode *CreateNode( int bLeaf );
+    void        DestroyNode( OGRBTreeNode * );
+    OGRBTreeNode *InsertEntry( OGRBTreeNode *, OGRBTreeEntry * );
+    OGRBTreeNode *SplitNode( OGRBTreeNode * );
+    OGRBTreeNode *FindKey( const OGRField *psKey, int *piEntry );
+    OGRBTreeNode *GetFirstLeaf();
+
+    void        BulkLoad( OGRBTreeEntry *pasEntries, int nCount );
+    OGRBTreeEntry *ExtractEntries( int *pnCount );
+    OGRErr      Load();
+
+    long       *CollectMatches( OGRField *psMin, int bMinInclusive,
+                                OGRField *psMax, int bMaxInclusive,
+                                const char *pszPrefix );
+
+    long        GetFirstMatch( OGRField *psKey );
+    long       *GetAllMatches( OGRField *psKey );
+    long       *GetRangeMatches( OGRField *psMin, int bMinInclusive,
+                                 OGRField *psMax, int bMaxInclusive );
+    long       *GetPrefixMatches( const char *pszPrefix );
+
+    OGRErr      AddEntry( OGRField *psKey, long nFID );
+    OGRErr      RemoveEntry( OGRField *psKey, long nFID );
+
+    OGRErr      Clear();
+};
+
+/************************************************************************/
+/* ==================================================================== */
+/*                        OGRBTreeLayerAttrIndex                        */
+/*                                                                      */
+/*      B-tree indexes of a layer.  Without an index path the           */
+/*      indexes only live as long as the layer.                         */
+/* ==================================================================== */
+/************************************************************************/
+
+class OGRBTreeLayerAttrIndex : public OGRLayerAttrIndex
+{
+public:
+    int         nIndexCount;
+    OGRBTreeAttrIndex **papoIndexList;
+
+    char        *pszIndexFilename;
+    char        *pszLayerName;
+    int         bDirty;
+
+                OGRBTreeLayerAttrIndex();
+    virtual     ~OGRBTreeLayerAttrIndex();
+
+    /* base class virtual methods */
+    OGRErr      Initialize( const char *pszIndexPath, OGRLayer * );
+    OGRErr      CreateIndex( int iField );
+    OGRErr      DropIndex( int iField );
+    OGRErr      IndexAllFeatures( int iField = -1 );
+
+    OGRErr      AddToIndex( OGRFeature *poFeature, int iField = -1 );
+    OGRErr      RemoveFromIndex( OGRFeature *poFeature );
+
+    OGRAttrIndex *GetFieldIndex( int iField );
+
+    /* custom to OGRBTreeLayerAttrIndex */
+    OGRErr      LoadDirectory();
+    OGRErr      Save();
+    void        AddAttrInd( OGRBTreeAttrIndex * );
+};
+
+/************************************************************************/
+/*                      OGRBTreeLayerAttrIndex()                        */
+/************************************************************************/
+
+OGRBTreeLayerAttrIndex::OGRBTreeLayerAttrIndex()
+
+{
+    nIndexCount = 0;
+    papoIndexList = NULL;
+    pszIndexFilename = NULL;
+    pszLayerName = NULL;
+    bDirty = FALSE;
+}
+
+/************************************************************************/
+/*                      ~OGRBTreeLayerAttrIndex()                       */
+/************************************************************************/
+
+OGRBTreeLayerAttrIndex::~OGRBTreeLayerAttrIndex()
+
+{
+    if( bDirty )
+        Save();
+
+    for( int i = 0; i < nIndexCount; i++ )
+        delete papoIndexList[i];
+    CPLFree( papoIndexList );
+
+    CPLFree( pszIndexFilename );
+    CPLFree( pszLayerName );
+}
+
+/************************************************************************/
+/*                             Initialize()                             */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::Initialize( const char *pszIndexPathIn,
+                                           OGRLayer *poLayerIn )
+
+{
+    if( poLayerIn == poLayer )
+        return OGRERR_NONE;
+
+    poLayer = poLayerIn;
+
+    if( pszIndexPathIn == NULL )
+        return OGRERR_NONE;
+
+    pszIndexPath = CPLStrdup( pszIndexPathIn );
+    pszIndexFilename = CPLStrdup( CPLResetExtension( pszIndexPathIn, "obi" ) );
+    pszLayerName = CPLStrdup( poLayer->GetLayerDefn()->GetName() );
+
+/* -------------------------------------------------------------------- */
+/*      If an index file already exists, read its directory.            */
+/* -------------------------------------------------------------------- */
+    VSIStatBufL sStat;
+
+    if( VSIStatL( pszIndexFilename, &sStat ) == 0 )
+        return LoadDirectory();
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                           LoadDirectory()                            */
+/*                                                                      */
+/*      Read the description of the indexes of the file, leaving       */
+/*      their entries to be read on first use.                          */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::LoadDirectory()
+
+{
+    FILE *fp = VSIFOpenL( pszIndexFilename, "rb" );
+    char  achSignature[8];
+    GInt32 nCount;
+    GIntBig anFileStamp[2], anStamp[2];
+
+    if( fp == NULL )
+        return OGRERR_NONE;
+
+    if( VSIFReadL( achSignature, 8, 1, fp ) != 1
+        || memcmp( achSignature, OGR_BTREE_SIGNATURE, 8 ) != 0
+        || VSIFReadL( anFileStamp, 8, 2, fp ) != 2
+        || VSIFReadL( &nCount, 4, 1, fp ) != 1 )
+    {
+        VSIFCloseL( fp );
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "%s is not an attribute index file.", pszIndexFilename );
+        return OGRERR_FAILURE;
+    }
+    CPL_LSBPTR64( anFileStamp + 0 );
+    CPL_LSBPTR64( anFileStamp + 1 );
+    CPL_LSBPTR32( &nCount );
+
+/* -------------------------------------------------------------------- */
+/*      Ignore the indexes if the layer was modified without them.      */
+/* -------------------------------------------------------------------- */
+    if( !OGRGetSourceStamp( pszIndexPath, pszLayerName, anStamp )
+        || anFileStamp[0] != anStamp[0] || anFileStamp[1] != anStamp[1] )
+    {
+        VSIFCloseL( fp );
+        CPLDebug( "OGR", "Layer %s has changed since %s was written, "
+                  "ignoring its attribute indexes.",
+                  pszLayerName, pszIndexFilename );
+        return OGRERR_NONE;
+    }
+
+    OGRFeatureDefn *poDefn = poLayer->GetLayerDefn();
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        GInt32 anHeader[3], anSizes[2];
+        char  *pszName;
+
+        if( VSIFReadL( anHeader, 4, 3, fp ) != 3 )
+            break;
+        CPL_LSBPTR32( anHeader + 0 );
+        CPL_LSBPTR32( anHeader + 1 );
+        CPL_LSBPTR32( anHeader + 2 );
+
+        if( anHeader[2] < 0 || anHeader[2] > 65536 )
+            break;
+
+        pszName = (char *) CPLCalloc( 1, anHeader[2] + 1 );
+        if( VSIFReadL( pszName, 1, anHeader[2], fp ) != (size_t) anHeader[2]
+            || VSIFReadL( anSizes, 4, 2, fp ) != 2 )
+        {
+            CPLFree( pszName );
+            break;
+        }
+        CPL_LSBPTR32( anSizes + 0 );
+        CPL_LSBPTR32( anSizes + 1 );
+
+        OGRBTreeAttrIndex *poAttrInd =
+            new OGRBTreeAttrIndex( this, anHeader[0], pszName,
+                                   (OGRFieldType) anHeader[1] );
+        poAttrInd->bLoaded = FALSE;
+        poAttrInd->nFileEntryCount = anSizes[0];
+        poAttrInd->nDataSize = (GUInt32) anSizes[1];
+        poAttrInd->nDataOffset = VSIFTellL( fp );
+
+/* -------------------------------------------------------------------- */
+/*      Ignore indexes that no longer match the layer schema.           */
+/* -------------------------------------------------------------------- */
+        if( anHeader[0] < 0 || anHeader[0] >= poDefn->GetFieldCount()
+            || !EQUAL(poDefn->GetFieldDefn(anHeader[0])->GetNameRef(),
+                      pszName)
+            || poDefn->GetFieldDefn(anHeader[0])->GetType()
+                                                    != anHeader[1] )
+        {
+            CPLError( CE_Warning, CPLE_AppDefined,
+                      "Skipping index on field %s of %s, which does not "
+                      "match the layer definition.",
+                      pszName, pszIndexFilename );
+            delete poAttrInd;
+        }
+        else
+            AddAttrInd( poAttrInd );
+
+        CPLFree( pszName );
+
+        VSIFSeekL( fp, VSIFTellL( fp ) + (GUInt32) anSizes[1], SEEK_SET );
+    }
+
+    VSIFCloseL( fp );
+
+    CPLDebug( "OGR", "Found %d field indexes for layer %s in %s.",
+              nIndexCount, poDefn->GetName(), pszIndexFilename );
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                                Save()                                */
+/*                                                                      */
+/*      Rewrite the index file with all our indexes, or remove it       */
+/*      if there are none left.                                         */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::Save()
+
+{
+    int i;
+
+    bDirty = FALSE;
+
+    if( pszIndexFilename == NULL )
+        return OGRERR_NONE;
+
+    if( nIndexCount == 0 )
+    {
+        VSIUnlink( pszIndexFilename );
+        return OGRERR_NONE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Make sure all indexes are in memory before we truncate the      */
+/*      file they may come from.                                        */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < nIndexCount; i++ )
+    {
+        if( papoIndexList[i]->Load() != OGRERR_NONE )
+            return OGRERR_FAILURE;
+    }
+
+    FILE *fp = VSIFOpenL( pszIndexFilename, "wb" );
+    if( fp == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OpenFailed,
+                  "Failed to open `%s' for write.", pszIndexFilename );
+        return OGRERR_FAILURE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Stamp the file with the current state of the layer files.  We   */
+/*      are also saved from the layer destructor, once the driver has   */
+/*      closed them, so the layer itself must not be used here.         */
+/* -------------------------------------------------------------------- */
+    GIntBig anStamp[2];
+    GInt32  nCount = nIndexCount;
+    int     bOK;
+
+    if( !OGRGetSourceStamp( pszIndexPath, pszLayerName, anStamp ) )
+        anStamp[0] = anStamp[1] = -1;
+
+    CPL_LSBPTR64( anStamp + 0 );
+    CPL_LSBPTR64( anStamp + 1 );
+    CPL_LSBPTR32( &nCount );
+    bOK = VSIFWriteL( (void *) OGR_BTREE_SIGNATURE, 8, 1, fp ) == 1
+        && VSIFWriteL( anStamp, 8, 2, fp ) == 2
+        && VSIFWriteL( &nCount, 4, 1, fp ) == 1;
+
+    for( i = 0; i < nIndexCount && bOK; i++ )
+    {
+        OGRBTreeAttrIndex *poAI = papoIndexList[i];
+        const char *pszName = poAI->pszFieldName;
+
+/* -------------------------------------------------------------------- */
+/*      Serialize the entries, walking the leaves in key order.         */
+/* -------------------------------------------------------------------- */
+        GByte  *pabyData = NULL;
+        GUInt32 nDataSize = 0, nDataMax = 0;
+        OGRBTreeNode *poLeaf;
+
+        for( poLeaf = poAI->GetFirstLeaf(); poLeaf != NULL;
+             poLeaf = poLeaf->poNext )
+        {
+            for( int iEntry = 0; iEntry < poLeaf->nCount; iEntry++ )
+            {
+                OGRBTreeEntry *psEntry = poLeaf->pasEntries + iEntry;
+                GInt32  nLength = 0;
+                GUInt32 nNeeded = 8 + 8;
+
+                if( poAI->eType == OFTString )
+                {
+                    nLength = strlen(psEntry->sKey.String);
+                    nNeeded = 8 + 4 + nLength;
+                }
+
+                if( nDataSize + nNeeded > nDataMax )
+                {
+                    nDataMax = nDataMax * 2 + nNeeded + 1024;
+                    pabyData = (GByte *) CPLRealloc( pabyData, nDataMax );
+                }
+
+                GIntBig nFID = psEntry->nFID;
+                CPL_LSBPTR64( &nFID );
+                memcpy( pabyData + nDataSize, &nFID, 8 );
+                nDataSize += 8;
+
+                if( poAI->eType == OFTInteger )
+                {
+                    GInt32 nValue = psEntry->sKey.Integer;
+                    CPL_LSBPTR32( &nValue );
+                    memcpy( pabyData + nDataSize, &nValue, 4 );
+                    nDataSize += 4;
+                }
+                else if( poAI->eType == OFTReal )
+                {
+                    double dfValue = psEntry->sKey.Real;
+                    CPL_LSBPTR64( &dfValue );
+                    memcpy( pabyData + nDataSize, &dfValue, 8 );
+                    nDataSize += 8;
+                }
+                else
+                {
+                    GInt32 nLSBLength = nLength;
+                    CPL_LSBPTR32( &nLSBLength );
+                    memcpy( pabyData + nDataSize, &nLSBLength, 4 );
+                    memcpy( pabyData + nDataSize + 4,
+                            psEntry->sKey.String, nLength );
+                    nDataSize += 4 + nLength;
+                }
+            }
+        }
+
+        GInt32 anHeader[3], anSizes[2];
+
+        anHeader[0] = poAI->iField;
+        anHeader[1] = (GInt32) poAI->eType;
+        anHeader[2] = strlen(pszName);
+        anSizes[0] = poAI->nEntryCount;
+        anSizes[1] = (GInt32) nDataSize;
+        CPL_LSBPTR32( anHeader + 0 );
+        CPL_LSBPTR32( anHeader + 1 );
+        CPL_LSBPTR32( anHeader + 2 );
+        CPL_LSBPTR32( anSizes + 0 );
+        CPL_LSBPTR32( anSizes + 1 );
+
+        bOK = VSIFWriteL( anHeader, 4, 3, fp ) == 3
+            && VSIFWriteL( (void *) pszName, 1, strlen(pszName), fp )
+                                                        == strlen(pszName)
+            && VSIFWriteL( anSizes, 4, 2, fp ) == 2
+            && (nDataSize == 0
+                || VSIFWriteL( pabyData, 1, nDataSize, fp ) == nDataSize);
+
+        CPLFree( pabyData );
+    }
+
+    if( VSIFCloseL( fp ) != 0 )
+        bOK = FALSE;
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to write `%s'.", pszIndexFilename );
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                             AddAttrInd()                             */
+/************************************************************************/
+
+void OGRBTreeLayerAttrIndex::AddAttrInd( OGRBTreeAttrIndex *poAttrInd )
+
+{
+    nIndexCount++;
+    papoIndexList = (OGRBTreeAttrIndex **)
+        CPLRealloc(papoIndexList, sizeof(void*) * nIndexCount);
+
+    papoIndexList[nIndexCount-1] = poAttrInd;
+}
+
+/************************************************************************/
+/*                            CreateIndex()                             */
+/*                                                                      */
+/*      Create an index corresponding to the indicated field, but do    */
+/*      not populate it.  Use IndexAllFeatures() for that.              */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::CreateIndex( int iField )
+
+{
+    OGRFieldDefn *poFldDefn=poLayer->GetLayerDefn()->GetFieldDefn(iField);
+
+    if( GetFieldIndex( iField ) != NULL )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "It seems we already have an index for field %d/%s\n"
+                  "of layer %s.",
+                  iField, poFldDefn->GetNameRef(),
+                  poLayer->GetLayerDefn()->GetName() );
+        return OGRERR_FAILURE;
+    }
+
+    if( poFldDefn->GetType() != OFTInteger
+        && poFldDefn->GetType() != OFTReal
+        && poFldDefn->GetType() != OFTString )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Indexing not support for the field type of field %s.",
+                  poFldDefn->GetNameRef() );
+        return OGRERR_FAILURE;
+    }
+
+    AddAttrInd( new OGRBTreeAttrIndex( this, iField, poFldDefn->GetNameRef(),
+                                       poFldDefn->GetType() ) );
+
+    return Save();
+}
+
+/************************************************************************/
+/*                             DropIndex()                              */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::DropIndex( int iField )
+
+{
+    int i;
+
+    for( i = 0; i < nIndexCount; i++ )
+    {
+        if( papoIndexList[i]->iField == iField )
+            break;
+    }
+
+    if( i == nIndexCount )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "DROP INDEX on field (%s) that doesn't have an index.",
+                  poLayer->GetLayerDefn()->GetFieldDefn(iField)->GetNameRef() );
+        return OGRERR_FAILURE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The other indexes may still have to be read from the file.      */
+/* -------------------------------------------------------------------- */
+    for( int j = 0; j < nIndexCount; j++ )
+    {
+        if( j != i && papoIndexList[j]->Load() != OGRERR_NONE )
+            return OGRERR_FAILURE;
+    }
+
+    delete papoIndexList[i];
+
+    memmove( papoIndexList + i, papoIndexList + i + 1,
+             sizeof(void*) * (nIndexCount - i - 1) );
+    nIndexCount--;
+
+    return Save();
+}
+
+/************************************************************************/
+/*                          OGRBTreeCompare*()                          */
+/*                                                                      */
+/*      qsort() comparators of entries for IndexAllFeatures().          */
+/************************************************************************/
+
+static int OGRBTreeCompareFID( long nFID1, long nFID2 )
+{
+    return nFID1 < nFID2 ? -1 : nFID1 > nFID2 ? 1 : 0;
+}
+
+static int OGRBTreeCompareInteger( const void *p1, const void *p2 )
+{
+    const OGRBTreeEntry *psE1 = (const OGRBTreeEntry *) p1;
+    const OGRBTreeEntry *psE2 = (const OGRBTreeEntry *) p2;
+
+    if( psE1->sKey.Integer != psE2->sKey.Integer )
+        return psE1->sKey.Integer < psE2->sKey.Integer ? -1 : 1;
+    return OGRBTreeCompareFID( psE1->nFID, psE2->nFID );
+}
+
+static int OGRBTreeCompareReal( const void *p1, const void *p2 )
+{
+    const OGRBTreeEntry *psE1 = (const OGRBTreeEntry *) p1;
+    const OGRBTreeEntry *psE2 = (const OGRBTreeEntry *) p2;
+
+    if( psE1->sKey.Real < psE2->sKey.Real )
+        return -1;
+    if( psE1->sKey.Real > psE2->sKey.Real )
+        return 1;
+    return OGRBTreeCompareFID( psE1->nFID, psE2->nFID );
+}
+
+static int OGRBTreeCompareString( const void *p1, const void *p2 )
+{
+    const OGRBTreeEntry *psE1 = (const OGRBTreeEntry *) p1;
+    const OGRBTreeEntry *psE2 = (const OGRBTreeEntry *) p2;
+    int nDiff = STRCASECMP( psE1->sKey.String, psE2->sKey.String );
+
+    if( nDiff != 0 )
+        return nDiff;
+    return OGRBTreeCompareFID( psE1->nFID, psE2->nFID );
+}
+
+/************************************************************************/
+/*                          IndexAllFeatures()                          */
+/*                                                                      */
+/*      Read all the features of the layer, and rebuild the targetted   */
+/*      indexes from their previous entries and the new ones in one     */
+/*      sort and bulk load.                                             */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::IndexAllFeatures( int iTargetField )
+
+{
+    OGRBTreeEntry **papasEntries;
+    int           *panCounts, *panMax;
+    int            i;
+
+/* -------------------------------------------------------------------- */
+/*      Take the current entries of the targetted indexes.              */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < nIndexCount; i++ )
+    {
+        if( (iTargetField == -1 || iTargetField == papoIndexList[i]->iField)
+            && papoIndexList[i]->Load() != OGRERR_NONE )
+            return OGRERR_FAILURE;
+    }
+
+    papasEntries = (OGRBTreeEntry **)
+        CPLCalloc( sizeof(OGRBTreeEntry *), nIndexCount + 1 );
+    panCounts = (int *) CPLCalloc( sizeof(int), nIndexCount + 1 );
+    panMax = (int *) CPLCalloc( sizeof(int), nIndexCount + 1 );
+
+    for( i = 0; i < nIndexCount; i++ )
+    {
+        OGRBTreeAttrIndex *poAI = papoIndexList[i];
+
+        if( iTargetField != -1 && iTargetField != poAI->iField )
+            continue;
+
+        papasEntries[i] = poAI->ExtractEntries( panCounts + i );
+        panMax[i] = panCounts[i];
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Collect the new entries.                                        */
+/* -------------------------------------------------------------------- */
+    OGRFeature *poFeature;
+    OGRErr      eErr = OGRERR_NONE;
+
+    poLayer->ResetReading();
+
+    while( (poFeature = poLayer->GetNextFeature()) != NULL )
+    {
+        if( poFeature->GetFID() == OGRNullFID )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Attempt to index feature with no FID." );
+            delete poFeature;
+            eErr = OGRERR_FAILURE;
+            break;
+        }
+
+        for( i = 0; i < nIndexCount; i++ )
+        {
+            OGRBTreeAttrIndex *poAI = papoIndexList[i];
+            OGRField *psField = poFeature->GetRawFieldRef( poAI->iField );
+
+            if( iTargetField != -1 && iTargetField != poAI->iField )
+                continue;
+
+            if( !poFeature->IsFieldSet( poAI->iField )
+                || (poAI->eType == OFTReal && CPLIsNan(psField->Real)) )
+                continue;
+
+            if( panCounts[i] == panMax[i] )
+            {
+                panMax[i] = panMax[i] * 2 + 1024;
+                papasEntries[i] = (OGRBTreeEntry *)
+                    CPLRealloc( papasEntries[i],
+                                sizeof(OGRBTreeEntry) * panMax[i] );
+            }
+
+            OGRBTreeEntry *psEntry = papasEntries[i] + panCounts[i]++;
+
+            memset( psEntry, 0, sizeof(OGRBTreeEntry) );
+            psEntry->nFID = poFeature->GetFID();
+            if( poAI->eType == OFTString )
+                psEntry->sKey.String = CPLStrdup( psField->String );
+            else
+                psEntry->sKey = *psField;
+        }
+
+        delete poFeature;
+    }
+
+    poLayer->ResetReading();
+
+/* -------------------------------------------------------------------- */
+/*      Sort, and rebuild the trees.                                    */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < nIndexCount; i++ )
+    {
+        OGRBTreeAttrIndex *poAI = papoIndexList[i];
+
+        if( iTargetField != -1 && iTargetField != poAI->iField )
+            continue;
+
+        if( poAI->eType == OFTInteger )
+            qsort( papasEntries[i], panCounts[i], sizeof(OGRBTreeEntry),
+                   OGRBTreeCompareInteger );
+        else if( poAI->eType == OFTReal )
+            qsort( papasEntries[i], panCounts[i], sizeof(OGRBTreeEntry),
+                   OGRBTreeCompareReal );
+        else
+            qsort( papasEntries[i], panCounts[i], sizeof(OGRBTreeEntry),
+                   OGRBTreeCompareString );
+
+        poAI->BulkLoad( papasEntries[i], panCounts[i] );
+        CPLFree( papasEntries[i] );
+    }
+
+    CPLFree( papasEntries );
+    CPLFree( panCounts );
+    CPLFree( panMax );
+
+    if( eErr != OGRERR_NONE )
+        return eErr;
+
+    return Save();
+}
+
+/************************************************************************/
+/*                            GetFieldIndex()                           */
+/************************************************************************/
+
+OGRAttrIndex *OGRBTreeLayerAttrIndex::GetFieldIndex( int iField )
+
+{
+    for( int i = 0; i < nIndexCount; i++ )
+    {
+        if( papoIndexList[i]->iField == iField )
+            return papoIndexList[i];
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                             AddToIndex()                             */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::AddToIndex( OGRFeature *poFeature,
+                                           int iTargetField )
+
+{
+    OGRErr eErr = OGRERR_NONE;
+
+    if( poFeature->GetFID() == OGRNullFID )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Attempt to index feature with no FID." );
+        return OGRERR_FAILURE;
+    }
+
+    for( int i = 0; i < nIndexCount && eErr == OGRERR_NONE; i++ )
+    {
+        int iField = papoIndexList[i]->iField;
+
+        if( iTargetField != -1 && iTargetField != iField )
+            continue;
+
+        if( !poFeature->IsFieldSet( iField ) )
+            continue;
+
+        eErr =
+            papoIndexList[i]->AddEntry( poFeature->GetRawFieldRef( iField ),
+                                        poFeature->GetFID() );
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                          RemoveFromIndex()                           */
+/************************************************************************/
+
+OGRErr OGRBTreeLayerAttrIndex::RemoveFromIndex( OGRFeature *poFeature )
+
+{
+    OGRErr eErr = OGRERR_NONE;
+
+    for( int i = 0; i < nIndexCount && eErr == OGRERR_NONE; i++ )
+    {
+        int iField = papoIndexList[i]->iField;
+
+        if( !poFeature->IsFieldSet( iField ) )
+            continue;
+
+        eErr =
+            papoIndexList[i]->RemoveEntry( poFeature->GetRawFieldRef(iField),
+                                           poFeature->GetFID() );
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                     OGRCreateDefaultLayerIndex()                     */
+/************************************************************************/
+
+OGRLayerAttrIndex *OGRCreateDefaultLayerIndex()
+
+{
+    return new OGRBTreeLayerAttrIndex();
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                          OGRBTreeAttrIndex                           */
+/* ==================================================================== */
+/************************************************************************/
+
+/* class declared at top of file */
+
+/************************************************************************/
+/*                         OGRBTreeAttrIndex()                          */
+/************************************************************************/
+
+OGRBTreeAttrIndex::OGRBTreeAttrIndex( OGRBTreeLayerAttrIndex *poLayerIndex,
+                                      int iFieldIn,
+                                      const char *pszFieldNameIn,
+                                      OGRFieldType eTypeIn )
+
+{
+    poLIndex = poLayerIndex;
+    iField = iFieldIn;
+    pszFieldName = CPLStrdup( pszFieldNameIn );
+    eType = eTypeIn;
+
+    poRoot = CreateNode( TRUE );
+    nEntryCount = 0;
+
+    bLoaded = TRUE;
+    nDataOffset = 0;
+    nDataSize = 0;
+    nFileEntryCount = 0;
+}
+
+/************************************************************************/
+/*                         ~OGRBTreeAttrIndex()                         */
+/************************************************************************/
+
+OGRBTreeAttrIndex::~OGRBTreeAttrIndex()
+
+{
+    DestroyNode( poRoot );
+    CPLFree( pszFieldName );
+}
+
+/************************************************************************/
+/*                             CompareKey()                             */
+/************************************************************************/
+
+int OGRBTreeAttrIndex::CompareKey( const OGRField *psKey1,
+                                   const OGRField *psKey2 )
+
+{
+    if( eType == OFTInteger )
+    {
+        if( psKey1->Integer == psKey2->Integer )
+            return 0;
+        return psKey1->Integer < psKey2->Integer ? -1 : 1;
+    }
+    else if( eType == OFTReal )
+    {
+        if( psKey1->Real < psKey2->Real )
+            return -1;
+        return psKey1->Real > psKey2->Real ? 1 : 0;
+    }
+    else
+        return STRCASECMP( psKey1->String, psKey2->String );
+}
+
+/************************************************************************/
+/*                            CompareEntry()                            */
+/************************************************************************/
+
+int OGRBTreeAttrIndex::CompareEntry( const OGRBTreeEntry *psEntry1,
+                                     const OGRBTreeEntry *psEntry2 )
+
+{
+    int nDiff = CompareKey( &(psEntry1->sKey), &(psEntry2->sKey) );
+
+    if( nDiff != 0 )
+        return nDiff;
+
+    return OGRBTreeCompareFID( psEntry1->nFID, psEntry2->nFID );
+}
+
+/************************************************************************/
+/*                        CopyEntry() / FreeEntry()                     */
+/************************************************************************/
+
+void OGRBTreeAttrIndex::CopyEntry( OGRBTreeEntry *psDst,
+                                   const OGRBTreeEntry *psSrc )
+
+{
+    *psDst = *psSrc;
+    if( eType == OFTString )
+        psDst->sKey.String = CPLStrdup( psSrc->sKey.String );
+}
+
+void OGRBTreeAttrIndex::FreeEntry( OGRBTreeEntry *psEntry )
+
+{
+    if( eType == OFTString )
+        CPLFree( psEntry->sKey.String );
+}
+
+/************************************************************************/
+/*                      CreateNode() / DestroyNode()                    */
+/************************************************************************/
+
+OGRBTreeNode *OGRBTreeAttrIndex::CreateNode( int bLeaf )
+
+{
+    OGRBTreeNode *poNode = (OGRBTreeNode *) CPLCalloc(sizeof(OGRBTreeNode),1);
+
+    poNode->bLeaf = bLeaf;
+    poNode->pasEntries = (OGRBTreeEntry *)
+        CPLMalloc( sizeof(OGRBTreeEntry) * OGR_BTREE_NODE_SIZE );
+    if( !bLeaf )
+        poNode->papoChildren = (OGRBTreeNode **)
+            CPLMalloc( sizeof(OGRBTreeNode *) * OGR_BTREE_NODE_SIZE );
+
+    return poNode;
+}
+
+void OGRBTreeAttrIndex::DestroyNode( OGRBTreeNode *poNode )
+
+{
+    for( int i = 0; i < poNode->nCount; i++ )
+    {
+        FreeEntry( poNode->pasEntries + i );
+        if( !poNode->bLeaf )
+            DestroyNode( poNode->papoChildren[i] );
+    }
+
+    CPLFree( poNode->pasEntries );
+    CPLFree( poNode->papoChildren );
+    CPLFree( poNode );
+}
+
+/************************************************************************/
+/*                             SplitNode()                              */
+/*                                                                      */
+/*      Move the upper half of a full node into a new right sibling.    */
+/************************************************************************/
+
+OGRBTreeNode *OGRBTreeAttrIndex::SplitNode( OGRBTreeNode *poNode )
+
+{
+    OGRBTreeNode *poSibling = CreateNode( poNode->bLeaf );
+    int nKeep = poNode->nCount / 2;
+
+    poSibling->nCount = poNode->nCount - nKeep;
+    memcpy( poSibling->pasEntries, poNode->pasEntries + nKeep,
+            sizeof(OGRBTreeEntry) * poSibling->nCount );
+    if( !poNode->bLeaf )
+        memcpy( poSibling->papoChildren, poNode->papoChildren + nKeep,
+                sizeof(OGRBTreeNode *) * poSibling->nCount );
+    poNode->nCount = nKeep;
+
+    if( poNode->bLeaf )
+    {
+        poSibling->poNext = poNode->poNext;
+        poNode->poNext = poSibling;
+    }
+
+    return poSibling;
+}
+
+/************************************************************************/
+/*                            InsertEntry()                             */
+/*                                                                      */
+/*      Insert an entry (taking ownership of its string) below          */
+/*      poNode, returning the new right sibling of poNode if it had     */
+/*      to be split.                                                    */
+/************************************************************************/
+
+OGRBTreeNode *OGRBTreeAttrIndex::InsertEntry( OGRBTreeNode *poNode,
+                                              OGRBTreeEntry *psEntry )
+
+{
+    int nLow = 0, nHigh = poNode->nCount;
+
+/* -------------------------------------------------------------------- */
+/*      Find the first entry greater than the new one.                  */
+/* -------------------------------------------------------------------- */
+    while( nLow < nHigh )
+    {
+        int nMid = (nLow + nHigh) / 2;
+
+        if( CompareEntry( poNode->pasEntries + nMid, psEntry ) <= 0 )
+            nLow = nMid + 1;
+        else
+            nHigh = nMid;
+    }
+
+    if( poNode->bLeaf )
+    {
+        memmove( poNode->pasEntries + nLow + 1, poNode->pasEntries + nLow,
+                 sizeof(OGRBTreeEntry) * (poNode->nCount - nLow) );
+        poNode->pasEntries[nLow] = *psEntry;
+        poNode->nCount++;
+    }
+    else
+    {
+        int iChild = MAX(nLow - 1, 0);
+        OGRBTreeNode *poNewChild;
+
+        if( nLow == 0 )
+        {
+            /* New lowest entry of the subtree. */
+            FreeEntry( poNode->pasEntries + 0 );
+            CopyEntry( poNode->pasEntries + 0, psEntry );
+        }
+
+        poNewChild = InsertEntry( poNode->papoChildren[iChild], psEntry );
+        if( poNewChild == NULL )
+            return NULL;
+
+        memmove( poNode->pasEntries + iChild + 2,
+                 poNode->pasEntries + iChild + 1,
+                 sizeof(OGRBTreeEntry) * (poNode->nCount - iChild - 1) );
+        memmove( poNode->papoChildren + iChild + 2,
+                 poNode->papoChildren + iChild + 1,
+                 sizeof(OGRBTreeNode *) * (poNode->nCount - iChild - 1) );
+        CopyEntry( poNode->pasEntries + iChild + 1,
+                   poNewChild->pasEntries + 0 );
+        poNode->papoChildren[iChild + 1] = poNewChild;
+        poNode->nCount++;
+    }
+
+    if( poNode->nCount == OGR_BTREE_NODE_SIZE )
+        return SplitNode( poNode );
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                              FindKey()                               */
+/*                                                                      */
+/*      Find the first entry whose key is not less than psKey,          */
+/*      returning its leaf and position.  The position may be the       */
+/*      end of the leaf, in which case the entry is in a later leaf.    */
+/************************************************************************/
+
+OGRBTreeNode *OGRBTreeAttrIndex::FindKey( const OGRField *psKey,
+                                          int *piEntry )
+
+{
+    OGRBTreeNode *poNode = poRoot;
+
+    while( TRUE )
+    {
+        int nLow = poNode->bLeaf ? 0 : 1, nHigh = poNode->nCount;
+
+        while( nLow < nHigh )
+        {
+            int nMid = (nLow + nHigh) / 2;
+
+            if( CompareKey( &(poNode->pasEntries[nMid].sKey), psKey ) < 0 )
+                nLow = nMid + 1;
+            else
+                nHigh = nMid;
+        }
+
+        if( poNode->bLeaf )
+        {
+            *piEntry = nLow;
+            return poNode;
+        }
+
+        poNode = poNode->papoChildren[nLow - 1];
+    }
+}
+
+/************************************************************************/
+/*                            GetFirstLeaf()                            */
+/************************************************************************/
+
+OGRBTreeNode *OGRBTreeAttrIndex::GetFirstLeaf()
+
+{
+    OGRBTreeNode *poNode = poRoot;
+
+    while( !poNode->bLeaf )
+        poNode = poNode->papoChildren[0];
+
+    return poNode;
+}
+
+/************************************************************************/
+/*                              BulkLoad()                              */
+/*                                                                      */
+/*      Replace the tree with one built bottom up from sorted           */
+/*      entries, taking ownership of their strings.                     */
+/************************************************************************/
+
+void OGRBTreeAttrIndex::BulkLoad( OGRBTreeEntry *pasEntries, int nCount )
+
+{
+    const int nFill = OGR_BTREE_NODE_SIZE - 1;
+    OGRBTreeNode **papoLevel;
+    int nLevelCount = 0, i;
+
+    DestroyNode( poRoot );
+    nEntryCount = nCount;
+
+    if( nCount == 0 )
+    {
+        poRoot = CreateNode( TRUE );
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Fill the leaves.                                                */
+/* -------------------------------------------------------------------- */
+    papoLevel = (OGRBTreeNode **)
+        CPLMalloc( sizeof(OGRBTreeNode *) * (nCount / nFill + 1) );
+
+    for( i = 0; i < nCount; i += nFill )
+    {
+        OGRBTreeNode *poLeaf = CreateNode( TRUE );
+
+        poLeaf->nCount = MIN(nFill, nCount - i);
+        memcpy( poLeaf->pasEntries, pasEntries + i,
+                sizeof(OGRBTreeEntry) * poLeaf->nCount );
+
+        if( nLevelCount > 0 )
+            papoLevel[nLevelCount-1]->poNext = poLeaf;
+        papoLevel[nLevelCount++] = poLeaf;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Build the internal levels up to a single root.                  */
+/* -------------------------------------------------------------------- */
+    while( nLevelCount > 1 )
+    {
+        int nParentCount = 0;
+
+        for( i = 0; i < nLevelCount; i += nFill )
+        {
+            OGRBTreeNode *poParent = CreateNode( FALSE );
+
+            poParent->nCount = MIN(nFill, nLevelCount - i);
+            for( int j = 0; j < poParent->nCount; j++ )
+            {
+                poParent->papoChildren[j] = papoLevel[i + j];
+                CopyEntry( poParent->pasEntries + j,
+                           papoLevel[i + j]->pasEntries + 0 );
+            }
+
+            papoLevel[nParentCount++] = poParent;
+        }
+
+        nLevelCount = nParentCount;
+    }
+
+    poRoot = papoLevel[0];
+    CPLFree( papoLevel );
+}
+
+/************************************************************************/
+/*                           ExtractEntries()                           */
+/*                                                                      */
+/*      Return all entries in key order, handing over their strings,    */
+/*      and empty the tree.                                             */
+/************************************************************************/
+
+OGRBTreeEntry *OGRBTreeAttrIndex::ExtractEntries( int *pnCount )
+
+{
+    OGRBTreeEntry *pasEntries;
+    OGRBTreeNode *poLeaf;
+    int nCount = 0;
+
+    pasEntries = (OGRBTreeEntry *)
+        CPLMalloc( sizeof(OGRBTreeEntry) * (nEntryCount + 1) );
+
+    for( poLeaf = GetFirstLeaf(); poLeaf != NULL; poLeaf = poLeaf->poNext )
+    {
+        memcpy( pasEntries + nCount, poLeaf->pasEntries,
+                sizeof(OGRBTreeEntry) * poLeaf->nCount );
+        nCount += poLeaf->nCount;
+        poLeaf->nCount = 0;
+    }
+
+    BulkLoad( NULL, 0 );
+
+    *pnCount = nCount;
+    return pasEntries;
+}
+
+/************************************************************************/
+/*                                Load()                                */
+/*                                                                      */
+/*      Read the entries of the index from the file, if not done yet.   */
+/************************************************************************/
+
+OGRErr OGRBTreeAttrIndex::Load()
+
+{
+    if( bLoaded )
+        return OGRERR_NONE;
+
+    bLoaded = TRUE;
+
+    FILE *fp = VSIFOpenL( poLIndex->pszIndexFilename, "rb" );
+    GByte *pabyData = (GByte *) VSIMalloc( nDataSize + 1 );
+
+    if( fp == NULL || pabyData == NULL
+        || VSIFSeekL( fp, nDataOffset, SEEK_SET ) != 0
+        || VSIFReadL( pabyData, 1, nDataSize, fp ) != nDataSize )
+    {
+        if( fp != NULL )
+            VSIFCloseL( fp );
+        CPLFree( pabyData );
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to read index of field %d from %s.",
+                  iField, poLIndex->pszIndexFilename );
+        return OGRERR_FAILURE;
+    }
+
+    VSIFCloseL( fp );
+
+/* -------------------------------------------------------------------- */
+/*      Decode the entries, which are already in key order.             */
+/* -------------------------------------------------------------------- */
+    OGRBTreeEntry *pasEntries = (OGRBTreeEntry *)
+        VSICalloc( sizeof(OGRBTreeEntry), nFileEntryCount + 1 );
+    GUInt32 nOffset = 0;
+    int     nCount = 0;
+
+    while( pasEntries != NULL && nCount < nFileEntryCount )
+    {
+        OGRBTreeEntry *psEntry = pasEntries + nCount;
+        GIntBig nFID;
+
+        if( nOffset + 8 > nDataSize )
+            break;
+        memcpy( &nFID, pabyData + nOffset, 8 );
+        CPL_LSBPTR64( &nFID );
+        psEntry->nFID = (long) nFID;
+        nOffset += 8;
+
+        if( eType == OFTInteger )
+        {
+            if( nOffset + 4 > nDataSize )
+                break;
+            memcpy( &(psEntry->sKey.Integer), pabyData + nOffset, 4 );
+            CPL_LSBPTR32( &(psEntry->sKey.Integer) );
+            nOffset += 4;
+        }
+        else if( eType == OFTReal )
+        {
+            if( nOffset + 8 > nDataSize )
+                break;
+            memcpy( &(psEntry->sKey.Real), pabyData + nOffset, 8 );
+            CPL_LSBPTR64( &(psEntry->sKey.Real) );
+            nOffset += 8;
+        }
+        else
+        {
+            GInt32 nLength;
+
+            if( nOffset + 4 > nDataSize )
+                break;
+            memcpy( &nLength, pabyData + nOffset, 4 );
+            CPL_LSBPTR32( &nLength );
+            nOffset += 4;
+            if( nLength < 0 || nOffset + nLength > nDataSize )
+                break;
+
+            psEntry->sKey.String = (char *) CPLMalloc( nLength + 1 );
+            memcpy( psEntry->sKey.String, pabyData + nOffset, nLength );
+            psEntry->sKey.String[nLength] = '\0';
+            nOffset += nLength;
+        }
+
+        nCount++;
+    }
+
+    CPLFree( pabyData );
+
+    if( pasEntries == NULL || nCount < nFileEntryCount )
+    {
+        if( pasEntries != NULL )
+        {
+            for( int i = 0; i < nCount; i++ )
+                FreeEntry( pasEntries + i );
+            CPLFree( pasEntries );
+        }
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Corrupt index of field %d in %s.",
+                  iField, poLIndex->pszIndexFilename );
+        return OGRERR_FAILURE;
+    }
+
+    BulkLoad( pasEntries, nCount );
+    CPLFree( pasEntries );
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                           CollectMatches()                           */
+/*                                                                      */
+/*      Walk the leaves from the first entry not less than psMin (or    */
+/*      the first entry) collecting FIDs while the keys are within      */
+/*      psMax, or start with pszPrefix.                                 */
+/************************************************************************/
+
+long *OGRBTreeAttrIndex::CollectMatches( OGRField *psMin, int bMinInclusive,
+                                         OGRField *psMax, int bMaxInclusive,
+                                         const char *pszPrefix )
+
+{
+    long *panFIDList;
+    int   nFIDCount = 0, nFIDMax = 16;
+
+    if( Load() != OGRERR_NONE )
+        return NULL;
+
+    panFIDList = (long *) CPLMalloc(sizeof(long) * nFIDMax);
+
+    OGRBTreeNode *poLeaf;
+    int iEntry = 0;
+    size_t nPrefixLen = pszPrefix ? strlen(pszPrefix) : 0;
+
+    if( psMin != NULL )
+        poLeaf = FindKey( psMin, &iEntry );
+    else
+        poLeaf = GetFirstLeaf();
+
+    for( ; poLeaf != NULL; poLeaf = poLeaf->poNext, iEntry = 0 )
+    {
+        for( ; iEntry < poLeaf->nCount; iEntry++ )
+        {
+            OGRBTreeEntry *psEntry = poLeaf->pasEntries + iEntry;
+
+            if( psMin != NULL && !bMinInclusive
+                && CompareKey( &(psEntry->sKey), psMin ) == 0 )
+                continue;
+
+            if( psMax != NULL )
+            {
+                int nDiff = CompareKey( &(psEntry->sKey), psMax );
+
+                if( nDiff > 0 || (nDiff == 0 && !bMaxInclusive) )
+                    break;
+            }
+
+            if( pszPrefix != NULL
+                && !EQUALN(psEntry->sKey.String, pszPrefix, nPrefixLen) )
+                break;
+
+            if( nFIDCount >= nFIDMax-1 )
+            {
+                nFIDMax = nFIDMax * 2 + 10;
+                panFIDList = (long *)
+                    CPLRealloc(panFIDList, sizeof(long)*nFIDMax);
+            }
+            panFIDList[nFIDCount++] = psEntry->nFID;
+        }
+
+        if( iEntry < poLeaf->nCount )
+            break;
+    }
+
+    panFIDList[nFIDCount] = OGRNullFID;
+
+    return panFIDList;
+}
+
+/************************************************************************/
+/*                           GetFirstMatch()                            */
+/************************************************************************/
+
+long OGRBTreeAttrIndex::GetFirstMatch( OGRField *psKey )
+
+{
+    long *panFIDList = CollectMatches( psKey, TRUE, psKey, TRUE, NULL );
+    long  nFID = OGRNullFID;
+
+    if( panFIDList != NULL )
+        nFID = panFIDList[0];
+    CPLFree( panFIDList );
+
+    return nFID;
+}
+
+/************************************************************************/
+/*                           GetAllMatches()                            */
+/************************************************************************/
+
+long *OGRBTreeAttrIndex::GetAllMatches( OGRField *psKey )
+
+{
+    return CollectMatches( psKey, TRUE, psKey, TRUE, NULL );
+}
+
+/************************************************************************/
+/*                          GetRangeMatches()                           */
+/************************************************************************/
+
+long *OGRBTreeAttrIndex::GetRangeMatches( OGRField *psMin, int bMinInclusive,
+                                          OGRField *psMax, int bMaxInclusive )
+
+{
+    return CollectMatches( psMin, bMinInclusive, psMax, bMaxInclusive, NULL );
+}
+
+/************************************************************************/
+/*                          GetPrefixMatches()                          */
+/************************************************************************/
+
+long *OGRBTreeAttrIndex::GetPrefixMatches( const char *pszPrefix )
+
+{
+    OGRField sKey;
+
+    if( eType != OFTString )
+        return NULL;
+
+    sKey.String = (char *) pszPrefix;
+
+    return CollectMatches( &sKey, TRUE, NULL, FALSE, pszPrefix );
+}
+
+/************************************************************************/
+/*                              AddEntry()                              */
+/************************************************************************/
+
+OGRErr OGRBTreeAttrIndex::AddEntry( OGRField *psKey, long nFID )
+
+{
+    OGRBTreeEntry sEntry;
+
+    if( psKey == NULL || Load() != OGRERR_NONE )
+        return OGRERR_FAILURE;
+
+    /* NaN does not compare to anything, so never matches a query. */
+    if( eType == OFTReal && CPLIsNan(psKey->Real) )
+        return OGRERR_NONE;
+
+    sEntry.nFID = nFID;
+    sEntry.sKey = *psKey;
+    if( eType == OFTString )
+        sEntry.sKey.String = CPLStrdup( psKey->String );
+
+    OGRBTreeNode *poSibling = InsertEntry( poRoot, &sEntry );
+
+    if( poSibling != NULL )
+    {
+        OGRBTreeNode *poNewRoot = CreateNode( FALSE );
+
+        poNewRoot->nCount = 2;
+        poNewRoot->papoChildren[0] = poRoot;
+        poNewRoot->papoChildren[1] = poSibling;
+        CopyEntry( poNewRoot->pasEntries + 0, poRoot->pasEntries + 0 );
+        CopyEntry( poNewRoot->pasEntries + 1, poSibling->pasEntries + 0 );
+        poRoot = poNewRoot;
+    }
+
+    nEntryCount++;
+    poLIndex->bDirty = TRUE;
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                            RemoveEntry()                             */
+/*                                                                      */
+/*      Leaves are not merged when they underflow : the lowest          */
+/*      entries kept in the internal nodes remain valid bounds.         */
+/************************************************************************/
+
+OGRErr OGRBTreeAttrIndex::RemoveEntry( OGRField *psKey, long nFID )
+
+{
+    if( psKey == NULL || Load() != OGRERR_NONE )
+        return OGRERR_FAILURE;
+
+    OGRBTreeNode *poLeaf;
+    int iEntry;
+
+    for( poLeaf = FindKey( psKey, &iEntry ); poLeaf != NULL;
+         poLeaf = poLeaf->poNext, iEntry = 0 )
+    {
+        for( ; iEntry < poLeaf->nCount; iEntry++ )
+        {
+            OGRBTreeEntry *psEntry = poLeaf->pasEntries + iEntry;
+
+            if( CompareKey( &(psEntry->sKey), psKey ) != 0 )
+                return OGRERR_NONE;
+
+            if( psEntry->nFID == nFID )
+            {
+                FreeEntry( psEntry );
+                memmove( psEntry, psEntry + 1, sizeof(OGRBTreeEntry)
+                         * (poLeaf->nCount - iEntry - 1) );
+                poLeaf->nCount--;
+                nEntryCount--;
+                poLIndex->bDirty = TRUE;
+                return OGRERR_NONE;
+            }
+        }
+    }
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                               Clear()                                */
+/************************************************************************/
+
+OGRErr OGRBTreeAttrIndex::Clear()
+
+{
+    BulkLoad( NULL, 0 );
+    bLoaded = TRUE;
+    poLIndex->bDirty = TRUE;
+
+    return OGRERR_NONE;
+}
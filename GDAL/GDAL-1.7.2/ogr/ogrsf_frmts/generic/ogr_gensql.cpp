@@ -29,7 +29,10 @@
 
 #include "ogr_p.h"
 #include "ogr_gensql.h"
+#include "ogr_attrind.h"
+#include "ogr_spatialind.h"
 #include "cpl_string.h"
+#include "cpl_hash_set.h"
 
 CPL_CVSID("$Id: ogr_gensql.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -53,6 +56,16 @@ OGRGenSQLResultsLayer::OGRGenSQLResultsLayer( OGRDataSource *poSrcDS,
     nNextIndexFID = 0;
     nExtraDSCount = 0;
     papoExtraDS = NULL;
+    papJoinHash = NULL;
+    panJoinHashState = NULL;
+    poSorter = NULL;
+    bSortedFeatures = FALSE;
+    poIndexQuery = NULL;
+    panMatchingFIDs = NULL;
+    panReadFIDs = NULL;
+    iNextMatchingFID = 0;
+    bIndexScanDone = FALSE;
+    bReadFIDsDone = FALSE;
 
 /* -------------------------------------------------------------------- */
 /*      Identify all the layers involved in the SELECT.                 */
@@ -233,12 +246,30 @@ OGRGenSQLResultsLayer::~OGRGenSQLResultsLayer()
 /* -------------------------------------------------------------------- */
 /*      Free various datastructures.                                    */
 /* -------------------------------------------------------------------- */
+    if( papJoinHash != NULL )
+    {
+        for( int iJoin = 0; 
+             iJoin < ((swq_select *) pSelectInfo)->join_count; iJoin++ )
+        {
+            if( papJoinHash[iJoin] != NULL )
+                CPLHashSetDestroy( (CPLHashSet *) papJoinHash[iJoin] );
+        }
+        CPLFree( papJoinHash );
+        CPLFree( panJoinHashState );
+    }
+
     CPLFree( papoTableLayers );
     papoTableLayers = NULL;
              
     if( panFIDIndex != NULL )
         CPLFree( panFIDIndex );
 
+    delete poSorter;
+
+    delete poIndexQuery;
+    CPLFree( panMatchingFIDs );
+    CPLFree( panReadFIDs );
+
     if( poSummaryFeature )
         delete poSummaryFeature;
 
@@ -319,6 +350,156 @@ void OGRGenSQLResultsLayer::ResetReading()
     }
 
     nNextIndexFID = 0;
+
+    CPLFree( panReadFIDs );
+    panReadFIDs = NULL;
+    bReadFIDsDone = FALSE;
+    iNextMatchingFID = 0;
+}
+
+/************************************************************************/
+/*                      OGRGenSQLIntersectFIDs()                        */
+/*                                                                      */
+/*      Return a new list of the FIDs of two increasing FID lists       */
+/*      that are in both, or in the first if the second is NULL.        */
+/************************************************************************/
+
+static long *OGRGenSQLIntersectFIDs( const long *panFIDs1, 
+                                     const long *panFIDs2 )
+
+{
+    int   i1 = 0, i2 = 0, nCount = 0;
+
+    while( panFIDs1[i1] != OGRNullFID )
+        i1++;
+
+    long *panResult = (long *) CPLMalloc( sizeof(long) * (i1 + 1) );
+
+    if( panFIDs2 == NULL )
+    {
+        memcpy( panResult, panFIDs1, sizeof(long) * (i1 + 1) );
+        return panResult;
+    }
+
+    i1 = 0;
+    while( panFIDs1[i1] != OGRNullFID && panFIDs2[i2] != OGRNullFID )
+    {
+        if( panFIDs1[i1] < panFIDs2[i2] )
+            i1++;
+        else if( panFIDs1[i1] > panFIDs2[i2] )
+            i2++;
+        else
+        {
+            panResult[nCount++] = panFIDs1[i1++];
+            i2++;
+        }
+    }
+    panResult[nCount] = OGRNullFID;
+
+    return panResult;
+}
+
+/************************************************************************/
+/*                           ScanSrcIndices()                           */
+/*                                                                      */
+/*      Establish the candidate FIDs of the WHERE clause from the       */
+/*      attribute indexes of the source layer (once), and of the        */
+/*      spatial filter from its spatial index (after each reset).       */
+/*      Returns TRUE if the source features are to be read from         */
+/*      the resulting list.  This is only done for layers with fast     */
+/*      random reading.                                                 */
+/************************************************************************/
+
+int OGRGenSQLResultsLayer::ScanSrcIndices()
+
+{
+    swq_select *psSelectInfo = (swq_select *) pSelectInfo;
+
+    if( !bIndexScanDone )
+    {
+        bIndexScanDone = TRUE;
+
+        if( !poSrcLayer->TestCapability( OLCRandomRead ) )
+            return FALSE;
+
+        if( psSelectInfo->whole_where_clause != NULL )
+        {
+            poIndexQuery = new OGRFeatureQuery();
+            if( poIndexQuery->Compile( poSrcLayer->GetLayerDefn(),
+                                       psSelectInfo->whole_where_clause ) 
+                != OGRERR_NONE )
+            {
+                delete poIndexQuery;
+                poIndexQuery = NULL;
+                return FALSE;
+            }
+
+            if( poSrcLayer->GetIndex() != NULL )
+                panMatchingFIDs = 
+                    poIndexQuery->EvaluateAgainstIndices( poSrcLayer, NULL );
+
+            if( panMatchingFIDs != NULL )
+                CPLDebug( "GenSQL", "Using attribute indexes of %s.",
+                          poSrcLayer->GetLayerDefn()->GetName() );
+        }
+    }
+
+    if( !bReadFIDsDone )
+    {
+        bReadFIDsDone = TRUE;
+
+        if( !poSrcLayer->TestCapability( OLCRandomRead )
+            || (psSelectInfo->whole_where_clause != NULL 
+                && poIndexQuery == NULL) )
+            return FALSE;
+
+        long *panSpatialFIDs = NULL;
+
+        if( m_poFilterGeom != NULL
+            && poSrcLayer->GetSpatialIndex() != NULL
+            && !poSrcLayer->GetSpatialIndex()->HasGeometrylessEntries() )
+            panSpatialFIDs = poSrcLayer->GetSpatialFilterCandidates();
+
+        if( panMatchingFIDs != NULL )
+            panReadFIDs = OGRGenSQLIntersectFIDs( panMatchingFIDs, 
+                                                  panSpatialFIDs );
+        else if( panSpatialFIDs != NULL )
+            panReadFIDs = OGRGenSQLIntersectFIDs( panSpatialFIDs, NULL );
+    }
+
+    return panReadFIDs != NULL;
+}
+
+/************************************************************************/
+/*                         GetNextSrcFeature()                          */
+/*                                                                      */
+/*      Fetch the next source feature matching the WHERE clause and     */
+/*      spatial filter.                                                 */
+/************************************************************************/
+
+OGRFeature *OGRGenSQLResultsLayer::GetNextSrcFeature()
+
+{
+    if( !ScanSrcIndices() )
+        return poSrcLayer->GetNextFeature();
+
+    while( panReadFIDs[iNextMatchingFID] != OGRNullFID )
+    {
+        OGRFeature *poSrcFeature = 
+            poSrcLayer->GetFeature( panReadFIDs[iNextMatchingFID++] );
+
+        if( poSrcFeature == NULL )
+            continue;
+
+        if( (poIndexQuery == NULL || poIndexQuery->Evaluate( poSrcFeature ))
+            && (m_poFilterGeom == NULL 
+                || FilterGeometry( poSrcFeature->GetGeometryRef() )) )
+            return poSrcFeature;
+
+        delete poSrcFeature;
+    }
+
+    return NULL;
 }
 
 /************************************************************************/
@@ -335,11 +516,15 @@ OGRErr OGRGenSQLResultsLayer::SetNextByIndex( long nIndex )
 
     if( psSelectInfo->query_mode == SWQM_SUMMARY_RECORD 
         || psSelectInfo->query_mode == SWQM_DISTINCT_LIST 
-        || panFIDIndex != NULL )
+        || panFIDIndex != NULL || poSorter != NULL )
     {
         nNextIndexFID = nIndex;
         return OGRERR_NONE;
     }
+    else if( ScanSrcIndices() )
+    {
+        return OGRLayer::SetNextByIndex( nIndex );
+    }
     else
     {
         return poSrcLayer->SetNextByIndex( nIndex );
@@ -400,7 +585,7 @@ int OGRGenSQLResultsLayer::GetFeatureCount( int bForce )
     }
     else if( psSelectInfo->query_mode != SWQM_RECORDSET )
         return 1;
-    else if( m_poAttrQuery == NULL )
+    else if( m_poAttrQuery == NULL && !ScanSrcIndices() )
         return poSrcLayer->GetFeatureCount( bForce );
     else
         return OGRLayer::GetFeatureCount( bForce );
@@ -440,6 +625,29 @@ int OGRGenSQLResultsLayer::TestCapability( const char *pszCap )
     return FALSE;
 }
 
+/************************************************************************/
+/*                      OGRGenSQLSummaryFormatter()                     */
+/*                                                                      */
+/*      Formats the value of a numeric source field for                 */
+/*      swq_select_summarize_number(), only called for values not       */
+/*      already in the distinct list.                                   */
+/************************************************************************/
+
+typedef struct
+{
+    swq_select *psSelectInfo;
+    OGRFeature *poSrcFeature;
+} OGRGenSQLSummaryRecord;
+
+static const char *OGRGenSQLSummaryFormatter( void *pRecord, int iField )
+
+{
+    OGRGenSQLSummaryRecord *psRecord = (OGRGenSQLSummaryRecord *) pRecord;
+
+    return psRecord->poSrcFeature->GetFieldAsString( 
+        psRecord->psSelectInfo->column_defs[iField].field_index );
+}
+
 /************************************************************************/
 /*                           PrepareSummary()                           */
 /************************************************************************/
@@ -465,16 +673,36 @@ int OGRGenSQLResultsLayer::PrepareSummary()
         
     poSrcLayer->ResetReading();
 
+    CPLFree( panReadFIDs );
+    panReadFIDs = NULL;
+    bReadFIDsDone = FALSE;
+    iNextMatchingFID = 0;
+
 /* -------------------------------------------------------------------- */
 /*      We treat COUNT(*) (or COUNT of anything without distinct) as    */
-/*      a special case, and fill with GetFeatureCount().                */
+/*      a special case, and fill with GetFeatureCount(), or by          */
+/*      counting the features selected through attribute indexes.      */
 /* -------------------------------------------------------------------- */
 
     if( psSelectInfo->result_columns == 1 
         && psSelectInfo->column_defs[0].col_func == SWQCF_COUNT
         && !psSelectInfo->column_defs[0].distinct_flag )
     {
-        poSummaryFeature->SetField( 0, poSrcLayer->GetFeatureCount( TRUE ) );
+        if( ScanSrcIndices() )
+        {
+            OGRFeature *poSrcFeature;
+            int nCount = 0;
+
+            while( (poSrcFeature = GetNextSrcFeature()) != NULL )
+            {
+                nCount++;
+                delete poSrcFeature;
+            }
+            poSummaryFeature->SetField( 0, nCount );
+        }
+        else
+            poSummaryFeature->SetField( 0, 
+                                        poSrcLayer->GetFeatureCount( TRUE ) );
         return TRUE;
     }
 
@@ -484,16 +712,44 @@ int OGRGenSQLResultsLayer::PrepareSummary()
 /* -------------------------------------------------------------------- */
     const char *pszError;
     OGRFeature *poSrcFeature;
+    OGRFeatureDefn *poSrcDefn = poSrcLayer->GetLayerDefn();
+    OGRGenSQLSummaryRecord sRecord;
 
-    while( (poSrcFeature = poSrcLayer->GetNextFeature()) != NULL )
+    sRecord.psSelectInfo = psSelectInfo;
+
+    while( (poSrcFeature = GetNextSrcFeature()) != NULL )
     {
+        sRecord.poSrcFeature = poSrcFeature;
+
         for( int iField = 0; iField < psSelectInfo->result_columns; iField++ )
         {
             swq_col_def *psColDef = psSelectInfo->column_defs + iField;
+            int iSrcField = psColDef->field_index;
+            OGRFieldType eType = OFTString;
+
+            if( iSrcField >= 0 && iSrcField < poSrcDefn->GetFieldCount() )
+                eType = poSrcDefn->GetFieldDefn( iSrcField )->GetType();
 
-            pszError = swq_select_summarize( psSelectInfo, iField, 
+/* -------------------------------------------------------------------- */
+/*      Numeric fields are summarized from their values, and only       */
+/*      formatted when new to a distinct list.                          */
+/* -------------------------------------------------------------------- */
+            if( eType == OFTInteger || eType == OFTReal )
+            {
+                OGRField *psField = poSrcFeature->GetRawFieldRef( iSrcField );
+                int bIsSet = poSrcFeature->IsFieldSet( iSrcField );
+
+                pszError = swq_select_summarize_number( 
+                    psSelectInfo, iField, bIsSet, 
+                    !bIsSet ? 0.0 : 
+                    eType == OFTInteger ? (double) psField->Integer 
+                                        : psField->Real,
+                    OGRGenSQLSummaryFormatter, &sRecord );
+            }
+            else
+                pszError = swq_select_summarize( psSelectInfo, iField, 
                                           poSrcFeature->GetFieldAsString( 
-                                              psColDef->field_index ) );
+                                              iSrcField ) );
             
             if( pszError != NULL )
             {
@@ -555,6 +811,55 @@ int OGRGenSQLResultsLayer::PrepareSummary()
     return TRUE;
 }
 
+/************************************************************************/
+/*                   OGRGenSQLGetFirstIndexedMatch()                    */
+/*                                                                      */
+/*      Fetch the first feature of a secondary layer matching the       */
+/*      join filter by way of its attribute indexes.  *pbUsedIndex      */
+/*      is set to FALSE if no index could resolve the filter, in        */
+/*      which case the caller has to scan the layer.                    */
+/************************************************************************/
+
+static OGRFeature *OGRGenSQLGetFirstIndexedMatch( OGRLayer *poLayer,
+                                                  const char *pszFilter,
+                                                  int *pbUsedIndex )
+
+{
+    *pbUsedIndex = FALSE;
+
+    if( poLayer->GetIndex() == NULL
+        || !poLayer->TestCapability( OLCRandomRead ) )
+        return NULL;
+
+    OGRFeatureQuery oQuery;
+    long           *panFIDs = NULL;
+
+    if( oQuery.Compile( poLayer->GetLayerDefn(), pszFilter ) == OGRERR_NONE )
+        panFIDs = oQuery.EvaluateAgainstIndices( poLayer, NULL );
+
+    if( panFIDs == NULL )
+        return NULL;
+
+    *pbUsedIndex = TRUE;
+
+    OGRFeature *poFeature = NULL;
+    int         i;
+
+    for( i = 0; panFIDs[i] != OGRNullFID && poFeature == NULL; i++ )
+    {
+        poFeature = poLayer->GetFeature( panFIDs[i] );
+        if( poFeature != NULL && !oQuery.Evaluate( poFeature ) )
+        {
+            delete poFeature;
+            poFeature = NULL;
+        }
+    }
+
+    CPLFree( panFIDs );
+
+    return poFeature;
+}
+
 /************************************************************************/
 /*                          TranslateFeature()                          */
 /************************************************************************/
@@ -648,6 +953,26 @@ OGRFeature *OGRGenSQLResultsLayer::TranslateFeature( OGRFeature *poSrcFeat )
         if( !poSrcFeat->IsFieldSet( psJoinInfo->primary_field ) )
             continue;
 
+        // Use the hash table of the secondary layer when we can.
+        if( BuildJoinHash( iJoin ) )
+        {
+            OGRFeature *poJoinFeature = LookupJoinHash( iJoin, poSrcFeat );
+
+            if( poJoinFeature == NULL )
+                continue;
+
+            for( int iField = 0; iField < psSelectInfo->result_columns; 
+                 iField++ )
+            {
+                swq_col_def *psColDef = psSelectInfo->column_defs + iField;
+            
+                if( psColDef->table_index == psJoinInfo->secondary_table )
+                    poDstFeat->SetField( iField,
+                                 poJoinFeature->GetRawFieldRef( iField ) );
+            }
+            continue;
+        }
+
         // Prepare attribute query to express fetching on the joined variable
         sprintf( szFilter, "%s = ", 
                  poJoinLayer->GetLayerDefn()->GetFieldDefn( 
@@ -689,14 +1014,23 @@ OGRFeature *OGRGenSQLResultsLayer::TranslateFeature( OGRFeature *poSrcFeat )
             continue;
         }
 
-        poJoinLayer->ResetReading();
-        if( poJoinLayer->SetAttributeFilter( szFilter ) != OGRERR_NONE )
-            continue;
-
-        // Fetch first joined feature.
+        // Fetch first joined feature, through the attribute index of the
+        // secondary layer if it has one we can use.
         OGRFeature *poJoinFeature;
+        int         bUsedIndex;
 
-        poJoinFeature = poJoinLayer->GetNextFeature();
+        poJoinFeature = 
+            OGRGenSQLGetFirstIndexedMatch( poJoinLayer, szFilter, 
+                                           &bUsedIndex );
+
+        if( !bUsedIndex )
+        {
+            poJoinLayer->ResetReading();
+            if( poJoinLayer->SetAttributeFilter( szFilter ) != OGRERR_NONE )
+                continue;
+
+            poJoinFeature = poJoinLayer->GetNextFeature();
+        }
 
         if( poJoinFeature == NULL )
             continue;
@@ -718,6 +1052,286 @@ OGRFeature *OGRGenSQLResultsLayer::TranslateFeature( OGRFeature *poSrcFeat )
     return poDstFeat;
 }
 
+/************************************************************************/
+/*                          OGRGenSQLJoinEntry                          */
+/*                                                                      */
+/*      Entry of a join hash table: the join key of a secondary         */
+/*      feature, and the values of the result columns taken from it    */
+/*      (stored in a feature of the result layer definition).           */
+/************************************************************************/
+
+typedef struct
+{
+    OGRField    sKey;
+    OGRFeature *poFeature;
+} OGRGenSQLJoinEntry;
+
+static unsigned long OGRGenSQLJoinHashInteger( const void *pElt )
+{
+    return (unsigned long) ((const OGRGenSQLJoinEntry *) pElt)->sKey.Integer;
+}
+
+static int OGRGenSQLJoinEqualInteger( const void *pElt1, const void *pElt2 )
+{
+    return ((const OGRGenSQLJoinEntry *) pElt1)->sKey.Integer
+        == ((const OGRGenSQLJoinEntry *) pElt2)->sKey.Integer;
+}
+
+static unsigned long OGRGenSQLJoinHashReal( const void *pElt )
+{
+    double dfValue = ((const OGRGenSQLJoinEntry *) pElt)->sKey.Real;
+    GUInt32 anWords[2];
+
+    if( dfValue == 0.0 ) /* -0.0 == 0.0 */
+        dfValue = 0.0;
+    memcpy( anWords, &dfValue, sizeof(double) );
+
+    return (unsigned long) (anWords[0] ^ (anWords[1] * 31));
+}
+
+static int OGRGenSQLJoinEqualReal( const void *pElt1, const void *pElt2 )
+{
+    return ((const OGRGenSQLJoinEntry *) pElt1)->sKey.Real
+        == ((const OGRGenSQLJoinEntry *) pElt2)->sKey.Real;
+}
+
+/* String keys compare without regard to case, as the "=" operator does. */
+static unsigned long OGRGenSQLJoinHashString( const void *pElt )
+{
+    const unsigned char *pszKey = (const unsigned char *)
+        ((const OGRGenSQLJoinEntry *) pElt)->sKey.String;
+    unsigned long nHash = 0;
+
+    for( ; *pszKey != '\0'; pszKey++ )
+        nHash = nHash * 31 + tolower( *pszKey );
+
+    return nHash;
+}
+
+static int OGRGenSQLJoinEqualString( const void *pElt1, const void *pElt2 )
+{
+    return EQUAL( ((const OGRGenSQLJoinEntry *) pElt1)->sKey.String,
+                  ((const OGRGenSQLJoinEntry *) pElt2)->sKey.String );
+}
+
+static void OGRGenSQLJoinFreeEntry( void *pElt )
+{
+    OGRGenSQLJoinEntry *psEntry = (OGRGenSQLJoinEntry *) pElt;
+
+    delete psEntry->poFeature;
+    CPLFree( psEntry );
+}
+
+static void OGRGenSQLJoinFreeStringEntry( void *pElt )
+{
+    CPLFree( ((OGRGenSQLJoinEntry *) pElt)->sKey.String );
+    OGRGenSQLJoinFreeEntry( pElt );
+}
+
+/************************************************************************/
+/*                           BuildJoinHash()                            */
+/*                                                                      */
+/*      Build, on first use, a hash table of the secondary layer of     */
+/*      a join keyed on its join field, so that each primary feature    */
+/*      is joined with a lookup instead of a scan of the secondary      */
+/*      layer.  Returns FALSE if the join must be done with attribute   */
+/*      filters instead: join fields of different or unsupported        */
+/*      types, an attribute index on the secondary join field, a        */
+/*      self join, or a table exceeding OGR_SQL_JOIN_HASH_MAX_MEMORY.   */
+/************************************************************************/
+
+int OGRGenSQLResultsLayer::BuildJoinHash( int iJoin )
+
+{
+    swq_select *psSelectInfo = (swq_select *) pSelectInfo;
+
+    if( papJoinHash == NULL )
+    {
+        papJoinHash = (void **) 
+            CPLCalloc( sizeof(void*), psSelectInfo->join_count );
+        panJoinHashState = (int *) 
+            CPLCalloc( sizeof(int), psSelectInfo->join_count );
+    }
+
+    if( panJoinHashState[iJoin] != 0 )
+        return panJoinHashState[iJoin] > 0;
+
+    panJoinHashState[iJoin] = -1;
+
+    swq_join_def *psJoinInfo = psSelectInfo->join_defs + iJoin;
+    OGRLayer *poJoinLayer = papoTableLayers[psJoinInfo->secondary_table];
+    OGRFeatureDefn *poJoinDefn = poJoinLayer->GetLayerDefn();
+
+/* -------------------------------------------------------------------- */
+/*      Can we, and do we want to, use a hash table for this join?      */
+/* -------------------------------------------------------------------- */
+    GIntBig nMaxMemory = 
+        CPLScanUIntBig( CPLGetConfigOption( "OGR_SQL_JOIN_HASH_MAX_MEMORY",
+                                            "268435456" ), 20 );
+
+    if( nMaxMemory == 0 || poJoinLayer == poSrcLayer )
+        return FALSE;
+
+    if( psJoinInfo->primary_field < 0
+        || psJoinInfo->primary_field >= iFIDFieldIndex
+        || psJoinInfo->secondary_field < 0
+        || psJoinInfo->secondary_field >= poJoinDefn->GetFieldCount() )
+        return FALSE;
+
+    OGRFieldType eKeyType = poSrcLayer->GetLayerDefn()->
+        GetFieldDefn( psJoinInfo->primary_field )->GetType();
+
+    if( (eKeyType != OFTInteger && eKeyType != OFTReal 
+         && eKeyType != OFTString)
+        || poJoinDefn->GetFieldDefn( psJoinInfo->secondary_field )->GetType()
+           != eKeyType )
+        return FALSE;
+
+    if( poJoinLayer->GetIndex() != NULL
+        && poJoinLayer->GetIndex()->GetFieldIndex( 
+            psJoinInfo->secondary_field ) != NULL )
+    {
+        CPLDebug( "GenSQL", "Using attribute index of %s for join.",
+                  poJoinDefn->GetName() );
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Scan the secondary layer once, keeping the first feature for    */
+/*      each key value.                                                 */
+/* -------------------------------------------------------------------- */
+    CPLHashSet *hSet;
+
+    if( eKeyType == OFTInteger )
+        hSet = CPLHashSetNew( OGRGenSQLJoinHashInteger, 
+                              OGRGenSQLJoinEqualInteger,
+                              OGRGenSQLJoinFreeEntry );
+    else if( eKeyType == OFTReal )
+        hSet = CPLHashSetNew( OGRGenSQLJoinHashReal, 
+                              OGRGenSQLJoinEqualReal,
+                              OGRGenSQLJoinFreeEntry );
+    else
+        hSet = CPLHashSetNew( OGRGenSQLJoinHashString, 
+                              OGRGenSQLJoinEqualString,
+                              OGRGenSQLJoinFreeStringEntry );
+
+    GIntBig nMemory = 0;
+    int     bOverflow = FALSE;
+    OGRFeature *poJoinFeature;
+
+    poJoinLayer->SetAttributeFilter( NULL );
+    poJoinLayer->ResetReading();
+
+    while( !bOverflow 
+           && (poJoinFeature = poJoinLayer->GetNextFeature()) != NULL )
+    {
+        OGRGenSQLJoinEntry sLookup;
+        int bKeySet = 
+            poJoinFeature->IsFieldSet( psJoinInfo->secondary_field );
+
+        // Unset string fields compare equal to '' in attribute filters.
+        if( eKeyType == OFTString )
+            sLookup.sKey.String = (char *) (bKeySet ?
+                poJoinFeature->GetFieldAsString( psJoinInfo->secondary_field )
+                : "");
+        else if( !bKeySet )
+        {
+            delete poJoinFeature;
+            continue;
+        }
+        else
+            sLookup.sKey = 
+                *poJoinFeature->GetRawFieldRef( psJoinInfo->secondary_field );
+
+        if( CPLHashSetLookup( hSet, &sLookup ) != NULL )
+        {
+            delete poJoinFeature;
+            continue;
+        }
+
+        OGRGenSQLJoinEntry *psEntry = (OGRGenSQLJoinEntry *)
+            CPLMalloc( sizeof(OGRGenSQLJoinEntry) );
+
+        psEntry->poFeature = new OGRFeature( poDefn );
+        nMemory += sizeof(OGRGenSQLJoinEntry) + sizeof(OGRFeature) 
+            + poDefn->GetFieldCount() * sizeof(OGRField) + 32;
+
+        for( int iField = 0; iField < psSelectInfo->result_columns; iField++ )
+        {
+            swq_col_def *psColDef = psSelectInfo->column_defs + iField;
+            
+            if( psColDef->table_index != psJoinInfo->secondary_table )
+                continue;
+
+            psEntry->poFeature->SetField( iField,
+                poJoinFeature->GetRawFieldRef( psColDef->field_index ) );
+            if( poDefn->GetFieldDefn( iField )->GetType() == OFTString
+                && psEntry->poFeature->IsFieldSet( iField ) )
+                nMemory += strlen( psEntry->poFeature->
+                                   GetFieldAsString( iField ) ) + 1;
+        }
+
+        if( eKeyType == OFTString )
+        {
+            psEntry->sKey.String = CPLStrdup( sLookup.sKey.String );
+            nMemory += strlen( sLookup.sKey.String ) + 1;
+        }
+        else
+            psEntry->sKey = sLookup.sKey;
+
+        CPLHashSetInsert( hSet, psEntry );
+        delete poJoinFeature;
+
+        if( nMemory > nMaxMemory )
+            bOverflow = TRUE;
+    }
+
+    poJoinLayer->ResetReading();
+
+    if( bOverflow )
+    {
+        CPLDebug( "GenSQL", 
+                  "Join table %s exceeds OGR_SQL_JOIN_HASH_MAX_MEMORY, "
+                  "using attribute filters.", poJoinDefn->GetName() );
+        CPLHashSetDestroy( hSet );
+        return FALSE;
+    }
+
+    CPLDebug( "GenSQL", "Built join hash table of %d keys for %s.",
+              CPLHashSetSize( hSet ), poJoinDefn->GetName() );
+
+    papJoinHash[iJoin] = hSet;
+    panJoinHashState[iJoin] = 1;
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                           LookupJoinHash()                           */
+/*                                                                      */
+/*      Return the feature holding the joined column values for the     */
+/*      key of poSrcFeat, or NULL if there is no match.  The result     */
+/*      belongs to the hash table.                                      */
+/************************************************************************/
+
+OGRFeature *OGRGenSQLResultsLayer::LookupJoinHash( int iJoin, 
+                                                   OGRFeature *poSrcFeat )
+
+{
+    swq_select *psSelectInfo = (swq_select *) pSelectInfo;
+    swq_join_def *psJoinInfo = psSelectInfo->join_defs + iJoin;
+    OGRGenSQLJoinEntry sLookup, *psEntry;
+
+    sLookup.sKey = *poSrcFeat->GetRawFieldRef( psJoinInfo->primary_field );
+
+    psEntry = (OGRGenSQLJoinEntry *) 
+        CPLHashSetLookup( (CPLHashSet *) papJoinHash[iJoin], &sLookup );
+    if( psEntry == NULL )
+        return NULL;
+
+    return psEntry->poFeature;
+}
+
 /************************************************************************/
 /*                           GetNextFeature()                           */
 /************************************************************************/
@@ -741,11 +1355,11 @@ OGRFeature *OGRGenSQLResultsLayer::GetNextFeature()
     {
         OGRFeature *poFeature;
 
-        if( panFIDIndex != NULL )
+        if( panFIDIndex != NULL || poSorter != NULL )
             poFeature =  GetFeature( nNextIndexFID++ );
         else
         {
-            OGRFeature *poSrcFeat = poSrcLayer->GetNextFeature();
+            OGRFeature *poSrcFeat = GetNextSrcFeature();
 
             if( poSrcFeat == NULL )
                 return NULL;
@@ -811,8 +1425,11 @@ OGRFeature *OGRGenSQLResultsLayer::GetFeature( long nFID )
 
 /* -------------------------------------------------------------------- */
 /*      Are we running in sorted mode?  If so, run the fid through      */
-/*      the index.                                                      */
+/*      the index, or fetch it from the sorter.                         */
 /* -------------------------------------------------------------------- */
+    if( poSorter != NULL )
+        return GetSortedFeature( nFID );
+
     if( panFIDIndex != NULL )
     {
         if( nFID < 0 || nFID >= nIndexSize )
@@ -858,6 +1475,274 @@ OGRFeatureDefn *OGRGenSQLResultsLayer::GetLayerDefn()
     return poDefn;
 }
 
+/************************************************************************/
+/*                        OGRGenSQLAppendBytes()                        */
+/************************************************************************/
+
+static void OGRGenSQLAppendBytes( GByte **ppabyBuffer, int *pnBufferSize,
+                                  int *pnUsed, const void *pData, 
+                                  int nBytes )
+
+{
+    if( *pnUsed + nBytes > *pnBufferSize )
+    {
+        *pnBufferSize = (*pnUsed + nBytes) * 2 + 256;
+        *ppabyBuffer = (GByte *) CPLRealloc( *ppabyBuffer, *pnBufferSize );
+    }
+
+    memcpy( *ppabyBuffer + *pnUsed, pData, nBytes );
+    *pnUsed += nBytes;
+}
+
+/************************************************************************/
+/*                     OGRGenSQLSerializeFeature()                      */
+/*                                                                      */
+/*      Serialize the style string, geometry (as WKB) and fields of a   */
+/*      source feature so it can travel through the sort runs.          */
+/*      Returns the number of bytes used in *ppabyBuffer.               */
+/************************************************************************/
+
+static int OGRGenSQLSerializeFeature( OGRFeature *poFeature,
+                                      GByte **ppabyBuffer, 
+                                      int *pnBufferSize )
+
+{
+    int nUsed = 0, nCount, i;
+    GInt32 nSize;
+    const char *pszStyle = poFeature->GetStyleString();
+    OGRGeometry *poGeom = poFeature->GetGeometryRef();
+
+    nSize = pszStyle ? (GInt32) strlen(pszStyle) + 1 : 0;
+    OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, &nSize, 4 );
+    if( nSize > 0 )
+        OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                              pszStyle, nSize );
+
+    nSize = poGeom ? poGeom->WkbSize() : 0;
+    OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, &nSize, 4 );
+    if( nSize > 0 )
+    {
+        if( nUsed + nSize > *pnBufferSize )
+        {
+            *pnBufferSize = (nUsed + nSize) * 2 + 256;
+            *ppabyBuffer = (GByte *) CPLRealloc( *ppabyBuffer, *pnBufferSize );
+        }
+        poGeom->exportToWkb( wkbNDR, *ppabyBuffer + nUsed );
+        nUsed += nSize;
+    }
+
+    for( int iField = 0; iField < poFeature->GetFieldCount(); iField++ )
+    {
+        OGRField *psField = poFeature->GetRawFieldRef( iField );
+        GByte bSet = (GByte) poFeature->IsFieldSet( iField );
+        OGRFieldType eType = poFeature->GetFieldDefnRef( iField )->GetType();
+
+        if( eType == OFTWideString || eType == OFTWideStringList )
+            bSet = FALSE;
+
+        OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, &bSet, 1 );
+        if( !bSet )
+            continue;
+
+        switch( eType )
+        {
+          case OFTInteger:
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &(psField->Integer), 4 );
+            break;
+
+          case OFTReal:
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &(psField->Real), 8 );
+            break;
+
+          case OFTString:
+            nSize = strlen(psField->String) + 1;
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &nSize, 4 );
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  psField->String, nSize );
+            break;
+
+          case OFTIntegerList:
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &(psField->IntegerList.nCount), 4 );
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  psField->IntegerList.paList,
+                                  4 * psField->IntegerList.nCount );
+            break;
+
+          case OFTRealList:
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &(psField->RealList.nCount), 4 );
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  psField->RealList.paList,
+                                  8 * psField->RealList.nCount );
+            break;
+
+          case OFTStringList:
+            nCount = psField->StringList.nCount;
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &nCount, 4 );
+            for( i = 0; i < nCount; i++ )
+            {
+                nSize = strlen(psField->StringList.paList[i]) + 1;
+                OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                      &nSize, 4 );
+                OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                      psField->StringList.paList[i], nSize );
+            }
+            break;
+
+          case OFTBinary:
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  &(psField->Binary.nCount), 4 );
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  psField->Binary.paData, 
+                                  psField->Binary.nCount );
+            break;
+
+          default: /* dates and times */
+            OGRGenSQLAppendBytes( ppabyBuffer, pnBufferSize, &nUsed, 
+                                  psField, sizeof(OGRField) );
+            break;
+        }
+    }
+
+    return nUsed;
+}
+
+/************************************************************************/
+/*                    OGRGenSQLDeserializeFeature()                     */
+/************************************************************************/
+
+static OGRFeature *OGRGenSQLDeserializeFeature( OGRLayer *poLayer,
+                                                const GByte *pabyData,
+                                                int nDataSize )
+
+{
+    OGRFeature *poFeature = new OGRFeature( poLayer->GetLayerDefn() );
+    const GByte *pabyEnd = pabyData + nDataSize;
+    GInt32 nSize, nCount, i;
+
+#define READ_INT32( nValue ) \
+    { memcpy( &(nValue), pabyData, 4 ); pabyData += 4; }
+
+    READ_INT32( nSize );
+    if( nSize > 0 )
+        poFeature->SetStyleString( (const char *) pabyData );
+    pabyData += nSize;
+
+    READ_INT32( nSize );
+    if( nSize > 0 )
+    {
+        OGRGeometry *poGeom = NULL;
+
+        OGRGeometryFactory::createFromWkb( (unsigned char *) pabyData,
+                                           poLayer->GetSpatialRef(),
+                                           &poGeom, nSize );
+        poFeature->SetGeometryDirectly( poGeom );
+    }
+    pabyData += nSize;
+
+    for( int iField = 0; 
+         iField < poFeature->GetFieldCount() && pabyData < pabyEnd; 
+         iField++ )
+    {
+        if( *(pabyData++) == 0 )
+            continue;
+
+        switch( poFeature->GetFieldDefnRef( iField )->GetType() )
+        {
+          case OFTInteger:
+          {
+              int nValue;
+
+              READ_INT32( nValue );
+              poFeature->SetField( iField, nValue );
+              break;
+          }
+
+          case OFTReal:
+          {
+              double dfValue;
+
+              memcpy( &dfValue, pabyData, 8 );
+              pabyData += 8;
+              poFeature->SetField( iField, dfValue );
+              break;
+          }
+
+          case OFTString:
+            READ_INT32( nSize );
+            poFeature->SetField( iField, (const char *) pabyData );
+            pabyData += nSize;
+            break;
+
+          case OFTIntegerList:
+          {
+              READ_INT32( nCount );
+              int *panList = (int *) CPLMalloc( 4 * MAX(1,nCount) );
+
+              memcpy( panList, pabyData, 4 * nCount );
+              pabyData += 4 * nCount;
+              poFeature->SetField( iField, nCount, panList );
+              CPLFree( panList );
+              break;
+          }
+
+          case OFTRealList:
+          {
+              READ_INT32( nCount );
+              double *padfList = (double *) CPLMalloc( 8 * MAX(1,nCount) );
+
+              memcpy( padfList, pabyData, 8 * nCount );
+              pabyData += 8 * nCount;
+              poFeature->SetField( iField, nCount, padfList );
+              CPLFree( padfList );
+              break;
+          }
+
+          case OFTStringList:
+          {
+              char **papszList = NULL;
+
+              READ_INT32( nCount );
+              for( i = 0; i < nCount; i++ )
+              {
+                  READ_INT32( nSize );
+                  papszList = CSLAddString( papszList, 
+                                            (const char *) pabyData );
+                  pabyData += nSize;
+              }
+              poFeature->SetField( iField, papszList );
+              CSLDestroy( papszList );
+              break;
+          }
+
+          case OFTBinary:
+            READ_INT32( nSize );
+            poFeature->SetField( iField, nSize, (GByte *) pabyData );
+            pabyData += nSize;
+            break;
+
+          default: /* dates and times */
+          {
+              OGRField sField;
+
+              memcpy( &sField, pabyData, sizeof(OGRField) );
+              pabyData += sizeof(OGRField);
+              poFeature->SetField( iField, &sField );
+              break;
+          }
+        }
+    }
+
+#undef READ_INT32
+
+    return poFeature;
+}
+
 /************************************************************************/
 /*                         CreateOrderByIndex()                         */
 /*                                                                      */
@@ -866,22 +1751,21 @@ OGRFeatureDefn *OGRGenSQLResultsLayer::GetLayerDefn()
 /*      ORDER BY clauses.                                               */
 /*                                                                      */
 /*      This is accomplished by making one pass through all the         */
-/*      eligible source features, and capturing the order by fields     */
-/*      of all records in memory.  A quick sort is then applied to      */
-/*      this in memory copy of the order-by fields to create the        */
-/*      required index.                                                 */
-/*                                                                      */
-/*      Keeping all the key values in memory will *not* scale up to     */
-/*      very large input datasets.                                      */
+/*      eligible source features, and passing the order by fields       */
+/*      and FID of each to an OGRGenSQLSorter.  When the sorter kept    */
+/*      everything in memory, the sorted FIDs are loaded into the       */
+/*      panFIDIndex.  Otherwise, because the sort was larger than       */
+/*      OGR_SQL_SORT_MAX_MEMORY or OGR_SQL_SORT_FEATURES asked for the  */
+/*      whole source features to be carried through the sort so that    */
+/*      they are not random read again, results are read back from      */
+/*      the sorter.                                                     */
 /************************************************************************/
 
 void OGRGenSQLResultsLayer::CreateOrderByIndex()
 
 {
     swq_select *psSelectInfo = (swq_select *) pSelectInfo;
-    OGRField *pasIndexFields;
-    int      i, nOrderItems = psSelectInfo->order_specs;
-    long     *panFIDList;
+    int      iKey, nOrderItems = psSelectInfo->order_specs;
 
     if( nOrderItems == 0 )
         return;
@@ -889,35 +1773,61 @@ void OGRGenSQLResultsLayer::CreateOrderByIndex()
     ResetReading();
 
 /* -------------------------------------------------------------------- */
-/*      Allocate set of key values, and the output index.               */
+/*      Establish the key types and create the sorter.                  */
 /* -------------------------------------------------------------------- */
-    nIndexSize = poSrcLayer->GetFeatureCount();
+    OGRFieldType *paeKeyTypes = (OGRFieldType *)
+        CPLMalloc( sizeof(OGRFieldType) * nOrderItems );
 
-    pasIndexFields = (OGRField *) 
-        CPLCalloc(sizeof(OGRField), nOrderItems * nIndexSize);
-    panFIDIndex = (long *) CPLCalloc(sizeof(long),nIndexSize);
-    panFIDList = (long *) CPLCalloc(sizeof(long),nIndexSize);
+    for( iKey = 0; iKey < nOrderItems; iKey++ )
+    {
+        swq_order_def *psKeyDef = psSelectInfo->order_defs + iKey;
 
-    for( i = 0; i < nIndexSize; i++ )
-        panFIDIndex[i] = i;
+        if( psKeyDef->field_index < iFIDFieldIndex )
+            paeKeyTypes[iKey] = poSrcLayer->GetLayerDefn()->
+                GetFieldDefn( psKeyDef->field_index )->GetType();
+        else if( psKeyDef->field_index 
+                 >= iFIDFieldIndex + SPECIAL_FIELD_COUNT )
+            paeKeyTypes[iKey] = OFTBinary; /* not compared */
+        else if( SpecialFieldTypes[psKeyDef->field_index - iFIDFieldIndex]
+                 == SWQ_INTEGER )
+            paeKeyTypes[iKey] = OFTInteger;
+        else if( SpecialFieldTypes[psKeyDef->field_index - iFIDFieldIndex]
+                 == SWQ_FLOAT )
+            paeKeyTypes[iKey] = OFTReal;
+        else
+            paeKeyTypes[iKey] = OFTString;
+    }
+
+    GIntBig nMaxMemory = 
+        CPLScanUIntBig( CPLGetConfigOption( "OGR_SQL_SORT_MAX_MEMORY",
+                                            "268435456" ), 20 );
+
+    bSortedFeatures = 
+        CSLTestBoolean( CPLGetConfigOption( "OGR_SQL_SORT_FEATURES", "NO" ) );
+
+    poSorter = new OGRGenSQLSorter( nOrderItems, paeKeyTypes, SortCompare,
+                                    this, nMaxMemory );
+    CPLFree( paeKeyTypes );
 
 /* -------------------------------------------------------------------- */
-/*      Read in all the key values.                                     */
+/*      Pass all the records to the sorter.                             */
 /* -------------------------------------------------------------------- */
+    OGRField *pasKeys = (OGRField *) CPLCalloc( sizeof(OGRField), 
+                                                nOrderItems );
+    char    **papszKeyStrings = (char **) CPLCalloc( sizeof(char *), 
+                                                     nOrderItems );
+    GByte   *pabyPayload = NULL;
+    int      nPayloadMax = 0, nPayloadSize = 0, bOK = TRUE;
     OGRFeature *poSrcFeat;
-    int         iFeature = 0;
 
-    while( (poSrcFeat = poSrcLayer->GetNextFeature()) != NULL )
+    while( bOK && (poSrcFeat = GetNextSrcFeature()) != NULL )
     {
-        int iKey;
-
         for( iKey = 0; iKey < nOrderItems; iKey++ )
         {
             swq_order_def *psKeyDef = psSelectInfo->order_defs + iKey;
-            OGRFieldDefn *poFDefn;
-            OGRField *psSrcField, *psDstField;
+            OGRField *psDstField = pasKeys + iKey;
 
-            psDstField = pasIndexFields + iFeature * nOrderItems + iKey;
+            memset( psDstField, 0, sizeof(OGRField) );
 
             if ( psKeyDef->field_index >= iFIDFieldIndex)
             {
@@ -934,156 +1844,150 @@ void OGRGenSQLResultsLayer::CreateOrderByIndex()
                         break;
 
                       default:
-                        psDstField->String = CPLStrdup( poSrcFeat->GetFieldAsString(psKeyDef->field_index) );
+                        papszKeyStrings[iKey] = CPLStrdup( poSrcFeat->GetFieldAsString(psKeyDef->field_index) );
+                        psDstField->String = papszKeyStrings[iKey];
                         break;
                     }
                 }
                 continue;
             }
             
-            poFDefn = poSrcLayer->GetLayerDefn()->GetFieldDefn( 
-                psKeyDef->field_index );
-
-            psSrcField = poSrcFeat->GetRawFieldRef( psKeyDef->field_index );
-
-            if( poFDefn->GetType() == OFTInteger 
-                || poFDefn->GetType() == OFTReal
-                || poFDefn->GetType() == OFTDate
-                || poFDefn->GetType() == OFTTime
-                || poFDefn->GetType() == OFTDateTime)
-                memcpy( psDstField, psSrcField, sizeof(OGRField) );
-            else if( poFDefn->GetType() == OFTString )
+            switch( poSrcLayer->GetLayerDefn()->GetFieldDefn( 
+                        psKeyDef->field_index )->GetType() )
             {
-                if( poSrcFeat->IsFieldSet( psKeyDef->field_index ) )
-                    psDstField->String = CPLStrdup( psSrcField->String );
-                else
-                    memcpy( psDstField, psSrcField, sizeof(OGRField) );
+              case OFTInteger:
+              case OFTReal:
+              case OFTDate:
+              case OFTTime:
+              case OFTDateTime:
+              case OFTString:
+                memcpy( psDstField, 
+                        poSrcFeat->GetRawFieldRef( psKeyDef->field_index ),
+                        sizeof(OGRField) );
+                break;
+
+              default:
+                break;
             }
         }
 
-        panFIDList[iFeature] = poSrcFeat->GetFID();
+        if( bSortedFeatures )
+            nPayloadSize = OGRGenSQLSerializeFeature( poSrcFeat, &pabyPayload,
+                                                      &nPayloadMax );
+
+        bOK = poSorter->AddRecord( pasKeys, poSrcFeat->GetFID(),
+                                   pabyPayload, nPayloadSize );
+
         delete poSrcFeat;
 
-        iFeature++;
+        for( iKey = 0; iKey < nOrderItems; iKey++ )
+        {
+            CPLFree( papszKeyStrings[iKey] );
+            papszKeyStrings[iKey] = NULL;
+        }
     }
 
-    CPLAssert( nIndexSize == iFeature );
+    CPLFree( pasKeys );
+    CPLFree( papszKeyStrings );
+    CPLFree( pabyPayload );
 
-/* -------------------------------------------------------------------- */
-/*      Quick sort the records.                                         */
-/* -------------------------------------------------------------------- */
-    SortIndexSection( pasIndexFields, 0, nIndexSize );
+    if( bOK )
+        bOK = poSorter->Finish();
 
 /* -------------------------------------------------------------------- */
-/*      Rework the FID map to map to real FIDs.                         */
+/*      On failure, the result set is empty.                            */
 /* -------------------------------------------------------------------- */
-    for( i = 0; i < nIndexSize; i++ )
-        panFIDIndex[i] = panFIDList[panFIDIndex[i]];
+    if( !bOK )
+    {
+        delete poSorter;
+        poSorter = NULL;
+        nIndexSize = 0;
+        panFIDIndex = (long *) CPLCalloc( sizeof(long), 1 );
+        return;
+    }
 
-    CPLFree( panFIDList );
+    nIndexSize = (int) poSorter->GetRecordCount();
+
+    if( poSorter->IsExternal() || bSortedFeatures )
+        return;
 
 /* -------------------------------------------------------------------- */
-/*      Free the key field values.                                      */
+/*      Otherwise load the sorted FIDs into the index.                  */
 /* -------------------------------------------------------------------- */
-    for( int iKey = 0; iKey < nOrderItems; iKey++ )
-    {
-        swq_order_def *psKeyDef = psSelectInfo->order_defs + iKey;
-        OGRFieldDefn *poFDefn;
+    int i;
 
-        if ( psKeyDef->field_index >= iFIDFieldIndex &&
-            psKeyDef->field_index < iFIDFieldIndex + SPECIAL_FIELD_COUNT )
-        {
-            /* warning: only special fields of type string should be deallocated */
-            if (SpecialFieldTypes[psKeyDef->field_index - iFIDFieldIndex] == SWQ_STRING)
-            {
-                for( i = 0; i < nIndexSize; i++ )
-                {
-                    OGRField *psField = pasIndexFields + iKey + i * nOrderItems;
-                    CPLFree( psField->String );
-                }
-            }
-            continue;
-        }
+    panFIDIndex = (long *) CPLCalloc( sizeof(long), MAX(1,nIndexSize) );
 
-        poFDefn = poSrcLayer->GetLayerDefn()->GetFieldDefn( 
-            psKeyDef->field_index );
-
-        if( poFDefn->GetType() == OFTString )
-        {
-            for( i = 0; i < nIndexSize; i++ )
-            {
-                OGRField *psField = pasIndexFields + iKey + i * nOrderItems;
-                
-                if( psField->Set.nMarker1 != OGRUnsetMarker 
-                    || psField->Set.nMarker2 != OGRUnsetMarker )
-                    CPLFree( psField->String );
-            }
-        }
-    }
+    for( i = 0; i < nIndexSize; i++ )
+        poSorter->GetNextRecord( panFIDIndex + i, NULL, NULL );
 
-    CPLFree( pasIndexFields );
+    delete poSorter;
+    poSorter = NULL;
 }
 
 /************************************************************************/
-/*                          SortIndexSection()                          */
+/*                          GetSortedFeature()                          */
 /*                                                                      */
-/*      Sort the records in a section of the index.                     */
+/*      Fetch the feature at position nIndex of the ORDER BY results    */
+/*      from the sorter.  Sequential reading streams the merge of the   */
+/*      sort runs, going backwards restarts it.                         */
 /************************************************************************/
 
-void OGRGenSQLResultsLayer::SortIndexSection( OGRField *pasIndexFields, 
-                                              int nStart, int nEntries )
+OGRFeature *OGRGenSQLResultsLayer::GetSortedFeature( long nIndex )
 
 {
-    if( nEntries < 2 )
-        return;
-
-    swq_select *psSelectInfo = (swq_select *) pSelectInfo;
-    int      nOrderItems = psSelectInfo->order_specs;
+    long         nSrcFID = OGRNullFID;
+    const GByte *pabyPayload = NULL;
+    int          nPayloadSize = 0;
 
-    int nFirstGroup = nEntries / 2;
-    int nFirstStart = nStart;
-    int nSecondGroup = nEntries - nFirstGroup;
-    int nSecondStart = nStart + nFirstGroup;
-    int iMerge = 0;
-    long *panMerged;
+    if( nIndex < 0 || nIndex >= nIndexSize )
+        return NULL;
 
-    SortIndexSection( pasIndexFields, nFirstStart, nFirstGroup );
-    SortIndexSection( pasIndexFields, nSecondStart, nSecondGroup );
+    if( nIndex < poSorter->GetNextRecordIndex() && !poSorter->Rewind() )
+        return NULL;
 
-    panMerged = (long *) CPLMalloc( sizeof(long) * nEntries );
-        
-    while( iMerge < nEntries )
+    while( poSorter->GetNextRecordIndex() <= nIndex )
     {
-        int  nResult;
+        if( !poSorter->GetNextRecord( &nSrcFID, &pabyPayload, 
+                                      &nPayloadSize ) )
+            return NULL;
+    }
 
-        if( nFirstGroup == 0 )
-            nResult = -1;
-        else if( nSecondGroup == 0 )
-            nResult = 1;
-        else
-            nResult = Compare( pasIndexFields 
-                               + panFIDIndex[nFirstStart] * nOrderItems, 
-                               pasIndexFields 
-                               + panFIDIndex[nSecondStart] * nOrderItems );
+    OGRFeature *poSrcFeature;
+    OGRFeature *poResult;
 
-        if( nResult < 0 )
-        {
-            panMerged[iMerge++] = panFIDIndex[nSecondStart++];
-            nSecondGroup--;
-        }
-        else
-        {
-            panMerged[iMerge++] = panFIDIndex[nFirstStart++];
-            nFirstGroup--;
-        }
+    if( bSortedFeatures )
+    {
+        poSrcFeature = OGRGenSQLDeserializeFeature( poSrcLayer, pabyPayload,
+                                                    nPayloadSize );
+        poSrcFeature->SetFID( nSrcFID );
     }
+    else
+        poSrcFeature = poSrcLayer->GetFeature( nSrcFID );
+
+    if( poSrcFeature == NULL )
+        return NULL;
 
-    /* Copy the merge list back into the main index */
+    poResult = TranslateFeature( poSrcFeature );
+    poResult->SetFID( nSrcFID );
+    
+    delete poSrcFeature;
 
-    memcpy( panFIDIndex + nStart, panMerged, sizeof(long) * nEntries );
-    CPLFree( panMerged );
+    return poResult;
 }
 
+/************************************************************************/
+/*                            SortCompare()                             */
+/************************************************************************/
+
+int OGRGenSQLResultsLayer::SortCompare( void *pUserData, 
+                                        OGRField *pasFirst,
+                                        OGRField *pasSecond )
+
+{
+    return ((OGRGenSQLResultsLayer *) pUserData)->Compare( pasFirst, 
+                                                           pasSecond );
+}
 
 /************************************************************************/
 /*                    OGRGenSQLCompareDate()                            */
@@ -32,6 +32,86 @@
 
 #include "ogrsf_frmts.h"
 
+/************************************************************************/
+/*                           OGRGenSQLSorter                            */
+/*                                                                      */
+/*      External merge sort of records made of a tuple of key fields,   */
+/*      a FID and an optional opaque payload.  Records are kept in      */
+/*      memory up to a budget, beyond which sorted runs are spilled     */
+/*      to temporary files and merged back when read.                   */
+/************************************************************************/
+
+typedef int (*OGRGenSQLSortCompareFunc)( void *pUserData, 
+                                         OGRField *pasFirst,
+                                         OGRField *pasSecond );
+
+typedef struct _OGRGenSQLSortSource OGRGenSQLSortSource;
+
+class OGRGenSQLSorter
+{
+    int         nKeyCount;
+    OGRFieldType *paeKeyTypes;
+    OGRGenSQLSortCompareFunc pfnCompare;
+    void       *pUserData;
+    GIntBig     nMaxMemory;
+    int         bFailed;
+
+    /* records of the current in memory run */
+    int         nRecordCount;
+    int         nRecordMax;
+    GByte     **papabyRecords;
+    OGRField   *pasKeys;
+    int        *panOrder;
+
+    GByte     **papabyBlocks;
+    int         nBlockCount;
+    int         nBlockUsed;
+    int         nBlockSize;
+    GIntBig     nMemoryUsed;
+
+    /* spilled runs, and merge state */
+    char      **papszRunFiles;
+    int         nRunCount;
+    OGRGenSQLSortSource *pasSources;
+    int         nSourceCount;
+    int         iLastSource;
+    GIntBig     nTotalCount;
+    GIntBig     nNextRecord;
+
+    GByte      *AllocRecord( int nSize );
+    void        FreeRecords();
+    int         DecodeKeys( const GByte *pabyRecord, OGRField *pasOut );
+    void        SortSection( int *panTmp, int nStart, int nEntries );
+    void        SortRun();
+    int         SpillRun();
+    int         MergeRuns( int iFirstRun, int nRuns );
+
+    OGRGenSQLSortSource *OpenSources( int iFirstRun, int nRuns, 
+                                      int bWithMemoryRun,
+                                      int *pnSourceCount );
+    int         ReadSource( OGRGenSQLSortSource *psSource );
+    int         SelectSource( OGRGenSQLSortSource *pasSrc, int nSrc );
+    void        CloseSources( OGRGenSQLSortSource *pasSrc, int nSrc );
+
+  public:
+                OGRGenSQLSorter( int nKeyCount, OGRFieldType *paeKeyTypes,
+                                 OGRGenSQLSortCompareFunc pfnCompare,
+                                 void *pUserData, GIntBig nMaxMemory );
+                ~OGRGenSQLSorter();
+
+    int         AddRecord( OGRField *pasKeys, long nFID,
+                           const GByte *pabyPayload, int nPayloadSize );
+    int         Finish();
+
+    int         IsExternal() { return nRunCount > 0; }
+    GIntBig     GetRecordCount() { return nTotalCount; }
+    GIntBig     GetNextRecordIndex() { return nNextRecord; }
+
+    int         Rewind();
+    int         GetNextRecord( long *pnFID, const GByte **ppabyPayload,
+                               int *pnPayloadSize );
+};
+
 /************************************************************************/
 /*                        OGRGenSQLResultsLayer                         */
 /************************************************************************/
@@ -59,14 +139,39 @@ class CPL_DLL OGRGenSQLResultsLayer : public OGRLayer
 
     OGRField    *pasOrderByIndex;
 
+    /* ORDER BY results read back from the sorter, rather than through
+       panFIDIndex, when they were spilled to disk or carry features. */
+    OGRGenSQLSorter *poSorter;
+    int         bSortedFeatures;
+
     int         nExtraDSCount;
     OGRDataSource **papoExtraDS;
 
+    /* Per join hash tables of the secondary layer, keyed on join field. */
+    void      **papJoinHash;
+    int        *panJoinHashState;
+
+    /* Candidate FIDs of the WHERE clause from attribute indexes of the
+       source layer, and of the spatial filter from its spatial index,
+       read with GetFeature() instead of scanning it. */
+    OGRFeatureQuery *poIndexQuery;
+    long       *panMatchingFIDs;
+    long       *panReadFIDs;
+    int         iNextMatchingFID;
+    int         bIndexScanDone;
+    int         bReadFIDsDone;
+
+    int         ScanSrcIndices();
+    OGRFeature *GetNextSrcFeature();
+
     OGRFeature *TranslateFeature( OGRFeature * );
+    int         BuildJoinHash( int iJoin );
+    OGRFeature *LookupJoinHash( int iJoin, OGRFeature *poSrcFeat );
     void        CreateOrderByIndex();
-    void        SortIndexSection( OGRField *pasIndexFields, 
-                                  int nStart, int nEntries );
     int         Compare( OGRField *pasFirst, OGRField *pasSecond );
+    static int  SortCompare( void *pUserData, OGRField *pasFirst,
+                             OGRField *pasSecond );
+    OGRFeature *GetSortedFeature( long nIndex );
 
     void        ClearFilters();
     
@@ -0,0 +1,893 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  Implements OGRGenSQLSorter, the external merge sort used for
+ *           ORDER BY by the generic ExecuteSQL() implementation.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_gensql.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+CPL_CVSID("$Id$");
+
+/* Records are laid out, in memory as in the run files, as :
+ *
+ *   GUInt32 record size, GUInt32 payload offset, GIntBig FID,
+ *   the keys, and the payload.
+ *
+ * Each key is a set flag byte followed, if set, by 4 bytes for an
+ * integer, 8 bytes for a real, a 4 byte length and the zero terminated
+ * characters for a string, and the raw OGRField for a date or time.
+ * Decoded string keys point into the record.
+ */
+
+#define SORT_HEADER_SIZE        16
+#define SORT_BLOCK_SIZE         (1024 * 1024)
+
+/* Beyond this number of spilled runs, runs are first merged together. */
+#define SORT_MAX_MERGE_WIDTH    64
+
+struct _OGRGenSQLSortSource
+{
+    FILE       *fp;             /* NULL for the in memory run */
+    int         iNext;          /* in memory run position */
+
+    GByte      *pabyBuffer;
+    int         nBufferSize;
+    OGRField   *pasKeyBuffer;
+
+    GByte      *pabyRecord;     /* current record, or NULL at end */
+    OGRField   *pasKeys;
+};
+
+/************************************************************************/
+/*                          OGRGenSQLSorter()                           */
+/************************************************************************/
+
+OGRGenSQLSorter::OGRGenSQLSorter( int nKeyCount, OGRFieldType *paeKeyTypes,
+                                  OGRGenSQLSortCompareFunc pfnCompare,
+                                  void *pUserData, GIntBig nMaxMemory )
+
+{
+    this->nKeyCount = nKeyCount;
+    this->paeKeyTypes = (OGRFieldType *)
+        CPLMalloc( sizeof(OGRFieldType) * MAX(1,nKeyCount) );
+    memcpy( this->paeKeyTypes, paeKeyTypes,
+            sizeof(OGRFieldType) * nKeyCount );
+    this->pfnCompare = pfnCompare;
+    this->pUserData = pUserData;
+    this->nMaxMemory = nMaxMemory;
+    bFailed = FALSE;
+
+    nRecordCount = 0;
+    nRecordMax = 0;
+    papabyRecords = NULL;
+    pasKeys = NULL;
+    panOrder = NULL;
+
+    papabyBlocks = NULL;
+    nBlockCount = 0;
+    nBlockUsed = 0;
+    nBlockSize = 0;
+    nMemoryUsed = 0;
+
+    papszRunFiles = NULL;
+    nRunCount = 0;
+    pasSources = NULL;
+    nSourceCount = 0;
+    iLastSource = -1;
+    nTotalCount = 0;
+    nNextRecord = 0;
+}
+
+/************************************************************************/
+/*                          ~OGRGenSQLSorter()                          */
+/************************************************************************/
+
+OGRGenSQLSorter::~OGRGenSQLSorter()
+
+{
+    CloseSources( pasSources, nSourceCount );
+    FreeRecords();
+
+    CPLFree( papabyRecords );
+    CPLFree( pasKeys );
+    CPLFree( panOrder );
+    CPLFree( paeKeyTypes );
+
+    for( int iRun = 0; iRun < nRunCount; iRun++ )
+        VSIUnlink( papszRunFiles[iRun] );
+    CSLDestroy( papszRunFiles );
+}
+
+/************************************************************************/
+/*                            AllocRecord()                             */
+/*                                                                      */
+/*      Allocate a record in the blocks of the in memory run.           */
+/************************************************************************/
+
+GByte *OGRGenSQLSorter::AllocRecord( int nSize )
+
+{
+    if( nBlockCount == 0 || nBlockUsed + nSize > nBlockSize )
+    {
+        int nNewBlockSize = MAX(SORT_BLOCK_SIZE, nSize);
+        GByte *pabyBlock = (GByte *) VSIMalloc( nNewBlockSize );
+
+        if( pabyBlock == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Out of memory allocating a %d byte sort block.",
+                      nNewBlockSize );
+            return NULL;
+        }
+
+        papabyBlocks = (GByte **)
+            CPLRealloc( papabyBlocks, sizeof(GByte*) * (nBlockCount+1) );
+        papabyBlocks[nBlockCount++] = pabyBlock;
+        nBlockSize = nNewBlockSize;
+        nBlockUsed = 0;
+    }
+
+    GByte *pabyRecord = papabyBlocks[nBlockCount-1] + nBlockUsed;
+
+    nBlockUsed += nSize;
+    nMemoryUsed += nSize;
+
+    return pabyRecord;
+}
+
+/************************************************************************/
+/*                            FreeRecords()                             */
+/*                                                                      */
+/*      Empty the in memory run.                                        */
+/************************************************************************/
+
+void OGRGenSQLSorter::FreeRecords()
+
+{
+    for( int iBlock = 0; iBlock < nBlockCount; iBlock++ )
+        CPLFree( papabyBlocks[iBlock] );
+    CPLFree( papabyBlocks );
+
+    papabyBlocks = NULL;
+    nBlockCount = 0;
+    nBlockUsed = 0;
+    nBlockSize = 0;
+    nRecordCount = 0;
+    nMemoryUsed = 0;
+}
+
+/************************************************************************/
+/*                             DecodeKeys()                             */
+/*                                                                      */
+/*      Decode the keys of a record, returning the size of the          */
+/*      record in bytes.                                                */
+/************************************************************************/
+
+int OGRGenSQLSorter::DecodeKeys( const GByte *pabyRecord, OGRField *pasOut )
+
+{
+    const GByte *pabyKey = pabyRecord + SORT_HEADER_SIZE;
+    GUInt32 nSize;
+
+    for( int iKey = 0; iKey < nKeyCount; iKey++ )
+    {
+        OGRField *psField = pasOut + iKey;
+
+        if( *(pabyKey++) == 0 )
+        {
+            psField->Set.nMarker1 = OGRUnsetMarker;
+            psField->Set.nMarker2 = OGRUnsetMarker;
+            continue;
+        }
+
+        switch( paeKeyTypes[iKey] )
+        {
+          case OFTInteger:
+            memcpy( &(psField->Integer), pabyKey, 4 );
+            pabyKey += 4;
+            break;
+
+          case OFTReal:
+            memcpy( &(psField->Real), pabyKey, 8 );
+            pabyKey += 8;
+            break;
+
+          case OFTString:
+            memcpy( &nSize, pabyKey, 4 );
+            psField->String = (char *) (pabyKey + 4);
+            pabyKey += 4 + nSize + 1;
+            break;
+
+          case OFTDate:
+          case OFTTime:
+          case OFTDateTime:
+            memcpy( psField, pabyKey, sizeof(OGRField) );
+            pabyKey += sizeof(OGRField);
+            break;
+
+          default:
+            memset( psField, 0, sizeof(OGRField) );
+            break;
+        }
+    }
+
+    memcpy( &nSize, pabyRecord, 4 );
+
+    return (int) nSize;
+}
+
+/************************************************************************/
+/*                             AddRecord()                              */
+/*                                                                      */
+/*      Add a record, spilling the in memory run to a temporary file    */
+/*      once it is over the memory budget.  String keys are copied.     */
+/************************************************************************/
+
+int OGRGenSQLSorter::AddRecord( OGRField *pasRecordKeys, long nFID,
+                                const GByte *pabyPayload, int nPayloadSize )
+
+{
+    if( bFailed )
+        return FALSE;
+
+/* -------------------------------------------------------------------- */
+/*      Compute the record size.                                        */
+/* -------------------------------------------------------------------- */
+    int nSize = SORT_HEADER_SIZE, iKey;
+
+    for( iKey = 0; iKey < nKeyCount; iKey++ )
+    {
+        OGRField *psField = pasRecordKeys + iKey;
+
+        nSize++;
+        if( psField->Set.nMarker1 == OGRUnsetMarker
+            && psField->Set.nMarker2 == OGRUnsetMarker )
+            continue;
+
+        switch( paeKeyTypes[iKey] )
+        {
+          case OFTInteger:
+            nSize += 4;
+            break;
+          case OFTReal:
+            nSize += 8;
+            break;
+          case OFTString:
+            nSize += 4 + strlen(psField->String) + 1;
+            break;
+          case OFTDate:
+          case OFTTime:
+          case OFTDateTime:
+            nSize += sizeof(OGRField);
+            break;
+          default:
+            break;
+        }
+    }
+
+    GUInt32 nPayloadOffset = nSize;
+
+    nSize += nPayloadSize;
+
+/* -------------------------------------------------------------------- */
+/*      Grow the record arrays.                                         */
+/* -------------------------------------------------------------------- */
+    if( nRecordCount == nRecordMax )
+    {
+        nRecordMax = nRecordMax * 2 + 1024;
+        papabyRecords = (GByte **)
+            VSIRealloc( papabyRecords, sizeof(GByte*) * nRecordMax );
+        OGRField *pasNewKeys = (OGRField *)
+            VSIRealloc( pasKeys, sizeof(OGRField) * nRecordMax * nKeyCount );
+        if( pasNewKeys != NULL || nKeyCount == 0 )
+            pasKeys = pasNewKeys;
+
+        if( papabyRecords == NULL || (pasNewKeys == NULL && nKeyCount > 0) )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Out of memory growing the sort index." );
+            bFailed = TRUE;
+            return FALSE;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Encode the record.                                              */
+/* -------------------------------------------------------------------- */
+    GByte *pabyRecord = AllocRecord( nSize );
+    GByte *pabyKey = pabyRecord + SORT_HEADER_SIZE;
+    GIntBig nFID64 = nFID;
+    GUInt32 nSize32 = nSize;
+
+    if( pabyRecord == NULL )
+    {
+        bFailed = TRUE;
+        return FALSE;
+    }
+
+    memcpy( pabyRecord, &nSize32, 4 );
+    memcpy( pabyRecord + 4, &nPayloadOffset, 4 );
+    memcpy( pabyRecord + 8, &nFID64, 8 );
+
+    for( iKey = 0; iKey < nKeyCount; iKey++ )
+    {
+        OGRField *psField = pasRecordKeys + iKey;
+
+        if( psField->Set.nMarker1 == OGRUnsetMarker
+            && psField->Set.nMarker2 == OGRUnsetMarker )
+        {
+            *(pabyKey++) = 0;
+            continue;
+        }
+
+        *(pabyKey++) = 1;
+
+        switch( paeKeyTypes[iKey] )
+        {
+          case OFTInteger:
+            memcpy( pabyKey, &(psField->Integer), 4 );
+            pabyKey += 4;
+            break;
+
+          case OFTReal:
+            memcpy( pabyKey, &(psField->Real), 8 );
+            pabyKey += 8;
+            break;
+
+          case OFTString:
+          {
+              GUInt32 nLength = strlen(psField->String);
+
+              memcpy( pabyKey, &nLength, 4 );
+              memcpy( pabyKey + 4, psField->String, nLength + 1 );
+              pabyKey += 4 + nLength + 1;
+              break;
+          }
+
+          case OFTDate:
+          case OFTTime:
+          case OFTDateTime:
+            memcpy( pabyKey, psField, sizeof(OGRField) );
+            pabyKey += sizeof(OGRField);
+            break;
+
+          default:
+            break;
+        }
+    }
+
+    if( nPayloadSize > 0 )
+        memcpy( pabyRecord + nPayloadOffset, pabyPayload, nPayloadSize );
+
+    papabyRecords[nRecordCount] = pabyRecord;
+    DecodeKeys( pabyRecord, pasKeys + nRecordCount * nKeyCount );
+    nRecordCount++;
+    nTotalCount++;
+
+    nMemoryUsed += sizeof(GByte*) + sizeof(int)
+        + sizeof(OGRField) * nKeyCount;
+
+/* -------------------------------------------------------------------- */
+/*      Spill the run if we are over budget.                            */
+/* -------------------------------------------------------------------- */
+    if( nMemoryUsed > nMaxMemory && !SpillRun() )
+    {
+        bFailed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                            SortSection()                             */
+/*                                                                      */
+/*      Stable merge sort of a section of panOrder, using the same      */
+/*      splitting and tie breaking as the former in memory ORDER BY.    */
+/************************************************************************/
+
+void OGRGenSQLSorter::SortSection( int *panTmp, int nStart, int nEntries )
+
+{
+    if( nEntries < 2 )
+        return;
+
+    int nFirstGroup = nEntries / 2;
+    int nFirstStart = nStart;
+    int nSecondGroup = nEntries - nFirstGroup;
+    int nSecondStart = nStart + nFirstGroup;
+    int iMerge = 0;
+
+    SortSection( panTmp, nFirstStart, nFirstGroup );
+    SortSection( panTmp, nSecondStart, nSecondGroup );
+
+    while( iMerge < nEntries )
+    {
+        int  nResult;
+
+        if( nFirstGroup == 0 )
+            nResult = -1;
+        else if( nSecondGroup == 0 )
+            nResult = 1;
+        else
+            nResult = pfnCompare( pUserData,
+                                  pasKeys + panOrder[nFirstStart] * nKeyCount,
+                                  pasKeys + panOrder[nSecondStart] * nKeyCount );
+
+        if( nResult < 0 )
+        {
+            panTmp[iMerge++] = panOrder[nSecondStart++];
+            nSecondGroup--;
+        }
+        else
+        {
+            panTmp[iMerge++] = panOrder[nFirstStart++];
+            nFirstGroup--;
+        }
+    }
+
+    memcpy( panOrder + nStart, panTmp, sizeof(int) * nEntries );
+}
+
+/************************************************************************/
+/*                              SortRun()                               */
+/************************************************************************/
+
+void OGRGenSQLSorter::SortRun()
+
+{
+    int *panTmp;
+
+    CPLFree( panOrder );
+    panOrder = (int *) CPLMalloc( sizeof(int) * MAX(1,nRecordCount) );
+    panTmp = (int *) CPLMalloc( sizeof(int) * MAX(1,nRecordCount) );
+
+    for( int i = 0; i < nRecordCount; i++ )
+        panOrder[i] = i;
+
+    SortSection( panTmp, 0, nRecordCount );
+
+    CPLFree( panTmp );
+}
+
+/************************************************************************/
+/*                              SpillRun()                              */
+/*                                                                      */
+/*      Sort the in memory run and write it to a temporary file.        */
+/************************************************************************/
+
+int OGRGenSQLSorter::SpillRun()
+
+{
+    if( nRecordCount == 0 )
+        return TRUE;
+
+    SortRun();
+
+    CPLString osFilename = CPLGenerateTempFilename( "ogrsort" );
+    FILE *fp = VSIFOpenL( osFilename, "wb" );
+    int  i, bOK = (fp != NULL);
+
+    for( i = 0; bOK && i < nRecordCount; i++ )
+    {
+        GByte *pabyRecord = papabyRecords[panOrder[i]];
+        GUInt32 nSize;
+
+        memcpy( &nSize, pabyRecord, 4 );
+        bOK = VSIFWriteL( pabyRecord, 1, nSize, fp ) == nSize;
+    }
+
+    if( fp != NULL && VSIFCloseL( fp ) != 0 )
+        bOK = FALSE;
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to write sort run to %s.", osFilename.c_str() );
+        VSIUnlink( osFilename );
+        return FALSE;
+    }
+
+    papszRunFiles = CSLAddString( papszRunFiles, osFilename );
+    nRunCount++;
+
+    CPLDebug( "GenSQL", "Spilled sort run of %d records to %s.",
+              nRecordCount, osFilename.c_str() );
+
+    FreeRecords();
+    CPLFree( panOrder );
+    panOrder = NULL;
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                            OpenSources()                             */
+/*                                                                      */
+/*      Open nRuns spilled runs from iFirstRun, and optionally the      */
+/*      in memory run after them, positioned on their first record.     */
+/************************************************************************/
+
+OGRGenSQLSortSource *OGRGenSQLSorter::OpenSources( int iFirstRun, int nRuns,
+                                                   int bWithMemoryRun,
+                                                   int *pnSourceCount )
+
+{
+    int nSrc = nRuns + (bWithMemoryRun ? 1 : 0);
+    OGRGenSQLSortSource *pasSrc = (OGRGenSQLSortSource *)
+        CPLCalloc( sizeof(OGRGenSQLSortSource), MAX(1,nSrc) );
+
+    *pnSourceCount = nSrc;
+
+    for( int iSrc = 0; iSrc < nSrc; iSrc++ )
+    {
+        OGRGenSQLSortSource *psSource = pasSrc + iSrc;
+
+        if( iSrc < nRuns )
+        {
+            const char *pszFilename = papszRunFiles[iFirstRun + iSrc];
+
+            psSource->fp = VSIFOpenL( pszFilename, "rb" );
+            if( psSource->fp == NULL )
+            {
+                CPLError( CE_Failure, CPLE_OpenFailed,
+                          "Failed to reopen sort run %s.", pszFilename );
+                CloseSources( pasSrc, nSrc );
+                return NULL;
+            }
+            psSource->pasKeyBuffer = (OGRField *)
+                CPLMalloc( sizeof(OGRField) * MAX(1,nKeyCount) );
+        }
+
+        if( !ReadSource( psSource ) )
+        {
+            CloseSources( pasSrc, nSrc );
+            return NULL;
+        }
+    }
+
+    return pasSrc;
+}
+
+/************************************************************************/
+/*                            CloseSources()                            */
+/************************************************************************/
+
+void OGRGenSQLSorter::CloseSources( OGRGenSQLSortSource *pasSrc, int nSrc )
+
+{
+    if( pasSrc == NULL )
+        return;
+
+    for( int iSrc = 0; iSrc < nSrc; iSrc++ )
+    {
+        if( pasSrc[iSrc].fp != NULL )
+            VSIFCloseL( pasSrc[iSrc].fp );
+        CPLFree( pasSrc[iSrc].pabyBuffer );
+        CPLFree( pasSrc[iSrc].pasKeyBuffer );
+    }
+
+    CPLFree( pasSrc );
+}
+
+/************************************************************************/
+/*                             ReadSource()                             */
+/*                                                                      */
+/*      Advance a source to its next record.  Returns FALSE on read     */
+/*      error only, the end of the source being signaled by a NULL      */
+/*      pabyRecord.                                                     */
+/************************************************************************/
+
+int OGRGenSQLSorter::ReadSource( OGRGenSQLSortSource *psSource )
+
+{
+    psSource->pabyRecord = NULL;
+
+/* -------------------------------------------------------------------- */
+/*      The in memory run.                                              */
+/* -------------------------------------------------------------------- */
+    if( psSource->fp == NULL )
+    {
+        if( psSource->iNext < nRecordCount )
+        {
+            int iRecord = panOrder[psSource->iNext++];
+
+            psSource->pabyRecord = papabyRecords[iRecord];
+            psSource->pasKeys = pasKeys + iRecord * nKeyCount;
+        }
+        return TRUE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      A spilled run.                                                  */
+/* -------------------------------------------------------------------- */
+    GUInt32 nSize;
+
+    if( VSIFReadL( &nSize, 1, 4, psSource->fp ) != 4 )
+        return TRUE;
+
+    if( nSize < SORT_HEADER_SIZE || nSize > 0x7fffffff )
+    {
+        CPLError( CE_Failure, CPLE_FileIO, "Corrupted sort run." );
+        return FALSE;
+    }
+
+    if( (int) nSize > psSource->nBufferSize )
+    {
+        GByte *pabyNew = (GByte *) VSIRealloc( psSource->pabyBuffer, nSize );
+
+        if( pabyNew == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Out of memory reading a %u byte sort record.",
+                      nSize );
+            return FALSE;
+        }
+        psSource->pabyBuffer = pabyNew;
+        psSource->nBufferSize = nSize;
+    }
+
+    memcpy( psSource->pabyBuffer, &nSize, 4 );
+    if( VSIFReadL( psSource->pabyBuffer + 4, 1, nSize - 4, psSource->fp )
+        != nSize - 4 )
+    {
+        CPLError( CE_Failure, CPLE_FileIO, "Truncated sort run." );
+        return FALSE;
+    }
+
+    psSource->pabyRecord = psSource->pabyBuffer;
+    psSource->pasKeys = psSource->pasKeyBuffer;
+    DecodeKeys( psSource->pabyRecord, psSource->pasKeys );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                            SelectSource()                            */
+/*                                                                      */
+/*      Return the source whose current record comes first, the        */
+/*      earliest source winning ties, or -1 when all are exhausted.     */
+/************************************************************************/
+
+int OGRGenSQLSorter::SelectSource( OGRGenSQLSortSource *pasSrc, int nSrc )
+
+{
+    int iBest = -1;
+
+    for( int iSrc = 0; iSrc < nSrc; iSrc++ )
+    {
+        if( pasSrc[iSrc].pabyRecord == NULL )
+            continue;
+
+        if( iBest < 0
+            || pfnCompare( pUserData, pasSrc[iBest].pasKeys,
+                           pasSrc[iSrc].pasKeys ) < 0 )
+            iBest = iSrc;
+    }
+
+    return iBest;
+}
+
+/************************************************************************/
+/*                             MergeRuns()                              */
+/*                                                                      */
+/*      Merge the nRuns spilled runs starting at iFirstRun into a       */
+/*      single run, which takes their place in the run list.            */
+/************************************************************************/
+
+int OGRGenSQLSorter::MergeRuns( int iFirstRun, int nRuns )
+
+{
+    int nSrc, iSrc, bOK = TRUE;
+    OGRGenSQLSortSource *pasSrc = 
+        OpenSources( iFirstRun, nRuns, FALSE, &nSrc );
+
+    if( pasSrc == NULL )
+        return FALSE;
+
+    CPLString osFilename = CPLGenerateTempFilename( "ogrsort" );
+    FILE *fp = VSIFOpenL( osFilename, "wb" );
+
+    if( fp == NULL )
+        bOK = FALSE;
+
+    while( bOK && (iSrc = SelectSource( pasSrc, nSrc )) >= 0 )
+    {
+        GUInt32 nSize;
+
+        memcpy( &nSize, pasSrc[iSrc].pabyRecord, 4 );
+        bOK = VSIFWriteL( pasSrc[iSrc].pabyRecord, 1, nSize, fp ) == nSize
+            && ReadSource( pasSrc + iSrc );
+    }
+
+    CloseSources( pasSrc, nSrc );
+
+    if( fp != NULL && VSIFCloseL( fp ) != 0 )
+        bOK = FALSE;
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to write merged sort run to %s.",
+                  osFilename.c_str() );
+        VSIUnlink( osFilename );
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Replace the merged runs by the new one.                         */
+/* -------------------------------------------------------------------- */
+    char **papszNewRunFiles = NULL;
+
+    for( iSrc = 0; iSrc < nRunCount; iSrc++ )
+    {
+        if( iSrc == iFirstRun )
+            papszNewRunFiles = CSLAddString( papszNewRunFiles, osFilename );
+
+        if( iSrc >= iFirstRun && iSrc < iFirstRun + nRuns )
+            VSIUnlink( papszRunFiles[iSrc] );
+        else
+            papszNewRunFiles =
+                CSLAddString( papszNewRunFiles, papszRunFiles[iSrc] );
+    }
+
+    CSLDestroy( papszRunFiles );
+    papszRunFiles = papszNewRunFiles;
+    nRunCount = nRunCount - nRuns + 1;
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                               Finish()                               */
+/*                                                                      */
+/*      Called once all records are added.  Sorts the in memory run,    */
+/*      merges groups of consecutive spilled runs, in as many passes    */
+/*      as needed for the rest to be merged while reading, and          */
+/*      prepares reading.                                               */
+/************************************************************************/
+
+int OGRGenSQLSorter::Finish()
+
+{
+    if( bFailed )
+        return FALSE;
+
+    SortRun();
+
+    while( nRunCount + 1 > SORT_MAX_MERGE_WIDTH )
+    {
+        for( int iRun = 0; iRun < nRunCount - 1; iRun++ )
+        {
+            if( !MergeRuns( iRun, MIN(SORT_MAX_MERGE_WIDTH, 
+                                      nRunCount - iRun) ) )
+            {
+                bFailed = TRUE;
+                return FALSE;
+            }
+        }
+    }
+
+    if( nRunCount > 0 )
+        CPLDebug( "GenSQL", "Merging %d sort runs and %d records in memory.",
+                  nRunCount, nRecordCount );
+
+    return Rewind();
+}
+
+/************************************************************************/
+/*                               Rewind()                               */
+/************************************************************************/
+
+int OGRGenSQLSorter::Rewind()
+
+{
+    if( bFailed )
+        return FALSE;
+
+    nNextRecord = 0;
+    iLastSource = -1;
+
+    if( pasSources != NULL )
+    {
+        for( int iSrc = 0; iSrc < nSourceCount; iSrc++ )
+        {
+            OGRGenSQLSortSource *psSource = pasSources + iSrc;
+
+            psSource->iNext = 0;
+            if( (psSource->fp != NULL
+                 && VSIFSeekL( psSource->fp, 0, SEEK_SET ) != 0)
+                || !ReadSource( psSource ) )
+            {
+                bFailed = TRUE;
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+    }
+
+    pasSources = OpenSources( 0, nRunCount, TRUE, &nSourceCount );
+    if( pasSources == NULL )
+    {
+        nSourceCount = 0;
+        bFailed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                           GetNextRecord()                            */
+/*                                                                      */
+/*      Fetch the next record in sorted order.  The payload remains     */
+/*      valid until the next call.                                      */
+/************************************************************************/
+
+int OGRGenSQLSorter::GetNextRecord( long *pnFID, const GByte **ppabyPayload,
+                                    int *pnPayloadSize )
+
+{
+    if( bFailed || pasSources == NULL )
+        return FALSE;
+
+    if( iLastSource >= 0 )
+    {
+        if( !ReadSource( pasSources + iLastSource ) )
+        {
+            bFailed = TRUE;
+            return FALSE;
+        }
+        iLastSource = -1;
+    }
+
+    int iSrc = SelectSource( pasSources, nSourceCount );
+
+    if( iSrc < 0 )
+        return FALSE;
+
+    const GByte *pabyRecord = pasSources[iSrc].pabyRecord;
+    GUInt32 nSize, nPayloadOffset;
+    GIntBig nFID64;
+
+    memcpy( &nSize, pabyRecord, 4 );
+    memcpy( &nPayloadOffset, pabyRecord + 4, 4 );
+    memcpy( &nFID64, pabyRecord + 8, 8 );
+
+    *pnFID = (long) nFID64;
+    if( ppabyPayload != NULL )
+        *ppabyPayload = pabyRecord + nPayloadOffset;
+    if( pnPayloadSize != NULL )
+        *pnPayloadSize = nSize - nPayloadOffset;
+
+    iLastSource = iSrc;
+    nNextRecord++;
+
+    return TRUE;
+}
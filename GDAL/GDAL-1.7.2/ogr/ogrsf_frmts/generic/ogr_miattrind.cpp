@@ -600,10 +600,10 @@ OGRErr OGRMILayerAttrIndex::RemoveFromIndex( OGRFeature * /*poFeature*/ )
 }
 
 /************************************************************************/
-/*                     OGRCreateDefaultLayerIndex()                     */
+/*                       OGRCreateMILayerIndex()                        */
 /************************************************************************/
 
-OGRLayerAttrIndex *OGRCreateDefaultLayerIndex()
+OGRLayerAttrIndex *OGRCreateMILayerIndex()
 
 {
     return new OGRMILayerAttrIndex();
@@ -0,0 +1,1180 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  Implementation of generic spatial indexes of layers as packed
+ *           R-trees kept in a sidecar file of the datasource.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_spatialind.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include <float.h>
+
+CPL_CVSID("$Id$");
+
+/* The .osi file of a datasource named "name" is "name.osi", and holds the
+ * spatial indexes of its layers.  Drivers may also keep their own .osi
+ * files through OGRReadSpatialIndexFile() and OGRWriteSpatialIndexFile().
+ * The layout is :
+ *
+ *   8 bytes signature "OGRSPI2\0", GInt32 layer count, and for each layer
+ *   GInt32 name length, the layer name, GIntBig total size and GIntBig
+ *   latest modification time of the files of the layer when its index
+ *   was written (see OGRGetSourceStamp()), GInt32 entry count, followed
+ *   by the boxes of all the levels of the tree (4 doubles each, min x,
+ *   min y, max x, max y) and the GIntBig FIDs of the entries.  All values
+ *   are LSB first.
+ *
+ * The index of a layer is ignored if its files were changed since.  The
+ * upper levels of an index are read on its first search, and the entries
+ * of a leaf node only when the search reaches it.
+ */
+
+#define OGR_SPATIALIND_SIGNATURE "OGRSPI2"
+
+typedef struct
+{
+    GUInt32     nHilbert;
+    int         iEntry;
+} OGRSpatialIndHilbertEntry;
+
+/************************************************************************/
+/*                        OGRLayerSpatialIndex()                        */
+/************************************************************************/
+
+OGRLayerSpatialIndex::OGRLayerSpatialIndex()
+
+{
+    nEntryCount = 0;
+    nGeometrylessCount = 0;
+    nLevelCount = 0;
+    panLevelEnd = NULL;
+    padfBoxes = NULL;
+    panFIDs = NULL;
+
+    pszFilename = NULL;
+    nFileOffset = 0;
+    bLoaded = TRUE;
+
+    fpSource = NULL;
+    padfUpperBoxes = NULL;
+}
+
+/************************************************************************/
+/*                       ~OGRLayerSpatialIndex()                        */
+/************************************************************************/
+
+OGRLayerSpatialIndex::~OGRLayerSpatialIndex()
+
+{
+    CPLFree( panLevelEnd );
+    CPLFree( padfBoxes );
+    CPLFree( panFIDs );
+    CPLFree( pszFilename );
+
+    CloseSource();
+}
+
+/************************************************************************/
+/*                            CloseSource()                             */
+/************************************************************************/
+
+void OGRLayerSpatialIndex::CloseSource()
+
+{
+    if( fpSource != NULL )
+        VSIFCloseL( fpSource );
+    fpSource = NULL;
+
+    CPLFree( padfUpperBoxes );
+    padfUpperBoxes = NULL;
+}
+
+/************************************************************************/
+/*                           ComputeLevels()                            */
+/*                                                                      */
+/*      Establish the end of each level in the box array, the           */
+/*      entries being level 0 and the root the last level.              */
+/************************************************************************/
+
+void OGRLayerSpatialIndex::ComputeLevels()
+
+{
+    int nCount = nEntryCount, nEnd = nEntryCount;
+
+    CPLFree( panLevelEnd );
+    panLevelEnd = NULL;
+    nLevelCount = 0;
+
+    if( nEntryCount == 0 )
+        return;
+
+    do
+    {
+        panLevelEnd = (int *)
+            CPLRealloc( panLevelEnd, sizeof(int) * (nLevelCount+1) );
+        panLevelEnd[nLevelCount++] = nEnd;
+
+        if( nCount == 1 )
+            break;
+
+        nCount = (nCount + OGR_SPATIALIND_NODE_SIZE - 1)
+            / OGR_SPATIALIND_NODE_SIZE;
+        nEnd += nCount;
+    } while( TRUE );
+}
+
+/************************************************************************/
+/*                         CountGeometryless()                          */
+/************************************************************************/
+
+void OGRLayerSpatialIndex::CountGeometryless()
+
+{
+    nGeometrylessCount = 0;
+
+    for( int i = 0; i < nEntryCount; i++ )
+    {
+        if( padfBoxes[i*4] == -DBL_MAX )
+            nGeometrylessCount++;
+    }
+}
+
+/************************************************************************/
+/*                       HasGeometrylessEntries()                       */
+/*                                                                      */
+/*      Are there features without geometry in the index?  Drivers      */
+/*      differ on whether those pass a spatial filter, so only the      */
+/*      driver itself can use an index that has some.                   */
+/************************************************************************/
+
+int OGRLayerSpatialIndex::HasGeometrylessEntries()
+
+{
+    if( Load() != OGRERR_NONE )
+        return TRUE;
+
+    return nGeometrylessCount > 0;
+}
+
+/************************************************************************/
+/*                            GetDataSize()                             */
+/*                                                                      */
+/*      Size in the .osi file of an index of nCount entries.            */
+/************************************************************************/
+
+vsi_l_offset OGRLayerSpatialIndex::GetDataSize( int nCount )
+
+{
+    vsi_l_offset nBoxCount = nCount;
+    int          nLevel = nCount;
+
+    while( nLevel > 1 )
+    {
+        nLevel = (nLevel + OGR_SPATIALIND_NODE_SIZE - 1)
+            / OGR_SPATIALIND_NODE_SIZE;
+        nBoxCount += nLevel;
+    }
+
+    return nBoxCount * 32 + (vsi_l_offset) nCount * 8;
+}
+
+/************************************************************************/
+/*                       OGRSpatialIndHilbert()                         */
+/*                                                                      */
+/*      Position along the Hilbert curve of a point of a 65536 x        */
+/*      65536 grid.                                                     */
+/************************************************************************/
+
+static GUInt32 OGRSpatialIndHilbert( GUInt32 nX, GUInt32 nY )
+
+{
+    GUInt32 nD = 0, nS;
+
+    for( nS = 1 << 15; nS > 0; nS >>= 1 )
+    {
+        GUInt32 nRX = (nX & nS) ? 1 : 0;
+        GUInt32 nRY = (nY & nS) ? 1 : 0;
+
+        nD += nS * nS * ((3 * nRX) ^ nRY);
+
+        if( nRY == 0 )
+        {
+            if( nRX == 1 )
+            {
+                nX = 65535 - nX;
+                nY = 65535 - nY;
+            }
+
+            GUInt32 nTmp = nX;
+            nX = nY;
+            nY = nTmp;
+        }
+    }
+
+    return nD;
+}
+
+/************************************************************************/
+/*                     OGRSpatialIndCompareHilbert()                    */
+/************************************************************************/
+
+static int OGRSpatialIndCompareHilbert( const void *pA, const void *pB )
+
+{
+    const OGRSpatialIndHilbertEntry *psA = (const OGRSpatialIndHilbertEntry*)pA;
+    const OGRSpatialIndHilbertEntry *psB = (const OGRSpatialIndHilbertEntry*)pB;
+
+    if( psA->nHilbert < psB->nHilbert )
+        return -1;
+    else if( psA->nHilbert > psB->nHilbert )
+        return 1;
+    else
+        return psA->iEntry - psB->iEntry;
+}
+
+/************************************************************************/
+/*                       OGRSpatialIndCompareFID()                      */
+/************************************************************************/
+
+static int OGRSpatialIndCompareFID( const void *pA, const void *pB )
+
+{
+    long nA = *((const long *) pA);
+    long nB = *((const long *) pB);
+
+    return (nA < nB) ? -1 : (nA > nB) ? 1 : 0;
+}
+
+/************************************************************************/
+/*                               Build()                                */
+/*                                                                      */
+/*      Pack the given feature envelopes.  The entries are sorted on    */
+/*      the Hilbert value of the center of their envelope in the        */
+/*      extent of the layer, so that nodes group nearby features.       */
+/*      Features without geometry, which match any spatial filter,      */
+/*      are to be passed with an envelope from -DBL_MAX to DBL_MAX.     */
+/************************************************************************/
+
+OGRErr OGRLayerSpatialIndex::Build( int nCount, const long *panFIDsIn,
+                                    const OGREnvelope *pasEnvelopes )
+
+{
+    int i;
+
+    CloseSource();
+    CPLFree( padfBoxes );
+    CPLFree( panFIDs );
+    CPLFree( pszFilename );
+    padfBoxes = NULL;
+    panFIDs = NULL;
+    pszFilename = NULL;
+    bLoaded = TRUE;
+
+    nEntryCount = nCount;
+    ComputeLevels();
+
+    if( nEntryCount == 0 )
+        return OGRERR_NONE;
+
+    padfBoxes = (double *)
+        VSIMalloc2( panLevelEnd[nLevelCount-1], 4 * sizeof(double) );
+    panFIDs = (long *) VSIMalloc2( nEntryCount, sizeof(long) );
+
+    OGRSpatialIndHilbertEntry *pasOrder = (OGRSpatialIndHilbertEntry *)
+        VSIMalloc2( nEntryCount, sizeof(OGRSpatialIndHilbertEntry) );
+
+    if( padfBoxes == NULL || panFIDs == NULL || pasOrder == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate spatial index of %d features.", nCount );
+        CPLFree( pasOrder );
+        nEntryCount = 0;
+        ComputeLevels();
+        return OGRERR_NOT_ENOUGH_MEMORY;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Order the entries along the Hilbert curve.                      */
+/* -------------------------------------------------------------------- */
+    OGREnvelope sExtent;
+    int         bExtentSet = FALSE;
+
+    for( i = 0; i < nEntryCount; i++ )
+    {
+        const OGREnvelope *psEnv = pasEnvelopes + i;
+
+        if( psEnv->MinX == -DBL_MAX )
+            continue;
+
+        if( !bExtentSet )
+        {
+            sExtent = *psEnv;
+            bExtentSet = TRUE;
+        }
+        else
+        {
+            sExtent.MinX = MIN(sExtent.MinX, psEnv->MinX);
+            sExtent.MinY = MIN(sExtent.MinY, psEnv->MinY);
+            sExtent.MaxX = MAX(sExtent.MaxX, psEnv->MaxX);
+            sExtent.MaxY = MAX(sExtent.MaxY, psEnv->MaxY);
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Features without geometry, and all of them if none has one,     */
+/*      get Hilbert value 0 and so stay in their given order.           */
+/* -------------------------------------------------------------------- */
+    double dfScaleX = 0.0, dfScaleY = 0.0;
+
+    if( bExtentSet && sExtent.MaxX > sExtent.MinX )
+        dfScaleX = 65535.0 / (sExtent.MaxX - sExtent.MinX);
+    if( bExtentSet && sExtent.MaxY > sExtent.MinY )
+        dfScaleY = 65535.0 / (sExtent.MaxY - sExtent.MinY);
+
+    for( i = 0; i < nEntryCount; i++ )
+    {
+        const OGREnvelope *psEnv = pasEnvelopes + i;
+
+        pasOrder[i].iEntry = i;
+
+        if( !bExtentSet || psEnv->MinX == -DBL_MAX )
+        {
+            pasOrder[i].nHilbert = 0;
+            continue;
+        }
+
+        double dfX = ((psEnv->MinX + psEnv->MaxX) * 0.5 - sExtent.MinX);
+        double dfY = ((psEnv->MinY + psEnv->MaxY) * 0.5 - sExtent.MinY);
+
+        pasOrder[i].nHilbert =
+            OGRSpatialIndHilbert( (GUInt32) MAX(0.0,MIN(65535.0,dfX*dfScaleX)),
+                                  (GUInt32) MAX(0.0,MIN(65535.0,dfY*dfScaleY)) );
+    }
+
+    qsort( pasOrder, nEntryCount, sizeof(OGRSpatialIndHilbertEntry),
+           OGRSpatialIndCompareHilbert );
+
+    for( i = 0; i < nEntryCount; i++ )
+    {
+        const OGREnvelope *psEnv = pasEnvelopes + pasOrder[i].iEntry;
+
+        panFIDs[i] = panFIDsIn[pasOrder[i].iEntry];
+        padfBoxes[i*4+0] = psEnv->MinX;
+        padfBoxes[i*4+1] = psEnv->MinY;
+        padfBoxes[i*4+2] = psEnv->MaxX;
+        padfBoxes[i*4+3] = psEnv->MaxY;
+    }
+
+    CPLFree( pasOrder );
+
+    CountGeometryless();
+
+/* -------------------------------------------------------------------- */
+/*      Each node of the upper levels is the union of the next          */
+/*      OGR_SPATIALIND_NODE_SIZE boxes of the level below.              */
+/* -------------------------------------------------------------------- */
+    int iLevel;
+
+    for( iLevel = 1; iLevel < nLevelCount; iLevel++ )
+    {
+        int iChild = (iLevel == 1) ? 0 : panLevelEnd[iLevel-2];
+        int iBox;
+
+        for( iBox = panLevelEnd[iLevel-1]; iBox < panLevelEnd[iLevel]; iBox++ )
+        {
+            int     iChildEnd = MIN(iChild + OGR_SPATIALIND_NODE_SIZE,
+                                    panLevelEnd[iLevel-1]);
+            double *padfBox = padfBoxes + iBox * 4;
+
+            memcpy( padfBox, padfBoxes + iChild * 4, 4 * sizeof(double) );
+
+            for( iChild++; iChild < iChildEnd; iChild++ )
+            {
+                const double *padfChild = padfBoxes + iChild * 4;
+
+                padfBox[0] = MIN(padfBox[0], padfChild[0]);
+                padfBox[1] = MIN(padfBox[1], padfChild[1]);
+                padfBox[2] = MAX(padfBox[2], padfChild[2]);
+                padfBox[3] = MAX(padfBox[3], padfChild[3]);
+            }
+        }
+    }
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                             SetSource()                              */
+/*                                                                      */
+/*      Declare where the index is to be read from on first use.        */
+/************************************************************************/
+
+void OGRLayerSpatialIndex::SetSource( const char *pszFilenameIn,
+                                      vsi_l_offset nOffset, int nCount )
+
+{
+    CloseSource();
+    CPLFree( padfBoxes );
+    CPLFree( panFIDs );
+    padfBoxes = NULL;
+    panFIDs = NULL;
+
+    CPLFree( pszFilename );
+    pszFilename = CPLStrdup( pszFilenameIn );
+    nFileOffset = nOffset;
+    bLoaded = FALSE;
+
+    nEntryCount = nCount;
+    ComputeLevels();
+}
+
+/************************************************************************/
+/*                                Load()                                */
+/************************************************************************/
+
+OGRErr OGRLayerSpatialIndex::Load()
+
+{
+    if( bLoaded )
+        return padfBoxes != NULL || nEntryCount == 0
+            ? OGRERR_NONE : OGRERR_FAILURE;
+
+    bLoaded = TRUE;
+    CloseSource();
+
+    if( nEntryCount == 0 )
+        return OGRERR_NONE;
+
+    int     nBoxCount = panLevelEnd[nLevelCount-1];
+    GIntBig *panFileFIDs;
+    FILE    *fp = VSIFOpenL( pszFilename, "rb" );
+    int     bOK, i;
+
+    padfBoxes = (double *) VSIMalloc2( nBoxCount, 4 * sizeof(double) );
+    panFIDs = (long *) VSIMalloc2( nEntryCount, sizeof(long) );
+    panFileFIDs = (GIntBig *) VSIMalloc2( nEntryCount, sizeof(GIntBig) );
+
+    bOK = fp != NULL && padfBoxes != NULL && panFIDs != NULL
+        && panFileFIDs != NULL
+        && VSIFSeekL( fp, nFileOffset, SEEK_SET ) == 0
+        && VSIFReadL( padfBoxes, 32, nBoxCount, fp ) == (size_t) nBoxCount
+        && VSIFReadL( panFileFIDs, 8, nEntryCount, fp )
+                                                    == (size_t) nEntryCount;
+
+    if( fp != NULL )
+        VSIFCloseL( fp );
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to read spatial index from %s.", pszFilename );
+        CPLFree( padfBoxes );
+        CPLFree( panFIDs );
+        CPLFree( panFileFIDs );
+        padfBoxes = NULL;
+        panFIDs = NULL;
+        return OGRERR_FAILURE;
+    }
+
+    for( i = 0; i < nBoxCount * 4; i++ )
+        CPL_LSBPTR64( padfBoxes + i );
+
+    CountGeometryless();
+
+    for( i = 0; i < nEntryCount; i++ )
+    {
+        CPL_LSBPTR64( panFileFIDs + i );
+        panFIDs[i] = (long) panFileFIDs[i];
+    }
+
+    CPLFree( panFileFIDs );
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                        OGRSpatialIndAddMatch()                       */
+/************************************************************************/
+
+static void OGRSpatialIndAddMatch( long **ppanMatches, int *pnMatchCount,
+                                   int *pnMatchMax, long nFID )
+
+{
+    if( *pnMatchCount == *pnMatchMax )
+    {
+        *pnMatchMax = *pnMatchMax * 2 + 64;
+        *ppanMatches = (long *)
+            CPLRealloc( *ppanMatches, sizeof(long) * *pnMatchMax );
+    }
+    (*ppanMatches)[(*pnMatchCount)++] = nFID;
+}
+
+/************************************************************************/
+/*                      OGRSpatialIndSortMatches()                      */
+/*                                                                      */
+/*      Put the matches in FID order, and terminate the list.           */
+/************************************************************************/
+
+static long *OGRSpatialIndSortMatches( long *panMatches, int nMatchCount )
+
+{
+    panMatches = (long *)
+        CPLRealloc( panMatches, sizeof(long) * (nMatchCount+1) );
+
+    qsort( panMatches, nMatchCount, sizeof(long), OGRSpatialIndCompareFID );
+    panMatches[nMatchCount] = OGRNullFID;
+
+    return panMatches;
+}
+
+/************************************************************************/
+/*                               Search()                               */
+/*                                                                      */
+/*      Return the FIDs of the features whose envelope intersects       */
+/*      the passed one, in increasing order, terminated by              */
+/*      OGRNullFID.  The list is to be freed with CPLFree().  NULL is   */
+/*      returned if the index could not be read.                        */
+/************************************************************************/
+
+long *OGRLayerSpatialIndex::Search( const OGREnvelope *psEnvelope )
+
+{
+    if( !bLoaded && nLevelCount > 1 )
+        return SearchSource( psEnvelope );
+
+    if( Load() != OGRERR_NONE )
+        return NULL;
+
+    int   nMatchCount = 0, nMatchMax = 0;
+    long *panMatches = NULL;
+
+    if( nEntryCount > 0 )
+    {
+/* -------------------------------------------------------------------- */
+/*      Walk down the tree from the root, stacking the boxes of the     */
+/*      nodes to visit along with their level.                          */
+/* -------------------------------------------------------------------- */
+        int  nStackMax = nLevelCount * OGR_SPATIALIND_NODE_SIZE + 1;
+        int *panStackBox = (int *) CPLMalloc( sizeof(int) * nStackMax );
+        int *panStackLevel = (int *) CPLMalloc( sizeof(int) * nStackMax );
+        int  nStackDepth = 0;
+
+        panStackBox[nStackDepth] = panLevelEnd[nLevelCount-1] - 1;
+        panStackLevel[nStackDepth++] = nLevelCount - 1;
+
+        while( nStackDepth > 0 )
+        {
+            nStackDepth--;
+
+            int           iBox = panStackBox[nStackDepth];
+            int           iLevel = panStackLevel[nStackDepth];
+            const double *padfBox = padfBoxes + iBox * 4;
+
+            if( padfBox[0] > psEnvelope->MaxX
+                || padfBox[1] > psEnvelope->MaxY
+                || padfBox[2] < psEnvelope->MinX
+                || padfBox[3] < psEnvelope->MinY )
+                continue;
+
+            if( iLevel == 0 )
+            {
+                OGRSpatialIndAddMatch( &panMatches, &nMatchCount, &nMatchMax,
+                                       panFIDs[iBox] );
+                continue;
+            }
+
+            int iLevelStart = (iLevel == 1) ? 0 : panLevelEnd[iLevel-2];
+            int iChild = iLevelStart + (iBox - panLevelEnd[iLevel-1])
+                * OGR_SPATIALIND_NODE_SIZE;
+            int iChildEnd = MIN(iChild + OGR_SPATIALIND_NODE_SIZE,
+                                panLevelEnd[iLevel-1]);
+
+            for( ; iChild < iChildEnd; iChild++ )
+            {
+                panStackBox[nStackDepth] = iChild;
+                panStackLevel[nStackDepth++] = iLevel - 1;
+            }
+        }
+
+        CPLFree( panStackBox );
+        CPLFree( panStackLevel );
+    }
+
+    return OGRSpatialIndSortMatches( panMatches, nMatchCount );
+}
+
+/************************************************************************/
+/*                            SearchSource()                            */
+/*                                                                      */
+/*      Search an index that is still in its file.  The boxes of the    */
+/*      upper levels, a small fraction of the tree, are read on the     */
+/*      first search and kept, while the boxes and FIDs of a leaf       */
+/*      node are only read when the node intersects the envelope.       */
+/************************************************************************/
+
+long *OGRLayerSpatialIndex::SearchSource( const OGREnvelope *psEnvelope )
+
+{
+    int nBoxCount = panLevelEnd[nLevelCount-1];
+    int nUpperCount = nBoxCount - nEntryCount;
+    int i;
+
+    if( fpSource == NULL )
+    {
+        fpSource = VSIFOpenL( pszFilename, "rb" );
+        padfUpperBoxes = (double *)
+            VSIMalloc2( nUpperCount, 4 * sizeof(double) );
+
+        if( fpSource == NULL || padfUpperBoxes == NULL
+            || VSIFSeekL( fpSource, nFileOffset
+                          + (vsi_l_offset) nEntryCount * 32, SEEK_SET ) != 0
+            || VSIFReadL( padfUpperBoxes, 32, nUpperCount, fpSource )
+                                                    != (size_t) nUpperCount )
+        {
+            CPLError( CE_Failure, CPLE_FileIO,
+                      "Failed to read spatial index from %s.", pszFilename );
+            CloseSource();
+            return NULL;
+        }
+
+        for( i = 0; i < nUpperCount * 4; i++ )
+            CPL_LSBPTR64( padfUpperBoxes + i );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Walk down the upper levels as Search() does, reading the        */
+/*      children of the intersecting nodes of level 1.                  */
+/* -------------------------------------------------------------------- */
+    int      nMatchCount = 0, nMatchMax = 0;
+    long    *panMatches = NULL;
+    int      nStackMax = nLevelCount * OGR_SPATIALIND_NODE_SIZE + 1;
+    int     *panStackBox = (int *) CPLMalloc( sizeof(int) * nStackMax );
+    int     *panStackLevel = (int *) CPLMalloc( sizeof(int) * nStackMax );
+    int      nStackDepth = 0, bOK = TRUE;
+    double   adfLeafBoxes[OGR_SPATIALIND_NODE_SIZE * 4];
+    GIntBig  anLeafFIDs[OGR_SPATIALIND_NODE_SIZE];
+
+    panStackBox[nStackDepth] = nBoxCount - 1;
+    panStackLevel[nStackDepth++] = nLevelCount - 1;
+
+    while( nStackDepth > 0 && bOK )
+    {
+        nStackDepth--;
+
+        int           iBox = panStackBox[nStackDepth];
+        int           iLevel = panStackLevel[nStackDepth];
+        const double *padfBox = padfUpperBoxes + (iBox - nEntryCount) * 4;
+
+        if( padfBox[0] > psEnvelope->MaxX
+            || padfBox[1] > psEnvelope->MaxY
+            || padfBox[2] < psEnvelope->MinX
+            || padfBox[3] < psEnvelope->MinY )
+            continue;
+
+        int iLevelStart = (iLevel == 1) ? 0 : panLevelEnd[iLevel-2];
+        int iChild = iLevelStart + (iBox - panLevelEnd[iLevel-1])
+            * OGR_SPATIALIND_NODE_SIZE;
+        int iChildEnd = MIN(iChild + OGR_SPATIALIND_NODE_SIZE,
+                            panLevelEnd[iLevel-1]);
+
+        if( iLevel > 1 )
+        {
+            for( ; iChild < iChildEnd; iChild++ )
+            {
+                panStackBox[nStackDepth] = iChild;
+                panStackLevel[nStackDepth++] = iLevel - 1;
+            }
+            continue;
+        }
+
+        int nLeafCount = iChildEnd - iChild;
+
+        bOK = VSIFSeekL( fpSource, nFileOffset + (vsi_l_offset) iChild * 32,
+                         SEEK_SET ) == 0
+            && VSIFReadL( adfLeafBoxes, 32, nLeafCount, fpSource )
+                                                    == (size_t) nLeafCount
+            && VSIFSeekL( fpSource, nFileOffset
+                          + (vsi_l_offset) nBoxCount * 32
+                          + (vsi_l_offset) iChild * 8, SEEK_SET ) == 0
+            && VSIFReadL( anLeafFIDs, 8, nLeafCount, fpSource )
+                                                    == (size_t) nLeafCount;
+
+        for( i = 0; bOK && i < nLeafCount; i++ )
+        {
+            double *padfLeaf = adfLeafBoxes + i * 4;
+
+            CPL_LSBPTR64( padfLeaf + 0 );
+            CPL_LSBPTR64( padfLeaf + 1 );
+            CPL_LSBPTR64( padfLeaf + 2 );
+            CPL_LSBPTR64( padfLeaf + 3 );
+
+            if( padfLeaf[0] > psEnvelope->MaxX
+                || padfLeaf[1] > psEnvelope->MaxY
+                || padfLeaf[2] < psEnvelope->MinX
+                || padfLeaf[3] < psEnvelope->MinY )
+                continue;
+
+            CPL_LSBPTR64( anLeafFIDs + i );
+            OGRSpatialIndAddMatch( &panMatches, &nMatchCount, &nMatchMax,
+                                   (long) anLeafFIDs[i] );
+        }
+    }
+
+    CPLFree( panStackBox );
+    CPLFree( panStackLevel );
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to read spatial index from %s.", pszFilename );
+        CPLFree( panMatches );
+        return NULL;
+    }
+
+    return OGRSpatialIndSortMatches( panMatches, nMatchCount );
+}
+
+/************************************************************************/
+/*                               Write()                                */
+/*                                                                      */
+/*      Write the boxes and the FIDs of the index, as expected by       */
+/*      Load().                                                         */
+/************************************************************************/
+
+OGRErr OGRLayerSpatialIndex::Write( FILE *fp )
+
+{
+    if( Load() != OGRERR_NONE )
+        return OGRERR_FAILURE;
+
+    if( nEntryCount == 0 )
+        return OGRERR_NONE;
+
+    int     nBoxCount = panLevelEnd[nLevelCount-1];
+    int     i, nChunk = 4096, bOK = TRUE;
+    double  adfBuffer[4096];
+    GIntBig anBuffer[4096];
+
+    for( i = 0; i < nBoxCount * 4 && bOK; i += nChunk )
+    {
+        int nThis = MIN(nChunk, nBoxCount * 4 - i), j;
+
+        for( j = 0; j < nThis; j++ )
+        {
+            adfBuffer[j] = padfBoxes[i+j];
+            CPL_LSBPTR64( adfBuffer + j );
+        }
+        bOK = VSIFWriteL( adfBuffer, 8, nThis, fp ) == (size_t) nThis;
+    }
+
+    for( i = 0; i < nEntryCount && bOK; i += nChunk )
+    {
+        int nThis = MIN(nChunk, nEntryCount - i), j;
+
+        for( j = 0; j < nThis; j++ )
+        {
+            anBuffer[j] = panFIDs[i+j];
+            CPL_LSBPTR64( anBuffer + j );
+        }
+        bOK = VSIFWriteL( anBuffer, 8, nThis, fp ) == (size_t) nThis;
+    }
+
+    return bOK ? OGRERR_NONE : OGRERR_FAILURE;
+}
+
+/************************************************************************/
+/*                         OGRGetSourceStamp()                          */
+/*                                                                      */
+/*      Total size and latest modification time of the files a layer    */
+/*      is read from, so that indexes written for it can be checked     */
+/*      against them.  If pszSource is a directory these are the        */
+/*      files of the directory named after the layer, whatever their    */
+/*      extension.  Otherwise they are pszSource and the files          */
+/*      sharing its basename, such as the .shx and .dbf of a .shp or    */
+/*      the .map and .dat of a .tab.  Index files are not counted.      */
+/************************************************************************/
+
+int OGRGetSourceStamp( const char *pszSource, const char *pszLayerName,
+                       GIntBig *panStamp )
+
+{
+    static const char *apszIndexExtensions[] =
+        { "osi", "obi", "qix", "sbn", "sbx", "idm", "ind", NULL };
+    VSIStatBufL sStat;
+    CPLString   osDir, osBasename;
+
+    if( pszSource == NULL )
+        return FALSE;
+
+    if( VSIStatL( pszSource, &sStat ) == 0 && VSI_ISDIR( sStat.st_mode ) )
+    {
+        if( pszLayerName == NULL )
+            return FALSE;
+        osDir = pszSource;
+        osBasename = pszLayerName;
+    }
+    else
+    {
+        osDir = CPLGetPath( pszSource );
+        osBasename = CPLGetBasename( pszSource );
+    }
+
+    char **papszFiles = VSIReadDir( osDir.size() ? osDir.c_str() : "." );
+    int    nFiles = 0;
+
+    panStamp[0] = 0;
+    panStamp[1] = 0;
+
+    for( int i = 0; papszFiles != NULL && papszFiles[i] != NULL; i++ )
+    {
+        if( !EQUAL(CPLGetBasename(papszFiles[i]), osBasename) )
+            continue;
+
+        const char *pszExtension = CPLGetExtension( papszFiles[i] );
+        int         iExt;
+
+        for( iExt = 0; apszIndexExtensions[iExt] != NULL; iExt++ )
+        {
+            if( EQUAL(pszExtension, apszIndexExtensions[iExt]) )
+                break;
+        }
+
+        if( apszIndexExtensions[iExt] != NULL
+            || VSIStatL( CPLFormFilename( osDir, papszFiles[i], NULL ),
+                         &sStat ) != 0
+            || VSI_ISDIR( sStat.st_mode ) )
+            continue;
+
+        panStamp[0] += (GIntBig) sStat.st_size;
+        panStamp[1] = MAX( panStamp[1], (GIntBig) sStat.st_mtime );
+        nFiles++;
+    }
+
+    CSLDestroy( papszFiles );
+
+    return nFiles > 0;
+}
+
+/************************************************************************/
+/*                      OGRReadSpatialIndexFile()                       */
+/*                                                                      */
+/*      Attach the spatial indexes found in an .osi file to the         */
+/*      passed layers of the same name, if they were written for the    */
+/*      current state of the files of the layer found from              */
+/*      pszSourceFile by OGRGetSourceStamp().  A missing index file     */
+/*      is not an error.                                                */
+/************************************************************************/
+
+OGRErr OGRReadSpatialIndexFile( const char *pszIndexFile,
+                                const char *pszSourceFile,
+                                int nLayerCount, OGRLayer **papoLayers )
+
+{
+    VSIStatBufL sStat;
+
+    if( VSIStatL( pszIndexFile, &sStat ) != 0 )
+        return OGRERR_NONE;
+
+    CPLString osIndexFile = pszIndexFile;
+    FILE     *fp = VSIFOpenL( osIndexFile, "rb" );
+    char      achSignature[8];
+    GInt32    nIndexCount;
+
+    if( fp == NULL )
+        return OGRERR_NONE;
+
+    if( VSIFReadL( achSignature, 8, 1, fp ) != 1
+        || memcmp( achSignature, OGR_SPATIALIND_SIGNATURE, 8 ) != 0
+        || VSIFReadL( &nIndexCount, 4, 1, fp ) != 1 )
+    {
+        VSIFCloseL( fp );
+        CPLError( CE_Warning, CPLE_AppDefined,
+                  "%s is not a spatial index file, ignoring it.",
+                  osIndexFile.c_str() );
+        return OGRERR_FAILURE;
+    }
+    CPL_LSBPTR32( &nIndexCount );
+
+    for( int i = 0; i < nIndexCount; i++ )
+    {
+        GInt32  nNameLength, nEntryCount;
+        GIntBig anFileStamp[2];
+        char  *pszName;
+
+        if( VSIFReadL( &nNameLength, 4, 1, fp ) != 1 )
+            break;
+        CPL_LSBPTR32( &nNameLength );
+
+        if( nNameLength < 0 || nNameLength > 65536 )
+            break;
+
+        pszName = (char *) CPLCalloc( 1, nNameLength + 1 );
+        if( VSIFReadL( pszName, 1, nNameLength, fp ) != (size_t) nNameLength
+            || VSIFReadL( anFileStamp, 8, 2, fp ) != 2
+            || VSIFReadL( &nEntryCount, 4, 1, fp ) != 1 )
+        {
+            CPLFree( pszName );
+            break;
+        }
+        CPL_LSBPTR64( anFileStamp + 0 );
+        CPL_LSBPTR64( anFileStamp + 1 );
+        CPL_LSBPTR32( &nEntryCount );
+
+        vsi_l_offset nOffset = VSIFTellL( fp );
+        OGRLayer    *poLayer = NULL;
+
+        for( int iLayer = 0; iLayer < nLayerCount; iLayer++ )
+        {
+            if( papoLayers[iLayer] != NULL
+                && EQUAL(papoLayers[iLayer]->GetLayerDefn()->GetName(),
+                         pszName) )
+            {
+                poLayer = papoLayers[iLayer];
+                break;
+            }
+        }
+
+        GIntBig anStamp[2];
+
+        if( nEntryCount >= 0 && poLayer != NULL
+            && (!OGRGetSourceStamp( pszSourceFile, pszName, anStamp )
+                || anFileStamp[0] != anStamp[0]
+                || anFileStamp[1] != anStamp[1]) )
+        {
+            CPLDebug( "OGR",
+                      "Layer %s has changed since %s was written, "
+                      "ignoring its spatial index.",
+                      pszName, osIndexFile.c_str() );
+        }
+        else if( nEntryCount >= 0 && poLayer != NULL )
+        {
+            OGRLayerSpatialIndex *poIndex = new OGRLayerSpatialIndex();
+
+            poIndex->SetSource( osIndexFile, nOffset, nEntryCount );
+            poLayer->SetSpatialIndex( poIndex );
+
+            CPLDebug( "OGR", "Found spatial index of %d features for "
+                      "layer %s in %s.",
+                      nEntryCount, pszName, osIndexFile.c_str() );
+        }
+
+        CPLFree( pszName );
+
+        if( nEntryCount < 0 )
+            break;
+
+        VSIFSeekL( fp, nOffset + OGRLayerSpatialIndex::GetDataSize(nEntryCount),
+                   SEEK_SET );
+    }
+
+    VSIFCloseL( fp );
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                      OGRWriteSpatialIndexFile()                      */
+/*                                                                      */
+/*      Rewrite an .osi file with the spatial indexes of the passed     */
+/*      layers that have one, each stamped with the current state of    */
+/*      its files found from pszSourceFile by OGRGetSourceStamp(), or   */
+/*      remove it if none has one.                                      */
+/************************************************************************/
+
+OGRErr OGRWriteSpatialIndexFile( const char *pszIndexFile,
+                                 const char *pszSourceFile,
+                                 int nLayerCount, OGRLayer **papoLayers )
+
+{
+    int         iLayer, nIndexCount = 0;
+
+    CPLString osIndexFile = pszIndexFile;
+
+/* -------------------------------------------------------------------- */
+/*      Make sure all indexes are in memory before we truncate the      */
+/*      file they may come from.                                        */
+/* -------------------------------------------------------------------- */
+    for( iLayer = 0; iLayer < nLayerCount; iLayer++ )
+    {
+        OGRLayer *poLayer = papoLayers[iLayer];
+
+        if( poLayer == NULL || poLayer->GetSpatialIndex() == NULL )
+            continue;
+
+        if( poLayer->GetSpatialIndex()->Load() != OGRERR_NONE )
+            return OGRERR_FAILURE;
+
+        nIndexCount++;
+    }
+
+    if( nIndexCount == 0 )
+    {
+        VSIStatBufL sStat;
+
+        if( VSIStatL( osIndexFile, &sStat ) == 0 )
+            VSIUnlink( osIndexFile );
+        return OGRERR_NONE;
+    }
+
+    FILE *fp = VSIFOpenL( osIndexFile, "wb" );
+    if( fp == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OpenFailed,
+                  "Failed to open `%s' for write.", osIndexFile.c_str() );
+        return OGRERR_FAILURE;
+    }
+
+    GInt32 nCount = nIndexCount;
+    int    bOK;
+
+    CPL_LSBPTR32( &nCount );
+    bOK = VSIFWriteL( (void *) OGR_SPATIALIND_SIGNATURE, 8, 1, fp ) == 1
+        && VSIFWriteL( &nCount, 4, 1, fp ) == 1;
+
+    for( iLayer = 0; iLayer < nLayerCount && bOK; iLayer++ )
+    {
+        OGRLayer *poLayer = papoLayers[iLayer];
+
+        if( poLayer == NULL || poLayer->GetSpatialIndex() == NULL )
+            continue;
+
+        OGRLayerSpatialIndex *poIndex = poLayer->GetSpatialIndex();
+        const char *pszName = poLayer->GetLayerDefn()->GetName();
+        GInt32      nNameLength = strlen(pszName);
+        GInt32      nEntryCount = poIndex->GetEntryCount();
+        GIntBig     anStamp[2];
+
+        if( !OGRGetSourceStamp( pszSourceFile, pszName, anStamp ) )
+        {
+            CPLDebug( "OGR", "No file found for layer %s of %s, its "
+                      "spatial index will not be reused.",
+                      pszName, pszSourceFile );
+            anStamp[0] = anStamp[1] = -1;
+        }
+
+        CPL_LSBPTR32( &nNameLength );
+        CPL_LSBPTR64( anStamp + 0 );
+        CPL_LSBPTR64( anStamp + 1 );
+        CPL_LSBPTR32( &nEntryCount );
+
+        bOK = VSIFWriteL( &nNameLength, 4, 1, fp ) == 1
+            && VSIFWriteL( (void *) pszName, 1, strlen(pszName), fp )
+                                                        == strlen(pszName)
+            && VSIFWriteL( anStamp, 8, 2, fp ) == 2
+            && VSIFWriteL( &nEntryCount, 4, 1, fp ) == 1
+            && poIndex->Write( fp ) == OGRERR_NONE;
+    }
+
+    if( VSIFCloseL( fp ) != 0 )
+        bOK = FALSE;
+
+    if( !bOK )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Failed to write `%s'.", osIndexFile.c_str() );
+        VSIUnlink( osIndexFile );
+        return OGRERR_FAILURE;
+    }
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                     OGRSpatialIndGetLayers()                         */
+/************************************************************************/
+
+static OGRLayer **OGRSpatialIndGetLayers( OGRDataSource *poDS )
+
+{
+    OGRLayer **papoLayers = (OGRLayer **)
+        CPLCalloc( sizeof(OGRLayer *), poDS->GetLayerCount() + 1 );
+
+    for( int iLayer = 0; iLayer < poDS->GetLayerCount(); iLayer++ )
+        papoLayers[iLayer] = poDS->GetLayer( iLayer );
+
+    return papoLayers;
+}
+
+/************************************************************************/
+/*                       OGRLoadSpatialIndexes()                        */
+/*                                                                      */
+/*      Attach the spatial indexes found in the .osi file of the        */
+/*      datasource, if any, to its layers.  This is done by the         */
+/*      driver registrar when a datasource is opened.                   */
+/************************************************************************/
+
+OGRErr OGRLoadSpatialIndexes( OGRDataSource *poDS )
+
+{
+    const char *pszName = poDS->GetName();
+    VSIStatBufL sStat;
+
+    if( pszName == NULL )
+        return OGRERR_NONE;
+
+    CPLString osIndexFile = CPLSPrintf( "%s.osi", pszName );
+
+    if( VSIStatL( osIndexFile, &sStat ) != 0 )
+        return OGRERR_NONE;
+
+    OGRLayer **papoLayers = OGRSpatialIndGetLayers( poDS );
+    OGRErr     eErr;
+
+    eErr = OGRReadSpatialIndexFile( osIndexFile, pszName,
+                                    poDS->GetLayerCount(), papoLayers );
+    CPLFree( papoLayers );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                       OGRSaveSpatialIndexes()                        */
+/*                                                                      */
+/*      Rewrite the .osi file of the datasource with the spatial        */
+/*      indexes of all its layers, or remove it if none has one.        */
+/*      Datasources that are not files only keep their indexes in       */
+/*      memory.                                                         */
+/************************************************************************/
+
+OGRErr OGRSaveSpatialIndexes( OGRDataSource *poDS )
+
+{
+    const char *pszName = poDS->GetName();
+    VSIStatBufL sStat;
+
+    if( pszName == NULL || VSIStatL( pszName, &sStat ) != 0 )
+        return OGRERR_NONE;
+
+    CPLString  osIndexFile = CPLSPrintf( "%s.osi", pszName );
+    OGRLayer **papoLayers = OGRSpatialIndGetLayers( poDS );
+    OGRErr     eErr;
+
+    eErr = OGRWriteSpatialIndexFile( osIndexFile, pszName,
+                                     poDS->GetLayerCount(), papoLayers );
+    CPLFree( papoLayers );
+
+    return eErr;
+}
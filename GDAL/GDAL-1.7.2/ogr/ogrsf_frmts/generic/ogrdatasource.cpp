@@ -32,6 +32,7 @@
 #include "ogr_p.h"
 #include "ogr_gensql.h"
 #include "ogr_attrind.h"
+#include "ogr_spatialind.h"
 #include "cpl_multiproc.h"
 
 CPL_CVSID("$Id: ogrdatasource.cpp 1 2011-07-16 23:22:47Z dcollins $");
@@ -549,12 +550,20 @@ OGRErr OGRDataSource::ProcessSQLCreateIndex( const char *pszSQLCommand )
     }
 
 /* -------------------------------------------------------------------- */
-/*      Does this layer even support attribute indexes?                 */
+/*      Read-only layers of drivers without attribute index support     */
+/*      get an index kept in memory for the life of the layer.  Their   */
+/*      features cannot change behind it, unlike those of writable      */
+/*      layers, whose drivers have to update the index themselves.      */
 /* -------------------------------------------------------------------- */
-    if( poLayer->GetIndex() == NULL )
+    if( poLayer->GetIndex() == NULL 
+        && (poLayer->TestCapability( OLCSequentialWrite )
+            || poLayer->TestCapability( OLCRandomWrite )
+            || poLayer->TestCapability( OLCDeleteFeature )
+            || poLayer->InitializeIndexSupport( NULL ) != OGRERR_NONE) )
     {
         CPLError( CE_Failure, CPLE_AppDefined, 
-                  "CREATE INDEX ON not supported by this driver." );
+                  "CREATE INDEX ON not supported by this driver, "
+                  "except on read-only layers." );
         CSLDestroy( papszTokens );
         return OGRERR_FAILURE;
     }
@@ -713,6 +722,88 @@ OGRErr OGRDataSource::ProcessSQLDropIndex( const char *pszSQLCommand )
     return eErr;
 }
 
+/************************************************************************/
+/*                       ProcessSQLSpatialIndex()                       */
+/*                                                                      */
+/*      The correct syntax for creating or dropping the generic         */
+/*      spatial index of a layer in the OGR SQL dialect is:            */
+/*                                                                      */
+/*          CREATE SPATIAL INDEX ON <layername>                         */
+/*          DROP SPATIAL INDEX ON <layername>                           */
+/*                                                                      */
+/*      The indexes of file datasources are kept in a .osi file         */
+/*      next to them, see OGRSaveSpatialIndexes().                      */
+/************************************************************************/
+
+OGRErr OGRDataSource::ProcessSQLSpatialIndex( const char *pszSQLCommand )
+
+{
+    char **papszTokens = CSLTokenizeString( pszSQLCommand );
+
+/* -------------------------------------------------------------------- */
+/*      Do some general syntax checking.                                */
+/* -------------------------------------------------------------------- */
+    if( CSLCount(papszTokens) != 5
+        || (!EQUAL(papszTokens[0],"CREATE") && !EQUAL(papszTokens[0],"DROP"))
+        || !EQUAL(papszTokens[1],"SPATIAL")
+        || !EQUAL(papszTokens[2],"INDEX")
+        || !EQUAL(papszTokens[3],"ON") )
+    {
+        CSLDestroy( papszTokens );
+        CPLError( CE_Failure, CPLE_AppDefined, 
+                  "Syntax error in SPATIAL INDEX command.\n"
+                  "Was '%s'\n"
+                  "Should be of form 'CREATE SPATIAL INDEX ON <table>' "
+                  "or 'DROP SPATIAL INDEX ON <table>'",
+                  pszSQLCommand );
+        return OGRERR_FAILURE;
+    }
+
+    int bCreate = EQUAL(papszTokens[0],"CREATE");
+
+/* -------------------------------------------------------------------- */
+/*      Find the named layer.                                           */
+/* -------------------------------------------------------------------- */
+    OGRLayer *poLayer = GetLayerByName( papszTokens[4] );
+
+    if( poLayer == NULL )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined, 
+                  "%s SPATIAL INDEX ON failed, no such layer as `%s'.",
+                  papszTokens[0], papszTokens[4] );
+        CSLDestroy( papszTokens );
+        return OGRERR_FAILURE;
+    }
+
+    CSLDestroy( papszTokens );
+
+/* -------------------------------------------------------------------- */
+/*      Build or drop the index, and update the .osi file.              */
+/* -------------------------------------------------------------------- */
+    if( bCreate )
+    {
+        OGRErr eErr = poLayer->CreateSpatialIndex();
+
+        if( eErr != OGRERR_NONE )
+            return eErr;
+    }
+    else
+    {
+        if( poLayer->GetSpatialIndex() == NULL )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined, 
+                      "Layer %s has no spatial index, "
+                      "DROP SPATIAL INDEX failed.",
+                      poLayer->GetLayerDefn()->GetName() );
+            return OGRERR_FAILURE;
+        }
+
+        poLayer->SetSpatialIndex( NULL );
+    }
+
+    return OGRSaveSpatialIndexes( this );
+}
+
 /************************************************************************/
 /*                             ExecuteSQL()                             */
 /************************************************************************/
@@ -750,6 +841,16 @@ OGRLayer * OGRDataSource::ExecuteSQL( const char *pszStatement,
         ProcessSQLDropIndex( pszStatement );
         return NULL;
     }
+
+/* -------------------------------------------------------------------- */
+/*      Handle CREATE and DROP SPATIAL INDEX statements specially.      */
+/* -------------------------------------------------------------------- */
+    if( EQUALN(pszStatement,"CREATE SPATIAL INDEX",20)
+        || EQUALN(pszStatement,"DROP SPATIAL INDEX",18) )
+    {
+        ProcessSQLSpatialIndex( pszStatement );
+        return NULL;
+    }
     
 /* -------------------------------------------------------------------- */
 /*      Preparse the SQL statement.                                     */
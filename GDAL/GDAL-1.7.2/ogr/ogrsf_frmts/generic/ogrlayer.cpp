@@ -31,6 +31,8 @@
 #include "ogr_api.h"
 #include "ogr_p.h"
 #include "ogr_attrind.h"
+#include "ogr_spatialind.h"
+#include <float.h>
 
 CPL_CVSID("$Id: ogrlayer.cpp 1 2011-07-16 23:22:47Z dcollins $");
 
@@ -44,6 +46,8 @@ OGRLayer::OGRLayer()
     m_poStyleTable = NULL;
     m_poAttrQuery = NULL;
     m_poAttrIndex = NULL;
+    m_poSpatialIndex = NULL;
+    m_panSpatialFilterFIDs = NULL;
     m_nRefCount = 0;
 
     m_nFeaturesRead = 0;
@@ -77,6 +81,9 @@ OGRLayer::~OGRLayer()
         m_poAttrQuery = NULL;
     }
 
+    delete m_poSpatialIndex;
+    CPLFree( m_panSpatialFilterFIDs );
+
     if( m_poFilterGeom )
     {
         delete m_poFilterGeom;
@@ -394,6 +401,45 @@ OGRFeatureH OGR_L_GetNextFeature( OGRLayerH hLayer )
     return (OGRFeatureH) ((OGRLayer *)hLayer)->GetNextFeature();
 }
 
+/************************************************************************/
+/*                        GetNextFeatureBatch()                         */
+/*                                                                      */
+/*      Generic implementation over GetNextFeature().  Drivers that     */
+/*      can fill the columns directly override this.                    */
+/************************************************************************/
+
+int OGRLayer::GetNextFeatureBatch( OGRFeatureBatch *poBatch, int nMaxCount )
+
+{
+    OGRFeature *poFeature;
+
+    poBatch->Reset( GetLayerDefn() );
+
+    while( poBatch->GetFeatureCount() < nMaxCount
+           && (poFeature = GetNextFeature()) != NULL )
+    {
+        poBatch->AddFeature( poFeature );
+        delete poFeature;
+    }
+
+    return poBatch->GetFeatureCount();
+}
+
+/************************************************************************/
+/*                     OGR_L_GetNextFeatureBatch()                      */
+/************************************************************************/
+
+int OGR_L_GetNextFeatureBatch( OGRLayerH hLayer, OGRFeatureBatchH hBatch,
+                               int nMaxCount )
+
+{
+    VALIDATE_POINTER1( hLayer, "OGR_L_GetNextFeatureBatch", 0 );
+    VALIDATE_POINTER1( hBatch, "OGR_L_GetNextFeatureBatch", 0 );
+
+    return ((OGRLayer *)hLayer)->GetNextFeatureBatch(
+        (OGRFeatureBatch *) hBatch, nMaxCount );
+}
+
 /************************************************************************/
 /*                             SetFeature()                             */
 /************************************************************************/
@@ -696,6 +742,9 @@ int OGRLayer::InstallFilter( OGRGeometry * poFilter )
         m_poFilterGeom = NULL;
     }
 
+    CPLFree( m_panSpatialFilterFIDs );
+    m_panSpatialFilterFIDs = NULL;
+
     if( poFilter != NULL )
         m_poFilterGeom = poFilter->clone();
 
@@ -812,6 +861,61 @@ int OGRLayer::FilterGeometry( OGRGeometry *poGeometry )
     }
 }
 
+/************************************************************************/
+/*                         FilterWkbGeometry()                          */
+/*                                                                      */
+/*      Same as FilterGeometry() for the geometry of a WKB view,        */
+/*      which is only built when the envelopes do not decide and       */
+/*      GEOS is available.                                              */
+/************************************************************************/
+
+int OGRLayer::FilterWkbGeometry( OGRWkbGeometryView *poView )
+
+{
+    if( m_poFilterGeom == NULL )
+        return TRUE;
+
+    if( poView == NULL || poView->GetData() == NULL )
+        return TRUE;
+
+/* -------------------------------------------------------------------- */
+/*      Envelope tests, like in FilterGeometry().                       */
+/* -------------------------------------------------------------------- */
+    OGREnvelope sGeomEnv;
+
+    poView->getEnvelope( &sGeomEnv );
+
+    if( sGeomEnv.MaxX < m_sFilterEnvelope.MinX
+        || sGeomEnv.MaxY < m_sFilterEnvelope.MinY
+        || m_sFilterEnvelope.MaxX < sGeomEnv.MinX
+        || m_sFilterEnvelope.MaxY < sGeomEnv.MinY )
+        return FALSE;
+
+    if( m_bFilterIsEnvelope &&
+        sGeomEnv.MinX >= m_sFilterEnvelope.MinX &&
+        sGeomEnv.MinY >= m_sFilterEnvelope.MinY &&
+        sGeomEnv.MaxX <= m_sFilterEnvelope.MaxX &&
+        sGeomEnv.MaxY <= m_sFilterEnvelope.MaxY)
+        return TRUE;
+
+    if( !OGRGeometryFactory::haveGEOS() )
+        return TRUE;
+
+/* -------------------------------------------------------------------- */
+/*      Build the geometry for the full intersection test.              */
+/* -------------------------------------------------------------------- */
+    OGRGeometry *poGeometry = NULL;
+    int          bResult;
+
+    if( poView->createGeometry( &poGeometry ) != OGRERR_NONE )
+        return TRUE;
+
+    bResult = m_poFilterGeom->Intersects( poGeometry );
+    delete poGeometry;
+
+    return bResult;
+}
+
 /************************************************************************/
 /*                         OGR_L_ResetReading()                         */
 /************************************************************************/
@@ -837,7 +941,24 @@ OGRErr OGRLayer::InitializeIndexSupport( const char *pszFilename )
 {
     OGRErr eErr;
 
-    m_poAttrIndex = OGRCreateDefaultLayerIndex();
+    if( m_poAttrIndex != NULL )
+        return OGRERR_NONE;
+
+/* -------------------------------------------------------------------- */
+/*      Keep using MapInfo .ind indexes where they already exist, or    */
+/*      if requested, otherwise use the generic B-tree indexes.         */
+/*      Without a filename the indexes are only kept in memory.         */
+/* -------------------------------------------------------------------- */
+    VSIStatBuf sStat;
+
+    if( pszFilename != NULL
+        && (EQUAL(CPLGetConfigOption( "OGR_ATTRIBUTE_INDEX_FORMAT", 
+                                      "BTREE" ), "MAPINFO")
+            || VSIStat( CPLResetExtension( pszFilename, "idm" ), 
+                        &sStat ) == 0) )
+        m_poAttrIndex = OGRCreateMILayerIndex();
+    else
+        m_poAttrIndex = OGRCreateDefaultLayerIndex();
 
     eErr = m_poAttrIndex->Initialize( pszFilename, this );
     if( eErr != OGRERR_NONE )
@@ -849,6 +970,149 @@ OGRErr OGRLayer::InitializeIndexSupport( const char *pszFilename )
     return eErr;
 }
 
+/************************************************************************/
+/*                         CreateSpatialIndex()                         */
+/*                                                                      */
+/*      Build a spatial index of the feature envelopes of the layer,    */
+/*      replacing any existing one.  Like InitializeIndexSupport()      */
+/*      this is intended for drivers and datasources, which decide      */
+/*      whether and where it gets saved with OGRSaveSpatialIndexes().   */
+/************************************************************************/
+
+OGRErr OGRLayer::CreateSpatialIndex()
+
+{
+/* -------------------------------------------------------------------- */
+/*      Read all the features, without the current filters.             */
+/* -------------------------------------------------------------------- */
+    OGRGeometry     *poSavedFilter = NULL;
+    OGRFeatureQuery *poSavedQuery = m_poAttrQuery;
+
+    if( m_poFilterGeom != NULL )
+        poSavedFilter = m_poFilterGeom->clone();
+
+    SetSpatialIndex( NULL );
+    m_poAttrQuery = NULL;
+    SetSpatialFilter( NULL );
+    ResetReading();
+
+    OGRFeature  *poFeature;
+    int          nCount = 0, nMaxCount = 0;
+    long        *panFIDs = NULL;
+    OGREnvelope *pasEnvelopes = NULL;
+    OGRErr       eErr = OGRERR_NONE;
+
+    while( eErr == OGRERR_NONE && (poFeature = GetNextFeature()) != NULL )
+    {
+        OGRGeometry *poGeom = poFeature->GetGeometryRef();
+
+        if( poFeature->GetFID() == OGRNullFID )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Features of layer %s have no FID, "
+                      "they cannot be spatially indexed.",
+                      GetLayerDefn()->GetName() );
+            eErr = OGRERR_FAILURE;
+        }
+        else
+        {
+            if( nCount == nMaxCount )
+            {
+                nMaxCount = nMaxCount * 2 + 1000;
+                panFIDs = (long *) 
+                    CPLRealloc( panFIDs, sizeof(long) * nMaxCount );
+                pasEnvelopes = (OGREnvelope *) 
+                    CPLRealloc( pasEnvelopes, sizeof(OGREnvelope)*nMaxCount );
+            }
+
+            // Features without geometry pass any spatial filter.
+            panFIDs[nCount] = poFeature->GetFID();
+            if( poGeom != NULL )
+                poGeom->getEnvelope( pasEnvelopes + nCount );
+            else
+            {
+                pasEnvelopes[nCount].MinX = -DBL_MAX;
+                pasEnvelopes[nCount].MinY = -DBL_MAX;
+                pasEnvelopes[nCount].MaxX = DBL_MAX;
+                pasEnvelopes[nCount].MaxY = DBL_MAX;
+            }
+            nCount++;
+        }
+
+        delete poFeature;
+    }
+
+    m_poAttrQuery = poSavedQuery;
+    SetSpatialFilter( poSavedFilter );
+    delete poSavedFilter;
+    ResetReading();
+
+/* -------------------------------------------------------------------- */
+/*      Pack the index.                                                 */
+/* -------------------------------------------------------------------- */
+    if( eErr == OGRERR_NONE )
+    {
+        OGRLayerSpatialIndex *poIndex = new OGRLayerSpatialIndex();
+
+        eErr = poIndex->Build( nCount, panFIDs, pasEnvelopes );
+        if( eErr == OGRERR_NONE )
+            SetSpatialIndex( poIndex );
+        else
+            delete poIndex;
+    }
+
+    CPLFree( panFIDs );
+    CPLFree( pasEnvelopes );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                          SetSpatialIndex()                           */
+/*                                                                      */
+/*      Attach a spatial index to the layer, which takes ownership      */
+/*      of it.  NULL drops the current one.                             */
+/************************************************************************/
+
+void OGRLayer::SetSpatialIndex( OGRLayerSpatialIndex *poIndex )
+
+{
+    if( poIndex == m_poSpatialIndex )
+        return;
+
+    delete m_poSpatialIndex;
+    m_poSpatialIndex = poIndex;
+
+    CPLFree( m_panSpatialFilterFIDs );
+    m_panSpatialFilterFIDs = NULL;
+}
+
+/************************************************************************/
+/*                     GetSpatialFilterCandidates()                     */
+/*                                                                      */
+/*      Return the FIDs, in increasing order and terminated by          */
+/*      OGRNullFID, of the features whose envelope intersects the       */
+/*      envelope of the current spatial filter, according to the        */
+/*      spatial index of the layer.  NULL is returned if there is no    */
+/*      spatial filter or no spatial index.  The list remains owned     */
+/*      by the layer, and is valid until the spatial filter or the      */
+/*      index changes.  The candidates must still be checked with       */
+/*      FilterGeometry(), and drivers should only read them with        */
+/*      GetFeature() if they support fast random reading.               */
+/************************************************************************/
+
+long *OGRLayer::GetSpatialFilterCandidates()
+
+{
+    if( m_poSpatialIndex == NULL || m_poFilterGeom == NULL )
+        return NULL;
+
+    if( m_panSpatialFilterFIDs == NULL )
+        m_panSpatialFilterFIDs = m_poSpatialIndex->Search( &m_sFilterEnvelope );
+
+    return m_panSpatialFilterFIDs;
+}
+
 /************************************************************************/
 /*                             SyncToDisk()                             */
 /************************************************************************/
@@ -30,6 +30,7 @@
 #include "ogrsf_frmts.h"
 #include "ogr_api.h"
 #include "ogr_p.h"
+#include "ogr_spatialind.h"
 #include "cpl_multiproc.h"
 
 CPL_CVSID("$Id: ogrsfdriverregistrar.cpp 1 2011-07-16 23:22:47Z dcollins $");
@@ -218,6 +219,8 @@ OGRDataSource *OGRSFDriverRegistrar::Open( const char * pszName,
 
             CPLDebug( "OGR", "OGROpen(%s/%p) succeeded as %s.", 
                       pszName, poDS, poDS->GetDriver()->GetName() );
+
+            OGRLoadSpatialIndexes( poDS );
             
             return poDS;
         }
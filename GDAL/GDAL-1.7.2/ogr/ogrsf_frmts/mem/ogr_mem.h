@@ -50,6 +50,8 @@ class OGRMemLayer : public OGRLayer
 
     OGRwkbGeometryType  eWkbType;
 
+    OGRFeature *        GetNextMatchingFeature();
+
   public:
                         OGRMemLayer( const char * pszName,
                                      OGRSpatialReference *poSRS,
@@ -58,6 +60,8 @@ class OGRMemLayer : public OGRLayer
 
     void                ResetReading();
     OGRFeature *        GetNextFeature();
+    virtual int         GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                             int nMaxCount );
     virtual OGRErr      SetNextByIndex( long nIndex );
 
     OGRFeature         *GetFeature( long nFeatureId );
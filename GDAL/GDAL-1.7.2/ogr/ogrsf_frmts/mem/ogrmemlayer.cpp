@@ -28,6 +28,7 @@
  ****************************************************************************/
 
 #include "ogr_mem.h"
+#include "ogr_attrind.h"
 #include "cpl_conv.h"
 
 CPL_CVSID("$Id: ogrmemlayer.cpp 1 2011-07-16 23:22:47Z dcollins $");
@@ -55,6 +56,9 @@ OGRMemLayer::OGRMemLayer( const char * pszName, OGRSpatialReference *poSRSIn,
     poFeatureDefn = new OGRFeatureDefn( pszName );
     poFeatureDefn->SetGeomType( eReqType );
     poFeatureDefn->Reference();
+
+    /* Attribute indexes are kept in memory, and updated on each write. */
+    InitializeIndexSupport( NULL );
 }
 
 /************************************************************************/
@@ -96,12 +100,45 @@ void OGRMemLayer::ResetReading()
 }
 
 /************************************************************************/
-/*                           GetNextFeature()                           */
+/*                       GetNextMatchingFeature()                       */
+/*                                                                      */
+/*      Return the next feature passing the filters, as stored in the   */
+/*      layer.                                                          */
 /************************************************************************/
 
-OGRFeature *OGRMemLayer::GetNextFeature()
+OGRFeature *OGRMemLayer::GetNextMatchingFeature()
 
 {
+/* -------------------------------------------------------------------- */
+/*      With a spatial index, only visit the features it selects for    */
+/*      the spatial filter, iNextReadFID being then the position in     */
+/*      the candidate list.                                             */
+/* -------------------------------------------------------------------- */
+    long *panCandidates = GetSpatialFilterCandidates();
+
+    if( panCandidates != NULL )
+    {
+        while( panCandidates[iNextReadFID] != OGRNullFID )
+        {
+            long nFID = panCandidates[iNextReadFID++];
+            OGRFeature *poFeature = NULL;
+
+            if( nFID >= 0 && nFID < nMaxFeatureCount )
+                poFeature = papoFeatures[nFID];
+
+            if( poFeature != NULL 
+                && FilterGeometry( poFeature->GetGeometryRef() )
+                && (m_poAttrQuery == NULL
+                    || m_poAttrQuery->Evaluate( poFeature ) ) )
+            {
+                m_nFeaturesRead++;
+                return poFeature;
+            }
+        }
+
+        return NULL;
+    }
+
     while( iNextReadFID < nMaxFeatureCount )
     {
         OGRFeature *poFeature = papoFeatures[iNextReadFID++];
@@ -115,13 +152,50 @@ OGRFeature *OGRMemLayer::GetNextFeature()
                 || m_poAttrQuery->Evaluate( poFeature ) ) )
         {
             m_nFeaturesRead++;
-            return poFeature->Clone();
+            return poFeature;
         }
     }
 
     return NULL;
 }
 
+/************************************************************************/
+/*                           GetNextFeature()                           */
+/************************************************************************/
+
+OGRFeature *OGRMemLayer::GetNextFeature()
+
+{
+    OGRFeature *poFeature = GetNextMatchingFeature();
+
+    if( poFeature == NULL )
+        return NULL;
+
+    return poFeature->Clone();
+}
+
+/************************************************************************/
+/*                        GetNextFeatureBatch()                         */
+/*                                                                      */
+/*      Copy the stored features in the batch, without the clone        */
+/*      GetNextFeature() has to make.                                   */
+/************************************************************************/
+
+int OGRMemLayer::GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                      int nMaxCount )
+
+{
+    OGRFeature *poFeature;
+
+    poBatch->Reset( poFeatureDefn );
+
+    while( poBatch->GetFeatureCount() < nMaxCount
+           && (poFeature = GetNextMatchingFeature()) != NULL )
+        poBatch->AddFeature( poFeature );
+
+    return poBatch->GetFeatureCount();
+}
+
 /************************************************************************/
 /*                           SetNextByIndex()                           */
 /************************************************************************/
@@ -165,6 +239,13 @@ OGRErr OGRMemLayer::SetFeature( OGRFeature *poFeature )
     if( poFeature == NULL )
         return OGRERR_FAILURE;
 
+    if( GetSpatialIndex() != NULL )
+    {
+        CPLDebug( "Mem", "Dropping the spatial index of modified layer %s.",
+                  poFeatureDefn->GetName() );
+        SetSpatialIndex( NULL );
+    }
+
     if( poFeature->GetFID() == OGRNullFID )
     {
         while( iNextCreateFID < nMaxFeatureCount 
@@ -199,6 +280,9 @@ OGRErr OGRMemLayer::SetFeature( OGRFeature *poFeature )
 
     if( papoFeatures[poFeature->GetFID()] != NULL )
     {
+        if( m_poAttrIndex != NULL )
+            m_poAttrIndex->UpdateFeature( papoFeatures[poFeature->GetFID()],
+                                          NULL );
         delete papoFeatures[poFeature->GetFID()];
         papoFeatures[poFeature->GetFID()] = NULL;
         nFeatureCount--;
@@ -207,6 +291,9 @@ OGRErr OGRMemLayer::SetFeature( OGRFeature *poFeature )
     papoFeatures[poFeature->GetFID()] = poFeature->Clone();
     nFeatureCount++;
 
+    if( m_poAttrIndex != NULL )
+        m_poAttrIndex->UpdateFeature( NULL, papoFeatures[poFeature->GetFID()] );
+
     return OGRERR_NONE;
 }
 
@@ -245,6 +332,8 @@ OGRErr OGRMemLayer::DeleteFeature( long nFID )
     }
     else 
     {
+        if( m_poAttrIndex != NULL )
+            m_poAttrIndex->UpdateFeature( papoFeatures[nFID], NULL );
         delete papoFeatures[nFID];
         papoFeatures[nFID] = NULL;
         nFeatureCount--;
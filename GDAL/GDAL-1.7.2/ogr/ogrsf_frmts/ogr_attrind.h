@@ -48,6 +48,10 @@ public:
 
     virtual long   GetFirstMatch( OGRField *psKey ) = 0;
     virtual long  *GetAllMatches( OGRField *psKey ) = 0;
+
+    virtual long  *GetRangeMatches( OGRField *psMin, int bMinInclusive,
+                                    OGRField *psMax, int bMaxInclusive );
+    virtual long  *GetPrefixMatches( const char *pszPrefix );
     
     virtual OGRErr AddEntry( OGRField *psKey, long nFID ) = 0;
     virtual OGRErr RemoveEntry( OGRField *psKey, long nFID ) = 0;
@@ -83,9 +87,13 @@ public:
     virtual OGRErr RemoveFromIndex( OGRFeature *poFeature ) = 0;
 
     virtual OGRAttrIndex *GetFieldIndex( int iField ) = 0;
+
+    OGRErr      UpdateFeature( OGRFeature *poOldFeature,
+                               OGRFeature *poNewFeature );
 };
 
 OGRLayerAttrIndex CPL_DLL *OGRCreateDefaultLayerIndex();
+OGRLayerAttrIndex CPL_DLL *OGRCreateMILayerIndex();
 
 
 #endif /* ndef _OGR_ATTRIND_H_INCLUDED */
@@ -0,0 +1,103 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  Classes related to generic implementation of spatial indexing.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef _OGR_SPATIALIND_H_INCLUDED
+#define _OGR_SPATIALIND_H_INCLUDED
+
+#include "ogrsf_frmts.h"
+
+/************************************************************************/
+/*                         OGRLayerSpatialIndex                         */
+/*                                                                      */
+/*      Packed R-tree of the feature envelopes of a layer, keyed by     */
+/*      FID.  The entries are ordered along a Hilbert curve, and        */
+/*      grouped by OGR_SPATIALIND_NODE_SIZE into the nodes of the       */
+/*      upper levels, which are stored level after level in one         */
+/*      array.  It is either built in memory, or searched in place in   */
+/*      a sidecar file written by OGRWriteSpatialIndexFile(), only      */
+/*      reading the nodes visited by each search.                       */
+/************************************************************************/
+
+#define OGR_SPATIALIND_NODE_SIZE 16
+
+class CPL_DLL OGRLayerSpatialIndex
+{
+    int          nEntryCount;
+    int          nGeometrylessCount;
+    int          nLevelCount;
+    int         *panLevelEnd;
+    double      *padfBoxes;
+    long        *panFIDs;
+
+    char        *pszFilename;
+    vsi_l_offset nFileOffset;
+    int          bLoaded;
+
+    FILE        *fpSource;
+    double      *padfUpperBoxes;
+
+    void         ComputeLevels();
+    void         CountGeometryless();
+    void         CloseSource();
+    long        *SearchSource( const OGREnvelope *psEnvelope );
+
+  public:
+                 OGRLayerSpatialIndex();
+                 ~OGRLayerSpatialIndex();
+
+    OGRErr       Build( int nCount, const long *panFIDsIn,
+                        const OGREnvelope *pasEnvelopes );
+    void         SetSource( const char *pszFilename, vsi_l_offset nOffset,
+                            int nCount );
+
+    OGRErr       Load();
+    int          GetEntryCount() { return nEntryCount; }
+    int          HasGeometrylessEntries();
+    long        *Search( const OGREnvelope *psEnvelope );
+
+    OGRErr       Write( FILE *fp );
+    static vsi_l_offset GetDataSize( int nCount );
+};
+
+OGRErr CPL_DLL OGRReadSpatialIndexFile( const char *pszIndexFile,
+                                        const char *pszSourceFile,
+                                        int nLayerCount,
+                                        OGRLayer **papoLayers );
+OGRErr CPL_DLL OGRWriteSpatialIndexFile( const char *pszIndexFile,
+                                         const char *pszSourceFile,
+                                         int nLayerCount,
+                                         OGRLayer **papoLayers );
+
+int CPL_DLL OGRGetSourceStamp( const char *pszSource,
+                               const char *pszLayerName,
+                               GIntBig *panStamp );
+
+OGRErr CPL_DLL OGRLoadSpatialIndexes( OGRDataSource *poDS );
+OGRErr CPL_DLL OGRSaveSpatialIndexes( OGRDataSource *poDS );
+
+#endif /* ndef _OGR_SPATIALIND_H_INCLUDED */
@@ -40,6 +40,7 @@
  */
 
 class OGRLayerAttrIndex;
+class OGRLayerSpatialIndex;
 class OGRSFDriver;
 
 /************************************************************************/
@@ -59,6 +60,7 @@ class CPL_DLL OGRLayer
     OGREnvelope  m_sFilterEnvelope;
     
     int          FilterGeometry( OGRGeometry * );
+    int          FilterWkbGeometry( OGRWkbGeometryView * );
     int          InstallFilter( OGRGeometry * );
 
   public:
@@ -74,6 +76,8 @@ class CPL_DLL OGRLayer
 
     virtual void        ResetReading() = 0;
     virtual OGRFeature *GetNextFeature() = 0;
+    virtual int         GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                             int nMaxCount );
     virtual OGRErr      SetNextByIndex( long nIndex );
     virtual OGRFeature *GetFeature( long nFID );
     virtual OGRErr      SetFeature( OGRFeature *poFeature );
@@ -124,11 +128,19 @@ class CPL_DLL OGRLayer
     OGRErr               InitializeIndexSupport( const char * );
     OGRLayerAttrIndex   *GetIndex() { return m_poAttrIndex; }
 
+    OGRErr               CreateSpatialIndex();
+    void                 SetSpatialIndex( OGRLayerSpatialIndex * );
+    OGRLayerSpatialIndex *GetSpatialIndex() { return m_poSpatialIndex; }
+    long                *GetSpatialFilterCandidates();
+
  protected:
     OGRStyleTable       *m_poStyleTable;
     OGRFeatureQuery     *m_poAttrQuery;
     OGRLayerAttrIndex   *m_poAttrIndex;
 
+    OGRLayerSpatialIndex *m_poSpatialIndex;
+    long                *m_panSpatialFilterFIDs;
+
     int                  m_nRefCount;
 
     GIntBig              m_nFeaturesRead;
@@ -209,6 +221,7 @@ class CPL_DLL OGRDataSource
 
     OGRErr              ProcessSQLCreateIndex( const char * );
     OGRErr              ProcessSQLDropIndex( const char * );
+    OGRErr              ProcessSQLSpatialIndex( const char * );
 
     OGRStyleTable      *m_poStyleTable;
     int                 m_nRefCount;
@@ -41,6 +41,9 @@ OGRFeature *SHPReadOGRFeature( SHPHandle hSHP, DBFHandle hDBF,
                                OGRFeatureDefn * poDefn, int iShape, 
                                SHPObject *psShape );
 OGRGeometry *SHPReadOGRObject( SHPHandle hSHP, int iShape, SHPObject *psShape );
+void SHPReadOGRBatchFeature( SHPHandle hSHP, DBFHandle hDBF,
+                             OGRFeatureDefn * poDefn, int iShape,
+                             OGRFeatureBatch *poBatch );
 OGRFeatureDefn *SHPReadOGRFeatureDefn( const char * pszName,
                                        SHPHandle hSHP, DBFHandle hDBF );
 OGRErr SHPWriteOGRFeature( SHPHandle hSHP, DBFHandle hDBF,
@@ -80,8 +83,17 @@ class OGRShapeLayer : public OGRLayer
 
     int                 CheckForQIX();
 
+    int                 bCheckedForOSI;
+
+    int                 CheckForOSI();
+    int                 HasOSIFile();
+    const char         *GetSHPFilename();
+    void                DiscardPackedSpatialIndex();
+    OGRFeature         *ReadIndexedAttributes( long nFID );
+
   public:
     OGRErr              CreateSpatialIndex( int nMaxDepth );
+    OGRErr              CreatePackedSpatialIndex();
     OGRErr              DropSpatialIndex();
     OGRErr              Repack();
 
@@ -98,6 +110,8 @@ class OGRShapeLayer : public OGRLayer
     void                ResetReading();
     OGRFeature *        FetchShape(int iShapeId);
     OGRFeature *        GetNextFeature();
+    virtual int         GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                             int nMaxCount );
     virtual OGRErr      SetNextByIndex( long nIndex );
 
     OGRFeature         *GetFeature( long nFeatureId );
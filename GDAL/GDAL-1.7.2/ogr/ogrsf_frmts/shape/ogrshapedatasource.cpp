@@ -636,7 +636,7 @@ OGRLayer *OGRShapeDataSource::GetLayer( int iLayer )
 /*      We override this to provide special handling of CREATE          */
 /*      SPATIAL INDEX commands.  Support forms are:                     */
 /*                                                                      */
-/*        CREATE SPATIAL INDEX ON layer_name [DEPTH n]                  */
+/*        CREATE SPATIAL INDEX ON layer_name [DEPTH n] [TYPE t]         */
 /*        DROP SPATIAL INDEX ON layer_name                              */
 /*        REPACK layer_name                                             */
 /************************************************************************/
@@ -696,45 +696,69 @@ OGRLayer * OGRShapeDataSource::ExecuteSQL( const char *pszStatement,
 /* -------------------------------------------------------------------- */
     char **papszTokens = CSLTokenizeString( pszStatement );
     
-    if( CSLCount(papszTokens) < 5
-        || !EQUAL(papszTokens[0],"CREATE")
-        || !EQUAL(papszTokens[1],"SPATIAL")
-        || !EQUAL(papszTokens[2],"INDEX") 
-        || !EQUAL(papszTokens[3],"ON") 
-        || CSLCount(papszTokens) > 7 
-        || (CSLCount(papszTokens) == 7 && !EQUAL(papszTokens[5],"DEPTH")) )
+    int nTokens = CSLCount(papszTokens);
+    int bSyntaxOK = nTokens >= 5 && nTokens % 2 == 1
+        && EQUAL(papszTokens[0],"CREATE")
+        && EQUAL(papszTokens[1],"SPATIAL")
+        && EQUAL(papszTokens[2],"INDEX") 
+        && EQUAL(papszTokens[3],"ON");
+
+/* -------------------------------------------------------------------- */
+/*      Get depth and index type if provided.  The type is QIX, the     */
+/*      quadtree of the .qix file, or RTREE, the packed R-tree of the   */
+/*      .osi file.  DEPTH only applies to the former.                   */
+/* -------------------------------------------------------------------- */
+    int nDepth = 0;
+    const char *pszType = CPLGetConfigOption( "SHAPE_SPATIAL_INDEX_TYPE",
+                                              "QIX" );
+
+    for( int iToken = 5; bSyntaxOK && iToken + 1 < nTokens; iToken += 2 )
+    {
+        if( EQUAL(papszTokens[iToken],"DEPTH") )
+            nDepth = atoi(papszTokens[iToken+1]);
+        else if( EQUAL(papszTokens[iToken],"TYPE") )
+            pszType = papszTokens[iToken+1];
+        else
+            bSyntaxOK = FALSE;
+    }
+
+    if( bSyntaxOK && !EQUAL(pszType,"QIX") && !EQUAL(pszType,"RTREE") )
+        bSyntaxOK = FALSE;
+
+    if( !bSyntaxOK )
     {
         CSLDestroy( papszTokens );
         CPLError( CE_Failure, CPLE_AppDefined, 
                   "Syntax error in CREATE SPATIAL INDEX command.\n"
                   "Was '%s'\n"
-                  "Should be of form 'CREATE SPATIAL INDEX ON <table> [DEPTH <n>]'",
+                  "Should be of form 'CREATE SPATIAL INDEX ON <table> "
+                  "[DEPTH <n>] [TYPE QIX|RTREE]'",
                   pszStatement );
         return NULL;
     }
 
-/* -------------------------------------------------------------------- */
-/*      Get depth if provided.                                          */
-/* -------------------------------------------------------------------- */
-    int nDepth = 0;
-    if( CSLCount(papszTokens) == 7 )
-        nDepth = atoi(papszTokens[6]);
+    int bPacked = EQUAL(pszType,"RTREE");
 
 /* -------------------------------------------------------------------- */
 /*      What layer are we operating on.                                 */
 /* -------------------------------------------------------------------- */
     OGRShapeLayer *poLayer = (OGRShapeLayer *) GetLayerByName(papszTokens[4]);
-    CSLDestroy( papszTokens );
 
     if( poLayer == NULL )
     {
         CPLError( CE_Failure, CPLE_AppDefined, 
                   "Layer %s not recognised.", 
                   papszTokens[4] );
+        CSLDestroy( papszTokens );
         return NULL;
     }
 
-    poLayer->CreateSpatialIndex( nDepth );
+    CSLDestroy( papszTokens );
+
+    if( bPacked )
+        poLayer->CreatePackedSpatialIndex();
+    else
+        poLayer->CreateSpatialIndex( nDepth );
     return NULL;
 }
 
@@ -28,8 +28,11 @@
  ****************************************************************************/
 
 #include "ogrshape.h"
+#include "ogr_attrind.h"
+#include "ogr_spatialind.h"
 #include "cpl_conv.h"
 #include "cpl_string.h"
+#include <float.h>
 
 #if defined(_WIN32_WCE)
 #  include <wce_errno.h>
@@ -69,6 +72,8 @@ OGRShapeLayer::OGRShapeLayer( const char * pszName,
     bCheckedForQIX = FALSE;
     fpQIX = NULL;
 
+    bCheckedForOSI = FALSE;
+
     bHeaderDirty = FALSE;
 
     if( hSHP != NULL )
@@ -138,6 +143,104 @@ int OGRShapeLayer::CheckForQIX()
     return fpQIX != NULL;
 }
 
+/************************************************************************/
+/*                           GetSHPFilename()                           */
+/*                                                                      */
+/*      The layer may have been opened through its .dbf or .shx.        */
+/************************************************************************/
+
+const char *OGRShapeLayer::GetSHPFilename()
+
+{
+    VSIStatBufL sStat;
+    const char *pszSHPFilename = CPLResetExtension( pszFullName, "shp" );
+
+    if( VSIStatL( pszSHPFilename, &sStat ) != 0 )
+        pszSHPFilename = CPLResetExtension( pszFullName, "SHP" );
+
+    return pszSHPFilename;
+}
+
+/************************************************************************/
+/*                            CheckForOSI()                             */
+/*                                                                      */
+/*      Attach the packed spatial index of the .osi file, if there is   */
+/*      one for the current content of the .shp file.                   */
+/************************************************************************/
+
+int OGRShapeLayer::CheckForOSI()
+
+{
+    if( bCheckedForOSI )
+        return m_poSpatialIndex != NULL;
+
+    bCheckedForOSI = TRUE;
+
+    if( hSHP == NULL )
+        return FALSE;
+
+    CPLString osOSIFilename = CPLResetExtension( pszFullName, "osi" );
+    CPLString osSHPFilename = GetSHPFilename();
+    OGRLayer *poThis = this;
+
+    OGRReadSpatialIndexFile( osOSIFilename, osSHPFilename, 1, &poThis );
+
+    return m_poSpatialIndex != NULL;
+}
+
+/************************************************************************/
+/*                             HasOSIFile()                             */
+/*                                                                      */
+/*      Is there an .osi file, even one that no longer matches the      */
+/*      .shp file?                                                      */
+/************************************************************************/
+
+int OGRShapeLayer::HasOSIFile()
+
+{
+    VSIStatBufL sStat;
+
+    return CheckForOSI()
+        || VSIStatL( CPLResetExtension( pszFullName, "osi" ), &sStat ) == 0;
+}
+
+/************************************************************************/
+/*                     DiscardPackedSpatialIndex()                      */
+/*                                                                      */
+/*      Called when shapes are written, as the packed index would no    */
+/*      longer be right.  The .osi file itself will be ignored on       */
+/*      next open since the .shp file changed.                          */
+/************************************************************************/
+
+void OGRShapeLayer::DiscardPackedSpatialIndex()
+
+{
+    if( m_poSpatialIndex == NULL )
+        return;
+
+    CPLDebug( "SHAPE", "Discarding packed spatial index of %s, "
+              "the layer is being modified.", poFeatureDefn->GetName() );
+    SetSpatialIndex( NULL );
+}
+
+/************************************************************************/
+/*                       ReadIndexedAttributes()                        */
+/*                                                                      */
+/*      Read the attributes of a record about to be rewritten or        */
+/*      deleted, so that its attribute index entries can be removed.    */
+/*      Returns NULL if the record does not exist.                      */
+/************************************************************************/
+
+OGRFeature *OGRShapeLayer::ReadIndexedAttributes( long nFID )
+
+{
+    if( hDBF == NULL || nFID < 0 || nFID >= hDBF->nRecords
+        || DBFIsRecordDeleted( hDBF, nFID ) )
+        return NULL;
+
+    return SHPReadOGRFeature( NULL, hDBF, poFeatureDefn, nFID, NULL );
+}
+
 /************************************************************************/
 /*                            ScanIndices()                             */
 /*                                                                      */
@@ -161,15 +264,62 @@ int OGRShapeLayer::ScanIndices()
     }
 
 /* -------------------------------------------------------------------- */
-/*      Check for spatial index if we have a spatial query.             */
+/*      Check for spatial index if we have a spatial query.  A          */
+/*      packed index is preferred over a .qix one.                      */
 /* -------------------------------------------------------------------- */
+    if( m_poFilterGeom != NULL && !bCheckedForOSI )
+        CheckForOSI();
+
     if( m_poFilterGeom != NULL && !bCheckedForQIX )
         CheckForQIX();
 
+    long *panSpatialCandidates = GetSpatialFilterCandidates();
+
+/* -------------------------------------------------------------------- */
+/*      Utilize packed spatial index if appropriate.  The candidates    */
+/*      are already in shape id order.                                  */
+/* -------------------------------------------------------------------- */
+    if( panSpatialCandidates != NULL )
+    {
+        int nSpatialFIDCount = 0;
+
+        while( panSpatialCandidates[nSpatialFIDCount] != OGRNullFID )
+            nSpatialFIDCount++;
+
+        CPLDebug( "SHAPE", "Used packed spatial index, got %d matches.", 
+                  nSpatialFIDCount );
+
+        if( panMatchingFIDs == NULL )
+        {
+            panMatchingFIDs = (long *) 
+                CPLMalloc(sizeof(long) * (nSpatialFIDCount+1) );
+            memcpy( panMatchingFIDs, panSpatialCandidates,
+                    sizeof(long) * (nSpatialFIDCount+1) );
+        }
+        else
+        {
+            int iRead, iWrite=0, iSpatial=0;
+
+            for( iRead = 0; panMatchingFIDs[iRead] != OGRNullFID; iRead++ )
+            {
+                while( iSpatial < nSpatialFIDCount
+                       && panSpatialCandidates[iSpatial] < panMatchingFIDs[iRead] )
+                    iSpatial++;
+
+                if( iSpatial == nSpatialFIDCount )
+                    continue;
+
+                if( panSpatialCandidates[iSpatial] == panMatchingFIDs[iRead] )
+                    panMatchingFIDs[iWrite++] = panMatchingFIDs[iRead];
+            }
+            panMatchingFIDs[iWrite] = OGRNullFID;
+        }
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Utilize spatial index if appropriate.                           */
 /* -------------------------------------------------------------------- */
-    if( m_poFilterGeom && fpQIX )
+    else if( m_poFilterGeom && fpQIX )
     {
         int nSpatialFIDCount, *panSpatialFIDs;
         double adfBoundsMin[4], adfBoundsMax[4];
@@ -395,7 +545,7 @@ OGRFeature *OGRShapeLayer::GetNextFeature()
                 return poFeature;
             }
 
-            delete poFeature;
+            OGRFeature::DestroyFeature( poFeature );
         }
     }        
 
@@ -405,6 +555,38 @@ OGRFeature *OGRShapeLayer::GetNextFeature()
     CPLAssert(!"OGRShapeLayer::GetNextFeature(): Execution never should get here!");
 }
 
+/************************************************************************/
+/*                        GetNextFeatureBatch()                         */
+/*                                                                      */
+/*      Without filter, read the shapes and records straight into the   */
+/*      batch.                                                          */
+/************************************************************************/
+
+int OGRShapeLayer::GetNextFeatureBatch( OGRFeatureBatch *poBatch,
+                                        int nMaxCount )
+
+{
+    if( m_poAttrQuery != NULL || m_poFilterGeom != NULL
+        || panMatchingFIDs != NULL )
+        return OGRLayer::GetNextFeatureBatch( poBatch, nMaxCount );
+
+    poBatch->Reset( poFeatureDefn );
+
+    while( poBatch->GetFeatureCount() < nMaxCount
+           && iNextShapeId < nTotalShapeCount )
+    {
+        if( hDBF == NULL || !DBFIsRecordDeleted( hDBF, iNextShapeId ) )
+        {
+            SHPReadOGRBatchFeature( hSHP, hDBF, poFeatureDefn, iNextShapeId,
+                                    poBatch );
+            m_nFeaturesRead++;
+        }
+        iNextShapeId++;
+    }
+
+    return poBatch->GetFeatureCount();
+}
+
 /************************************************************************/
 /*                             GetFeature()                             */
 /************************************************************************/
@@ -447,7 +629,22 @@ OGRErr OGRShapeLayer::SetFeature( OGRFeature *poFeature )
 
     bHeaderDirty = TRUE;
 
-    return SHPWriteOGRFeature( hSHP, hDBF, poFeatureDefn, poFeature );
+    DiscardPackedSpatialIndex();
+
+    OGRFeature *poOldFeature = NULL;
+    OGRErr      eErr;
+
+    if( m_poAttrIndex != NULL )
+        poOldFeature = ReadIndexedAttributes( poFeature->GetFID() );
+
+    eErr = SHPWriteOGRFeature( hSHP, hDBF, poFeatureDefn, poFeature );
+
+    if( m_poAttrIndex != NULL && eErr == OGRERR_NONE )
+        m_poAttrIndex->UpdateFeature( poOldFeature, poFeature );
+
+    delete poOldFeature;
+
+    return eErr;
 }
 
 /************************************************************************/
@@ -491,8 +688,22 @@ OGRErr OGRShapeLayer::DeleteFeature( long nFID )
         return OGRERR_FAILURE;
     }
 
+    OGRFeature *poOldFeature = NULL;
+
+    if( m_poAttrIndex != NULL )
+        poOldFeature = ReadIndexedAttributes( nFID );
+
     if( !DBFMarkRecordDeleted( hDBF, nFID, TRUE ) )
+    {
+        delete poOldFeature;
         return OGRERR_FAILURE;
+    }
+
+    if( poOldFeature != NULL )
+    {
+        m_poAttrIndex->UpdateFeature( poOldFeature, NULL );
+        delete poOldFeature;
+    }
 
     bHeaderDirty = TRUE;
 
@@ -517,6 +728,8 @@ OGRErr OGRShapeLayer::CreateFeature( OGRFeature *poFeature )
 
     bHeaderDirty = TRUE;
 
+    DiscardPackedSpatialIndex();
+
     poFeature->SetFID( OGRNullFID );
 
     if( nTotalShapeCount == 0 
@@ -585,6 +798,9 @@ OGRErr OGRShapeLayer::CreateFeature( OGRFeature *poFeature )
     
     eErr = SHPWriteOGRFeature( hSHP, hDBF, poFeatureDefn, poFeature );
 
+    if( m_poAttrIndex != NULL && eErr == OGRERR_NONE )
+        m_poAttrIndex->UpdateFeature( NULL, poFeature );
+
     if( hSHP != NULL )
         nTotalShapeCount = hSHP->nRecords;
     else 
@@ -656,13 +872,13 @@ int OGRShapeLayer::TestCapability( const char * pszCap )
         return bUpdateAccess;
 
     else if( EQUAL(pszCap,OLCFastFeatureCount) )
-        return m_poFilterGeom == NULL || CheckForQIX();
+        return m_poFilterGeom == NULL || CheckForOSI() || CheckForQIX();
 
     else if( EQUAL(pszCap,OLCDeleteFeature) )
         return bUpdateAccess;
 
     else if( EQUAL(pszCap,OLCFastSpatialFilter) )
-        return CheckForQIX();
+        return CheckForOSI() || CheckForQIX();
 
     else if( EQUAL(pszCap,OLCFastGetExtent) )
         return TRUE;
@@ -947,12 +1163,20 @@ OGRErr OGRShapeLayer::SyncToDisk()
 
 /************************************************************************/
 /*                          DropSpatialIndex()                          */
+/*                                                                      */
+/*      Remove the .qix or packed (.osi) spatial index of the layer.    */
 /************************************************************************/
 
 OGRErr OGRShapeLayer::DropSpatialIndex()
 
 {
-    if( !CheckForQIX() )
+    CPLString   osOSIFilename = CPLResetExtension( pszFullName, "osi" );
+    int         bHasOSI, bHasQIX;
+
+    bHasOSI = HasOSIFile();
+    bHasQIX = CheckForQIX();
+
+    if( !bHasOSI && !bHasQIX )
     {
         CPLError( CE_Warning, CPLE_AppDefined, 
                   "Layer %s has no spatial index, DROP SPATIAL INDEX failed.",
@@ -960,6 +1184,26 @@ OGRErr OGRShapeLayer::DropSpatialIndex()
         return OGRERR_FAILURE;
     }
 
+    OGRErr eErr = OGRERR_NONE;
+
+    if( bHasOSI )
+    {
+        SetSpatialIndex( NULL );
+
+        CPLDebug( "SHAPE", "Unlinking index file %s", osOSIFilename.c_str() );
+
+        if( VSIUnlink( osOSIFilename ) != 0 )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Failed to delete file %s.\n%s", 
+                      osOSIFilename.c_str(), VSIStrerror( errno ) );
+            eErr = OGRERR_FAILURE;
+        }
+    }
+
+    if( !bHasQIX )
+        return eErr;
+
     VSIFClose( fpQIX );
     fpQIX = NULL;
     bCheckedForQIX = FALSE;
@@ -977,7 +1221,7 @@ OGRErr OGRShapeLayer::DropSpatialIndex()
         return OGRERR_FAILURE;
     }
     else
-        return OGRERR_NONE;
+        return eErr;
 }
 
 /************************************************************************/
@@ -990,7 +1234,7 @@ OGRErr OGRShapeLayer::CreateSpatialIndex( int nMaxDepth )
 /* -------------------------------------------------------------------- */
 /*      If we have an existing spatial index, blow it away first.       */
 /* -------------------------------------------------------------------- */
-    if( CheckForQIX() )
+    if( CheckForQIX() || HasOSIFile() )
         DropSpatialIndex();
 
     bCheckedForQIX = FALSE;
@@ -1041,6 +1285,163 @@ OGRErr OGRShapeLayer::CreateSpatialIndex( int nMaxDepth )
     return OGRERR_NONE;
 }
 
+/************************************************************************/
+/*                         OGRShapeReadBounds()                         */
+/*                                                                      */
+/*      Read the bounds of a shape from the start of its record,        */
+/*      without reading its vertices.  Null shapes are given an         */
+/*      envelope covering everything, as FetchShape() lets them pass    */
+/*      any spatial filter.                                             */
+/************************************************************************/
+
+static int OGRShapeReadBounds( SHPHandle hSHP, int iShape,
+                               OGREnvelope *psEnvelope )
+
+{
+    GInt32  nSHPType = SHPT_NULL;
+    double  adfBounds[4];
+    int     nRecSize = (int) hSHP->panRecSize[iShape];
+
+    if( nRecSize >= 4 )
+    {
+        if( hSHP->sHooks.FSeek( hSHP->fpSHP,
+                                hSHP->panRecOffset[iShape] + 8, 0 ) != 0
+            || hSHP->sHooks.FRead( &nSHPType, 4, 1, hSHP->fpSHP ) != 1 )
+            return FALSE;
+        CPL_LSBPTR32( &nSHPType );
+    }
+
+    if( nSHPType == SHPT_POINT || nSHPType == SHPT_POINTZ
+        || nSHPType == SHPT_POINTM )
+    {
+        if( nRecSize < 20
+            || hSHP->sHooks.FRead( adfBounds, 8, 2, hSHP->fpSHP ) != 2 )
+            return FALSE;
+        CPL_LSBPTR64( adfBounds + 0 );
+        CPL_LSBPTR64( adfBounds + 1 );
+        adfBounds[2] = adfBounds[0];
+        adfBounds[3] = adfBounds[1];
+    }
+    else if( nSHPType != SHPT_NULL )
+    {
+        if( nRecSize < 36
+            || hSHP->sHooks.FRead( adfBounds, 8, 4, hSHP->fpSHP ) != 4 )
+            return FALSE;
+        CPL_LSBPTR64( adfBounds + 0 );
+        CPL_LSBPTR64( adfBounds + 1 );
+        CPL_LSBPTR64( adfBounds + 2 );
+        CPL_LSBPTR64( adfBounds + 3 );
+    }
+
+    if( nSHPType == SHPT_NULL )
+    {
+        psEnvelope->MinX = psEnvelope->MinY = -DBL_MAX;
+        psEnvelope->MaxX = psEnvelope->MaxY = DBL_MAX;
+    }
+    else
+    {
+        psEnvelope->MinX = adfBounds[0];
+        psEnvelope->MinY = adfBounds[1];
+        psEnvelope->MaxX = adfBounds[2];
+        psEnvelope->MaxY = adfBounds[3];
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                      CreatePackedSpatialIndex()                      */
+/*                                                                      */
+/*      Build a packed R-tree of the shape bounds in one pass over      */
+/*      the record headers of the .shp file, and write it to the        */
+/*      .osi file, replacing any existing spatial index.                */
+/************************************************************************/
+
+OGRErr OGRShapeLayer::CreatePackedSpatialIndex()
+
+{
+    if( hSHP == NULL )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Layer %s has no .shp file, cannot create a spatial index.",
+                  poFeatureDefn->GetName() );
+        return OGRERR_FAILURE;
+    }
+
+    if( CheckForQIX() || HasOSIFile() )
+        DropSpatialIndex();
+
+/* -------------------------------------------------------------------- */
+/*      Flush pending changes, including the headers that SHPClose()    */
+/*      and DBFClose() would otherwise rewrite, so that none of the     */
+/*      files the index is stamped with is touched anymore after.       */
+/* -------------------------------------------------------------------- */
+    if( hSHP->bUpdated || (hDBF != NULL && hDBF->bUpdated) )
+        bHeaderDirty = TRUE;
+    SyncToDisk();
+    hSHP->bUpdated = FALSE;
+    if( hDBF != NULL )
+        hDBF->bUpdated = FALSE;
+
+/* -------------------------------------------------------------------- */
+/*      Collect the bounds of all shapes.                               */
+/* -------------------------------------------------------------------- */
+    int          nCount = hSHP->nRecords;
+    long        *panFIDs = (long *) VSIMalloc2( MAX(1,nCount), sizeof(long) );
+    OGREnvelope *pasEnvelopes = (OGREnvelope *)
+        VSIMalloc2( MAX(1,nCount), sizeof(OGREnvelope) );
+
+    if( panFIDs == NULL || pasEnvelopes == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate spatial index of %d shapes.", nCount );
+        CPLFree( panFIDs );
+        CPLFree( pasEnvelopes );
+        return OGRERR_NOT_ENOUGH_MEMORY;
+    }
+
+    for( int iShape = 0; iShape < nCount; iShape++ )
+    {
+        panFIDs[iShape] = iShape;
+
+        if( !OGRShapeReadBounds( hSHP, iShape, pasEnvelopes + iShape ) )
+        {
+            CPLError( CE_Failure, CPLE_FileIO,
+                      "Failed to read shape %d of %s.", 
+                      iShape, pszFullName );
+            CPLFree( panFIDs );
+            CPLFree( pasEnvelopes );
+            return OGRERR_FAILURE;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Pack them, and write the index.                                 */
+/* -------------------------------------------------------------------- */
+    OGRLayerSpatialIndex *poIndex = new OGRLayerSpatialIndex();
+    OGRErr eErr = poIndex->Build( nCount, panFIDs, pasEnvelopes );
+
+    CPLFree( panFIDs );
+    CPLFree( pasEnvelopes );
+
+    if( eErr != OGRERR_NONE )
+    {
+        delete poIndex;
+        return eErr;
+    }
+
+    SetSpatialIndex( poIndex );
+    bCheckedForOSI = TRUE;
+
+    CPLString osOSIFilename = CPLResetExtension( pszFullName, "osi" );
+    CPLString osSHPFilename = GetSHPFilename();
+    OGRLayer *poThis = this;
+
+    CPLDebug( "SHAPE", "Creating index file %s", osOSIFilename.c_str() );
+
+    return OGRWriteSpatialIndexFile( osOSIFilename, osSHPFilename, 1, &poThis );
+}
+
 /************************************************************************/
 /*                               Repack()                               */
 /*                                                                      */
@@ -1130,7 +1531,7 @@ OGRErr OGRShapeLayer::Repack()
 /*      Cleanup any existing spatial index.  It will become             */
 /*      meaningless when the fids change.                               */
 /* -------------------------------------------------------------------- */
-    if( CheckForQIX() )
+    if( CheckForQIX() || HasOSIFile() )
         DropSpatialIndex();
 
 /* -------------------------------------------------------------------- */
@@ -1326,5 +1727,30 @@ OGRErr OGRShapeLayer::Repack()
 /* -------------------------------------------------------------------- */
     nTotalShapeCount = hDBF->nRecords;
 
+/* -------------------------------------------------------------------- */
+/*      The FIDs changed, so rebuild the attribute indexes, dropping    */
+/*      those that cannot be cleared.                                   */
+/* -------------------------------------------------------------------- */
+    if( m_poAttrIndex != NULL )
+    {
+        int bRebuild = FALSE;
+
+        for( int iField = 0; iField < poFeatureDefn->GetFieldCount(); iField++ )
+        {
+            OGRAttrIndex *poAttrIndex = m_poAttrIndex->GetFieldIndex( iField );
+
+            if( poAttrIndex == NULL )
+                continue;
+
+            if( poAttrIndex->Clear() == OGRERR_NONE )
+                bRebuild = TRUE;
+            else
+                m_poAttrIndex->DropIndex( iField );
+        }
+
+        if( bRebuild )
+            return m_poAttrIndex->IndexAllFeatures();
+    }
+
     return OGRERR_NONE;
 }
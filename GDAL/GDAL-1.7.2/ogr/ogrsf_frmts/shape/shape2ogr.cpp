@@ -820,6 +820,33 @@ OGRFeatureDefn *SHPReadOGRFeatureDefn( const char * pszName,
     return poDefn;
 }
 
+/************************************************************************/
+/*                           SHPReadOGRDate()                           */
+/*                                                                      */
+/*      Parse a DBF date, either YYYYMMDD or MM/DD/YYYY.                */
+/************************************************************************/
+
+static void SHPReadOGRDate( const char *pszDateValue, OGRField *psField )
+
+{
+    memset( psField, 0, sizeof(OGRField) );
+
+    if( pszDateValue[2] == '/' && pszDateValue[5] == '/' 
+        && strlen(pszDateValue) >= 10 )
+    {
+        psField->Date.Month = (GByte)atoi(pszDateValue+0);
+        psField->Date.Day   = (GByte)atoi(pszDateValue+3);
+        psField->Date.Year  = (GInt16)atoi(pszDateValue+6);
+    }
+    else
+    {
+        int nFullDate = atoi(pszDateValue);
+        psField->Date.Year = (GInt16)(nFullDate / 10000);
+        psField->Date.Month = (GByte)((nFullDate / 100) % 100);
+        psField->Date.Day = (GByte)(nFullDate % 100);
+    }
+}
+
 /************************************************************************/
 /*                         SHPReadOGRFeature()                          */
 /************************************************************************/
@@ -847,7 +874,7 @@ OGRFeature *SHPReadOGRFeature( SHPHandle hSHP, DBFHandle hDBF,
         return NULL;
     }
 
-    OGRFeature  *poFeature = new OGRFeature( poDefn );
+    OGRFeature  *poFeature = OGRFeature::CreateFeature( poDefn );
 
 /* -------------------------------------------------------------------- */
 /*      Fetch geometry from Shapefile to OGRFeature.                    */
@@ -902,26 +929,9 @@ OGRFeature *SHPReadOGRFeature( SHPHandle hSHP, DBFHandle hDBF,
           case OFTDate:
           {
               OGRField sFld;
-              const char* pszDateValue = 
-                  DBFReadStringAttribute(hDBF,iShape,iField); 
-
-              memset( &sFld, 0, sizeof(sFld) );
 
-              if( pszDateValue[2] == '/' && pszDateValue[5] == '/' 
-                  && strlen(pszDateValue) >= 10 )
-              {
-                  sFld.Date.Month = (GByte)atoi(pszDateValue+0);
-                  sFld.Date.Day   = (GByte)atoi(pszDateValue+3);
-                  sFld.Date.Year  = (GInt16)atoi(pszDateValue+6);
-              }
-              else
-              {
-                  int nFullDate = atoi(pszDateValue);
-                  sFld.Date.Year = (GInt16)(nFullDate / 10000);
-                  sFld.Date.Month = (GByte)((nFullDate / 100) % 100);
-                  sFld.Date.Day = (GByte)(nFullDate % 100);
-              }
-              
+              SHPReadOGRDate( DBFReadStringAttribute(hDBF,iShape,iField),
+                              &sFld );
               poFeature->SetField( iField, &sFld );
           }
           break;
@@ -937,6 +947,265 @@ OGRFeature *SHPReadOGRFeature( SHPHandle hSHP, DBFHandle hDBF,
     return( poFeature );
 }
 
+/************************************************************************/
+/*                         SHPWriteWKBHeader()                          */
+/************************************************************************/
+
+static GByte *SHPWriteWKBHeader( GByte *pabyData, int nGType, int nDimension,
+                                 int nCount )
+
+{
+    GUInt32 nWKBType = nGType;
+
+    if( nDimension == 3 )
+        nWKBType |= wkb25DBit;
+
+    pabyData[0] = DB2_V72_UNFIX_BYTE_ORDER((unsigned char) wkbNDR);
+    CPL_LSBPTR32( &nWKBType );
+    memcpy( pabyData + 1, &nWKBType, 4 );
+
+    if( nCount < 0 )
+        return pabyData + 5;
+
+    GInt32 nWKBCount = nCount;
+
+    CPL_LSBPTR32( &nWKBCount );
+    memcpy( pabyData + 5, &nWKBCount, 4 );
+
+    return pabyData + 9;
+}
+
+/************************************************************************/
+/*                         SHPWriteWKBPoints()                          */
+/************************************************************************/
+
+static GByte *SHPWriteWKBPoints( GByte *pabyData, SHPObject *psShape,
+                                 int nStart, int nCount, int nDimension )
+
+{
+    for( int i = nStart; i < nStart + nCount; i++ )
+    {
+        memcpy( pabyData, psShape->padfX + i, 8 );
+        memcpy( pabyData + 8, psShape->padfY + i, 8 );
+        CPL_LSBPTR64( pabyData );
+        CPL_LSBPTR64( pabyData + 8 );
+        pabyData += 16;
+
+        if( nDimension == 3 )
+        {
+            memcpy( pabyData, psShape->padfZ + i, 8 );
+            CPL_LSBPTR64( pabyData );
+            pabyData += 8;
+        }
+    }
+
+    return pabyData;
+}
+
+/************************************************************************/
+/*                          SHPReadWKBObject()                          */
+/*                                                                      */
+/*      Write the WKB geometry SHPReadOGRObject() would build for       */
+/*      points, multipoints and arcs directly in the batch.  Returns    */
+/*      FALSE for the other shapes, which are left untouched.           */
+/************************************************************************/
+
+static int SHPReadWKBObject( SHPObject *psShape, OGRFeatureBatch *poBatch,
+                             int iFeature )
+
+{
+    int    nType = psShape->nSHPType;
+    GByte *pabyData;
+
+/* -------------------------------------------------------------------- */
+/*      Point.                                                          */
+/* -------------------------------------------------------------------- */
+    if( nType == SHPT_POINT || nType == SHPT_POINTM || nType == SHPT_POINTZ )
+    {
+        int nDimension = (nType == SHPT_POINT) ? 2 : 3;
+
+        if( psShape->nVertices < 1 )
+            return FALSE;
+
+        pabyData = poBatch->ReserveGeometryWKB( iFeature,
+                                                5 + 8 * nDimension );
+        pabyData = SHPWriteWKBHeader( pabyData, wkbPoint, nDimension, -1 );
+        SHPWriteWKBPoints( pabyData, psShape, 0, 1, nDimension );
+
+        return TRUE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Multipoint.                                                     */
+/* -------------------------------------------------------------------- */
+    if( nType == SHPT_MULTIPOINT || nType == SHPT_MULTIPOINTM
+        || nType == SHPT_MULTIPOINTZ )
+    {
+        int nDimension = (nType == SHPT_MULTIPOINT) ? 2 : 3;
+
+        if( psShape->nVertices == 0 )
+            return TRUE;
+
+        pabyData = poBatch->ReserveGeometryWKB(
+            iFeature, 9 + psShape->nVertices * (5 + 8 * nDimension) );
+        pabyData = SHPWriteWKBHeader( pabyData, wkbMultiPoint, nDimension,
+                                      psShape->nVertices );
+
+        for( int i = 0; i < psShape->nVertices; i++ )
+        {
+            pabyData = SHPWriteWKBHeader( pabyData, wkbPoint, nDimension, -1 );
+            pabyData = SHPWriteWKBPoints( pabyData, psShape, i, 1,
+                                          nDimension );
+        }
+
+        return TRUE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Arc, as a linestring, or a multilinestring if it has several    */
+/*      parts.                                                          */
+/* -------------------------------------------------------------------- */
+    if( nType == SHPT_ARC || nType == SHPT_ARCM || nType == SHPT_ARCZ )
+    {
+        int nDimension = (nType == SHPT_ARC) ? 2 : 3;
+        int iPart, nSize;
+
+        if( psShape->nParts == 0 )
+            return TRUE;
+
+        if( psShape->nParts == 1 )
+        {
+            pabyData = poBatch->ReserveGeometryWKB(
+                iFeature, 9 + psShape->nVertices * 8 * nDimension );
+            pabyData = SHPWriteWKBHeader( pabyData, wkbLineString, nDimension,
+                                          psShape->nVertices );
+            SHPWriteWKBPoints( pabyData, psShape, 0, psShape->nVertices,
+                               nDimension );
+
+            return TRUE;
+        }
+
+        if( psShape->panPartStart == NULL )
+            return FALSE;
+
+        nSize = 9 + psShape->nParts * 9;
+        for( iPart = 0; iPart < psShape->nParts; iPart++ )
+        {
+            int nEnd = (iPart == psShape->nParts - 1) ? psShape->nVertices
+                : psShape->panPartStart[iPart+1];
+
+            if( psShape->panPartStart[iPart] < 0
+                || nEnd < psShape->panPartStart[iPart]
+                || nEnd > psShape->nVertices )
+                return FALSE;
+
+            nSize += (nEnd - psShape->panPartStart[iPart]) * 8 * nDimension;
+        }
+
+        pabyData = poBatch->ReserveGeometryWKB( iFeature, nSize );
+        pabyData = SHPWriteWKBHeader( pabyData, wkbMultiLineString,
+                                      nDimension, psShape->nParts );
+
+        for( iPart = 0; iPart < psShape->nParts; iPart++ )
+        {
+            int nStart = psShape->panPartStart[iPart];
+            int nEnd = (iPart == psShape->nParts - 1) ? psShape->nVertices
+                : psShape->panPartStart[iPart+1];
+
+            pabyData = SHPWriteWKBHeader( pabyData, wkbLineString, nDimension,
+                                          nEnd - nStart );
+            pabyData = SHPWriteWKBPoints( pabyData, psShape, nStart,
+                                          nEnd - nStart, nDimension );
+        }
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/************************************************************************/
+/*                       SHPReadOGRBatchFeature()                       */
+/*                                                                      */
+/*      Append a shape to a feature batch, as SHPReadOGRFeature()       */
+/*      would read it, but without building an OGRFeature.  The shape   */
+/*      must exist and not be deleted.                                  */
+/************************************************************************/
+
+void SHPReadOGRBatchFeature( SHPHandle hSHP, DBFHandle hDBF,
+                             OGRFeatureDefn * poDefn, int iShape,
+                             OGRFeatureBatch *poBatch )
+
+{
+    int iFeature = poBatch->AddFeature( iShape );
+
+/* -------------------------------------------------------------------- */
+/*      Fetch the geometry, in WKB.  Polygons need organizePolygons(),  */
+/*      so they go through an OGRGeometry.                              */
+/* -------------------------------------------------------------------- */
+    if( hSHP != NULL )
+    {
+        SHPObject *psShape = SHPReadObject( hSHP, iShape );
+
+        if( psShape != NULL )
+        {
+            if( SHPReadWKBObject( psShape, poBatch, iFeature ) )
+                SHPDestroyObject( psShape );
+            else
+            {
+                OGRGeometry *poGeometry = 
+                    SHPReadOGRObject( hSHP, iShape, psShape );
+
+                poBatch->SetGeometry( iFeature, poGeometry );
+                delete poGeometry;
+            }
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Fetch the attributes.                                           */
+/* -------------------------------------------------------------------- */
+    for( int iField = 0; iField < poDefn->GetFieldCount(); iField++ )
+    {
+        if( DBFIsAttributeNULL( hDBF, iShape, iField ) )
+            continue;
+
+        switch( poDefn->GetFieldDefn(iField)->GetType() )
+        {
+          case OFTString:
+            poBatch->SetField( iFeature, iField,
+                               DBFReadStringAttribute( hDBF, iShape,
+                                                       iField ) );
+            break;
+
+          case OFTInteger:
+            poBatch->SetField( iFeature, iField,
+                               DBFReadIntegerAttribute( hDBF, iShape,
+                                                        iField ) );
+            break;
+
+          case OFTReal:
+            poBatch->SetField( iFeature, iField,
+                               DBFReadDoubleAttribute( hDBF, iShape,
+                                                       iField ) );
+            break;
+
+          case OFTDate:
+          {
+              OGRField sFld;
+
+              SHPReadOGRDate( DBFReadStringAttribute(hDBF,iShape,iField),
+                              &sFld );
+              poBatch->SetField( iFeature, iField, &sFld );
+          }
+          break;
+
+          default:
+            CPLAssert( FALSE );
+        }
+    }
+}
+
 /************************************************************************/
 /*                         SHPWriteOGRFeature()                         */
 /*                                                                      */
@@ -96,6 +96,12 @@ class OGRSQLiteLayer : public OGRLayer
     int                *panFieldOrdinals;
     int                 bHasSpatialIndex;
 
+    OGRWkbGeometryView  oWkbView;
+    int                 bFilterRowsOnRead;
+    int                 bRowGeometryFiltered;
+
+    int                 RowMatchesSpatialFilter();
+
     CPLErr              BuildFeatureDefn( const char *pszLayerName, 
                                           sqlite3_stmt *hStmt );
 
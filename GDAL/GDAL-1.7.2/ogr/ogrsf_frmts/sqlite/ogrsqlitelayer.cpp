@@ -59,6 +59,9 @@ OGRSQLiteLayer::OGRSQLiteLayer()
 
     bTriedAsSpatiaLite = FALSE;
     bHasSpatialIndex = FALSE;
+
+    bFilterRowsOnRead = FALSE;
+    bRowGeometryFiltered = FALSE;
 }
 
 /************************************************************************/
@@ -269,11 +272,14 @@ OGRFeature *OGRSQLiteLayer::GetNextFeature()
     {
         OGRFeature      *poFeature;
 
+        bFilterRowsOnRead = TRUE;
         poFeature = GetNextRawFeature();
+        bFilterRowsOnRead = FALSE;
+
         if( poFeature == NULL )
             return NULL;
 
-        if( (m_poFilterGeom == NULL
+        if( (m_poFilterGeom == NULL || bRowGeometryFiltered
             || FilterGeometry( poFeature->GetGeometryRef() ) )
             && (m_poAttrQuery == NULL
                 || m_poAttrQuery->Evaluate( poFeature )) )
@@ -298,19 +304,36 @@ OGRFeature *OGRSQLiteLayer::GetNextRawFeature()
 /* -------------------------------------------------------------------- */
     int rc;
 
-    rc = sqlite3_step( hStmt );
-    if( rc != SQLITE_ROW )
+    bRowGeometryFiltered = FALSE;
+
+    while( TRUE )
     {
-        if ( rc != SQLITE_DONE )
+        rc = sqlite3_step( hStmt );
+        if( rc != SQLITE_ROW )
         {
-            CPLError( CE_Failure, CPLE_AppDefined, 
-                    "In GetNextRawFeature(): sqlite3_step() : %s", 
-                    sqlite3_errmsg(poDS->GetDB()) );
+            if ( rc != SQLITE_DONE )
+            {
+                CPLError( CE_Failure, CPLE_AppDefined, 
+                        "In GetNextRawFeature(): sqlite3_step() : %s", 
+                        sqlite3_errmsg(poDS->GetDB()) );
+            }
+
+            ClearStatement();
+
+            return NULL;
         }
 
-        ClearStatement();
+/* -------------------------------------------------------------------- */
+/*      When reading for GetNextFeature(), skip the rows whose WKB      */
+/*      geometry does not match the spatial filter without building    */
+/*      their feature.                                                  */
+/* -------------------------------------------------------------------- */
+        if( !bFilterRowsOnRead || m_poFilterGeom == NULL 
+            || RowMatchesSpatialFilter() )
+            break;
 
-        return NULL;
+        iNextShapeId++;
+        m_nFeaturesRead++;
     }
 
 /* -------------------------------------------------------------------- */
@@ -474,6 +497,47 @@ OGRFeature *OGRSQLiteLayer::GetNextRawFeature()
     return poFeature;
 }
 
+/************************************************************************/
+/*                      RowMatchesSpatialFilter()                       */
+/*                                                                      */
+/*      Test the WKB geometry of the current row against the spatial    */
+/*      filter through a view, and set bRowGeometryFiltered when the    */
+/*      test could be done.  Rows with geometries in other formats are  */
+/*      kept, and tested by GetNextFeature() once translated.           */
+/************************************************************************/
+
+int OGRSQLiteLayer::RowMatchesSpatialFilter()
+
+{
+    int iGeomCol;
+
+    bRowGeometryFiltered = FALSE;
+
+    if( eGeomFormat != OSGF_WKB || osGeomColumn.size() == 0 )
+        return TRUE;
+
+    for( iGeomCol = 0; iGeomCol < sqlite3_column_count(hStmt); iGeomCol++ )
+    {
+        if( EQUAL(sqlite3_column_name(hStmt,iGeomCol), osGeomColumn) )
+            break;
+    }
+
+    if( iGeomCol == sqlite3_column_count(hStmt)
+        || sqlite3_column_type( hStmt, iGeomCol ) != SQLITE_BLOB )
+        return TRUE;
+
+    const GByte *pabyWKB = (const GByte *) 
+        sqlite3_column_blob( hStmt, iGeomCol );
+    const int    nBytes = sqlite3_column_bytes( hStmt, iGeomCol );
+
+    if( oWkbView.Attach( pabyWKB, nBytes ) != OGRERR_NONE )
+        return TRUE;
+
+    bRowGeometryFiltered = TRUE;
+
+    return FilterWkbGeometry( &oWkbView );
+}
+
 /************************************************************************/
 /*                             GetFeature()                             */
 /************************************************************************/
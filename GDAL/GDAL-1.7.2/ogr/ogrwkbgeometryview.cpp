@@ -0,0 +1,623 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenGIS Simple Features Reference Implementation
+ * Purpose:  The OGRWkbGeometryView class, read-only access to the
+ *           coordinates of a WKB geometry without building an OGRGeometry.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, GDAL contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "ogr_geometry.h"
+#include "ogr_p.h"
+
+CPL_CVSID("$Id$");
+
+/* Collections nested deeper than this are rejected as corrupt. */
+#define OGR_WKB_VIEW_MAX_DEPTH  32
+
+/************************************************************************/
+/*                          OGRWkbReadInt32()                           */
+/************************************************************************/
+
+static int OGRWkbReadInt32( const GByte *pabyData, int bSwap )
+
+{
+    GInt32 nValue;
+
+    memcpy( &nValue, pabyData, 4 );
+    if( bSwap )
+        CPL_SWAP32PTR( &nValue );
+
+    return nValue;
+}
+
+/************************************************************************/
+/*                          OGRWkbReadDouble()                          */
+/************************************************************************/
+
+static double OGRWkbReadDouble( const GByte *pabyData, int bSwap )
+
+{
+    double dfValue;
+
+    memcpy( &dfValue, pabyData, 8 );
+    if( bSwap )
+        CPL_SWAPDOUBLE( &dfValue );
+
+    return dfValue;
+}
+
+/************************************************************************/
+/*                         OGRWkbGeometryView()                         */
+/************************************************************************/
+
+/**
+ * \brief Constructor
+ *
+ * The view is not attached to any buffer.
+ */
+
+OGRWkbGeometryView::OGRWkbGeometryView()
+
+{
+    pabyData = NULL;
+    nSize = 0;
+    eGeometryType = wkbNone;
+
+    nSequenceCount = 0;
+    nSequenceMax = 0;
+    pasSequences = NULL;
+    nPointCount = 0;
+
+    iCurSequence = 0;
+    nCurSequenceStart = 0;
+}
+
+/************************************************************************/
+/*                        ~OGRWkbGeometryView()                         */
+/************************************************************************/
+
+OGRWkbGeometryView::~OGRWkbGeometryView()
+
+{
+    CPLFree( pasSequences );
+}
+
+/************************************************************************/
+/*                               Detach()                               */
+/************************************************************************/
+
+/**
+ * \brief Forget the attached buffer.
+ *
+ * The view is left as just constructed, except for its internal tables
+ * that are kept for the next Attach().
+ */
+
+void OGRWkbGeometryView::Detach()
+
+{
+    pabyData = NULL;
+    nSize = 0;
+    eGeometryType = wkbNone;
+
+    nSequenceCount = 0;
+    nPointCount = 0;
+
+    iCurSequence = 0;
+    nCurSequenceStart = 0;
+}
+
+/************************************************************************/
+/*                               Attach()                               */
+/************************************************************************/
+
+/**
+ * \brief Attach the view to a WKB geometry.
+ *
+ * The structure of the geometry is checked like
+ * OGRGeometryFactory::createFromWkb() would, and the position of each
+ * sequence of points (point, line string or ring) is recorded.  The
+ * coordinates themselves are only read on demand.
+ *
+ * @param pabyWKB the WKB geometry, which must stay valid and unchanged
+ * while attached.
+ * @param nBytes the number of bytes available in pabyWKB, or -1 if not
+ * known, in which case the data is trusted to be complete.  The WKB may be
+ * followed by other data: WkbSize() gives the size actually used.
+ *
+ * @return OGRERR_NONE on success, or OGRERR_NOT_ENOUGH_DATA,
+ * OGRERR_UNSUPPORTED_GEOMETRY_TYPE or OGRERR_CORRUPT_DATA in which case
+ * the view is left detached.
+ */
+
+OGRErr OGRWkbGeometryView::Attach( const GByte *pabyWKB, int nBytes )
+
+{
+    OGRwkbGeometryType eType;
+    int                nConsumed;
+    OGRErr             eErr;
+
+    Detach();
+
+    if( pabyWKB == NULL )
+        return OGRERR_NOT_ENOUGH_DATA;
+
+    pabyData = pabyWKB;
+
+    eErr = ParseGeometry( 0, nBytes, 0, &eType, &nConsumed );
+    if( eErr != OGRERR_NONE )
+    {
+        Detach();
+        return eErr;
+    }
+
+    nSize = nConsumed;
+    eGeometryType = eType;
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                            AddSequence()                             */
+/************************************************************************/
+
+void OGRWkbGeometryView::AddSequence( int nOffset, int nPoints, int bIs3D,
+                                      int bSwap )
+
+{
+    if( nPoints == 0 )
+        return;
+
+    if( nSequenceCount == nSequenceMax )
+    {
+        nSequenceMax = nSequenceMax * 2 + 8;
+        pasSequences = (OGRWkbPointSequence *)
+            CPLRealloc( pasSequences,
+                        sizeof(OGRWkbPointSequence) * nSequenceMax );
+    }
+
+    OGRWkbPointSequence *psSequence = pasSequences + nSequenceCount++;
+
+    psSequence->nOffset = nOffset;
+    psSequence->nPointCount = nPoints;
+    psSequence->bIs3D = bIs3D;
+    psSequence->bSwap = bSwap;
+
+    nPointCount += nPoints;
+}
+
+/************************************************************************/
+/*                           ParseGeometry()                            */
+/*                                                                      */
+/*      Check the geometry at nOffset, with nAvailable bytes (or -1),   */
+/*      and record its point sequences.  The type and 3D flag are       */
+/*      read like the importFromWkb() methods do.                       */
+/************************************************************************/
+
+OGRErr OGRWkbGeometryView::ParseGeometry( int nOffset, int nAvailable,
+                                          int nDepth,
+                                          OGRwkbGeometryType *peType,
+                                          int *pnConsumed )
+
+{
+    const GByte *pabyGeom = pabyData + nOffset;
+
+    if( nAvailable != -1 && nAvailable < 5 )
+        return OGRERR_NOT_ENOUGH_DATA;
+
+    if( nDepth > OGR_WKB_VIEW_MAX_DEPTH )
+        return OGRERR_CORRUPT_DATA;
+
+/* -------------------------------------------------------------------- */
+/*      Get the byte order, type and dimension.                         */
+/* -------------------------------------------------------------------- */
+    OGRwkbByteOrder eByteOrder;
+    int             nFlatType, bIs3D, bSwap;
+
+    eByteOrder = DB2_V72_FIX_BYTE_ORDER((OGRwkbByteOrder) *pabyGeom);
+    if( !(eByteOrder == wkbXDR || eByteOrder == wkbNDR) )
+        return OGRERR_CORRUPT_DATA;
+
+    bSwap = OGR_SWAP( eByteOrder );
+
+    if( eByteOrder == wkbNDR )
+    {
+        nFlatType = pabyGeom[1];
+        bIs3D = pabyGeom[4] & 0x80 || pabyGeom[2] & 0x80;
+    }
+    else
+    {
+        nFlatType = pabyGeom[4];
+        bIs3D = pabyGeom[1] & 0x80 || pabyGeom[3] & 0x80;
+    }
+
+    int nPointSize = bIs3D ? 24 : 16;
+
+    *peType = (OGRwkbGeometryType) (bIs3D ? (nFlatType | wkb25DBit)
+                                           : nFlatType);
+
+/* -------------------------------------------------------------------- */
+/*      Point.                                                          */
+/* -------------------------------------------------------------------- */
+    if( nFlatType == wkbPoint )
+    {
+        if( nAvailable != -1 && nAvailable < 5 + nPointSize )
+            return OGRERR_NOT_ENOUGH_DATA;
+
+        AddSequence( nOffset + 5, 1, bIs3D, bSwap );
+        *pnConsumed = 5 + nPointSize;
+
+        return OGRERR_NONE;
+    }
+
+    if( nFlatType < (int) wkbLineString
+        || nFlatType > (int) wkbGeometryCollection )
+        return OGRERR_UNSUPPORTED_GEOMETRY_TYPE;
+
+/* -------------------------------------------------------------------- */
+/*      The other types have a count of points, rings or parts.         */
+/* -------------------------------------------------------------------- */
+    int nCount, nUsed = 9, i;
+
+    if( nAvailable != -1 && nAvailable < 9 )
+        return OGRERR_NOT_ENOUGH_DATA;
+
+    nCount = OGRWkbReadInt32( pabyGeom + 5, bSwap );
+    if( nCount < 0 )
+        return OGRERR_CORRUPT_DATA;
+
+    switch( nFlatType )
+    {
+      case wkbLineString:
+        if( nCount > (INT_MAX - nOffset - nUsed) / nPointSize )
+            return OGRERR_CORRUPT_DATA;
+        if( nAvailable != -1 && nCount * nPointSize > nAvailable - nUsed )
+            return OGRERR_NOT_ENOUGH_DATA;
+
+        AddSequence( nOffset + nUsed, nCount, bIs3D, bSwap );
+        nUsed += nCount * nPointSize;
+        break;
+
+      case wkbPolygon:
+        for( i = 0; i < nCount; i++ )
+        {
+            int nPoints;
+
+            if( nAvailable != -1 && nAvailable - nUsed < 4 )
+                return OGRERR_NOT_ENOUGH_DATA;
+
+            nPoints = OGRWkbReadInt32( pabyGeom + nUsed, bSwap );
+            nUsed += 4;
+
+            if( nPoints < 0
+                || nPoints > (INT_MAX - nOffset - nUsed) / nPointSize )
+                return OGRERR_CORRUPT_DATA;
+            if( nAvailable != -1 && nPoints * nPointSize > nAvailable - nUsed )
+                return OGRERR_NOT_ENOUGH_DATA;
+
+            AddSequence( nOffset + nUsed, nPoints, bIs3D, bSwap );
+            nUsed += nPoints * nPointSize;
+        }
+        break;
+
+      default:
+        for( i = 0; i < nCount; i++ )
+        {
+            OGRwkbGeometryType eSubType;
+            int                nSubSize;
+            OGRErr             eErr;
+
+            eErr = ParseGeometry( nOffset + nUsed,
+                                  nAvailable == -1 ? -1 : nAvailable - nUsed,
+                                  nDepth + 1, &eSubType, &nSubSize );
+            if( eErr != OGRERR_NONE )
+                return eErr;
+
+            // Multi geometries only hold their own kind of parts.
+            if( nFlatType != wkbGeometryCollection
+                && (int) wkbFlatten(eSubType) != nFlatType - 3 )
+                return OGRERR_CORRUPT_DATA;
+
+            nUsed += nSubSize;
+        }
+        break;
+    }
+
+    *pnConsumed = nUsed;
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                       getCoordinateDimension()                       */
+/************************************************************************/
+
+/**
+ * \brief Get the dimension of the coordinates of the attached geometry.
+ *
+ * @return 3 for a 2.5D geometry, 2 for a 2D one and 0 when detached.
+ */
+
+int OGRWkbGeometryView::getCoordinateDimension()
+
+{
+    if( pabyData == NULL )
+        return 0;
+
+    return (eGeometryType & wkb25DBit) ? 3 : 2;
+}
+
+/************************************************************************/
+/*                            getEnvelope()                             */
+/************************************************************************/
+
+/**
+ * \brief Compute the envelope of the attached geometry.
+ *
+ * The envelope of a geometry without any point is all zero.
+ *
+ * @param psEnvelope the structure in which to place the results.
+ */
+
+void OGRWkbGeometryView::getEnvelope( OGREnvelope * psEnvelope )
+
+{
+    double dfMinX = 0.0, dfMinY = 0.0, dfMaxX = 0.0, dfMaxY = 0.0;
+    int    bFirst = TRUE;
+
+    for( int iSeq = 0; iSeq < nSequenceCount; iSeq++ )
+    {
+        const OGRWkbPointSequence *psSequence = pasSequences + iSeq;
+        const GByte *pabyPoint = pabyData + psSequence->nOffset;
+        int          nPointSize = psSequence->bIs3D ? 24 : 16;
+
+        for( int i = 0; i < psSequence->nPointCount; i++ )
+        {
+            double dfX = OGRWkbReadDouble( pabyPoint, psSequence->bSwap );
+            double dfY = OGRWkbReadDouble( pabyPoint + 8, psSequence->bSwap );
+
+            if( bFirst )
+            {
+                dfMinX = dfMaxX = dfX;
+                dfMinY = dfMaxY = dfY;
+                bFirst = FALSE;
+            }
+            else
+            {
+                if( dfX < dfMinX )
+                    dfMinX = dfX;
+                if( dfX > dfMaxX )
+                    dfMaxX = dfX;
+                if( dfY < dfMinY )
+                    dfMinY = dfY;
+                if( dfY > dfMaxY )
+                    dfMaxY = dfY;
+            }
+
+            pabyPoint += nPointSize;
+        }
+    }
+
+    psEnvelope->MinX = dfMinX;
+    psEnvelope->MaxX = dfMaxX;
+    psEnvelope->MinY = dfMinY;
+    psEnvelope->MaxY = dfMaxY;
+}
+
+/************************************************************************/
+/*                              getPoint()                              */
+/************************************************************************/
+
+/**
+ * \brief Fetch a point of the attached geometry.
+ *
+ * The points of all the point sequences of the geometry (points, line
+ * strings and rings, in the order of the WKB) are numbered from 0 to
+ * getNumPoints()-1.  Reading them in order is done in constant time per
+ * point.
+ *
+ * @param iPoint the index of the point.
+ * @param pdfX location to put the X coordinate.
+ * @param pdfY location to put the Y coordinate.
+ * @param pdfZ location to put the Z coordinate, 0 for 2D points.  May be
+ * NULL.
+ *
+ * @return TRUE on success, FALSE if iPoint is out of range.
+ */
+
+int OGRWkbGeometryView::getPoint( int iPoint, double *pdfX, double *pdfY,
+                                  double *pdfZ )
+
+{
+    if( iPoint < 0 || iPoint >= nPointCount )
+        return FALSE;
+
+    if( iPoint < nCurSequenceStart )
+    {
+        iCurSequence = 0;
+        nCurSequenceStart = 0;
+    }
+
+    while( iPoint >= nCurSequenceStart
+           + pasSequences[iCurSequence].nPointCount )
+    {
+        nCurSequenceStart += pasSequences[iCurSequence].nPointCount;
+        iCurSequence++;
+    }
+
+    const OGRWkbPointSequence *psSequence = pasSequences + iCurSequence;
+    const GByte *pabyPoint = pabyData + psSequence->nOffset
+        + (iPoint - nCurSequenceStart) * (psSequence->bIs3D ? 24 : 16);
+
+    *pdfX = OGRWkbReadDouble( pabyPoint, psSequence->bSwap );
+    *pdfY = OGRWkbReadDouble( pabyPoint + 8, psSequence->bSwap );
+    if( pdfZ != NULL )
+        *pdfZ = psSequence->bIs3D
+            ? OGRWkbReadDouble( pabyPoint + 16, psSequence->bSwap ) : 0.0;
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                        OGRWkbSetByteOrder()                          */
+/*                                                                      */
+/*      Convert in place a geometry already checked by                  */
+/*      ParseGeometry() to the given byte order, and return its size.   */
+/************************************************************************/
+
+static int OGRWkbSetByteOrder( GByte *pabyGeom, OGRwkbByteOrder eTarget )
+
+{
+    OGRwkbByteOrder eByteOrder;
+    int             nFlatType, bIs3D, bSwap, nDoubles, nCount, nUsed, i;
+
+    eByteOrder = DB2_V72_FIX_BYTE_ORDER((OGRwkbByteOrder) *pabyGeom);
+    bSwap = (eByteOrder != eTarget);
+
+    if( eByteOrder == wkbNDR )
+    {
+        nFlatType = pabyGeom[1];
+        bIs3D = pabyGeom[4] & 0x80 || pabyGeom[2] & 0x80;
+    }
+    else
+    {
+        nFlatType = pabyGeom[4];
+        bIs3D = pabyGeom[1] & 0x80 || pabyGeom[3] & 0x80;
+    }
+
+    nDoubles = bIs3D ? 3 : 2;
+
+    pabyGeom[0] = DB2_V72_UNFIX_BYTE_ORDER((unsigned char) eTarget);
+    if( bSwap )
+        CPL_SWAP32PTR( pabyGeom + 1 );
+
+    if( nFlatType == wkbPoint )
+    {
+        if( bSwap )
+        {
+            for( i = 0; i < nDoubles; i++ )
+                CPL_SWAPDOUBLE( pabyGeom + 5 + i * 8 );
+        }
+        return 5 + nDoubles * 8;
+    }
+
+    nCount = OGRWkbReadInt32( pabyGeom + 5, OGR_SWAP( eByteOrder ) );
+    if( bSwap )
+        CPL_SWAP32PTR( pabyGeom + 5 );
+    nUsed = 9;
+
+    switch( nFlatType )
+    {
+      case wkbLineString:
+        if( bSwap )
+        {
+            for( i = 0; i < nCount * nDoubles; i++ )
+                CPL_SWAPDOUBLE( pabyGeom + nUsed + i * 8 );
+        }
+        nUsed += nCount * nDoubles * 8;
+        break;
+
+      case wkbPolygon:
+        for( int iRing = 0; iRing < nCount; iRing++ )
+        {
+            int nPoints = OGRWkbReadInt32( pabyGeom + nUsed,
+                                           OGR_SWAP( eByteOrder ) );
+
+            if( bSwap )
+            {
+                CPL_SWAP32PTR( pabyGeom + nUsed );
+                for( i = 0; i < nPoints * nDoubles; i++ )
+                    CPL_SWAPDOUBLE( pabyGeom + nUsed + 4 + i * 8 );
+            }
+            nUsed += 4 + nPoints * nDoubles * 8;
+        }
+        break;
+
+      default:
+        for( i = 0; i < nCount; i++ )
+            nUsed += OGRWkbSetByteOrder( pabyGeom + nUsed, eTarget );
+        break;
+    }
+
+    return nUsed;
+}
+
+/************************************************************************/
+/*                            exportToWkb()                             */
+/************************************************************************/
+
+/**
+ * \brief Copy the attached geometry in WKB format.
+ *
+ * The WKB is copied as is, only swapping the bytes of the parts that are
+ * not in the requested byte order.
+ *
+ * @param eByteOrder the byte order of the output.
+ * @param pabyDstBuffer a buffer of at least WkbSize() bytes.
+ *
+ * @return OGRERR_NONE, or OGRERR_FAILURE if the view is not attached.
+ */
+
+OGRErr OGRWkbGeometryView::exportToWkb( OGRwkbByteOrder eByteOrder,
+                                        unsigned char *pabyDstBuffer )
+
+{
+    if( pabyData == NULL )
+        return OGRERR_FAILURE;
+
+    memcpy( pabyDstBuffer, pabyData, nSize );
+    OGRWkbSetByteOrder( pabyDstBuffer, eByteOrder );
+
+    return OGRERR_NONE;
+}
+
+/************************************************************************/
+/*                           createGeometry()                           */
+/************************************************************************/
+
+/**
+ * \brief Build the OGRGeometry of the attached WKB.
+ *
+ * This is the same as calling OGRGeometryFactory::createFromWkb() on the
+ * attached buffer.
+ *
+ * @param ppoGeometry location to put the new geometry, which the caller
+ * must delete.
+ * @param poSRS the spatial reference to assign to the geometry, or NULL.
+ *
+ * @return OGRERR_NONE on success, or an error of createFromWkb().
+ */
+
+OGRErr OGRWkbGeometryView::createGeometry( OGRGeometry **ppoGeometry,
+                                           OGRSpatialReference *poSRS )
+
+{
+    *ppoGeometry = NULL;
+
+    if( pabyData == NULL )
+        return OGRERR_FAILURE;
+
+    return OGRGeometryFactory::createFromWkb( (unsigned char *) pabyData,
+                                              poSRS, ppoGeometry, nSize );
+}
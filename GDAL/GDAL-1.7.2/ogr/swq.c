@@ -25,10 +25,12 @@
 
 #include "cpl_conv.h"
 #include "cpl_multiproc.h"
+#include "cpl_hash_set.h"
 #include "swq.h"
 
 #ifndef SWQ_MALLOC
 #define SWQ_MALLOC(x) malloc(x)
+#define SWQ_REALLOC(x,y) realloc(x,y)
 #define SWQ_FREE(x) free(x)
 #endif
 
@@ -2228,16 +2230,20 @@ const char *swq_select_parse( swq_select *select_info,
 }
 
 /************************************************************************/
-/*                        swq_select_summarize()                        */
+/*                       swq_summarize_prepare()                        */
+/*                                                                      */
+/*      Validate the arguments of a swq_select_summarize*() call and    */
+/*      create the summary information on the first row.                */
 /************************************************************************/
 
-const char *
-swq_select_summarize( swq_select *select_info, 
-                      int dest_column, const char *value )
+static const char *
+swq_summarize_prepare( swq_select *select_info, int dest_column,
+                       swq_summary **summary_out )
 
 {
-    swq_col_def *def = select_info->column_defs + dest_column;
-    swq_summary *summary;
+    swq_col_def *def;
+
+    *summary_out = NULL;
 
 /* -------------------------------------------------------------------- */
 /*      Do various checking.                                            */
@@ -2248,9 +2254,13 @@ swq_select_summarize( swq_select *select_info,
     if( dest_column < 0 || dest_column >= select_info->result_columns )
         return "dest_column out of range in swq_select_summarize().";
 
+    def = select_info->column_defs + dest_column;
     if( def->col_func == SWQCF_NONE && !def->distinct_flag )
         return NULL;
 
+    if( def->col_func == SWQCF_CUSTOM )
+        return "swq_select_summarize() called on custom field function.";
+
 /* -------------------------------------------------------------------- */
 /*      Create the summary information if this is the first row         */
 /*      being processed.                                                */
@@ -2271,37 +2281,76 @@ swq_select_summarize( swq_select *select_info,
         }
     }
 
+    *summary_out = select_info->column_summary + dest_column;
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                    swq_summary_distinct_append()                     */
+/************************************************************************/
+
+static char *swq_summary_distinct_append( swq_summary *summary, 
+                                          const char *value )
+
+{
+    if( summary->count == summary->distinct_max )
+    {
+        summary->distinct_max = summary->distinct_max * 2 + 16;
+        summary->distinct_list = (char **) 
+            SWQ_REALLOC( summary->distinct_list, 
+                         sizeof(char *) * summary->distinct_max );
+    }
+
+    return summary->distinct_list[(summary->count)++] = swq_strdup( value );
+}
+
+/************************************************************************/
+/*                        swq_summary_distinct()                        */
+/*                                                                      */
+/*      Add value to the distinct list if it is not already there.      */
+/*      The strings of the list are indexed in a hash set, and the      */
+/*      list grows geometrically, so that accumulating n distinct       */
+/*      values is linear rather than quadratic in n.                    */
+/************************************************************************/
+
+static void swq_summary_distinct( swq_summary *summary, const char *value )
+
+{
+    if( summary->distinct_hash == NULL )
+        summary->distinct_hash = 
+            CPLHashSetNew( CPLHashSetHashStr, CPLHashSetEqualStr, NULL );
+
+    if( CPLHashSetLookup( (CPLHashSet *) summary->distinct_hash, 
+                          value ) != NULL )
+        return;
+
+    CPLHashSetInsert( (CPLHashSet *) summary->distinct_hash, 
+                      swq_summary_distinct_append( summary, value ) );
+}
+
+/************************************************************************/
+/*                        swq_select_summarize()                        */
+/************************************************************************/
+
+const char *
+swq_select_summarize( swq_select *select_info, 
+                      int dest_column, const char *value )
+
+{
+    swq_col_def *def = select_info->column_defs + dest_column;
+    swq_summary *summary;
+    const char *error;
+
+    error = swq_summarize_prepare( select_info, dest_column, &summary );
+    if( error != NULL || summary == NULL )
+        return error;
+
 /* -------------------------------------------------------------------- */
 /*      If distinct processing is on, process that now.                 */
 /* -------------------------------------------------------------------- */
-    summary = select_info->column_summary + dest_column;
-    
     if( def->distinct_flag )
-    {
-        int  i;
-
-        /* This should be implemented with a much more complicated
-           data structure to achieve any sort of efficiency. */
-        for( i = 0; i < summary->count; i++ )
-        {
-            if( strcmp(value,summary->distinct_list[i]) == 0 )
-                break;
-        }
-        
-        if( i == summary->count )
-        {
-            char  **old_list = summary->distinct_list;
-            
-            summary->distinct_list = (char **) 
-                SWQ_MALLOC(sizeof(char *) * (summary->count+1));
-            memcpy( summary->distinct_list, old_list, 
-                    sizeof(char *) * summary->count );
-            summary->distinct_list[(summary->count)++] = 
-                swq_strdup( value );
-
-            SWQ_FREE(old_list);
-        }
-    }
+        swq_summary_distinct( summary, value );
 
 /* -------------------------------------------------------------------- */
 /*      Process various options.                                        */
@@ -2342,8 +2391,149 @@ swq_select_summarize( swq_select *select_info,
       case SWQCF_NONE:
         break;
 
-      case SWQCF_CUSTOM:
-        return "swq_select_summarize() called on custom field function.";
+      default:
+        return "swq_select_summarize() - unexpected col_func";
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                          swq_distinct_key                            */
+/*                                                                      */
+/*      Typed key of the distinct values of a numeric column.           */
+/************************************************************************/
+
+typedef struct {
+    double      value;
+    int         is_set;
+} swq_distinct_key;
+
+static unsigned long swq_distinct_key_hash( const void *elt )
+{
+    const swq_distinct_key *key = (const swq_distinct_key *) elt;
+    GUInt32 words[2];
+
+    if( !key->is_set )
+        return 0;
+
+    memcpy( words, &(key->value), sizeof(double) );
+    return (unsigned long) (words[0] ^ (words[1] * 31));
+}
+
+static int swq_distinct_key_equal( const void *elt1, const void *elt2 )
+{
+    const swq_distinct_key *key1 = (const swq_distinct_key *) elt1;
+    const swq_distinct_key *key2 = (const swq_distinct_key *) elt2;
+
+    if( key1->is_set != key2->is_set )
+        return FALSE;
+
+    return !key1->is_set 
+        || memcmp( &(key1->value), &(key2->value), sizeof(double) ) == 0;
+}
+
+static void swq_distinct_key_free( void *elt )
+{
+    SWQ_FREE( elt );
+}
+
+/************************************************************************/
+/*                    swq_select_summarize_number()                     */
+/*                                                                      */
+/*      Same as swq_select_summarize() for an integer or real column,   */
+/*      taking the value itself rather than its string form.  The      */
+/*      string form, which is what the distinct list holds, is only    */
+/*      requested from fn_format() the first time a value is seen.     */
+/*      Unset values are passed with is_set FALSE, and formatted as     */
+/*      an empty string.                                                */
+/************************************************************************/
+
+const char *
+swq_select_summarize_number( swq_select *select_info, 
+                             int dest_column, int is_set, double value,
+                             swq_value_formatter fn_format, 
+                             void *record_handle )
+
+{
+    swq_col_def *def = select_info->column_defs + dest_column;
+    swq_summary *summary;
+    const char *error;
+
+    error = swq_summarize_prepare( select_info, dest_column, &summary );
+    if( error != NULL || summary == NULL )
+        return error;
+
+/* -------------------------------------------------------------------- */
+/*      If distinct processing is on, look the typed value up first,    */
+/*      and only format values seen for the first time.  Different      */
+/*      real values may format to the same string, so for them the      */
+/*      string list is still what decides which values are distinct.    */
+/* -------------------------------------------------------------------- */
+    if( def->distinct_flag )
+    {
+        swq_distinct_key key;
+
+        key.value = is_set ? value : 0.0;
+        key.is_set = is_set;
+
+        if( summary->distinct_key_hash == NULL )
+            summary->distinct_key_hash = 
+                CPLHashSetNew( swq_distinct_key_hash, 
+                               swq_distinct_key_equal,
+                               swq_distinct_key_free );
+
+        if( CPLHashSetLookup( (CPLHashSet *) summary->distinct_key_hash, 
+                              &key ) == NULL )
+        {
+            swq_distinct_key *new_key = (swq_distinct_key *) 
+                SWQ_MALLOC( sizeof(swq_distinct_key) );
+            const char *string_value;
+
+            *new_key = key;
+            CPLHashSetInsert( (CPLHashSet *) summary->distinct_key_hash, 
+                              new_key );
+
+            string_value = 
+                is_set ? fn_format( record_handle, dest_column ) : "";
+
+            if( def->field_type == SWQ_INTEGER )
+                swq_summary_distinct_append( summary, string_value );
+            else
+                swq_summary_distinct( summary, string_value );
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Process various options.                                        */
+/* -------------------------------------------------------------------- */
+
+    switch( def->col_func )
+    {
+      case SWQCF_MIN:
+        if( is_set && value < summary->min )
+            summary->min = value;
+        break;
+      case SWQCF_MAX:
+        if( is_set && value > summary->max )
+            summary->max = value;
+        break;
+      case SWQCF_AVG:
+      case SWQCF_SUM:
+        if( is_set )
+        {
+            summary->count++;
+            summary->sum += value;
+        }
+        break;
+
+      case SWQCF_COUNT:
+        if( !def->distinct_flag )
+            summary->count++;
+        break;
+
+      case SWQCF_NONE:
+        break;
 
       default:
         return "swq_select_summarize() - unexpected col_func";
@@ -2351,6 +2541,7 @@ swq_select_summarize( swq_select *select_info,
 
     return NULL;
 }
+
 /************************************************************************/
 /*                      sort comparison functions.                      */
 /************************************************************************/
@@ -2499,6 +2690,16 @@ void swq_select_free( swq_select *select_info )
 
             SWQ_FREE( select_info->column_summary[i].distinct_list );
         }
+
+        if( select_info->column_summary != NULL )
+        {
+            if( select_info->column_summary[i].distinct_hash != NULL )
+                CPLHashSetDestroy( (CPLHashSet *) 
+                           select_info->column_summary[i].distinct_hash );
+            if( select_info->column_summary[i].distinct_key_hash != NULL )
+                CPLHashSetDestroy( (CPLHashSet *) 
+                           select_info->column_summary[i].distinct_key_hash );
+        }
     }
 
     if( select_info->column_defs != NULL )
@@ -152,6 +152,11 @@ typedef struct {
     double      sum;
     double      min;
     double      max;
+
+    /* private to swq_select_summarize*() */
+    int         distinct_max;
+    void        *distinct_hash;     /* CPLHashSet of distinct_list strings */
+    void        *distinct_key_hash; /* CPLHashSet of typed distinct keys */
 } swq_summary;
 
 typedef struct {
@@ -212,6 +217,13 @@ const char *swq_select_finish_summarize( swq_select *select_info );
 const char *swq_select_summarize( swq_select *select_info, 
                                   int dest_column, 
                                   const char *value );
+typedef const char *(*swq_value_formatter)( void *record_handle, 
+                                            int dest_column );
+const char *swq_select_summarize_number( swq_select *select_info, 
+                                         int dest_column, 
+                                         int is_set, double value,
+                                         swq_value_formatter fn_format,
+                                         void *record_handle );
 
 
 #endif /* def _SWQ_H_INCLUDED_ */
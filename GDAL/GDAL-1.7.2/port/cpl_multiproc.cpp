@@ -172,6 +172,139 @@ static void CPLCleanupTLSList( void **papTLSList )
     CPLFree( papTLSList );
 }
 
+/************************************************************************/
+/*                          CPLGetNumThreads()                          */
+/************************************************************************/
+
+/**
+ * Translate a thread count setting into a number of worker threads.
+ *
+ * The value may be a positive integer or "ALL_CPUS" to use as many
+ * threads as there are processors.  If pszValue is NULL the
+ * GDAL_NUM_THREADS configuration option is used instead, defaulting to
+ * a single thread.
+ *
+ * @param pszValue the setting to translate, or NULL.
+ *
+ * @return a number of threads, always at least one.
+ */
+
+int CPLGetNumThreads( const char *pszValue )
+
+{
+    int nThreads;
+
+    if( pszValue == NULL )
+        pszValue = CPLGetConfigOption( "GDAL_NUM_THREADS", "1" );
+
+    if( EQUAL(pszValue,"ALL_CPUS") )
+        nThreads = CPLGetNumCPUs();
+    else
+        nThreads = atoi(pszValue);
+
+    if( nThreads < 1 )
+        nThreads = 1;
+
+    return nThreads;
+}
+
+/************************************************************************/
+/*                          CPLJobQueueMain()                           */
+/************************************************************************/
+
+typedef struct {
+    void         *hMutex;
+    int           nJobs;
+    int           iNextJob;
+    void        **papJobData;
+    CPLThreadFunc pfnJob;
+} CPLJobQueue;
+
+static void CPLJobQueueMain( void *pData )
+
+{
+    CPLJobQueue *psQueue = (CPLJobQueue *) pData;
+
+    for( ;; )
+    {
+        int iJob;
+
+        CPLAcquireMutex( psQueue->hMutex, 1000.0 );
+        iJob = psQueue->iNextJob++;
+        CPLReleaseMutex( psQueue->hMutex );
+
+        if( iJob >= psQueue->nJobs )
+            break;
+
+        psQueue->pfnJob( psQueue->papJobData[iJob] );
+    }
+}
+
+/************************************************************************/
+/*                             CPLRunJobs()                             */
+/************************************************************************/
+
+/**
+ * Run a list of independent jobs on a set of worker threads.
+ *
+ * pfnJob is called once for each entry of papJobData.  Jobs are handed
+ * out in list order to up to nThreads threads (the calling thread being
+ * one of them), and the function returns once all jobs have completed.
+ * If threads cannot be created, or nThreads is 1, the jobs are simply
+ * run in order on the calling thread.
+ *
+ * Jobs must not depend on each other, and must report their status
+ * through their own job data.
+ *
+ * @param nJobs number of jobs in papJobData.
+ * @param papJobData list of job arguments passed to pfnJob.
+ * @param pfnJob the function to run for each job.
+ * @param nThreads maximum number of threads to use.
+ */
+
+void CPLRunJobs( int nJobs, void **papJobData, CPLThreadFunc pfnJob,
+                 int nThreads )
+
+{
+    int i;
+
+    if( nThreads > nJobs )
+        nThreads = nJobs;
+
+    if( nThreads <= 1 )
+    {
+        for( i = 0; i < nJobs; i++ )
+            pfnJob( papJobData[i] );
+        return;
+    }
+
+    CPLJobQueue sQueue;
+    CPLJoinableThread **pahThreads;
+
+    sQueue.hMutex = CPLCreateMutex();
+    CPLReleaseMutex( sQueue.hMutex );
+    sQueue.nJobs = nJobs;
+    sQueue.iNextJob = 0;
+    sQueue.papJobData = papJobData;
+    sQueue.pfnJob = pfnJob;
+
+    pahThreads = (CPLJoinableThread **)
+        CPLCalloc( sizeof(CPLJoinableThread*), nThreads - 1 );
+    for( i = 0; i < nThreads - 1; i++ )
+        pahThreads[i] = CPLCreateJoinableThread( CPLJobQueueMain, &sQueue );
+
+    CPLJobQueueMain( &sQueue );
+
+    for( i = 0; i < nThreads - 1; i++ )
+    {
+        if( pahThreads[i] != NULL )
+            CPLJoinThread( pahThreads[i] );
+    }
+
+    CPLFree( pahThreads );
+    CPLDestroyMutex( sQueue.hMutex );
+}
+
 #ifdef CPL_MULTIPROC_STUB
 /************************************************************************/
 /* ==================================================================== */
@@ -373,6 +506,37 @@ int CPLCreateThread( CPLThreadFunc pfnMain, void *pArg )
     return -1;
 }
 
+/************************************************************************/
+/*                      CPLCreateJoinableThread()                       */
+/************************************************************************/
+
+CPLJoinableThread* CPLCreateJoinableThread( CPLThreadFunc pfnMain, void *pArg )
+
+{
+    CPLDebug( "CPLCreateJoinableThread", "Fails to dummy implementation" );
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                           CPLJoinThread()                            */
+/************************************************************************/
+
+void CPLJoinThread( CPLJoinableThread* hJoinableThread )
+
+{
+}
+
+/************************************************************************/
+/*                           CPLGetNumCPUs()                            */
+/************************************************************************/
+
+int CPLGetNumCPUs()
+
+{
+    return 1;
+}
+
 /************************************************************************/
 /*                              CPLSleep()                              */
 /************************************************************************/
@@ -623,6 +787,68 @@ int CPLCreateThread( CPLThreadFunc pfnMain, void *pThreadArg )
     return nThreadId;
 }
 
+/************************************************************************/
+/*                      CPLCreateJoinableThread()                       */
+/************************************************************************/
+
+struct _CPLJoinableThread
+{
+    HANDLE hThread;
+};
+
+CPLJoinableThread* CPLCreateJoinableThread( CPLThreadFunc pfnMain,
+                                            void *pThreadArg )
+
+{
+    DWORD  nThreadId;
+    CPLStdCallThreadInfo *psInfo;
+    CPLJoinableThread *psJoinableThread;
+
+    psInfo = (CPLStdCallThreadInfo*) CPLCalloc(sizeof(CPLStdCallThreadInfo),1);
+    psInfo->pAppData = pThreadArg;
+    psInfo->pfnMain = pfnMain;
+
+    psJoinableThread = (CPLJoinableThread*)
+        CPLCalloc(sizeof(CPLJoinableThread),1);
+    psJoinableThread->hThread = CreateThread( NULL, 0, CPLStdCallThreadJacket,
+                                              psInfo, 0, &nThreadId );
+
+    if( psJoinableThread->hThread == NULL )
+    {
+        CPLFree( psInfo );
+        CPLFree( psJoinableThread );
+        return NULL;
+    }
+
+    return psJoinableThread;
+}
+
+/************************************************************************/
+/*                           CPLJoinThread()                            */
+/************************************************************************/
+
+void CPLJoinThread( CPLJoinableThread* hJoinableThread )
+
+{
+    WaitForSingleObject( hJoinableThread->hThread, INFINITE );
+    CloseHandle( hJoinableThread->hThread );
+    CPLFree( hJoinableThread );
+}
+
+/************************************************************************/
+/*                           CPLGetNumCPUs()                            */
+/************************************************************************/
+
+int CPLGetNumCPUs()
+
+{
+    SYSTEM_INFO sInfo;
+
+    GetSystemInfo( &sInfo );
+
+    return MAX( 1, (int) sInfo.dwNumberOfProcessors );
+}
+
 /************************************************************************/
 /*                              CPLSleep()                              */
 /************************************************************************/
@@ -696,6 +922,7 @@ void CPLCleanupTLS()
 #ifdef CPL_MULTIPROC_PTHREAD
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
 
   /************************************************************************/
   /* ==================================================================== */
@@ -935,6 +1162,67 @@ int CPLCreateThread( CPLThreadFunc pfnMain, void *pThreadArg )
     return 1; /* can we return the actual thread pid? */
 }
 
+/************************************************************************/
+/*                      CPLCreateJoinableThread()                       */
+/************************************************************************/
+
+struct _CPLJoinableThread
+{
+    pthread_t hThread;
+};
+
+CPLJoinableThread* CPLCreateJoinableThread( CPLThreadFunc pfnMain,
+                                            void *pThreadArg )
+
+{
+    CPLStdCallThreadInfo *psInfo;
+    CPLJoinableThread *psJoinableThread;
+
+    psInfo = (CPLStdCallThreadInfo*) CPLCalloc(sizeof(CPLStdCallThreadInfo),1);
+    psInfo->pAppData = pThreadArg;
+    psInfo->pfnMain = pfnMain;
+
+    psJoinableThread = (CPLJoinableThread*)
+        CPLCalloc(sizeof(CPLJoinableThread),1);
+
+    if( pthread_create( &(psJoinableThread->hThread), NULL,
+                        CPLStdCallThreadJacket, (void *) psInfo ) != 0 )
+    {
+        CPLFree( psInfo );
+        CPLFree( psJoinableThread );
+        return NULL;
+    }
+
+    return psJoinableThread;
+}
+
+/************************************************************************/
+/*                           CPLJoinThread()                            */
+/************************************************************************/
+
+void CPLJoinThread( CPLJoinableThread* hJoinableThread )
+
+{
+    pthread_join( hJoinableThread->hThread, NULL );
+    CPLFree( hJoinableThread );
+}
+
+/************************************************************************/
+/*                           CPLGetNumCPUs()                            */
+/************************************************************************/
+
+int CPLGetNumCPUs()
+
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    int nCPUs = (int) sysconf( _SC_NPROCESSORS_ONLN );
+
+    return MAX( 1, nCPUs );
+#else
+    return 1;
+#endif
+}
+
 /************************************************************************/
 /*                              CPLSleep()                              */
 /************************************************************************/
@@ -52,6 +52,8 @@ CPL_C_START
 
 typedef void (*CPLThreadFunc)(void *);
 
+typedef struct _CPLJoinableThread CPLJoinableThread;
+
 void CPL_DLL *CPLLockFile( const char *pszPath, double dfWaitInSeconds );
 void  CPL_DLL CPLUnlockFile( void *hLock );
 
@@ -65,6 +67,15 @@ GIntBig CPL_DLL CPLGetPID();
 int   CPL_DLL CPLCreateThread( CPLThreadFunc pfnMain, void *pArg );
 void  CPL_DLL CPLSleep( double dfWaitInSeconds );
 
+CPLJoinableThread CPL_DLL *CPLCreateJoinableThread( CPLThreadFunc pfnMain,
+                                                    void *pArg );
+void  CPL_DLL CPLJoinThread( CPLJoinableThread *hJoinableThread );
+
+int   CPL_DLL CPLGetNumCPUs();
+int   CPL_DLL CPLGetNumThreads( const char *pszValue );
+void  CPL_DLL CPLRunJobs( int nJobs, void **papJobData, CPLThreadFunc pfnJob,
+                          int nThreads );
+
 const char CPL_DLL *CPLGetThreadingModel();
 
 CPL_C_END
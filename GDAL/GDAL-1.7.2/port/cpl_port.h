@@ -299,6 +299,15 @@ typedef unsigned long    GUIntBig;
 #endif
 #endif
 
+/* Case insensitive ordering of strings, for sorting. */
+#ifndef STRCASECMP
+#if defined(WIN32) || defined(WIN32CE)
+#  define STRCASECMP(a,b)         (stricmp(a,b))
+#else
+#  define STRCASECMP(a,b)         (strcasecmp(a,b))
+#endif
+#endif
+
 #ifdef macos_pre10
 int strcasecmp(char * str1, char * str2);
 int strncasecmp(char * str1, char * str2, int len);